@@ -36,7 +36,10 @@ CHAR strYsHelpText[] =
         "\n"
         "Execute a script in Yori.\n"
         "\n"
-        "YS [-license] <script>\n"
+        "YS [-license] [-profile] <script>\n"
+        "\n"
+        "   -profile       Display the number of times each line was executed and the\n"
+        "                  time spent executing it\n"
         "\n"
         "Yori scripts are different to CMD scripts.  Notable changes include:\n"
         " 1. Parameters are referred to as %1%, %2%, ... rather than %1, %2 ...\n"
@@ -223,6 +226,35 @@ typedef struct _YS_SCRIPT_LINE {
      */
     YORI_STRING LineContents;
 
+    /**
+     If the line is a label, the entry for the line in the hash table of
+     labels within the script.
+     */
+    YORI_HASH_ENTRY LabelEntry;
+
+    /**
+     The line number of this line within the file it was loaded from.
+     */
+    DWORD LineNumber;
+
+    /**
+     The number of times this line has been executed.  This is only updated
+     when profiling.
+     */
+    DWORD ExecuteCount;
+
+    /**
+     The total time spent executing this line, in performance counter units.
+     This is only updated when profiling.
+     */
+    LONGLONG ExecuteTime;
+
+    /**
+     TRUE if the line contains a variable which may need to be expanded
+     before executing it.  If FALSE, the line can be executed as is.
+     */
+    BOOLEAN NeedsExpansion;
+
 } YS_SCRIPT_LINE, *PYS_SCRIPT_LINE;
 
 /**
@@ -298,6 +330,18 @@ typedef struct _YS_SCRIPT {
      */
     PYS_ARGUMENT_CONTEXT ArgContext;
 
+    /**
+     A hash table of labels within the script, used to find the target of
+     a goto or call.  If NULL, the script is searched for the label.
+     */
+    PYORI_HASH_TABLE Labels;
+
+    /**
+     TRUE if the number of times each line is executed and the time spent
+     executing it should be recorded.
+     */
+    BOOLEAN Profile;
+
 } YS_SCRIPT, *PYS_SCRIPT;
 
 /**
@@ -306,6 +350,90 @@ typedef struct _YS_SCRIPT {
  */
 PYS_SCRIPT YsActiveScript = NULL;
 
+/**
+ If a line within a script is a label, return the name of the label.
+
+ @param Line Pointer to the line within the script.
+
+ @param LabelString On successful completion, updated to point to the name
+        of the label within the line.  This string is not referenced.
+
+ @return TRUE if the line is a label, FALSE if it is not.
+ */
+BOOL
+YsGetLineLabel(
+    __in PYS_SCRIPT_LINE Line,
+    __out PYORI_STRING LabelString
+    )
+{
+    if (Line->LineContents.LengthInChars <= 1 ||
+        Line->LineContents.StartOfString[0] != ':') {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(LabelString);
+    LabelString->StartOfString = &Line->LineContents.StartOfString[1];
+    LabelString->LengthInChars = Line->LineContents.LengthInChars - 1;
+
+    if (LabelString->LengthInChars >= 1 &&
+        LabelString->StartOfString[LabelString->LengthInChars - 1] == '\0') {
+        LabelString->LengthInChars--;
+    }
+
+    return TRUE;
+}
+
+/**
+ Build or rebuild the hash table of labels within a script.  If the same
+ label occurs more than once, the first occurrence is used.  If the table
+ cannot be allocated, labels are found by searching the script.
+
+ @param Script Pointer to the script.
+ */
+VOID
+YsBuildLabelIndex(
+    __in PYS_SCRIPT Script
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYS_SCRIPT_LINE Line;
+    YORI_STRING LabelString;
+
+    if (Script->Labels == NULL) {
+        Script->Labels = YoriLibAllocateHashTable(250);
+        if (Script->Labels == NULL) {
+            return;
+        }
+    }
+
+    //
+    //  Remove any existing labels first, since lines may have been inserted
+    //  ahead of a label that was previously the first occurrence.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
+        if (Line->LabelEntry.HashTable != NULL) {
+            YoriLibHashRemoveByEntry(&Line->LabelEntry);
+        }
+        ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, ListEntry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
+        if (YsGetLineLabel(Line, &LabelString) &&
+            LabelString.LengthInChars > 0 &&
+            YoriLibHashLookupByKey(Script->Labels, &LabelString) == NULL) {
+
+            YoriLibHashInsertByKey(Script->Labels, &LabelString, Line, &Line->LabelEntry);
+        }
+        ListEntry = YoriLibGetNextListEntry(&Script->LineLinks, ListEntry);
+    }
+}
+
 /**
  Switch the actively executing line within the script to the specified label,
  if it can be found.
@@ -322,6 +450,7 @@ YsGotoLabel(
 {
     PYORI_LIST_ENTRY ListEntry;
     PYS_SCRIPT_LINE Line;
+    YORI_STRING LabelString;
 
     //
     //  First special case :eof for no good reason other than CMD does.
@@ -342,23 +471,23 @@ YsGotoLabel(
     //  Now look for user defined labels within the script.
     //
 
-    ListEntry = YoriLibGetNextListEntry(&YsActiveScript->LineLinks, NULL);
-    while (ListEntry != NULL) {
-        Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
-        if (Line->LineContents.LengthInChars > 1 &&
-            Line->LineContents.StartOfString[0] == ':') {
-
-            YORI_STRING LabelString;
+    if (YsActiveScript->Labels != NULL) {
+        PYORI_HASH_ENTRY HashEntry;
 
-            YoriLibInitEmptyString(&LabelString);
-            LabelString.StartOfString = &Line->LineContents.StartOfString[1];
-            LabelString.LengthInChars = Line->LineContents.LengthInChars - 1;
+        YoriLibConstantString(&LabelString, Label);
+        HashEntry = YoriLibHashLookupByKey(YsActiveScript->Labels, &LabelString);
+        if (HashEntry == NULL) {
+            return FALSE;
+        }
 
-            if (LabelString.LengthInChars >= 1 &&
-                LabelString.StartOfString[LabelString.LengthInChars - 1] == '\0') {
-                LabelString.LengthInChars--;
-            }
+        YsActiveScript->ActiveLine = HashEntry->Context;
+        return TRUE;
+    }
 
+    ListEntry = YoriLibGetNextListEntry(&YsActiveScript->LineLinks, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YS_SCRIPT_LINE, LineLinks);
+        if (YsGetLineLabel(Line, &LabelString)) {
             if (YoriLibCompareStringWithLiteralInsensitive(&LabelString, Label) == 0) {
                 YsActiveScript->ActiveLine = Line;
                 return TRUE;
@@ -407,6 +536,8 @@ YsLoadLines(
     PVOID LineContext = NULL;
     PYS_SCRIPT_LINE ThisLine;
     PYORI_LIST_ENTRY InsertPoint = ListHead;
+    DWORD LineNumber = 0;
+    DWORD Index;
 
     while (TRUE) {
 
@@ -416,7 +547,10 @@ YsLoadLines(
             return FALSE;
         }
 
+        ZeroMemory(ThisLine, sizeof(YS_SCRIPT_LINE));
         YoriLibInitEmptyString(&ThisLine->LineContents);
+        LineNumber++;
+        ThisLine->LineNumber = LineNumber;
 
         if (!YoriLibReadLineToString(&ThisLine->LineContents, &LineContext, Handle)) {
             YoriLibFree(ThisLine);
@@ -433,6 +567,18 @@ YsLoadLines(
         ASSERT(ThisLine->LineContents.StartOfString[ThisLine->LineContents.LengthInChars] == '\0');
         ThisLine->LineContents.LengthInChars++;
 
+        //
+        //  Only lines containing a variable need to be expanded before each
+        //  execution.
+        //
+
+        for (Index = 0; Index < ThisLine->LineContents.LengthInChars; Index++) {
+            if (ThisLine->LineContents.StartOfString[Index] == '%') {
+                ThisLine->NeedsExpansion = TRUE;
+                break;
+            }
+        }
+
         YoriLibInsertList(InsertPoint, &ThisLine->LineLinks);
         InsertPoint = &ThisLine->LineLinks;
     }
@@ -896,6 +1042,10 @@ YoriCmd_INCLUDE(
 
     CloseHandle(FileHandle);
 
+    if (YsActiveScript->Labels != NULL) {
+        YsBuildLabelIndex(YsActiveScript);
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -1075,11 +1225,14 @@ YsExecuteScript(
     )
 {
     YORI_STRING LineWithArgumentsExpanded;
+    YORI_STRING LineToExecute;
     YORI_STRING CommandName;
     DWORD Index;
     PYORI_LIST_ENTRY NextEntry;
     PYS_SCRIPT_LINE CurrentLine;
     PYS_SCRIPT PreviouslyActiveScript;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
 
     for (Index = 0; Index < sizeof(YsScriptCommands)/sizeof(YsScriptCommands[0]); Index++) {
         YoriLibConstantString(&CommandName, YsScriptCommands[Index].CommandName);
@@ -1105,27 +1258,51 @@ YsExecuteScript(
         if (CurrentLine->LineContents.LengthInChars > 1 &&
             CurrentLine->LineContents.StartOfString[0] != ':') {
 
-            if (!YoriLibExpandCommandVariables(&CurrentLine->LineContents, '%', TRUE, YsExpandArgumentVariables, Script->ArgContext, &LineWithArgumentsExpanded)) {
-                break;
+            if (Script->Profile) {
+                QueryPerformanceCounter(&StartTime);
             }
 
-            //
-            //  Lines are intentionally left with NULLs inside the string, so
-            //  we'd normally truncate these here.  When an incomplete command
-            //  expansion is used though, the NULL ends up in the variable name
-            //  so it can get truncated.  YoriLibExpandCommandVariables
-            //  also adds one, but it's not within the string, so check which
-            //  case we're in.
-            //
-
-            if (LineWithArgumentsExpanded.LengthInChars > 0 &&
-                LineWithArgumentsExpanded.StartOfString[LineWithArgumentsExpanded.LengthInChars - 1] == '\0') {
-                LineWithArgumentsExpanded.LengthInChars--;
+            if (CurrentLine->NeedsExpansion) {
+                if (!YoriLibExpandCommandVariables(&CurrentLine->LineContents, '%', TRUE, YsExpandArgumentVariables, Script->ArgContext, &LineWithArgumentsExpanded)) {
+                    break;
+                }
+
+                //
+                //  Lines are intentionally left with NULLs inside the string, so
+                //  we'd normally truncate these here.  When an incomplete command
+                //  expansion is used though, the NULL ends up in the variable name
+                //  so it can get truncated.  YoriLibExpandCommandVariables
+                //  also adds one, but it's not within the string, so check which
+                //  case we're in.
+                //
+
+                if (LineWithArgumentsExpanded.LengthInChars > 0 &&
+                    LineWithArgumentsExpanded.StartOfString[LineWithArgumentsExpanded.LengthInChars - 1] == '\0') {
+                    LineWithArgumentsExpanded.LengthInChars--;
+                }
+                ASSERT(LineWithArgumentsExpanded.StartOfString[LineWithArgumentsExpanded.LengthInChars] == '\0');
+
+                memcpy(&LineToExecute, &LineWithArgumentsExpanded, sizeof(YORI_STRING));
+            } else {
+
+                //
+                //  With nothing to expand, execute the line as loaded,
+                //  excluding its NULL terminator.
+                //
+
+                YoriLibInitEmptyString(&LineToExecute);
+                LineToExecute.StartOfString = CurrentLine->LineContents.StartOfString;
+                LineToExecute.LengthInChars = CurrentLine->LineContents.LengthInChars - 1;
             }
-            ASSERT(LineWithArgumentsExpanded.StartOfString[LineWithArgumentsExpanded.LengthInChars] == '\0');
 
-            YoriCallExecuteExpression(&LineWithArgumentsExpanded);
+            YoriCallExecuteExpression(&LineToExecute);
             ASSERT(YsActiveScript == Script);
+
+            if (Script->Profile) {
+                QueryPerformanceCounter(&EndTime);
+                CurrentLine->ExecuteCount++;
+                CurrentLine->ExecuteTime += EndTime.QuadPart - StartTime.QuadPart;
+            }
         }
 
         NextEntry = YoriLibGetNextListEntry(&Script->LineLinks, &Script->ActiveLine->LineLinks);
@@ -1164,10 +1341,18 @@ YsFreeScript(
         CurrentLine = CONTAINING_RECORD(NextEntry, YS_SCRIPT_LINE, LineLinks);
         NextEntry = YoriLibGetNextListEntry(&Script->LineLinks, NextEntry);
 
+        if (CurrentLine->LabelEntry.HashTable != NULL) {
+            YoriLibHashRemoveByEntry(&CurrentLine->LabelEntry);
+        }
         YoriLibFreeStringContents(&CurrentLine->LineContents);
         YoriLibFree(CurrentLine);
     }
 
+    if (Script->Labels != NULL) {
+        YoriLibFreeEmptyHashTable(Script->Labels);
+        Script->Labels = NULL;
+    }
+
     CallStackFound = FALSE;
 
     NextEntry = YoriLibGetNextListEntry(&Script->CallStackLinks, NULL);
@@ -1207,6 +1392,7 @@ YsLoadScript(
 {
     BOOL Result = TRUE;
 
+    ZeroMemory(Script, sizeof(YS_SCRIPT));
     YoriLibInitializeListHead(&Script->LineLinks);
     YoriLibInitializeListHead(&Script->CallStackLinks);
 
@@ -1216,10 +1402,51 @@ YsLoadScript(
 
     if (Result == FALSE) {
         YsFreeScript(Script);
+    } else {
+        YsBuildLabelIndex(Script);
     }
     return Result;
 }
 
+/**
+ Display the number of times each line in a script was executed and the
+ time spent executing it.
+
+ @param Script Pointer to the script which was executed with profiling
+        enabled.
+ */
+VOID
+YsDisplayProfile(
+    __in PYS_SCRIPT Script
+    )
+{
+    PYORI_LIST_ENTRY NextEntry;
+    PYS_SCRIPT_LINE CurrentLine;
+    LARGE_INTEGER Frequency;
+    YORI_STRING LineText;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("\n    Line      Count   Time (us)  Command\n"));
+
+    NextEntry = YoriLibGetNextListEntry(&Script->LineLinks, NULL);
+    while(NextEntry != NULL) {
+        CurrentLine = CONTAINING_RECORD(NextEntry, YS_SCRIPT_LINE, LineLinks);
+        if (CurrentLine->ExecuteCount > 0) {
+            YoriLibInitEmptyString(&LineText);
+            LineText.StartOfString = CurrentLine->LineContents.StartOfString;
+            LineText.LengthInChars = CurrentLine->LineContents.LengthInChars - 1;
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR,
+                          _T("%8i %10i %11lli  %y\n"),
+                          CurrentLine->LineNumber,
+                          CurrentLine->ExecuteCount,
+                          CurrentLine->ExecuteTime * 1000000 / Frequency.QuadPart,
+                          &LineText);
+        }
+        NextEntry = YoriLibGetNextListEntry(&Script->LineLinks, NextEntry);
+    }
+}
+
 /**
  Execute a script.
 
@@ -1241,6 +1468,7 @@ YoriCmd_YS(
     YORI_STRING FileName;
     DWORD i;
     DWORD StartArg = 0;
+    BOOLEAN Profile = FALSE;
     YS_SCRIPT Script;
     YORI_STRING Arg;
 
@@ -1260,6 +1488,9 @@ YoriCmd_YS(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
                 YoriLibDisplayMitLicense(_T("2017-2018"));
                 return EXIT_SUCCESS;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("profile")) == 0) {
+                Profile = TRUE;
+                ArgumentUnderstood = TRUE;
             }
         } else {
             ArgumentUnderstood = TRUE;
@@ -1314,12 +1545,17 @@ YoriCmd_YS(
     Script.GlobalArgContext.ArgV = ArgV;
 
     Script.ArgContext = &Script.GlobalArgContext;
+    Script.Profile = Profile;
 
     if (!YsExecuteScript(&Script)) {
         YsFreeScript(&Script);
         return EXIT_FAILURE;
     }
 
+    if (Script.Profile) {
+        YsDisplayProfile(&Script);
+    }
+
     YsFreeScript(&Script);
 
     return YoriCallGetErrorLevel();
@@ -36,10 +36,13 @@ CHAR strCompactHelpText[] =
         "Compress or decompress one or more files.\n"
         "\n"
         "COMPACT [-license] [-b] [-c:algorithm | -u] [-s] [<file>...]\n"
+        "COMPACT -perf [-b] <file>...\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Compress files with the specified algorithm.  Options are:\n"
         "                    lzx, ntfs, xp4k, xp8k, xp16k\n"
+        "   -perf          Measure how many files per second are found in all\n"
+        "                    subdirectories, with and without parallel enumeration\n"
         "   -s             Process files from all subdirectories\n"
         "   -u             Decompress files\n"
         "   -v             Verbose output\n";
@@ -86,6 +89,13 @@ typedef struct _COMPACT_CONTEXT {
      */
     LONGLONG FilesFound;
 
+    /**
+     Records the number of files found when measuring enumeration speed.
+     Enumeration may invoke the callback from several threads at once, so
+     this is updated with interlocked operations.
+     */
+    LONG PerfFilesFound;
+
     /**
      Context for the background thread pool that performs compression tasks.
      */
@@ -210,6 +220,188 @@ CompactFileEnumerateErrorCallback(
     return Result;
 }
 
+/**
+ A callback that is invoked for each file found when measuring enumeration
+ speed.  This only counts the file.
+
+ @param FilePath Pointer to the file path that was found.
+
+ @param FileInfo Information about the file.
+
+ @param Depth Specifies recursion depth.  Ignored in this application.
+
+ @param Context Pointer to the compact context structure containing the
+        count of files found.
+
+ @return TRUE to continute enumerating, FALSE to abort.
+ */
+BOOL
+CompactPerfFileFoundCallback(
+    __in PYORI_STRING FilePath,
+    __in PWIN32_FIND_DATA FileInfo,
+    __in DWORD Depth,
+    __in PVOID Context
+    )
+{
+    PCOMPACT_CONTEXT CompactContext = (PCOMPACT_CONTEXT)Context;
+
+    UNREFERENCED_PARAMETER(FilePath);
+    UNREFERENCED_PARAMETER(FileInfo);
+    UNREFERENCED_PARAMETER(Depth);
+
+    InterlockedIncrement(&CompactContext->PerfFilesFound);
+    return TRUE;
+}
+
+/**
+ Find all files matching a set of arguments, counting them and measuring the
+ time taken.
+
+ @param CompactContext Pointer to the compact context, which is used to
+        count files found.
+
+ @param ArgC The number of arguments to enumerate.
+
+ @param ArgV An array of arguments to enumerate.
+
+ @param MatchFlags Specifies the flags to enumerate with.
+
+ @param FilesFound On successful completion, updated to contain the number of
+        files found.
+
+ @param Ticks On successful completion, updated to contain the number of
+        performance counter ticks taken to find the files.
+
+ @return TRUE to indicate success, FALSE if the operation was cancelled.
+ */
+BOOL
+CompactPerfEnumerate(
+    __in PCOMPACT_CONTEXT CompactContext,
+    __in DWORD ArgC,
+    __in YORI_STRING ArgV[],
+    __in DWORD MatchFlags,
+    __out PLONG FilesFound,
+    __out PLONGLONG Ticks
+    )
+{
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    DWORD i;
+
+    CompactContext->PerfFilesFound = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (i = 0; i < ArgC; i++) {
+        YoriLibForEachFile(&ArgV[i],
+                           MatchFlags,
+                           0,
+                           CompactPerfFileFoundCallback,
+                           CompactFileEnumerateErrorCallback,
+                           CompactContext);
+        if (YoriLibIsOperationCancelled()) {
+            return FALSE;
+        }
+    }
+    QueryPerformanceCounter(&EndTime);
+
+    *FilesFound = CompactContext->PerfFilesFound;
+    *Ticks = EndTime.QuadPart - StartTime.QuadPart;
+    return TRUE;
+}
+
+/**
+ Convert a number of files found over a number of performance counter ticks
+ into files per second.
+
+ @param FilesFound The number of files found.
+
+ @param Ticks The number of performance counter ticks elapsed.
+
+ @param Frequency The number of performance counter ticks per second.
+
+ @return The number of files found per second.
+ */
+DWORDLONG
+CompactPerfRate(
+    __in LONG FilesFound,
+    __in LONGLONG Ticks,
+    __in LONGLONG Frequency
+    )
+{
+    if (Ticks <= 0) {
+        Ticks = 1;
+    }
+    return (DWORDLONG)FilesFound * Frequency / Ticks;
+}
+
+/**
+ Measure how quickly files are found in a set of arguments and all of their
+ subdirectories, enumerating one directory at a time and then enumerating
+ subdirectories in parallel, and display the result for each.  The files are
+ enumerated once before either is measured, so both measurements see the
+ same cached file system state.
+
+ @param CompactContext Pointer to the compact context, which is used to
+        count files found.
+
+ @param ArgC The number of arguments to enumerate.
+
+ @param ArgV An array of arguments to enumerate.
+
+ @param MatchFlags Specifies the flags to enumerate with, not including
+        YORILIB_FILEENUM_PARALLEL.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+CompactPerf(
+    __in PCOMPACT_CONTEXT CompactContext,
+    __in DWORD ArgC,
+    __in YORI_STRING ArgV[],
+    __in DWORD MatchFlags
+    )
+{
+    LARGE_INTEGER Frequency;
+    LONG SerialFilesFound;
+    LONG ParallelFilesFound;
+    LONGLONG SerialTicks;
+    LONGLONG ParallelTicks;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    //
+    //  The first enumeration only populates the file system cache, so its
+    //  results are replaced by the next one.
+    //
+
+    if (!CompactPerfEnumerate(CompactContext, ArgC, ArgV, MatchFlags, &SerialFilesFound, &SerialTicks)) {
+        return FALSE;
+    }
+
+    if (!CompactPerfEnumerate(CompactContext, ArgC, ArgV, MatchFlags, &SerialFilesFound, &SerialTicks) ||
+        !CompactPerfEnumerate(CompactContext, ArgC, ArgV, MatchFlags | YORILIB_FILEENUM_PARALLEL, &ParallelFilesFound, &ParallelTicks)) {
+
+        return FALSE;
+    }
+
+    if (SerialFilesFound == 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("compact: no matching files found\n"));
+        return FALSE;
+    }
+
+    if (SerialFilesFound != ParallelFilesFound) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("compact: found %i files in series but %i files in parallel\n"), SerialFilesFound, ParallelFilesFound);
+        return FALSE;
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%i files: serial %lli files/s, parallel %lli files/s\n"),
+                  SerialFilesFound,
+                  CompactPerfRate(SerialFilesFound, SerialTicks, Frequency.QuadPart),
+                  CompactPerfRate(ParallelFilesFound, ParallelTicks, Frequency.QuadPart));
+
+    return TRUE;
+}
+
 
 #ifdef YORI_BUILTIN
 /**
@@ -243,6 +435,7 @@ ENTRYPOINT(
     DWORD StartArg = 0;
     DWORD MatchFlags;
     BOOL BasicEnumeration = FALSE;
+    BOOL Perf = FALSE;
     COMPACT_CONTEXT CompactContext;
     YORILIB_COMPRESS_ALGORITHM CompressionAlgorithm;
     YORI_STRING Arg;
@@ -294,6 +487,9 @@ ENTRYPOINT(
                 CompactContext.Compress = TRUE;
                 ArgumentUnderstood = TRUE;
 
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
+                Perf = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 CompactContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -330,6 +526,28 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
+    //
+    //  When measuring enumeration, find files and directories in the same
+    //  way as compact -s, but only count them.
+    //
+
+    if (Perf) {
+#if YORI_BUILTIN
+        YoriLibCancelEnable();
+#endif
+        CompactContext.Recursive = TRUE;
+        MatchFlags = YORILIB_FILEENUM_RETURN_FILES |
+                     YORILIB_FILEENUM_RETURN_DIRECTORIES |
+                     YORILIB_FILEENUM_RECURSE_BEFORE_RETURN;
+        if (BasicEnumeration) {
+            MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
+        }
+        if (!CompactPerf(&CompactContext, ArgC - StartArg, &ArgV[StartArg], MatchFlags)) {
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
     if (!YoriLibInitializeCompressContext(&CompactContext.CompressContext, CompressionAlgorithm)) {
         YoriLibFreeCompressContext(&CompactContext.CompressContext);
         return EXIT_FAILURE;
@@ -353,6 +571,15 @@ ENTRYPOINT(
     MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES;
     if (CompactContext.Recursive) {
         MatchFlags |= YORILIB_FILEENUM_RECURSE_BEFORE_RETURN;
+
+        //
+        //  The callback only queues work for the compression threads, so
+        //  finding files is the bottleneck.  Enumerate subdirectories in
+        //  parallel, and serialize callbacks since they update the file
+        //  count and may compress on the calling thread.
+        //
+
+        MatchFlags |= YORILIB_FILEENUM_PARALLEL | YORILIB_FILEENUM_SERIALIZE_CALLBACKS;
     }
     if (BasicEnumeration) {
         MatchFlags |= YORILIB_FILEENUM_BASIC_EXPANSION;
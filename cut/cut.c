@@ -138,9 +138,16 @@ CutFilterHandle(
     YORI_STRING MatchingSubset;
     PVOID LineContext = NULL;
     YORI_STRING LineString;
+    BOOLEAN SourceIsPipe;
+    DWORD BytesAvailable;
 
     YoriLibInitEmptyString(&LineString);
 
+    SourceIsPipe = FALSE;
+    if (GetFileType(hSource) == FILE_TYPE_PIPE) {
+        SourceIsPipe = TRUE;
+    }
+
     while (TRUE) {
         if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
             break;
@@ -186,6 +193,18 @@ CutFilterHandle(
         if (MatchingSubset.LengthInChars > 0) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &MatchingSubset);
         }
+
+        //
+        //  If the source is a pipe and it has no more data yet, write
+        //  everything so far so the output keeps up with the producer.
+        //
+
+        if (SourceIsPipe &&
+            (!PeekNamedPipe(hSource, NULL, 0, NULL, &BytesAvailable, NULL) ||
+             BytesAvailable == 0)) {
+
+            YoriLibOutputFlush(GetStdHandle(STD_OUTPUT_HANDLE));
+        }
     }
 
     YoriLibLineReadClose(LineContext);
@@ -433,6 +452,13 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    //
+    //  Output is generated a line at a time, so if it's going to a file or
+    //  pipe, buffer it to write in larger chunks.
+    //
+
+    YoriLibOutputEnableBuffering(GetStdHandle(STD_OUTPUT_HANDLE));
+
     if (StartArg == 0 || StartArg == ArgC) {
         if (YoriLibIsStdInConsole()) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("No file or pipe for input\n"));
@@ -37,21 +37,29 @@ const
 CHAR strForHelpText[] =
         "Enumerates through a list of strings or files.\n"
         "\n"
-        "FOR [-license] [-b] [-c] [-d] [-i <criteria>] [-p n] [-r] <var> in (<list>)\n"
+        "FOR [-license] [-b] [-c] [-d] [-g|-o] [-i <criteria>] [-n n] [-p n] [-r]\n"
+        "    <var> in (<list>)\n"
         "    do <cmd>\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Use cmd as a subshell rather than Yori\n"
         "   -d             Match directories rather than files\n"
+        "   -g             Capture output of each command and display it when complete\n"
         "   -i <criteria>  Only treat match files if they meet criteria, see below\n"
         "   -l             Use (start,step,end) notation for the list\n"
+        "   -n <n>         Supply up to <n> elements from the list to each command\n"
+        "   -o             Capture output of each command and display it in list order\n"
         "   -p <n>         Execute with <n> concurrent processes\n"
         "   -r             Look for matches in subdirectories under the current directory\n"
         "\n"
         " The -i option will match files only if they meet criteria.  This is a\n"
         " semicolon delimited list of entries matching the following form:\n"
         "\n"
-        "   [file attribute][operator][criteria]\n";
+        "   [file attribute][operator][criteria]\n"
+        "\n"
+        " When -n is used, an argument consisting only of <var> is expanded into one\n"
+        " argument per element.  Other uses of <var> are replaced with all elements\n"
+        " separated by spaces.\n";
 
 /**
  Display usage text to the user.
@@ -74,6 +82,54 @@ ForHelp()
     return TRUE;
 }
 
+/**
+ Specifies how output from concurrently executing child processes should be
+ handled.
+ */
+typedef enum _FOR_OUTPUT_MODE {
+    ForOutputDirect = 0,
+    ForOutputGrouped = 1,
+    ForOutputOrdered = 2
+} FOR_OUTPUT_MODE;
+
+/**
+ State about a single child process launched by this program.
+ */
+typedef struct _FOR_CHILD_PROCESS {
+
+    /**
+     The list of child processes which have been launched and whose output
+     has not yet been displayed, in the order they were launched.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A handle to the child process.  This is NULL once the process has
+     terminated.
+     */
+    HANDLE hProcess;
+
+    /**
+     A completion port to notify when the child process terminates.  If
+     NULL, the caller waits on process handles directly, which limits the
+     number of concurrent children to MAXIMUM_WAIT_OBJECTS.
+     */
+    HANDLE CompletionPort;
+
+    /**
+     A handle to a registered wait on the child process, used to post to
+     CompletionPort when the process terminates.
+     */
+    HANDLE WaitHandle;
+
+    /**
+     A handle to a temporary file containing the output of the child
+     process, or NULL if output is not being captured.
+     */
+    HANDLE OutputHandle;
+
+} FOR_CHILD_PROCESS, *PFOR_CHILD_PROCESS;
+
 /**
  State about the currently running processes as well as information required
  to launch any new processes from this program.
@@ -85,6 +141,11 @@ typedef struct _FOR_EXEC_CONTEXT {
      */
     BOOL InvokeCmd;
 
+    /**
+     Specifies how output from child processes should be displayed.
+     */
+    FOR_OUTPUT_MODE OutputMode;
+
     /**
      The string that might be found in ArgV which should be changed to contain
      the value of any match.
@@ -115,11 +176,59 @@ typedef struct _FOR_EXEC_CONTEXT {
     DWORD CurrentConcurrentCount;
 
     /**
-     An array of handles with CurrentConcurrentCount number of valid
-     elements.  These correspond to processes that are currently running.
+     The maximum number of matches to supply to a single command.
+     */
+    DWORD BatchSize;
+
+    /**
+     The number of matches currently held in BatchItems waiting for a
+     command to be launched.
+     */
+    DWORD BatchCount;
+
+    /**
+     An array of BatchSize elements containing matches which have not yet
+     been supplied to a command.
+     */
+    PYORI_STRING BatchItems;
+
+    /**
+     The list of child processes which have been launched and whose output
+     has not yet been displayed, in the order they were launched.
+     */
+    YORI_LIST_ENTRY ChildList;
+
+    /**
+     If the system supports it, a completion port that is notified when
+     any child process terminates.  If NULL, process handles are waited on
+     directly.
+     */
+    HANDLE CompletionPort;
+
+    /**
+     An array of handles used to wait for processes when a completion port
+     is not in use.  This has one element per concurrent process.
      */
     PHANDLE HandleArray;
 
+    /**
+     An array used to map an entry in HandleArray back to its child process
+     when a completion port is not in use.
+     */
+    PFOR_CHILD_PROCESS *ChildArray;
+
+    /**
+     The directory used to hold temporary files containing the output of
+     child processes.  Only meaningful if OutputMode is not ForOutputDirect.
+     */
+    YORI_STRING TempPath;
+
+    /**
+     A buffer used to copy output from temporary files to the output
+     device.
+     */
+    PUCHAR OutputBuffer;
+
     /**
      A list of criteria to filter matches against.
      */
@@ -127,6 +236,103 @@ typedef struct _FOR_EXEC_CONTEXT {
 
 } FOR_EXEC_CONTEXT, *PFOR_EXEC_CONTEXT;
 
+/**
+ The size of the buffer used to copy output from temporary files to the
+ output device.
+ */
+#define FOR_OUTPUT_BUFFER_SIZE (64 * 1024)
+
+/**
+ A callback invoked from the thread pool when a child process terminates.
+ This posts the child to the completion port so the main thread can
+ process it.
+
+ @param Context Pointer to the child process structure.
+
+ @param TimedOut Ignored, since the wait is infinite.
+ */
+VOID WINAPI
+ForChildProcessTerminated(
+    __in PVOID Context,
+    __in BOOLEAN TimedOut
+    )
+{
+    PFOR_CHILD_PROCESS ChildProcess;
+
+    UNREFERENCED_PARAMETER(TimedOut);
+
+    ChildProcess = (PFOR_CHILD_PROCESS)Context;
+    DllKernel32.pPostQueuedCompletionStatus(ChildProcess->CompletionPort, 0, (DWORD_PTR)ChildProcess, NULL);
+}
+
+/**
+ Write the captured output of a child process to standard output, so that
+ the output of each child is displayed contiguously.
+
+ @param ExecContext Pointer to the for exec context.
+
+ @param ChildProcess Pointer to the child process whose output should be
+        displayed.
+ */
+VOID
+ForDisplayChildOutput(
+    __in PFOR_EXEC_CONTEXT ExecContext,
+    __in PFOR_CHILD_PROCESS ChildProcess
+    )
+{
+    HANDLE hStdOut;
+    DWORD BytesRead;
+    DWORD BytesWritten;
+    DWORD CurrentOffset;
+
+    if (ChildProcess->OutputHandle == NULL) {
+        return;
+    }
+
+    hStdOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    SetFilePointer(ChildProcess->OutputHandle, 0, NULL, FILE_BEGIN);
+
+    while (ReadFile(ChildProcess->OutputHandle, ExecContext->OutputBuffer, FOR_OUTPUT_BUFFER_SIZE, &BytesRead, NULL) &&
+           BytesRead > 0) {
+
+        CurrentOffset = 0;
+        while (CurrentOffset < BytesRead) {
+            if (!WriteFile(hStdOut, ExecContext->OutputBuffer + CurrentOffset, BytesRead - CurrentOffset, &BytesWritten, NULL) ||
+                BytesWritten == 0) {
+
+                return;
+            }
+            CurrentOffset += BytesWritten;
+        }
+    }
+}
+
+/**
+ Free a child process structure, closing any handles it contains.  The
+ structure is expected to have been removed from the list of children.
+
+ @param ChildProcess Pointer to the child process to free.
+ */
+VOID
+ForFreeChildProcess(
+    __in PFOR_CHILD_PROCESS ChildProcess
+    )
+{
+    if (ChildProcess->WaitHandle != NULL) {
+        DllKernel32.pUnregisterWaitEx(ChildProcess->WaitHandle, INVALID_HANDLE_VALUE);
+        ChildProcess->WaitHandle = NULL;
+    }
+    if (ChildProcess->hProcess != NULL) {
+        CloseHandle(ChildProcess->hProcess);
+        ChildProcess->hProcess = NULL;
+    }
+    if (ChildProcess->OutputHandle != NULL) {
+        CloseHandle(ChildProcess->OutputHandle);
+        ChildProcess->OutputHandle = NULL;
+    }
+    YoriLibFree(ChildProcess);
+}
+
 /**
  Wait for any single process to complete.
 
@@ -138,64 +344,258 @@ ForWaitForProcessToComplete(
     __in PFOR_EXEC_CONTEXT ExecContext
     )
 {
+    PYORI_LIST_ENTRY ListEntry;
+    PFOR_CHILD_PROCESS ChildProcess;
     DWORD Result;
-    DWORD Index;
     DWORD Count;
+    DWORD BytesTransferred;
+    DWORD_PTR CompletionKey;
+    LPOVERLAPPED Overlapped;
 
-    Result = WaitForMultipleObjects(ExecContext->CurrentConcurrentCount, ExecContext->HandleArray, FALSE, INFINITE);
+    ASSERT(ExecContext->CurrentConcurrentCount > 0);
 
-    ASSERT(Result >= WAIT_OBJECT_0 && Result < (WAIT_OBJECT_0 + ExecContext->CurrentConcurrentCount));
+    if (ExecContext->CompletionPort != NULL) {
+        CompletionKey = 0;
+        Overlapped = NULL;
+        DllKernel32.pGetQueuedCompletionStatus(ExecContext->CompletionPort, &BytesTransferred, &CompletionKey, &Overlapped, INFINITE);
+        ChildProcess = (PFOR_CHILD_PROCESS)CompletionKey;
 
-    Index = Result - WAIT_OBJECT_0;
+        //
+        //  Every completion is posted with a child process as its key, and
+        //  the wait has no timeout, so returning without a key means the
+        //  port can't be waited on.  Rather than retry, wait for the oldest
+        //  running child to complete.
+        //
 
-    CloseHandle(ExecContext->HandleArray[Index]);
+        if (ChildProcess == NULL) {
+            ListEntry = YoriLibGetNextListEntry(&ExecContext->ChildList, NULL);
+            while (ListEntry != NULL) {
+                ChildProcess = CONTAINING_RECORD(ListEntry, FOR_CHILD_PROCESS, ListEntry);
+                if (ChildProcess->hProcess != NULL) {
+                    break;
+                }
+                ListEntry = YoriLibGetNextListEntry(&ExecContext->ChildList, ListEntry);
+            }
 
-    for (Count = Index; Count < ExecContext->CurrentConcurrentCount - 1; Count++) {
+            ASSERT(ListEntry != NULL);
+            WaitForSingleObject(ChildProcess->hProcess, INFINITE);
+        }
+    } else {
 
-#if defined(_MSC_VER) && (_MSC_VER >= 1700)
-        //
-        //  The "correct" annotation here would describe that HandleArray is
-        //  of TargetConcurrentCount elements, CurrentConcurrentCount of which
-        //  are readable, and CurrentConcurrentCount needs to be less than or
-        //  equal to TargetConcurrentCount.  This is something that I don't
-        //  see a way to express as of this writing.
-        //
-#pragma warning(suppress: 6001)
-#endif
-        ExecContext->HandleArray[Count] = ExecContext->HandleArray[Count + 1];
+        Count = 0;
+        ListEntry = YoriLibGetNextListEntry(&ExecContext->ChildList, NULL);
+        while (ListEntry != NULL) {
+            ChildProcess = CONTAINING_RECORD(ListEntry, FOR_CHILD_PROCESS, ListEntry);
+            if (ChildProcess->hProcess != NULL) {
+                ExecContext->HandleArray[Count] = ChildProcess->hProcess;
+                ExecContext->ChildArray[Count] = ChildProcess;
+                Count++;
+            }
+            ListEntry = YoriLibGetNextListEntry(&ExecContext->ChildList, ListEntry);
+        }
+
+        ASSERT(Count == ExecContext->CurrentConcurrentCount && Count <= MAXIMUM_WAIT_OBJECTS);
+
+        Result = WaitForMultipleObjects(Count, ExecContext->HandleArray, FALSE, INFINITE);
+
+        ASSERT(Result >= WAIT_OBJECT_0 && Result < (WAIT_OBJECT_0 + Count));
+
+        ChildProcess = ExecContext->ChildArray[Result - WAIT_OBJECT_0];
     }
 
+    if (ChildProcess->WaitHandle != NULL) {
+        DllKernel32.pUnregisterWaitEx(ChildProcess->WaitHandle, INVALID_HANDLE_VALUE);
+        ChildProcess->WaitHandle = NULL;
+    }
+
+    CloseHandle(ChildProcess->hProcess);
+    ChildProcess->hProcess = NULL;
     ExecContext->CurrentConcurrentCount--;
+
+    //
+    //  If output is displayed in order, display the output of every
+    //  process that has completed which was launched before any process
+    //  that is still running.  Otherwise, this process can be retired now.
+    //
+
+    if (ExecContext->OutputMode == ForOutputOrdered) {
+        ListEntry = YoriLibGetNextListEntry(&ExecContext->ChildList, NULL);
+        while (ListEntry != NULL) {
+            ChildProcess = CONTAINING_RECORD(ListEntry, FOR_CHILD_PROCESS, ListEntry);
+            if (ChildProcess->hProcess != NULL) {
+                break;
+            }
+            ForDisplayChildOutput(ExecContext, ChildProcess);
+            YoriLibRemoveListItem(&ChildProcess->ListEntry);
+            ForFreeChildProcess(ChildProcess);
+            ListEntry = YoriLibGetNextListEntry(&ExecContext->ChildList, NULL);
+        }
+    } else {
+        ForDisplayChildOutput(ExecContext, ChildProcess);
+        YoriLibRemoveListItem(&ChildProcess->ListEntry);
+        ForFreeChildProcess(ChildProcess);
+    }
 }
 
 /**
- Execute a new command in response to a newly matched element.
+ Create a temporary file to capture the output of a child process.  The file
+ is deleted when the handle is closed.
 
- @param Match The match that was found from the set.
+ @param ExecContext Pointer to the for exec context.
+
+ @param OutputHandle On successful completion, updated to contain a handle
+        to the temporary file, opened for read and write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ForCreateOutputFile(
+    __in PFOR_EXEC_CONTEXT ExecContext,
+    __out PHANDLE OutputHandle
+    )
+{
+    TCHAR TempFileName[MAX_PATH];
+    HANDLE Handle;
+
+    if (GetTempFileName(ExecContext->TempPath.StartOfString, _T("yfr"), 0, TempFileName) == 0) {
+        return FALSE;
+    }
+
+    Handle = CreateFile(TempFileName,
+                        GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                        NULL);
+
+    if (Handle == INVALID_HANDLE_VALUE) {
+        DeleteFile(TempFileName);
+        return FALSE;
+    }
+
+    *OutputHandle = Handle;
+    return TRUE;
+}
+
+/**
+ Generate a single argument from a template argument by replacing all
+ instances of the substitution variable with a value.
+
+ @param Template The template form of the argument.
+
+ @param Variable The variable to replace.
+
+ @param Value The value to replace the variable with.
+
+ @param NewArg On successful completion, updated to contain a newly
+        allocated argument.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+ForSubstituteArgument(
+    __in PYORI_STRING Template,
+    __in PYORI_STRING Variable,
+    __in PYORI_STRING Value,
+    __out PYORI_STRING NewArg
+    )
+{
+    DWORD FoundOffset;
+    DWORD SubstitutesFound;
+    DWORD ArgLengthNeeded;
+    YORI_STRING OldArg;
+    YORI_STRING NewArgWritePoint;
+
+    YoriLibInitEmptyString(&OldArg);
+    OldArg.StartOfString = Template->StartOfString;
+    OldArg.LengthInChars = Template->LengthInChars;
+    SubstitutesFound = 0;
+
+    while (YoriLibFindFirstMatchingSubstring(&OldArg, 1, Variable, &FoundOffset)) {
+        SubstitutesFound++;
+        OldArg.StartOfString += FoundOffset + 1;
+        OldArg.LengthInChars -= FoundOffset + 1;
+    }
+
+    ArgLengthNeeded = Template->LengthInChars + SubstitutesFound * Value->LengthInChars - SubstitutesFound * Variable->LengthInChars + 1;
+    if (!YoriLibAllocateString(NewArg, ArgLengthNeeded)) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&NewArgWritePoint);
+    NewArgWritePoint.StartOfString = NewArg->StartOfString;
+    NewArgWritePoint.LengthAllocated = NewArg->LengthAllocated;
+
+    YoriLibInitEmptyString(&OldArg);
+    OldArg.StartOfString = Template->StartOfString;
+    OldArg.LengthInChars = Template->LengthInChars;
+
+    while (TRUE) {
+        if (YoriLibFindFirstMatchingSubstring(&OldArg, 1, Variable, &FoundOffset)) {
+            memcpy(NewArgWritePoint.StartOfString, OldArg.StartOfString, FoundOffset * sizeof(TCHAR));
+            NewArgWritePoint.StartOfString += FoundOffset;
+            NewArgWritePoint.LengthAllocated -= FoundOffset;
+            memcpy(NewArgWritePoint.StartOfString, Value->StartOfString, Value->LengthInChars * sizeof(TCHAR));
+            NewArgWritePoint.StartOfString += Value->LengthInChars;
+            NewArgWritePoint.LengthAllocated -= Value->LengthInChars;
+
+            OldArg.StartOfString += FoundOffset + Variable->LengthInChars;
+            OldArg.LengthInChars -= FoundOffset + Variable->LengthInChars;
+        } else {
+            memcpy(NewArgWritePoint.StartOfString, OldArg.StartOfString, OldArg.LengthInChars * sizeof(TCHAR));
+            NewArgWritePoint.StartOfString += OldArg.LengthInChars;
+            NewArgWritePoint.LengthAllocated -= OldArg.LengthInChars;
+            NewArgWritePoint.StartOfString[0] = '\0';
+
+            NewArg->LengthInChars = (DWORD)(NewArgWritePoint.StartOfString - NewArg->StartOfString);
+            ASSERT(NewArg->LengthInChars < NewArg->LengthAllocated);
+            ASSERT(YoriLibIsStringNullTerminated(NewArg));
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Execute a new command for a set of matched elements.
+
+ @param Matches Pointer to an array of matches that were found from the set.
+
+ @param MatchCount The number of elements in the Matches array.
 
  @param ExecContext The current state of child processes and information about
         the arguments for any new child process.
  */
 VOID
-ForExecuteCommand(
-    __in PYORI_STRING Match,
+ForLaunchCommand(
+    __in PYORI_STRING Matches,
+    __in DWORD MatchCount,
     __in PFOR_EXEC_CONTEXT ExecContext
     )
 {
-    DWORD ArgsNeeded = ExecContext->ArgC;
+    DWORD ArgsNeeded;
     DWORD PrefixArgCount;
-    DWORD FoundOffset;
     DWORD Count;
-    DWORD SubstitutesFound;
+    DWORD MatchIndex;
+    DWORD ArgIndex;
     DWORD ArgLengthNeeded;
-    YORI_STRING OldArg;
-    YORI_STRING NewArgWritePoint;
     PYORI_STRING NewArgArray;
+    YORI_STRING JoinedMatch;
     YORI_STRING CmdLine;
     PROCESS_INFORMATION ProcessInfo;
     STARTUPINFO StartupInfo;
+    PFOR_CHILD_PROCESS ChildProcess;
+    HANDLE InheritableOutput;
+    BOOL Success;
 
     YoriLibInitEmptyString(&CmdLine);
+    YoriLibInitEmptyString(&JoinedMatch);
+    ChildProcess = NULL;
+    InheritableOutput = NULL;
 
 #ifdef YORI_BUILTIN
     if (!ExecContext->InvokeCmd &&
@@ -208,10 +608,46 @@ ForExecuteCommand(
     PrefixArgCount = 2;
 #endif
 
-    ArgsNeeded += PrefixArgCount;
+    //
+    //  When multiple matches are supplied to one command, an argument
+    //  consisting solely of the variable is expanded into one argument per
+    //  match.  Any other use of the variable is replaced with all of the
+    //  matches separated by spaces.
+    //
+
+    ArgsNeeded = ExecContext->ArgC + PrefixArgCount;
+    if (MatchCount > 1) {
+        for (Count = 0; Count < ExecContext->ArgC; Count++) {
+            if (YoriLibCompareString(&ExecContext->ArgV[Count], ExecContext->SubstituteVariable) == 0) {
+                ArgsNeeded += MatchCount - 1;
+            }
+        }
+
+        ArgLengthNeeded = 0;
+        for (MatchIndex = 0; MatchIndex < MatchCount; MatchIndex++) {
+            ArgLengthNeeded += Matches[MatchIndex].LengthInChars + 1;
+        }
+
+        if (!YoriLibAllocateString(&JoinedMatch, ArgLengthNeeded)) {
+            return;
+        }
+
+        for (MatchIndex = 0; MatchIndex < MatchCount; MatchIndex++) {
+            if (MatchIndex > 0) {
+                JoinedMatch.StartOfString[JoinedMatch.LengthInChars] = ' ';
+                JoinedMatch.LengthInChars++;
+            }
+            memcpy(&JoinedMatch.StartOfString[JoinedMatch.LengthInChars], Matches[MatchIndex].StartOfString, Matches[MatchIndex].LengthInChars * sizeof(TCHAR));
+            JoinedMatch.LengthInChars += Matches[MatchIndex].LengthInChars;
+        }
+        JoinedMatch.StartOfString[JoinedMatch.LengthInChars] = '\0';
+    } else {
+        YoriLibCloneString(&JoinedMatch, &Matches[0]);
+    }
 
     NewArgArray = YoriLibMalloc(ArgsNeeded * sizeof(YORI_STRING));
     if (NewArgArray == NULL) {
+        YoriLibFreeStringContents(&JoinedMatch);
         return;
     }
 
@@ -253,56 +689,25 @@ ForExecuteCommand(
         YoriLibConstantString(&NewArgArray[1], _T("/c"));
     }
 
+    ArgIndex = PrefixArgCount;
     for (Count = 0; Count < ExecContext->ArgC; Count++) {
-        YoriLibInitEmptyString(&OldArg);
-        OldArg.StartOfString = ExecContext->ArgV[Count].StartOfString;
-        OldArg.LengthInChars = ExecContext->ArgV[Count].LengthInChars;
-        SubstitutesFound = 0;
-
-        while (YoriLibFindFirstMatchingSubstring(&OldArg, 1, ExecContext->SubstituteVariable, &FoundOffset)) {
-            SubstitutesFound++;
-            OldArg.StartOfString += FoundOffset + 1;
-            OldArg.LengthInChars -= FoundOffset + 1;
-        }
-
-        ArgLengthNeeded = ExecContext->ArgV[Count].LengthInChars + SubstitutesFound * Match->LengthInChars - SubstitutesFound * ExecContext->SubstituteVariable->LengthInChars + 1;
-        if (!YoriLibAllocateString(&NewArgArray[Count + PrefixArgCount], ArgLengthNeeded)) {
-            goto Cleanup;
-        }
-
-        YoriLibInitEmptyString(&NewArgWritePoint);
-        NewArgWritePoint.StartOfString = NewArgArray[Count + PrefixArgCount].StartOfString;
-        NewArgWritePoint.LengthAllocated = NewArgArray[Count + PrefixArgCount].LengthAllocated;
-
-        YoriLibInitEmptyString(&OldArg);
-        OldArg.StartOfString = ExecContext->ArgV[Count].StartOfString;
-        OldArg.LengthInChars = ExecContext->ArgV[Count].LengthInChars;
-
-        while (TRUE) {
-            if (YoriLibFindFirstMatchingSubstring(&OldArg, 1, ExecContext->SubstituteVariable, &FoundOffset)) {
-                memcpy(NewArgWritePoint.StartOfString, OldArg.StartOfString, FoundOffset * sizeof(TCHAR));
-                NewArgWritePoint.StartOfString += FoundOffset;
-                NewArgWritePoint.LengthAllocated -= FoundOffset;
-                memcpy(NewArgWritePoint.StartOfString, Match->StartOfString, Match->LengthInChars * sizeof(TCHAR));
-                NewArgWritePoint.StartOfString += Match->LengthInChars;
-                NewArgWritePoint.LengthAllocated -= Match->LengthInChars;
+        if (MatchCount > 1 &&
+            YoriLibCompareString(&ExecContext->ArgV[Count], ExecContext->SubstituteVariable) == 0) {
 
-                OldArg.StartOfString += FoundOffset + ExecContext->SubstituteVariable->LengthInChars;
-                OldArg.LengthInChars -= FoundOffset + ExecContext->SubstituteVariable->LengthInChars;
-            } else {
-                memcpy(NewArgWritePoint.StartOfString, OldArg.StartOfString, OldArg.LengthInChars * sizeof(TCHAR));
-                NewArgWritePoint.StartOfString += OldArg.LengthInChars;
-                NewArgWritePoint.LengthAllocated -= OldArg.LengthInChars;
-                NewArgWritePoint.StartOfString[0] = '\0';
-
-                NewArgArray[Count + PrefixArgCount].LengthInChars = (DWORD)(NewArgWritePoint.StartOfString - NewArgArray[Count + PrefixArgCount].StartOfString);
-                ASSERT(NewArgArray[Count + PrefixArgCount].LengthInChars < NewArgArray[Count + PrefixArgCount].LengthAllocated);
-                ASSERT(YoriLibIsStringNullTerminated(&NewArgArray[Count + PrefixArgCount]));
-                break;
+            for (MatchIndex = 0; MatchIndex < MatchCount; MatchIndex++) {
+                YoriLibCloneString(&NewArgArray[ArgIndex], &Matches[MatchIndex]);
+                ArgIndex++;
             }
+        } else {
+            if (!ForSubstituteArgument(&ExecContext->ArgV[Count], ExecContext->SubstituteVariable, &JoinedMatch, &NewArgArray[ArgIndex])) {
+                goto Cleanup;
+            }
+            ArgIndex++;
         }
     }
 
+    ASSERT(ArgIndex == ArgsNeeded);
+
     if (!YoriLibBuildCmdlineFromArgcArgv(ArgsNeeded, NewArgArray, TRUE, &CmdLine)) {
         goto Cleanup;
     }
@@ -314,10 +719,48 @@ ForExecuteCommand(
     }
 #endif
 
+    ChildProcess = YoriLibMalloc(sizeof(FOR_CHILD_PROCESS));
+    if (ChildProcess == NULL) {
+        goto Cleanup;
+    }
+
+    ZeroMemory(ChildProcess, sizeof(FOR_CHILD_PROCESS));
+    ChildProcess->CompletionPort = ExecContext->CompletionPort;
+
     memset(&StartupInfo, 0, sizeof(StartupInfo));
     StartupInfo.cb = sizeof(StartupInfo);
 
-    if (!CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, 0, NULL, NULL, &StartupInfo, &ProcessInfo)) {
+    //
+    //  If output is being captured, send the child's output to a temporary
+    //  file.  The handle to the file is only made inheritable for the
+    //  duration of this launch, so that other children don't hold it open.
+    //
+
+    if (ExecContext->OutputMode != ForOutputDirect) {
+        if (!ForCreateOutputFile(ExecContext, &ChildProcess->OutputHandle)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("for: could not create temporary file\n"));
+            goto Cleanup;
+        }
+
+        if (!DuplicateHandle(GetCurrentProcess(), ChildProcess->OutputHandle, GetCurrentProcess(), &InheritableOutput, 0, TRUE, DUPLICATE_SAME_ACCESS)) {
+            InheritableOutput = NULL;
+            goto Cleanup;
+        }
+
+        StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+        StartupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        StartupInfo.hStdOutput = InheritableOutput;
+        StartupInfo.hStdError = InheritableOutput;
+    }
+
+    Success = CreateProcess(NULL, CmdLine.StartOfString, NULL, NULL, TRUE, 0, NULL, NULL, &StartupInfo, &ProcessInfo);
+
+    if (InheritableOutput != NULL) {
+        CloseHandle(InheritableOutput);
+        InheritableOutput = NULL;
+    }
+
+    if (!Success) {
         DWORD LastError = GetLastError();
         LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("for: execution failed: %s"), ErrText);
@@ -327,23 +770,119 @@ ForExecuteCommand(
 
     CloseHandle(ProcessInfo.hThread);
 
-    ExecContext->HandleArray[ExecContext->CurrentConcurrentCount] = ProcessInfo.hProcess;
+    ChildProcess->hProcess = ProcessInfo.hProcess;
+    YoriLibAppendList(&ExecContext->ChildList, &ChildProcess->ListEntry);
     ExecContext->CurrentConcurrentCount++;
 
+    //
+    //  If the system can monitor the process asynchronously, arrange for
+    //  the completion port to be notified when it terminates.  If not, wait
+    //  for it now, and the completion port will be notified below.
+    //
+
+    if (ChildProcess->CompletionPort != NULL) {
+        if (!DllKernel32.pRegisterWaitForSingleObject(&ChildProcess->WaitHandle,
+                                                      ChildProcess->hProcess,
+                                                      ForChildProcessTerminated,
+                                                      ChildProcess,
+                                                      INFINITE,
+                                                      WT_EXECUTEONLYONCE)) {
+
+            ChildProcess->WaitHandle = NULL;
+            WaitForSingleObject(ChildProcess->hProcess, INFINITE);
+            DllKernel32.pPostQueuedCompletionStatus(ChildProcess->CompletionPort, 0, (DWORD_PTR)ChildProcess, NULL);
+        }
+    }
+
+    ChildProcess = NULL;
+
     if (ExecContext->CurrentConcurrentCount == ExecContext->TargetConcurrentCount) {
         ForWaitForProcessToComplete(ExecContext);
     }
 
 Cleanup:
 
+    if (ChildProcess != NULL) {
+        ForFreeChildProcess(ChildProcess);
+    }
+
     for (Count = 0; Count < ArgsNeeded; Count++) {
         YoriLibFreeStringContents(&NewArgArray[Count]);
     }
 
+    YoriLibFreeStringContents(&JoinedMatch);
     YoriLibFreeStringContents(&CmdLine);
     YoriLibFree(NewArgArray);
 }
 
+/**
+ Launch a command for any matches that have been batched but not yet
+ supplied to a command.
+
+ @param ExecContext The current state of child processes and information about
+        the arguments for any new child process.
+ */
+VOID
+ForFlushBatch(
+    __in PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    DWORD Count;
+
+    if (ExecContext->BatchCount == 0) {
+        return;
+    }
+
+    ForLaunchCommand(ExecContext->BatchItems, ExecContext->BatchCount, ExecContext);
+
+    for (Count = 0; Count < ExecContext->BatchCount; Count++) {
+        YoriLibFreeStringContents(&ExecContext->BatchItems[Count]);
+    }
+    ExecContext->BatchCount = 0;
+}
+
+/**
+ Execute a new command in response to a newly matched element.  If matches
+ are being batched, the match is retained until enough matches have been
+ found to launch a command.
+
+ @param Match The match that was found from the set.
+
+ @param ExecContext The current state of child processes and information about
+        the arguments for any new child process.
+ */
+VOID
+ForExecuteCommand(
+    __in PYORI_STRING Match,
+    __in PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    PYORI_STRING BatchItem;
+
+    if (ExecContext->BatchSize <= 1) {
+        ForLaunchCommand(Match, 1, ExecContext);
+        return;
+    }
+
+    //
+    //  The match may be a buffer that the caller is about to reuse, so
+    //  take a copy of it.
+    //
+
+    BatchItem = &ExecContext->BatchItems[ExecContext->BatchCount];
+    if (!YoriLibAllocateString(BatchItem, Match->LengthInChars + 1)) {
+        return;
+    }
+    memcpy(BatchItem->StartOfString, Match->StartOfString, Match->LengthInChars * sizeof(TCHAR));
+    BatchItem->StartOfString[Match->LengthInChars] = '\0';
+    BatchItem->LengthInChars = Match->LengthInChars;
+    ExecContext->BatchCount++;
+
+    if (ExecContext->BatchCount == ExecContext->BatchSize) {
+        ForFlushBatch(ExecContext);
+    }
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -384,6 +923,45 @@ ForFileFoundCallback(
     return TRUE;
 }
 
+/**
+ Free any resources allocated within the for exec context.  This is only
+ called once all child processes have completed.
+
+ @param ExecContext Pointer to the for exec context.
+ */
+VOID
+ForFreeExecContext(
+    __in PFOR_EXEC_CONTEXT ExecContext
+    )
+{
+    DWORD Count;
+
+    for (Count = 0; Count < ExecContext->BatchCount; Count++) {
+        YoriLibFreeStringContents(&ExecContext->BatchItems[Count]);
+    }
+    ExecContext->BatchCount = 0;
+
+    if (ExecContext->BatchItems != NULL) {
+        YoriLibFree(ExecContext->BatchItems);
+        ExecContext->BatchItems = NULL;
+    }
+    if (ExecContext->HandleArray != NULL) {
+        YoriLibFree(ExecContext->HandleArray);
+        ExecContext->HandleArray = NULL;
+        ExecContext->ChildArray = NULL;
+    }
+    if (ExecContext->OutputBuffer != NULL) {
+        YoriLibFree(ExecContext->OutputBuffer);
+        ExecContext->OutputBuffer = NULL;
+    }
+    if (ExecContext->CompletionPort != NULL) {
+        CloseHandle(ExecContext->CompletionPort);
+        ExecContext->CompletionPort = NULL;
+    }
+    YoriLibFreeStringContents(&ExecContext->TempPath);
+    YoriLibFileFiltFreeFilter(&ExecContext->Filter);
+}
+
 #ifdef YORI_BUILTIN
 /**
  The main entrypoint for the for builtin command.
@@ -433,6 +1011,8 @@ ENTRYPOINT(
 
     ExecContext.TargetConcurrentCount = 1;
     ExecContext.CurrentConcurrentCount = 0;
+    ExecContext.BatchSize = 1;
+    YoriLibInitializeListHead(&ExecContext.ChildList);
     MatchDirectories = FALSE;
     Recurse = FALSE;
     StepMode = FALSE;
@@ -460,6 +1040,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("d")) == 0) {
                 MatchDirectories = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("g")) == 0) {
+                ExecContext.OutputMode = ForOutputGrouped;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("i")) == 0) {
                 if (i + 1 < ArgC) {
                     YORI_STRING ErrorSubstring;
@@ -479,6 +1062,21 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 StepMode = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("n")) == 0) {
+                if (i + 1 < ArgC) {
+                    LONGLONG LlBatchSize = 0;
+                    DWORD CharsConsumed = 0;
+                    YoriLibStringToNumber(&ArgV[i + 1], TRUE, &LlBatchSize, &CharsConsumed);
+                    ExecContext.BatchSize = (DWORD)LlBatchSize;
+                    ArgumentUnderstood = TRUE;
+                    if (ExecContext.BatchSize < 1) {
+                        ExecContext.BatchSize = 1;
+                    }
+                    i++;
+                }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("o")) == 0) {
+                ExecContext.OutputMode = ForOutputOrdered;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("p")) == 0) {
                 if (i + 1 < ArgC) {
                     LONGLONG LlNumberProcesses = 0;
@@ -575,9 +1173,58 @@ ENTRYPOINT(
 
     ExecContext.ArgC = ArgC - CmdArg;
     ExecContext.ArgV = &ArgV[CmdArg];
-    ExecContext.HandleArray = YoriLibMalloc(ExecContext.TargetConcurrentCount * sizeof(HANDLE));
-    if (ExecContext.HandleArray == NULL) {
-        goto cleanup_and_exit;
+
+    //
+    //  If the system supports it, use a completion port to find out when
+    //  children terminate, which has no limit on the number of children.
+    //  Otherwise, fall back to waiting on the handles directly.
+    //
+
+    if (DllKernel32.pCreateIoCompletionPort != NULL &&
+        DllKernel32.pGetQueuedCompletionStatus != NULL &&
+        DllKernel32.pPostQueuedCompletionStatus != NULL &&
+        DllKernel32.pRegisterWaitForSingleObject != NULL &&
+        DllKernel32.pUnregisterWaitEx != NULL) {
+
+        ExecContext.CompletionPort = DllKernel32.pCreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    }
+
+    if (ExecContext.CompletionPort == NULL) {
+        if (ExecContext.TargetConcurrentCount > MAXIMUM_WAIT_OBJECTS) {
+            ExecContext.TargetConcurrentCount = MAXIMUM_WAIT_OBJECTS;
+        }
+
+        ExecContext.HandleArray = YoriLibMalloc(ExecContext.TargetConcurrentCount * (sizeof(HANDLE) + sizeof(PFOR_CHILD_PROCESS)));
+        if (ExecContext.HandleArray == NULL) {
+            goto cleanup_and_exit;
+        }
+        ExecContext.ChildArray = (PFOR_CHILD_PROCESS *)(ExecContext.HandleArray + ExecContext.TargetConcurrentCount);
+    }
+
+    if (ExecContext.BatchSize > 1) {
+        ExecContext.BatchItems = YoriLibMalloc(ExecContext.BatchSize * sizeof(YORI_STRING));
+        if (ExecContext.BatchItems == NULL) {
+            goto cleanup_and_exit;
+        }
+    }
+
+    if (ExecContext.OutputMode != ForOutputDirect) {
+        ExecContext.TempPath.LengthAllocated = GetTempPath(0, NULL);
+        if (!YoriLibAllocateString(&ExecContext.TempPath, ExecContext.TempPath.LengthAllocated)) {
+            goto cleanup_and_exit;
+        }
+        ExecContext.TempPath.LengthInChars = GetTempPath(ExecContext.TempPath.LengthAllocated, ExecContext.TempPath.StartOfString);
+        if (ExecContext.TempPath.LengthInChars == 0 ||
+            ExecContext.TempPath.LengthInChars >= ExecContext.TempPath.LengthAllocated) {
+
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("for: could not find temporary directory\n"));
+            goto cleanup_and_exit;
+        }
+
+        ExecContext.OutputBuffer = YoriLibMalloc(FOR_OUTPUT_BUFFER_SIZE);
+        if (ExecContext.OutputBuffer == NULL) {
+            goto cleanup_and_exit;
+        }
     }
 
     MatchFlags = 0;
@@ -771,18 +1418,25 @@ ENTRYPOINT(
         }
     }
 
+    ForFlushBatch(&ExecContext);
+
     while (ExecContext.CurrentConcurrentCount > 0) {
         ForWaitForProcessToComplete(&ExecContext);
     }
 
-    YoriLibFileFiltFreeFilter(&ExecContext.Filter);
-    YoriLibFree(ExecContext.HandleArray);
+    ASSERT(YoriLibIsListEmpty(&ExecContext.ChildList));
+
+    ForFreeExecContext(&ExecContext);
 
     return EXIT_SUCCESS;
 
 cleanup_and_exit:
 
-    YoriLibFileFiltFreeFilter(&ExecContext.Filter);
+    while (ExecContext.CurrentConcurrentCount > 0) {
+        ForWaitForProcessToComplete(&ExecContext);
+    }
+
+    ForFreeExecContext(&ExecContext);
 
     return EXIT_FAILURE;
 }
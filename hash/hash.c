@@ -45,11 +45,13 @@ CHAR strHashHelpText[] =
         "\n"
         "Hash a file.\n"
         "\n"
-        "HASH [-license] [-a <algorithm>] [-b] [-s] [<file>]\n"
+        "HASH [-license] [-a <algorithm>[,<algorithm>...]] [-b] [-j <n>] [-s] [<file>]\n"
         "\n"
         "   -a <algorithm> Specify the hash algorithm. Supported algorithms:\n"
         "                    MD4, MD5, SHA1, SHA256, SHA384, or SHA512\n"
+        "                  Multiple algorithms are calculated in one pass\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -j <n>         Hash up to <n> files concurrently\n"
         "   -s             Hash files in subdirectories\n";
 
 /**
@@ -66,144 +68,893 @@ HashHelp()
     return TRUE;
 }
 
+/**
+ The names of hash algorithms that can be requested, which are also the names
+ that BCrypt uses to describe them.
+ */
+LPCTSTR HashSupportedAlgorithms[] = {
+    _T("MD4"),
+    _T("MD5"),
+    _T("SHA1"),
+    _T("SHA256"),
+    _T("SHA384"),
+    _T("SHA512")
+};
+
+/**
+ The maximum number of algorithms that can be calculated at once.  Since each
+ algorithm can only be requested once, this is the number of supported
+ algorithms.
+ */
+#define HASH_MAX_ALGORITHMS (sizeof(HashSupportedAlgorithms)/sizeof(HashSupportedAlgorithms[0]))
+
+/**
+ The maximum number of threads to hash files with.
+ */
+#define HASH_MAX_WORKERS (64)
+
+/**
+ A hash algorithm that has been requested by the user.
+ */
+typedef struct _HASH_ALGORITHM {
+
+    /**
+     The BCrypt name of the algorithm.
+     */
+    LPCTSTR Name;
+
+    /**
+     BCrypt handle to the algorithm provider.  If NULL, the algorithm provider
+     has not been initialized.  This handle is shared by all threads, each of
+     which creates its own hash objects from it.
+     */
+    PVOID Algorithm;
+
+    /**
+     Specifies the number of bytes in the hash produced by the algorithm.
+     */
+    DWORD HashLength;
+
+    /**
+     Specifies the number of bytes of scratch space BCrypt needs for each
+     hash object.
+     */
+    DWORD ScratchBufferLength;
+} HASH_ALGORITHM, *PHASH_ALGORITHM;
+
+/**
+ The state used by a single thread to hash files.  When files are hashed
+ serially there is one of these, used by the main thread; when files are
+ hashed concurrently, there is one for each worker thread.
+ */
+typedef struct _HASH_WORKER {
+
+    /**
+     A BCrypt hash object for each algorithm.  These are only valid while a
+     stream is being hashed.
+     */
+    PVOID Hash[HASH_MAX_ALGORITHMS];
+
+    /**
+     Pointer to an opaque blob of memory for each algorithm which is used by
+     BCrypt to generate the hash.
+     */
+    PVOID ScratchBuffer[HASH_MAX_ALGORITHMS];
+
+    /**
+     Pointer to a blob of memory large enough to contain the result of any
+     of the algorithms.
+     */
+    PUCHAR HashBuffer;
+
+    /**
+     Pointers to buffers to read data from the file into.  When reading
+     asynchronously, one buffer is being filled while the other is being
+     hashed.
+     */
+    PVOID ReadBuffer[2];
+
+    /**
+     Specifies the number of bytes in each ReadBuffer.
+     */
+    DWORD ReadBufferLength;
+
+    /**
+     An event used to wait for asynchronous reads.  This is NULL for the
+     serial worker, which reads synchronously.
+     */
+    HANDLE ReadEvent;
+
+    /**
+     Handle to the thread running this worker, or NULL for the serial
+     worker.
+     */
+    HANDLE Thread;
+
+    /**
+     Pointer to the context describing the files and algorithms, used by
+     worker threads to find queued jobs.
+     */
+    struct _HASH_CONTEXT *HashContext;
+
+} HASH_WORKER, *PHASH_WORKER;
+
+/**
+ A single file which has been queued to be hashed by a worker thread.
+ */
+typedef struct _HASH_JOB {
+
+    /**
+     The list of jobs in the order they were found.  Results are displayed
+     in this order, regardless of the order in which they complete.
+     */
+    YORI_LIST_ENTRY OrderedList;
+
+    /**
+     The list of jobs which have not yet been picked up by a worker thread.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     A handle to the file, opened for asynchronous reads.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The name of the file to display along with the result.
+     */
+    YORI_STRING RelativePath;
+
+    /**
+     On completion, the hash of the file.
+     */
+    YORI_STRING HashString;
+
+    /**
+     Set to TRUE by the worker thread when the job has been processed.
+     */
+    BOOLEAN Complete;
+
+    /**
+     Set to TRUE by the worker thread if HashString contains a valid hash.
+     */
+    BOOLEAN Succeeded;
+
+} HASH_JOB, *PHASH_JOB;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
-typedef struct _HASH_CONTEXT {
+typedef struct _HASH_CONTEXT {
+
+    /**
+     TRUE if file enumeration is being performed recursively; FALSE if it is
+     in one directory only.
+     */
+    BOOLEAN Recursive;
+
+    /**
+     The first error encountered when enumerating objects from a single arg.
+     This is used to preserve file not found/path not found errors so that
+     when the program falls back to interpreting the argument as a literal,
+     if that still doesn't work, this is the error code that is displayed.
+     */
+    DWORD SavedErrorThisArg;
+
+    /**
+     The number of algorithms to calculate for each file.
+     */
+    DWORD AlgorithmCount;
+
+    /**
+     The algorithms to calculate for each file, in the order that their
+     results are displayed.
+     */
+    HASH_ALGORITHM Algorithms[HASH_MAX_ALGORITHMS];
+
+    /**
+     The largest number of bytes in the hash produced by any of the
+     algorithms.
+     */
+    DWORD MaximumHashLength;
+
+    /**
+     The number of characters needed to display the result of all of the
+     algorithms, not including a NULL terminator.
+     */
+    DWORD HashStringLength;
+
+    /**
+     A string which contains enough characters to contain the hex
+     representation of all of the algorithms plus a NULL terminator.
+     */
+    YORI_STRING HashString;
+
+    /**
+     The state used to hash files on the main thread.
+     */
+    HASH_WORKER SerialWorker;
+
+    /**
+     The number of threads to hash files with.  If zero, files are hashed
+     serially on the main thread.
+     */
+    DWORD WorkerCount;
+
+    /**
+     The number of entries in Workers which have been initialized.
+     */
+    DWORD WorkersAllocated;
+
+    /**
+     An array of WorkerCount worker states.
+     */
+    PHASH_WORKER Workers;
+
+    /**
+     A mutex protecting the job lists and the Complete member of each job.
+     */
+    HANDLE Mutex;
+
+    /**
+     A semaphore which is released once for each job added to PendingList.
+     */
+    HANDLE WorkAvailable;
+
+    /**
+     An event which is set to indicate that worker threads should terminate.
+     */
+    HANDLE WorkerShutdownEvent;
+
+    /**
+     An event which is set by a worker thread each time it completes a job.
+     */
+    HANDLE CompletionEvent;
+
+    /**
+     The list of jobs which have not been displayed, in the order they were
+     found.
+     */
+    YORI_LIST_ENTRY OrderedList;
+
+    /**
+     The list of jobs which have not been picked up by a worker thread.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     The number of jobs in OrderedList.
+     */
+    DWORD JobsOutstanding;
+
+    /**
+     Records the total number of files processed.
+     */
+    LONGLONG FilesFound;
+
+    /**
+     Records the total number of files processed within a single command line
+     argument.
+     */
+    LONGLONG FilesFoundThisArg;
+
+} HASH_CONTEXT, *PHASH_CONTEXT;
+
+/**
+ Create a hash object for each requested algorithm in preparation for
+ hashing a stream.
+
+ @param HashContext Pointer to the context describing the algorithms.
+
+ @param Worker Pointer to the worker state to create hash objects within.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashBeginStream(
+    __in PHASH_CONTEXT HashContext,
+    __in PHASH_WORKER Worker
+    )
+{
+    DWORD Index;
+    LONG Status;
+
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        Status = DllBCrypt.pBCryptCreateHash(HashContext->Algorithms[Index].Algorithm, &Worker->Hash[Index], Worker->ScratchBuffer[Index], HashContext->Algorithms[Index].ScratchBufferLength, NULL, 0, 0);
+        if (Status != STATUS_SUCCESS) {
+            while (Index > 0) {
+                Index--;
+                DllBCrypt.pBCryptDestroyHash(Worker->Hash[Index]);
+                Worker->Hash[Index] = NULL;
+            }
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Add a block of data to the hash of each requested algorithm.
+
+ @param HashContext Pointer to the context describing the algorithms.
+
+ @param Worker Pointer to the worker state containing hash objects.
+
+ @param Buffer Pointer to the data to hash.
+
+ @param BufferLength The number of bytes in Buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashStreamData(
+    __in PHASH_CONTEXT HashContext,
+    __in PHASH_WORKER Worker,
+    __in PVOID Buffer,
+    __in DWORD BufferLength
+    )
+{
+    DWORD Index;
+    LONG Status;
+
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        Status = DllBCrypt.pBCryptHashData(Worker->Hash[Index], Buffer, BufferLength, 0);
+        if (Status != STATUS_SUCCESS) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Complete hashing a stream, generate the displayable form of each hash, and
+ destroy the hash objects.
+
+ @param HashContext Pointer to the context describing the algorithms.
+
+ @param Worker Pointer to the worker state containing hash objects.
+
+ @param Succeeded TRUE if all of the data in the stream was hashed and the
+        result should be generated, FALSE if the hash objects should be
+        destroyed only.
+
+ @param HashString On successful completion, updated to contain the hex form
+        of the result of each algorithm, separated by spaces.  This string
+        must be able to hold HashStringLength characters plus a NULL.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashEndStream(
+    __in PHASH_CONTEXT HashContext,
+    __in PHASH_WORKER Worker,
+    __in BOOL Succeeded,
+    __inout PYORI_STRING HashString
+    )
+{
+    DWORD Index;
+    LONG Status;
+    YORI_STRING Substring;
+
+    HashString->LengthInChars = 0;
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (Succeeded) {
+            Status = DllBCrypt.pBCryptFinishHash(Worker->Hash[Index], Worker->HashBuffer, HashContext->Algorithms[Index].HashLength, 0);
+            if (Status != STATUS_SUCCESS) {
+                Succeeded = FALSE;
+            }
+        }
+
+        if (Succeeded) {
+            if (Index > 0) {
+                HashString->StartOfString[HashString->LengthInChars] = ' ';
+                HashString->LengthInChars++;
+            }
+
+            YoriLibInitEmptyString(&Substring);
+            Substring.StartOfString = &HashString->StartOfString[HashString->LengthInChars];
+            Substring.LengthAllocated = HashString->LengthAllocated - HashString->LengthInChars;
+            if (YoriLibHexBufferToString(Worker->HashBuffer, HashContext->Algorithms[Index].HashLength, &Substring)) {
+                HashString->LengthInChars = HashString->LengthInChars + Substring.LengthInChars;
+            } else {
+                Succeeded = FALSE;
+            }
+        }
+
+        DllBCrypt.pBCryptDestroyHash(Worker->Hash[Index]);
+        Worker->Hash[Index] = NULL;
+    }
+
+    return Succeeded;
+}
+
+/**
+ Hash a single incoming stream.
+
+ @param hSource A handle to the incoming stream, which may be a file or a
+        pipe.
+
+ @param HashContext Pointer to a context describing the actions to perform.
+
+ @param Worker Pointer to the state to use to hash the stream.
+
+ @param HashString On successful completion, updated to contain the hash of
+        the stream.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashProcessStream(
+    __in HANDLE hSource,
+    __in PHASH_CONTEXT HashContext,
+    __in PHASH_WORKER Worker,
+    __inout PYORI_STRING HashString
+    )
+{
+    BOOL Succeeded;
+    DWORD BytesRead;
+    YORI_LIB_MAPPED_INPUT MappedInput;
+    PVOID MappedBuffer;
+
+    if (!HashBeginStream(HashContext, Worker)) {
+        return FALSE;
+    }
+
+    Succeeded = TRUE;
+
+    //
+    //  If the source is a file, hash it directly from a mapped view to
+    //  avoid copying it through the read buffer.  Pipes and devices are
+    //  read with ReadFile.
+    //
+
+    if (YoriLibMappedInputOpen(hSource, &MappedInput)) {
+        while (YoriLibMappedInputGetNext(&MappedInput, (DWORD)-1, &MappedBuffer, &BytesRead)) {
+            if (!HashStreamData(HashContext, Worker, MappedBuffer, BytesRead)) {
+                Succeeded = FALSE;
+                break;
+            }
+        }
+
+        if (MappedInput.Failed) {
+            Succeeded = FALSE;
+        }
+        YoriLibMappedInputClose(&MappedInput);
+    }
+
+    while (Succeeded) {
+        if (!ReadFile(hSource, Worker->ReadBuffer[0], Worker->ReadBufferLength, &BytesRead, NULL)) {
+            break;
+        }
+
+        if (BytesRead == 0) {
+            break;
+        }
+
+        if (!HashStreamData(HashContext, Worker, Worker->ReadBuffer[0], BytesRead)) {
+            Succeeded = FALSE;
+        }
+    }
+
+    return HashEndStream(HashContext, Worker, Succeeded, HashString);
+}
+
+/**
+ Issue an asynchronous read from a file.
+
+ @param hSource A handle to the file, opened for asynchronous IO.
+
+ @param Overlapped Pointer to the overlapped structure describing the read.
+        The event in this structure is used to indicate completion.
+
+ @param Buffer Pointer to the buffer to read into.
+
+ @param BufferLength The number of bytes to read.
+
+ @param Offset The offset within the file to read from.
+
+ @return TRUE to indicate the read was issued and its result can be obtained
+         with GetOverlappedResult, FALSE to indicate the read failed.  If
+         the read failed because the offset is at the end of the file, the
+         last error is ERROR_HANDLE_EOF.
+ */
+BOOL
+HashIssueRead(
+    __in HANDLE hSource,
+    __in LPOVERLAPPED Overlapped,
+    __out_bcount(BufferLength) PVOID Buffer,
+    __in DWORD BufferLength,
+    __in LARGE_INTEGER Offset
+    )
+{
+    Overlapped->Offset = Offset.LowPart;
+    Overlapped->OffsetHigh = Offset.HighPart;
+    if (!ReadFile(hSource, Buffer, BufferLength, NULL, Overlapped)) {
+        if (GetLastError() != ERROR_IO_PENDING) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Hash a single file using asynchronous reads, so that the next block of the
+ file is being read while the current one is being hashed.
+
+ @param hSource A handle to the file, opened for asynchronous IO.
+
+ @param HashContext Pointer to a context describing the actions to perform.
+
+ @param Worker Pointer to the state to use to hash the stream.
+
+ @param HashString On successful completion, updated to contain the hash of
+        the stream.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HashProcessOverlappedFile(
+    __in HANDLE hSource,
+    __in PHASH_CONTEXT HashContext,
+    __in PHASH_WORKER Worker,
+    __inout PYORI_STRING HashString
+    )
+{
+    OVERLAPPED Overlapped;
+    LARGE_INTEGER Offset;
+    DWORD BytesRead;
+    DWORD CurrentBuffer;
+    BOOL Succeeded;
+    BOOL ReadPending;
+
+    if (!HashBeginStream(HashContext, Worker)) {
+        return FALSE;
+    }
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = Worker->ReadEvent;
+    Offset.QuadPart = 0;
+    CurrentBuffer = 0;
+    Succeeded = TRUE;
+
+    ReadPending = HashIssueRead(hSource, &Overlapped, Worker->ReadBuffer[CurrentBuffer], Worker->ReadBufferLength, Offset);
+    if (!ReadPending && GetLastError() != ERROR_HANDLE_EOF) {
+        Succeeded = FALSE;
+    }
+
+    while (ReadPending) {
+        if (!GetOverlappedResult(hSource, &Overlapped, &BytesRead, TRUE)) {
+            if (GetLastError() != ERROR_HANDLE_EOF) {
+                Succeeded = FALSE;
+            }
+            break;
+        }
+
+        if (BytesRead == 0) {
+            break;
+        }
+
+        //
+        //  Start reading the next block into the other buffer before
+        //  hashing this one.
+        //
+
+        Offset.QuadPart = Offset.QuadPart + BytesRead;
+        ReadPending = HashIssueRead(hSource, &Overlapped, Worker->ReadBuffer[1 - CurrentBuffer], Worker->ReadBufferLength, Offset);
+        if (!ReadPending && GetLastError() != ERROR_HANDLE_EOF) {
+            Succeeded = FALSE;
+        }
+
+        if (!HashStreamData(HashContext, Worker, Worker->ReadBuffer[CurrentBuffer], BytesRead)) {
+            if (ReadPending) {
+                GetOverlappedResult(hSource, &Overlapped, &BytesRead, TRUE);
+            }
+            Succeeded = FALSE;
+            break;
+        }
+
+        CurrentBuffer = 1 - CurrentBuffer;
+    }
+
+    return HashEndStream(HashContext, Worker, Succeeded, HashString);
+}
+
+/**
+ Allocate the buffers needed by a worker to hash files.
+
+ @param HashContext Pointer to the context describing the algorithms.
+
+ @param Worker Pointer to the worker state to initialize.
+
+ @param Overlapped TRUE if the worker will hash files with asynchronous
+        reads, which requires a second read buffer and an event.
+
+ @return TRUE to indicate success, FALSE to indicate failure.  On failure,
+         the caller should call @ref HashCleanupWorker .
+ */
+BOOL
+HashInitializeWorker(
+    __in PHASH_CONTEXT HashContext,
+    __out PHASH_WORKER Worker,
+    __in BOOL Overlapped
+    )
+{
+    DWORD Index;
+
+    ZeroMemory(Worker, sizeof(HASH_WORKER));
+
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        Worker->ScratchBuffer[Index] = YoriLibMalloc(HashContext->Algorithms[Index].ScratchBufferLength);
+        if (Worker->ScratchBuffer[Index] == NULL) {
+            return FALSE;
+        }
+    }
+
+    Worker->HashBuffer = YoriLibMalloc(HashContext->MaximumHashLength);
+    if (Worker->HashBuffer == NULL) {
+        return FALSE;
+    }
+
+    Worker->ReadBufferLength = 1024 * 1024;
+
+    Worker->ReadBuffer[0] = YoriLibMalloc(Worker->ReadBufferLength);
+    if (Worker->ReadBuffer[0] == NULL) {
+        return FALSE;
+    }
+
+    if (Overlapped) {
+        Worker->ReadBuffer[1] = YoriLibMalloc(Worker->ReadBufferLength);
+        if (Worker->ReadBuffer[1] == NULL) {
+            return FALSE;
+        }
+
+        Worker->ReadEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (Worker->ReadEvent == NULL) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Free the buffers used by a worker to hash files.  The worker structure
+ itself is not freed.
+
+ @param Worker Pointer to the worker state to clean up.
+ */
+VOID
+HashCleanupWorker(
+    __in PHASH_WORKER Worker
+    )
+{
+    DWORD Index;
 
-    /**
-     TRUE if file enumeration is being performed recursively; FALSE if it is
-     in one directory only.
-     */
-    BOOLEAN Recursive;
+    for (Index = 0; Index < HASH_MAX_ALGORITHMS; Index++) {
+        if (Worker->ScratchBuffer[Index] != NULL) {
+            YoriLibFree(Worker->ScratchBuffer[Index]);
+            Worker->ScratchBuffer[Index] = NULL;
+        }
+    }
 
-    /**
-     BCrypt handle to the algorithm provider.  If NULL, the algorithm provider
-     has not been initialized.
-     */
-    PVOID Algorithm;
+    if (Worker->HashBuffer != NULL) {
+        YoriLibFree(Worker->HashBuffer);
+        Worker->HashBuffer = NULL;
+    }
 
-    /**
-     Pointer to an opaque blob of memory which is used by BCrypt to generate
-     the hash.
-     */
-    PVOID ScratchBuffer;
+    for (Index = 0; Index < sizeof(Worker->ReadBuffer)/sizeof(Worker->ReadBuffer[0]); Index++) {
+        if (Worker->ReadBuffer[Index] != NULL) {
+            YoriLibFree(Worker->ReadBuffer[Index]);
+            Worker->ReadBuffer[Index] = NULL;
+        }
+    }
 
-    /**
-     The first error encountered when enumerating objects from a single arg.
-     This is used to preserve file not found/path not found errors so that
-     when the program falls back to interpreting the argument as a literal,
-     if that still doesn't work, this is the error code that is displayed.
-     */
-    DWORD SavedErrorThisArg;
+    if (Worker->ReadEvent != NULL) {
+        CloseHandle(Worker->ReadEvent);
+        Worker->ReadEvent = NULL;
+    }
+}
 
-    /**
-     Specifies the number of bytes in ScratchBuffer.
-     */
-    DWORD ScratchBufferLength;
+/**
+ Allocate a job to hash a file on a worker thread.
 
-    /**
-     Pointer to a blob of memory containing the result of the hash calculation
-     for each file.
-     */
-    PUCHAR HashBuffer;
+ @param HashContext Pointer to the context describing the algorithms.
 
-    /**
-     Specifies the number of bytes in HashBuffer.
-     */
-    DWORD HashLength;
+ @param FileHandle Handle to the file to hash, opened for asynchronous IO.
+        On success, the job takes ownership of this handle.
 
-    /**
-     Pointer to a buffer to read data from the file into.
-     */
-    PVOID ReadBuffer;
+ @param RelativePath Pointer to the name to display along with the result.
 
-    /**
-     Specifies the number of bytes in ReadBuffer.
-     */
-    DWORD ReadBufferLength;
+ @return Pointer to the job, or NULL on allocation failure.
+ */
+PHASH_JOB
+HashAllocateJob(
+    __in PHASH_CONTEXT HashContext,
+    __in HANDLE FileHandle,
+    __in PYORI_STRING RelativePath
+    )
+{
+    PHASH_JOB Job;
 
-    /**
-     A string which contains enough characters to contain the hex
-     representation of HashBuffer plus a NULL terminator.
-     */
-    YORI_STRING HashString;
+    Job = YoriLibMalloc(sizeof(HASH_JOB) + (RelativePath->LengthInChars + HashContext->HashStringLength + 1) * sizeof(TCHAR));
+    if (Job == NULL) {
+        return NULL;
+    }
 
-    /**
-     Records the total number of files processed.
-     */
-    LONGLONG FilesFound;
+    ZeroMemory(Job, sizeof(HASH_JOB));
+    Job->FileHandle = FileHandle;
 
-    /**
-     Records the total number of files processed within a single command line
-     argument.
-     */
-    LONGLONG FilesFoundThisArg;
+    YoriLibInitEmptyString(&Job->RelativePath);
+    Job->RelativePath.StartOfString = (LPTSTR)(Job + 1);
+    Job->RelativePath.LengthInChars = RelativePath->LengthInChars;
+    Job->RelativePath.LengthAllocated = RelativePath->LengthInChars;
+    memcpy(Job->RelativePath.StartOfString, RelativePath->StartOfString, RelativePath->LengthInChars * sizeof(TCHAR));
 
-} HASH_CONTEXT, *PHASH_CONTEXT;
+    YoriLibInitEmptyString(&Job->HashString);
+    Job->HashString.StartOfString = Job->RelativePath.StartOfString + Job->RelativePath.LengthAllocated;
+    Job->HashString.LengthAllocated = HashContext->HashStringLength + 1;
+
+    return Job;
+}
 
 /**
- Take a single incoming stream and break it into pieces.
+ A worker thread which hashes files that have been queued by the main
+ thread.
 
- @param hSource A handle to the incoming stream, which may be a file or a
-        pipe.
- 
- @param HashContext Pointer to a context describing the actions to perform.
+ @param Context Pointer to the worker state for this thread.
 
- @return TRUE to indicate success, FALSE to indicate failure.
+ @return Thread exit code, ignored.
  */
-BOOL
-HashProcessStream(
-    __in HANDLE hSource,
-    __in PHASH_CONTEXT HashContext
+DWORD WINAPI
+HashWorker(
+    __in LPVOID Context
     )
 {
-    LONG Status;
-    PVOID hHash;
-    DWORD BytesRead;
+    PHASH_WORKER Worker = (PHASH_WORKER)Context;
+    PHASH_CONTEXT HashContext = Worker->HashContext;
+    PHASH_JOB Job;
+    HANDLE WaitHandles[2];
+    DWORD FoundEvent;
+    BOOL Succeeded;
 
-    HashContext->FilesFound++;
-    HashContext->FilesFoundThisArg++;
+    WaitHandles[0] = HashContext->WorkAvailable;
+    WaitHandles[1] = HashContext->WorkerShutdownEvent;
+
+    while (TRUE) {
 
-    Status = DllBCrypt.pBCryptCreateHash(HashContext->Algorithm, &hHash, HashContext->ScratchBuffer, HashContext->ScratchBufferLength, NULL, 0, 0);
+        //
+        //  Wait for an indication of more work or shutdown.  The semaphore
+        //  is checked first, so all queued work is processed before the
+        //  shutdown event is observed.
+        //
 
-    if (Status != STATUS_SUCCESS) {
-        return FALSE;
+        FoundEvent = WaitForMultipleObjects(2, WaitHandles, FALSE, INFINITE);
+        if (FoundEvent != WAIT_OBJECT_0) {
+            break;
+        }
+
+        WaitForSingleObject(HashContext->Mutex, INFINITE);
+        ASSERT(!YoriLibIsListEmpty(&HashContext->PendingList));
+        Job = CONTAINING_RECORD(HashContext->PendingList.Next, HASH_JOB, PendingList);
+        YoriLibRemoveListItem(&Job->PendingList);
+        ReleaseMutex(HashContext->Mutex);
+
+        Succeeded = HashProcessOverlappedFile(Job->FileHandle, HashContext, Worker, &Job->HashString);
+        CloseHandle(Job->FileHandle);
+        Job->FileHandle = NULL;
+
+        WaitForSingleObject(HashContext->Mutex, INFINITE);
+        Job->Succeeded = (BOOLEAN)Succeeded;
+        Job->Complete = TRUE;
+        ReleaseMutex(HashContext->Mutex);
+
+        SetEvent(HashContext->CompletionEvent);
     }
 
-    Status = STATUS_SUCCESS;
+    return 0;
+}
+
+/**
+ Display the results of jobs which have completed, in the order the files
+ were found.  Results are displayed up to the first job that has not
+ completed.
+
+ @param HashContext Pointer to the hash context.
+
+ @param WaitForAll If TRUE, wait for all queued jobs to complete and display
+        their results.  If FALSE, wait only until fewer jobs are outstanding
+        than the limit which is allowed to be queued.
+ */
+VOID
+HashDisplayCompletedJobs(
+    __in PHASH_CONTEXT HashContext,
+    __in BOOL WaitForAll
+    )
+{
+    PHASH_JOB Job;
+    DWORD JobLimit;
+
+    //
+    //  Allow enough jobs to be queued to keep every worker busy while the
+    //  main thread is blocked behind a slow file at the head of the list.
+    //
+
+    JobLimit = HashContext->WorkerCount * 4;
+    if (WaitForAll) {
+        JobLimit = 1;
+    }
 
     while (TRUE) {
-        if (!ReadFile(hSource, HashContext->ReadBuffer, HashContext->ReadBufferLength, &BytesRead, NULL)) {
-            break;
-        }
+        WaitForSingleObject(HashContext->Mutex, INFINITE);
+        while (!YoriLibIsListEmpty(&HashContext->OrderedList)) {
+            Job = CONTAINING_RECORD(HashContext->OrderedList.Next, HASH_JOB, OrderedList);
+            if (!Job->Complete) {
+                break;
+            }
 
-        if (BytesRead == 0) {
-            break;
+            YoriLibRemoveListItem(&Job->OrderedList);
+            HashContext->JobsOutstanding--;
+            ReleaseMutex(HashContext->Mutex);
+
+            if (Job->Succeeded) {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y\n"), &Job->HashString, &Job->RelativePath);
+            } else {
+                YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: could not hash %y\n"), &Job->RelativePath);
+            }
+            YoriLibFree(Job);
+
+            WaitForSingleObject(HashContext->Mutex, INFINITE);
         }
 
-        Status = DllBCrypt.pBCryptHashData(hHash, HashContext->ReadBuffer, BytesRead, 0);
-        if (Status != STATUS_SUCCESS) {
+        if (HashContext->JobsOutstanding < JobLimit) {
+            ReleaseMutex(HashContext->Mutex);
             break;
         }
+        ReleaseMutex(HashContext->Mutex);
 
+        WaitForSingleObject(HashContext->CompletionEvent, INFINITE);
     }
+}
 
-    if (Status == STATUS_SUCCESS) {
-        Status = DllBCrypt.pBCryptFinishHash(hHash, HashContext->HashBuffer, HashContext->HashLength, 0);
-        if (Status == STATUS_SUCCESS) {
-            if (!YoriLibHexBufferToString(HashContext->HashBuffer, HashContext->HashLength, &HashContext->HashString)) {
-                Status = !(STATUS_SUCCESS);
-            }
-        }
-    }
+/**
+ Queue a file to be hashed by a worker thread.  If too many files are
+ already queued, this waits for earlier files to complete.
 
-    DllBCrypt.pBCryptDestroyHash(hHash);
+ @param HashContext Pointer to the hash context.
+
+ @param FileHandle Handle to the file, opened for asynchronous IO.  On
+        success, ownership of this handle is transferred to the job.
+
+ @param RelativePath Pointer to the name to display along with the result.
+
+ @return TRUE to indicate the file was queued, FALSE if it was not.
+ */
+BOOL
+HashQueueFile(
+    __in PHASH_CONTEXT HashContext,
+    __in HANDLE FileHandle,
+    __in PYORI_STRING RelativePath
+    )
+{
+    PHASH_JOB Job;
 
-    if (Status != STATUS_SUCCESS) {
+    Job = HashAllocateJob(HashContext, FileHandle, RelativePath);
+    if (Job == NULL) {
         return FALSE;
     }
 
+    WaitForSingleObject(HashContext->Mutex, INFINITE);
+    YoriLibAppendList(&HashContext->OrderedList, &Job->OrderedList);
+    YoriLibAppendList(&HashContext->PendingList, &Job->PendingList);
+    HashContext->JobsOutstanding++;
+    ReleaseMutex(HashContext->Mutex);
+
+    ReleaseSemaphore(HashContext->WorkAvailable, 1, NULL);
+
+    HashDisplayCompletedJobs(HashContext, FALSE);
     return TRUE;
 }
 
@@ -235,6 +986,7 @@ HashFileFoundCallback(
     HANDLE FileHandle;
     DWORD SlashesFound;
     DWORD Index;
+    DWORD OpenFlags;
 
     UNREFERENCED_PARAMETER(FileInfo);
 
@@ -258,12 +1010,17 @@ HashFileFoundCallback(
     RelativePathFrom.StartOfString = &FilePath->StartOfString[Index];
     RelativePathFrom.LengthInChars = FilePath->LengthInChars - Index;
 
+    OpenFlags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS;
+    if (HashContext->WorkerCount > 0) {
+        OpenFlags = OpenFlags | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+
     FileHandle = CreateFile(FilePath->StartOfString,
                             GENERIC_READ,
                             FILE_SHARE_READ | FILE_SHARE_DELETE,
                             NULL,
                             OPEN_EXISTING,
-                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                            OpenFlags,
                             NULL);
 
     if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
@@ -277,15 +1034,55 @@ HashFileFoundCallback(
     }
 
     HashContext->SavedErrorThisArg = ERROR_SUCCESS;
+    HashContext->FilesFound++;
+    HashContext->FilesFoundThisArg++;
+
+    if (HashContext->WorkerCount > 0) {
+        if (HashQueueFile(HashContext, FileHandle, &RelativePathFrom)) {
+            return TRUE;
+        }
+        CloseHandle(FileHandle);
+        return FALSE;
+    }
 
-    if (HashProcessStream(FileHandle, HashContext)) {
+    if (HashProcessStream(FileHandle, HashContext, &HashContext->SerialWorker, &HashContext->HashString)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y\n"), &HashContext->HashString, &RelativePathFrom);
+    } else {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: could not hash %y\n"), &RelativePathFrom);
     }
 
     CloseHandle(FileHandle);
     return TRUE;
 }
 
+/**
+ Wait for any queued files to be hashed, and terminate worker threads.
+
+ @param HashContext Pointer to the hash context.
+ */
+VOID
+HashStopWorkers(
+    __in PHASH_CONTEXT HashContext
+    )
+{
+    DWORD Index;
+
+    if (HashContext->WorkersAllocated == 0) {
+        return;
+    }
+
+    HashDisplayCompletedJobs(HashContext, TRUE);
+    ASSERT(YoriLibIsListEmpty(&HashContext->OrderedList));
+
+    SetEvent(HashContext->WorkerShutdownEvent);
+    for (Index = 0; Index < HashContext->WorkersAllocated; Index++) {
+        if (HashContext->Workers[Index].Thread != NULL) {
+            WaitForSingleObject(HashContext->Workers[Index].Thread, INFINITE);
+            CloseHandle(HashContext->Workers[Index].Thread);
+            HashContext->Workers[Index].Thread = NULL;
+        }
+    }
+}
 
 /**
  Cleanup any internal allocations within the hash context.  The context
@@ -299,95 +1096,224 @@ HashCleanupContext(
     )
 {
     LONG Status;
+    DWORD Index;
+
+    HashStopWorkers(HashContext);
 
-    if (HashContext->ScratchBuffer != NULL) {
-        YoriLibFree(HashContext->ScratchBuffer);
-        HashContext->ScratchBuffer = NULL;
+    if (HashContext->Workers != NULL) {
+        for (Index = 0; Index < HashContext->WorkersAllocated; Index++) {
+            HashCleanupWorker(&HashContext->Workers[Index]);
+        }
+        YoriLibFree(HashContext->Workers);
+        HashContext->Workers = NULL;
+        HashContext->WorkersAllocated = 0;
+    }
+
+    if (HashContext->Mutex != NULL) {
+        CloseHandle(HashContext->Mutex);
+        HashContext->Mutex = NULL;
+    }
+
+    if (HashContext->WorkAvailable != NULL) {
+        CloseHandle(HashContext->WorkAvailable);
+        HashContext->WorkAvailable = NULL;
     }
 
-    if (HashContext->HashBuffer != NULL) {
-        YoriLibFree(HashContext->HashBuffer);
-        HashContext->HashBuffer = NULL;
+    if (HashContext->WorkerShutdownEvent != NULL) {
+        CloseHandle(HashContext->WorkerShutdownEvent);
+        HashContext->WorkerShutdownEvent = NULL;
     }
 
-    if (HashContext->ReadBuffer != NULL) {
-        YoriLibFree(HashContext->ReadBuffer);
-        HashContext->ReadBuffer = NULL;
+    if (HashContext->CompletionEvent != NULL) {
+        CloseHandle(HashContext->CompletionEvent);
+        HashContext->CompletionEvent = NULL;
     }
 
+    HashCleanupWorker(&HashContext->SerialWorker);
+
     YoriLibFreeStringContents(&HashContext->HashString);
 
-    if (HashContext->Algorithm != NULL) {
-        Status = DllBCrypt.pBCryptCloseAlgorithmProvider(HashContext->Algorithm, 0);
-        ASSERT(Status == STATUS_SUCCESS);
-        HashContext->Algorithm = NULL;
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        if (HashContext->Algorithms[Index].Algorithm != NULL) {
+            Status = DllBCrypt.pBCryptCloseAlgorithmProvider(HashContext->Algorithms[Index].Algorithm, 0);
+            ASSERT(Status == STATUS_SUCCESS);
+            HashContext->Algorithms[Index].Algorithm = NULL;
+        }
+    }
+}
+
+/**
+ Add algorithms to the set to calculate for each file.
+
+ @param HashContext Pointer to the hash context.
+
+ @param AlgorithmList Pointer to a comma delimited list of algorithm names.
+
+ @return TRUE to indicate all of the algorithms were understood, FALSE if
+         any were not.
+ */
+BOOL
+HashAddAlgorithms(
+    __in PHASH_CONTEXT HashContext,
+    __in PYORI_STRING AlgorithmList
+    )
+{
+    YORI_STRING Remaining;
+    YORI_STRING Name;
+    LPTSTR Comma;
+    DWORD Index;
+    DWORD Existing;
+
+    YoriLibInitEmptyString(&Remaining);
+    Remaining.StartOfString = AlgorithmList->StartOfString;
+    Remaining.LengthInChars = AlgorithmList->LengthInChars;
+
+    while (TRUE) {
+        YoriLibInitEmptyString(&Name);
+        Name.StartOfString = Remaining.StartOfString;
+        Comma = YoriLibFindLeftMostCharacter(&Remaining, ',');
+        if (Comma != NULL) {
+            Name.LengthInChars = (DWORD)(Comma - Remaining.StartOfString);
+        } else {
+            Name.LengthInChars = Remaining.LengthInChars;
+        }
+
+        for (Index = 0; Index < HASH_MAX_ALGORITHMS; Index++) {
+            if (YoriLibCompareStringWithLiteralInsensitive(&Name, HashSupportedAlgorithms[Index]) == 0) {
+                break;
+            }
+        }
+
+        if (Index == HASH_MAX_ALGORITHMS) {
+            return FALSE;
+        }
+
+        for (Existing = 0; Existing < HashContext->AlgorithmCount; Existing++) {
+            if (HashContext->Algorithms[Existing].Name == HashSupportedAlgorithms[Index]) {
+                break;
+            }
+        }
+
+        if (Existing == HashContext->AlgorithmCount) {
+            HashContext->Algorithms[HashContext->AlgorithmCount].Name = HashSupportedAlgorithms[Index];
+            HashContext->AlgorithmCount++;
+        }
+
+        if (Comma == NULL) {
+            break;
+        }
+
+        Remaining.LengthInChars = Remaining.LengthInChars - Name.LengthInChars - 1;
+        Remaining.StartOfString = Comma + 1;
     }
+
+    return TRUE;
 }
 
 /**
  Allocate any internal allocations within the hash context needed for the
- specified hash algorithm.
+ requested hash algorithms, and start any worker threads.
 
  @param HashContext Pointer to the hash context to initialize.
 
- @param Algorithm Specifies a NULL terminated string indicating the BCrypt
-        hash algorithm to initialize.
-
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 HashInitializeContext(
-    __in PHASH_CONTEXT HashContext,
-    __in LPCWSTR Algorithm
+    __in PHASH_CONTEXT HashContext
     )
 {
     LONG Status;
     DWORD BytesReturned;
+    DWORD Index;
+    DWORD ThreadId;
+    PHASH_ALGORITHM Algorithm;
 
-    Status = DllBCrypt.pBCryptOpenAlgorithmProvider(&HashContext->Algorithm, Algorithm, MS_PRIMITIVE_PROVIDER, 0);
-    if (Status != STATUS_SUCCESS) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider not functional, status 0x%08x\n"), Status);
-        HashCleanupContext(HashContext);
-        return FALSE;
+    YoriLibInitializeListHead(&HashContext->OrderedList);
+    YoriLibInitializeListHead(&HashContext->PendingList);
+
+    HashContext->HashStringLength = 0;
+    HashContext->MaximumHashLength = 0;
+
+    for (Index = 0; Index < HashContext->AlgorithmCount; Index++) {
+        Algorithm = &HashContext->Algorithms[Index];
+        Status = DllBCrypt.pBCryptOpenAlgorithmProvider(&Algorithm->Algorithm, Algorithm->Name, MS_PRIMITIVE_PROVIDER, 0);
+        if (Status != STATUS_SUCCESS) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider not functional, status 0x%08x\n"), Status);
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
+
+        Status = DllBCrypt.pBCryptGetProperty(Algorithm->Algorithm, L"HashDigestLength", &Algorithm->HashLength, sizeof(Algorithm->HashLength), &BytesReturned, 0);
+        if (Status != STATUS_SUCCESS) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider did not return required hash length, status 0x%08x\n"), Status);
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
+
+        Status = DllBCrypt.pBCryptGetProperty(Algorithm->Algorithm, L"ObjectLength", &Algorithm->ScratchBufferLength, sizeof(Algorithm->ScratchBufferLength), &BytesReturned, 0);
+        if (Status != STATUS_SUCCESS) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider did not return required scratch space, status 0x%08x\n"), Status);
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
+
+        if (Algorithm->HashLength > HashContext->MaximumHashLength) {
+            HashContext->MaximumHashLength = Algorithm->HashLength;
+        }
+
+        if (Index > 0) {
+            HashContext->HashStringLength++;
+        }
+        HashContext->HashStringLength = HashContext->HashStringLength + Algorithm->HashLength * 2;
     }
 
-    Status = DllBCrypt.pBCryptGetProperty(HashContext->Algorithm, L"HashDigestLength", &HashContext->HashLength, sizeof(HashContext->HashLength), &BytesReturned, 0);
-    if (Status != STATUS_SUCCESS) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider did not return required hash length, status 0x%08x\n"), Status);
+    if (!YoriLibAllocateString(&HashContext->HashString, HashContext->HashStringLength + 1)) {
         HashCleanupContext(HashContext);
         return FALSE;
     }
 
-    HashContext->HashBuffer = YoriLibMalloc(HashContext->HashLength);
-    if (HashContext->HashBuffer == NULL) {
+    if (!HashInitializeWorker(HashContext, &HashContext->SerialWorker, FALSE)) {
         HashCleanupContext(HashContext);
         return FALSE;
     }
 
-    Status = DllBCrypt.pBCryptGetProperty(HashContext->Algorithm, L"ObjectLength", &HashContext->ScratchBufferLength, sizeof(HashContext->ScratchBufferLength), &BytesReturned, 0);
-    if (Status != STATUS_SUCCESS) {
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm provider did not return required scratch space, status 0x%08x\n"), Status);
-        HashCleanupContext(HashContext);
-        return FALSE;
+    if (HashContext->WorkerCount == 0) {
+        return TRUE;
     }
 
-    HashContext->ScratchBuffer = YoriLibMalloc(HashContext->ScratchBufferLength);
-    if (HashContext->ScratchBuffer == NULL) {
+    HashContext->Mutex = CreateMutex(NULL, FALSE, NULL);
+    HashContext->WorkAvailable = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+    HashContext->WorkerShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    HashContext->CompletionEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (HashContext->Mutex == NULL ||
+        HashContext->WorkAvailable == NULL ||
+        HashContext->WorkerShutdownEvent == NULL ||
+        HashContext->CompletionEvent == NULL) {
+
         HashCleanupContext(HashContext);
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&HashContext->HashString, HashContext->HashLength * 2 + 1)) {
+    HashContext->Workers = YoriLibMalloc(HashContext->WorkerCount * sizeof(HASH_WORKER));
+    if (HashContext->Workers == NULL) {
         HashCleanupContext(HashContext);
         return FALSE;
     }
 
-    HashContext->ReadBufferLength = 1024 * 1024;
+    for (Index = 0; Index < HashContext->WorkerCount; Index++) {
+        HashContext->WorkersAllocated++;
+        if (!HashInitializeWorker(HashContext, &HashContext->Workers[Index], TRUE)) {
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
 
-    HashContext->ReadBuffer = YoriLibMalloc(HashContext->ReadBufferLength);
-    if (HashContext->ReadBuffer == NULL) {
-        HashCleanupContext(HashContext);
-        return FALSE;
+        HashContext->Workers[Index].HashContext = HashContext;
+        HashContext->Workers[Index].Thread = CreateThread(NULL, 0, HashWorker, &HashContext->Workers[Index], 0, &ThreadId);
+        if (HashContext->Workers[Index].Thread == NULL) {
+            HashCleanupContext(HashContext);
+            return FALSE;
+        }
     }
 
     return TRUE;
@@ -486,10 +1412,11 @@ ENTRYPOINT(
     DWORD i;
     DWORD StartArg = 0;
     DWORD MatchFlags;
+    DWORD CharsConsumed;
+    LONGLONG llTemp;
     BOOL BasicEnumeration = FALSE;
     HASH_CONTEXT HashContext;
     YORI_STRING Arg;
-    LPTSTR Algorithm = L"SHA1";
 
     ZeroMemory(&HashContext, sizeof(HashContext));
 
@@ -504,42 +1431,31 @@ ENTRYPOINT(
                 HashHelp();
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("license")) == 0) {
-                YoriLibDisplayMitLicense(_T("2019"));
+                YoriLibDisplayMitLicense(_T("2019-2020"));
                 return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("a")) == 0) {
                 if (i + 1 < ArgC) {
-                    if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("MD4")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = _T("MD4");
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("MD5")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = _T("MD5");
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA1")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = _T("SHA1");
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA256")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = _T("SHA256");
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA384")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = _T("SHA384");
-                    } else if (YoriLibCompareStringWithLiteralInsensitive(&ArgV[i + 1], _T("SHA512")) == 0) {
-                        ArgumentUnderstood = TRUE;
-                        i++;
-                        Algorithm = _T("SHA512");
-                    } else {
+                    if (!HashAddAlgorithms(&HashContext, &ArgV[i + 1])) {
                         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hash: algorithm not recognized.  Supported algorithms are MD4, MD5, SHA1, SHA256, SHA384, and SHA512\n"));
                         return EXIT_FAILURE;
                     }
+                    ArgumentUnderstood = TRUE;
+                    i++;
                 }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("j")) == 0) {
+                if (i + 1 < ArgC) {
+                    if (YoriLibStringToNumber(&ArgV[i + 1], FALSE, &llTemp, &CharsConsumed) && CharsConsumed > 0) {
+                        HashContext.WorkerCount = (DWORD)llTemp;
+                        if (llTemp > HASH_MAX_WORKERS) {
+                            HashContext.WorkerCount = HASH_MAX_WORKERS;
+                        }
+                        ArgumentUnderstood = TRUE;
+                        i++;
+                    }
+                }
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 HashContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -559,6 +1475,11 @@ ENTRYPOINT(
         }
     }
 
+    if (HashContext.AlgorithmCount == 0) {
+        HashContext.Algorithms[0].Name = _T("SHA1");
+        HashContext.AlgorithmCount = 1;
+    }
+
     YoriLibLoadBCryptFunctions();
     if (DllBCrypt.pBCryptCloseAlgorithmProvider == NULL ||
         DllBCrypt.pBCryptCreateHash == NULL ||
@@ -572,7 +1493,16 @@ ENTRYPOINT(
         return EXIT_FAILURE;
     }
 
-    if (!HashInitializeContext(&HashContext, Algorithm)) {
+    //
+    //  Worker threads are only useful when hashing files.  Standard input
+    //  is a single stream, so it is always hashed on the main thread.
+    //
+
+    if (StartArg == 0 || StartArg == ArgC) {
+        HashContext.WorkerCount = 0;
+    }
+
+    if (!HashInitializeContext(&HashContext)) {
         return EXIT_FAILURE;
     }
 
@@ -599,7 +1529,8 @@ ENTRYPOINT(
             return EXIT_FAILURE;
         }
 
-        if (!HashProcessStream(GetStdHandle(STD_INPUT_HANDLE), &HashContext)) {
+        HashContext.FilesFound++;
+        if (!HashProcessStream(GetStdHandle(STD_INPUT_HANDLE), &HashContext, &HashContext.SerialWorker, &HashContext.HashString)) {
             HashCleanupContext(&HashContext);
             return EXIT_FAILURE;
         }
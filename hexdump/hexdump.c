@@ -671,6 +671,7 @@ HexDumpProcessStream(
     DWORD LengthToDisplay;
     DWORD DisplayFlags;
     DWORD FileType;
+    DWORD BytesAvailable;
     LARGE_INTEGER StreamOffset;
     BOOLEAN LimitDisplayToEvenLine;
 
@@ -715,9 +716,18 @@ HexDumpProcessStream(
     while (TRUE) {
 
         //
-        //  Read a block of data.  On a pipe, this will block.
+        //  Read a block of data.  On a pipe, this will block, so if the
+        //  pipe has no data yet, write everything displayed so far so the
+        //  output keeps up with the producer.
         //
 
+        if (FileType == FILE_TYPE_PIPE &&
+            (!PeekNamedPipe(hSource, NULL, 0, NULL, &BytesAvailable, NULL) ||
+             BytesAvailable == 0)) {
+
+            YoriLibOutputFlush(GetStdHandle(STD_OUTPUT_HANDLE));
+        }
+
         BytesReturned = 0;
         ASSERT(BufferReadOffset < BufferSize);
         if (!ReadFile(hSource, Buffer + BufferReadOffset, BufferSize - BufferReadOffset, &BytesReturned, NULL)) {
@@ -1422,6 +1432,13 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    //
+    //  Output is generated a line at a time, so if it's going to a file or
+    //  pipe, buffer it to write in larger chunks.
+    //
+
+    YoriLibOutputEnableBuffering(GetStdHandle(STD_OUTPUT_HANDLE));
+
     if (DiffMode) {
         if (StartArg == 0 || StartArg + 2 > ArgC) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hexdump: insufficient arguments\n"));
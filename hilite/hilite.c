@@ -38,11 +38,13 @@ CHAR strHiliteHelpText[] =
         "\n"
         "HILITE [-license] [-b] [-c <string> <color>] [-h <string> <color>]\n"
         "       [-i] [-s] [-t <string> <color>] [<file>...]\n"
+        "HILITE -perf\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Highlight lines containing <string> with <color>\n"
         "   -h             Highlight lines starting with <string> with <color>\n"
         "   -i             Match insensitively\n"
+        "   -perf          Measure the speed of searching generated lines of text\n"
         "   -s             Process files from all subdirectories\n"
         "   -t             Highlight lines ending with <string> with <color>\n";
 
@@ -94,8 +96,19 @@ typedef struct _HILITE_MATCH_CRITERIA {
      The color to apply to the line, in event of a match.
      */
     YORILIB_COLOR_ATTRIBUTES Color;
+
+    /**
+     For matches that look for a string anywhere in the line, the index of
+     the string in the context's ContainsArray.
+     */
+    DWORD ContainsIndex;
 } HILITE_MATCH_CRITERIA, *PHILITE_MATCH_CRITERIA;
 
+/**
+ The number of characters to buffer before writing output.
+ */
+#define HILITE_OUTPUT_BUFFER_LENGTH (64 * 1024)
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -128,8 +141,233 @@ typedef struct _HILITE_CONTEXT {
      */
     YORI_LIST_ENTRY Matches;
 
+    /**
+     The number of matches in the Matches list which look for a string
+     anywhere in the line.
+     */
+    DWORD ContainsCount;
+
+    /**
+     An array of the strings to look for anywhere in the line, in the same
+     order as the Matches list.
+     */
+    PYORI_STRING ContainsArray;
+
+    /**
+     A matcher that searches each line for all of the strings in
+     ContainsArray at once.
+     */
+    YORI_LIB_SUBSTRING_MATCHER ContainsMatcher;
+
+    /**
+     The VT escape sequence to restore the default color.
+     */
+    YORI_STRING DefaultColorEscape;
+
+    /**
+     Output which has been generated but not yet written.
+     */
+    YORI_STRING OutputBuffer;
+
 } HILITE_CONTEXT, *PHILITE_CONTEXT;
 
+/**
+ Prepare the user specified criteria for matching against lines.  This
+ compiles all of the criteria which look for strings anywhere in the line
+ into a single matcher so each line can be searched once, and allocates the
+ buffer used for output.
+
+ @param HiliteContext The context containing the user specified criteria.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+HiliteCompileCriteria(
+    __inout PHILITE_CONTEXT HiliteContext
+    )
+{
+    PHILITE_MATCH_CRITERIA MatchCriteria;
+    PYORI_LIST_ENTRY ListEntry;
+
+    if (!YoriLibVtStringForTextAttribute(&HiliteContext->DefaultColorEscape, 0, HiliteContext->DefaultColor.Win32Attr)) {
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&HiliteContext->OutputBuffer, HILITE_OUTPUT_BUFFER_LENGTH)) {
+        return FALSE;
+    }
+
+    HiliteContext->ContainsCount = 0;
+    ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, NULL);
+    while (ListEntry != NULL) {
+        MatchCriteria = CONTAINING_RECORD(ListEntry, HILITE_MATCH_CRITERIA, ListEntry);
+        if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
+            HiliteContext->ContainsCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, ListEntry);
+    }
+
+    if (HiliteContext->ContainsCount == 0) {
+        return TRUE;
+    }
+
+    HiliteContext->ContainsArray = YoriLibMalloc(HiliteContext->ContainsCount * sizeof(YORI_STRING));
+    if (HiliteContext->ContainsArray == NULL) {
+        return FALSE;
+    }
+
+    HiliteContext->ContainsCount = 0;
+    ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, NULL);
+    while (ListEntry != NULL) {
+        MatchCriteria = CONTAINING_RECORD(ListEntry, HILITE_MATCH_CRITERIA, ListEntry);
+        if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
+            MatchCriteria->ContainsIndex = HiliteContext->ContainsCount;
+            HiliteContext->ContainsArray[HiliteContext->ContainsCount] = MatchCriteria->MatchString;
+            HiliteContext->ContainsCount++;
+        }
+        ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, ListEntry);
+    }
+
+    if (!YoriLibInitializeSubstringMatcher(&HiliteContext->ContainsMatcher,
+                                           HiliteContext->ContainsCount,
+                                           HiliteContext->ContainsArray,
+                                           HiliteContext->Insensitive)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Write any buffered output.
+
+ @param HiliteContext Pointer to the context containing the output buffer.
+ */
+VOID
+HiliteFlushOutput(
+    __in PHILITE_CONTEXT HiliteContext
+    )
+{
+    if (HiliteContext->OutputBuffer.LengthInChars > 0) {
+        YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), 0, &HiliteContext->OutputBuffer);
+        HiliteContext->OutputBuffer.LengthInChars = 0;
+    }
+}
+
+/**
+ Add a string to the output buffer, writing the buffer if it is full.
+
+ @param HiliteContext Pointer to the context containing the output buffer.
+
+ @param String The string to add.
+ */
+VOID
+HiliteBufferOutput(
+    __in PHILITE_CONTEXT HiliteContext,
+    __in PYORI_STRING String
+    )
+{
+    PYORI_STRING OutputBuffer;
+
+    OutputBuffer = &HiliteContext->OutputBuffer;
+    if (OutputBuffer->LengthInChars + String->LengthInChars > OutputBuffer->LengthAllocated) {
+        HiliteFlushOutput(HiliteContext);
+        if (String->LengthInChars > OutputBuffer->LengthAllocated) {
+            YoriLibOutputString(GetStdHandle(STD_OUTPUT_HANDLE), 0, String);
+            return;
+        }
+    }
+
+    memcpy(&OutputBuffer->StartOfString[OutputBuffer->LengthInChars], String->StartOfString, String->LengthInChars * sizeof(TCHAR));
+    OutputBuffer->LengthInChars += String->LengthInChars;
+}
+
+/**
+ Determine the criteria that applies to a line.  Criteria are evaluated in
+ the order they were specified, and the first one that matches is applied.
+ All criteria looking for strings anywhere in the line are evaluated with a
+ single search of the line, so the result of each can be determined without
+ searching again.
+
+ @param HiliteContext Pointer to the context containing the criteria.
+
+ @param LineString The line to match against.
+
+ @return Pointer to the criteria that matched, or NULL if no criteria
+         matched.
+ */
+PHILITE_MATCH_CRITERIA
+HiliteFindCriteriaForLine(
+    __in PHILITE_CONTEXT HiliteContext,
+    __in PYORI_STRING LineString
+    )
+{
+    PHILITE_MATCH_CRITERIA MatchCriteria;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_STRING ContainsMatch;
+    DWORD ContainsIndex;
+    YORI_STRING TailOfLine;
+
+    ContainsIndex = (DWORD)-1;
+    if (HiliteContext->ContainsCount > 0) {
+        ContainsMatch = YoriLibFindFirstListedSubstringMatch(&HiliteContext->ContainsMatcher, LineString);
+        if (ContainsMatch != NULL) {
+            ContainsIndex = (DWORD)(ContainsMatch - HiliteContext->ContainsArray);
+        }
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, NULL);
+    while (ListEntry != NULL) {
+        MatchCriteria = CONTAINING_RECORD(ListEntry, HILITE_MATCH_CRITERIA, ListEntry);
+        if (MatchCriteria->MatchType == HiliteMatchTypeBeginsWith) {
+            if (HiliteContext->Insensitive) {
+                if (YoriLibCompareStringInsensitiveCount(LineString,
+                                                         &MatchCriteria->MatchString,
+                                                         MatchCriteria->MatchString.LengthInChars) == 0) {
+                    return MatchCriteria;
+                }
+            } else {
+                if (YoriLibCompareStringCount(LineString,
+                                              &MatchCriteria->MatchString,
+                                              MatchCriteria->MatchString.LengthInChars) == 0) {
+                    return MatchCriteria;
+                }
+            }
+        } else if (MatchCriteria->MatchType == HiliteMatchTypeEndsWith) {
+            if (LineString->LengthInChars >= MatchCriteria->MatchString.LengthInChars) {
+                YoriLibInitEmptyString(&TailOfLine);
+                TailOfLine.LengthInChars = MatchCriteria->MatchString.LengthInChars;
+                TailOfLine.StartOfString = &LineString->StartOfString[LineString->LengthInChars - MatchCriteria->MatchString.LengthInChars];
+
+                if (HiliteContext->Insensitive) {
+                    if (YoriLibCompareStringInsensitive(&TailOfLine, &MatchCriteria->MatchString) == 0) {
+                        return MatchCriteria;
+                    }
+                } else {
+                    if (YoriLibCompareString(&TailOfLine, &MatchCriteria->MatchString) == 0) {
+                        return MatchCriteria;
+                    }
+                }
+            }
+        } else if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
+
+            //
+            //  The search found the earliest specified criteria that
+            //  matches.  Criteria before it don't match, and criteria
+            //  after it aren't reached.
+            //
+
+            if (MatchCriteria->ContainsIndex == ContainsIndex) {
+                return MatchCriteria;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, ListEntry);
+    }
+
+    return NULL;
+}
+
 /**
  Process a stream and apply the hilite criteria before outputting to standard
  output.
@@ -150,14 +388,42 @@ HiliteProcessStream(
     PVOID LineContext = NULL;
     CONSOLE_SCREEN_BUFFER_INFO ScreenInfo;
     YORI_STRING LineString;
+    YORI_STRING ColorEscape;
+    YORI_STRING LineEnd;
+    TCHAR ColorEscapeBuffer[YORI_MAX_INTERNAL_VT_ESCAPE_CHARS];
     PHILITE_MATCH_CRITERIA MatchCriteria;
     YORILIB_COLOR_ATTRIBUTES ColorToUse;
-    PYORI_LIST_ENTRY ListEntry;
+    DWORD ConsoleWidth;
+    DWORD BytesAvailable;
+    DWORD Index;
+    BOOL SourceIsPipe;
+    BOOL LineWrapped;
 
     YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&ColorEscape);
+    ColorEscape.StartOfString = ColorEscapeBuffer;
+    ColorEscape.LengthAllocated = sizeof(ColorEscapeBuffer)/sizeof(ColorEscapeBuffer[0]);
+    YoriLibConstantString(&LineEnd, _T("\n"));
 
     HiliteContext->FilesFound++;
 
+    //
+    //  If the output is a console, a line which exactly fills the width of
+    //  the console will have already moved the cursor to the next line.
+    //  Since output is buffered the cursor can't be queried after each line,
+    //  so determine this from the console width.
+    //
+
+    ConsoleWidth = 0;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo)) {
+        ConsoleWidth = ScreenInfo.dwSize.X;
+    }
+
+    SourceIsPipe = FALSE;
+    if (GetFileType(hSource) == FILE_TYPE_PIPE) {
+        SourceIsPipe = TRUE;
+    }
+
     while (TRUE) {
 
         if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
@@ -167,90 +433,59 @@ HiliteProcessStream(
         ColorToUse.Ctrl = HiliteContext->DefaultColor.Ctrl;
         ColorToUse.Win32Attr = HiliteContext->DefaultColor.Win32Attr;
 
-        //
-        //  Enumerate through the matches and see if there is anything to
-        //  apply.
-        //
+        MatchCriteria = HiliteFindCriteriaForLine(HiliteContext, &LineString);
+        if (MatchCriteria != NULL) {
+            ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
+            ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
+        }
 
-        ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, NULL);
-        while (ListEntry != NULL) {
-            MatchCriteria = CONTAINING_RECORD(ListEntry, HILITE_MATCH_CRITERIA, ListEntry);
-            if (MatchCriteria->MatchType == HiliteMatchTypeBeginsWith) {
-                if (HiliteContext->Insensitive) {
-                    if (YoriLibCompareStringInsensitiveCount(&LineString,
-                                                             &MatchCriteria->MatchString,
-                                                             MatchCriteria->MatchString.LengthInChars) == 0) {
-                        ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
-                        ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
-                        break;
-                    }
-                } else {
-                    if (YoriLibCompareStringCount(&LineString,
-                                                  &MatchCriteria->MatchString,
-                                                  MatchCriteria->MatchString.LengthInChars) == 0) {
-                        ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
-                        ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
-                        break;
-                    }
-                }
-            } else if (MatchCriteria->MatchType == HiliteMatchTypeEndsWith) {
-                YORI_STRING TailOfLine;
-    
-                if (LineString.LengthInChars >= MatchCriteria->MatchString.LengthInChars) {
-                    YoriLibInitEmptyString(&TailOfLine);
-                    TailOfLine.LengthInChars = MatchCriteria->MatchString.LengthInChars;
-                    TailOfLine.StartOfString = &LineString.StartOfString[LineString.LengthInChars - MatchCriteria->MatchString.LengthInChars];
-    
-                    if (HiliteContext->Insensitive) {
-                        if (YoriLibCompareStringInsensitive(&TailOfLine, &MatchCriteria->MatchString) == 0) {
-                            ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
-                            ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
-                            break;
-                        }
-                    } else {
-                        if (YoriLibCompareString(&TailOfLine, &MatchCriteria->MatchString) == 0) {
-                            ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
-                            ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
-                            break;
-                        }
-                    }
-                }
-            } else if (MatchCriteria->MatchType == HiliteMatchTypeContains) {
-                if (HiliteContext->Insensitive) {
-                    if (YoriLibFindFirstMatchingSubstringInsensitive(&LineString, 1, &MatchCriteria->MatchString, NULL)) {
-                        ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
-                        ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
-                        break;
-                    }
-                } else {
-                    if (YoriLibFindFirstMatchingSubstring(&LineString, 1, &MatchCriteria->MatchString, NULL)) {
-                        ColorToUse.Ctrl = MatchCriteria->Color.Ctrl;
-                        ColorToUse.Win32Attr = MatchCriteria->Color.Win32Attr;
-                        break;
-                    }
+        LineWrapped = FALSE;
+        if (ConsoleWidth > 0 &&
+            LineString.LengthInChars > 0 &&
+            (LineString.LengthInChars % ConsoleWidth) == 0) {
+
+            LineWrapped = TRUE;
+            for (Index = 0; Index < LineString.LengthInChars; Index++) {
+                if (LineString.StartOfString[Index] < ' ') {
+                    LineWrapped = FALSE;
+                    break;
                 }
             }
-            ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, ListEntry);
         }
 
         //
         //  Apply the color and output the line.
         //
 
-        YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, ColorToUse.Win32Attr);
-        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &LineString);
-        if (LineString.LengthInChars == 0 || !GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &ScreenInfo) || ScreenInfo.dwCursorPosition.X != 0) {
-            YoriLibVtSetConsoleTextAttribute(YORI_LIB_OUTPUT_STDOUT, HiliteContext->DefaultColor.Win32Attr);
-            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+        if (YoriLibVtStringForTextAttribute(&ColorEscape, 0, ColorToUse.Win32Attr)) {
+            HiliteBufferOutput(HiliteContext, &ColorEscape);
+        }
+        HiliteBufferOutput(HiliteContext, &LineString);
+        if (!LineWrapped) {
+            HiliteBufferOutput(HiliteContext, &HiliteContext->DefaultColorEscape);
+            HiliteBufferOutput(HiliteContext, &LineEnd);
+        }
+
+        //
+        //  If the source is a pipe and it has no more data yet, write
+        //  everything so far so the output keeps up with the producer.
+        //
+
+        if (SourceIsPipe &&
+            (!PeekNamedPipe(hSource, NULL, 0, NULL, &BytesAvailable, NULL) ||
+             BytesAvailable == 0)) {
+
+            HiliteFlushOutput(HiliteContext);
         }
     }
 
+    HiliteFlushOutput(HiliteContext);
+
     YoriLibLineReadClose(LineContext);
     YoriLibFreeStringContents(&LineString);
 
     return TRUE;
 }
-
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -387,6 +622,262 @@ HiliteCleanupContext(
         YoriLibFree(MatchCriteria);
         ListEntry = YoriLibGetNextListEntry(&HiliteContext->Matches, NULL);
     }
+
+    YoriLibFreeSubstringMatcher(&HiliteContext->ContainsMatcher);
+    if (HiliteContext->ContainsArray != NULL) {
+        YoriLibFree(HiliteContext->ContainsArray);
+        HiliteContext->ContainsArray = NULL;
+    }
+    YoriLibFreeStringContents(&HiliteContext->DefaultColorEscape);
+    YoriLibFreeStringContents(&HiliteContext->OutputBuffer);
+}
+
+/**
+ The number of lines of generated text to search when measuring the speed of
+ matching.
+ */
+#define HILITE_PERF_LINES (100000)
+
+/**
+ The number of characters in each line of generated text.
+ */
+#define HILITE_PERF_LINE_LENGTH (100)
+
+/**
+ The strings to search for when measuring the speed of matching.  Searches
+ use either the first of these or all of them.
+ */
+LPCTSTR HilitePerfStrings[] = {
+    _T("error"),
+    _T("warning"),
+    _T("timeout"),
+    _T("denied"),
+    _T("failed"),
+    _T("retry"),
+    _T("abort"),
+    _T("fatal")
+};
+
+/**
+ Fill a buffer with lines of pseudorandom lowercase words.  One line in every
+ sixteen contains one of the strings in HilitePerfStrings, and one line in
+ every sixteen contains one of them with its first letter in upper case, so
+ that case sensitive and insensitive searches find different lines.
+
+ @param Buffer Pointer to the buffer to fill, which must contain
+        HILITE_PERF_LINES * HILITE_PERF_LINE_LENGTH characters.
+ */
+VOID
+HilitePerfGenerate(
+    __out LPTSTR Buffer
+    )
+{
+    DWORD LineIndex;
+    DWORD CharIndex;
+    DWORD Seed;
+    DWORD Value;
+    LPTSTR Line;
+    LPCTSTR Insert;
+
+    Seed = 1;
+    for (LineIndex = 0; LineIndex < HILITE_PERF_LINES; LineIndex++) {
+        Line = &Buffer[LineIndex * HILITE_PERF_LINE_LENGTH];
+        for (CharIndex = 0; CharIndex < HILITE_PERF_LINE_LENGTH; CharIndex++) {
+            Seed = Seed * 1103515245 + 12345;
+            Value = (Seed >> 16) % 27;
+            if (Value == 26) {
+                Line[CharIndex] = ' ';
+            } else {
+                Line[CharIndex] = (TCHAR)('a' + Value);
+            }
+        }
+
+        if ((LineIndex % 8) == 0) {
+            Insert = HilitePerfStrings[(LineIndex / 16) % (sizeof(HilitePerfStrings)/sizeof(HilitePerfStrings[0]))];
+            CharIndex = (Seed >> 16) % (HILITE_PERF_LINE_LENGTH - 16);
+            for (Value = 0; Insert[Value] != '\0'; Value++) {
+                Line[CharIndex + Value] = Insert[Value];
+            }
+            if ((LineIndex % 16) == 8) {
+                Line[CharIndex] = YoriLibUpcaseChar(Line[CharIndex]);
+            }
+        }
+    }
+}
+
+/**
+ Convert a number of lines searched over a number of performance counter
+ ticks into lines per second.
+
+ @param Lines The number of lines searched.
+
+ @param Ticks The number of performance counter ticks elapsed.
+
+ @param Frequency The number of performance counter ticks per second.
+
+ @return The number of lines searched per second.
+ */
+DWORDLONG
+HilitePerfRate(
+    __in DWORDLONG Lines,
+    __in LONGLONG Ticks,
+    __in LONGLONG Frequency
+    )
+{
+    if (Ticks <= 0) {
+        Ticks = 1;
+    }
+    return Lines * Frequency / Ticks;
+}
+
+/**
+ Search every line of generated text for a set of strings, once with a
+ substring matcher and once by comparing each string at each offset, and
+ display the number of lines per second searched by each.  The results of the
+ two searches are compared so that an error in the matcher is reported rather
+ than measured.
+
+ @param Buffer Pointer to the generated text.
+
+ @param NumberMatches The number of strings to search for.
+
+ @param MatchArray The strings to search for.
+
+ @param Insensitive TRUE to search case insensitively, FALSE to search case
+        sensitively.
+
+ @param Frequency The number of performance counter ticks per second.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HilitePerfSearch(
+    __in LPTSTR Buffer,
+    __in DWORD NumberMatches,
+    __in PYORI_STRING MatchArray,
+    __in BOOLEAN Insensitive,
+    __in LONGLONG Frequency
+    )
+{
+    YORI_LIB_SUBSTRING_MATCHER Matcher;
+    YORI_STRING Line;
+    PYORI_STRING Match;
+    DWORD LineIndex;
+    DWORD Offset;
+    DWORD MatcherLinesFound;
+    DWORDLONG MatcherChecksum;
+    DWORD CompareLinesFound;
+    DWORDLONG CompareChecksum;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    LONGLONG MatcherTicks;
+    LONGLONG CompareTicks;
+
+    if (!YoriLibInitializeSubstringMatcher(&Matcher, NumberMatches, MatchArray, Insensitive)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: out of memory\n"));
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&Line);
+    Line.LengthInChars = HILITE_PERF_LINE_LENGTH;
+
+    //
+    //  The checksum combines which string was found and where in each
+    //  line, so the two searches must agree on both.
+    //
+
+    MatcherLinesFound = 0;
+    MatcherChecksum = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (LineIndex = 0; LineIndex < HILITE_PERF_LINES; LineIndex++) {
+        Line.StartOfString = &Buffer[LineIndex * HILITE_PERF_LINE_LENGTH];
+        Match = YoriLibFindSubstringMatch(&Matcher, &Line, &Offset);
+        if (Match != NULL) {
+            MatcherLinesFound++;
+            MatcherChecksum = MatcherChecksum + Offset * NumberMatches + (DWORD)(Match - MatchArray);
+        }
+    }
+    QueryPerformanceCounter(&EndTime);
+    MatcherTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    CompareLinesFound = 0;
+    CompareChecksum = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (LineIndex = 0; LineIndex < HILITE_PERF_LINES; LineIndex++) {
+        Line.StartOfString = &Buffer[LineIndex * HILITE_PERF_LINE_LENGTH];
+        if (Insensitive) {
+            Match = YoriLibFindFirstMatchingSubstringInsensitive(&Line, NumberMatches, MatchArray, &Offset);
+        } else {
+            Match = YoriLibFindFirstMatchingSubstring(&Line, NumberMatches, MatchArray, &Offset);
+        }
+        if (Match != NULL) {
+            CompareLinesFound++;
+            CompareChecksum = CompareChecksum + Offset * NumberMatches + (DWORD)(Match - MatchArray);
+        }
+    }
+    QueryPerformanceCounter(&EndTime);
+    CompareTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    YoriLibFreeSubstringMatcher(&Matcher);
+
+    if (MatcherLinesFound != CompareLinesFound || MatcherChecksum != CompareChecksum) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: matcher found %i lines, comparison found %i lines, or found different strings\n"), MatcherLinesFound, CompareLinesFound);
+        return FALSE;
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("%i strings, %s: %i lines found, matcher %lli lines/s, per string %lli lines/s\n"),
+                  NumberMatches,
+                  Insensitive?_T("insensitive"):_T("sensitive"),
+                  MatcherLinesFound,
+                  HilitePerfRate(HILITE_PERF_LINES, MatcherTicks, Frequency),
+                  HilitePerfRate(HILITE_PERF_LINES, CompareTicks, Frequency));
+
+    return TRUE;
+}
+
+/**
+ Measure the speed of searching generated lines of text for one string and
+ for several strings, case sensitively and insensitively.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+HilitePerf(VOID)
+{
+    YORI_STRING MatchArray[sizeof(HilitePerfStrings)/sizeof(HilitePerfStrings[0])];
+    DWORD NumberMatches;
+    DWORD Index;
+    LPTSTR Buffer;
+    LARGE_INTEGER Frequency;
+    BOOL Result;
+
+    Buffer = YoriLibMalloc(HILITE_PERF_LINES * HILITE_PERF_LINE_LENGTH * sizeof(TCHAR));
+    if (Buffer == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: out of memory\n"));
+        return FALSE;
+    }
+
+    HilitePerfGenerate(Buffer);
+
+    NumberMatches = sizeof(HilitePerfStrings)/sizeof(HilitePerfStrings[0]);
+    for (Index = 0; Index < NumberMatches; Index++) {
+        YoriLibConstantString(&MatchArray[Index], HilitePerfStrings[Index]);
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+
+    Result = FALSE;
+    if (HilitePerfSearch(Buffer, 1, MatchArray, FALSE, Frequency.QuadPart) &&
+        HilitePerfSearch(Buffer, 1, MatchArray, TRUE, Frequency.QuadPart) &&
+        HilitePerfSearch(Buffer, NumberMatches, MatchArray, FALSE, Frequency.QuadPart) &&
+        HilitePerfSearch(Buffer, NumberMatches, MatchArray, TRUE, Frequency.QuadPart)) {
+
+        Result = TRUE;
+    }
+
+    YoriLibFree(Buffer);
+    return Result;
 }
 
 
@@ -495,6 +986,12 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("i")) == 0) {
                 HiliteContext.Insensitive = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
+                HiliteCleanupContext(&HiliteContext);
+                if (!HilitePerf()) {
+                    return EXIT_FAILURE;
+                }
+                return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 HiliteContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -531,6 +1028,12 @@ ENTRYPOINT(
         }
     }
 
+    if (!HiliteCompileCriteria(&HiliteContext)) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("hilite: out of memory\n"));
+        HiliteCleanupContext(&HiliteContext);
+        return EXIT_FAILURE;
+    }
+
     //
     //  Attempt to enable backup privilege so an administrator can access more
     //  objects successfully.
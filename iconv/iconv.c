@@ -36,11 +36,13 @@ CHAR strIconvHelpText[] =
         "Convert the character encoding of one or more files.\n"
         "\n"
         "ICONV [-license] [-b] [-s] [-e <encoding>] [-i <encoding>] [<file>...]\n"
+        "ICONV -perf\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -e <encoding>  Specifies the new encoding to use\n"
         "   -i <encoding>  Specifies the input (current) encoding\n"
         "   -m             Use traditional Mac line endings (CR)\n"
+        "   -perf          Measure UTF-8 conversion speed of generated text\n"
         "   -s             Process files from all subdirectories\n"
         "   -u             Use Unix line endings (LF)\n"
         "   -w             Use Windows line endings (CRLF)\n";
@@ -265,6 +267,236 @@ IconvFileEnumerateErrorCallback(
     return Result;
 }
 
+/**
+ The number of characters in each buffer generated for the benchmark.
+ */
+#define ICONV_BENCHMARK_CHARS (4 * 1024 * 1024)
+
+/**
+ The number of times each buffer is converted in each direction when
+ benchmarking.
+ */
+#define ICONV_BENCHMARK_ITERATIONS (16)
+
+/**
+ The types of text generated for the benchmark.
+ */
+typedef enum _ICONV_BENCHMARK_TYPE {
+    IconvBenchmarkAscii = 0,
+    IconvBenchmarkMixed = 1,
+    IconvBenchmarkCjk = 2,
+    IconvBenchmarkMaximum = 3
+} ICONV_BENCHMARK_TYPE;
+
+/**
+ Populate a UTF16 buffer with generated text of the specified type.  ASCII
+ text contains printable characters with a line break every 80 characters.
+ Mixed text is the same but with every sixteenth character replaced by a
+ Latin-1 or Greek character, so the ASCII runs are short.  CJK text consists
+ entirely of CJK unified ideographs, with a line break every 40 characters.
+
+ @param Type The type of text to generate.
+
+ @param Buffer Pointer to the buffer to populate.
+
+ @param Length The length of the buffer, in characters.
+ */
+VOID
+IconvBenchmarkGenerate(
+    __in ICONV_BENCHMARK_TYPE Type,
+    __out_ecount(Length) LPTSTR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD Seed;
+
+    Seed = 1;
+    for (Index = 0; Index < Length; Index++) {
+        Seed = Seed * 1103515245 + 12345;
+        if (Type == IconvBenchmarkCjk) {
+            if ((Index % 40) == 38) {
+                Buffer[Index] = '\r';
+            } else if ((Index % 40) == 39) {
+                Buffer[Index] = '\n';
+            } else {
+                Buffer[Index] = (TCHAR)(0x4E00 + ((Seed >> 16) % 0x5000));
+            }
+        } else {
+            if ((Index % 80) == 78) {
+                Buffer[Index] = '\r';
+            } else if ((Index % 80) == 79) {
+                Buffer[Index] = '\n';
+            } else if (Type == IconvBenchmarkMixed && (Index % 16) == 15) {
+                if (Seed & 0x10000) {
+                    Buffer[Index] = (TCHAR)(0xC0 + ((Seed >> 17) % 0x40));
+                } else {
+                    Buffer[Index] = (TCHAR)(0x3B1 + ((Seed >> 17) % 0x18));
+                }
+            } else {
+                Buffer[Index] = (TCHAR)(' ' + ((Seed >> 16) % 95));
+            }
+        }
+    }
+}
+
+/**
+ Convert a number of bytes processed over a number of performance counter
+ ticks into megabytes per second.
+
+ @param Bytes The number of bytes processed.
+
+ @param Ticks The number of performance counter ticks elapsed.
+
+ @param Frequency The number of performance counter ticks per second.
+
+ @return The throughput, in megabytes per second.
+ */
+DWORDLONG
+IconvBenchmarkThroughput(
+    __in DWORDLONG Bytes,
+    __in LONGLONG Ticks,
+    __in LONGLONG Frequency
+    )
+{
+    if (Ticks <= 0) {
+        Ticks = 1;
+    }
+    return Bytes * Frequency / Ticks / (1024 * 1024);
+}
+
+/**
+ Measure the throughput of converting generated ASCII, mixed and CJK text
+ from UTF16 to UTF8 and back, and display the result for each.  The text
+ converted back is compared against the original so that a conversion
+ error is reported rather than measured.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IconvBenchmark(VOID)
+{
+    LPTSTR WideBuffer;
+    LPTSTR RoundTripBuffer;
+    LPSTR NarrowBuffer;
+    DWORD NarrowLength;
+    DWORD NarrowBufferLength;
+    DWORD WideLength;
+    DWORD Iteration;
+    DWORD Index;
+    ICONV_BENCHMARK_TYPE Type;
+    LARGE_INTEGER Frequency;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    LONGLONG OutputTicks;
+    LONGLONG InputTicks;
+    DWORD OriginalOutputEncoding;
+    DWORD OriginalInputEncoding;
+    BOOL Result;
+    LPCTSTR TypeNames[IconvBenchmarkMaximum] = {_T("ascii"), _T("mixed"), _T("cjk")};
+
+    //
+    //  Every UTF16 character in the generated text is within the basic
+    //  multilingual plane, so needs at most three bytes in UTF8.
+    //
+
+    NarrowBufferLength = ICONV_BENCHMARK_CHARS * 3;
+
+    WideBuffer = YoriLibMalloc(ICONV_BENCHMARK_CHARS * sizeof(TCHAR));
+    RoundTripBuffer = YoriLibMalloc(ICONV_BENCHMARK_CHARS * sizeof(TCHAR));
+    NarrowBuffer = YoriLibMalloc(NarrowBufferLength);
+    if (WideBuffer == NULL || RoundTripBuffer == NULL || NarrowBuffer == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("iconv: out of memory\n"));
+        if (WideBuffer != NULL) {
+            YoriLibFree(WideBuffer);
+        }
+        if (RoundTripBuffer != NULL) {
+            YoriLibFree(RoundTripBuffer);
+        }
+        if (NarrowBuffer != NULL) {
+            YoriLibFree(NarrowBuffer);
+        }
+        return FALSE;
+    }
+
+    OriginalOutputEncoding = YoriLibGetMultibyteOutputEncoding();
+    OriginalInputEncoding = YoriLibGetMultibyteInputEncoding();
+    YoriLibSetMultibyteOutputEncoding(CP_UTF8);
+    YoriLibSetMultibyteInputEncoding(CP_UTF8);
+
+    QueryPerformanceFrequency(&Frequency);
+    Result = TRUE;
+
+    for (Type = IconvBenchmarkAscii; Type < IconvBenchmarkMaximum; Type++) {
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        IconvBenchmarkGenerate(Type, WideBuffer, ICONV_BENCHMARK_CHARS);
+
+        //
+        //  Measure UTF16 to UTF8, including sizing the output, since that
+        //  is what every caller of the conversion does.
+        //
+
+        NarrowLength = 0;
+        QueryPerformanceCounter(&StartTime);
+        for (Iteration = 0; Iteration < ICONV_BENCHMARK_ITERATIONS; Iteration++) {
+            NarrowLength = YoriLibGetMultibyteOutputSizeNeeded(WideBuffer, ICONV_BENCHMARK_CHARS);
+            ASSERT(NarrowLength <= NarrowBufferLength);
+            if (NarrowLength > NarrowBufferLength) {
+                NarrowLength = NarrowBufferLength;
+            }
+            YoriLibMultibyteOutput(WideBuffer, ICONV_BENCHMARK_CHARS, NarrowBuffer, NarrowLength);
+        }
+        QueryPerformanceCounter(&EndTime);
+        OutputTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+        //
+        //  Measure UTF8 to UTF16.
+        //
+
+        WideLength = 0;
+        QueryPerformanceCounter(&StartTime);
+        for (Iteration = 0; Iteration < ICONV_BENCHMARK_ITERATIONS; Iteration++) {
+            WideLength = YoriLibGetMultibyteInputSizeNeeded(NarrowBuffer, NarrowLength);
+            ASSERT(WideLength <= ICONV_BENCHMARK_CHARS);
+            if (WideLength > ICONV_BENCHMARK_CHARS) {
+                WideLength = ICONV_BENCHMARK_CHARS;
+            }
+            YoriLibMultibyteInput(NarrowBuffer, NarrowLength, RoundTripBuffer, WideLength);
+        }
+        QueryPerformanceCounter(&EndTime);
+        InputTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+        for (Index = 0; Index < WideLength; Index++) {
+            if (RoundTripBuffer[Index] != WideBuffer[Index]) {
+                break;
+            }
+        }
+
+        if (WideLength != ICONV_BENCHMARK_CHARS || Index != WideLength) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("iconv: %s text did not convert back to its original form at character %i\n"), TypeNames[Type], Index);
+            Result = FALSE;
+        }
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%s: utf16 to utf8 %lli MB/s, utf8 to utf16 %lli MB/s\n"),
+                      TypeNames[Type],
+                      IconvBenchmarkThroughput((DWORDLONG)ICONV_BENCHMARK_CHARS * sizeof(TCHAR) * ICONV_BENCHMARK_ITERATIONS, OutputTicks, Frequency.QuadPart),
+                      IconvBenchmarkThroughput((DWORDLONG)NarrowLength * ICONV_BENCHMARK_ITERATIONS, InputTicks, Frequency.QuadPart));
+    }
+
+    YoriLibSetMultibyteOutputEncoding(OriginalOutputEncoding);
+    YoriLibSetMultibyteInputEncoding(OriginalInputEncoding);
+
+    YoriLibFree(WideBuffer);
+    YoriLibFree(RoundTripBuffer);
+    YoriLibFree(NarrowBuffer);
+
+    return Result;
+}
 
 /**
  Parse a user specified argument into an encoding identifier.
@@ -373,6 +605,11 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("u")) == 0) {
                 IconvContext.LineEnding = _T("\n");
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
+                if (!IconvBenchmark()) {
+                    return EXIT_FAILURE;
+                }
+                return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 IconvContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -38,12 +38,14 @@ CHAR strIniToolHelpText[] =
         "INITOOL [-license]\n"
         "INITOOL -d <file> <section> [<key>]\n"
         "INITOOL -l <file> <section>\n"
+        "INITOOL -perf\n"
         "INITOOL -r <file> <section> <key>\n"
         "INITOOL -s <file>\n"
         "INITOOL -w <file> <section> <key> <value>\n"
         "\n"
         "   -d             Delete a specified key from an INI file\n"
         "   -l             List key/value pairs in a specified section from an INI file\n"
+        "   -perf          Measure the speed of the table used to find INI keys\n"
         "   -r             Read a specified key from an INI file\n"
         "   -s             List sections in an INI file\n"
         "   -w             Write a specified value to an INI file\n";
@@ -81,18 +83,26 @@ IniToolDeleteFromIniFile(
     )
 {
     YORI_STRING RealFileName;
+    PVOID IniDocument;
+    BOOL Result;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!WritePrivateProfileString(Section->StartOfString, (Key != NULL)?Key->StartOfString:NULL, NULL, RealFileName.StartOfString)) {
+    if (!YoriLibIniOpen(&RealFileName, &IniDocument)) {
         YoriLibFreeStringContents(&RealFileName);
         return FALSE;
     }
 
+    Result = FALSE;
+    if (YoriLibIniSetString(IniDocument, Section->StartOfString, (Key != NULL)?Key->StartOfString:NULL, NULL)) {
+        Result = YoriLibIniCommit(IniDocument);
+    }
+
+    YoriLibIniClose(IniDocument);
     YoriLibFreeStringContents(&RealFileName);
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -113,17 +123,25 @@ IniToolListSectionFromIniFile(
     YORI_STRING RealFileName;
     YORI_STRING Value;
     LPTSTR ThisVar;
+    PVOID IniDocument;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
+    if (!YoriLibIniOpen(&RealFileName, &IniDocument)) {
+        YoriLibFreeStringContents(&RealFileName);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&Value, 64 * 1024)) {
+        YoriLibIniClose(IniDocument);
         YoriLibFreeStringContents(&RealFileName);
         return FALSE;
     }
 
-    Value.LengthInChars = GetPrivateProfileSection(Section->StartOfString, Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
+    Value.LengthInChars = YoriLibIniGetSection(IniDocument, Section->StartOfString, Value.StartOfString, Value.LengthAllocated);
+    YoriLibIniClose(IniDocument);
     ThisVar = Value.StartOfString;
     while (*ThisVar != '\0') {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s\n"), ThisVar);
@@ -152,21 +170,25 @@ IniToolListSectionsFromIniFile(
     YORI_STRING RealFileName;
     YORI_STRING Value;
     LPTSTR ThisVar;
+    PVOID IniDocument;
 
-    if (DllKernel32.pGetPrivateProfileSectionNamesW == NULL) {
+    if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
+    if (!YoriLibIniOpen(&RealFileName, &IniDocument)) {
+        YoriLibFreeStringContents(&RealFileName);
         return FALSE;
     }
 
     if (!YoriLibAllocateString(&Value, 64 * 1024)) {
+        YoriLibIniClose(IniDocument);
         YoriLibFreeStringContents(&RealFileName);
         return FALSE;
     }
 
-    Value.LengthInChars = DllKernel32.pGetPrivateProfileSectionNamesW(Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
+    Value.LengthInChars = YoriLibIniGetSectionNames(IniDocument, Value.StartOfString, Value.LengthAllocated);
+    YoriLibIniClose(IniDocument);
     ThisVar = Value.StartOfString;
     while (*ThisVar != '\0') {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%s\n"), ThisVar);
@@ -200,17 +222,25 @@ IniToolReadFromIniFile(
 {
     YORI_STRING RealFileName;
     YORI_STRING Value;
+    PVOID IniDocument;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
+    if (!YoriLibIniOpen(&RealFileName, &IniDocument)) {
+        YoriLibFreeStringContents(&RealFileName);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&Value, 16 * 1024)) {
+        YoriLibIniClose(IniDocument);
         YoriLibFreeStringContents(&RealFileName);
         return FALSE;
     }
 
-    Value.LengthInChars = GetPrivateProfileString(Section->StartOfString, Key->StartOfString, _T(""), Value.StartOfString, Value.LengthAllocated, RealFileName.StartOfString);
+    Value.LengthInChars = YoriLibIniGetString(IniDocument, Section->StartOfString, Key->StartOfString, _T(""), Value.StartOfString, Value.LengthAllocated);
+    YoriLibIniClose(IniDocument);
     YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y"), &Value);
 
     YoriLibFreeStringContents(&RealFileName);
@@ -240,17 +270,227 @@ IniToolWriteToIniFile(
     )
 {
     YORI_STRING RealFileName;
+    PVOID IniDocument;
+    BOOL Result;
 
     if (!YoriLibUserStringToSingleFilePath(UserFileName, FALSE, &RealFileName)) {
         return FALSE;
     }
 
-    if (!WritePrivateProfileString(Section->StartOfString, Key->StartOfString, Value->StartOfString, RealFileName.StartOfString)) {
+    if (!YoriLibIniOpen(&RealFileName, &IniDocument)) {
         YoriLibFreeStringContents(&RealFileName);
         return FALSE;
     }
 
+    Result = FALSE;
+    if (YoriLibIniSetString(IniDocument, Section->StartOfString, Key->StartOfString, Value->StartOfString)) {
+        Result = YoriLibIniCommit(IniDocument);
+    }
+
+    YoriLibIniClose(IniDocument);
     YoriLibFreeStringContents(&RealFileName);
+    return Result;
+}
+
+/**
+ The number of characters in each key generated for the hash table
+ benchmark, including the NULL terminator.
+ */
+#define INITOOL_PERF_KEY_LENGTH (12)
+
+/**
+ A single entry inserted into a hash table by the benchmark.
+ */
+typedef struct _INITOOL_PERF_ENTRY {
+
+    /**
+     The entry within the hash table.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The key of the entry.
+     */
+    TCHAR Key[INITOOL_PERF_KEY_LENGTH];
+} INITOOL_PERF_ENTRY, *PINITOOL_PERF_ENTRY;
+
+/**
+ Convert a number of performance counter ticks spent on a number of
+ operations into nanoseconds per operation.
+
+ @param Ticks The number of performance counter ticks elapsed.
+
+ @param Frequency The number of performance counter ticks per second.
+
+ @param Count The number of operations performed.
+
+ @return The average time of each operation, in nanoseconds.
+ */
+LONGLONG
+IniToolPerfNanoseconds(
+    __in LONGLONG Ticks,
+    __in LONGLONG Frequency,
+    __in DWORD Count
+    )
+{
+    return Ticks * 1000000000 / Frequency / Count;
+}
+
+/**
+ Measure the time taken to insert, find, fail to find and remove a number of
+ generated keys in the hash table that indexes INI sections and keys, and
+ display the result.
+
+ @param KeyCount The number of keys to insert.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolPerfHashTable(
+    __in DWORD KeyCount
+    )
+{
+    PINITOOL_PERF_ENTRY Entries;
+    LPTSTR MissingKeys;
+    PYORI_HASH_TABLE HashTable;
+    YORI_STRING Key;
+    DWORD Index;
+    DWORD Found;
+    LARGE_INTEGER Frequency;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    LONGLONG InsertTicks;
+    LONGLONG HitTicks;
+    LONGLONG MissTicks;
+    LONGLONG RemoveTicks;
+    BOOL Result;
+
+    Entries = YoriLibMalloc(KeyCount * sizeof(INITOOL_PERF_ENTRY));
+    if (Entries == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: out of memory\n"));
+        return FALSE;
+    }
+
+    MissingKeys = YoriLibMalloc(KeyCount * INITOOL_PERF_KEY_LENGTH * sizeof(TCHAR));
+    if (MissingKeys == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: out of memory\n"));
+        YoriLibFree(Entries);
+        return FALSE;
+    }
+
+    //
+    //  Multiplying by an odd constant scrambles the order of the keys
+    //  while keeping every key unique.  Keys that are not found use the
+    //  numbers that follow the ones that are inserted.
+    //
+
+    for (Index = 0; Index < KeyCount; Index++) {
+        YoriLibSPrintf(Entries[Index].Key, _T("Key%08x"), Index * 2654435761u);
+        YoriLibSPrintf(&MissingKeys[Index * INITOOL_PERF_KEY_LENGTH], _T("Key%08x"), (Index + KeyCount) * 2654435761u);
+    }
+
+    //
+    //  Start from a small table so that growing it is part of the cost of
+    //  inserting, as it is for INI files.
+    //
+
+    HashTable = YoriLibAllocateHashTable(16);
+    if (HashTable == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: out of memory\n"));
+        YoriLibFree(MissingKeys);
+        YoriLibFree(Entries);
+        return FALSE;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    Result = TRUE;
+    YoriLibInitEmptyString(&Key);
+    Key.LengthInChars = INITOOL_PERF_KEY_LENGTH - 1;
+
+    QueryPerformanceCounter(&StartTime);
+    for (Index = 0; Index < KeyCount; Index++) {
+        Key.StartOfString = Entries[Index].Key;
+        if (!YoriLibHashInsertByKey(HashTable, &Key, &Entries[Index], &Entries[Index].HashEntry)) {
+            break;
+        }
+    }
+    QueryPerformanceCounter(&EndTime);
+    InsertTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    if (Index < KeyCount) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: could not insert %i keys\n"), KeyCount);
+        KeyCount = Index;
+        Result = FALSE;
+    }
+
+    Found = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (Index = 0; Index < KeyCount; Index++) {
+        Key.StartOfString = Entries[Index].Key;
+        if (YoriLibHashLookupByKey(HashTable, &Key) != NULL) {
+            Found++;
+        }
+    }
+    QueryPerformanceCounter(&EndTime);
+    HitTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    QueryPerformanceCounter(&StartTime);
+    for (Index = 0; Index < KeyCount; Index++) {
+        Key.StartOfString = &MissingKeys[Index * INITOOL_PERF_KEY_LENGTH];
+        if (YoriLibHashLookupByKey(HashTable, &Key) != NULL) {
+            Found++;
+        }
+    }
+    QueryPerformanceCounter(&EndTime);
+    MissTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    QueryPerformanceCounter(&StartTime);
+    for (Index = 0; Index < KeyCount; Index++) {
+        YoriLibHashRemoveByEntry(&Entries[Index].HashEntry);
+    }
+    QueryPerformanceCounter(&EndTime);
+    RemoveTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    if (Found != KeyCount) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("initool: found %i of %i keys\n"), Found, KeyCount);
+        Result = FALSE;
+    }
+
+    if (KeyCount > 0) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                      _T("%i keys: insert %lli ns, find %lli ns, not found %lli ns, remove %lli ns\n"),
+                      KeyCount,
+                      IniToolPerfNanoseconds(InsertTicks, Frequency.QuadPart, KeyCount),
+                      IniToolPerfNanoseconds(HitTicks, Frequency.QuadPart, KeyCount),
+                      IniToolPerfNanoseconds(MissTicks, Frequency.QuadPart, KeyCount),
+                      IniToolPerfNanoseconds(RemoveTicks, Frequency.QuadPart, KeyCount));
+    }
+
+    YoriLibFreeEmptyHashTable(HashTable);
+    YoriLibFree(MissingKeys);
+    YoriLibFree(Entries);
+
+    return Result;
+}
+
+/**
+ Measure the hash table that indexes INI sections and keys with one
+ thousand, one hundred thousand and one million keys.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+IniToolPerf(VOID)
+{
+    DWORD KeyCounts[] = {1000, 100000, 1000000};
+    DWORD Index;
+
+    for (Index = 0; Index < sizeof(KeyCounts)/sizeof(KeyCounts[0]); Index++) {
+        if (!IniToolPerfHashTable(KeyCounts[Index])) {
+            return FALSE;
+        }
+    }
+
     return TRUE;
 }
 
@@ -263,7 +503,8 @@ typedef enum _INITOOL_OPERATION {
     IniToolOpReadValue = 2,
     IniToolOpDeleteValue = 3,
     IniToolOpListSection = 4,
-    IniToolOpListSections = 5
+    IniToolOpListSections = 5,
+    IniToolOpPerf = 6
 } INITOOL_OPERATION;
 
 #ifdef YORI_BUILTIN
@@ -321,6 +562,9 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("l")) == 0) {
                 Op = IniToolOpListSection;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
+                Op = IniToolOpPerf;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("r")) == 0) {
                 Op = IniToolOpReadValue;
                 ArgumentUnderstood = TRUE;
@@ -403,6 +647,10 @@ ENTRYPOINT(
         if (!IniToolListSectionsFromIniFile(&ArgV[StartArg])) {
             return EXIT_FAILURE;
         }
+    } else if (Op == IniToolOpPerf) {
+        if (!IniToolPerf()) {
+            return EXIT_FAILURE;
+        }
     }
 
     return EXIT_SUCCESS;
@@ -62,6 +62,7 @@ VOID __cdecl CONSOLE_CRT_ENTRYPOINT()
         ExitProcess(EXIT_FAILURE);
     }
     ExitCode = CONSOLE_USER_ENTRYPOINT(ArgC, ArgV);
+    YoriLibOutputDisableBuffering();
     for (Index = 0; Index < ArgC; Index++) {
         YoriLibFreeStringContents(&ArgV[Index]);
     }
@@ -83,6 +83,33 @@ typedef struct _YORILIB_FOREACHFILE_CONTEXT {
      */
     YORI_STRING RecurseCriteria;
 
+    /**
+     When enumerating in parallel, the list of subdirectories of this
+     directory which have been queued to be enumerated.  Paired with
+     YORILIB_FOREACHFILE_CHILD::SiblingList.
+     */
+    YORI_LIST_ENTRY ChildList;
+
+    /**
+     When enumerating in parallel, the first entry in ChildList which may
+     not have been started yet.  Children are started in the order they
+     are queued, so all entries before this one have been started.
+     */
+    PYORI_LIST_ENTRY NextChild;
+
+    /**
+     When enumerating in parallel, the number of entries in ChildList which
+     have not completed.
+     */
+    DWORD ChildrenOutstanding;
+
+    /**
+     When enumerating in parallel, an event which is signalled when
+     ChildrenOutstanding reaches zero.  This is only created when a child is
+     queued.
+     */
+    HANDLE ChildEvent;
+
     /**
      The result of the Win32 FindFirstFile operation for the current
      file.
@@ -91,6 +118,486 @@ typedef struct _YORILIB_FOREACHFILE_CONTEXT {
 
 } YORILIB_FOREACHFILE_CONTEXT, *PYORILIB_FOREACHFILE_CONTEXT;
 
+/**
+ The maximum number of threads to enumerate subdirectories with.
+ */
+#define YORILIB_FOREACHFILE_MAX_THREADS (32)
+
+/**
+ State shared by all threads when enumerating a directory tree in parallel.
+ */
+typedef struct _YORILIB_FOREACHFILE_PARALLEL {
+
+    /**
+     A mutex protecting PendingList and the child state of each directory.
+     */
+    HANDLE Mutex;
+
+    /**
+     A mutex which is held while invoking a callback, if the caller
+     requested that callbacks be serialized.  NULL if callbacks can be
+     invoked concurrently.
+     */
+    HANDLE CallbackMutex;
+
+    /**
+     A semaphore which is released once for each subdirectory queued.
+     */
+    HANDLE WorkAvailable;
+
+    /**
+     An event which is set to indicate that threads should terminate.
+     */
+    HANDLE ShutdownEvent;
+
+    /**
+     The list of subdirectories which have not yet been started, in the
+     order they were found.  Paired with
+     YORILIB_FOREACHFILE_CHILD::PendingList.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     Set to TRUE if any callback requested that enumeration stop, so that
+     other threads stop enumerating as soon as possible.
+     */
+    BOOL Abort;
+
+    /**
+     The match flags for the enumeration.
+     */
+    DWORD MatchFlags;
+
+    /**
+     The callback to invoke on each match.
+     */
+    PYORILIB_FILE_ENUM_FN Callback;
+
+    /**
+     Optionally points to a function to invoke if a directory cannot be
+     enumerated.
+     */
+    PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback;
+
+    /**
+     Caller provided context to pass to the callbacks.
+     */
+    PVOID Context;
+
+    /**
+     The number of entries in Threads which have been created.
+     */
+    DWORD ThreadCount;
+
+    /**
+     Handles to the threads enumerating subdirectories.
+     */
+    HANDLE Threads[YORILIB_FOREACHFILE_MAX_THREADS];
+
+} YORILIB_FOREACHFILE_PARALLEL, *PYORILIB_FOREACHFILE_PARALLEL;
+
+/**
+ A subdirectory which has been queued to be enumerated in parallel.
+ */
+typedef struct _YORILIB_FOREACHFILE_CHILD {
+
+    /**
+     The list of subdirectories which have not yet been started.  Paired
+     with YORILIB_FOREACHFILE_PARALLEL::PendingList.
+     */
+    YORI_LIST_ENTRY PendingList;
+
+    /**
+     The list of subdirectories of the parent directory.  Paired with
+     YORILIB_FOREACHFILE_CONTEXT::ChildList.
+     */
+    YORI_LIST_ENTRY SiblingList;
+
+    /**
+     Pointer to the enumeration state of the parent directory, which waits
+     for this subdirectory to complete.
+     */
+    PYORILIB_FOREACHFILE_CONTEXT Parent;
+
+    /**
+     The criteria to enumerate within the subdirectory.
+     */
+    YORI_STRING Criteria;
+
+    /**
+     The recursion depth of the subdirectory.
+     */
+    DWORD Depth;
+
+    /**
+     Set to TRUE when a thread has started enumerating the subdirectory.
+     */
+    BOOLEAN Started;
+
+    /**
+     The result of enumerating the subdirectory.
+     */
+    BOOLEAN Result;
+
+} YORILIB_FOREACHFILE_CHILD, *PYORILIB_FOREACHFILE_CHILD;
+
+__success(return)
+BOOL
+YoriLibForEachFileEnum(
+    __in PYORI_STRING FileSpec,
+    __in DWORD MatchFlags,
+    __in DWORD Depth,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
+    );
+
+/**
+ Enumerate a subdirectory which was queued for parallel enumeration, and
+ indicate its completion to the parent directory.
+
+ @param Parallel Pointer to the parallel enumeration state.
+
+ @param Child Pointer to the subdirectory to enumerate.  This has been
+        removed from the pending list by the caller.
+ */
+VOID
+YoriLibForEachFileRunChild(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORILIB_FOREACHFILE_CHILD Child
+    )
+{
+    BOOL Result;
+    PYORILIB_FOREACHFILE_CONTEXT Parent;
+
+    Result = FALSE;
+    if (!Parallel->Abort) {
+        Result = YoriLibForEachFileEnum(&Child->Criteria, Parallel->MatchFlags, Child->Depth, Parallel->Callback, Parallel->ErrorCallback, Parallel->Context, Parallel);
+        if (!Result) {
+            Parallel->Abort = TRUE;
+        }
+    }
+
+    Parent = Child->Parent;
+    WaitForSingleObject(Parallel->Mutex, INFINITE);
+    Child->Result = (BOOLEAN)Result;
+    ASSERT(Parent->ChildrenOutstanding > 0);
+    Parent->ChildrenOutstanding--;
+    if (Parent->ChildrenOutstanding == 0) {
+        SetEvent(Parent->ChildEvent);
+    }
+    ReleaseMutex(Parallel->Mutex);
+}
+
+/**
+ Queue a subdirectory to be enumerated in parallel.
+
+ @param Parallel Pointer to the parallel enumeration state.
+
+ @param ForEachContext Pointer to the enumeration state of the parent
+        directory.
+
+ @param Criteria Pointer to the criteria to enumerate within the
+        subdirectory.  On success, ownership of this allocation is
+        transferred to the queued subdirectory and the string is
+        reinitialized.
+
+ @param Depth The recursion depth of the subdirectory.
+
+ @return TRUE to indicate the subdirectory was queued, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriLibForEachFileQueueChild(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORILIB_FOREACHFILE_CONTEXT ForEachContext,
+    __inout PYORI_STRING Criteria,
+    __in DWORD Depth
+    )
+{
+    PYORILIB_FOREACHFILE_CHILD Child;
+
+    if (ForEachContext->ChildEvent == NULL) {
+        ForEachContext->ChildEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (ForEachContext->ChildEvent == NULL) {
+            return FALSE;
+        }
+    }
+
+    Child = YoriLibMalloc(sizeof(YORILIB_FOREACHFILE_CHILD));
+    if (Child == NULL) {
+        return FALSE;
+    }
+
+    Child->Parent = ForEachContext;
+    memcpy(&Child->Criteria, Criteria, sizeof(YORI_STRING));
+    YoriLibInitEmptyString(Criteria);
+    Child->Depth = Depth;
+    Child->Started = FALSE;
+    Child->Result = FALSE;
+
+    WaitForSingleObject(Parallel->Mutex, INFINITE);
+    YoriLibAppendList(&Parallel->PendingList, &Child->PendingList);
+    YoriLibAppendList(&ForEachContext->ChildList, &Child->SiblingList);
+    if (ForEachContext->NextChild == &ForEachContext->ChildList) {
+        ForEachContext->NextChild = &Child->SiblingList;
+    }
+    ForEachContext->ChildrenOutstanding++;
+    ReleaseMutex(Parallel->Mutex);
+
+    ReleaseSemaphore(Parallel->WorkAvailable, 1, NULL);
+    return TRUE;
+}
+
+/**
+ Wait for all subdirectories queued by a directory to be enumerated.  While
+ waiting, this thread enumerates any of the subdirectories that have not
+ been started by another thread, so that a directory never waits for work
+ that nobody is performing, and the nesting of this thread's stack is no
+ deeper than the directory tree.
+
+ @param Parallel Pointer to the parallel enumeration state.
+
+ @param ForEachContext Pointer to the enumeration state of the parent
+        directory.
+
+ @return TRUE if all subdirectories were enumerated successfully, FALSE if
+         any failed or requested that enumeration stop.
+ */
+__success(return)
+BOOL
+YoriLibForEachFileWaitForChildren(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in PYORILIB_FOREACHFILE_CONTEXT ForEachContext
+    )
+{
+    PYORILIB_FOREACHFILE_CHILD Child;
+    PYORI_LIST_ENTRY ListEntry;
+    BOOL Result;
+
+    while (TRUE) {
+        Child = NULL;
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        while (ForEachContext->NextChild != &ForEachContext->ChildList) {
+            Child = CONTAINING_RECORD(ForEachContext->NextChild, YORILIB_FOREACHFILE_CHILD, SiblingList);
+            ForEachContext->NextChild = ForEachContext->NextChild->Next;
+            if (!Child->Started) {
+                Child->Started = TRUE;
+                YoriLibRemoveListItem(&Child->PendingList);
+                break;
+            }
+            Child = NULL;
+        }
+
+        if (Child == NULL && ForEachContext->ChildrenOutstanding == 0) {
+            ReleaseMutex(Parallel->Mutex);
+            break;
+        }
+        ReleaseMutex(Parallel->Mutex);
+
+        if (Child != NULL) {
+            YoriLibForEachFileRunChild(Parallel, Child);
+        } else {
+            WaitForSingleObject(ForEachContext->ChildEvent, INFINITE);
+        }
+    }
+
+    Result = TRUE;
+    ListEntry = YoriLibGetNextListEntry(&ForEachContext->ChildList, NULL);
+    while (ListEntry != NULL) {
+        Child = CONTAINING_RECORD(ListEntry, YORILIB_FOREACHFILE_CHILD, SiblingList);
+        ListEntry = YoriLibGetNextListEntry(&ForEachContext->ChildList, ListEntry);
+        if (!Child->Result) {
+            Result = FALSE;
+        }
+        YoriLibRemoveListItem(&Child->SiblingList);
+        YoriLibFreeStringContents(&Child->Criteria);
+        YoriLibFree(Child);
+    }
+
+    ForEachContext->NextChild = &ForEachContext->ChildList;
+    return Result;
+}
+
+/**
+ A thread which enumerates subdirectories queued for parallel enumeration.
+
+ @param Context Pointer to the parallel enumeration state.
+
+ @return Thread exit code, ignored.
+ */
+DWORD WINAPI
+YoriLibForEachFileWorker(
+    __in LPVOID Context
+    )
+{
+    PYORILIB_FOREACHFILE_PARALLEL Parallel = (PYORILIB_FOREACHFILE_PARALLEL)Context;
+    PYORILIB_FOREACHFILE_CHILD Child;
+    HANDLE WaitHandles[2];
+    DWORD FoundEvent;
+
+    WaitHandles[0] = Parallel->WorkAvailable;
+    WaitHandles[1] = Parallel->ShutdownEvent;
+
+    while (TRUE) {
+
+        //
+        //  Wait for an indication of more work or shutdown.  Note that a
+        //  parent directory may have started the subdirectory that this
+        //  wakeup refers to, so the list may be empty.
+        //
+
+        FoundEvent = WaitForMultipleObjects(2, WaitHandles, FALSE, INFINITE);
+        if (FoundEvent != WAIT_OBJECT_0) {
+            break;
+        }
+
+        Child = NULL;
+        WaitForSingleObject(Parallel->Mutex, INFINITE);
+        if (!YoriLibIsListEmpty(&Parallel->PendingList)) {
+            Child = CONTAINING_RECORD(Parallel->PendingList.Next, YORILIB_FOREACHFILE_CHILD, PendingList);
+            Child->Started = TRUE;
+            YoriLibRemoveListItem(&Child->PendingList);
+        }
+        ReleaseMutex(Parallel->Mutex);
+
+        if (Child != NULL) {
+            YoriLibForEachFileRunChild(Parallel, Child);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ Terminate the threads used for parallel enumeration and free the
+ associated state.  The structure itself is not freed.
+
+ @param Parallel Pointer to the parallel enumeration state.
+ */
+VOID
+YoriLibForEachFileStopParallel(
+    __in PYORILIB_FOREACHFILE_PARALLEL Parallel
+    )
+{
+    DWORD Index;
+
+    if (Parallel->ThreadCount > 0) {
+        SetEvent(Parallel->ShutdownEvent);
+        WaitForMultipleObjects(Parallel->ThreadCount, Parallel->Threads, TRUE, INFINITE);
+        for (Index = 0; Index < Parallel->ThreadCount; Index++) {
+            CloseHandle(Parallel->Threads[Index]);
+            Parallel->Threads[Index] = NULL;
+        }
+        Parallel->ThreadCount = 0;
+    }
+
+    ASSERT(YoriLibIsListEmpty(&Parallel->PendingList));
+
+    if (Parallel->Mutex != NULL) {
+        CloseHandle(Parallel->Mutex);
+        Parallel->Mutex = NULL;
+    }
+    if (Parallel->CallbackMutex != NULL) {
+        CloseHandle(Parallel->CallbackMutex);
+        Parallel->CallbackMutex = NULL;
+    }
+    if (Parallel->WorkAvailable != NULL) {
+        CloseHandle(Parallel->WorkAvailable);
+        Parallel->WorkAvailable = NULL;
+    }
+    if (Parallel->ShutdownEvent != NULL) {
+        CloseHandle(Parallel->ShutdownEvent);
+        Parallel->ShutdownEvent = NULL;
+    }
+}
+
+/**
+ Create the threads used for parallel enumeration.
+
+ @param Parallel Pointer to the parallel enumeration state to initialize.
+
+ @param MatchFlags Specifies the behavior of the match.
+
+ @param Callback The callback to invoke on each match.
+
+ @param ErrorCallback Optionally points to a function to invoke if a
+        directory cannot be enumerated.
+
+ @param Context Caller provided context to pass to the callbacks.
+
+ @return TRUE to indicate parallel enumeration can be performed, FALSE if
+         the enumeration should be performed serially.
+ */
+__success(return)
+BOOL
+YoriLibForEachFileStartParallel(
+    __out PYORILIB_FOREACHFILE_PARALLEL Parallel,
+    __in DWORD MatchFlags,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context
+    )
+{
+    SYSTEM_INFO SystemInfo;
+    DWORD ThreadsWanted;
+    DWORD ThreadId;
+
+    ZeroMemory(Parallel, sizeof(YORILIB_FOREACHFILE_PARALLEL));
+    YoriLibInitializeListHead(&Parallel->PendingList);
+    Parallel->MatchFlags = MatchFlags;
+    Parallel->Callback = Callback;
+    Parallel->ErrorCallback = ErrorCallback;
+    Parallel->Context = Context;
+
+    Parallel->Mutex = CreateMutex(NULL, FALSE, NULL);
+    Parallel->WorkAvailable = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+    Parallel->ShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (Parallel->Mutex == NULL ||
+        Parallel->WorkAvailable == NULL ||
+        Parallel->ShutdownEvent == NULL) {
+
+        YoriLibForEachFileStopParallel(Parallel);
+        return FALSE;
+    }
+
+    if (MatchFlags & YORILIB_FILEENUM_SERIALIZE_CALLBACKS) {
+        Parallel->CallbackMutex = CreateMutex(NULL, FALSE, NULL);
+        if (Parallel->CallbackMutex == NULL) {
+            YoriLibForEachFileStopParallel(Parallel);
+            return FALSE;
+        }
+    }
+
+    //
+    //  These threads spend most of their time waiting for the file system,
+    //  so use more of them than there are processors.  The calling thread
+    //  also enumerates.
+    //
+
+    GetSystemInfo(&SystemInfo);
+    ThreadsWanted = SystemInfo.dwNumberOfProcessors * 2;
+    if (ThreadsWanted > YORILIB_FOREACHFILE_MAX_THREADS) {
+        ThreadsWanted = YORILIB_FOREACHFILE_MAX_THREADS;
+    }
+
+    while (Parallel->ThreadCount < ThreadsWanted) {
+        Parallel->Threads[Parallel->ThreadCount] = CreateThread(NULL, 0, YoriLibForEachFileWorker, Parallel, 0, &ThreadId);
+        if (Parallel->Threads[Parallel->ThreadCount] == NULL) {
+            break;
+        }
+        Parallel->ThreadCount++;
+    }
+
+    if (Parallel->ThreadCount == 0) {
+        YoriLibForEachFileStopParallel(Parallel);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Call a callback for every file matching a specified file pattern.
 
@@ -109,6 +616,10 @@ typedef struct _YORILIB_FOREACHFILE_CONTEXT {
         about failures and wants to silently continue.
 
  @param Context Caller provided context to pass to the callback.
+
+ @param Parallel If subdirectories should be enumerated in parallel, points
+        to the state shared by all enumerating threads.  If NULL,
+        subdirectories are enumerated recursively on this thread.
  */
 __success(return)
 BOOL
@@ -118,7 +629,8 @@ YoriLibForEachFileEnum(
     __in DWORD Depth,
     __in PYORILIB_FILE_ENUM_FN Callback,
     __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
-    __in_opt PVOID Context
+    __in_opt PVOID Context,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
     )
 {
     HANDLE hFind;
@@ -128,6 +640,7 @@ YoriLibForEachFileEnum(
     BOOLEAN Result;
     BOOLEAN RecursePhase;
     BOOLEAN IsLink;
+    BOOL CallbackResult;
     PYORILIB_FOREACHFILE_CONTEXT ForEachContext = NULL;
 
     Result = TRUE;
@@ -142,6 +655,10 @@ YoriLibForEachFileEnum(
         return FALSE;
     }
     YoriLibInitEmptyString(&ForEachContext->RecurseCriteria);
+    YoriLibInitializeListHead(&ForEachContext->ChildList);
+    ForEachContext->NextChild = &ForEachContext->ChildList;
+    ForEachContext->ChildrenOutstanding = 0;
+    ForEachContext->ChildEvent = NULL;
 
     //
     //  This is currently only needed for the GetFileAttributes call.  It may
@@ -371,7 +888,15 @@ YoriLibForEachFileEnum(
 
         if (hFind == INVALID_HANDLE_VALUE) {
             if (ErrorCallback != NULL) {
-                if (!ErrorCallback(&ForEachContext->FullPath, GetLastError(), Depth, Context)) {
+                DWORD LastError = GetLastError();
+                if (Parallel != NULL && Parallel->CallbackMutex != NULL) {
+                    WaitForSingleObject(Parallel->CallbackMutex, INFINITE);
+                }
+                CallbackResult = ErrorCallback(&ForEachContext->FullPath, LastError, Depth, Context);
+                if (Parallel != NULL && Parallel->CallbackMutex != NULL) {
+                    ReleaseMutex(Parallel->CallbackMutex);
+                }
+                if (!CallbackResult) {
                     Result = FALSE;
                 }
                 break;
@@ -379,6 +904,11 @@ YoriLibForEachFileEnum(
         } else {
             do {
 
+                if (Parallel != NULL && Parallel->Abort) {
+                    Result = FALSE;
+                    break;
+                }
+
                 ReportObject = TRUE;
                 DotFile = FALSE;
 
@@ -483,7 +1013,18 @@ YoriLibForEachFileEnum(
                         ForEachContext->RecurseCriteria.StartOfString[ForEachContext->RecurseCriteria.LengthInChars] = '\0';
                     }
 
-                    if (!YoriLibForEachFileEnum(&ForEachContext->RecurseCriteria, MatchFlags, Depth + 1, Callback, ErrorCallback, Context)) {
+                    //
+                    //  When enumerating in parallel, queue the subdirectory
+                    //  so that any thread can enumerate it.  This directory
+                    //  waits for it to complete at the end of this phase.
+                    //
+
+                    if (Parallel != NULL) {
+                        if (!YoriLibForEachFileQueueChild(Parallel, ForEachContext, &ForEachContext->RecurseCriteria, Depth + 1)) {
+                            Result = FALSE;
+                            break;
+                        }
+                    } else if (!YoriLibForEachFileEnum(&ForEachContext->RecurseCriteria, MatchFlags, Depth + 1, Callback, ErrorCallback, Context, NULL)) {
                         Result = FALSE;
                         break;
                     }
@@ -505,7 +1046,14 @@ YoriLibForEachFileEnum(
 
                     ForEachContext->FullPath.LengthInChars = YoriLibSPrintfS(ForEachContext->FullPath.StartOfString, ForEachContext->FullPath.LengthAllocated, _T("%y\\%s"), &ForEachContext->ParentFullPath, ForEachContext->FileInfo.cFileName);
 
-                    if (!Callback(&ForEachContext->FullPath, &ForEachContext->FileInfo, Depth, Context)) {
+                    if (Parallel != NULL && Parallel->CallbackMutex != NULL) {
+                        WaitForSingleObject(Parallel->CallbackMutex, INFINITE);
+                    }
+                    CallbackResult = Callback(&ForEachContext->FullPath, &ForEachContext->FileInfo, Depth, Context);
+                    if (Parallel != NULL && Parallel->CallbackMutex != NULL) {
+                        ReleaseMutex(Parallel->CallbackMutex);
+                    }
+                    if (!CallbackResult) {
                         Result = FALSE;
                         break;
                     }
@@ -524,6 +1072,21 @@ YoriLibForEachFileEnum(
                 FindClose(hFind);
             }
 
+            //
+            //  Subdirectories queued for parallel enumeration must complete
+            //  before this phase is complete, so that results from this
+            //  directory are reported after its children for
+            //  YORILIB_FILEENUM_RECURSE_BEFORE_RETURN, and so that this
+            //  function returns only once the whole tree has been
+            //  enumerated.
+            //
+
+            if (Parallel != NULL && !YoriLibIsListEmpty(&ForEachContext->ChildList)) {
+                if (!YoriLibForEachFileWaitForChildren(Parallel, ForEachContext)) {
+                    Result = FALSE;
+                }
+            }
+
             if (Result == FALSE) {
                 break;
             }
@@ -533,6 +1096,9 @@ YoriLibForEachFileEnum(
     YoriLibFreeStringContents(&ForEachContext->EffectiveFileSpec);
     YoriLibFreeStringContents(&ForEachContext->ParentFullPath);
     YoriLibFreeStringContents(&ForEachContext->FullPath);
+    if (ForEachContext->ChildEvent != NULL) {
+        CloseHandle(ForEachContext->ChildEvent);
+    }
     YoriLibFree(ForEachContext);
 
     return Result;
@@ -559,17 +1125,21 @@ YoriLibForEachFileEnum(
 
  @param Context Caller provided context to pass to the callback.
 
+ @param Parallel If subdirectories should be enumerated in parallel, points
+        to the state shared by all enumerating threads.
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriLibForEachFile(
+YoriLibForEachFileExpand(
     __in PYORI_STRING FileSpec,
     __in DWORD MatchFlags,
     __in DWORD Depth,
     __in PYORILIB_FILE_ENUM_FN Callback,
     __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
-    __in_opt PVOID Context
+    __in_opt PVOID Context,
+    __in_opt PYORILIB_FOREACHFILE_PARALLEL Parallel
     )
 {
     YORI_STRING BeforeOperator;
@@ -581,7 +1151,7 @@ YoriLibForEachFile(
     BOOL SingleCharMode;
 
     if (MatchFlags & YORILIB_FILEENUM_BASIC_EXPANSION) {
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
     }
 
     SingleCharMode = FALSE;
@@ -596,12 +1166,12 @@ YoriLibForEachFile(
 
         if (YoriLibExpandHomeDirectories(FileSpec, &NewFileSpec)) {
             BOOL Result;
-            Result = YoriLibForEachFileEnum(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+            Result = YoriLibForEachFileEnum(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
             YoriLibFreeStringContents(&NewFileSpec);
             return Result;
         }
 
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
     }
 
     YoriLibInitEmptyString(&BeforeOperator);
@@ -620,7 +1190,7 @@ YoriLibForEachFile(
 
     CharsToOperator = YoriLibCountStringNotContainingChars(&SubstituteValues, SingleCharMode?_T("]"):_T("}"));
     if (CharsToOperator == SubstituteValues.LengthInChars) {
-        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context);
+        return YoriLibForEachFileEnum(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel);
     }
 
     AfterOperator.StartOfString = &SubstituteValues.StartOfString[CharsToOperator + 1];
@@ -640,7 +1210,7 @@ YoriLibForEachFile(
 
             YoriLibYPrintf(&NewFileSpec, _T("%y%y%y"), &BeforeOperator, &MatchValue, &AfterOperator);
 
-            if (!YoriLibForEachFile(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context)) {
+            if (!YoriLibForEachFileExpand(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel)) {
                 YoriLibFreeStringContents(&NewFileSpec);
                 return FALSE;
             }
@@ -667,7 +1237,7 @@ YoriLibForEachFile(
 
             YoriLibYPrintf(&NewFileSpec, _T("%y%y%y"), &BeforeOperator, &MatchValue, &AfterOperator);
 
-            if (!YoriLibForEachFile(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context)) {
+            if (!YoriLibForEachFileExpand(&NewFileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, Parallel)) {
                 YoriLibFreeStringContents(&NewFileSpec);
                 return FALSE;
             }
@@ -686,6 +1256,63 @@ YoriLibForEachFile(
     return TRUE;
 }
 
+/**
+ Enumerate the set of possible files matching a user specified pattern.
+ This function is responsible for expanding Yori defined sequences, including
+ {}, [], and ~ operators.
+
+ If YORILIB_FILEENUM_PARALLEL is specified along with a recursive
+ enumeration, subdirectories are enumerated by a pool of threads, and the
+ callbacks are invoked from any of those threads.  Results within a
+ directory are reported in order, and the recursion order between a
+ directory and its children is preserved, but results from different
+ directories are interleaved arbitrarily.
+
+ @param FileSpec The user provided file specification to enumerate matches on.
+
+ @param MatchFlags Specifies the behavior of the match, including whether
+        it should be applied recursively and the recursing behavior.
+
+ @param Depth Indicates the current recursion depth.  If this function is
+        reentered, this value is incremented.
+
+ @param Callback The callback to invoke on each match.
+
+ @param ErrorCallback Optionally points to a function to invoke if a
+        directory cannot be enumerated.  If NULL, the caller does not care
+        about failures and wants to silently continue.
+
+ @param Context Caller provided context to pass to the callback.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibForEachFile(
+    __in PYORI_STRING FileSpec,
+    __in DWORD MatchFlags,
+    __in DWORD Depth,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in_opt PYORILIB_FILE_ENUM_ERROR_FN ErrorCallback,
+    __in_opt PVOID Context
+    )
+{
+    YORILIB_FOREACHFILE_PARALLEL Parallel;
+    BOOL Result;
+
+    if ((MatchFlags & YORILIB_FILEENUM_PARALLEL) != 0 &&
+        (MatchFlags & (YORILIB_FILEENUM_RECURSE_AFTER_RETURN | YORILIB_FILEENUM_RECURSE_BEFORE_RETURN)) != 0) {
+
+        if (YoriLibForEachFileStartParallel(&Parallel, MatchFlags, Callback, ErrorCallback, Context)) {
+            Result = YoriLibForEachFileExpand(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, &Parallel);
+            YoriLibForEachFileStopParallel(&Parallel);
+            return Result;
+        }
+    }
+
+    return YoriLibForEachFileExpand(FileSpec, MatchFlags, Depth, Callback, ErrorCallback, Context, NULL);
+}
+
 /**
  Compare a file name against a wildcard criteria to see if it matches.
 
@@ -0,0 +1,239 @@
+/**
+ * @file lib/filemap.c
+ *
+ * Yori routines to read files by mapping them into memory
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ The alignment of file offsets that views can be mapped from.  This is the
+ allocation granularity, which is 64Kb on all versions of Windows.
+ */
+#define YORI_LIB_MAPPED_INPUT_ALIGNMENT (0x10000)
+
+/**
+ The number of bytes to map at a time.  Views are kept small enough that a
+ 32 bit process can always find address space for one, and large enough that
+ the cost of mapping each view is insignificant.
+ */
+#define YORI_LIB_MAPPED_INPUT_VIEW_SIZE (32 * 1024 * 1024)
+
+/**
+ Prepare to read a file by mapping it into memory.  This is only possible
+ for regular files; if the handle refers to a pipe or device, or the file
+ cannot be mapped, this function fails and the caller is expected to read
+ the handle with ReadFile instead.  Data is returned starting from the
+ current file position.
+
+ An error reading a mapped view is raised as an exception when the data is
+ accessed rather than returned from a call, and these programs have no
+ exception handler to catch it.  Files are therefore only mapped if they
+ are on a local, non-removable device, where a read error indicates failing
+ hardware rather than a network disconnect or removed media.  Other files
+ are read with ReadFile so errors are reported normally.
+
+ @param FileHandle Handle to the file to read.
+
+ @param MappedInput On successful completion, populated with the state
+        needed to read the file.  The caller should call
+        @ref YoriLibMappedInputClose when it is no longer needed.
+
+ @return TRUE to indicate the file can be read by mapping it, FALSE if the
+         caller should read the handle with ReadFile.
+ */
+__success(return)
+BOOL
+YoriLibMappedInputOpen(
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_MAPPED_INPUT MappedInput
+    )
+{
+    DWORD LastError;
+    IO_STATUS_BLOCK IoStatus;
+    YORI_FILE_FS_DEVICE_INFORMATION DeviceInfo;
+
+    ZeroMemory(MappedInput, sizeof(YORI_LIB_MAPPED_INPUT));
+
+    if (GetFileType(FileHandle) != FILE_TYPE_DISK) {
+        return FALSE;
+    }
+
+    YoriLibLoadNtDllFunctions();
+    if (DllNtDll.pNtQueryVolumeInformationFile == NULL) {
+        return FALSE;
+    }
+
+    if (DllNtDll.pNtQueryVolumeInformationFile(FileHandle, &IoStatus, &DeviceInfo, sizeof(DeviceInfo), FileFsDeviceInformation) != 0) {
+        return FALSE;
+    }
+
+    if (DeviceInfo.Characteristics & (FILE_REMOVABLE_MEDIA | FILE_REMOTE_DEVICE)) {
+        return FALSE;
+    }
+
+    MappedInput->FileSize.LowPart = GetFileSize(FileHandle, (LPDWORD)&MappedInput->FileSize.HighPart);
+    if (MappedInput->FileSize.LowPart == INVALID_FILE_SIZE) {
+        LastError = GetLastError();
+        if (LastError != NO_ERROR) {
+            return FALSE;
+        }
+    }
+
+    MappedInput->CurrentOffset.HighPart = 0;
+    MappedInput->CurrentOffset.LowPart = SetFilePointer(FileHandle, 0, &MappedInput->CurrentOffset.HighPart, FILE_CURRENT);
+    if (MappedInput->CurrentOffset.LowPart == INVALID_SET_FILE_POINTER) {
+        LastError = GetLastError();
+        if (LastError != NO_ERROR) {
+            return FALSE;
+        }
+    }
+
+    //
+    //  Empty files cannot be mapped, and there is nothing to gain from
+    //  mapping a file which has already been read.
+    //
+
+    if (MappedInput->CurrentOffset.QuadPart >= MappedInput->FileSize.QuadPart) {
+        return FALSE;
+    }
+
+    MappedInput->hMap = CreateFileMapping(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (MappedInput->hMap == NULL) {
+        return FALSE;
+    }
+
+    YoriLibLoadKernel32Functions();
+    MappedInput->FileHandle = FileHandle;
+    return TRUE;
+}
+
+/**
+ Return the next range of a file which has been prepared with
+ @ref YoriLibMappedInputOpen .  The range remains valid until the next call
+ to this function or @ref YoriLibMappedInputClose .
+
+ @param MappedInput Pointer to the state of the file.
+
+ @param MaximumLength The maximum number of bytes to return.
+
+ @param Buffer On successful completion, points to the data.
+
+ @param Length On successful completion, the number of bytes of data.  This
+        is never zero.
+
+ @return TRUE to indicate data was returned, FALSE if the end of the file
+         was reached or a view could not be mapped.  In the latter case,
+         the Failed member of MappedInput is set.
+ */
+__success(return)
+BOOL
+YoriLibMappedInputGetNext(
+    __inout PYORI_LIB_MAPPED_INPUT MappedInput,
+    __in DWORD MaximumLength,
+    __out PVOID * Buffer,
+    __out PDWORD Length
+    )
+{
+    YORI_WIN32_MEMORY_RANGE_ENTRY Range;
+    LARGE_INTEGER ViewEnd;
+    DWORD OffsetInView;
+
+    if (MappedInput->Failed ||
+        MappedInput->CurrentOffset.QuadPart >= MappedInput->FileSize.QuadPart) {
+
+        return FALSE;
+    }
+
+    ViewEnd.QuadPart = MappedInput->ViewOffset.QuadPart + MappedInput->ViewLength;
+    if (MappedInput->View == NULL ||
+        MappedInput->CurrentOffset.QuadPart >= ViewEnd.QuadPart) {
+
+        if (MappedInput->View != NULL) {
+            UnmapViewOfFile(MappedInput->View);
+            MappedInput->View = NULL;
+        }
+
+        MappedInput->ViewOffset.QuadPart = MappedInput->CurrentOffset.QuadPart & ~((LONGLONG)YORI_LIB_MAPPED_INPUT_ALIGNMENT - 1);
+        MappedInput->ViewLength = YORI_LIB_MAPPED_INPUT_VIEW_SIZE;
+        if (MappedInput->ViewOffset.QuadPart + MappedInput->ViewLength > MappedInput->FileSize.QuadPart) {
+            MappedInput->ViewLength = (DWORD)(MappedInput->FileSize.QuadPart - MappedInput->ViewOffset.QuadPart);
+        }
+
+        MappedInput->View = MapViewOfFile(MappedInput->hMap, FILE_MAP_READ, MappedInput->ViewOffset.HighPart, MappedInput->ViewOffset.LowPart, MappedInput->ViewLength);
+        if (MappedInput->View == NULL) {
+            MappedInput->Failed = TRUE;
+            return FALSE;
+        }
+
+        //
+        //  Ask the system to read the whole view now, so the storage can
+        //  transfer large requests rather than having each page faulted in
+        //  as the caller reaches it.
+        //
+
+        if (DllKernel32.pPrefetchVirtualMemory != NULL) {
+            Range.VirtualAddress = MappedInput->View;
+            Range.NumberOfBytes = MappedInput->ViewLength;
+            DllKernel32.pPrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+        }
+    }
+
+    OffsetInView = (DWORD)(MappedInput->CurrentOffset.QuadPart - MappedInput->ViewOffset.QuadPart);
+    *Buffer = MappedInput->View + OffsetInView;
+    *Length = MappedInput->ViewLength - OffsetInView;
+    if (*Length > MaximumLength) {
+        *Length = MaximumLength;
+    }
+
+    MappedInput->CurrentOffset.QuadPart = MappedInput->CurrentOffset.QuadPart + *Length;
+    return TRUE;
+}
+
+/**
+ Release the state used to read a file by mapping it.  The file position is
+ updated to reflect the data that has been returned, so that the handle can
+ be used as if the data had been read with ReadFile.  The handle itself is
+ not closed.
+
+ @param MappedInput Pointer to the state of the file.
+ */
+VOID
+YoriLibMappedInputClose(
+    __inout PYORI_LIB_MAPPED_INPUT MappedInput
+    )
+{
+    if (MappedInput->View != NULL) {
+        UnmapViewOfFile(MappedInput->View);
+        MappedInput->View = NULL;
+    }
+
+    if (MappedInput->hMap != NULL) {
+        CloseHandle(MappedInput->hMap);
+        MappedInput->hMap = NULL;
+        SetFilePointer(MappedInput->FileHandle, MappedInput->CurrentOffset.LowPart, &MappedInput->CurrentOffset.HighPart, FILE_BEGIN);
+    }
+}
+
+// vim:sw=4:ts=4:et:
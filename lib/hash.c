@@ -28,10 +28,24 @@
 #include "yorilib.h"
 
 
+/**
+ The smallest number of slots to allocate in a hash table.
+ */
+#define YORI_HASH_MINIMUM_SLOTS (16)
+
+/**
+ The largest number of slots to allocate in a hash table.  Beyond this
+ point the table is no longer grown, and becomes progressively slower as it
+ becomes full.
+ */
+#define YORI_HASH_MAXIMUM_SLOTS (0x10000000)
+
 /**
  Allocate an empty hash table.
 
- @param NumberBuckets The number of buckets to allocate into the hash table.
+ @param NumberBuckets An estimate of the number of entries that will be
+        inserted into the hash table.  The table will grow as needed, so
+        this value determines the initial allocation only.
 
  @return On successful completion, points to the resulting hash table.
          On allocation failure, returns NULL.
@@ -41,22 +55,29 @@ YoriLibAllocateHashTable(
     __in DWORD NumberBuckets
     )
 {
-    DWORD SizeNeeded = sizeof(YORI_HASH_TABLE) + NumberBuckets * sizeof(YORI_HASH_BUCKET);
     PYORI_HASH_TABLE HashTable;
-    DWORD BucketIndex;
+    DWORD NumberSlots;
 
-    HashTable = YoriLibReferencedMalloc(SizeNeeded);
+    NumberSlots = YORI_HASH_MINIMUM_SLOTS;
+    while (NumberSlots < NumberBuckets && NumberSlots < YORI_HASH_MAXIMUM_SLOTS) {
+        NumberSlots = NumberSlots * 2;
+    }
+
+    HashTable = YoriLibReferencedMalloc(sizeof(YORI_HASH_TABLE));
     if (HashTable == NULL) {
         return NULL;
     }
 
-    HashTable->NumberBuckets = NumberBuckets;
-    HashTable->Buckets = (PYORI_HASH_BUCKET)(HashTable + 1);
-
-    for (BucketIndex = 0; BucketIndex < NumberBuckets; BucketIndex++) {
-        YoriLibInitializeListHead(&HashTable->Buckets[BucketIndex].ListHead);
+    HashTable->Slots = YoriLibMalloc(NumberSlots * sizeof(YORI_HASH_SLOT));
+    if (HashTable->Slots == NULL) {
+        YoriLibDereference(HashTable);
+        return NULL;
     }
 
+    ZeroMemory(HashTable->Slots, NumberSlots * sizeof(YORI_HASH_SLOT));
+    HashTable->NumberSlots = NumberSlots;
+    HashTable->NumberSlotsInUse = 0;
+
     return HashTable;
 }
 
@@ -71,54 +92,162 @@ YoriLibFreeEmptyHashTable(
     __in PYORI_HASH_TABLE HashTable
     )
 {
-#if DBG
-    DWORD BucketIndex;
-
-    for (BucketIndex = 0; BucketIndex < HashTable->NumberBuckets; BucketIndex++) {
-        ASSERT(YoriLibGetNextListEntry(&HashTable->Buckets[BucketIndex].ListHead, NULL) == NULL);
-    }
-#endif
+    ASSERT(HashTable->NumberSlotsInUse == 0);
 
+    YoriLibFree(HashTable->Slots);
     YoriLibDereference(HashTable);
 }
 
 /**
- Hash a yori string into a 16 bit hash value.
+ Hash a yori string into a 64 bit hash value without regard to case.  This
+ is FNV-1a applied to each upcased character, followed by a final mix so
+ that the low bits, which are used to select a slot, depend on every
+ character.
 
  @param String The string to generate a hash for.
 
- @return A 16 bit hash value for the string.
+ @return A 64 bit hash value for the string.
  */
-WORD
+DWORDLONG
 YoriLibHashString(
     __in PCYORI_STRING String
     )
 {
-    DWORD Hash;
+    DWORDLONG Hash;
+    DWORDLONG Prime;
     DWORD Index;
+    TCHAR Char;
 
-    //
-    //  Simple string xor hash
-    //
+    Hash = (((DWORDLONG)0xcbf29ce4) << 32) | 0x84222325;
+    Prime = (((DWORDLONG)0x00000100) << 32) | 0x000001b3;
 
-    Hash = 0;
     for (Index = 0; Index < String->LengthInChars; Index++) {
-        Hash = (Hash << 3) ^ YoriLibUpcaseChar(String->StartOfString[Index]) ^ (Hash >> 29);
+        Char = String->StartOfString[Index];
+        if (Char >= 'a' && Char <= 'z') {
+            Char = (TCHAR)(Char - 'a' + 'A');
+        }
+        Hash = (Hash ^ (WORD)Char) * Prime;
+    }
+
+    Hash = Hash ^ (Hash >> 32);
+    Hash = Hash ^ (Hash >> 15);
+    return Hash;
+}
+
+/**
+ Locate the slot for a key within the hash table.
+
+ @param HashTable Pointer to the hash table.
+
+ @param KeyString Pointer to the key to find.
+
+ @param Hash The hash of the key, as returned from @ref YoriLibHashString .
+
+ @return The index of the slot containing an entry with a matching key, or
+         the index of the empty slot where an entry with the key should be
+         inserted.
+ */
+DWORD
+YoriLibHashFindSlot(
+    __in PYORI_HASH_TABLE HashTable,
+    __in PCYORI_STRING KeyString,
+    __in DWORDLONG Hash
+    )
+{
+    DWORD Mask;
+    DWORD SlotIndex;
+    PYORI_HASH_SLOT Slot;
+
+    Mask = HashTable->NumberSlots - 1;
+    SlotIndex = (DWORD)Hash & Mask;
+
+    while (TRUE) {
+        Slot = &HashTable->Slots[SlotIndex];
+        if (Slot->Entry == NULL) {
+            break;
+        }
+
+        if (Slot->Hash == Hash &&
+            Slot->Entry->Key.LengthInChars == KeyString->LengthInChars &&
+            YoriLibCompareStringInsensitive(KeyString, &Slot->Entry->Key) == 0) {
+
+            break;
+        }
+
+        SlotIndex = (SlotIndex + 1) & Mask;
+    }
+
+    return SlotIndex;
+}
+
+/**
+ Double the number of slots in a hash table, and move each existing entry
+ into the new set of slots.
+
+ @param HashTable Pointer to the hash table to grow.
+
+ @return TRUE to indicate the table was grown, FALSE to indicate failure.
+ */
+BOOLEAN
+YoriLibHashGrow(
+    __in PYORI_HASH_TABLE HashTable
+    )
+{
+    PYORI_HASH_SLOT OldSlots;
+    PYORI_HASH_SLOT NewSlots;
+    DWORD OldNumberSlots;
+    DWORD NewNumberSlots;
+    DWORD Mask;
+    DWORD OldIndex;
+    DWORD NewIndex;
+
+    if (HashTable->NumberSlots >= YORI_HASH_MAXIMUM_SLOTS) {
+        return FALSE;
+    }
+
+    OldNumberSlots = HashTable->NumberSlots;
+    OldSlots = HashTable->Slots;
+    NewNumberSlots = OldNumberSlots * 2;
+
+    NewSlots = YoriLibMalloc(NewNumberSlots * sizeof(YORI_HASH_SLOT));
+    if (NewSlots == NULL) {
+        return FALSE;
     }
 
+    ZeroMemory(NewSlots, NewNumberSlots * sizeof(YORI_HASH_SLOT));
+    Mask = NewNumberSlots - 1;
+
     //
-    //  Move some high bits into the low bits since the low bits
-    //  will likely be used as a bucket index.  Note we're moving
-    //  bits 16 here and 3 above (ie., not divisible and won't
-    //  cancel out.)
+    //  Each key is unique within the old table, so there is no need to
+    //  compare keys while moving them.
     //
 
-    Hash = Hash ^ (Hash >> 16);
-    return (WORD)Hash;
+    for (OldIndex = 0; OldIndex < OldNumberSlots; OldIndex++) {
+        if (OldSlots[OldIndex].Entry == NULL) {
+            continue;
+        }
+
+        NewIndex = (DWORD)OldSlots[OldIndex].Hash & Mask;
+        while (NewSlots[NewIndex].Entry != NULL) {
+            NewIndex = (NewIndex + 1) & Mask;
+        }
+
+        NewSlots[NewIndex].Hash = OldSlots[OldIndex].Hash;
+        NewSlots[NewIndex].Entry = OldSlots[OldIndex].Entry;
+        NewSlots[NewIndex].Entry->SlotIndex = NewIndex;
+    }
+
+    HashTable->Slots = NewSlots;
+    HashTable->NumberSlots = NewNumberSlots;
+    YoriLibFree(OldSlots);
+
+    return TRUE;
 }
 
 /**
- Insert an object with a string based key into the hash table.
+ Insert an object with a string based key into the hash table.  If an
+ object with the same key has already been inserted, the new object will
+ be found by subsequent lookups until it is removed.
 
  @param HashTable The hash table to insert the object into.
 
@@ -129,8 +258,11 @@ YoriLibHashString(
 
  @param HashEntry On successful completion, populated with structures
         describing the entry within the hash table.
+
+ @return TRUE to indicate the entry was inserted, FALSE if the table is full
+         and could not be grown.
  */
-VOID
+BOOLEAN
 YoriLibHashInsertByKey(
     __in PYORI_HASH_TABLE HashTable,
     __in PYORI_STRING KeyString,
@@ -138,11 +270,54 @@ YoriLibHashInsertByKey(
     __out PYORI_HASH_ENTRY HashEntry
     )
 {
-    DWORD BucketIndex = YoriLibHashString(KeyString) % HashTable->NumberBuckets;
+    DWORDLONG Hash;
+    DWORD SlotIndex;
+    PYORI_HASH_SLOT Slot;
+    PYORI_HASH_ENTRY ExistingEntry;
+
+    HashEntry->HashTable = NULL;
+
+    //
+    //  Keep the table no more than three quarters full so that probe
+    //  sequences remain short.  If the table can't be grown, keep using
+    //  it until only one empty slot remains, which terminates searches.
+    //
+
+    if ((HashTable->NumberSlotsInUse + 1) * 4 > HashTable->NumberSlots * 3) {
+        if (!YoriLibHashGrow(HashTable) &&
+            HashTable->NumberSlotsInUse + 1 >= HashTable->NumberSlots) {
+
+            return FALSE;
+        }
+    }
+
+    Hash = YoriLibHashString(KeyString);
+    SlotIndex = YoriLibHashFindSlot(HashTable, KeyString, Hash);
+    Slot = &HashTable->Slots[SlotIndex];
 
     YoriLibCloneString(&HashEntry->Key, KeyString);
     HashEntry->Context = Context;
-    YoriLibInsertList(&HashTable->Buckets[BucketIndex].ListHead, &HashEntry->ListEntry);
+    HashEntry->HashTable = HashTable;
+    HashEntry->SlotIndex = SlotIndex;
+
+    if (Slot->Entry != NULL) {
+
+        //
+        //  Place the new entry before the existing entry, so the existing
+        //  entry follows it and will be found again when the new entry is
+        //  removed.
+        //
+
+        ExistingEntry = Slot->Entry;
+        YoriLibAppendList(&ExistingEntry->ListEntry, &HashEntry->ListEntry);
+    } else {
+        YoriLibInitializeListHead(&HashEntry->ListEntry);
+        Slot->Hash = Hash;
+        HashTable->NumberSlotsInUse++;
+    }
+
+    Slot->Entry = HashEntry;
+    return TRUE;
 }
 
 /**
@@ -161,27 +336,65 @@ YoriLibHashLookupByKey(
     __in PCYORI_STRING KeyString
     )
 {
-    DWORD BucketIndex = YoriLibHashString(KeyString) % HashTable->NumberBuckets;
-    PYORI_LIST_ENTRY ListEntry;
-    PYORI_HASH_ENTRY HashEntry;
-
-    HashEntry = NULL;
-    ListEntry = YoriLibGetNextListEntry(&HashTable->Buckets[BucketIndex].ListHead, NULL);
-    while (ListEntry != NULL) {
-        HashEntry = CONTAINING_RECORD(ListEntry, YORI_HASH_ENTRY, ListEntry);
-        if (YoriLibCompareStringInsensitive(KeyString, &HashEntry->Key) == 0) {
+    DWORD SlotIndex;
+
+    SlotIndex = YoriLibHashFindSlot(HashTable, KeyString, YoriLibHashString(KeyString));
+    return HashTable->Slots[SlotIndex].Entry;
+}
+
+/**
+ Empty a slot in a hash table.  Because the table uses linear probing, any
+ entries following the slot which would have been placed in it if it had
+ been empty are moved back, so that every entry remains reachable from its
+ initial slot without encountering an empty slot.
+
+ @param HashTable Pointer to the hash table.
+
+ @param SlotIndex The index of the slot to empty.
+ */
+VOID
+YoriLibHashEmptySlot(
+    __in PYORI_HASH_TABLE HashTable,
+    __in DWORD SlotIndex
+    )
+{
+    DWORD Mask;
+    DWORD EmptyIndex;
+    DWORD NextIndex;
+    DWORD InitialIndex;
+
+    Mask = HashTable->NumberSlots - 1;
+    EmptyIndex = SlotIndex;
+    NextIndex = SlotIndex;
+
+    while (TRUE) {
+        NextIndex = (NextIndex + 1) & Mask;
+        if (HashTable->Slots[NextIndex].Entry == NULL) {
             break;
         }
-        HashEntry = NULL;
-        ListEntry = YoriLibGetNextListEntry(&HashTable->Buckets[BucketIndex].ListHead, ListEntry);
+
+        //
+        //  If the entry's initial slot is not between the empty slot and
+        //  the entry's current slot, it can be moved into the empty slot.
+        //
+
+        InitialIndex = (DWORD)HashTable->Slots[NextIndex].Hash & Mask;
+        if (((NextIndex - InitialIndex) & Mask) >= ((NextIndex - EmptyIndex) & Mask)) {
+            HashTable->Slots[EmptyIndex].Hash = HashTable->Slots[NextIndex].Hash;
+            HashTable->Slots[EmptyIndex].Entry = HashTable->Slots[NextIndex].Entry;
+            HashTable->Slots[EmptyIndex].Entry->SlotIndex = EmptyIndex;
+            EmptyIndex = NextIndex;
+        }
     }
 
-    return HashEntry;
+    HashTable->Slots[EmptyIndex].Hash = 0;
+    HashTable->Slots[EmptyIndex].Entry = NULL;
+    HashTable->NumberSlotsInUse--;
 }
 
 /**
- Remove an entry from a hash table.  This routine assumes the entry must
- already be inserted into a hash table.
+ Remove an entry from a hash table.  If the entry is not currently inserted
+ into a hash table, this routine has no effect.
 
  @param HashEntry The entry to remove.
  */
@@ -190,8 +403,42 @@ YoriLibHashRemoveByEntry(
     __in PYORI_HASH_ENTRY HashEntry
     )
 {
+    PYORI_HASH_TABLE HashTable;
+    PYORI_HASH_ENTRY NextEntry;
+    PYORI_HASH_SLOT Slot;
+
+    HashTable = HashEntry->HashTable;
+    if (HashTable == NULL) {
+        return;
+    }
+
+    //
+    //  If the entry is the one referenced by its slot, either the entry
+    //  inserted before it with the same key takes its place, or the slot
+    //  becomes empty.  Otherwise the entry is only linked to the other
+    //  entries with the same key.
+    //
+
+    Slot = NULL;
+    if (HashEntry->SlotIndex < HashTable->NumberSlots &&
+        HashTable->Slots[HashEntry->SlotIndex].Entry == HashEntry) {
+
+        Slot = &HashTable->Slots[HashEntry->SlotIndex];
+    }
+
+    if (Slot != NULL) {
+        if (YoriLibIsListEmpty(&HashEntry->ListEntry)) {
+            YoriLibHashEmptySlot(HashTable, HashEntry->SlotIndex);
+        } else {
+            NextEntry = CONTAINING_RECORD(HashEntry->ListEntry.Next, YORI_HASH_ENTRY, ListEntry);
+            NextEntry->SlotIndex = HashEntry->SlotIndex;
+            Slot->Entry = NextEntry;
+        }
+    }
+
     YoriLibRemoveListItem(&HashEntry->ListEntry);
     YoriLibFreeStringContents(&HashEntry->Key);
+    HashEntry->HashTable = NULL;
 }
 
 /**
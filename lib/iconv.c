@@ -135,6 +135,156 @@ YoriLibSetMultibyteInputEncoding(
     YoriLibActiveInputEncodingInitialized = TRUE;
 }
 
+/**
+ A mask which, when applied to a pointer sized block of UTF16 characters, is
+ nonzero if any of the characters are outside of the ASCII range.
+ */
+#define YORI_LIB_NON_ASCII_MASK_W ((DWORD_PTR)-1 / 0xFFFF * 0xFF80)
+
+/**
+ A mask which, when applied to a pointer sized block of bytes, is nonzero if
+ any of the bytes are outside of the ASCII range.
+ */
+#define YORI_LIB_NON_ASCII_MASK_A ((DWORD_PTR)-1 / 0xFF * 0x80)
+
+/**
+ Count the number of characters at the start of a UTF16 string which are in
+ the ASCII range.  Once the string is aligned, this checks a pointer's worth
+ of characters at a time.
+
+ @param String Pointer to the UTF16 string.
+
+ @param Length The length of the string, in characters.
+
+ @return The number of characters at the start of the string which are in
+         the ASCII range.
+ */
+DWORD
+YoriLibCountAsciiCharsW(
+    __in_ecount(Length) LPCTSTR String,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+
+    Index = 0;
+    while (Index < Length && ((DWORD_PTR)&String[Index] & (sizeof(DWORD_PTR) - 1)) != 0) {
+        if (String[Index] >= 0x80) {
+            return Index;
+        }
+        Index++;
+    }
+
+    while (Index + sizeof(DWORD_PTR) / sizeof(TCHAR) <= Length) {
+        if ((*(DWORD_PTR *)&String[Index] & YORI_LIB_NON_ASCII_MASK_W) != 0) {
+            break;
+        }
+        Index += sizeof(DWORD_PTR) / sizeof(TCHAR);
+    }
+
+    while (Index < Length && String[Index] < 0x80) {
+        Index++;
+    }
+
+    return Index;
+}
+
+/**
+ Count the number of characters at the start of a UTF16 string which are
+ outside of the ASCII range.
+
+ @param String Pointer to the UTF16 string.
+
+ @param Length The length of the string, in characters.
+
+ @return The number of characters at the start of the string which are
+         outside of the ASCII range.
+ */
+DWORD
+YoriLibCountNonAsciiCharsW(
+    __in_ecount(Length) LPCTSTR String,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+
+    Index = 0;
+    while (Index < Length && String[Index] >= 0x80) {
+        Index++;
+    }
+
+    return Index;
+}
+
+/**
+ Count the number of bytes at the start of a multibyte string which are in
+ the ASCII range.  Once the string is aligned, this checks a pointer's worth
+ of bytes at a time.
+
+ @param String Pointer to the multibyte string.
+
+ @param Length The length of the string, in bytes.
+
+ @return The number of bytes at the start of the string which are in the
+         ASCII range.
+ */
+DWORD
+YoriLibCountAsciiBytes(
+    __in_ecount(Length) LPCSTR String,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+
+    Index = 0;
+    while (Index < Length && ((DWORD_PTR)&String[Index] & (sizeof(DWORD_PTR) - 1)) != 0) {
+        if ((UCHAR)String[Index] >= 0x80) {
+            return Index;
+        }
+        Index++;
+    }
+
+    while (Index + sizeof(DWORD_PTR) <= Length) {
+        if ((*(DWORD_PTR *)&String[Index] & YORI_LIB_NON_ASCII_MASK_A) != 0) {
+            break;
+        }
+        Index += sizeof(DWORD_PTR);
+    }
+
+    while (Index < Length && (UCHAR)String[Index] < 0x80) {
+        Index++;
+    }
+
+    return Index;
+}
+
+/**
+ Count the number of bytes at the start of a multibyte string which are
+ outside of the ASCII range.
+
+ @param String Pointer to the multibyte string.
+
+ @param Length The length of the string, in bytes.
+
+ @return The number of bytes at the start of the string which are outside
+         of the ASCII range.
+ */
+DWORD
+YoriLibCountNonAsciiBytes(
+    __in_ecount(Length) LPCSTR String,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+
+    Index = 0;
+    while (Index < Length && (UCHAR)String[Index] >= 0x80) {
+        Index++;
+    }
+
+    return Index;
+}
+
 /**
  Returns the number of bytes needed to store a specified UTF16 string in
  the current output encoding.
@@ -152,10 +302,38 @@ YoriLibGetMultibyteOutputSizeNeeded(
     )
 {
     DWORD Return;
+    DWORD Offset;
+    DWORD RunLength;
+    DWORD RunBytes;
     DWORD Encoding = YoriLibGetMultibyteOutputEncoding();
     if (Encoding == CP_UTF16) {
         return BufferLength * sizeof(WCHAR);
     }
+
+    //
+    //  In UTF8, each ASCII character is a single byte, and no multibyte
+    //  sequence contains an ASCII byte, so only ranges of non-ASCII
+    //  characters need to be sized by the system.
+    //
+
+    if (Encoding == CP_UTF8) {
+        Return = 0;
+        Offset = 0;
+        while (Offset < BufferLength) {
+            RunLength = YoriLibCountAsciiCharsW(&StringBuffer[Offset], BufferLength - Offset);
+            Return += RunLength;
+            Offset += RunLength;
+            if (Offset < BufferLength) {
+                RunLength = YoriLibCountNonAsciiCharsW(&StringBuffer[Offset], BufferLength - Offset);
+                RunBytes = WideCharToMultiByte(Encoding, 0, &StringBuffer[Offset], RunLength, NULL, 0, NULL, NULL);
+                ASSERT(RunBytes > 0);
+                Return += RunBytes;
+                Offset += RunLength;
+            }
+        }
+        return Return;
+    }
+
     Return = WideCharToMultiByte(Encoding, 0, StringBuffer, BufferLength, NULL, 0, NULL, NULL);
     ASSERT(Return > 0 || BufferLength == 0);
     return Return;
@@ -189,6 +367,10 @@ YoriLibMultibyteOutput(
     )
 {
     DWORD Return;
+    DWORD InputOffset;
+    DWORD OutputOffset;
+    DWORD RunLength;
+    DWORD Index;
     DWORD Encoding = YoriLibGetMultibyteOutputEncoding();
     if (Encoding == CP_UTF16) {
         ASSERT(OutputBufferLength >= InputBufferLength * sizeof(WCHAR));
@@ -197,6 +379,52 @@ YoriLibMultibyteOutput(
         }
         return;
     }
+
+    //
+    //  For UTF8, copy ranges of ASCII characters directly and only ask the
+    //  system to convert ranges that are not ASCII.
+    //
+
+    if (Encoding == CP_UTF8) {
+        InputOffset = 0;
+        OutputOffset = 0;
+        while (InputOffset < InputBufferLength) {
+            RunLength = YoriLibCountAsciiCharsW(&InputStringBuffer[InputOffset], InputBufferLength - InputOffset);
+            if (RunLength > OutputBufferLength - OutputOffset) {
+                ASSERT(RunLength <= OutputBufferLength - OutputOffset);
+                RunLength = OutputBufferLength - OutputOffset;
+            }
+            for (Index = 0; Index < RunLength; Index++) {
+                OutputStringBuffer[OutputOffset + Index] = (CHAR)InputStringBuffer[InputOffset + Index];
+            }
+            InputOffset += RunLength;
+            OutputOffset += RunLength;
+
+            if (InputOffset < InputBufferLength) {
+                RunLength = YoriLibCountNonAsciiCharsW(&InputStringBuffer[InputOffset], InputBufferLength - InputOffset);
+                if (RunLength == 0 || OutputOffset >= OutputBufferLength) {
+                    break;
+                }
+                Return = WideCharToMultiByte(Encoding,
+                                             0,
+                                             &InputStringBuffer[InputOffset],
+                                             RunLength,
+                                             &OutputStringBuffer[OutputOffset],
+                                             OutputBufferLength - OutputOffset,
+                                             NULL,
+                                             NULL);
+                if (Return == 0) {
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("InputBufferLength %i OutputBufferLength %i\n"), InputBufferLength, OutputBufferLength);
+                    ASSERT(Return != 0);
+                    break;
+                }
+                InputOffset += RunLength;
+                OutputOffset += Return;
+            }
+        }
+        return;
+    }
+
     Return = WideCharToMultiByte(Encoding,
                                  0,
                                  InputStringBuffer,
@@ -228,10 +456,36 @@ YoriLibGetMultibyteInputSizeNeeded(
     __in DWORD BufferLength
     )
 {
+    DWORD Return;
+    DWORD Offset;
+    DWORD RunLength;
     DWORD Encoding = YoriLibGetMultibyteInputEncoding();
     if (Encoding == CP_UTF16) {
         return BufferLength;
     }
+
+    //
+    //  In UTF8, each ASCII byte is a single character, and no multibyte
+    //  sequence contains an ASCII byte, so only ranges of non-ASCII bytes
+    //  need to be sized by the system.
+    //
+
+    if (Encoding == CP_UTF8) {
+        Return = 0;
+        Offset = 0;
+        while (Offset < BufferLength) {
+            RunLength = YoriLibCountAsciiBytes(&StringBuffer[Offset], BufferLength - Offset);
+            Return += RunLength;
+            Offset += RunLength;
+            if (Offset < BufferLength) {
+                RunLength = YoriLibCountNonAsciiBytes(&StringBuffer[Offset], BufferLength - Offset);
+                Return += MultiByteToWideChar(Encoding, 0, &StringBuffer[Offset], RunLength, NULL, 0);
+                Offset += RunLength;
+            }
+        }
+        return Return;
+    }
+
     return MultiByteToWideChar(Encoding, 0, StringBuffer, BufferLength, NULL, 0);
 }
 
@@ -256,6 +510,10 @@ YoriLibMultibyteInput(
     )
 {
     DWORD Return;
+    DWORD InputOffset;
+    DWORD OutputOffset;
+    DWORD RunLength;
+    DWORD Index;
     DWORD Encoding = YoriLibGetMultibyteInputEncoding();
     if (Encoding == CP_UTF16) {
         ASSERT(OutputBufferLength >= InputBufferLength);
@@ -264,6 +522,49 @@ YoriLibMultibyteInput(
         }
         return;
     }
+
+    //
+    //  For UTF8, widen ranges of ASCII bytes directly and only ask the
+    //  system to convert ranges that are not ASCII.
+    //
+
+    if (Encoding == CP_UTF8) {
+        InputOffset = 0;
+        OutputOffset = 0;
+        while (InputOffset < InputBufferLength) {
+            RunLength = YoriLibCountAsciiBytes(&InputStringBuffer[InputOffset], InputBufferLength - InputOffset);
+            if (RunLength > OutputBufferLength - OutputOffset) {
+                ASSERT(RunLength <= OutputBufferLength - OutputOffset);
+                RunLength = OutputBufferLength - OutputOffset;
+            }
+            for (Index = 0; Index < RunLength; Index++) {
+                OutputStringBuffer[OutputOffset + Index] = (TCHAR)InputStringBuffer[InputOffset + Index];
+            }
+            InputOffset += RunLength;
+            OutputOffset += RunLength;
+
+            if (InputOffset < InputBufferLength) {
+                RunLength = YoriLibCountNonAsciiBytes(&InputStringBuffer[InputOffset], InputBufferLength - InputOffset);
+                if (RunLength == 0 || OutputOffset >= OutputBufferLength) {
+                    break;
+                }
+                Return = MultiByteToWideChar(Encoding,
+                                             0,
+                                             &InputStringBuffer[InputOffset],
+                                             RunLength,
+                                             &OutputStringBuffer[OutputOffset],
+                                             OutputBufferLength - OutputOffset);
+                ASSERT(Return != 0);
+                if (Return == 0) {
+                    break;
+                }
+                InputOffset += RunLength;
+                OutputOffset += Return;
+            }
+        }
+        return;
+    }
+
     Return = MultiByteToWideChar(Encoding,
                                  0,
                                  InputStringBuffer,
@@ -0,0 +1,1513 @@
+/**
+ * @file lib/ini.c
+ *
+ * Yori routines to query and update INI files in memory
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+/**
+ A single line within an INI document.  Each line retains its text so that
+ lines which are not modified are written back unchanged.  If the line is a
+ key value pair, the key and value refer to portions of the text.
+ */
+typedef struct _YORI_LIB_INI_LINE {
+
+    /**
+     The link of this line within the lines of its section.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this line within the hash table of keys in its section.
+     This is only inserted if the line is a key value pair and no earlier
+     line in the section has the same key.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The text of the line, without any line ending.
+     */
+    YORI_STRING Text;
+
+    /**
+     The key of a key value pair, without surrounding spaces.  This is empty
+     if the line is not a key value pair.
+     */
+    YORI_STRING Key;
+
+    /**
+     The value of a key value pair, without surrounding spaces.
+     */
+    YORI_STRING Value;
+} YORI_LIB_INI_LINE, *PYORI_LIB_INI_LINE;
+
+/**
+ A section within an INI document.
+ */
+typedef struct _YORI_LIB_INI_SECTION {
+
+    /**
+     The link of this section within the sections of the document.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this section within the hash table of sections in the
+     document.  This is only inserted if no earlier section in the document
+     has the same name.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The text of the line which started the section.  This is empty for the
+     lines which precede the first section in the file.
+     */
+    YORI_STRING Text;
+
+    /**
+     The name of the section, without brackets or surrounding spaces.
+     */
+    YORI_STRING Name;
+
+    /**
+     The list of lines within the section, in file order.
+     */
+    YORI_LIST_ENTRY LineList;
+
+    /**
+     A hash table of key value pairs within the section.  This is NULL for
+     the lines which precede the first section in the file, since these
+     cannot be queried.
+     */
+    PYORI_HASH_TABLE Keys;
+} YORI_LIB_INI_SECTION, *PYORI_LIB_INI_SECTION;
+
+/**
+ An INI file which has been parsed into memory.
+ */
+typedef struct _YORI_LIB_INI_DOCUMENT {
+
+    /**
+     The full path to the file.
+     */
+    YORI_STRING FileName;
+
+    /**
+     Any lines in the file which precede the first section.
+     */
+    YORI_LIB_INI_SECTION Preamble;
+
+    /**
+     The list of sections within the file, in file order.
+     */
+    YORI_LIST_ENTRY SectionList;
+
+    /**
+     A hash table of sections within the file.
+     */
+    PYORI_HASH_TABLE Sections;
+
+    /**
+     The encoding of the file.  This is CP_UTF16, CP_UTF8, or CP_ACP.
+     */
+    DWORD Encoding;
+
+    /**
+     TRUE if the file should be written with a byte order mark.
+     */
+    BOOLEAN ByteOrderMark;
+
+    /**
+     TRUE if the document has been modified since it was loaded or last
+     written.
+     */
+    BOOLEAN Modified;
+} YORI_LIB_INI_DOCUMENT, *PYORI_LIB_INI_DOCUMENT;
+
+/**
+ Remove spaces and tabs from the beginning and end of a Yori string.
+
+ @param String Pointer to the string to trim.
+ */
+VOID
+YoriLibIniTrimWhitespace(
+    __inout PYORI_STRING String
+    )
+{
+    while (String->LengthInChars > 0 &&
+           (String->StartOfString[0] == ' ' || String->StartOfString[0] == '\t')) {
+
+        String->StartOfString++;
+        String->LengthInChars--;
+    }
+
+    while (String->LengthInChars > 0 &&
+           (String->StartOfString[String->LengthInChars - 1] == ' ' ||
+            String->StartOfString[String->LengthInChars - 1] == '\t')) {
+
+        String->LengthInChars--;
+    }
+}
+
+/**
+ Allocate a line and determine whether it is a key value pair.
+
+ @param Text Pointer to the text of the line, without any line ending.
+
+ @return Pointer to the line, or NULL on allocation failure.
+ */
+PYORI_LIB_INI_LINE
+YoriLibIniAllocateLine(
+    __in PCYORI_STRING Text
+    )
+{
+    PYORI_LIB_INI_LINE Line;
+    YORI_STRING Trimmed;
+    DWORD Index;
+
+    Line = YoriLibMalloc(sizeof(YORI_LIB_INI_LINE) + (Text->LengthInChars + 1) * sizeof(TCHAR));
+    if (Line == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Line, sizeof(YORI_LIB_INI_LINE));
+    YoriLibInitEmptyString(&Line->Text);
+    Line->Text.StartOfString = (LPTSTR)(Line + 1);
+    Line->Text.LengthInChars = Text->LengthInChars;
+    Line->Text.LengthAllocated = Text->LengthInChars + 1;
+    memcpy(Line->Text.StartOfString, Text->StartOfString, Text->LengthInChars * sizeof(TCHAR));
+    Line->Text.StartOfString[Text->LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Line->Key);
+    YoriLibInitEmptyString(&Line->Value);
+
+    YoriLibInitEmptyString(&Trimmed);
+    Trimmed.StartOfString = Line->Text.StartOfString;
+    Trimmed.LengthInChars = Line->Text.LengthInChars;
+    YoriLibIniTrimWhitespace(&Trimmed);
+
+    if (Trimmed.LengthInChars == 0 || Trimmed.StartOfString[0] == ';') {
+        return Line;
+    }
+
+    for (Index = 0; Index < Trimmed.LengthInChars; Index++) {
+        if (Trimmed.StartOfString[Index] == '=') {
+            break;
+        }
+    }
+
+    if (Index == 0 || Index == Trimmed.LengthInChars) {
+        return Line;
+    }
+
+    Line->Key.StartOfString = Trimmed.StartOfString;
+    Line->Key.LengthInChars = Index;
+    YoriLibIniTrimWhitespace(&Line->Key);
+
+    Line->Value.StartOfString = &Trimmed.StartOfString[Index + 1];
+    Line->Value.LengthInChars = Trimmed.LengthInChars - Index - 1;
+    YoriLibIniTrimWhitespace(&Line->Value);
+
+    return Line;
+}
+
+/**
+ Free a line, removing it from its section.
+
+ @param Line Pointer to the line to free.
+ */
+VOID
+YoriLibIniFreeLine(
+    __in PYORI_LIB_INI_LINE Line
+    )
+{
+    YoriLibHashRemoveByEntry(&Line->HashEntry);
+    YoriLibRemoveListItem(&Line->ListEntry);
+    YoriLibFree(Line);
+}
+
+/**
+ Insert a line into a section after a specified line, and make the line
+ findable by its key if it is the first line in the section with that key.
+
+ @param Section Pointer to the section to insert the line into.
+
+ @param PreviousEntry Pointer to the list entry which the line should follow.
+        This can be the section's list of lines, to insert the line at the
+        beginning of the section.
+
+ @param Line Pointer to the line to insert.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniInsertLine(
+    __in PYORI_LIB_INI_SECTION Section,
+    __in PYORI_LIST_ENTRY PreviousEntry,
+    __in PYORI_LIB_INI_LINE Line
+    )
+{
+    if (Line->Key.LengthInChars > 0 &&
+        Section->Keys != NULL &&
+        YoriLibHashLookupByKey(Section->Keys, &Line->Key) == NULL) {
+
+        if (!YoriLibHashInsertByKey(Section->Keys, &Line->Key, Line, &Line->HashEntry)) {
+            return FALSE;
+        }
+    }
+
+    YoriLibInsertList(PreviousEntry, &Line->ListEntry);
+    return TRUE;
+}
+
+/**
+ Allocate a section.
+
+ @param Text Pointer to the text of the line which starts the section.
+
+ @return Pointer to the section, or NULL on allocation failure.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniAllocateSection(
+    __in PCYORI_STRING Text
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    DWORD Index;
+
+    Section = YoriLibMalloc(sizeof(YORI_LIB_INI_SECTION) + (Text->LengthInChars + 1) * sizeof(TCHAR));
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Section, sizeof(YORI_LIB_INI_SECTION));
+    YoriLibInitEmptyString(&Section->Text);
+    Section->Text.StartOfString = (LPTSTR)(Section + 1);
+    Section->Text.LengthInChars = Text->LengthInChars;
+    Section->Text.LengthAllocated = Text->LengthInChars + 1;
+    memcpy(Section->Text.StartOfString, Text->StartOfString, Text->LengthInChars * sizeof(TCHAR));
+    Section->Text.StartOfString[Text->LengthInChars] = '\0';
+
+    YoriLibInitEmptyString(&Section->Name);
+    Section->Name.StartOfString = Section->Text.StartOfString;
+    Section->Name.LengthInChars = Section->Text.LengthInChars;
+    YoriLibIniTrimWhitespace(&Section->Name);
+
+    ASSERT(Section->Name.LengthInChars > 0 && Section->Name.StartOfString[0] == '[');
+    Section->Name.StartOfString++;
+    Section->Name.LengthInChars--;
+    for (Index = 0; Index < Section->Name.LengthInChars; Index++) {
+        if (Section->Name.StartOfString[Index] == ']') {
+            Section->Name.LengthInChars = Index;
+            break;
+        }
+    }
+    YoriLibIniTrimWhitespace(&Section->Name);
+
+    YoriLibInitializeListHead(&Section->LineList);
+    Section->Keys = YoriLibAllocateHashTable(16);
+    if (Section->Keys == NULL) {
+        YoriLibFree(Section);
+        return NULL;
+    }
+
+    return Section;
+}
+
+/**
+ Free all of the lines within a section.
+
+ @param Section Pointer to the section.
+ */
+VOID
+YoriLibIniFreeSectionLines(
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+
+    ListEntry = YoriLibGetNextListEntry(&Section->LineList, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Section->LineList, ListEntry);
+        YoriLibIniFreeLine(Line);
+    }
+}
+
+/**
+ Free a section and all of its lines, removing it from its document.
+
+ @param Section Pointer to the section to free.
+ */
+VOID
+YoriLibIniFreeSection(
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    YoriLibIniFreeSectionLines(Section);
+    YoriLibHashRemoveByEntry(&Section->HashEntry);
+    YoriLibRemoveListItem(&Section->ListEntry);
+    YoriLibFreeEmptyHashTable(Section->Keys);
+    YoriLibFree(Section);
+}
+
+/**
+ Add a section to the end of a document, and make the section findable by
+ its name if it is the first section in the document with that name.
+
+ @param IniDocument Pointer to the document.
+
+ @param Section Pointer to the section to add.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniAppendSection(
+    __in PYORI_LIB_INI_DOCUMENT IniDocument,
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    if (YoriLibHashLookupByKey(IniDocument->Sections, &Section->Name) == NULL) {
+        if (!YoriLibHashInsertByKey(IniDocument->Sections, &Section->Name, Section, &Section->HashEntry)) {
+            return FALSE;
+        }
+    }
+
+    YoriLibAppendList(&IniDocument->SectionList, &Section->ListEntry);
+    return TRUE;
+}
+
+/**
+ Find a section within a document by name.
+
+ @param IniDocument Pointer to the document.
+
+ @param SectionName Pointer to the name of the section to find.
+
+ @return Pointer to the section, or NULL if no section has the name.
+ */
+PYORI_LIB_INI_SECTION
+YoriLibIniFindSection(
+    __in PYORI_LIB_INI_DOCUMENT IniDocument,
+    __in LPCTSTR SectionName
+    )
+{
+    YORI_STRING Name;
+    PYORI_HASH_ENTRY HashEntry;
+
+    YoriLibConstantString(&Name, SectionName);
+    HashEntry = YoriLibHashLookupByKey(IniDocument->Sections, &Name);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
+/**
+ Find a key value pair within a document.
+
+ @param IniDocument Pointer to the document.
+
+ @param SectionName Pointer to the name of the section containing the key.
+
+ @param KeyName Pointer to the key to find.
+
+ @return Pointer to the line containing the key value pair, or NULL if the
+         key is not found.
+ */
+PYORI_LIB_INI_LINE
+YoriLibIniFindLine(
+    __in PYORI_LIB_INI_DOCUMENT IniDocument,
+    __in LPCTSTR SectionName,
+    __in LPCTSTR KeyName
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    YORI_STRING Key;
+    PYORI_HASH_ENTRY HashEntry;
+
+    Section = YoriLibIniFindSection(IniDocument, SectionName);
+    if (Section == NULL) {
+        return NULL;
+    }
+
+    YoriLibConstantString(&Key, KeyName);
+    HashEntry = YoriLibHashLookupByKey(Section->Keys, &Key);
+    if (HashEntry == NULL) {
+        return NULL;
+    }
+
+    return HashEntry->Context;
+}
+
+/**
+ Split the text of an INI file into lines and sections, and add them to a
+ document.  Lines may be terminated with a carriage return, a line feed, or
+ both.
+
+ @param IniDocument Pointer to the document, which should be empty.
+
+ @param FileText Pointer to the text of the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniParse(
+    __in PYORI_LIB_INI_DOCUMENT IniDocument,
+    __in PCYORI_STRING FileText
+    )
+{
+    PYORI_LIB_INI_SECTION Section;
+    PYORI_LIB_INI_SECTION NewSection;
+    PYORI_LIB_INI_LINE Line;
+    YORI_STRING LineText;
+    YORI_STRING Trimmed;
+    DWORD Index;
+    DWORD LineStart;
+
+    Section = &IniDocument->Preamble;
+    YoriLibInitEmptyString(&LineText);
+    LineStart = 0;
+
+    for (Index = 0; Index <= FileText->LengthInChars; Index++) {
+        if (Index < FileText->LengthInChars &&
+            FileText->StartOfString[Index] != '\r' &&
+            FileText->StartOfString[Index] != '\n') {
+
+            continue;
+        }
+
+        //
+        //  Don't generate an empty line for the end of the file if the
+        //  final line was terminated.
+        //
+
+        if (Index == FileText->LengthInChars && LineStart == Index) {
+
+            break;
+        }
+
+        LineText.StartOfString = &FileText->StartOfString[LineStart];
+        LineText.LengthInChars = Index - LineStart;
+
+        if (Index + 1 < FileText->LengthInChars &&
+            FileText->StartOfString[Index] == '\r' &&
+            FileText->StartOfString[Index + 1] == '\n') {
+
+            Index++;
+        }
+        LineStart = Index + 1;
+
+        memcpy(&Trimmed, &LineText, sizeof(YORI_STRING));
+        YoriLibIniTrimWhitespace(&Trimmed);
+
+        if (Trimmed.LengthInChars > 0 && Trimmed.StartOfString[0] == '[') {
+            NewSection = YoriLibIniAllocateSection(&LineText);
+            if (NewSection == NULL) {
+                return FALSE;
+            }
+
+            if (!YoriLibIniAppendSection(IniDocument, NewSection)) {
+                YoriLibFreeEmptyHashTable(NewSection->Keys);
+                YoriLibFree(NewSection);
+                return FALSE;
+            }
+
+            Section = NewSection;
+            continue;
+        }
+
+        Line = YoriLibIniAllocateLine(&LineText);
+        if (Line == NULL) {
+            return FALSE;
+        }
+
+        if (!YoriLibIniInsertLine(Section, Section->LineList.Prev, Line)) {
+            YoriLibFree(Line);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Free an INI document and all of its contents.  Any modifications which
+ have not been written with @ref YoriLibIniCommit are discarded.
+
+ @param IniDocument Pointer to the document to free.
+ */
+VOID
+YoriLibIniClose(
+    __in PVOID IniDocument
+    )
+{
+    PYORI_LIB_INI_DOCUMENT Document;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_SECTION Section;
+
+    Document = (PYORI_LIB_INI_DOCUMENT)IniDocument;
+
+    ListEntry = YoriLibGetNextListEntry(&Document->SectionList, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Document->SectionList, ListEntry);
+        YoriLibIniFreeSection(Section);
+    }
+
+    YoriLibIniFreeSectionLines(&Document->Preamble);
+    YoriLibFreeEmptyHashTable(Document->Sections);
+    YoriLibFreeStringContents(&Document->FileName);
+    YoriLibFree(Document);
+}
+
+/**
+ Load an INI file into memory so that it can be queried and updated without
+ parsing it for each operation.  If the file does not exist, an empty
+ document is returned, and the file is created if the document is modified
+ and committed.  Files beginning with a UTF-16 byte order mark are read as
+ UTF-16, files beginning with a UTF-8 byte order mark are read as UTF-8,
+ and all other files are read in the ANSI code page, matching the system's
+ handling of INI files.
+
+ @param FileName Pointer to the full path to the INI file.
+
+ @param IniDocument On successful completion, updated to point to an opaque
+        document which should be freed with @ref YoriLibIniClose .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniOpen(
+    __in PCYORI_STRING FileName,
+    __out PVOID *IniDocument
+    )
+{
+    PYORI_LIB_INI_DOCUMENT Document;
+    HANDLE FileHandle;
+    DWORD Err;
+    DWORD FileSize;
+    DWORD BytesRead;
+    DWORD Index;
+    PUCHAR FileBytes;
+    YORI_STRING FileText;
+    BOOL Result;
+
+    ASSERT(YoriLibIsStringNullTerminated(FileName));
+
+    Document = YoriLibMalloc(sizeof(YORI_LIB_INI_DOCUMENT));
+    if (Document == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(Document, sizeof(YORI_LIB_INI_DOCUMENT));
+    YoriLibInitializeListHead(&Document->SectionList);
+    YoriLibInitializeListHead(&Document->Preamble.LineList);
+    YoriLibInitEmptyString(&Document->Preamble.Text);
+    YoriLibInitEmptyString(&Document->Preamble.Name);
+    Document->Encoding = CP_ACP;
+
+    Document->Sections = YoriLibAllocateHashTable(64);
+    if (Document->Sections == NULL) {
+        YoriLibFree(Document);
+        return FALSE;
+    }
+
+    if (!YoriLibAllocateString(&Document->FileName, FileName->LengthInChars + 1)) {
+        YoriLibFreeEmptyHashTable(Document->Sections);
+        YoriLibFree(Document);
+        return FALSE;
+    }
+
+    memcpy(Document->FileName.StartOfString, FileName->StartOfString, FileName->LengthInChars * sizeof(TCHAR));
+    Document->FileName.StartOfString[FileName->LengthInChars] = '\0';
+    Document->FileName.LengthInChars = FileName->LengthInChars;
+
+    FileHandle = CreateFile(FileName->StartOfString,
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+        Err = GetLastError();
+        if (Err == ERROR_FILE_NOT_FOUND || Err == ERROR_PATH_NOT_FOUND) {
+            *IniDocument = Document;
+            return TRUE;
+        }
+        YoriLibIniClose(Document);
+        return FALSE;
+    }
+
+    FileSize = GetFileSize(FileHandle, &Index);
+    if ((FileSize == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) ||
+        Index != 0 ||
+        FileSize >= 0x40000000) {
+
+        CloseHandle(FileHandle);
+        YoriLibIniClose(Document);
+        return FALSE;
+    }
+
+    FileBytes = YoriLibMalloc(FileSize + sizeof(WCHAR));
+    if (FileBytes == NULL) {
+        CloseHandle(FileHandle);
+        YoriLibIniClose(Document);
+        return FALSE;
+    }
+
+    for (Index = 0; Index < FileSize; Index += BytesRead) {
+        if (!ReadFile(FileHandle, &FileBytes[Index], FileSize - Index, &BytesRead, NULL) ||
+            BytesRead == 0) {
+
+            break;
+        }
+    }
+
+    CloseHandle(FileHandle);
+    FileSize = Index;
+
+    //
+    //  Convert the file into UTF-16 according to its byte order mark.
+    //  UTF-16 files are parsed in place.
+    //
+
+    YoriLibInitEmptyString(&FileText);
+    if (FileSize >= 2 && FileBytes[0] == 0xFF && FileBytes[1] == 0xFE) {
+        Document->Encoding = CP_UTF16;
+        Document->ByteOrderMark = TRUE;
+        FileText.StartOfString = (LPTSTR)&FileBytes[2];
+        FileText.LengthInChars = (FileSize - 2) / sizeof(WCHAR);
+    } else {
+        Index = 0;
+        if (FileSize >= 3 && FileBytes[0] == 0xEF && FileBytes[1] == 0xBB && FileBytes[2] == 0xBF) {
+            Document->Encoding = CP_UTF8;
+            Document->ByteOrderMark = TRUE;
+            Index = 3;
+        }
+
+        if (FileSize > Index) {
+            if (!YoriLibAllocateString(&FileText, FileSize - Index)) {
+                YoriLibFree(FileBytes);
+                YoriLibIniClose(Document);
+                return FALSE;
+            }
+
+            FileText.LengthInChars = MultiByteToWideChar(Document->Encoding, 0, (LPCSTR)&FileBytes[Index], FileSize - Index, FileText.StartOfString, FileText.LengthAllocated);
+
+            //
+            //  If the file can't be converted, fail rather than returning
+            //  an empty document that could later overwrite it.
+            //
+
+            if (FileText.LengthInChars == 0) {
+                YoriLibFreeStringContents(&FileText);
+                YoriLibFree(FileBytes);
+                YoriLibIniClose(Document);
+                return FALSE;
+            }
+        }
+    }
+
+    Result = YoriLibIniParse(Document, &FileText);
+    YoriLibFreeStringContents(&FileText);
+    YoriLibFree(FileBytes);
+
+    if (!Result) {
+        YoriLibIniClose(Document);
+        return FALSE;
+    }
+
+    *IniDocument = Document;
+    return TRUE;
+}
+
+/**
+ Query a value from an INI document.  This behaves like
+ GetPrivateProfileString, except that a section and key must be specified.
+
+ @param IniDocument Pointer to the document.
+
+ @param Section Pointer to the name of the section containing the value.
+
+ @param Key Pointer to the key of the value.
+
+ @param Default Optionally points to a string to return if the value is not
+        found.  If NULL, an empty string is returned.
+
+ @param Buffer Pointer to a buffer to receive the value.  This is always
+        NULL terminated, and is truncated if the buffer is too small.
+
+ @param BufferLength The length of Buffer, in characters.
+
+ @return The number of characters copied to Buffer, not including the NULL
+         terminator.
+ */
+DWORD
+YoriLibIniGetString(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __in LPCTSTR Key,
+    __in_opt LPCTSTR Default,
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength
+    )
+{
+    PYORI_LIB_INI_LINE Line;
+    YORI_STRING Value;
+
+    if (BufferLength == 0) {
+        return 0;
+    }
+
+    Line = YoriLibIniFindLine((PYORI_LIB_INI_DOCUMENT)IniDocument, Section, Key);
+    if (Line != NULL) {
+        memcpy(&Value, &Line->Value, sizeof(YORI_STRING));
+
+        //
+        //  Like the system, remove a single pair of matching quotes around
+        //  the value.
+        //
+
+        if (Value.LengthInChars >= 2 &&
+            (Value.StartOfString[0] == '"' || Value.StartOfString[0] == '\'') &&
+            Value.StartOfString[Value.LengthInChars - 1] == Value.StartOfString[0]) {
+
+            Value.StartOfString++;
+            Value.LengthInChars -= 2;
+        }
+    } else if (Default != NULL) {
+        YoriLibConstantString(&Value, Default);
+    } else {
+        YoriLibInitEmptyString(&Value);
+    }
+
+    if (Value.LengthInChars >= BufferLength) {
+        Value.LengthInChars = BufferLength - 1;
+    }
+
+    memcpy(Buffer, Value.StartOfString, Value.LengthInChars * sizeof(TCHAR));
+    Buffer[Value.LengthInChars] = '\0';
+    return Value.LengthInChars;
+}
+
+/**
+ Query a numeric value from an INI document.  This behaves like
+ GetPrivateProfileInt.
+
+ @param IniDocument Pointer to the document.
+
+ @param Section Pointer to the name of the section containing the value.
+
+ @param Key Pointer to the key of the value.
+
+ @param Default The value to return if the key is not found.
+
+ @return The numeric value of the key, Default if the key is not found, or
+         zero if the value is not a positive number.
+ */
+DWORD
+YoriLibIniGetInt(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __in LPCTSTR Key,
+    __in DWORD Default
+    )
+{
+    PYORI_LIB_INI_LINE Line;
+    LONGLONG Number;
+    DWORD CharsConsumed;
+
+    Line = YoriLibIniFindLine((PYORI_LIB_INI_DOCUMENT)IniDocument, Section, Key);
+    if (Line == NULL) {
+        return Default;
+    }
+
+    if (!YoriLibStringToNumber(&Line->Value, FALSE, &Number, &CharsConsumed) ||
+        CharsConsumed == 0 ||
+        Number < 0) {
+
+        return 0;
+    }
+
+    return (DWORD)Number;
+}
+
+/**
+ Copy a string into a buffer of NULL terminated strings which is itself
+ terminated by an additional NULL, if it fits.
+
+ @param Buffer Pointer to the buffer.
+
+ @param BufferLength The length of Buffer, in characters.
+
+ @param CharsUsed On input, the number of characters already in the buffer,
+        excluding the final terminator.  Updated on successful completion
+        to include the new string and its NULL terminator.
+
+ @param First Pointer to the first part of the string to copy.
+
+ @param Second Optionally points to a second part of the string to copy,
+        which is separated from the first part with an equals sign.
+
+ @return TRUE if the string was copied, FALSE if it does not fit.
+ */
+__success(return)
+BOOL
+YoriLibIniAppendToMultiString(
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength,
+    __inout PDWORD CharsUsed,
+    __in PCYORI_STRING First,
+    __in_opt PCYORI_STRING Second
+    )
+{
+    DWORD Length;
+    DWORD Offset;
+
+    Length = First->LengthInChars;
+    if (Second != NULL) {
+        Length = Length + 1 + Second->LengthInChars;
+    }
+
+    if (*CharsUsed + Length + 2 > BufferLength) {
+        return FALSE;
+    }
+
+    Offset = *CharsUsed;
+    memcpy(&Buffer[Offset], First->StartOfString, First->LengthInChars * sizeof(TCHAR));
+    Offset = Offset + First->LengthInChars;
+    if (Second != NULL) {
+        Buffer[Offset] = '=';
+        Offset++;
+        memcpy(&Buffer[Offset], Second->StartOfString, Second->LengthInChars * sizeof(TCHAR));
+        Offset = Offset + Second->LengthInChars;
+    }
+    Buffer[Offset] = '\0';
+    Offset++;
+    Buffer[Offset] = '\0';
+
+    *CharsUsed = Offset;
+    return TRUE;
+}
+
+/**
+ Query all of the key value pairs within a section of an INI document.
+ This behaves like GetPrivateProfileSection, returning a series of NULL
+ terminated key=value strings followed by an additional NULL.  Any entries
+ which do not fit in the buffer are omitted.
+
+ @param IniDocument Pointer to the document.
+
+ @param Section Pointer to the name of the section.
+
+ @param Buffer Pointer to a buffer to receive the key value pairs.
+
+ @param BufferLength The length of Buffer, in characters.
+
+ @return The number of characters copied to Buffer, not including the final
+         NULL terminator.
+ */
+DWORD
+YoriLibIniGetSection(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength
+    )
+{
+    PYORI_LIB_INI_SECTION IniSection;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+    YORI_STRING Trimmed;
+    DWORD CharsUsed;
+
+    if (BufferLength < 2) {
+        return 0;
+    }
+
+    CharsUsed = 0;
+    Buffer[0] = '\0';
+    Buffer[1] = '\0';
+
+    IniSection = YoriLibIniFindSection((PYORI_LIB_INI_DOCUMENT)IniDocument, Section);
+    if (IniSection == NULL) {
+        return 0;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&IniSection->LineList, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&IniSection->LineList, ListEntry);
+
+        if (Line->Key.LengthInChars > 0) {
+            if (!YoriLibIniAppendToMultiString(Buffer, BufferLength, &CharsUsed, &Line->Key, &Line->Value)) {
+                break;
+            }
+        } else {
+            memcpy(&Trimmed, &Line->Text, sizeof(YORI_STRING));
+            YoriLibIniTrimWhitespace(&Trimmed);
+            if (Trimmed.LengthInChars == 0 || Trimmed.StartOfString[0] == ';') {
+                continue;
+            }
+            if (!YoriLibIniAppendToMultiString(Buffer, BufferLength, &CharsUsed, &Trimmed, NULL)) {
+                break;
+            }
+        }
+    }
+
+    return CharsUsed;
+}
+
+/**
+ Query the names of all sections within an INI document.  This behaves like
+ GetPrivateProfileSectionNames, returning a series of NULL terminated names
+ followed by an additional NULL.  Any names which do not fit in the buffer
+ are omitted.
+
+ @param IniDocument Pointer to the document.
+
+ @param Buffer Pointer to a buffer to receive the section names.
+
+ @param BufferLength The length of Buffer, in characters.
+
+ @return The number of characters copied to Buffer, not including the final
+         NULL terminator.
+ */
+DWORD
+YoriLibIniGetSectionNames(
+    __in PVOID IniDocument,
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength
+    )
+{
+    PYORI_LIB_INI_DOCUMENT Document;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_SECTION Section;
+    DWORD CharsUsed;
+
+    if (BufferLength < 2) {
+        return 0;
+    }
+
+    Document = (PYORI_LIB_INI_DOCUMENT)IniDocument;
+    CharsUsed = 0;
+    Buffer[0] = '\0';
+    Buffer[1] = '\0';
+
+    ListEntry = YoriLibGetNextListEntry(&Document->SectionList, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Document->SectionList, ListEntry);
+
+        //
+        //  Sections which duplicate the name of an earlier section cannot
+        //  be queried, so don't report them.
+        //
+
+        if (Section->HashEntry.HashTable == NULL) {
+            continue;
+        }
+
+        if (!YoriLibIniAppendToMultiString(Buffer, BufferLength, &CharsUsed, &Section->Name, NULL)) {
+            break;
+        }
+    }
+
+    return CharsUsed;
+}
+
+/**
+ Update a value within an INI document.  This behaves like
+ WritePrivateProfileString, except that the change is made in memory and
+ is not written to the file until @ref YoriLibIniCommit is called.
+
+ @param IniDocument Pointer to the document.
+
+ @param Section Pointer to the name of the section to update.  The section
+        is created if it does not exist.
+
+ @param Key Optionally points to the key to update.  If NULL, the entire
+        section is deleted.
+
+ @param Value Optionally points to the value to set.  If NULL, the key is
+        deleted.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniSetString(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __in_opt LPCTSTR Key,
+    __in_opt LPCTSTR Value
+    )
+{
+    PYORI_LIB_INI_DOCUMENT Document;
+    PYORI_LIB_INI_SECTION IniSection;
+    PYORI_LIB_INI_LINE ExistingLine;
+    PYORI_LIB_INI_LINE Line;
+    PYORI_LIST_ENTRY PreviousEntry;
+    YORI_STRING Text;
+    YORI_STRING KeyName;
+    YORI_STRING Trimmed;
+
+    Document = (PYORI_LIB_INI_DOCUMENT)IniDocument;
+    IniSection = YoriLibIniFindSection(Document, Section);
+
+    if (Key == NULL) {
+        if (IniSection != NULL) {
+            YoriLibIniFreeSection(IniSection);
+            Document->Modified = TRUE;
+        }
+        return TRUE;
+    }
+
+    ExistingLine = NULL;
+    if (IniSection != NULL) {
+        ExistingLine = YoriLibIniFindLine(Document, Section, Key);
+    }
+
+    if (Value == NULL) {
+        if (ExistingLine != NULL) {
+            YoriLibIniFreeLine(ExistingLine);
+            Document->Modified = TRUE;
+        }
+        return TRUE;
+    }
+
+    if (IniSection == NULL) {
+        YoriLibInitEmptyString(&Text);
+        YoriLibYPrintf(&Text, _T("[%s]"), Section);
+        if (Text.StartOfString == NULL) {
+            return FALSE;
+        }
+
+        IniSection = YoriLibIniAllocateSection(&Text);
+        YoriLibFreeStringContents(&Text);
+        if (IniSection == NULL) {
+            return FALSE;
+        }
+
+        if (!YoriLibIniAppendSection(Document, IniSection)) {
+            YoriLibFreeEmptyHashTable(IniSection->Keys);
+            YoriLibFree(IniSection);
+            return FALSE;
+        }
+    }
+
+    //
+    //  Retain the existing spelling of the key when updating it.
+    //
+
+    if (ExistingLine != NULL) {
+        memcpy(&KeyName, &ExistingLine->Key, sizeof(YORI_STRING));
+    } else {
+        YoriLibConstantString(&KeyName, Key);
+    }
+
+    YoriLibInitEmptyString(&Text);
+    YoriLibYPrintf(&Text, _T("%y=%s"), &KeyName, Value);
+    if (Text.StartOfString == NULL) {
+        return FALSE;
+    }
+
+    Line = YoriLibIniAllocateLine(&Text);
+    YoriLibFreeStringContents(&Text);
+    if (Line == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  An existing line is replaced in place.  A new key is placed after
+    //  the last line in the section which is not blank or a comment.
+    //
+
+    if (ExistingLine != NULL) {
+        PreviousEntry = ExistingLine->ListEntry.Prev;
+        YoriLibIniFreeLine(ExistingLine);
+    } else {
+        PreviousEntry = YoriLibGetPreviousListEntry(&IniSection->LineList, NULL);
+        while (PreviousEntry != NULL) {
+            memcpy(&Trimmed, &CONTAINING_RECORD(PreviousEntry, YORI_LIB_INI_LINE, ListEntry)->Text, sizeof(YORI_STRING));
+            YoriLibIniTrimWhitespace(&Trimmed);
+            if (Trimmed.LengthInChars > 0 && Trimmed.StartOfString[0] != ';') {
+                break;
+            }
+            PreviousEntry = YoriLibGetPreviousListEntry(&IniSection->LineList, PreviousEntry);
+        }
+
+        if (PreviousEntry == NULL) {
+            PreviousEntry = &IniSection->LineList;
+        }
+    }
+
+    if (!YoriLibIniInsertLine(IniSection, PreviousEntry, Line)) {
+        YoriLibFree(Line);
+        return FALSE;
+    }
+
+    Document->Modified = TRUE;
+    return TRUE;
+}
+
+/**
+ Append the text of a section, including its lines, to a string.  The
+ string is assumed to be large enough.
+
+ @param Section Pointer to the section.
+
+ @param FileText Pointer to the string to append to.
+ */
+VOID
+YoriLibIniAppendSectionText(
+    __in PYORI_LIB_INI_SECTION Section,
+    __inout PYORI_STRING FileText
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+
+    if (Section->Text.LengthInChars > 0) {
+        memcpy(&FileText->StartOfString[FileText->LengthInChars], Section->Text.StartOfString, Section->Text.LengthInChars * sizeof(TCHAR));
+        FileText->LengthInChars = FileText->LengthInChars + Section->Text.LengthInChars;
+        FileText->StartOfString[FileText->LengthInChars++] = '\r';
+        FileText->StartOfString[FileText->LengthInChars++] = '\n';
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Section->LineList, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        memcpy(&FileText->StartOfString[FileText->LengthInChars], Line->Text.StartOfString, Line->Text.LengthInChars * sizeof(TCHAR));
+        FileText->LengthInChars = FileText->LengthInChars + Line->Text.LengthInChars;
+        FileText->StartOfString[FileText->LengthInChars++] = '\r';
+        FileText->StartOfString[FileText->LengthInChars++] = '\n';
+        ListEntry = YoriLibGetNextListEntry(&Section->LineList, ListEntry);
+    }
+}
+
+/**
+ Return the number of characters needed to write a section, including its
+ lines.
+
+ @param Section Pointer to the section.
+
+ @return The number of characters needed.
+ */
+DWORD
+YoriLibIniGetSectionTextLength(
+    __in PYORI_LIB_INI_SECTION Section
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_LINE Line;
+    DWORD Length;
+
+    Length = 0;
+    if (Section->Text.LengthInChars > 0) {
+        Length = Section->Text.LengthInChars + 2;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Section->LineList, NULL);
+    while (ListEntry != NULL) {
+        Line = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_LINE, ListEntry);
+        Length = Length + Line->Text.LengthInChars + 2;
+        ListEntry = YoriLibGetNextListEntry(&Section->LineList, ListEntry);
+    }
+
+    return Length;
+}
+
+/**
+ Write all of the data to a file handle.  A write which succeeds without
+ writing anything is treated as a failure, since retrying it would not make
+ progress.
+
+ @param FileHandle The handle to write to.
+
+ @param Buffer Pointer to the data to write.
+
+ @param BufferLength The number of bytes to write.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniWriteBuffer(
+    __in HANDLE FileHandle,
+    __in PVOID Buffer,
+    __in DWORD BufferLength
+    )
+{
+    DWORD BytesWritten;
+    DWORD Offset;
+
+    for (Offset = 0; Offset < BufferLength; Offset += BytesWritten) {
+        if (!WriteFile(FileHandle, (PUCHAR)Buffer + Offset, BufferLength - Offset, &BytesWritten, NULL) ||
+            BytesWritten == 0) {
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Write the contents of an INI file to a file handle, starting from the
+ beginning of the file, and truncate the file at the end of the contents.
+
+ @param FileHandle The handle to write to.
+
+ @param ByteOrderMark Pointer to the byte order mark to write before the
+        contents.
+
+ @param ByteOrderMarkLength The number of bytes in the byte order mark, which
+        can be zero.
+
+ @param FileBytes Pointer to the contents in the file's encoding.
+
+ @param FileSize The number of bytes of contents.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniWriteContents(
+    __in HANDLE FileHandle,
+    __in PUCHAR ByteOrderMark,
+    __in DWORD ByteOrderMarkLength,
+    __in PVOID FileBytes,
+    __in DWORD FileSize
+    )
+{
+    if (ByteOrderMarkLength > 0 &&
+        !YoriLibIniWriteBuffer(FileHandle, ByteOrderMark, ByteOrderMarkLength)) {
+
+        return FALSE;
+    }
+
+    if (!YoriLibIniWriteBuffer(FileHandle, FileBytes, FileSize)) {
+        return FALSE;
+    }
+
+    if (!SetEndOfFile(FileHandle)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Write any modifications to an INI document back to its file.  The file is
+ written in its original encoding.  Where possible, the new contents are
+ written to a temporary file in the same directory which then replaces the
+ original file, so that other processes never observe a partially written
+ file.  The replaced file keeps its security, attributes and streams.
+
+ @param IniDocument Pointer to the document.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibIniCommit(
+    __in PVOID IniDocument
+    )
+{
+    PYORI_LIB_INI_DOCUMENT Document;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIB_INI_SECTION Section;
+    YORI_STRING FileText;
+    YORI_STRING Directory;
+    YORI_STRING Prefix;
+    YORI_STRING TempFileName;
+    HANDLE FileHandle;
+    PVOID FileBytes;
+    DWORD FileSize;
+    DWORD Length;
+    LPTSTR FinalSeperator;
+    UCHAR ByteOrderMark[3];
+    DWORD ByteOrderMarkLength;
+    BOOL TargetExists;
+    BOOL WriteInPlace;
+    BOOL Result;
+
+    Document = (PYORI_LIB_INI_DOCUMENT)IniDocument;
+    if (!Document->Modified) {
+        return TRUE;
+    }
+
+    //
+    //  Generate the text of the file.
+    //
+
+    Length = YoriLibIniGetSectionTextLength(&Document->Preamble);
+    ListEntry = YoriLibGetNextListEntry(&Document->SectionList, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        Length = Length + YoriLibIniGetSectionTextLength(Section);
+        ListEntry = YoriLibGetNextListEntry(&Document->SectionList, ListEntry);
+    }
+
+    if (!YoriLibAllocateString(&FileText, Length + 1)) {
+        return FALSE;
+    }
+
+    YoriLibIniAppendSectionText(&Document->Preamble, &FileText);
+    ListEntry = YoriLibGetNextListEntry(&Document->SectionList, NULL);
+    while (ListEntry != NULL) {
+        Section = CONTAINING_RECORD(ListEntry, YORI_LIB_INI_SECTION, ListEntry);
+        YoriLibIniAppendSectionText(Section, &FileText);
+        ListEntry = YoriLibGetNextListEntry(&Document->SectionList, ListEntry);
+    }
+
+    ASSERT(FileText.LengthInChars == Length);
+
+    //
+    //  Convert it to the file's encoding.
+    //
+
+    ByteOrderMarkLength = 0;
+    if (Document->Encoding == CP_UTF16) {
+        FileBytes = FileText.StartOfString;
+        FileSize = FileText.LengthInChars * sizeof(WCHAR);
+        ByteOrderMark[0] = 0xFF;
+        ByteOrderMark[1] = 0xFE;
+        ByteOrderMarkLength = 2;
+    } else {
+        if (Document->ByteOrderMark) {
+            ByteOrderMark[0] = 0xEF;
+            ByteOrderMark[1] = 0xBB;
+            ByteOrderMark[2] = 0xBF;
+            ByteOrderMarkLength = 3;
+        }
+
+        FileSize = 0;
+        FileBytes = NULL;
+        if (FileText.LengthInChars > 0) {
+            FileSize = WideCharToMultiByte(Document->Encoding, 0, FileText.StartOfString, FileText.LengthInChars, NULL, 0, NULL, NULL);
+            FileBytes = YoriLibMalloc(FileSize);
+            if (FileBytes == NULL) {
+                YoriLibFreeStringContents(&FileText);
+                return FALSE;
+            }
+            FileSize = WideCharToMultiByte(Document->Encoding, 0, FileText.StartOfString, FileText.LengthInChars, FileBytes, FileSize, NULL, NULL);
+        }
+    }
+
+    //
+    //  Write to a temporary file alongside the file and have it replace the
+    //  file, so the original contents remain intact until the new contents
+    //  are complete.  If the file already exists this requires ReplaceFile,
+    //  which preserves its security, attributes and streams; without it, or
+    //  if the directory can't be written to, the file is rewritten in place
+    //  which also preserves them.
+    //
+
+    Result = FALSE;
+    WriteInPlace = TRUE;
+    YoriLibInitEmptyString(&TempFileName);
+    YoriLibLoadKernel32Functions();
+    TargetExists = (GetFileAttributes(Document->FileName.StartOfString) != (DWORD)-1);
+
+    if (!TargetExists || DllKernel32.pReplaceFileW != NULL) {
+        YoriLibInitEmptyString(&Directory);
+        Directory.StartOfString = Document->FileName.StartOfString;
+        FinalSeperator = YoriLibFindRightMostCharacter(&Document->FileName, '\\');
+        if (FinalSeperator != NULL) {
+            Directory.LengthInChars = (DWORD)(FinalSeperator - Document->FileName.StartOfString);
+        } else {
+            YoriLibConstantString(&Directory, _T("."));
+        }
+
+        YoriLibConstantString(&Prefix, _T("INI"));
+        if (YoriLibGetTempFileName(&Directory, &Prefix, &FileHandle, &TempFileName)) {
+
+            //
+            //  If the temporary file can't be written, the volume is full
+            //  or failing, and writing in place would only leave the file
+            //  partially written.
+            //
+
+            WriteInPlace = FALSE;
+            Result = YoriLibIniWriteContents(FileHandle, ByteOrderMark, ByteOrderMarkLength, FileBytes, FileSize);
+            CloseHandle(FileHandle);
+
+            if (Result) {
+                if (TargetExists) {
+                    if (!DllKernel32.pReplaceFileW(Document->FileName.StartOfString, TempFileName.StartOfString, NULL, REPLACEFILE_IGNORE_MERGE_ERRORS, NULL, NULL)) {
+                        Result = FALSE;
+                        WriteInPlace = TRUE;
+                    }
+                } else if (!MoveFileEx(TempFileName.StartOfString, Document->FileName.StartOfString, MOVEFILE_REPLACE_EXISTING)) {
+                    Result = FALSE;
+                }
+            }
+
+            if (!Result) {
+                DeleteFile(TempFileName.StartOfString);
+            }
+        }
+    }
+
+    if (WriteInPlace && !Result) {
+        FileHandle = CreateFile(Document->FileName.StartOfString,
+                                GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL);
+
+        if (FileHandle != INVALID_HANDLE_VALUE) {
+            Result = YoriLibIniWriteContents(FileHandle, ByteOrderMark, ByteOrderMarkLength, FileBytes, FileSize);
+            CloseHandle(FileHandle);
+        }
+    }
+
+    if (FileBytes != NULL && FileBytes != FileText.StartOfString) {
+        YoriLibFree(FileBytes);
+    }
+    YoriLibFreeStringContents(&TempFileName);
+    YoriLibFreeStringContents(&FileText);
+
+    if (Result) {
+        Document->Modified = FALSE;
+    }
+
+    return Result;
+}
+
+// vim:sw=4:ts=4:et:
@@ -27,6 +27,18 @@
 #include "yoripch.h"
 #include "yorilib.h"
 
+#if defined(_M_AMD64) && defined(_MSC_VER) && (_MSC_VER >= 1400)
+#include <emmintrin.h>
+
+/**
+ Set to nonzero if the compiler can generate SSE2 instructions, which are
+ always available on AMD64.
+ */
+#define YORI_LIB_LINE_READ_SSE2 1
+#else
+#define YORI_LIB_LINE_READ_SSE2 0
+#endif
+
 /**
  Context to be passed between repeated line read calls to contain data
  that doesn't constitute a whole line but cannot be left in the incoming
@@ -80,6 +92,56 @@ typedef struct _YORI_LIB_LINE_READ_CONTEXT {
 
 } YORI_LIB_LINE_READ_CONTEXT, *PYORI_LIB_LINE_READ_CONTEXT;
 
+/**
+ Returns TRUE if a buffer consists entirely of 7 bit characters.  This
+ examines a pointer sized word at a time once the buffer is aligned.
+
+ @param Buffer Pointer to the buffer to check.
+
+ @param Length The number of bytes in the buffer.
+
+ @return TRUE if every byte in the buffer is less than 0x80, FALSE if any
+         byte has the high bit set.
+ */
+BOOL
+YoriLibIsBufferAscii(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD_PTR Combined;
+    DWORD_PTR HighBits;
+
+    Index = 0;
+    while (Index < Length && ((DWORD_PTR)&Buffer[Index] & (sizeof(DWORD_PTR) - 1)) != 0) {
+        if (Buffer[Index] >= 0x80) {
+            return FALSE;
+        }
+        Index++;
+    }
+
+    HighBits = ((DWORD_PTR)-1 / 0xFF) * 0x80;
+    Combined = 0;
+    while (Index + sizeof(DWORD_PTR) <= Length) {
+        Combined = Combined | *(PDWORD_PTR)&Buffer[Index];
+        Index += sizeof(DWORD_PTR);
+    }
+
+    if ((Combined & HighBits) != 0) {
+        return FALSE;
+    }
+
+    while (Index < Length) {
+        if (Buffer[Index] >= 0x80) {
+            return FALSE;
+        }
+        Index++;
+    }
+
+    return TRUE;
+}
+
 /**
  Copy the contents of a line into a user specified buffer.  If the buffer
  is not large enough, it is reallocated.  This function performs encoding
@@ -103,9 +165,22 @@ YoriLibCopyLineToUserBufferW(
     )
 {
     DWORD CharsNeeded;
+    DWORD Index;
+    BOOL Ascii;
+
+    //
+    //  UTF-8 text is commonly entirely 7 bit, where each byte is a single
+    //  character and can be widened directly, without asking the system
+    //  to size and convert the line.
+    //
 
+    Ascii = FALSE;
     if (CharsToCopy == 0) {
         CharsNeeded = 1;
+    } else if (YoriLibGetMultibyteInputEncoding() == CP_UTF8 &&
+               YoriLibIsBufferAscii((PUCHAR)SourceBuffer, CharsToCopy)) {
+        Ascii = TRUE;
+        CharsNeeded = CharsToCopy + 1;
     } else {
         CharsNeeded = YoriLibGetMultibyteInputSizeNeeded(SourceBuffer, CharsToCopy) + 1;
     }
@@ -117,7 +192,11 @@ YoriLibCopyLineToUserBufferW(
         }
     }
 
-    if (CharsToCopy > 0) {
+    if (Ascii) {
+        for (Index = 0; Index < CharsToCopy; Index++) {
+            UserString->StartOfString[Index] = (TCHAR)(UCHAR)SourceBuffer[Index];
+        }
+    } else if (CharsToCopy > 0) {
         YoriLibMultibyteInput(SourceBuffer,
                               CharsToCopy,
                               UserString->StartOfString,
@@ -129,6 +208,173 @@ YoriLibCopyLineToUserBufferW(
     return TRUE;
 }
 
+/**
+ Return the offset of the first carriage return or line feed in a buffer
+ of 8 bit characters.  On AMD64 this compares sixteen bytes at a time with
+ SSE2, and elsewhere compares a pointer sized word at a time.
+
+ @param Buffer Pointer to the buffer to search.
+
+ @param Length The number of characters in the buffer.
+
+ @return The index of the first line break character, or Length if the
+         buffer does not contain one.
+ */
+DWORD
+YoriLibFindLineBreakA(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+#if YORI_LIB_LINE_READ_SSE2
+    __m128i Cr;
+    __m128i Lf;
+    __m128i Chunk;
+    DWORD Mask;
+#else
+    DWORD_PTR Ones;
+    DWORD_PTR HighBits;
+    DWORD_PTR CrWord;
+    DWORD_PTR LfWord;
+    DWORD_PTR Word;
+#endif
+
+    Index = 0;
+
+#if YORI_LIB_LINE_READ_SSE2
+    Cr = _mm_set1_epi8(0xD);
+    Lf = _mm_set1_epi8(0xA);
+    while (Index + sizeof(__m128i) <= Length) {
+        Chunk = _mm_loadu_si128((__m128i *)&Buffer[Index]);
+        Mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(Chunk, Cr), _mm_cmpeq_epi8(Chunk, Lf)));
+        if (Mask != 0) {
+            while ((Mask & 1) == 0) {
+                Mask = Mask >> 1;
+                Index++;
+            }
+            return Index;
+        }
+        Index += sizeof(__m128i);
+    }
+#else
+    while (Index < Length && ((DWORD_PTR)&Buffer[Index] & (sizeof(DWORD_PTR) - 1)) != 0) {
+        if (Buffer[Index] == 0xD || Buffer[Index] == 0xA) {
+            return Index;
+        }
+        Index++;
+    }
+
+    //
+    //  XOR each word with a repeated line break character, so a matching
+    //  byte becomes zero, and detect a zero byte by checking for a borrow.
+    //
+
+    Ones = (DWORD_PTR)-1 / 0xFF;
+    HighBits = Ones * 0x80;
+    CrWord = Ones * 0xD;
+    LfWord = Ones * 0xA;
+    while (Index + sizeof(DWORD_PTR) <= Length) {
+        Word = *(PDWORD_PTR)&Buffer[Index];
+        if (((((Word ^ CrWord) - Ones) & ~(Word ^ CrWord)) |
+             (((Word ^ LfWord) - Ones) & ~(Word ^ LfWord))) & HighBits) {
+            break;
+        }
+        Index += sizeof(DWORD_PTR);
+    }
+#endif
+
+    while (Index < Length) {
+        if (Buffer[Index] == 0xD || Buffer[Index] == 0xA) {
+            break;
+        }
+        Index++;
+    }
+
+    return Index;
+}
+
+/**
+ Return the offset of the first carriage return or line feed in a buffer
+ of 16 bit characters.  On AMD64 this compares eight characters at a time
+ with SSE2, and elsewhere compares a pointer sized word at a time.
+
+ @param Buffer Pointer to the buffer to search.
+
+ @param Length The number of characters in the buffer.
+
+ @return The index of the first line break character, or Length if the
+         buffer does not contain one.
+ */
+DWORD
+YoriLibFindLineBreakW(
+    __in PWCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+#if YORI_LIB_LINE_READ_SSE2
+    __m128i Cr;
+    __m128i Lf;
+    __m128i Chunk;
+    DWORD Mask;
+#else
+    DWORD_PTR Ones;
+    DWORD_PTR HighBits;
+    DWORD_PTR CrWord;
+    DWORD_PTR LfWord;
+    DWORD_PTR Word;
+#endif
+
+    Index = 0;
+
+#if YORI_LIB_LINE_READ_SSE2
+    Cr = _mm_set1_epi16(0xD);
+    Lf = _mm_set1_epi16(0xA);
+    while (Index + sizeof(__m128i) / sizeof(WCHAR) <= Length) {
+        Chunk = _mm_loadu_si128((__m128i *)&Buffer[Index]);
+        Mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(Chunk, Cr), _mm_cmpeq_epi16(Chunk, Lf)));
+        if (Mask != 0) {
+            while ((Mask & 3) == 0) {
+                Mask = Mask >> 2;
+                Index++;
+            }
+            return Index;
+        }
+        Index += sizeof(__m128i) / sizeof(WCHAR);
+    }
+#else
+    while (Index < Length && ((DWORD_PTR)&Buffer[Index] & (sizeof(DWORD_PTR) - 1)) != 0) {
+        if (Buffer[Index] == 0xD || Buffer[Index] == 0xA) {
+            return Index;
+        }
+        Index++;
+    }
+
+    Ones = (DWORD_PTR)-1 / 0xFFFF;
+    HighBits = Ones * 0x8000;
+    CrWord = Ones * 0xD;
+    LfWord = Ones * 0xA;
+    while (Index + sizeof(DWORD_PTR) / sizeof(WCHAR) <= Length) {
+        Word = *(PDWORD_PTR)&Buffer[Index];
+        if (((((Word ^ CrWord) - Ones) & ~(Word ^ CrWord)) |
+             (((Word ^ LfWord) - Ones) & ~(Word ^ LfWord))) & HighBits) {
+            break;
+        }
+        Index += sizeof(DWORD_PTR) / sizeof(WCHAR);
+    }
+#endif
+
+    while (Index < Length) {
+        if (Buffer[Index] == 0xD || Buffer[Index] == 0xA) {
+            break;
+        }
+        Index++;
+    }
+
+    return Index;
+}
+
 /**
  Check for the existence of a byte order mark in the string, and return how
  many bytes are in it.
@@ -175,12 +421,12 @@ YoriLibBytesInBom(
 
 
 /**
- Read a line from an input stream.
+ Read a line from an input stream, returning it as a view into the buffer
+ that the line was read into.  The view remains valid until the next call
+ with the same context.
 
- @param UserString Pointer to a string to be updated to contain data for a
-        line.  This must be initialized by the caller and the caller's buffer
-        will be used if it is large enough.  If not, this function may
-        reallocate the string to point to a new buffer.
+ @param LineView On successful completion, populated with the location and
+        length of the line, in the input encoding.
 
  @param Context Pointer to a PVOID sized block of memory that should be
         initialized to NULL for the first line read, and will be updated by
@@ -194,10 +440,13 @@ YoriLibBytesInBom(
  @param MaximumDelay Specifies the maximum amount of time to wait for a
         complete line.  This value can be INFINITE or a specified number of
         milliseconds.  If the timeout value is reached, TimeoutReached will
-        be set to true and the function will return NULL.
+        be set to true and the function will return FALSE.
 
  @param FileHandle Specifies the handle to the file to read the line from.
 
+ @param MinimumBufferLength Specifies the minimum size of the buffer to
+        allocate if this is the first call for the context.
+
  @param LineEnding On successful completion, set to indicate the string of
         characters used to terminate the line.  Can be YoriLibLineEndingNone
         to indicate no line end was found, which can happen if
@@ -208,15 +457,18 @@ YoriLibBytesInBom(
         the timeout value in MaximumDelay was reached.  If MaximumDelay is
         INFINITE, this cannot happen.
 
- @return Pointer to the Line buffer for success, NULL on failure.
+ @return TRUE to indicate a line was found, FALSE on failure or at the end
+         of the stream.
  */
-PVOID
-YoriLibReadLineToStringEx(
-    __in PYORI_STRING UserString,
+__success(return)
+BOOL
+YoriLibReadLineToViewInternal(
+    __out PYORI_LIB_LINE_VIEW LineView,
     __inout PVOID * Context,
     __in BOOL ReturnFinalNonTerminatedLine,
     __in DWORD MaximumDelay,
     __in HANDLE FileHandle,
+    __in DWORD MinimumBufferLength,
     __out PYORI_LIB_LINE_ENDING LineEnding,
     __out PBOOL TimeoutReached
     )
@@ -226,6 +478,7 @@ YoriLibReadLineToStringEx(
     DWORD BytesRead;
     DWORD CharsToCopy;
     DWORD CharsToSkip;
+    DWORD CharSize;
     BOOL BomFound = FALSE;
     BOOL TerminateProcessing;
     HANDLE HandleArray[2];
@@ -235,9 +488,14 @@ YoriLibReadLineToStringEx(
     DWORD DelayTime;
     DWORD CharsRemaining;
     DWORD CumulativeDelay;
+    PUCHAR Buffer;
+    PWCHAR WideBuffer;
+    WCHAR ThisChar;
+    WCHAR NextChar;
     YORI_LIB_LINE_ENDING LocalLineEnding;
 
     *TimeoutReached = FALSE;
+    *LineEnding = YoriLibLineEndingNone;
     FileType = GetFileType(FileHandle);
 
     //
@@ -247,9 +505,7 @@ YoriLibReadLineToStringEx(
     if (*Context == NULL) {
         ReadContext = YoriLibMalloc(sizeof(YORI_LIB_LINE_READ_CONTEXT));
         if (ReadContext == NULL) {
-            UserString->LengthInChars = 0;
-            *LineEnding = YoriLibLineEndingNone;
-            return NULL;
+            return FALSE;
         }
         *Context = ReadContext;
         ReadContext->PreviousBuffer = NULL;
@@ -266,7 +522,7 @@ YoriLibReadLineToStringEx(
     } else {
         ReadContext = *Context;
         if (ReadContext->Terminated) {
-            return NULL;
+            return FALSE;
         }
     }
 
@@ -275,19 +531,22 @@ YoriLibReadLineToStringEx(
     //
 
     if (ReadContext->PreviousBuffer == NULL) {
-        ReadContext->LengthOfBuffer = UserString->LengthAllocated;
+        ReadContext->LengthOfBuffer = MinimumBufferLength;
         if (ReadContext->LengthOfBuffer < 256 * 1024) {
             ReadContext->LengthOfBuffer = 256 * 1024;
         }
         ReadContext->PreviousBuffer = YoriLibMalloc(ReadContext->LengthOfBuffer);
         if (ReadContext->PreviousBuffer == NULL) {
-            UserString->LengthInChars = 0;
-            *LineEnding = YoriLibLineEndingNone;
             ReadContext->Terminated = TRUE;
-            return NULL;
+            return FALSE;
         }
     }
 
+    CharSize = sizeof(CHAR);
+    if (ReadContext->ReadWChars) {
+        CharSize = sizeof(WCHAR);
+    }
+
     do {
 
         BOOL ProcessThisLine;
@@ -295,112 +554,75 @@ YoriLibReadLineToStringEx(
 
         //
         //  Scan through the buffer looking for newlines.  If we find one,
-        //  copy the data back into the caller's buffer.  Copy any remaining
+        //  return the line to the caller.  If not, copy any remaining
         //  buffer back to the beginning of the holdover buffer, and
         //  decrement chars there accordingly.
         //
 
-        if (ReadContext->ReadWChars) {
-            PWCHAR WideBuffer = (PWCHAR)YoriLibAddToPointer(ReadContext->PreviousBuffer, ReadContext->CurrentBufferOffset);
-            CharsRemaining = (ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset) / sizeof(WCHAR);
-            for (Count = 0; Count < CharsRemaining; Count++) {
-                if (WideBuffer[Count] == 0xD ||
-                    WideBuffer[Count] == 0xA) {
-
-                    ProcessThisLine = TRUE;
-
-                    CharsToCopy = Count;
-                    LocalLineEnding = YoriLibLineEndingCR;
-                    if (WideBuffer[Count] == 0xD) {
-                        if ((Count + 1) * sizeof(WCHAR) < (ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset)) {
-                            if (WideBuffer[Count + 1] == 0xA) {
-                                Count++;
-                                LocalLineEnding = YoriLibLineEndingCRLF;
-                            }
-                        } else if (ReadContext->CurrentBufferOffset > 0) {
-                            ProcessThisLine = FALSE;
-                        }
-                    } else {
-                        LocalLineEnding = YoriLibLineEndingLF;
-                    }
+        Buffer = YoriLibAddToPointer(ReadContext->PreviousBuffer, ReadContext->CurrentBufferOffset);
+        WideBuffer = (PWCHAR)Buffer;
+        CharsRemaining = (ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset) / CharSize;
+        Count = 0;
+        while (Count < CharsRemaining) {
 
-                    Count++;
+            if (ReadContext->ReadWChars) {
+                Count = Count + YoriLibFindLineBreakW(&WideBuffer[Count], CharsRemaining - Count);
+            } else {
+                Count = Count + YoriLibFindLineBreakA(&Buffer[Count], CharsRemaining - Count);
+            }
 
-                    if (ProcessThisLine) {
+            if (Count >= CharsRemaining) {
+                break;
+            }
 
-                        CharsToSkip = 0;
-                        if (!BomFound && ReadContext->LinesRead == 0) {
-                            CharsToSkip = YoriLibBytesInBom(ReadContext->PreviousBuffer, CharsToCopy * sizeof(WCHAR));
-                            if (CharsToSkip > 0) {
-                                BomFound = TRUE;
-                                CharsToSkip = CharsToSkip / sizeof(WCHAR);
-                                CharsToCopy -= CharsToSkip;
-                            }
-                        }
-                        if (YoriLibCopyLineToUserBufferW(UserString, (LPSTR)&WideBuffer[CharsToSkip], CharsToCopy)) {
-                            ReadContext->CurrentBufferOffset += Count * sizeof(WCHAR);
-                            ReadContext->LinesRead++;
-                            *LineEnding = LocalLineEnding;
-                            return UserString->StartOfString;
-                        } else {
-                            UserString->LengthInChars = 0;
-                            *LineEnding = YoriLibLineEndingNone;
-                            ReadContext->Terminated = TRUE;
-                            return NULL;
-                        }
-                    }
-                }
+            ProcessThisLine = TRUE;
+
+            CharsToCopy = Count;
+            LocalLineEnding = YoriLibLineEndingCR;
+            if (ReadContext->ReadWChars) {
+                ThisChar = WideBuffer[Count];
+            } else {
+                ThisChar = Buffer[Count];
             }
-        } else {
-            PUCHAR Buffer = YoriLibAddToPointer(ReadContext->PreviousBuffer, ReadContext->CurrentBufferOffset);
-            CharsRemaining = ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset;
-            for (Count = 0; Count < CharsRemaining; Count++) {
-
-                if (Buffer[Count] == 0xD ||
-                    Buffer[Count] == 0xA) {
-
-                    ProcessThisLine = TRUE;
-
-                    CharsToCopy = Count;
-                    LocalLineEnding = YoriLibLineEndingCR;
-                    if (Buffer[Count] == 0xD) {
-                        if (Count + 1 < (ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset)) {
-                            if (Buffer[Count + 1] == 0xA) {
-                                Count++;
-                                LocalLineEnding = YoriLibLineEndingCRLF;
-                            }
-                        } else if (ReadContext->CurrentBufferOffset > 0) {
-                            ProcessThisLine = FALSE;
-                        }
+            if (ThisChar == 0xD) {
+                if (Count + 1 < CharsRemaining) {
+                    if (ReadContext->ReadWChars) {
+                        NextChar = WideBuffer[Count + 1];
                     } else {
-                        LocalLineEnding = YoriLibLineEndingLF;
+                        NextChar = Buffer[Count + 1];
+                    }
+                    if (NextChar == 0xA) {
+                        Count++;
+                        LocalLineEnding = YoriLibLineEndingCRLF;
                     }
+                } else if (ReadContext->CurrentBufferOffset > 0) {
+                    ProcessThisLine = FALSE;
+                }
+            } else {
+                LocalLineEnding = YoriLibLineEndingLF;
+            }
 
-                    Count++;
+            Count++;
 
-                    if (ProcessThisLine) {
+            if (ProcessThisLine) {
 
-                        CharsToSkip = 0;
-                        if (!BomFound && ReadContext->LinesRead == 0) {
-                            CharsToSkip = YoriLibBytesInBom(ReadContext->PreviousBuffer, CharsToCopy);
-                            if (CharsToSkip > 0) {
-                                BomFound = TRUE;
-                                CharsToCopy -= CharsToSkip;
-                            }
-                        }
-                        if (YoriLibCopyLineToUserBufferW(UserString, (LPSTR)&Buffer[CharsToSkip], CharsToCopy)) {
-                            ReadContext->CurrentBufferOffset += Count;
-                            ReadContext->LinesRead++;
-                            *LineEnding = LocalLineEnding;
-                            return UserString->StartOfString;
-                        } else {
-                            UserString->LengthInChars = 0;
-                            *LineEnding = YoriLibLineEndingNone;
-                            ReadContext->Terminated = TRUE;
-                            return NULL;
-                        }
+                CharsToSkip = 0;
+                if (!BomFound && ReadContext->LinesRead == 0) {
+                    CharsToSkip = YoriLibBytesInBom(ReadContext->PreviousBuffer, CharsToCopy * CharSize);
+                    if (CharsToSkip > 0) {
+                        BomFound = TRUE;
+                        CharsToSkip = CharsToSkip / CharSize;
+                        CharsToCopy -= CharsToSkip;
                     }
                 }
+
+                LineView->Buffer = YoriLibAddToPointer(Buffer, CharsToSkip * CharSize);
+                LineView->LengthInChars = CharsToCopy;
+                LineView->WideChars = ReadContext->ReadWChars;
+                ReadContext->CurrentBufferOffset += Count * CharSize;
+                ReadContext->LinesRead++;
+                *LineEnding = LocalLineEnding;
+                return TRUE;
             }
         }
 
@@ -423,12 +645,9 @@ YoriLibReadLineToStringEx(
         //
 
         if (ReadContext->LengthOfBuffer == ReadContext->BytesInBuffer) {
-            UserString->LengthInChars = 0;
-            *LineEnding = YoriLibLineEndingNone;
             ReadContext->Terminated = TRUE;
-            return NULL;
+            return FALSE;
         }
-
         //
         //  Wait for more data, or for cancellation if it's enabled.
         //
@@ -563,19 +782,16 @@ YoriLibReadLineToStringEx(
                             CharsToCopy -= CharsToSkip;
                         }
                     }
-                    if (ReadContext->ReadWChars) {
-                        CharsToCopy = CharsToCopy / sizeof(WCHAR);
-                    }
-                    if (YoriLibCopyLineToUserBufferW(UserString, &ReadContext->PreviousBuffer[CharsToSkip], CharsToCopy)) {
-                        ReadContext->BytesInBuffer = 0;
-                        *LineEnding = YoriLibLineEndingNone;
-                        return UserString->StartOfString;
-                    }
+
+                    LineView->Buffer = &ReadContext->PreviousBuffer[CharsToSkip];
+                    LineView->LengthInChars = CharsToCopy / CharSize;
+                    LineView->WideChars = ReadContext->ReadWChars;
+                    ReadContext->BytesInBuffer = 0;
+                    ReadContext->LinesRead++;
+                    return TRUE;
                 }
             }
-            UserString->LengthInChars = 0;
-            *LineEnding = YoriLibLineEndingNone;
-            return NULL;
+            return FALSE;
         }
 
         ReadContext->BytesInBuffer += BytesRead;
@@ -583,6 +799,177 @@ YoriLibReadLineToStringEx(
     } while(TRUE);
 }
 
+/**
+ Read a line from an input stream, returning it as a view into the buffer
+ that the line was read into.  This allows a caller to inspect lines in
+ their input encoding without copying them.  The view remains valid until
+ the next call with the same context, and @ref YoriLibLineViewToString can
+ be used to obtain a line in host encoding.
+
+ @param LineView On successful completion, populated with the location and
+        length of the line, in the input encoding.
+
+ @param Context Pointer to a PVOID sized block of memory that should be
+        initialized to NULL for the first line read, and will be updated by
+        this function.
+
+ @param ReturnFinalNonTerminatedLine If TRUE, treat any line at the end of the
+        stream without a line ending character to be a line to return.  If
+        FALSE, assume new input could arrive that means we just haven't
+        observed the line break yet.
+
+ @param MaximumDelay Specifies the maximum amount of time to wait for a
+        complete line.  This value can be INFINITE or a specified number of
+        milliseconds.  If the timeout value is reached, TimeoutReached will
+        be set to true and the function will return FALSE.
+
+ @param FileHandle Specifies the handle to the file to read the line from.
+
+ @param LineEnding On successful completion, set to indicate the string of
+        characters used to terminate the line.
+
+ @param TimeoutReached On successful completion, set to TRUE to indicate that
+        the timeout value in MaximumDelay was reached.
+
+ @return TRUE to indicate a line was found, FALSE on failure or at the end
+         of the stream.
+ */
+__success(return)
+BOOL
+YoriLibReadLineToViewEx(
+    __out PYORI_LIB_LINE_VIEW LineView,
+    __inout PVOID * Context,
+    __in BOOL ReturnFinalNonTerminatedLine,
+    __in DWORD MaximumDelay,
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_LINE_ENDING LineEnding,
+    __out PBOOL TimeoutReached
+    )
+{
+    return YoriLibReadLineToViewInternal(LineView, Context, ReturnFinalNonTerminatedLine, MaximumDelay, FileHandle, 0, LineEnding, TimeoutReached);
+}
+
+/**
+ Read a line from an input stream, returning it as a view into the buffer
+ that the line was read into.  The view remains valid until the next call
+ with the same context.
+
+ @param LineView On successful completion, populated with the location and
+        length of the line, in the input encoding.
+
+ @param Context Pointer to a PVOID sized block of memory that should be
+        initialized to NULL for the first line read, and will be updated by
+        this function.
+
+ @param FileHandle Specifies the handle to the file to read the line from.
+
+ @return TRUE to indicate a line was found, FALSE on failure or at the end
+         of the stream.
+ */
+__success(return)
+BOOL
+YoriLibReadLineToView(
+    __out PYORI_LIB_LINE_VIEW LineView,
+    __inout PVOID * Context,
+    __in HANDLE FileHandle
+    )
+{
+    YORI_LIB_LINE_ENDING LineEnding;
+    BOOL TimeoutReached;
+
+    return YoriLibReadLineToViewInternal(LineView, Context, TRUE, INFINITE, FileHandle, 0, &LineEnding, &TimeoutReached);
+}
+
+/**
+ Convert a line returned as a view into host encoding.
+
+ @param LineView Pointer to the line returned from
+        @ref YoriLibReadLineToView .
+
+ @param UserString Pointer to a string to be updated to contain the line.
+        This must be initialized by the caller and the caller's buffer will
+        be used if it is large enough.  If not, this function may reallocate
+        the string to point to a new buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibLineViewToString(
+    __in PYORI_LIB_LINE_VIEW LineView,
+    __inout PYORI_STRING UserString
+    )
+{
+    return YoriLibCopyLineToUserBufferW(UserString, LineView->Buffer, LineView->LengthInChars);
+}
+
+/**
+ Read a line from an input stream.
+
+ @param UserString Pointer to a string to be updated to contain data for a
+        line.  This must be initialized by the caller and the caller's buffer
+        will be used if it is large enough.  If not, this function may
+        reallocate the string to point to a new buffer.
+
+ @param Context Pointer to a PVOID sized block of memory that should be
+        initialized to NULL for the first line read, and will be updated by
+        this function.
+
+ @param ReturnFinalNonTerminatedLine If TRUE, treat any line at the end of the
+        stream without a line ending character to be a line to return.  If
+        FALSE, assume new input could arrive that means we just haven't
+        observed the line break yet.
+
+ @param MaximumDelay Specifies the maximum amount of time to wait for a
+        complete line.  This value can be INFINITE or a specified number of
+        milliseconds.  If the timeout value is reached, TimeoutReached will
+        be set to true and the function will return NULL.
+
+ @param FileHandle Specifies the handle to the file to read the line from.
+
+ @param LineEnding On successful completion, set to indicate the string of
+        characters used to terminate the line.  Can be YoriLibLineEndingNone
+        to indicate no line end was found, which can happen if
+        ReturnFinalNonTerminatedLine is TRUE or MaximumDelay is less than
+        infinite and a partial line was found.
+
+ @param TimeoutReached On successful completion, set to TRUE to indicate that
+        the timeout value in MaximumDelay was reached.  If MaximumDelay is
+        INFINITE, this cannot happen.
+
+ @return Pointer to the Line buffer for success, NULL on failure.
+ */
+PVOID
+YoriLibReadLineToStringEx(
+    __in PYORI_STRING UserString,
+    __inout PVOID * Context,
+    __in BOOL ReturnFinalNonTerminatedLine,
+    __in DWORD MaximumDelay,
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_LINE_ENDING LineEnding,
+    __out PBOOL TimeoutReached
+    )
+{
+    YORI_LIB_LINE_VIEW LineView;
+    PYORI_LIB_LINE_READ_CONTEXT ReadContext;
+
+    if (!YoriLibReadLineToViewInternal(&LineView, Context, ReturnFinalNonTerminatedLine, MaximumDelay, FileHandle, UserString->LengthAllocated, LineEnding, TimeoutReached)) {
+        UserString->LengthInChars = 0;
+        *LineEnding = YoriLibLineEndingNone;
+        return NULL;
+    }
+
+    if (!YoriLibCopyLineToUserBufferW(UserString, LineView.Buffer, LineView.LengthInChars)) {
+        ReadContext = *Context;
+        ReadContext->Terminated = TRUE;
+        UserString->LengthInChars = 0;
+        *LineEnding = YoriLibLineEndingNone;
+        return NULL;
+    }
+
+    return UserString->StartOfString;
+}
+
 /**
  Read a line from an input stream.
 
@@ -612,6 +999,66 @@ YoriLibReadLineToString(
     return YoriLibReadLineToStringEx(UserString, Context, TRUE, INFINITE, FileHandle, &LineEnding, &TimeoutReached);
 }
 
+/**
+ Returns TRUE if the next line can be returned from data that has already
+ been read from the stream, so reading it will not need to wait for the
+ source.  A caller reading from a pipe can use this to determine whether
+ to act on lines it has already received before the read blocks.
+
+ @param Context Pointer to the context used for previous line reads.  This
+        can be NULL if no line has been read.
+
+ @return TRUE if a complete line is buffered, FALSE if the next read needs
+         to read from the stream.
+ */
+BOOL
+YoriLibLineReadIsLineBuffered(
+    __in_opt PVOID Context
+    )
+{
+    PYORI_LIB_LINE_READ_CONTEXT ReadContext = (PYORI_LIB_LINE_READ_CONTEXT)Context;
+    DWORD CharsRemaining;
+    DWORD Count;
+    PUCHAR Buffer;
+    WCHAR ThisChar;
+
+    if (ReadContext == NULL || ReadContext->PreviousBuffer == NULL) {
+        return FALSE;
+    }
+
+    if (ReadContext->Terminated) {
+        return TRUE;
+    }
+
+    //
+    //  A carriage return at the end of the buffer may be followed by a
+    //  line feed that hasn't been read yet, so it doesn't complete a line.
+    //
+
+    Buffer = YoriLibAddToPointer(ReadContext->PreviousBuffer, ReadContext->CurrentBufferOffset);
+    if (ReadContext->ReadWChars) {
+        CharsRemaining = (ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset) / sizeof(WCHAR);
+        Count = YoriLibFindLineBreakW((PWCHAR)Buffer, CharsRemaining);
+        if (Count >= CharsRemaining) {
+            return FALSE;
+        }
+        ThisChar = ((PWCHAR)Buffer)[Count];
+    } else {
+        CharsRemaining = ReadContext->BytesInBuffer - ReadContext->CurrentBufferOffset;
+        Count = YoriLibFindLineBreakA(Buffer, CharsRemaining);
+        if (Count >= CharsRemaining) {
+            return FALSE;
+        }
+        ThisChar = Buffer[Count];
+    }
+
+    if (ThisChar == 0xD && Count + 1 == CharsRemaining) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Free any context allocated by YoriLibReadLineFromFile .
 
@@ -1132,8 +1132,21 @@ YoriLibFindFirstMatchingSubstring(
     )
 {
     YORI_STRING RemainingString;
+    YORI_LIB_SUBSTRING_MATCHER Matcher;
     DWORD CheckCount;
 
+    //
+    //  A single substring can be found by scanning for its first character,
+    //  which doesn't require any allocation.  Callers searching for many
+    //  substrings in many strings should construct a matcher once with
+    //  YoriLibInitializeSubstringMatcher instead.
+    //
+
+    if (NumberMatches == 1) {
+        YoriLibInitializeSubstringMatcher(&Matcher, NumberMatches, MatchArray, FALSE);
+        return YoriLibFindSubstringMatch(&Matcher, String, StringOffsetOfMatch);
+    }
+
     YoriLibInitEmptyString(&RemainingString);
     RemainingString.StartOfString = String->StartOfString;
     RemainingString.LengthInChars = String->LengthInChars;
@@ -1186,8 +1199,21 @@ YoriLibFindFirstMatchingSubstringInsensitive(
     )
 {
     YORI_STRING RemainingString;
+    YORI_LIB_SUBSTRING_MATCHER Matcher;
     DWORD CheckCount;
 
+    //
+    //  A single substring can be found by scanning for its first character,
+    //  which doesn't require any allocation.  Callers searching for many
+    //  substrings in many strings should construct a matcher once with
+    //  YoriLibInitializeSubstringMatcher instead.
+    //
+
+    if (NumberMatches == 1) {
+        YoriLibInitializeSubstringMatcher(&Matcher, NumberMatches, MatchArray, TRUE);
+        return YoriLibFindSubstringMatch(&Matcher, String, StringOffsetOfMatch);
+    }
+
     YoriLibInitEmptyString(&RemainingString);
     RemainingString.StartOfString = String->StartOfString;
     RemainingString.LengthInChars = String->LengthInChars;
@@ -0,0 +1,724 @@
+/**
+ * @file lib/strmatch.c
+ *
+ * Yori routines to search strings for one or more substrings
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yoripch.h"
+#include "yorilib.h"
+
+#if defined(_M_AMD64) && defined(_MSC_VER) && (_MSC_VER >= 1400)
+#include <emmintrin.h>
+
+/**
+ Set to nonzero if the compiler can generate SSE2 instructions, which are
+ always available on AMD64.
+ */
+#define YORI_LIB_STRMATCH_SSE2 1
+#else
+#define YORI_LIB_STRMATCH_SSE2 0
+#endif
+
+/**
+ The number of characters at the root of the automaton which are looked up
+ in a table rather than by searching the list of children.
+ */
+#define YORI_LIB_SUBSTRING_MATCH_ROOT_TABLE_SIZE (128)
+
+/**
+ A single state in the automaton used to search for multiple substrings.
+ State zero is the root, which corresponds to no characters matched, so a
+ value of zero in any of the state links indicates no state.
+ */
+typedef struct _YORI_LIB_SUBSTRING_MATCH_STATE {
+
+    /**
+     The first state reached from this one by matching one more character.
+     */
+    DWORD FirstChild;
+
+    /**
+     The next state with the same parent as this one.
+     */
+    DWORD NextSibling;
+
+    /**
+     The state corresponding to the longest proper suffix of the characters
+     matched by this state which is also a prefix of some substring.
+     */
+    DWORD Fail;
+
+    /**
+     One plus the index of the substring which ends at this state, or zero
+     if no substring ends here.  If more than one substring is identical,
+     this refers to the earliest.
+     */
+    DWORD Output;
+
+    /**
+     The next state reached by following Fail links which has an Output,
+     or zero if there is none.
+     */
+    DWORD OutputLink;
+
+    /**
+     The character which is matched to reach this state from its parent.
+     */
+    TCHAR Char;
+
+} YORI_LIB_SUBSTRING_MATCH_STATE, *PYORI_LIB_SUBSTRING_MATCH_STATE;
+
+/**
+ Fold a character for comparison.  This uses the same rules as the rest of
+ the library's case insensitive comparisons.
+
+ @param Matcher Pointer to the matcher.
+
+ @param Char The character to fold.
+
+ @return The folded character.
+ */
+TCHAR
+YoriLibSubstringMatcherFold(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in TCHAR Char
+    )
+{
+    if (Matcher->Insensitive) {
+        return YoriLibUpcaseChar(Char);
+    }
+    return Char;
+}
+
+/**
+ Return the offset of the first instance of either of two characters in a
+ buffer.  On AMD64 this compares eight characters at a time with SSE2.
+
+ @param Buffer Pointer to the buffer to search.
+
+ @param Length The number of characters in the buffer.
+
+ @param Char1 The first character to find.
+
+ @param Char2 The second character to find.  This can be the same as Char1.
+
+ @return The index of the first matching character, or Length if the buffer
+         does not contain either.
+ */
+DWORD
+YoriLibFindEitherChar(
+    __in LPTSTR Buffer,
+    __in DWORD Length,
+    __in TCHAR Char1,
+    __in TCHAR Char2
+    )
+{
+    DWORD Index;
+#if YORI_LIB_STRMATCH_SSE2
+    __m128i Match1;
+    __m128i Match2;
+    __m128i Chunk;
+    DWORD Mask;
+#endif
+
+    Index = 0;
+
+#if YORI_LIB_STRMATCH_SSE2
+    Match1 = _mm_set1_epi16(Char1);
+    Match2 = _mm_set1_epi16(Char2);
+    while (Index + sizeof(__m128i) / sizeof(TCHAR) <= Length) {
+        Chunk = _mm_loadu_si128((__m128i *)&Buffer[Index]);
+        Mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(Chunk, Match1), _mm_cmpeq_epi16(Chunk, Match2)));
+        if (Mask != 0) {
+            while ((Mask & 3) == 0) {
+                Mask = Mask >> 2;
+                Index++;
+            }
+            return Index;
+        }
+        Index += sizeof(__m128i) / sizeof(TCHAR);
+    }
+#endif
+
+    while (Index < Length) {
+        if (Buffer[Index] == Char1 || Buffer[Index] == Char2) {
+            break;
+        }
+        Index++;
+    }
+
+    return Index;
+}
+
+/**
+ Return the state reached from a state by matching one more character,
+ without following Fail links.
+
+ @param Matcher Pointer to the matcher.
+
+ @param State The current state.
+
+ @param Char The folded character to match.
+
+ @return The next state, or zero if the state has no such child.
+ */
+DWORD
+YoriLibSubstringMatcherChild(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in DWORD State,
+    __in TCHAR Char
+    )
+{
+    PYORI_LIB_SUBSTRING_MATCH_STATE States;
+    DWORD Child;
+
+    if (State == 0 && (DWORD)Char < YORI_LIB_SUBSTRING_MATCH_ROOT_TABLE_SIZE) {
+        return Matcher->RootTable[Char];
+    }
+
+    States = Matcher->States;
+    Child = States[State].FirstChild;
+    while (Child != 0) {
+        if (States[Child].Char == Char) {
+            return Child;
+        }
+        Child = States[Child].NextSibling;
+    }
+
+    return 0;
+}
+
+/**
+ Prepare to search strings for any of a set of substrings.  The matcher can
+ be used to search any number of strings, and is intended to be constructed
+ once and used for many searches.  A single substring is located by
+ scanning for its first character; multiple substrings are located by
+ building an Aho-Corasick automaton, so the cost of a search does not depend
+ on the number of substrings.
+
+ @param Matcher On successful completion, populated with the state needed to
+        search.  This should be freed with @ref YoriLibFreeSubstringMatcher .
+
+ @param NumberMatches The number of substrings to look for.
+
+ @param MatchArray An array of strings corresponding to the matches to look
+        for.  This array is referenced by the matcher and must remain valid
+        until the matcher is freed.
+
+ @param Insensitive TRUE if matches should be found without regard to case,
+        FALSE if they should be case sensitive.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriLibInitializeSubstringMatcher(
+    __out PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in DWORD NumberMatches,
+    __in PYORI_STRING MatchArray,
+    __in BOOLEAN Insensitive
+    )
+{
+    PYORI_LIB_SUBSTRING_MATCH_STATE States;
+    PDWORD Queue;
+    DWORD QueueHead;
+    DWORD QueueTail;
+    DWORD MatchIndex;
+    DWORD CharIndex;
+    DWORD StatesNeeded;
+    DWORD State;
+    DWORD Child;
+    DWORD Fail;
+    TCHAR Char;
+
+    ZeroMemory(Matcher, sizeof(YORI_LIB_SUBSTRING_MATCHER));
+    Matcher->NumberMatches = NumberMatches;
+    Matcher->MatchArray = MatchArray;
+    Matcher->Insensitive = Insensitive;
+
+    StatesNeeded = 1;
+    for (MatchIndex = 0; MatchIndex < NumberMatches; MatchIndex++) {
+        if (MatchArray[MatchIndex].LengthInChars == 0) {
+            Matcher->ContainsEmptyMatch = TRUE;
+        }
+        if (MatchArray[MatchIndex].LengthInChars > Matcher->MaximumMatchLength) {
+            Matcher->MaximumMatchLength = MatchArray[MatchIndex].LengthInChars;
+        }
+        StatesNeeded = StatesNeeded + MatchArray[MatchIndex].LengthInChars;
+    }
+
+    //
+    //  If there's one substring, remember the forms of its first character
+    //  to scan for.  An empty substring matches at the start of any string,
+    //  which doesn't need an automaton either.
+    //
+
+    if (NumberMatches <= 1 || Matcher->ContainsEmptyMatch) {
+        if (NumberMatches == 1 && MatchArray[0].LengthInChars > 0) {
+            Char = MatchArray[0].StartOfString[0];
+            Matcher->FirstChar = Char;
+            Matcher->FirstCharAlternate = Char;
+            if (Insensitive) {
+                if (Char >= 'a' && Char <= 'z') {
+                    Matcher->FirstCharAlternate = (TCHAR)(Char - 'a' + 'A');
+                } else if (Char >= 'A' && Char <= 'Z') {
+                    Matcher->FirstCharAlternate = (TCHAR)(Char - 'A' + 'a');
+                }
+            }
+        }
+        return TRUE;
+    }
+
+    States = YoriLibMalloc(StatesNeeded * (sizeof(YORI_LIB_SUBSTRING_MATCH_STATE) + sizeof(DWORD)));
+    if (States == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(States, StatesNeeded * sizeof(YORI_LIB_SUBSTRING_MATCH_STATE));
+    Queue = (PDWORD)(States + StatesNeeded);
+    Matcher->States = States;
+    Matcher->NumberStates = 1;
+
+    //
+    //  Build a trie of all of the substrings.
+    //
+
+    for (MatchIndex = 0; MatchIndex < NumberMatches; MatchIndex++) {
+        State = 0;
+        for (CharIndex = 0; CharIndex < MatchArray[MatchIndex].LengthInChars; CharIndex++) {
+            Char = YoriLibSubstringMatcherFold(Matcher, MatchArray[MatchIndex].StartOfString[CharIndex]);
+            Child = YoriLibSubstringMatcherChild(Matcher, State, Char);
+            if (Child == 0) {
+                Child = Matcher->NumberStates;
+                Matcher->NumberStates++;
+                States[Child].Char = Char;
+                States[Child].NextSibling = States[State].FirstChild;
+                States[State].FirstChild = Child;
+                if (State == 0 && (DWORD)Char < YORI_LIB_SUBSTRING_MATCH_ROOT_TABLE_SIZE) {
+                    Matcher->RootTable[Char] = Child;
+                }
+            }
+            State = Child;
+        }
+
+        if (States[State].Output == 0) {
+            States[State].Output = MatchIndex + 1;
+        }
+    }
+
+    //
+    //  Walk the trie breadth first, so that the Fail link of each state
+    //  refers to a state which has already been completed.
+    //
+
+    QueueHead = 0;
+    QueueTail = 0;
+    Child = States[0].FirstChild;
+    while (Child != 0) {
+        States[Child].Fail = 0;
+        States[Child].OutputLink = 0;
+        Queue[QueueTail++] = Child;
+        Child = States[Child].NextSibling;
+    }
+
+    while (QueueHead < QueueTail) {
+        State = Queue[QueueHead++];
+        Child = States[State].FirstChild;
+        while (Child != 0) {
+            Char = States[Child].Char;
+            Fail = States[State].Fail;
+            while (Fail != 0 && YoriLibSubstringMatcherChild(Matcher, Fail, Char) == 0) {
+                Fail = States[Fail].Fail;
+            }
+            Fail = YoriLibSubstringMatcherChild(Matcher, Fail, Char);
+            States[Child].Fail = Fail;
+            if (States[Fail].Output != 0) {
+                States[Child].OutputLink = Fail;
+            } else {
+                States[Child].OutputLink = States[Fail].OutputLink;
+            }
+            Queue[QueueTail++] = Child;
+            Child = States[Child].NextSibling;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Free any allocations associated with a substring matcher.  The matcher
+ structure itself is not freed.
+
+ @param Matcher Pointer to the matcher.
+ */
+VOID
+YoriLibFreeSubstringMatcher(
+    __inout PYORI_LIB_SUBSTRING_MATCHER Matcher
+    )
+{
+    if (Matcher->States != NULL) {
+        YoriLibFree(Matcher->States);
+        Matcher->States = NULL;
+    }
+}
+
+/**
+ Search for substrings by comparing each substring at each offset.  This is
+ used when an empty substring is present, since it matches at the first
+ offset.
+
+ @param Matcher Pointer to the matcher.
+
+ @param String The string to search through.
+
+ @param StringOffsetOfMatch On successful completion, returns the offset
+        within the string of the match.
+
+ @return If a match is found, returns a pointer to the entry in MatchArray
+         corresponding to the substring that was matched.  If no match is
+         found, returns NULL.
+ */
+PYORI_STRING
+YoriLibFindSubstringMatchByComparison(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String,
+    __out PDWORD StringOffsetOfMatch
+    )
+{
+    YORI_STRING RemainingString;
+    DWORD CheckCount;
+    int CompareResult;
+
+    YoriLibInitEmptyString(&RemainingString);
+    RemainingString.StartOfString = String->StartOfString;
+    RemainingString.LengthInChars = String->LengthInChars;
+
+    while (RemainingString.LengthInChars > 0) {
+        for (CheckCount = 0; CheckCount < Matcher->NumberMatches; CheckCount++) {
+            if (Matcher->Insensitive) {
+                CompareResult = YoriLibCompareStringInsensitiveCount(&RemainingString, &Matcher->MatchArray[CheckCount], Matcher->MatchArray[CheckCount].LengthInChars);
+            } else {
+                CompareResult = YoriLibCompareStringCount(&RemainingString, &Matcher->MatchArray[CheckCount], Matcher->MatchArray[CheckCount].LengthInChars);
+            }
+            if (CompareResult == 0) {
+                *StringOffsetOfMatch = String->LengthInChars - RemainingString.LengthInChars;
+                return &Matcher->MatchArray[CheckCount];
+            }
+        }
+
+        RemainingString.LengthInChars--;
+        RemainingString.StartOfString++;
+    }
+
+    return NULL;
+}
+
+/**
+ Search for a single substring by scanning for its first character and
+ comparing the remainder wherever it is found.
+
+ @param Matcher Pointer to the matcher.
+
+ @param String The string to search through.
+
+ @param StringOffsetOfMatch On successful completion, returns the offset
+        within the string of the match.
+
+ @return If a match is found, returns a pointer to the substring.  If no
+         match is found, returns NULL.
+ */
+PYORI_STRING
+YoriLibFindSubstringMatchByFirstChar(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String,
+    __out PDWORD StringOffsetOfMatch
+    )
+{
+    PYORI_STRING Match;
+    DWORD Index;
+    DWORD CharIndex;
+
+    Match = &Matcher->MatchArray[0];
+    Index = 0;
+    while (Index + Match->LengthInChars <= String->LengthInChars) {
+        Index = Index + YoriLibFindEitherChar(&String->StartOfString[Index], String->LengthInChars - Index, Matcher->FirstChar, Matcher->FirstCharAlternate);
+        if (Index + Match->LengthInChars > String->LengthInChars) {
+            break;
+        }
+
+        if (Matcher->Insensitive) {
+            for (CharIndex = 1; CharIndex < Match->LengthInChars; CharIndex++) {
+                if (YoriLibUpcaseChar(String->StartOfString[Index + CharIndex]) != YoriLibUpcaseChar(Match->StartOfString[CharIndex])) {
+                    break;
+                }
+            }
+        } else {
+            for (CharIndex = 1; CharIndex < Match->LengthInChars; CharIndex++) {
+                if (String->StartOfString[Index + CharIndex] != Match->StartOfString[CharIndex]) {
+                    break;
+                }
+            }
+        }
+
+        if (CharIndex == Match->LengthInChars) {
+            *StringOffsetOfMatch = Index;
+            return Match;
+        }
+
+        Index++;
+    }
+
+    return NULL;
+}
+
+/**
+ Search for any of a set of substrings using the automaton.  Each character
+ of the string is examined once, plus a bounded number of Fail links.  The
+ match which starts earliest in the string is returned; where more than one
+ substring starts at the same offset, the one earliest in MatchArray is
+ returned, which is the same result as comparing each substring at each
+ offset.
+
+ @param Matcher Pointer to the matcher.
+
+ @param String The string to search through.
+
+ @param StringOffsetOfMatch On successful completion, returns the offset
+        within the string of the match.
+
+ @return If a match is found, returns a pointer to the entry in MatchArray
+         corresponding to the substring that was matched.  If no match is
+         found, returns NULL.
+ */
+PYORI_STRING
+YoriLibFindSubstringMatchByAutomaton(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String,
+    __out PDWORD StringOffsetOfMatch
+    )
+{
+    PYORI_LIB_SUBSTRING_MATCH_STATE States;
+    DWORD Index;
+    DWORD State;
+    DWORD Next;
+    DWORD Output;
+    DWORD MatchIndex;
+    DWORD MatchStart;
+    DWORD BestStart;
+    DWORD BestIndex;
+    TCHAR Char;
+
+    States = Matcher->States;
+    State = 0;
+    BestStart = (DWORD)-1;
+    BestIndex = 0;
+
+    for (Index = 0; Index < String->LengthInChars; Index++) {
+        Char = YoriLibSubstringMatcherFold(Matcher, String->StartOfString[Index]);
+
+        while (TRUE) {
+            Next = YoriLibSubstringMatcherChild(Matcher, State, Char);
+            if (Next != 0 || State == 0) {
+                break;
+            }
+            State = States[State].Fail;
+        }
+        State = Next;
+
+        //
+        //  Check every substring which ends at this character.  A longer
+        //  substring ending later may still start earlier than one found
+        //  already, so keep going until no such substring is possible.
+        //
+
+        Output = State;
+        if (States[Output].Output == 0) {
+            Output = States[Output].OutputLink;
+        }
+
+        while (Output != 0) {
+            MatchIndex = States[Output].Output - 1;
+            MatchStart = Index + 1 - Matcher->MatchArray[MatchIndex].LengthInChars;
+            if (MatchStart < BestStart ||
+                (MatchStart == BestStart && MatchIndex < BestIndex)) {
+
+                BestStart = MatchStart;
+                BestIndex = MatchIndex;
+            }
+            Output = States[Output].OutputLink;
+        }
+
+        if (BestStart != (DWORD)-1 &&
+            Index + 1 >= BestStart + Matcher->MaximumMatchLength) {
+
+            break;
+        }
+    }
+
+    if (BestStart == (DWORD)-1) {
+        return NULL;
+    }
+
+    *StringOffsetOfMatch = BestStart;
+    return &Matcher->MatchArray[BestIndex];
+}
+
+/**
+ Search through a string looking to see if any of the substrings in a
+ matcher can be located.  Returns the first match in offset from the
+ beginning of the string order.
+
+ @param Matcher Pointer to the matcher, previously initialized with
+        @ref YoriLibInitializeSubstringMatcher .
+
+ @param String The string to search through.
+
+ @param StringOffsetOfMatch On successful completion, returns the offset
+        within the string of the match.
+
+ @return If a match is found, returns a pointer to the entry in MatchArray
+         corresponding to the substring that was matched.  If no match is
+         found, returns NULL.
+ */
+PYORI_STRING
+YoriLibFindSubstringMatch(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String,
+    __out_opt PDWORD StringOffsetOfMatch
+    )
+{
+    PYORI_STRING Match;
+    DWORD Offset;
+
+    Offset = 0;
+    if (Matcher->NumberMatches == 0) {
+        Match = NULL;
+    } else if (Matcher->ContainsEmptyMatch) {
+        Match = YoriLibFindSubstringMatchByComparison(Matcher, String, &Offset);
+    } else if (Matcher->States != NULL) {
+        Match = YoriLibFindSubstringMatchByAutomaton(Matcher, String, &Offset);
+    } else {
+        Match = YoriLibFindSubstringMatchByFirstChar(Matcher, String, &Offset);
+    }
+
+    if (Match == NULL) {
+        Offset = 0;
+    }
+
+    if (StringOffsetOfMatch != NULL) {
+        *StringOffsetOfMatch = Offset;
+    }
+    return Match;
+}
+
+/**
+ Search through a string looking to see if any of the substrings in a
+ matcher can be located.  Unlike @ref YoriLibFindSubstringMatch , this
+ returns the match which is earliest in the matcher's array of substrings,
+ regardless of where it occurs in the string.  This is useful when the
+ array describes a set of rules in order of precedence, since the string
+ needs to be scanned once to determine which rule applies.
+
+ @param Matcher Pointer to the matcher, previously initialized with
+        @ref YoriLibInitializeSubstringMatcher .
+
+ @param String The string to search through.
+
+ @return If a match is found, returns a pointer to the entry in MatchArray
+         corresponding to the substring that was matched.  If no match is
+         found, returns NULL.
+ */
+PYORI_STRING
+YoriLibFindFirstListedSubstringMatch(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String
+    )
+{
+    YORI_LIB_SUBSTRING_MATCHER SingleMatcher;
+    PYORI_LIB_SUBSTRING_MATCH_STATE States;
+    DWORD Index;
+    DWORD State;
+    DWORD Next;
+    DWORD Output;
+    DWORD MatchIndex;
+    DWORD BestIndex;
+    TCHAR Char;
+
+    //
+    //  Without an automaton, check each substring in turn.  This only
+    //  happens for a single substring or when an empty substring is
+    //  present, so it is not the common case.
+    //
+
+    if (Matcher->States == NULL) {
+        for (MatchIndex = 0; MatchIndex < Matcher->NumberMatches; MatchIndex++) {
+            YoriLibInitializeSubstringMatcher(&SingleMatcher, 1, &Matcher->MatchArray[MatchIndex], Matcher->Insensitive);
+            if (YoriLibFindSubstringMatch(&SingleMatcher, String, NULL) != NULL) {
+                return &Matcher->MatchArray[MatchIndex];
+            }
+        }
+        return NULL;
+    }
+
+    States = Matcher->States;
+    State = 0;
+    BestIndex = (DWORD)-1;
+
+    for (Index = 0; Index < String->LengthInChars; Index++) {
+        Char = YoriLibSubstringMatcherFold(Matcher, String->StartOfString[Index]);
+
+        while (TRUE) {
+            Next = YoriLibSubstringMatcherChild(Matcher, State, Char);
+            if (Next != 0 || State == 0) {
+                break;
+            }
+            State = States[State].Fail;
+        }
+        State = Next;
+
+        Output = State;
+        if (States[Output].Output == 0) {
+            Output = States[Output].OutputLink;
+        }
+
+        while (Output != 0) {
+            MatchIndex = States[Output].Output - 1;
+            if (MatchIndex < BestIndex) {
+                BestIndex = MatchIndex;
+            }
+            Output = States[Output].OutputLink;
+        }
+
+        if (BestIndex == 0) {
+            break;
+        }
+    }
+
+    if (BestIndex == (DWORD)-1) {
+        return NULL;
+    }
+
+    return &Matcher->MatchArray[BestIndex];
+}
+
+// vim:sw=4:ts=4:et:
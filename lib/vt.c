@@ -53,6 +53,71 @@ BOOLEAN YoriLibVtResetColorSet;
  */
 LPTSTR YoriLibVtLineEnding = _T("\r\n");
 
+/**
+ The size of the buffer used to accumulate output to a file or pipe before
+ it is written to the device, in bytes.
+ */
+#define YORI_LIB_OUTPUT_BUFFER_SIZE (64 * 1024)
+
+/**
+ The maximum number of handles that can have buffered output at once.
+ */
+#define YORI_LIB_OUTPUT_MAX_BUFFERS 4
+
+/**
+ A buffer that accumulates output for a file or pipe in the output encoding,
+ so that many small writes can be sent to the device in a single write.
+ */
+typedef struct _YORI_LIB_OUTPUT_BUFFER {
+
+    /**
+     The handle that output is being buffered for.  NULL if this entry is
+     not in use.
+     */
+    HANDLE hOutput;
+
+    /**
+     The thread that enabled buffering.  Output from any other thread is
+     written to the device immediately, so that the buffer is only ever
+     accessed from a single thread.
+     */
+    DWORD OwningThreadId;
+
+    /**
+     The number of bytes currently populated in Buffer.
+     */
+    DWORD BytesInBuffer;
+
+    /**
+     Pointer to a buffer of YORI_LIB_OUTPUT_BUFFER_SIZE bytes containing
+     output that has not yet been written to the device.
+     */
+    PUCHAR Buffer;
+
+    /**
+     Pointer to a buffer used to format strings that are too large for the
+     stack, retained between calls so it can be reused.
+     */
+    LPTSTR FormatBuffer;
+
+    /**
+     The size of FormatBuffer, in characters.
+     */
+    DWORD FormatBufferLength;
+
+} YORI_LIB_OUTPUT_BUFFER, *PYORI_LIB_OUTPUT_BUFFER;
+
+/**
+ The set of handles that have buffered output.
+ */
+YORI_LIB_OUTPUT_BUFFER YoriLibOutputBuffers[YORI_LIB_OUTPUT_MAX_BUFFERS];
+
+/**
+ The number of entries in YoriLibOutputBuffers that are in use.  This allows
+ the common case of no buffering to be detected without a search.
+ */
+DWORD YoriLibOutputBuffersActive;
+
 /**
  Set the default color for the process.  The default color is the one that
  will be used when a reset command is issued to the terminal.  For most
@@ -121,6 +186,266 @@ YoriLibVtGetLineEnding()
     return YoriLibVtLineEnding;
 }
 
+/**
+ Find the output buffer for a specified handle, if output to that handle
+ from the current thread is buffered.
+
+ @param hOutput Handle to the device to receive output.
+
+ @return Pointer to the output buffer, or NULL if output to the handle is
+         not buffered.
+ */
+PYORI_LIB_OUTPUT_BUFFER
+YoriLibOutputFindBuffer(
+    __in HANDLE hOutput
+    )
+{
+    DWORD Index;
+    DWORD ThreadId;
+
+    if (YoriLibOutputBuffersActive == 0) {
+        return NULL;
+    }
+
+    ThreadId = GetCurrentThreadId();
+    for (Index = 0; Index < YORI_LIB_OUTPUT_MAX_BUFFERS; Index++) {
+        if (YoriLibOutputBuffers[Index].hOutput == hOutput &&
+            YoriLibOutputBuffers[Index].OwningThreadId == ThreadId) {
+
+            return &YoriLibOutputBuffers[Index];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ Write any data in an output buffer to its device.
+
+ @param OutputBuffer Pointer to the output buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibOutputFlushBuffer(
+    __in PYORI_LIB_OUTPUT_BUFFER OutputBuffer
+    )
+{
+    DWORD BytesWritten;
+    DWORD CurrentOffset;
+    BOOL Result;
+
+    Result = TRUE;
+    CurrentOffset = 0;
+    while (CurrentOffset < OutputBuffer->BytesInBuffer) {
+        if (!WriteFile(OutputBuffer->hOutput,
+                       &OutputBuffer->Buffer[CurrentOffset],
+                       OutputBuffer->BytesInBuffer - CurrentOffset,
+                       &BytesWritten,
+                       NULL) ||
+            BytesWritten == 0) {
+
+            Result = FALSE;
+            break;
+        }
+        CurrentOffset += BytesWritten;
+    }
+
+    OutputBuffer->BytesInBuffer = 0;
+    return Result;
+}
+
+/**
+ Write any buffered output to its device and stop buffering output to it.
+
+ @param OutputBuffer Pointer to the output buffer.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibOutputReleaseBuffer(
+    __in PYORI_LIB_OUTPUT_BUFFER OutputBuffer
+    )
+{
+    BOOL Result;
+
+    Result = YoriLibOutputFlushBuffer(OutputBuffer);
+    YoriLibFree(OutputBuffer->Buffer);
+    if (OutputBuffer->FormatBuffer != NULL) {
+        YoriLibFree(OutputBuffer->FormatBuffer);
+    }
+    ZeroMemory(OutputBuffer, sizeof(YORI_LIB_OUTPUT_BUFFER));
+    YoriLibOutputBuffersActive--;
+    return Result;
+}
+
+/**
+ Indicate that output to a specified handle from the current thread should
+ be buffered and written to the device in large writes.  This is useful for
+ applications that generate output a line at a time to a file or pipe.
+ Output to a console is not buffered, so that interactive users see output
+ as it is generated; in that case this function returns FALSE and output
+ continues to be written immediately.
+
+ Buffered output is written when the buffer is full, when the application
+ calls @ref YoriLibOutputFlush, or when it calls
+ @ref YoriLibOutputDisableBuffering.  Application entrypoints and the shell
+ disable buffering when a command completes, so any remaining output is
+ written at that point.  Applications that wait for further input, such as
+ when following a file, should call @ref YoriLibOutputFlush before waiting.
+
+ @param hOutput Handle to the device to buffer output for.
+
+ @return TRUE to indicate output is buffered, FALSE if it is not.
+ */
+BOOL
+YoriLibOutputEnableBuffering(
+    __in HANDLE hOutput
+    )
+{
+    DWORD CurrentMode;
+    DWORD Index;
+    PYORI_LIB_OUTPUT_BUFFER OutputBuffer;
+
+    if (hOutput == NULL || hOutput == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (GetConsoleMode(hOutput, &CurrentMode)) {
+        return FALSE;
+    }
+
+    if (YoriLibOutputFindBuffer(hOutput) != NULL) {
+        return TRUE;
+    }
+
+    for (Index = 0; Index < YORI_LIB_OUTPUT_MAX_BUFFERS; Index++) {
+        OutputBuffer = &YoriLibOutputBuffers[Index];
+        if (OutputBuffer->hOutput == NULL) {
+            OutputBuffer->Buffer = YoriLibMalloc(YORI_LIB_OUTPUT_BUFFER_SIZE);
+            if (OutputBuffer->Buffer == NULL) {
+                return FALSE;
+            }
+            OutputBuffer->hOutput = hOutput;
+            OutputBuffer->OwningThreadId = GetCurrentThreadId();
+            OutputBuffer->BytesInBuffer = 0;
+            OutputBuffer->FormatBuffer = NULL;
+            OutputBuffer->FormatBufferLength = 0;
+            YoriLibOutputBuffersActive++;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ Write any output that has been buffered for a specified handle by the
+ current thread to the device.
+
+ @param hOutput Handle to the device.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibOutputFlush(
+    __in HANDLE hOutput
+    )
+{
+    PYORI_LIB_OUTPUT_BUFFER OutputBuffer;
+
+    OutputBuffer = YoriLibOutputFindBuffer(hOutput);
+    if (OutputBuffer == NULL) {
+        return TRUE;
+    }
+
+    return YoriLibOutputFlushBuffer(OutputBuffer);
+}
+
+/**
+ Write any buffered output to its device, and stop buffering output.  This
+ applies to all buffered handles regardless of the thread that enabled
+ buffering, so it should only be called when no other thread is generating
+ output, such as when a command has completed.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+YoriLibOutputDisableBuffering()
+{
+    DWORD Index;
+    BOOL Result;
+
+    Result = TRUE;
+    for (Index = 0; Index < YORI_LIB_OUTPUT_MAX_BUFFERS && YoriLibOutputBuffersActive > 0; Index++) {
+        if (YoriLibOutputBuffers[Index].hOutput != NULL) {
+            if (!YoriLibOutputReleaseBuffer(&YoriLibOutputBuffers[Index])) {
+                Result = FALSE;
+            }
+        }
+    }
+
+    return Result;
+}
+
+/**
+ Convert a string to the active output encoding and append it to an output
+ buffer, writing the buffer to its device if it has insufficient space.
+
+ @param OutputBuffer Pointer to the output buffer.
+
+ @param StringBuffer Pointer to the string to output which is in host (UTF16)
+        encoding.
+
+ @param BufferLength Length of StringBuffer, in characters.
+
+ @param Result On successful completion, set to TRUE to indicate the string
+        was written successfully or FALSE to indicate failure.
+
+ @return TRUE to indicate the string was processed via the buffer, or FALSE
+         if the string is too large to buffer and should be written to the
+         device directly.
+ */
+BOOL
+YoriLibOutputTextToBuffer(
+    __in PYORI_LIB_OUTPUT_BUFFER OutputBuffer,
+    __in LPCTSTR StringBuffer,
+    __in DWORD BufferLength,
+    __out PBOOL Result
+    )
+{
+    DWORD BytesNeeded;
+
+#ifdef UNICODE
+    BytesNeeded = YoriLibGetMultibyteOutputSizeNeeded(StringBuffer, BufferLength);
+#else
+    BytesNeeded = BufferLength * sizeof(TCHAR);
+#endif
+
+    *Result = TRUE;
+    if (BytesNeeded > YORI_LIB_OUTPUT_BUFFER_SIZE - OutputBuffer->BytesInBuffer) {
+        if (!YoriLibOutputFlushBuffer(OutputBuffer)) {
+            *Result = FALSE;
+            return TRUE;
+        }
+
+        if (BytesNeeded > YORI_LIB_OUTPUT_BUFFER_SIZE) {
+            return FALSE;
+        }
+    }
+
+#ifdef UNICODE
+    YoriLibMultibyteOutput(StringBuffer,
+                           BufferLength,
+                           (LPSTR)&OutputBuffer->Buffer[OutputBuffer->BytesInBuffer],
+                           BytesNeeded);
+#else
+    memcpy(&OutputBuffer->Buffer[OutputBuffer->BytesInBuffer], StringBuffer, BytesNeeded);
+#endif
+    OutputBuffer->BytesInBuffer += BytesNeeded;
+    return TRUE;
+}
+
 /**
  Convert any incoming string to the active output encoding, and send it to
  the output device.
@@ -143,6 +468,14 @@ YoriLibOutputTextToMultibyteDevice(
 {
     DWORD  BytesTransferred;
     BOOL Result;
+    PYORI_LIB_OUTPUT_BUFFER OutputBuffer;
+
+    OutputBuffer = YoriLibOutputFindBuffer(hOutput);
+    if (OutputBuffer != NULL &&
+        YoriLibOutputTextToBuffer(OutputBuffer, StringBuffer, BufferLength, &Result)) {
+
+        return Result;
+    }
 
 #ifdef UNICODE
     {
@@ -868,15 +1201,18 @@ YoriLibOutputInternal(
     TCHAR stack_buf[64];
     TCHAR * buf;
     YORI_LIB_VT_CALLBACK_FUNCTIONS Callbacks;
+    PYORI_LIB_OUTPUT_BUFFER OutputBuffer;
     DWORD CurrentMode;
     BOOL Result;
 
     //
     //  Check if we're writing to a console supporting color or a file
-    //  that doesn't
+    //  that doesn't.  Buffered output is never to a console, so there's no
+    //  need to ask.
     //
 
-    if (GetConsoleMode(hOut, &CurrentMode)) {
+    OutputBuffer = YoriLibOutputFindBuffer(hOut);
+    if (OutputBuffer == NULL && GetConsoleMode(hOut, &CurrentMode)) {
         if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
             YoriLibConsoleNoEscapeSetFunctions(&Callbacks);
         } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
@@ -892,10 +1228,31 @@ YoriLibOutputInternal(
 
     len = YoriLibVSPrintfSize(szFmt, marker);
 
+    //
+    //  If the string doesn't fit on the stack, allocate a buffer for it.
+    //  If output is buffered, the allocation is retained for the next
+    //  call.
+    //
+
     if (len>(int)(sizeof(stack_buf)/sizeof(stack_buf[0]))) {
-        buf = YoriLibMalloc(len * sizeof(TCHAR));
-        if (buf == NULL) {
-            return 0;
+        if (OutputBuffer != NULL) {
+            if ((DWORD)len > OutputBuffer->FormatBufferLength) {
+                buf = YoriLibMalloc(len * sizeof(TCHAR));
+                if (buf == NULL) {
+                    return 0;
+                }
+                if (OutputBuffer->FormatBuffer != NULL) {
+                    YoriLibFree(OutputBuffer->FormatBuffer);
+                }
+                OutputBuffer->FormatBuffer = buf;
+                OutputBuffer->FormatBufferLength = len;
+            }
+            buf = OutputBuffer->FormatBuffer;
+        } else {
+            buf = YoriLibMalloc(len * sizeof(TCHAR));
+            if (buf == NULL) {
+                return 0;
+            }
         }
     } else {
         buf = stack_buf;
@@ -906,7 +1263,9 @@ YoriLibOutputInternal(
 
     Result = YoriLibProcessVtEscapesOnNewStream(buf, len, hOut, &Callbacks);
 
-    if (buf != stack_buf) {
+    if (buf != stack_buf &&
+        (OutputBuffer == NULL || buf != OutputBuffer->FormatBuffer)) {
+
         YoriLibFree(buf);
     }
     return Result;
@@ -973,10 +1332,11 @@ YoriLibOutputString(
 
     //
     //  Check if we're writing to a console supporting color or a file
-    //  that doesn't
+    //  that doesn't.  Buffered output is never to a console, so there's no
+    //  need to ask.
     //
 
-    if (GetConsoleMode(hOut, &CurrentMode)) {
+    if (YoriLibOutputFindBuffer(hOut) == NULL && GetConsoleMode(hOut, &CurrentMode)) {
         if ((Flags & YORI_LIB_OUTPUT_STRIP_VT) != 0) {
             YoriLibConsoleNoEscapeSetFunctions(&Callbacks);
         } else if ((Flags & YORI_LIB_OUTPUT_PASSTHROUGH_VT) != 0) {
@@ -137,6 +137,14 @@ typedef _Return_type_success_(return >= 0) long HRESULT;
 #define PROCESS_QUERY_LIMITED_INFORMATION  (0x1000)
 #endif
 
+#ifndef WT_EXECUTEONLYONCE
+/**
+ Definition for a registered wait that should only be satisfied once, for
+ compilers that don't provide it.
+ */
+#define WT_EXECUTEONLYONCE 0x00000008
+#endif
+
 #ifndef SE_MANAGE_VOLUME_NAME
 /**
  Definition for manage volume privilege for compilation environments that
@@ -191,6 +199,47 @@ typedef struct _FILE_PROCESS_IDS_USING_FILE_INFORMATION {
 
 } FILE_PROCESS_IDS_USING_FILE_INFORMATION, *PFILE_PROCESS_IDS_USING_FILE_INFORMATION;
 
+/**
+ Definition of the information class to query the type and characteristics
+ of the device containing a file for compilation environments that don't
+ define it.
+ */
+#define FileFsDeviceInformation (4)
+
+/**
+ A structure that is returned by NtQueryVolumeInformationFile describing the
+ device containing a file.
+ */
+typedef struct _YORI_FILE_FS_DEVICE_INFORMATION {
+
+    /**
+     The type of the device.
+     */
+    DWORD DeviceType;
+
+    /**
+     Flags describing the device, including FILE_REMOVABLE_MEDIA and
+     FILE_REMOTE_DEVICE.
+     */
+    DWORD Characteristics;
+} YORI_FILE_FS_DEVICE_INFORMATION, *PYORI_FILE_FS_DEVICE_INFORMATION;
+
+#ifndef FILE_REMOVABLE_MEDIA
+/**
+ Device characteristic indicating the media can be removed, for compilation
+ environments that don't define it.
+ */
+#define FILE_REMOVABLE_MEDIA (0x00000001)
+#endif
+
+#ifndef FILE_REMOTE_DEVICE
+/**
+ Device characteristic indicating the device is accessed over a network,
+ for compilation environments that don't define it.
+ */
+#define FILE_REMOTE_DEVICE   (0x00000010)
+#endif
+
 /**
  Definition of the information class to query memory usage of a process for
  compilation environments that don't define it.
@@ -1069,6 +1118,22 @@ typedef struct _YORI_MEMORYSTATUSEX {
     DWORDLONG ullAvailExtendedVirtual;
 } YORI_MEMORYSTATUSEX, *PYORI_MEMORYSTATUSEX;
 
+/**
+ A range of virtual address space to prefetch.
+ */
+typedef struct _YORI_WIN32_MEMORY_RANGE_ENTRY {
+
+    /**
+     The start of the range.
+     */
+    PVOID VirtualAddress;
+
+    /**
+     The number of bytes in the range.
+     */
+    SIZE_T NumberOfBytes;
+} YORI_WIN32_MEMORY_RANGE_ENTRY, *PYORI_WIN32_MEMORY_RANGE_ENTRY;
+
 /**
  Information about the IO requests generated by the process.
  */
@@ -4697,6 +4762,18 @@ NT_QUERY_SYSTEM_INFORMATION(DWORD, PVOID, DWORD, PDWORD);
  */
 typedef NT_QUERY_SYSTEM_INFORMATION *PNT_QUERY_SYSTEM_INFORMATION;
 
+/**
+ A prototype for the NtQueryVolumeInformationFile function.
+ */
+typedef
+LONG WINAPI
+NT_QUERY_VOLUME_INFORMATION_FILE(HANDLE, PIO_STATUS_BLOCK, PVOID, DWORD, DWORD);
+
+/**
+ A prototype for a pointer to the NtQueryVolumeInformationFile function.
+ */
+typedef NT_QUERY_VOLUME_INFORMATION_FILE *PNT_QUERY_VOLUME_INFORMATION_FILE;
+
 /**
  A prototype for the RtlGetLastNtStatus function.
  */
@@ -4744,6 +4821,12 @@ typedef struct _YORI_NTDLL_FUNCTIONS {
      */
     PNT_QUERY_SYSTEM_INFORMATION pNtQuerySystemInformation;
 
+    /**
+     If it's available on the current system, a pointer to
+     NtQueryVolumeInformationFile.
+     */
+    PNT_QUERY_VOLUME_INFORMATION_FILE pNtQueryVolumeInformationFile;
+
     /**
      If it's available on the current system, a pointer to
      RtlGetLastNtStatus.
@@ -4791,6 +4874,18 @@ CREATE_HARD_LINKW(LPWSTR, LPWSTR, PVOID);
  */
 typedef CREATE_HARD_LINKW *PCREATE_HARD_LINKW;
 
+/**
+ A prototype for the CreateIoCompletionPort function.
+ */
+typedef
+HANDLE WINAPI
+CREATE_IO_COMPLETION_PORT(HANDLE, HANDLE, DWORD_PTR, DWORD);
+
+/**
+ A prototype for a pointer to the CreateIoCompletionPort function.
+ */
+typedef CREATE_IO_COMPLETION_PORT *PCREATE_IO_COMPLETION_PORT;
+
 /**
  A prototype for the CreateJobObjectW function.
  */
@@ -5091,6 +5186,18 @@ GET_PRODUCT_INFO(DWORD, DWORD, DWORD, DWORD, PDWORD);
  */
 typedef GET_PRODUCT_INFO *PGET_PRODUCT_INFO;
 
+/**
+ A prototype for the GetQueuedCompletionStatus function.
+ */
+typedef
+BOOL WINAPI
+GET_QUEUED_COMPLETION_STATUS(HANDLE, LPDWORD, PDWORD_PTR, LPOVERLAPPED *, DWORD);
+
+/**
+ A prototype for a pointer to the GetQueuedCompletionStatus function.
+ */
+typedef GET_QUEUED_COMPLETION_STATUS *PGET_QUEUED_COMPLETION_STATUS;
+
 /**
  A prototype for the GetTickCount64 function.
  */
@@ -5163,6 +5270,30 @@ IS_WOW64_PROCESS(HANDLE, PBOOL);
  */
 typedef IS_WOW64_PROCESS *PIS_WOW64_PROCESS;
 
+/**
+ A prototype for the PostQueuedCompletionStatus function.
+ */
+typedef
+BOOL WINAPI
+POST_QUEUED_COMPLETION_STATUS(HANDLE, DWORD, DWORD_PTR, LPOVERLAPPED);
+
+/**
+ A prototype for a pointer to the PostQueuedCompletionStatus function.
+ */
+typedef POST_QUEUED_COMPLETION_STATUS *PPOST_QUEUED_COMPLETION_STATUS;
+
+/**
+ A prototype for the PrefetchVirtualMemory function.
+ */
+typedef
+BOOL WINAPI
+PREFETCH_VIRTUAL_MEMORY(HANDLE, DWORD_PTR, PYORI_WIN32_MEMORY_RANGE_ENTRY, ULONG);
+
+/**
+ A prototype for a pointer to the PrefetchVirtualMemory function.
+ */
+typedef PREFETCH_VIRTUAL_MEMORY *PPREFETCH_VIRTUAL_MEMORY;
+
 /**
  A prototype for the QueryFullProcessImageNameW function.
  */
@@ -5199,6 +5330,52 @@ REGISTER_APPLICATION_RESTART(LPCWSTR, DWORD);
  */
 typedef REGISTER_APPLICATION_RESTART *PREGISTER_APPLICATION_RESTART;
 
+/**
+ A prototype for a function to invoke when a registered wait completes.
+ */
+typedef
+VOID WINAPI
+YORI_WAIT_OR_TIMER_CALLBACK(PVOID, BOOLEAN);
+
+/**
+ A prototype for a pointer to a function to invoke when a registered wait
+ completes.
+ */
+typedef YORI_WAIT_OR_TIMER_CALLBACK *PYORI_WAIT_OR_TIMER_CALLBACK;
+
+/**
+ A prototype for the RegisterWaitForSingleObject function.
+ */
+typedef
+BOOL WINAPI
+REGISTER_WAIT_FOR_SINGLE_OBJECT(PHANDLE, HANDLE, PYORI_WAIT_OR_TIMER_CALLBACK, PVOID, ULONG, ULONG);
+
+/**
+ A prototype for a pointer to the RegisterWaitForSingleObject function.
+ */
+typedef REGISTER_WAIT_FOR_SINGLE_OBJECT *PREGISTER_WAIT_FOR_SINGLE_OBJECT;
+
+#ifndef REPLACEFILE_IGNORE_MERGE_ERRORS
+/**
+ Flag to ReplaceFile indicating that failure to merge the attributes of the
+ replaced file should not fail the operation, for compilation environments
+ that don't define it.
+ */
+#define REPLACEFILE_IGNORE_MERGE_ERRORS 0x00000002
+#endif
+
+/**
+ A prototype for the ReplaceFileW function.
+ */
+typedef
+BOOL WINAPI
+REPLACE_FILEW(LPCWSTR, LPCWSTR, LPCWSTR, DWORD, LPVOID, LPVOID);
+
+/**
+ A prototype for a pointer to the ReplaceFileW function.
+ */
+typedef REPLACE_FILEW *PREPLACE_FILEW;
+
 /**
  A prototype for the RtlCaptureStackBackTrace function.
  */
@@ -5259,6 +5436,18 @@ SET_INFORMATION_JOB_OBJECT(HANDLE, DWORD, PVOID, DWORD);
  */
 typedef SET_INFORMATION_JOB_OBJECT *PSET_INFORMATION_JOB_OBJECT;
 
+/**
+ A prototype for the UnregisterWaitEx function.
+ */
+typedef
+BOOL WINAPI
+UNREGISTER_WAIT_EX(HANDLE, HANDLE);
+
+/**
+ A prototype for a pointer to the UnregisterWaitEx function.
+ */
+typedef UNREGISTER_WAIT_EX *PUNREGISTER_WAIT_EX;
+
 /**
  A prototype for the Wow64DisableWow64FsRedirection function.
  */
@@ -5321,6 +5510,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PCREATE_HARD_LINKW pCreateHardLinkW;
 
+    /**
+     If it's available on the current system, a pointer to CreateIoCompletionPort.
+     */
+    PCREATE_IO_COMPLETION_PORT pCreateIoCompletionPort;
+
     /**
      If it's available on the current system, a pointer to CreateJobObjectW.
      */
@@ -5446,6 +5640,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PGET_PRODUCT_INFO pGetProductInfo;
 
+    /**
+     If it's available on the current system, a pointer to GetQueuedCompletionStatus.
+     */
+    PGET_QUEUED_COMPLETION_STATUS pGetQueuedCompletionStatus;
+
     /**
      If it's available on the current system, a pointer to GetTickCount64.
      */
@@ -5476,6 +5675,16 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PIS_WOW64_PROCESS pIsWow64Process;
 
+    /**
+     If it's available on the current system, a pointer to PostQueuedCompletionStatus.
+     */
+    PPOST_QUEUED_COMPLETION_STATUS pPostQueuedCompletionStatus;
+
+    /**
+     If it's available on the current system, a pointer to PrefetchVirtualMemory.
+     */
+    PPREFETCH_VIRTUAL_MEMORY pPrefetchVirtualMemory;
+
     /**
      If it's available on the current system, a pointer to QueryFullProcessImageNameW.
      */
@@ -5491,6 +5700,16 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PREGISTER_APPLICATION_RESTART pRegisterApplicationRestart;
 
+    /**
+     If it's available on the current system, a pointer to RegisterWaitForSingleObject.
+     */
+    PREGISTER_WAIT_FOR_SINGLE_OBJECT pRegisterWaitForSingleObject;
+
+    /**
+     If it's available on the current system, a pointer to ReplaceFileW.
+     */
+    PREPLACE_FILEW pReplaceFileW;
+
     /**
      If it's available on the current system, a pointer to RtlCaptureStackBackTrace.
      */
@@ -5516,6 +5735,11 @@ typedef struct _YORI_KERNEL32_FUNCTIONS {
      */
     PSET_INFORMATION_JOB_OBJECT pSetInformationJobObject;
 
+    /**
+     If it's available on the current system, a pointer to UnregisterWaitEx.
+     */
+    PUNREGISTER_WAIT_EX pUnregisterWaitEx;
+
     /**
      If it's available on the current system, a pointer to Wow64DisableWow64FsRedirection.
      */
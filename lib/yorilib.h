@@ -81,7 +81,9 @@ typedef YORI_STRING CONST *PCYORI_STRING;
 typedef struct _YORI_HASH_ENTRY {
 
     /**
-     The links of this entry within the hash bucket.
+     The links of this entry with any other entries that share the same key.
+     The entry referenced from the hash table is the most recently inserted,
+     and the next entry is the one which was inserted before it.
      */
     YORI_LIST_ENTRY ListEntry;
 
@@ -95,33 +97,60 @@ typedef struct _YORI_HASH_ENTRY {
      table to identify the entry.
      */
     PVOID Context;
+
+    /**
+     The hash table that this entry is inserted into, or NULL if the entry
+     is not inserted into a hash table.
+     */
+    struct _YORI_HASH_TABLE *HashTable;
+
+    /**
+     The index of the slot within the hash table that refers to this entry.
+     This is only meaningful if the slot refers to this entry, since entries
+     which share a key with a more recently inserted entry are not referenced
+     from a slot.
+     */
+    DWORD SlotIndex;
 } YORI_HASH_ENTRY, *PYORI_HASH_ENTRY;
 
 /**
- A structure describing a hash bucket in a hash table.
+ A structure describing a slot in a hash table.  The hash of the key is
+ stored alongside the entry so that most nonmatching entries can be skipped
+ without accessing them.
  */
-typedef struct _YORI_HASH_BUCKET {
+typedef struct _YORI_HASH_SLOT {
 
     /**
-     A list of matching entries within the hash bucket.
+     The hash of the key of the entry in this slot.
      */
-    YORI_LIST_ENTRY ListHead;
-} YORI_HASH_BUCKET, *PYORI_HASH_BUCKET;
+    DWORDLONG Hash;
+
+    /**
+     Pointer to the entry in this slot, or NULL if the slot is empty.
+     */
+    PYORI_HASH_ENTRY Entry;
+} YORI_HASH_SLOT, *PYORI_HASH_SLOT;
 
 /**
- A structure describing a hash table.
+ A structure describing a hash table.  This is an open addressed table
+ using linear probing, which grows as entries are inserted.
  */
 typedef struct _YORI_HASH_TABLE {
 
     /**
-     The number of buckets in the hash table.
+     The number of slots in the hash table.  This is always a power of two.
+     */
+    DWORD NumberSlots;
+
+    /**
+     The number of slots in the hash table which are currently in use.
      */
-    DWORD NumberBuckets;
+    DWORD NumberSlotsInUse;
 
     /**
-     An array of hash buckets.
+     An array of slots.
      */
-    PYORI_HASH_BUCKET Buckets;
+    PYORI_HASH_SLOT Slots;
 } YORI_HASH_TABLE, *PYORI_HASH_TABLE;
 
 #pragma pack(push, 1)
@@ -1090,6 +1119,21 @@ typedef YORILIB_FILE_ENUM_FN *PYORILIB_FILE_ENUM_FN;
  */
 #define YORILIB_FILEENUM_DIRECTORY_CONTENTS      0x00000100
 
+/**
+ When recursing, enumerate subdirectories on a pool of threads.  Callbacks
+ may be invoked concurrently from any of these threads unless
+ YORILIB_FILEENUM_SERIALIZE_CALLBACKS is also specified, and results from
+ different directories are returned in no particular order.
+ */
+#define YORILIB_FILEENUM_PARALLEL                0x00000200
+
+/**
+ When enumerating with YORILIB_FILEENUM_PARALLEL, invoke callbacks one at a
+ time, so that callbacks which are not thread safe can still benefit from
+ parallel enumeration.
+ */
+#define YORILIB_FILEENUM_SERIALIZE_CALLBACKS     0x00000400
+
 __success(return)
 BOOL
 YoriLibForEachFile(
@@ -1911,6 +1955,76 @@ YoriLibGenerateWriteTime(
     __in PYORI_STRING String
     );
 
+// *** FILEMAP.C ***
+
+/**
+ State for reading a file by mapping successive views of it into memory.
+ */
+typedef struct _YORI_LIB_MAPPED_INPUT {
+
+    /**
+     Handle to the file.
+     */
+    HANDLE FileHandle;
+
+    /**
+     Handle to the section describing the file.
+     */
+    HANDLE hMap;
+
+    /**
+     The size of the file, in bytes.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The offset within the file of the next byte to return.
+     */
+    LARGE_INTEGER CurrentOffset;
+
+    /**
+     The offset within the file of the currently mapped view.
+     */
+    LARGE_INTEGER ViewOffset;
+
+    /**
+     Pointer to the currently mapped view, or NULL if no view is mapped.
+     */
+    PUCHAR View;
+
+    /**
+     The number of bytes in the currently mapped view.
+     */
+    DWORD ViewLength;
+
+    /**
+     Set to TRUE if a view could not be mapped, so the data returned does not
+     describe the entire file.
+     */
+    BOOLEAN Failed;
+} YORI_LIB_MAPPED_INPUT, *PYORI_LIB_MAPPED_INPUT;
+
+__success(return)
+BOOL
+YoriLibMappedInputOpen(
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_MAPPED_INPUT MappedInput
+    );
+
+__success(return)
+BOOL
+YoriLibMappedInputGetNext(
+    __inout PYORI_LIB_MAPPED_INPUT MappedInput,
+    __in DWORD MaximumLength,
+    __out PVOID * Buffer,
+    __out PDWORD Length
+    );
+
+VOID
+YoriLibMappedInputClose(
+    __inout PYORI_LIB_MAPPED_INPUT MappedInput
+    );
+
 // *** FULLPATH.C ***
 
 /**
@@ -2071,6 +2185,11 @@ YoriLibIsCurrentUserInGroup(
 
 // *** HASH.C ***
 
+DWORDLONG
+YoriLibHashString(
+    __in PCYORI_STRING String
+    );
+
 PYORI_HASH_TABLE
 YoriLibAllocateHashTable(
     __in DWORD NumberBuckets
@@ -2081,7 +2200,7 @@ YoriLibFreeEmptyHashTable(
     __in PYORI_HASH_TABLE HashTable
     );
 
-VOID
+BOOLEAN
 YoriLibHashInsertByKey(
     __in PYORI_HASH_TABLE HashTable,
     __in PYORI_STRING KeyString,
@@ -2220,6 +2339,68 @@ YoriLibMultibyteInput(
     __in DWORD OutputBufferLength
     );
 
+// *** INI.C ***
+
+__success(return)
+BOOL
+YoriLibIniOpen(
+    __in PCYORI_STRING FileName,
+    __out PVOID *IniDocument
+    );
+
+VOID
+YoriLibIniClose(
+    __in PVOID IniDocument
+    );
+
+DWORD
+YoriLibIniGetString(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __in LPCTSTR Key,
+    __in_opt LPCTSTR Default,
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength
+    );
+
+DWORD
+YoriLibIniGetInt(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __in LPCTSTR Key,
+    __in DWORD Default
+    );
+
+DWORD
+YoriLibIniGetSection(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength
+    );
+
+DWORD
+YoriLibIniGetSectionNames(
+    __in PVOID IniDocument,
+    __out_ecount(BufferLength) LPTSTR Buffer,
+    __in DWORD BufferLength
+    );
+
+__success(return)
+BOOL
+YoriLibIniSetString(
+    __in PVOID IniDocument,
+    __in LPCTSTR Section,
+    __in_opt LPCTSTR Key,
+    __in_opt LPCTSTR Value
+    );
+
+__success(return)
+BOOL
+YoriLibIniCommit(
+    __in PVOID IniDocument
+    );
+
 // *** JOBOBJ.C ***
 
 HANDLE
@@ -2268,6 +2449,36 @@ typedef enum _YORI_LIB_LINE_ENDING {
  */
 typedef YORI_LIB_LINE_ENDING *PYORI_LIB_LINE_ENDING;
 
+/**
+ A line returned from the line reader without conversion, referring to the
+ data within the line reader's buffer.
+ */
+typedef struct _YORI_LIB_LINE_VIEW {
+
+    /**
+     Pointer to the start of the line, in the input encoding.
+     */
+    PVOID Buffer;
+
+    /**
+     The number of characters in the line, excluding any line ending.  These
+     are 16 bit characters if WideChars is TRUE, and 8 bit characters
+     otherwise.
+     */
+    DWORD LengthInChars;
+
+    /**
+     TRUE if the input encoding is UTF16, FALSE if it uses 8 bit characters.
+     */
+    BOOLEAN WideChars;
+} YORI_LIB_LINE_VIEW, *PYORI_LIB_LINE_VIEW;
+
+DWORD
+YoriLibBytesInBom(
+    __in PCHAR StringToCheck,
+    __in DWORD BytesInString
+    );
+
 PVOID
 YoriLibReadLineToString(
     __in PYORI_STRING UserString,
@@ -2286,6 +2497,50 @@ YoriLibReadLineToStringEx(
     __out PBOOL TimeoutReached
     );
 
+DWORD
+YoriLibFindLineBreakA(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    );
+
+DWORD
+YoriLibFindLineBreakW(
+    __in PWCHAR Buffer,
+    __in DWORD Length
+    );
+
+__success(return)
+BOOL
+YoriLibReadLineToView(
+    __out PYORI_LIB_LINE_VIEW LineView,
+    __inout PVOID * Context,
+    __in HANDLE FileHandle
+    );
+
+__success(return)
+BOOL
+YoriLibReadLineToViewEx(
+    __out PYORI_LIB_LINE_VIEW LineView,
+    __inout PVOID * Context,
+    __in BOOL ReturnFinalNonTerminatedLine,
+    __in DWORD MaximumDelay,
+    __in HANDLE FileHandle,
+    __out PYORI_LIB_LINE_ENDING LineEnding,
+    __out PBOOL TimeoutReached
+    );
+
+__success(return)
+BOOL
+YoriLibLineViewToString(
+    __in PYORI_LIB_LINE_VIEW LineView,
+    __inout PYORI_STRING UserString
+    );
+
+BOOL
+YoriLibLineReadIsLineBuffered(
+    __in_opt PVOID Context
+    );
+
 VOID
 YoriLibLineReadClose(
     __in_opt PVOID Context
@@ -2439,6 +2694,96 @@ YoriLibRecycleBinFile(
     __in PYORI_STRING FilePath
     );
 
+// *** STRMATCH.C ***
+
+/**
+ State used to search strings for any of a set of substrings.
+ */
+typedef struct _YORI_LIB_SUBSTRING_MATCHER {
+
+    /**
+     The number of substrings to look for.
+     */
+    DWORD NumberMatches;
+
+    /**
+     An array of substrings to look for.  This is owned by the caller.
+     */
+    PYORI_STRING MatchArray;
+
+    /**
+     TRUE if substrings should be matched without regard to case.
+     */
+    BOOLEAN Insensitive;
+
+    /**
+     TRUE if any of the substrings is empty, which matches at the start of
+     any string.
+     */
+    BOOLEAN ContainsEmptyMatch;
+
+    /**
+     When searching for a single substring, its first character.
+     */
+    TCHAR FirstChar;
+
+    /**
+     When searching for a single substring, the other case of its first
+     character, or the same character if it has no other case or the search
+     is case sensitive.
+     */
+    TCHAR FirstCharAlternate;
+
+    /**
+     The length of the longest substring, in characters.
+     */
+    DWORD MaximumMatchLength;
+
+    /**
+     The number of states in use within the automaton.
+     */
+    DWORD NumberStates;
+
+    /**
+     When searching for multiple substrings, an array of states forming an
+     automaton.  NULL when searching for a single substring.
+     */
+    struct _YORI_LIB_SUBSTRING_MATCH_STATE *States;
+
+    /**
+     The state reached from the initial state for each ASCII character.
+     */
+    DWORD RootTable[128];
+
+} YORI_LIB_SUBSTRING_MATCHER, *PYORI_LIB_SUBSTRING_MATCHER;
+
+__success(return)
+BOOL
+YoriLibInitializeSubstringMatcher(
+    __out PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in DWORD NumberMatches,
+    __in PYORI_STRING MatchArray,
+    __in BOOLEAN Insensitive
+    );
+
+VOID
+YoriLibFreeSubstringMatcher(
+    __inout PYORI_LIB_SUBSTRING_MATCHER Matcher
+    );
+
+PYORI_STRING
+YoriLibFindSubstringMatch(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String,
+    __out_opt PDWORD StringOffsetOfMatch
+    );
+
+PYORI_STRING
+YoriLibFindFirstListedSubstringMatch(
+    __in PYORI_LIB_SUBSTRING_MATCHER Matcher,
+    __in PYORI_STRING String
+    );
+
 // *** STRMENUM.C ***
 
 BOOL
@@ -2623,6 +2968,19 @@ YoriLibOutputString(
     __in PYORI_STRING String
     );
 
+BOOL
+YoriLibOutputEnableBuffering(
+    __in HANDLE hOutput
+    );
+
+BOOL
+YoriLibOutputFlush(
+    __in HANDLE hOutput
+    );
+
+BOOL
+YoriLibOutputDisableBuffering();
+
 BOOL
 YoriLibVtSetConsoleTextAttributeOnDevice(
     __in HANDLE hOut,
@@ -2701,6 +3059,8 @@ typedef BOOL YORI_LIB_PATH_MATCH_FN(PYORI_STRING Match, PVOID Context);
  */
 typedef YORI_LIB_PATH_MATCH_FN *PYORI_LIB_PATH_MATCH_FN;
 
+extern LPCTSTR YoriLibDefaultPathExt;
+
 __success(return)
 BOOL
 YoriLibPathLocateKnownExtensionUnknownLocation(
@@ -105,7 +105,13 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
     YORI_STRING Caption;
 
     /**
-     An array of lines corresponding to lines within a file.
+     An array of lines corresponding to lines within a file.  This is
+     maintained as a gap buffer: lines before GapStart are at the beginning
+     of the array and all following lines are at the end of the array, with
+     any unused entries between the two.  Inserting or deleting lines only
+     needs to move the lines between the previous modification and the
+     current one.  Lines should be located with
+     @ref YoriWinMultilineEditGetLine .
      */
     PYORI_STRING LineArray;
 
@@ -115,10 +121,17 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
     DWORD LinesAllocated;
 
     /**
-     The number of lines populated with text within LineArray.
+     The number of lines populated with text within LineArray.  The gap
+     consists of LinesAllocated - LinesPopulated entries.
      */
     DWORD LinesPopulated;
 
+    /**
+     The line index of the first line following the gap in LineArray.  This
+     is also the array index of the first unused entry in the gap.
+     */
+    DWORD GapStart;
+
     /**
      The index within LineArray that is displayed at the top of the control.
      */
@@ -219,6 +232,67 @@ typedef struct _YORI_WIN_CTRL_MULTILINE_EDIT {
 
 } YORI_WIN_CTRL_MULTILINE_EDIT, *PYORI_WIN_CTRL_MULTILINE_EDIT;
 
+/**
+ Return a pointer to a line within the multiline edit control.
+
+ @param MultilineEdit Pointer to the multiline edit control.
+
+ @param LineIndex Specifies the line number to return.  This must be less
+        than the number of populated lines.
+
+ @return Pointer to the line.
+ */
+PYORI_STRING
+YoriWinMultilineEditGetLine(
+    __in PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit,
+    __in DWORD LineIndex
+    )
+{
+    ASSERT(LineIndex < MultilineEdit->LinesPopulated);
+    if (LineIndex < MultilineEdit->GapStart) {
+        return &MultilineEdit->LineArray[LineIndex];
+    }
+    return &MultilineEdit->LineArray[LineIndex + MultilineEdit->LinesAllocated - MultilineEdit->LinesPopulated];
+}
+
+/**
+ Move the gap in the line array so that it is immediately before the
+ specified line.  Lines can then be inserted at this point by populating
+ entries from GapStart onwards, or the lines immediately before or after
+ the gap can be deleted, without moving any other lines.
+
+ @param MultilineEdit Pointer to the multiline edit control.
+
+ @param NewGapStart Specifies the line index that should immediately follow
+        the gap.  This can be equal to the number of populated lines to move
+        the gap to the end of the array.
+ */
+VOID
+YoriWinMultilineEditMoveGap(
+    __in PYORI_WIN_CTRL_MULTILINE_EDIT MultilineEdit,
+    __in DWORD NewGapStart
+    )
+{
+    DWORD GapSize;
+
+    ASSERT(NewGapStart <= MultilineEdit->LinesPopulated);
+    GapSize = MultilineEdit->LinesAllocated - MultilineEdit->LinesPopulated;
+
+    if (GapSize > 0) {
+        if (NewGapStart < MultilineEdit->GapStart) {
+            memmove(&MultilineEdit->LineArray[NewGapStart + GapSize],
+                    &MultilineEdit->LineArray[NewGapStart],
+                    (MultilineEdit->GapStart - NewGapStart) * sizeof(YORI_STRING));
+        } else if (NewGapStart > MultilineEdit->GapStart) {
+            memmove(&MultilineEdit->LineArray[MultilineEdit->GapStart],
+                    &MultilineEdit->LineArray[MultilineEdit->GapStart + GapSize],
+                    (NewGapStart - MultilineEdit->GapStart) * sizeof(YORI_STRING));
+        }
+    }
+
+    MultilineEdit->GapStart = NewGapStart;
+}
+
 /**
  Calculate the line of text to display.  This is typically the exact same
  string as the line from the file's contents, but can diverge due to 
@@ -252,7 +326,7 @@ YoriWinMultilineEditGenerateDisplayLine(
 
     ASSERT(LineIndex < MultilineEdit->LinesPopulated);
 
-    SourceLine = &MultilineEdit->LineArray[LineIndex];
+    SourceLine = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     NeedDoubleBuffer = FALSE;
     TabCount = 0;
@@ -326,7 +400,7 @@ YoriWinMultilineEditFindCursorCharFromDisplayChar(
         return;
     }
 
-    Line = &MultilineEdit->LineArray[LineIndex];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     CurrentDisplayIndex = 0;
     for (CharIndex = 0; CharIndex < Line->LengthInChars; CharIndex++) {
@@ -376,7 +450,7 @@ YoriWinMultilineEditFindDisplayCharFromCursorChar(
         return;
     }
 
-    Line = &MultilineEdit->LineArray[LineIndex];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     CurrentDisplayIndex = 0;
     for (CharIndex = 0; CharIndex < Line->LengthInChars; CharIndex++) {
@@ -966,14 +1040,20 @@ YoriWinMultilineEditMergeLines(
     )
 {
     PYORI_STRING Line[2];
-    DWORD LinesToCopy;
 
-    if (FirstLineIndex + 1 > MultilineEdit->LinesPopulated) {
+    if (FirstLineIndex + 1 >= MultilineEdit->LinesPopulated) {
         return FALSE;
     }
 
-    Line[0] = &MultilineEdit->LineArray[FirstLineIndex];
-    Line[1] = &MultilineEdit->LineArray[FirstLineIndex + 1];
+    //
+    //  Move the gap to be immediately before the second line so that it
+    //  can be removed by extending the gap.
+    //
+
+    YoriWinMultilineEditMoveGap(MultilineEdit, FirstLineIndex + 1);
+
+    Line[0] = YoriWinMultilineEditGetLine(MultilineEdit, FirstLineIndex);
+    Line[1] = YoriWinMultilineEditGetLine(MultilineEdit, FirstLineIndex + 1);
 
     if (Line[0]->LengthInChars + Line[1]->LengthInChars > Line[0]->LengthAllocated) {
         YORI_STRING TargetLine;
@@ -993,12 +1073,6 @@ YoriWinMultilineEditMergeLines(
 
     YoriLibFreeStringContents(Line[1]);
 
-    LinesToCopy = MultilineEdit->LinesPopulated - FirstLineIndex - 2;
-    if (LinesToCopy > 0) {
-        memmove(&MultilineEdit->LineArray[FirstLineIndex + 1],
-                &MultilineEdit->LineArray[FirstLineIndex + 2], 
-                LinesToCopy * sizeof(YORI_STRING));
-    }
     MultilineEdit->LinesPopulated--;
     YoriWinMultilineEditExpandDirtyRange(MultilineEdit, FirstLineIndex, MultilineEdit->LinesPopulated);
 
@@ -1031,8 +1105,8 @@ YoriWinMultilineEditCheckSelectionState(
     } else {
         ASSERT(Selection->LastLine != Selection->FirstLine || Selection->FirstCharOffset < Selection->LastCharOffset);
     }
-    ASSERT(Selection->FirstCharOffset <= MultilineEdit->LineArray[Selection->FirstLine].LengthInChars);
-    ASSERT(Selection->LastCharOffset <= MultilineEdit->LineArray[Selection->LastLine].LengthInChars);
+    ASSERT(Selection->FirstCharOffset <= YoriWinMultilineEditGetLine(MultilineEdit, Selection->FirstLine)->LengthInChars);
+    ASSERT(Selection->LastCharOffset <= YoriWinMultilineEditGetLine(MultilineEdit, Selection->LastLine)->LengthInChars);
 }
 
 /**
@@ -1054,9 +1128,8 @@ YoriWinMultilineEditSplitLines(
     __in DWORD CharOffset
     )
 {
-    PYORI_STRING Line[2];
+    PYORI_STRING Line;
     YORI_STRING TargetLine;
-    DWORD LinesToCopy;
     DWORD CharsNeededOnNewLine;
 
     if (LineIndex >= MultilineEdit->LinesPopulated) {
@@ -1068,48 +1141,39 @@ YoriWinMultilineEditSplitLines(
     //  calling this function.
     //
 
-    ASSERT(LineIndex + 1 < MultilineEdit->LinesAllocated);
-    if (LineIndex + 1 >= MultilineEdit->LinesAllocated) {
+    ASSERT(MultilineEdit->LinesPopulated < MultilineEdit->LinesAllocated);
+    if (MultilineEdit->LinesPopulated >= MultilineEdit->LinesAllocated) {
         return FALSE;
     }
 
-    Line[0] = &MultilineEdit->LineArray[LineIndex];
-    Line[1] = &MultilineEdit->LineArray[LineIndex + 1];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
 
     //
     //  If there is text to preserve from the end of the first line, allocate
     //  a new line and copy the text into it.
     //
 
-    if (CharOffset < Line[0]->LengthInChars) {
-        CharsNeededOnNewLine = Line[0]->LengthInChars - CharOffset;
+    if (CharOffset < Line->LengthInChars) {
+        CharsNeededOnNewLine = Line->LengthInChars - CharOffset;
         if (!YoriLibAllocateString(&TargetLine, CharsNeededOnNewLine + YORI_WIN_MULTILINE_EDIT_LINE_PADDING)) {
             return FALSE;
         }
 
-        memcpy(TargetLine.StartOfString, &Line[0]->StartOfString[CharOffset], CharsNeededOnNewLine * sizeof(TCHAR));
+        memcpy(TargetLine.StartOfString, &Line->StartOfString[CharOffset], CharsNeededOnNewLine * sizeof(TCHAR));
         TargetLine.LengthInChars = CharsNeededOnNewLine;
-        Line[0]->LengthInChars = CharOffset;
+        Line->LengthInChars = CharOffset;
     } else {
         YoriLibInitEmptyString(&TargetLine);
     }
 
     //
-    //  If there are lines following this point, move them down.
-    //
-
-    LinesToCopy = MultilineEdit->LinesPopulated - LineIndex - 1;
-    if (LinesToCopy > 0) {
-        memmove(&MultilineEdit->LineArray[LineIndex + 2],
-                &MultilineEdit->LineArray[LineIndex + 1], 
-                LinesToCopy * sizeof(YORI_STRING));
-    }
-
-    //
-    //  Copy the new line into position.
+    //  Move the gap to follow this line and copy the new line into the
+    //  beginning of the gap.
     //
 
-    memcpy(Line[1], &TargetLine, sizeof(YORI_STRING));
+    YoriWinMultilineEditMoveGap(MultilineEdit, LineIndex + 1);
+    memcpy(&MultilineEdit->LineArray[MultilineEdit->GapStart], &TargetLine, sizeof(YORI_STRING));
+    MultilineEdit->GapStart++;
     MultilineEdit->LinesPopulated++;
     YoriWinMultilineEditExpandDirtyRange(MultilineEdit, LineIndex, MultilineEdit->LinesPopulated);
 
@@ -1137,8 +1201,6 @@ YoriWinMultilineEditDeleteSelection(
     DWORD CharsToCopy;
     DWORD CharsToDelete;
     DWORD LinesToDelete;
-    DWORD LinesToCopy;
-    DWORD FirstLineIndexToKeep;
     DWORD LineIndexToDelete;
     PYORI_STRING Line;
     PYORI_STRING FinalLine;
@@ -1151,7 +1213,7 @@ YoriWinMultilineEditDeleteSelection(
     }
 
     Selection = &MultilineEdit->Selection;
-    Line = &MultilineEdit->LineArray[Selection->FirstLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, Selection->FirstLine);
 
     //
     //  If the selection is one line, this is a simple case, because no
@@ -1184,16 +1246,24 @@ YoriWinMultilineEditDeleteSelection(
 
     LinesToDelete = 0;
     ASSERT(Selection->LastLine < MultilineEdit->LinesPopulated);
-    FinalLine = &MultilineEdit->LineArray[Selection->LastLine];
+
+    //
+    //  Move the gap to follow the selection so that the lines being deleted
+    //  can be removed by extending the gap.
+    //
+
+    YoriWinMultilineEditMoveGap(MultilineEdit, Selection->LastLine + 1);
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, Selection->FirstLine);
+    FinalLine = YoriWinMultilineEditGetLine(MultilineEdit, Selection->LastLine);
     CharsToCopy = FinalLine->LengthInChars - Selection->LastCharOffset;
 
     //
     //  If the first part of the first line and the last part of the last
-    //  line (the unselected regions of each) don't fit in the final line's
+    //  line (the unselected regions of each) don't fit in the first line's
     //  allocation, reallocate it.
     //
 
-    if (Selection->FirstCharOffset + CharsToCopy > FinalLine->LengthAllocated) {
+    if (Selection->FirstCharOffset + CharsToCopy > Line->LengthAllocated) {
         YORI_STRING NewLine;
         if (!YoriLibAllocateString(&NewLine, Selection->FirstCharOffset + CharsToCopy + YORI_WIN_MULTILINE_EDIT_LINE_PADDING)) {
             return FALSE;
@@ -1221,17 +1291,13 @@ YoriWinMultilineEditDeleteSelection(
     LinesToDelete = Selection->LastLine - Selection->FirstLine;
 
     for (LineIndexToDelete = 0; LineIndexToDelete < LinesToDelete; LineIndexToDelete++) {
-        YoriLibFreeStringContents(&MultilineEdit->LineArray[Selection->FirstLine + 1 + LineIndexToDelete]);
+        YoriLibFreeStringContents(YoriWinMultilineEditGetLine(MultilineEdit, Selection->FirstLine + 1 + LineIndexToDelete));
     }
 
-    FirstLineIndexToKeep = Selection->FirstLine + 1 + LinesToDelete;
-    LinesToCopy = MultilineEdit->LinesPopulated - FirstLineIndexToKeep;
-    memmove(&MultilineEdit->LineArray[Selection->FirstLine + 1],
-            &MultilineEdit->LineArray[Selection->FirstLine + 1 + LinesToDelete],
-            LinesToCopy * sizeof(YORI_STRING));
-
     YoriWinMultilineEditExpandDirtyRange(MultilineEdit, Selection->FirstLine, MultilineEdit->LinesPopulated);
 
+    ASSERT(MultilineEdit->GapStart == Selection->FirstLine + 1 + LinesToDelete);
+    MultilineEdit->GapStart = MultilineEdit->GapStart - LinesToDelete;
     MultilineEdit->LinesPopulated = MultilineEdit->LinesPopulated - LinesToDelete;
 
     YoriWinMultilineEditSetCursorLocationInternal(MultilineEdit, Selection->FirstCharOffset, Selection->FirstLine);
@@ -1284,7 +1350,7 @@ YoriWinMultilineEditGetSelectedText(
     }
 
     Selection = &MultilineEdit->Selection;
-    Line = &MultilineEdit->LineArray[Selection->FirstLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, Selection->FirstLine);
 
     if (Selection->FirstLine == Selection->LastLine) {
 
@@ -1303,7 +1369,7 @@ YoriWinMultilineEditGetSelectedText(
     LinesInRange = Selection->LastLine - Selection->FirstLine;
     CharsInRange = Line->LengthInChars - Selection->FirstCharOffset;
     for (LineIndex = Selection->FirstLine + 1; LineIndex < Selection->LastLine; LineIndex++) {
-        CharsInRange += MultilineEdit->LineArray[LineIndex].LengthInChars;
+        CharsInRange += YoriWinMultilineEditGetLine(MultilineEdit, LineIndex)->LengthInChars;
     }
     CharsInRange += Selection->LastCharOffset;
 
@@ -1317,14 +1383,13 @@ YoriWinMultilineEditGetSelectedText(
     for (LineIndex = Selection->FirstLine + 1; LineIndex < Selection->LastLine; LineIndex++) {
         memcpy(Ptr, NewlineString->StartOfString, NewlineString->LengthInChars * sizeof(TCHAR));
         Ptr += NewlineString->LengthInChars;
-        memcpy(Ptr,
-               MultilineEdit->LineArray[LineIndex].StartOfString,
-               MultilineEdit->LineArray[LineIndex].LengthInChars * sizeof(TCHAR));
-        Ptr += MultilineEdit->LineArray[LineIndex].LengthInChars;
+        Line = YoriWinMultilineEditGetLine(MultilineEdit, LineIndex);
+        memcpy(Ptr, Line->StartOfString, Line->LengthInChars * sizeof(TCHAR));
+        Ptr += Line->LengthInChars;
     }
     memcpy(Ptr, NewlineString->StartOfString, NewlineString->LengthInChars * sizeof(TCHAR));
     Ptr += NewlineString->LengthInChars;
-    memcpy(Ptr, MultilineEdit->LineArray[Selection->LastLine].StartOfString, Selection->LastCharOffset * sizeof(TCHAR));
+    memcpy(Ptr, YoriWinMultilineEditGetLine(MultilineEdit, Selection->LastLine)->StartOfString, Selection->LastCharOffset * sizeof(TCHAR));
     Ptr += Selection->LastCharOffset;
 
     SelectedText->LengthInChars = (DWORD)(Ptr - SelectedText->StartOfString);
@@ -1351,6 +1416,7 @@ YoriWinMultilineEditReallocateLineArray(
     )
 {
     PYORI_STRING NewLineArray;
+    DWORD LinesAfterGap;
     ASSERT(NewLineCount > MultilineEdit->LinesPopulated);
 
     NewLineArray = YoriLibReferencedMalloc(NewLineCount * sizeof(YORI_STRING));
@@ -1358,8 +1424,17 @@ YoriWinMultilineEditReallocateLineArray(
         return FALSE;
     }
 
-    if (MultilineEdit->LinesPopulated > 0) {
-        memcpy(NewLineArray, MultilineEdit->LineArray, MultilineEdit->LinesPopulated * sizeof(YORI_STRING));
+    //
+    //  Preserve the location of the gap, so lines before it are copied to
+    //  the beginning of the new array and lines after it to the end.
+    //
+
+    if (MultilineEdit->LineArray != NULL) {
+        LinesAfterGap = MultilineEdit->LinesPopulated - MultilineEdit->GapStart;
+        memcpy(NewLineArray, MultilineEdit->LineArray, MultilineEdit->GapStart * sizeof(YORI_STRING));
+        memcpy(&NewLineArray[NewLineCount - LinesAfterGap],
+               &MultilineEdit->LineArray[MultilineEdit->LinesAllocated - LinesAfterGap],
+               LinesAfterGap * sizeof(YORI_STRING));
         YoriLibDereference(MultilineEdit->LineArray);
     }
 
@@ -1393,6 +1468,9 @@ YoriWinMultilineEditInsertTextAtCursor(
     DWORD CharsFirstLine;
     DWORD CharsLastLine;
     DWORD CharsNeeded;
+    DWORD PasteBufferLength;
+    DWORD PasteBufferOffset;
+    LPTSTR PasteBuffer;
     YORI_STRING TrailingPortionOfCursorLine;
     PYORI_STRING Line;
     BOOLEAN TerminateLine;
@@ -1419,14 +1497,12 @@ YoriWinMultilineEditInsertTextAtCursor(
 
     //
     //  If new lines are being added, check if the line array is large
-    //  enough and reallocate as needed.  Even if lines are already
-    //  allocated, the current lines need to be moved downwards to make room
-    //  for the lines that are about to be inserted.
+    //  enough and reallocate as needed.  The gap is moved to follow the
+    //  cursor line and the new lines are inserted at the beginning of it.
     //
 
     if (LineCount > 0 || MultilineEdit->LinesPopulated == 0) {
         DWORD SourceLine;
-        DWORD TargetLine;
         DWORD LinesNeeded;
 
         LinesNeeded = MultilineEdit->LinesPopulated + LineCount;
@@ -1452,21 +1528,16 @@ YoriWinMultilineEditInsertTextAtCursor(
 
         if (MultilineEdit->LinesPopulated > 0) {
             SourceLine = MultilineEdit->CursorLine + 1;
-            TargetLine = SourceLine + LineCount;
         } else {
             SourceLine = MultilineEdit->CursorLine;
-            TargetLine = SourceLine + LineCount + 1;
-        }
-        if (SourceLine < MultilineEdit->LinesPopulated) {
-            DWORD LinesToMove;
-            LinesToMove = MultilineEdit->LinesPopulated - SourceLine;
-            memmove(&MultilineEdit->LineArray[TargetLine],
-                    &MultilineEdit->LineArray[SourceLine],
-                    LinesToMove * sizeof(YORI_STRING));
         }
 
-        for (Index = SourceLine; Index < TargetLine; Index++) {
-            YoriLibInitEmptyString(&MultilineEdit->LineArray[Index]);
+        ASSERT(SourceLine <= MultilineEdit->LinesPopulated);
+        YoriWinMultilineEditMoveGap(MultilineEdit, SourceLine);
+
+        for (Index = MultilineEdit->LinesPopulated; Index < LinesNeeded; Index++) {
+            YoriLibInitEmptyString(&MultilineEdit->LineArray[MultilineEdit->GapStart]);
+            MultilineEdit->GapStart++;
         }
 
         MultilineEdit->LinesPopulated = LinesNeeded;
@@ -1482,13 +1553,34 @@ YoriWinMultilineEditInsertTextAtCursor(
 
     YoriLibInitEmptyString(&TrailingPortionOfCursorLine);
     if (MultilineEdit->CursorLine < MultilineEdit->LinesPopulated) {
-        Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+        Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
         if (MultilineEdit->CursorOffset < Line->LengthInChars) {
             TrailingPortionOfCursorLine.StartOfString = &Line->StartOfString[MultilineEdit->CursorOffset];
             TrailingPortionOfCursorLine.LengthInChars = Line->LengthInChars - MultilineEdit->CursorOffset;
         }
     }
 
+    //
+    //  Rather than allocating each new line individually, allocate a single
+    //  buffer that can contain the text of all new lines, and have each line
+    //  refer to its portion of it.  This makes pasting a large number of
+    //  lines much cheaper.  Lines that are subsequently edited to be larger
+    //  are reallocated as needed.
+    //
+
+    PasteBuffer = NULL;
+    PasteBufferOffset = 0;
+    PasteBufferLength = 0;
+    if (LineCount > 0) {
+        PasteBufferLength = Text->LengthInChars + TrailingPortionOfCursorLine.LengthInChars;
+        if (PasteBufferLength > 0) {
+            PasteBuffer = YoriLibReferencedMalloc(PasteBufferLength * sizeof(TCHAR));
+            if (PasteBuffer == NULL) {
+                return FALSE;
+            }
+        }
+    }
+
     //
     //  Go through each line.  For all lines except the first, construct the
     //  new line.  Note that these lines should be empty lines due to the
@@ -1529,17 +1621,19 @@ YoriWinMultilineEditInsertTextAtCursor(
                     CharsLastLine = CharsThisLine;
                 }
             } else {
-                Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine + LineIndex];
-                ASSERT(Line->LengthInChars == 0);
+                Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine + LineIndex);
+                ASSERT(Line->LengthInChars == 0 && Line->LengthAllocated == 0);
                 CharsNeeded = CharsThisLine;
                 if (LineIndex == LineCount) {
                     CharsNeeded += TrailingPortionOfCursorLine.LengthInChars;
                 }
-                if (Line->LengthAllocated < CharsNeeded) {
-                    YoriLibFreeStringContents(Line);
-                    if (!YoriLibAllocateString(Line, CharsNeeded + YORI_WIN_MULTILINE_EDIT_LINE_PADDING)) {
-                        return FALSE;
-                    }
+                if (CharsNeeded > 0) {
+                    ASSERT(PasteBufferOffset + CharsNeeded <= PasteBufferLength);
+                    YoriLibReference(PasteBuffer);
+                    Line->MemoryToFree = PasteBuffer;
+                    Line->StartOfString = &PasteBuffer[PasteBufferOffset];
+                    Line->LengthAllocated = CharsNeeded;
+                    PasteBufferOffset += CharsNeeded;
                 }
 
                 if (CharsThisLine > 0) {
@@ -1586,6 +1680,10 @@ YoriWinMultilineEditInsertTextAtCursor(
         CharsThisLine++;
     }
 
+    if (PasteBuffer != NULL) {
+        YoriLibDereference(PasteBuffer);
+    }
+
     //
     //  Because the first line was left unaltered in the regular loop to
     //  enable its text to be moved to the end of the last line, fix up
@@ -1599,7 +1697,7 @@ YoriWinMultilineEditInsertTextAtCursor(
         YoriLibInitEmptyString(&TrailingPortionOfCursorLine);
     }
 
-    Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
     if (MultilineEdit->CursorOffset + CharsFirstLine + TrailingPortionOfCursorLine.LengthInChars > Line->LengthAllocated) {
         if (!YoriLibReallocateString(Line, MultilineEdit->CursorOffset + CharsFirstLine + TrailingPortionOfCursorLine.LengthInChars + YORI_WIN_MULTILINE_EDIT_LINE_PADDING)) {
             return FALSE;
@@ -1664,8 +1762,8 @@ YoriWinMultilineEditAppendLinesNoDataCopy(
         DWORD NewLinesToAllocate;
         NewLinesToAllocate = MultilineEdit->LinesAllocated * 2;
 
-        if (NewLinesToAllocate < NewLineCount) {
-            NewLinesToAllocate = NewLineCount;
+        if (NewLinesToAllocate < NewLineCount + MultilineEdit->LinesPopulated) {
+            NewLinesToAllocate = NewLineCount + MultilineEdit->LinesPopulated;
             NewLinesToAllocate += 0x1000;
             NewLinesToAllocate = NewLinesToAllocate & ~(0xfff);
         } else if (NewLinesToAllocate < 0x1000) {
@@ -1677,8 +1775,10 @@ YoriWinMultilineEditAppendLinesNoDataCopy(
         }
     }
 
-    memcpy(&MultilineEdit->LineArray[MultilineEdit->LinesPopulated], NewLines, NewLineCount * sizeof(YORI_STRING));
+    YoriWinMultilineEditMoveGap(MultilineEdit, MultilineEdit->LinesPopulated);
+    memcpy(&MultilineEdit->LineArray[MultilineEdit->GapStart], NewLines, NewLineCount * sizeof(YORI_STRING));
     YoriWinMultilineEditExpandDirtyRange(MultilineEdit, MultilineEdit->LinesPopulated, MultilineEdit->LinesPopulated + NewLineCount);
+    MultilineEdit->GapStart += NewLineCount;
     MultilineEdit->LinesPopulated += NewLineCount;
 
     YoriWinMultilineEditPaint(MultilineEdit);
@@ -1818,7 +1918,7 @@ YoriWinMultilineEditBackspace(
         return YoriWinMultilineEditDeleteSelection(&MultilineEdit->Ctrl);
     }
 
-    Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
 
     //
     //  If we're at the beginning of the line, we may need to merge lines.
@@ -1835,7 +1935,7 @@ YoriWinMultilineEditBackspace(
 
         MultilineEdit->UserModified = TRUE;
 
-        CursorOffset = MultilineEdit->LineArray[MultilineEdit->CursorLine - 1].LengthInChars;
+        CursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine - 1)->LengthInChars;
 
         if (!YoriWinMultilineEditMergeLines(MultilineEdit, MultilineEdit->CursorLine - 1)) {
             return FALSE;
@@ -1887,7 +1987,7 @@ YoriWinMultilineEditDelete(
         return YoriWinMultilineEditDeleteSelection(&MultilineEdit->Ctrl);
     }
 
-    Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
 
     if (MultilineEdit->CursorOffset >= Line->LengthInChars) {
         return FALSE;
@@ -1962,13 +2062,13 @@ YoriWinMultilineEditStartSelectionAtCursor(
         } else if (EffectiveCursorLine >= MultilineEdit->LinesPopulated) {
 
             EffectiveCursorLine = MultilineEdit->LinesPopulated - 1;
-            EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+            EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
 
         }
 
         if (EffectiveCursorLine < MultilineEdit->LinesPopulated) {
-            if (EffectiveCursorOffset > MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars) {
-                EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+            if (EffectiveCursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars) {
+                EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
             }
         }
 
@@ -2079,11 +2179,11 @@ YoriWinMultilineEditExtendSelectionToCursor(
     EffectiveCursorOffset = MultilineEdit->CursorOffset;
     if (EffectiveCursorLine >= MultilineEdit->LinesPopulated) {
         EffectiveCursorLine = MultilineEdit->LinesPopulated - 1;
-        EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+        EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
     }
 
-    if (EffectiveCursorOffset > MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars) {
-        EffectiveCursorOffset = MultilineEdit->LineArray[EffectiveCursorLine].LengthInChars;
+    if (EffectiveCursorOffset > YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars) {
+        EffectiveCursorOffset = YoriWinMultilineEditGetLine(MultilineEdit, EffectiveCursorLine)->LengthInChars;
     }
 
     if (EffectiveCursorLine < AnchorLine) {
@@ -2550,7 +2650,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedKey(
             YoriWinMultilineEditClearSelection(MultilineEdit);
         }
         if (MultilineEdit->CursorLine < MultilineEdit->LinesPopulated) {
-            FinalChar = MultilineEdit->LineArray[MultilineEdit->CursorLine].LengthInChars;
+            FinalChar = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine)->LengthInChars;
         }
         if (MultilineEdit->CursorOffset != FinalChar) {
             YoriWinMultilineEditSetCursorLocationInternal(MultilineEdit, FinalChar, MultilineEdit->CursorLine);
@@ -2699,7 +2799,7 @@ YoriWinMultilineEditProcessPossiblyEnhancedCtrlKey(
             YoriWinMultilineEditClearSelection(MultilineEdit);
         }
         if (MultilineEdit->LinesPopulated > 0) {
-            FinalChar = MultilineEdit->LineArray[MultilineEdit->LinesPopulated - 1].LengthInChars;
+            FinalChar = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->LinesPopulated - 1)->LengthInChars;
             if (MultilineEdit->CursorLine != MultilineEdit->LinesPopulated - 1 || MultilineEdit->CursorOffset != FinalChar) {
                 YoriWinMultilineEditSetCursorLocationInternal(MultilineEdit, FinalChar, MultilineEdit->LinesPopulated - 1);
                 if (Event->KeyDown.CtrlMask & SHIFT_PRESSED) {
@@ -2734,6 +2834,7 @@ YoriWinMultilineEditAddChar(
 {
     DWORD LineLengthNeeded;
     DWORD NewCursorOffset;
+    DWORD LinesNeeded;
     PYORI_STRING Line;
 
     if (YoriWinMultilineEditSelectionActive(MultilineEdit)) {
@@ -2744,14 +2845,24 @@ YoriWinMultilineEditAddChar(
     //  If the line array doesn't have enough lines, allocate more.
     //
 
-    if (MultilineEdit->CursorLine >= MultilineEdit->LinesAllocated ||
-        (Char == '\r' && MultilineEdit->LinesPopulated == MultilineEdit->LinesAllocated)) {
+    LinesNeeded = MultilineEdit->CursorLine + 1;
+    if (LinesNeeded < MultilineEdit->LinesPopulated) {
+        LinesNeeded = MultilineEdit->LinesPopulated;
+    }
+    if (Char == '\r') {
+        LinesNeeded++;
+    }
+
+    if (LinesNeeded > MultilineEdit->LinesAllocated) {
         DWORD NewLineCount;
 
         NewLineCount = MultilineEdit->LinesAllocated * 2;
         if (NewLineCount < 0x1000) {
             NewLineCount = 0x1000;
         }
+        if (NewLineCount < LinesNeeded) {
+            NewLineCount = LinesNeeded;
+        }
 
         if (!YoriWinMultilineEditReallocateLineArray(MultilineEdit, NewLineCount)) {
             return FALSE;
@@ -2776,11 +2887,15 @@ YoriWinMultilineEditAddChar(
     //  If the line array isn't populated to the current point, populate it.
     //
 
-    for (;
-         MultilineEdit->LinesPopulated <= MultilineEdit->CursorLine;
-         MultilineEdit->LinesPopulated++) {
+    if (MultilineEdit->LinesPopulated <= MultilineEdit->CursorLine) {
+        YoriWinMultilineEditMoveGap(MultilineEdit, MultilineEdit->LinesPopulated);
+        for (;
+             MultilineEdit->LinesPopulated <= MultilineEdit->CursorLine;
+             MultilineEdit->LinesPopulated++) {
 
-        YoriLibInitEmptyString(&MultilineEdit->LineArray[MultilineEdit->LinesPopulated]);
+            YoriLibInitEmptyString(&MultilineEdit->LineArray[MultilineEdit->GapStart]);
+            MultilineEdit->GapStart++;
+        }
     }
 
     MultilineEdit->UserModified = TRUE;
@@ -2790,7 +2905,7 @@ YoriWinMultilineEditAddChar(
     //  enough, reallocate it.
     //
 
-    Line = &MultilineEdit->LineArray[MultilineEdit->CursorLine];
+    Line = YoriWinMultilineEditGetLine(MultilineEdit, MultilineEdit->CursorLine);
 
     LineLengthNeeded = 0;
     if (MultilineEdit->InsertMode) {
@@ -2884,7 +2999,7 @@ YoriWinMultilineEditEventHandler(
     switch(Event->EventType) {
         case YoriWinEventParentDestroyed:
             for (Index = 0; Index < MultilineEdit->LinesPopulated; Index++) {
-                YoriLibFreeStringContents(&MultilineEdit->LineArray[Index]);
+                YoriLibFreeStringContents(YoriWinMultilineEditGetLine(MultilineEdit, Index));
             }
             if (MultilineEdit->LineArray != NULL) {
                 YoriLibDereference(MultilineEdit->LineArray);
@@ -3071,10 +3186,11 @@ YoriWinMultilineEditClear(
     MultilineEdit = CONTAINING_RECORD(Ctrl, YORI_WIN_CTRL_MULTILINE_EDIT, Ctrl);
 
     for (Index = 0; Index < MultilineEdit->LinesPopulated; Index++) {
-        YoriLibFreeStringContents(&MultilineEdit->LineArray[Index]);
+        YoriLibFreeStringContents(YoriWinMultilineEditGetLine(MultilineEdit, Index));
     }
 
     MultilineEdit->LinesPopulated = 0;
+    MultilineEdit->GapStart = 0;
     MultilineEdit->ViewportTop = 0;
     MultilineEdit->ViewportLeft = 0;
 
@@ -3135,7 +3251,7 @@ YoriWinMultilineEditGetLineByIndex(
         return NULL;
     }
 
-    return &MultilineEdit->LineArray[Index];
+    return YoriWinMultilineEditGetLine(MultilineEdit, Index);
 }
 
 /**
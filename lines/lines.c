@@ -36,8 +36,10 @@ CHAR strLinesHelpText[] =
         "Count the number of lines in one or more files.\n"
         "\n"
         "LINES [-license] [-b] [-s] [-t] [<file>...]\n"
+        "LINES -perf\n"
         "\n"
         "   -b             Use basic search criteria for files only\n"
+        "   -perf          Measure the speed of finding line breaks in generated text\n"
         "   -s             Process files from all subdirectories\n"
         "   -t             Display total line count of all files\n";
 
@@ -101,6 +103,115 @@ typedef struct _LINES_CONTEXT {
     LONGLONG TotalLinesFound;
 } LINES_CONTEXT, *PLINES_CONTEXT;
 
+/**
+ Count the lines in a file by scanning mapped views of it.  This follows the
+ rules of the line reader: a carriage return, line feed, or carriage return
+ followed by line feed each end a line, and any characters after the final
+ line break form one more line.
+
+ @param MappedInput Pointer to a file which has been prepared for mapping.
+
+ @param LinesContext Specifies the context to record line count information.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+LinesCountMappedStream(
+    __in PYORI_LIB_MAPPED_INPUT MappedInput,
+    __in PLINES_CONTEXT LinesContext
+    )
+{
+    PVOID Buffer;
+    PUCHAR CharBuffer;
+    PWCHAR WideBuffer;
+    DWORD Length;
+    DWORD CharsInBuffer;
+    DWORD Index;
+    WCHAR ThisChar;
+    BOOLEAN WideChars;
+    BOOLEAN PreviousWasCr;
+    BOOLEAN CharsSinceBreak;
+
+    WideChars = FALSE;
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        WideChars = TRUE;
+    }
+
+    PreviousWasCr = FALSE;
+    CharsSinceBreak = FALSE;
+
+    while (YoriLibMappedInputGetNext(MappedInput, (DWORD)-1, &Buffer, &Length)) {
+        CharBuffer = Buffer;
+        WideBuffer = Buffer;
+        if (WideChars) {
+            CharsInBuffer = Length / sizeof(WCHAR);
+        } else {
+            CharsInBuffer = Length;
+        }
+
+        //
+        //  A line feed which immediately follows a carriage return is part
+        //  of the same line break, including when the two are returned in
+        //  different views.
+        //
+
+        Index = 0;
+        if (PreviousWasCr && CharsInBuffer > 0) {
+            if (WideChars) {
+                ThisChar = WideBuffer[0];
+            } else {
+                ThisChar = CharBuffer[0];
+            }
+            if (ThisChar == '\n') {
+                Index = 1;
+            }
+        }
+        PreviousWasCr = FALSE;
+
+        while (Index < CharsInBuffer) {
+            if (WideChars) {
+                Index = Index + YoriLibFindLineBreakW(&WideBuffer[Index], CharsInBuffer - Index);
+            } else {
+                Index = Index + YoriLibFindLineBreakA(&CharBuffer[Index], CharsInBuffer - Index);
+            }
+
+            if (Index >= CharsInBuffer) {
+                CharsSinceBreak = TRUE;
+                break;
+            }
+
+            LinesContext->FileLinesFound++;
+            CharsSinceBreak = FALSE;
+
+            if (WideChars) {
+                ThisChar = WideBuffer[Index];
+            } else {
+                ThisChar = CharBuffer[Index];
+            }
+            Index++;
+
+            if (ThisChar == '\r') {
+                if (Index == CharsInBuffer) {
+                    PreviousWasCr = TRUE;
+                } else if ((WideChars && WideBuffer[Index] == '\n') ||
+                           (!WideChars && CharBuffer[Index] == '\n')) {
+                    Index++;
+                }
+            }
+        }
+    }
+
+    if (CharsSinceBreak) {
+        LinesContext->FileLinesFound++;
+    }
+
+    if (MappedInput->Failed) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  Count the lines in an opened stream.
 
@@ -117,17 +228,43 @@ LinesProcessStream(
     )
 {
     PVOID LineContext = NULL;
-    YORI_STRING LineString;
-
-    YoriLibInitEmptyString(&LineString);
+    YORI_LIB_LINE_VIEW LineView;
+    YORI_LIB_MAPPED_INPUT MappedInput;
+    BOOL Result;
 
     LinesContext->FilesFound++;
     LinesContext->FilesFoundThisArg++;
     LinesContext->FileLinesFound = 0;
 
+    //
+    //  If the source is a file, count line breaks directly in mapped views
+    //  of it rather than copying it through the line reader.
+    //
+
+    if (YoriLibMappedInputOpen(hSource, &MappedInput)) {
+        Result = LinesCountMappedStream(&MappedInput, LinesContext);
+        YoriLibMappedInputClose(&MappedInput);
+        LinesContext->TotalLinesFound += LinesContext->FileLinesFound;
+        return Result;
+    }
+
+    //
+    //  Reading from a pipe may block waiting for the producer, so write any
+    //  results for previous files first.
+    //
+
+    if (GetFileType(hSource) == FILE_TYPE_PIPE) {
+        YoriLibOutputFlush(GetStdHandle(STD_OUTPUT_HANDLE));
+    }
+
+    //
+    //  Only the number of lines is needed, so there is no need to convert
+    //  each line into a string.
+    //
+
     while (TRUE) {
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
+        if (!YoriLibReadLineToView(&LineView, &LineContext, hSource)) {
             break;
         }
 
@@ -135,7 +272,6 @@ LinesProcessStream(
     }
 
     YoriLibLineReadClose(LineContext);
-    YoriLibFreeStringContents(&LineString);
 
     LinesContext->TotalLinesFound += LinesContext->FileLinesFound;
     return TRUE;
@@ -278,6 +414,294 @@ LinesFileEnumerateErrorCallback(
     return Result;
 }
 
+/**
+ The number of characters of generated text to scan when measuring the
+ speed of finding line breaks.
+ */
+#define LINES_PERF_CHARS (8 * 1024 * 1024)
+
+/**
+ The number of times to scan the generated text when measuring the speed of
+ finding line breaks.
+ */
+#define LINES_PERF_ITERATIONS (16)
+
+/**
+ Convert a number of bytes processed over a number of performance counter
+ ticks into megabytes per second.
+
+ @param Bytes The number of bytes processed.
+
+ @param Ticks The number of performance counter ticks elapsed.
+
+ @param Frequency The number of performance counter ticks per second.
+
+ @return The throughput, in megabytes per second.
+ */
+DWORDLONG
+LinesPerfThroughput(
+    __in DWORDLONG Bytes,
+    __in LONGLONG Ticks,
+    __in LONGLONG Frequency
+    )
+{
+    if (Ticks <= 0) {
+        Ticks = 1;
+    }
+    return Bytes * Frequency / Ticks / (1024 * 1024);
+}
+
+/**
+ Fill a buffer with lines of varying length, ending alternately with a line
+ feed and a carriage return followed by a line feed.  Any space after the
+ final complete line is filled with characters that do not end a line.
+
+ @param Buffer Pointer to the buffer to fill.
+
+ @param Length The number of characters in the buffer.
+
+ @return The number of line breaks written to the buffer.
+ */
+DWORD
+LinesPerfGenerate(
+    __out PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD LineIndex;
+    DWORD LineLength;
+    DWORD CharIndex;
+
+    Index = 0;
+    LineIndex = 0;
+    while (TRUE) {
+        LineLength = (LineIndex * 37) % 120;
+        if (Index + LineLength + 2 > Length) {
+            break;
+        }
+
+        for (CharIndex = 0; CharIndex < LineLength; CharIndex++) {
+            Buffer[Index + CharIndex] = (UCHAR)('a' + (Index + CharIndex) % 26);
+        }
+        Index = Index + LineLength;
+
+        if (LineIndex % 2) {
+            Buffer[Index] = '\r';
+            Index++;
+        }
+        Buffer[Index] = '\n';
+        Index++;
+        LineIndex++;
+    }
+
+    for (; Index < Length; Index++) {
+        Buffer[Index] = 'x';
+    }
+
+    return LineIndex;
+}
+
+/**
+ Count the line breaks in a buffer of 8 bit characters by testing one
+ character at a time.  This is the approach the line reader used before it
+ could search for line breaks, and is used to compare against it.
+
+ @param Buffer Pointer to the buffer to scan.
+
+ @param Length The number of characters in the buffer.
+
+ @return The number of line breaks found.
+ */
+DWORD
+LinesPerfCountReference(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD LineCount;
+
+    LineCount = 0;
+    for (Index = 0; Index < Length; Index++) {
+        if (Buffer[Index] == '\r') {
+            LineCount++;
+            if (Index + 1 < Length && Buffer[Index + 1] == '\n') {
+                Index++;
+            }
+        } else if (Buffer[Index] == '\n') {
+            LineCount++;
+        }
+    }
+
+    return LineCount;
+}
+
+/**
+ Count the line breaks in a buffer of 8 bit characters using the library
+ search for line breaks.
+
+ @param Buffer Pointer to the buffer to scan.
+
+ @param Length The number of characters in the buffer.
+
+ @return The number of line breaks found.
+ */
+DWORD
+LinesPerfCountA(
+    __in PUCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD LineCount;
+
+    LineCount = 0;
+    Index = 0;
+    while (TRUE) {
+        Index = Index + YoriLibFindLineBreakA(&Buffer[Index], Length - Index);
+        if (Index >= Length) {
+            break;
+        }
+        LineCount++;
+        if (Buffer[Index] == '\r' && Index + 1 < Length && Buffer[Index + 1] == '\n') {
+            Index++;
+        }
+        Index++;
+    }
+
+    return LineCount;
+}
+
+/**
+ Count the line breaks in a buffer of UTF16 characters using the library
+ search for line breaks.
+
+ @param Buffer Pointer to the buffer to scan.
+
+ @param Length The number of characters in the buffer.
+
+ @return The number of line breaks found.
+ */
+DWORD
+LinesPerfCountW(
+    __in PWCHAR Buffer,
+    __in DWORD Length
+    )
+{
+    DWORD Index;
+    DWORD LineCount;
+
+    LineCount = 0;
+    Index = 0;
+    while (TRUE) {
+        Index = Index + YoriLibFindLineBreakW(&Buffer[Index], Length - Index);
+        if (Index >= Length) {
+            break;
+        }
+        LineCount++;
+        if (Buffer[Index] == '\r' && Index + 1 < Length && Buffer[Index + 1] == '\n') {
+            Index++;
+        }
+        Index++;
+    }
+
+    return LineCount;
+}
+
+/**
+ Measure the throughput of finding line breaks in generated text, using the
+ library search on 8 bit and UTF16 text and a one character at a time loop
+ on 8 bit text, and display the result for each.  The number of lines found
+ by each is compared against the number generated so that an error in the
+ search is reported rather than measured.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+LinesPerf(VOID)
+{
+    PUCHAR NarrowBuffer;
+    PWCHAR WideBuffer;
+    DWORD Index;
+    DWORD Iteration;
+    DWORD ExpectedLines;
+    DWORD ReferenceLines;
+    DWORD NarrowLines;
+    DWORD WideLines;
+    LARGE_INTEGER Frequency;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    LONGLONG ReferenceTicks;
+    LONGLONG NarrowTicks;
+    LONGLONG WideTicks;
+    BOOL Result;
+
+    NarrowBuffer = YoriLibMalloc(LINES_PERF_CHARS);
+    WideBuffer = YoriLibMalloc(LINES_PERF_CHARS * sizeof(WCHAR));
+    if (NarrowBuffer == NULL || WideBuffer == NULL) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("lines: out of memory\n"));
+        if (NarrowBuffer != NULL) {
+            YoriLibFree(NarrowBuffer);
+        }
+        if (WideBuffer != NULL) {
+            YoriLibFree(WideBuffer);
+        }
+        return FALSE;
+    }
+
+    ExpectedLines = LinesPerfGenerate(NarrowBuffer, LINES_PERF_CHARS);
+    for (Index = 0; Index < LINES_PERF_CHARS; Index++) {
+        WideBuffer[Index] = NarrowBuffer[Index];
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+
+    ReferenceLines = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (Iteration = 0; Iteration < LINES_PERF_ITERATIONS; Iteration++) {
+        ReferenceLines = LinesPerfCountReference(NarrowBuffer, LINES_PERF_CHARS);
+    }
+    QueryPerformanceCounter(&EndTime);
+    ReferenceTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    NarrowLines = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (Iteration = 0; Iteration < LINES_PERF_ITERATIONS; Iteration++) {
+        NarrowLines = LinesPerfCountA(NarrowBuffer, LINES_PERF_CHARS);
+    }
+    QueryPerformanceCounter(&EndTime);
+    NarrowTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    WideLines = 0;
+    QueryPerformanceCounter(&StartTime);
+    for (Iteration = 0; Iteration < LINES_PERF_ITERATIONS; Iteration++) {
+        WideLines = LinesPerfCountW(WideBuffer, LINES_PERF_CHARS);
+    }
+    QueryPerformanceCounter(&EndTime);
+    WideTicks = EndTime.QuadPart - StartTime.QuadPart;
+
+    Result = TRUE;
+    if (ReferenceLines != ExpectedLines ||
+        NarrowLines != ExpectedLines ||
+        WideLines != ExpectedLines) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("lines: expected %i lines, found %i one character at a time, %i in 8 bit text, %i in utf16 text\n"), ExpectedLines, ReferenceLines, NarrowLines, WideLines);
+        Result = FALSE;
+    }
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDOUT,
+                  _T("one character at a time %lli MB/s, 8 bit %lli MB/s, utf16 %lli MB/s\n"),
+                  LinesPerfThroughput((DWORDLONG)LINES_PERF_CHARS * LINES_PERF_ITERATIONS, ReferenceTicks, Frequency.QuadPart),
+                  LinesPerfThroughput((DWORDLONG)LINES_PERF_CHARS * LINES_PERF_ITERATIONS, NarrowTicks, Frequency.QuadPart),
+                  LinesPerfThroughput((DWORDLONG)LINES_PERF_CHARS * sizeof(WCHAR) * LINES_PERF_ITERATIONS, WideTicks, Frequency.QuadPart));
+
+    YoriLibFree(NarrowBuffer);
+    YoriLibFree(WideBuffer);
+
+    return Result;
+}
+
 
 #ifdef YORI_BUILTIN
 /**
@@ -333,6 +757,11 @@ ENTRYPOINT(
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("b")) == 0) {
                 BasicEnumeration = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
+                if (!LinesPerf()) {
+                    return EXIT_FAILURE;
+                }
+                return EXIT_SUCCESS;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("s")) == 0) {
                 LinesContext.Recursive = TRUE;
                 ArgumentUnderstood = TRUE;
@@ -366,6 +795,13 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    //
+    //  Output is generated a line at a time, so if it's going to a file or
+    //  pipe, buffer it to write in larger chunks.
+    //
+
+    YoriLibOutputEnableBuffering(GetStdHandle(STD_OUTPUT_HANDLE));
+
     //
     //  If no file name is specified, use stdin; otherwise open
     //  the file and use that
@@ -0,0 +1,1194 @@
+/**
+ * @file make/builddb.c
+ *
+ * Yori shell make persistent record of up to date builds
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "make.h"
+
+/**
+ The signature at the beginning of a build database, 'YMDB'.
+ */
+#define MAKE_BUILD_DB_SIGNATURE 0x42444d59
+
+/**
+ The version of the build database format.  Databases with a different
+ version are ignored.
+ */
+#define MAKE_BUILD_DB_VERSION 2
+
+/**
+ A flag in the build database header indicating that the build found nothing
+ to do, so the objects it describes can be checked to determine if a new
+ build has anything to do.
+ */
+#define MAKE_BUILD_DB_FLAG_UP_TO_DATE 0x00000001
+
+/**
+ The initial value of a hash, being the 64 bit FNV-1a offset basis.  This is
+ constructed from two halves to avoid depending on 64 bit literals.
+ */
+#define MAKE_BUILD_DB_HASH_SEED (((DWORDLONG)0xcbf29ce4 << 32) | 0x84222325)
+
+/**
+ The 64 bit FNV-1a prime.
+ */
+#define MAKE_BUILD_DB_HASH_PRIME (((DWORDLONG)0x100 << 32) | 0x000001b3)
+
+/**
+ The header of a build database file.  This is followed by a series of
+ MAKE_BUILD_DB_RECORD structures.
+ */
+typedef struct _MAKE_BUILD_DB_HEADER {
+
+    /**
+     Set to MAKE_BUILD_DB_SIGNATURE.
+     */
+    DWORD Signature;
+
+    /**
+     Set to MAKE_BUILD_DB_VERSION.
+     */
+    DWORD Version;
+
+    /**
+     The total size of the file in bytes, including this header.  Used to
+     detect a file that was not completely written.
+     */
+    DWORD TotalSize;
+
+    /**
+     The number of records following the header.
+     */
+    DWORD RecordCount;
+
+    /**
+     A hash of the command line, environment and makefile location that
+     produced this database.
+     */
+    DWORDLONG Key;
+
+    /**
+     A hash of the environment that produced this database.  Results of
+     preprocessor commands are only used if this matches.
+     */
+    DWORDLONG EnvironmentKey;
+
+    /**
+     A combination of MAKE_BUILD_DB_FLAG_ values.
+     */
+    DWORD Flags;
+
+    /**
+     Reserved to keep the first record aligned.
+     */
+    DWORD Reserved;
+} MAKE_BUILD_DB_HEADER, *PMAKE_BUILD_DB_HEADER;
+
+/**
+ A single record within a build database describing an object whose state
+ was used to determine that the build was up to date.
+ */
+typedef struct _MAKE_BUILD_DB_RECORD {
+
+    /**
+     The size of this record in bytes, including the name which follows it,
+     and rounded up to preserve alignment of the next record.
+     */
+    DWORD RecordSize;
+
+    /**
+     One of the MAKE_BUILD_DB_PATH_ flags indicating the type of the record.
+     */
+    DWORD Type;
+
+    /**
+     For a makefile, the hash of its contents.  For a directory, the
+     fingerprint of its contents.  For a command, its exit code.
+     */
+    DWORDLONG Hash;
+
+    /**
+     For a makefile or probed file, its last modified time.
+     */
+    LARGE_INTEGER ModifiedTime;
+
+    /**
+     For a makefile, its size in bytes.  For a probed file, one if the file
+     exists, zero if it does not.
+     */
+    LARGE_INTEGER FileSize;
+
+    /**
+     The number of characters in the name following this record.
+     */
+    DWORD NameLengthInChars;
+
+    /**
+     Reserved to keep the name aligned.
+     */
+    DWORD Reserved;
+} MAKE_BUILD_DB_RECORD, *PMAKE_BUILD_DB_RECORD;
+
+/**
+ Update a running hash with the contents of a buffer.
+
+ @param Hash The hash of any previous data, or zero to begin a new hash.
+
+ @param Buffer Pointer to the data to hash.
+
+ @param Length The number of bytes in the buffer.
+
+ @return The updated hash.
+ */
+DWORDLONG
+MakeBuildDbHashBuffer(
+    __in DWORDLONG Hash,
+    __in PVOID Buffer,
+    __in DWORD Length
+    )
+{
+    PUCHAR Bytes;
+    DWORD Index;
+
+    if (Hash == 0) {
+        Hash = MAKE_BUILD_DB_HASH_SEED;
+    }
+
+    Bytes = (PUCHAR)Buffer;
+    for (Index = 0; Index < Length; Index++) {
+        Hash = (Hash ^ Bytes[Index]) * MAKE_BUILD_DB_HASH_PRIME;
+    }
+
+    return Hash;
+}
+
+/**
+ Generate a hash describing a single object found within a directory.  A
+ directory fingerprint is the sum of these, so that it does not depend on
+ the order in which objects are returned.
+
+ @param FindData Pointer to the information returned from enumerate.
+
+ @return The hash of the object.
+ */
+DWORDLONG
+MakeBuildDbHashFindData(
+    __in PWIN32_FIND_DATA FindData
+    )
+{
+    DWORDLONG Hash;
+    DWORD IsDirectory;
+
+    Hash = MakeBuildDbHashBuffer(0, FindData->cFileName, (DWORD)_tcslen(FindData->cFileName) * sizeof(TCHAR));
+    Hash = MakeBuildDbHashBuffer(Hash, &FindData->ftLastWriteTime, sizeof(FindData->ftLastWriteTime));
+    Hash = MakeBuildDbHashBuffer(Hash, &FindData->nFileSizeLow, sizeof(FindData->nFileSizeLow));
+    Hash = MakeBuildDbHashBuffer(Hash, &FindData->nFileSizeHigh, sizeof(FindData->nFileSizeHigh));
+    IsDirectory = FindData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+    Hash = MakeBuildDbHashBuffer(Hash, &IsDirectory, sizeof(IsDirectory));
+    return Hash;
+}
+
+/**
+ Return the number of bytes needed to store a record within the build
+ database, including its name, rounded up to preserve the alignment of the
+ next record.
+
+ @param Name Pointer to the name of the object.
+
+ @return The size of the record in bytes.
+ */
+DWORD
+MakeBuildDbRecordSize(
+    __in PCYORI_STRING Name
+    )
+{
+    DWORD RecordSize;
+
+    RecordSize = sizeof(MAKE_BUILD_DB_RECORD) + (Name->LengthInChars + 1) * sizeof(TCHAR);
+    RecordSize = (RecordSize + 7) & ~(7);
+    return RecordSize;
+}
+
+/**
+ Allocate the structures used to record the objects that a build depends on.
+
+ @param MakeContext Pointer to the context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeBuildDbInitialize(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    YoriLibInitializeListHead(&MakeContext->BuildDbPathList);
+    YoriLibInitEmptyString(&MakeContext->BuildDbFileName);
+    MakeContext->BuildDbPaths = YoriLibAllocateHashTable(1000);
+    if (MakeContext->BuildDbPaths == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Find or create the entry describing an object that the build depends on.
+
+ @param MakeContext Pointer to the context.
+
+ @param Path Pointer to the fully qualified path to the object.
+
+ @return Pointer to the entry, or NULL on allocation failure.
+ */
+PMAKE_BUILD_DB_PATH
+MakeBuildDbLookupOrCreatePath(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Path
+    )
+{
+    PMAKE_BUILD_DB_PATH Entry;
+    PYORI_HASH_ENTRY HashEntry;
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->BuildDbPaths, Path);
+    if (HashEntry != NULL) {
+        return HashEntry->Context;
+    }
+
+    Entry = YoriLibReferencedMalloc(sizeof(MAKE_BUILD_DB_PATH) + (Path->LengthInChars + 1) * sizeof(TCHAR));
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    Entry->Flags = 0;
+    YoriLibInitEmptyString(&Entry->Path);
+    Entry->Path.StartOfString = (LPTSTR)(Entry + 1);
+    Entry->Path.LengthInChars = Path->LengthInChars;
+    Entry->Path.LengthAllocated = Path->LengthInChars + 1;
+    memcpy(Entry->Path.StartOfString, Path->StartOfString, Path->LengthInChars * sizeof(TCHAR));
+    Entry->Path.StartOfString[Path->LengthInChars] = '\0';
+
+    YoriLibHashInsertByKey(MakeContext->BuildDbPaths, &Entry->Path, Entry, &Entry->HashEntry);
+    YoriLibAppendList(&MakeContext->BuildDbPathList, &Entry->ListEntry);
+    return Entry;
+}
+
+/**
+ Record that the result of this build depends on the state of an object.
+ If the state of the object has changed on a later run, the build database
+ will not be used.
+
+ @param MakeContext Pointer to the context.
+
+ @param Path Pointer to the fully qualified path to the object.
+
+ @param Flag One of the MAKE_BUILD_DB_PATH_ flags indicating how the object
+        was used.
+ */
+VOID
+MakeBuildDbRecordPath(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Path,
+    __in DWORD Flag
+    )
+{
+    PMAKE_BUILD_DB_PATH Entry;
+
+    if (!MakeContext->BuildDbRecording) {
+        return;
+    }
+
+    Entry = MakeBuildDbLookupOrCreatePath(MakeContext, Path);
+    if (Entry == NULL) {
+        MakeContext->BuildDbRecordingFailed = TRUE;
+        return;
+    }
+
+    Entry->Flags = Entry->Flags | Flag;
+}
+
+/**
+ Determine the size, last modified time, and hash of the contents of a
+ makefile.
+
+ @param FileName Pointer to a NULL terminated fully qualified path to the
+        file.
+
+ @param FileSize On successful completion, updated to contain the size of
+        the file.
+
+ @param ModifiedTime On successful completion, updated to contain the last
+        modified time of the file.
+
+ @param Hash On successful completion, updated to contain the hash of the
+        file contents.  If NULL, the contents are not read.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbQueryInput(
+    __in PYORI_STRING FileName,
+    __out PLARGE_INTEGER FileSize,
+    __out PLARGE_INTEGER ModifiedTime,
+    __out_opt PDWORDLONG Hash
+    )
+{
+    HANDLE hFile;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    UCHAR Buffer[4096];
+    DWORD BytesRead;
+    DWORDLONG LocalHash;
+
+    hFile = CreateFile(FileName->StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (!GetFileInformationByHandle(hFile, &FileInfo)) {
+        CloseHandle(hFile);
+        return FALSE;
+    }
+
+    FileSize->LowPart = FileInfo.nFileSizeLow;
+    FileSize->HighPart = FileInfo.nFileSizeHigh;
+    ModifiedTime->LowPart = FileInfo.ftLastWriteTime.dwLowDateTime;
+    ModifiedTime->HighPart = FileInfo.ftLastWriteTime.dwHighDateTime;
+
+    if (Hash != NULL) {
+        LocalHash = 0;
+        while (ReadFile(hFile, Buffer, sizeof(Buffer), &BytesRead, NULL) && BytesRead > 0) {
+            LocalHash = MakeBuildDbHashBuffer(LocalHash, Buffer, BytesRead);
+        }
+        *Hash = LocalHash;
+    }
+
+    CloseHandle(hFile);
+    return TRUE;
+}
+
+/**
+ Check whether a single record in a build database still describes the
+ current state of the system.
+
+ @param MakeContext Pointer to the context.
+
+ @param Record Pointer to the record.
+
+ @param Name Pointer to the name of the object described by the record.
+        This must be NULL terminated.
+
+ @return TRUE if the object is unchanged, FALSE if it has changed.
+ */
+BOOLEAN
+MakeBuildDbIsRecordCurrent(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_BUILD_DB_RECORD Record,
+    __in PYORI_STRING Name
+    )
+{
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER ModifiedTime;
+    DWORDLONG Hash;
+    BOOLEAN Exists;
+
+    if (Record->Type == MAKE_BUILD_DB_PATH_INPUT) {
+        if (!MakeBuildDbQueryInput(Name, &FileSize, &ModifiedTime, NULL)) {
+            return FALSE;
+        }
+
+        if (FileSize.QuadPart != Record->FileSize.QuadPart) {
+            return FALSE;
+        }
+
+        //
+        //  If the file has been written but has the same contents, it
+        //  will be parsed the same way.
+        //
+
+        if (ModifiedTime.QuadPart != Record->ModifiedTime.QuadPart) {
+            if (!MakeBuildDbQueryInput(Name, &FileSize, &ModifiedTime, &Hash)) {
+                return FALSE;
+            }
+            if (Hash != Record->Hash) {
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+
+    } else if (Record->Type == MAKE_BUILD_DB_PATH_DIRECTORY ||
+               Record->Type == MAKE_BUILD_DB_PATH_TOOL_DIRECTORY) {
+        if (!MakeStatCacheGetDirectoryFingerprint(MakeContext, Name, &Hash)) {
+            if (Record->Type != MAKE_BUILD_DB_PATH_TOOL_DIRECTORY) {
+                return FALSE;
+            }
+            Hash = 0;
+        }
+
+        if (Hash != Record->Hash) {
+            return FALSE;
+        }
+
+        return TRUE;
+
+    } else if (Record->Type == MAKE_BUILD_DB_PATH_PROBE) {
+        ModifiedTime.QuadPart = 0;
+        Exists = MakeStatCacheQueryFile(MakeContext, Name, &ModifiedTime);
+        if (Exists != (BOOLEAN)(Record->FileSize.QuadPart != 0)) {
+            return FALSE;
+        }
+
+        if (Exists && ModifiedTime.QuadPart != Record->ModifiedTime.QuadPart) {
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Calculate the key identifying the set of conditions that the build depends
+ on which are not recorded as individual objects.  This includes the command
+ line, the environment, the current directory and the makefile.
+
+ @param MakeContext Pointer to the context.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @param MakefileName Pointer to the fully qualified path to the makefile.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeBuildDbCalculateKey(
+    __in PMAKE_CONTEXT MakeContext,
+    __in DWORD ArgC,
+    __in YORI_STRING ArgV[],
+    __in PYORI_STRING MakefileName
+    )
+{
+    YORI_STRING EnvStrings;
+    YORI_STRING TempPath;
+    DWORDLONG Hash;
+    DWORD Version;
+    DWORD Index;
+    DWORD NameHash;
+
+    Version = (MAKE_VER_MAJOR << 16) | MAKE_VER_MINOR;
+    Hash = MakeBuildDbHashBuffer(0, &Version, sizeof(Version));
+
+    if (!YoriLibGetEnvironmentStrings(&EnvStrings)) {
+        return FALSE;
+    }
+
+    MakeContext->BuildDbEnvironmentKey = MakeBuildDbHashBuffer(Hash, EnvStrings.StartOfString, EnvStrings.LengthAllocated * sizeof(TCHAR));
+    YoriLibFreeStringContents(&EnvStrings);
+
+    Hash = MakeBuildDbHashBuffer(Hash, MakeContext->RootScope->HashEntry.Key.StartOfString, MakeContext->RootScope->HashEntry.Key.LengthInChars * sizeof(TCHAR));
+    Hash = MakeBuildDbHashBuffer(Hash, MakefileName->StartOfString, MakefileName->LengthInChars * sizeof(TCHAR));
+
+    //
+    //  The name of the database depends only on the location, so that
+    //  building with a different environment or command line replaces the
+    //  previous database rather than creating a new one.
+    //
+
+    NameHash = (DWORD)(Hash ^ (Hash >> 32));
+
+    for (Index = 1; Index < ArgC; Index++) {
+        Hash = MakeBuildDbHashBuffer(Hash, &ArgV[Index].LengthInChars, sizeof(ArgV[Index].LengthInChars));
+        Hash = MakeBuildDbHashBuffer(Hash, ArgV[Index].StartOfString, ArgV[Index].LengthInChars * sizeof(TCHAR));
+    }
+
+    Hash = MakeBuildDbHashBuffer(Hash, &MakeContext->BuildDbEnvironmentKey, sizeof(MakeContext->BuildDbEnvironmentKey));
+    MakeContext->BuildDbKey = Hash;
+
+    if (!YoriLibAllocateString(&TempPath, MAX_PATH)) {
+        return FALSE;
+    }
+
+    TempPath.LengthInChars = GetTempPath(TempPath.LengthAllocated, TempPath.StartOfString);
+    if (TempPath.LengthInChars == 0 || TempPath.LengthInChars >= TempPath.LengthAllocated) {
+        YoriLibFreeStringContents(&TempPath);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&MakeContext->BuildDbFileName);
+    YoriLibYPrintf(&MakeContext->BuildDbFileName, _T("%y%s%08x.ymd"), &TempPath, (TempPath.StartOfString[TempPath.LengthInChars - 1] == '\\')?_T(""):_T("\\"), NameHash);
+    YoriLibFreeStringContents(&TempPath);
+
+    if (MakeContext->BuildDbFileName.StartOfString == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Locate the next record within a mapped build database and validate that it
+ is contained within the database.
+
+ @param Buffer Pointer to the mapped database.
+
+ @param BufferSize The number of bytes in the database.
+
+ @param Offset On input, the offset of the record to return.  On successful
+        completion, updated to the offset of the following record.
+
+ @param Record On successful completion, updated to point to the record.
+
+ @param Name On successful completion, updated to describe the name within
+        the record.
+
+ @return TRUE to indicate a valid record was found, FALSE if the database
+         is corrupt.
+ */
+__success(return)
+BOOLEAN
+MakeBuildDbGetNextRecord(
+    __in PUCHAR Buffer,
+    __in DWORD BufferSize,
+    __inout PDWORD Offset,
+    __out PMAKE_BUILD_DB_RECORD *Record,
+    __out PYORI_STRING Name
+    )
+{
+    PMAKE_BUILD_DB_RECORD LocalRecord;
+
+    if (*Offset + sizeof(MAKE_BUILD_DB_RECORD) > BufferSize) {
+        return FALSE;
+    }
+
+    LocalRecord = (PMAKE_BUILD_DB_RECORD)(Buffer + *Offset);
+    if (LocalRecord->NameLengthInChars >= BufferSize ||
+        LocalRecord->RecordSize < sizeof(MAKE_BUILD_DB_RECORD) + (LocalRecord->NameLengthInChars + 1) * sizeof(TCHAR) ||
+        LocalRecord->RecordSize > BufferSize - *Offset) {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(Name);
+    Name->StartOfString = (LPTSTR)(LocalRecord + 1);
+    Name->LengthInChars = LocalRecord->NameLengthInChars;
+    Name->LengthAllocated = LocalRecord->NameLengthInChars + 1;
+    if (Name->StartOfString[Name->LengthInChars] != '\0') {
+        return FALSE;
+    }
+
+    *Record = LocalRecord;
+    *Offset = *Offset + LocalRecord->RecordSize;
+    return TRUE;
+}
+
+/**
+ Load the results of preprocessor commands from a mapped build database.
+ These are only used if the environment is unchanged, and no directory that
+ may contain a program used by the commands has changed.
+
+ @param MakeContext Pointer to the context.
+
+ @param Buffer Pointer to the mapped database.
+
+ @param BufferSize The number of bytes in the database.
+ */
+VOID
+MakeBuildDbLoadCommands(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PUCHAR Buffer,
+    __in DWORD BufferSize
+    )
+{
+    PMAKE_BUILD_DB_HEADER Header;
+    PMAKE_BUILD_DB_RECORD Record;
+    YORI_STRING Name;
+    DWORD Offset;
+    DWORD Index;
+
+    Header = (PMAKE_BUILD_DB_HEADER)Buffer;
+    if (Header->EnvironmentKey != MakeContext->BuildDbEnvironmentKey) {
+        return;
+    }
+
+    Offset = sizeof(MAKE_BUILD_DB_HEADER);
+    for (Index = 0; Index < Header->RecordCount; Index++) {
+        if (!MakeBuildDbGetNextRecord(Buffer, BufferSize, &Offset, &Record, &Name)) {
+            return;
+        }
+
+        if (Record->Type == MAKE_BUILD_DB_PATH_TOOL_DIRECTORY &&
+            !MakeBuildDbIsRecordCurrent(MakeContext, Record, &Name)) {
+
+            return;
+        }
+    }
+
+    Offset = sizeof(MAKE_BUILD_DB_HEADER);
+    for (Index = 0; Index < Header->RecordCount; Index++) {
+        if (!MakeBuildDbGetNextRecord(Buffer, BufferSize, &Offset, &Record, &Name)) {
+            return;
+        }
+
+        if (Record->Type == MAKE_BUILD_DB_PATH_COMMAND) {
+            MakeCmdCacheAddResult(MakeContext, &Name, (DWORD)Record->Hash);
+        }
+    }
+}
+
+/**
+ Check whether a mapped build database is valid and every object that it
+ describes is unchanged.  A build that executed preprocessor commands is
+ never considered current, since the result of a command can depend on
+ anything and can only be known by executing it again.
+
+ @param MakeContext Pointer to the context.
+
+ @param Buffer Pointer to the mapped database.
+
+ @param BufferSize The number of bytes in the database.
+
+ @return TRUE if the database indicates that the build is up to date, FALSE
+         if it does not.
+ */
+BOOLEAN
+MakeBuildDbIsDatabaseCurrent(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PUCHAR Buffer,
+    __in DWORD BufferSize
+    )
+{
+    PMAKE_BUILD_DB_HEADER Header;
+    PMAKE_BUILD_DB_RECORD Record;
+    YORI_STRING Name;
+    DWORD Offset;
+    DWORD Index;
+
+    Header = (PMAKE_BUILD_DB_HEADER)Buffer;
+    if (Header->Key != MakeContext->BuildDbKey ||
+        (Header->Flags & MAKE_BUILD_DB_FLAG_UP_TO_DATE) == 0) {
+
+        return FALSE;
+    }
+
+    Offset = sizeof(MAKE_BUILD_DB_HEADER);
+    for (Index = 0; Index < Header->RecordCount; Index++) {
+        if (!MakeBuildDbGetNextRecord(Buffer, BufferSize, &Offset, &Record, &Name)) {
+            return FALSE;
+        }
+
+        if (Record->Type == MAKE_BUILD_DB_PATH_COMMAND) {
+            return FALSE;
+        }
+
+        if (!MakeBuildDbIsRecordCurrent(MakeContext, Record, &Name)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Begin recording objects that the build uses, so if the build determines
+ there is nothing to do, a new database can be written.  Directories that
+ have already been enumerated, such as when locating the makefile, are
+ recorded now.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeBuildDbStartRecording(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_STAT_CACHE_DIRECTORY Directory;
+
+    MakeContext->BuildDbRecording = TRUE;
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->StatCacheDirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_STAT_CACHE_DIRECTORY, ListEntry);
+        MakeBuildDbRecordPath(MakeContext, &Directory->DirectoryName, MAKE_BUILD_DB_PATH_DIRECTORY);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->StatCacheDirectoryList, ListEntry);
+    }
+}
+
+/**
+ Load the build database from a previous invocation, and check whether
+ every object that it depends on is unchanged.  If so, the previous build
+ determined that there was nothing to do, and this build will determine the
+ same thing, so the caller can skip parsing makefiles entirely.  If not,
+ and the user requested it, results of preprocessor commands from the
+ previous build are loaded if they are still applicable.  After this call, the objects used by this build are
+ recorded so that a new database can be written.
+
+ @param MakeContext Pointer to the context.
+
+ @param ArgC The number of arguments.
+
+ @param ArgV An array of arguments.
+
+ @param MakefileName Pointer to the fully qualified path to the makefile.
+
+ @return TRUE to indicate that the build is up to date, FALSE if it needs
+         to be evaluated.
+ */
+BOOLEAN
+MakeBuildDbOpen(
+    __in PMAKE_CONTEXT MakeContext,
+    __in DWORD ArgC,
+    __in YORI_STRING ArgV[],
+    __in PYORI_STRING MakefileName
+    )
+{
+    HANDLE hFile;
+    HANDLE hMap;
+    PUCHAR Buffer;
+    PMAKE_BUILD_DB_HEADER Header;
+    DWORD FileSizeHigh;
+    DWORD FileSize;
+    BOOLEAN Current;
+
+    if (!MakeBuildDbCalculateKey(MakeContext, ArgC, ArgV, MakefileName)) {
+        return FALSE;
+    }
+
+    Current = FALSE;
+    hFile = CreateFile(MakeContext->BuildDbFileName.StartOfString, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        MakeBuildDbStartRecording(MakeContext);
+        return FALSE;
+    }
+
+    FileSize = GetFileSize(hFile, &FileSizeHigh);
+    if (FileSize == (DWORD)-1 || FileSizeHigh != 0 || FileSize < sizeof(MAKE_BUILD_DB_HEADER)) {
+        CloseHandle(hFile);
+        MakeBuildDbStartRecording(MakeContext);
+        return FALSE;
+    }
+
+    hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMap != NULL) {
+        Buffer = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+        if (Buffer != NULL) {
+            Header = (PMAKE_BUILD_DB_HEADER)Buffer;
+            if (Header->Signature == MAKE_BUILD_DB_SIGNATURE &&
+                Header->Version == MAKE_BUILD_DB_VERSION &&
+                Header->TotalSize == FileSize) {
+
+                Current = MakeBuildDbIsDatabaseCurrent(MakeContext, Buffer, FileSize);
+                if (!Current && MakeContext->ReuseCommandResults) {
+                    MakeBuildDbLoadCommands(MakeContext, Buffer, FileSize);
+                }
+            }
+            UnmapViewOfFile(Buffer);
+        }
+        CloseHandle(hMap);
+    }
+
+    CloseHandle(hFile);
+    MakeContext->BuildDbUpToDate = Current;
+    MakeBuildDbStartRecording(MakeContext);
+    return Current;
+}
+
+/**
+ Populate a single record describing the current state of an object that
+ the build depends on.
+
+ @param MakeContext Pointer to the context.
+
+ @param Type The MAKE_BUILD_DB_PATH_ flag describing the record to create.
+
+ @param Name Pointer to the name of the object.  This must be NULL
+        terminated.
+
+ @param ExitCode For a command, the exit code of the command.
+
+ @param Record On successful completion, populated with the record,
+        followed by the name.
+
+ @return TRUE to indicate success, FALSE if the state of the object could
+         not be determined.
+ */
+BOOLEAN
+MakeBuildDbPopulateRecord(
+    __in PMAKE_CONTEXT MakeContext,
+    __in DWORD Type,
+    __in PYORI_STRING Name,
+    __in DWORD ExitCode,
+    __out PMAKE_BUILD_DB_RECORD Record
+    )
+{
+    BOOLEAN Result;
+
+    ZeroMemory(Record, sizeof(MAKE_BUILD_DB_RECORD));
+    Record->Type = Type;
+    Record->NameLengthInChars = Name->LengthInChars;
+    Record->RecordSize = MakeBuildDbRecordSize(Name);
+
+    Result = FALSE;
+    if (Type == MAKE_BUILD_DB_PATH_INPUT) {
+        Result = MakeBuildDbQueryInput(Name, &Record->FileSize, &Record->ModifiedTime, &Record->Hash);
+    } else if (Type == MAKE_BUILD_DB_PATH_DIRECTORY) {
+        Result = MakeStatCacheGetDirectoryFingerprint(MakeContext, Name, &Record->Hash);
+    } else if (Type == MAKE_BUILD_DB_PATH_TOOL_DIRECTORY) {
+
+        //
+        //  The path commonly refers to directories that don't exist.  If
+        //  one is created later, the fingerprint will no longer be zero.
+        //
+
+        if (!MakeStatCacheGetDirectoryFingerprint(MakeContext, Name, &Record->Hash)) {
+            Record->Hash = 0;
+        }
+        Result = TRUE;
+    } else if (Type == MAKE_BUILD_DB_PATH_PROBE) {
+        if (MakeStatCacheQueryFile(MakeContext, Name, &Record->ModifiedTime)) {
+            Record->FileSize.QuadPart = 1;
+        } else {
+            Record->ModifiedTime.QuadPart = 0;
+        }
+        Result = TRUE;
+    } else if (Type == MAKE_BUILD_DB_PATH_COMMAND) {
+        Record->Hash = ExitCode;
+        Result = TRUE;
+    }
+
+    if (Result) {
+        memcpy(Record + 1, Name->StartOfString, (Name->LengthInChars + 1) * sizeof(TCHAR));
+    }
+
+    return Result;
+}
+
+/**
+ Record the directories which may contain programs used by preprocessor
+ commands, being the current directory and each directory in the path.  If
+ any of these change, the results of the commands may change.
+
+ @param MakeContext Pointer to the context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeBuildDbRecordToolDirectories(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PMAKE_BUILD_DB_PATH Entry;
+    YORI_STRING PathVariable;
+    YORI_STRING Component;
+    YORI_STRING FullPath;
+    YORI_STRING DirectoryName;
+    LPTSTR Separator;
+    BOOLEAN Result;
+
+    YoriLibInitEmptyString(&DirectoryName);
+    YoriLibYPrintf(&DirectoryName, _T("%y\\"), &MakeContext->RootScope->HashEntry.Key);
+    if (DirectoryName.StartOfString == NULL) {
+        return FALSE;
+    }
+
+    Entry = MakeBuildDbLookupOrCreatePath(MakeContext, &DirectoryName);
+    YoriLibFreeStringContents(&DirectoryName);
+    if (Entry == NULL) {
+        return FALSE;
+    }
+    Entry->Flags = Entry->Flags | MAKE_BUILD_DB_PATH_TOOL_DIRECTORY;
+
+    YoriLibInitEmptyString(&PathVariable);
+    if (!YoriLibAllocateAndGetEnvironmentVariable(_T("PATH"), &PathVariable)) {
+        return TRUE;
+    }
+
+    Result = TRUE;
+    YoriLibInitEmptyString(&Component);
+    Component.StartOfString = PathVariable.StartOfString;
+    Component.LengthInChars = PathVariable.LengthInChars;
+
+    while (Component.LengthInChars > 0) {
+        Separator = YoriLibFindLeftMostCharacter(&Component, ';');
+        YoriLibInitEmptyString(&DirectoryName);
+        DirectoryName.StartOfString = Component.StartOfString;
+        if (Separator != NULL) {
+            DirectoryName.LengthInChars = (DWORD)(Separator - Component.StartOfString);
+            Component.StartOfString = Separator + 1;
+            Component.LengthInChars = Component.LengthInChars - DirectoryName.LengthInChars - 1;
+        } else {
+            DirectoryName.LengthInChars = Component.LengthInChars;
+            Component.LengthInChars = 0;
+        }
+
+        if (DirectoryName.LengthInChars == 0) {
+            continue;
+        }
+
+        YoriLibInitEmptyString(&FullPath);
+        if (!YoriLibGetFullPathNameReturnAllocation(&DirectoryName, FALSE, &FullPath, NULL)) {
+            continue;
+        }
+
+        YoriLibInitEmptyString(&DirectoryName);
+        if (FullPath.LengthInChars > 0 && FullPath.StartOfString[FullPath.LengthInChars - 1] == '\\') {
+            YoriLibYPrintf(&DirectoryName, _T("%y"), &FullPath);
+        } else {
+            YoriLibYPrintf(&DirectoryName, _T("%y\\"), &FullPath);
+        }
+        YoriLibFreeStringContents(&FullPath);
+
+        if (DirectoryName.StartOfString == NULL) {
+            Result = FALSE;
+            break;
+        }
+
+        Entry = MakeBuildDbLookupOrCreatePath(MakeContext, &DirectoryName);
+        YoriLibFreeStringContents(&DirectoryName);
+        if (Entry == NULL) {
+            Result = FALSE;
+            break;
+        }
+        Entry->Flags = Entry->Flags | MAKE_BUILD_DB_PATH_TOOL_DIRECTORY;
+    }
+
+    YoriLibFreeStringContents(&PathVariable);
+    return Result;
+}
+
+/**
+ Write a new build database describing every object that this build
+ depended on.  This is only meaningful if the build found that there was
+ nothing to do and executed no preprocessor commands, since otherwise the
+ state of objects has been changed by the build itself, or depends on
+ commands that must be executed again.  If the user requested that
+ preprocessor command results be reused, they are written in either case,
+ along with the state of the directories that could contain the programs
+ they invoke.
+
+ @param MakeContext Pointer to the context.
+
+ @param UpToDate TRUE if the build found nothing to do, so a subsequent
+        build with the same inputs can skip evaluation.
+ */
+VOID
+MakeBuildDbSave(
+    __in PMAKE_CONTEXT MakeContext,
+    __in BOOLEAN UpToDate
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_BUILD_DB_PATH Entry;
+    PMAKE_CMD_CACHE_ENTRY Cmd;
+    PMAKE_BUILD_DB_HEADER Header;
+    PMAKE_BUILD_DB_RECORD Record;
+    PUCHAR Buffer;
+    DWORD BufferSize;
+    DWORD Offset;
+    DWORD Type;
+    DWORD BytesWritten;
+    DWORD CommandCount;
+    HANDLE hFile;
+    BOOLEAN Success;
+
+    if (!MakeContext->BuildDbRecording) {
+        return;
+    }
+
+    //
+    //  Determining the state of objects below must not record new objects
+    //  while the list is being written.
+    //
+
+    MakeContext->BuildDbRecording = FALSE;
+
+    if (MakeContext->BuildDbRecordingFailed) {
+        UpToDate = FALSE;
+    }
+
+    CommandCount = 0;
+    BufferSize = sizeof(MAKE_BUILD_DB_HEADER);
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheList, NULL);
+    while (ListEntry != NULL) {
+        Cmd = CONTAINING_RECORD(ListEntry, MAKE_CMD_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheList, ListEntry);
+        if (Cmd->State == MakeCmdCacheComplete && Cmd->Requested) {
+            CommandCount++;
+            BufferSize = BufferSize + MakeBuildDbRecordSize(&Cmd->Cmd);
+        }
+    }
+
+    //
+    //  If the build executed any preprocessor commands, a later build can't
+    //  know that it would reach the same result without executing them
+    //  again, so it can't skip evaluation.
+    //
+
+    if (CommandCount > 0) {
+        UpToDate = FALSE;
+    }
+
+    if (!MakeContext->ReuseCommandResults) {
+        CommandCount = 0;
+    }
+
+    if (!UpToDate && CommandCount == 0) {
+        DeleteFile(MakeContext->BuildDbFileName.StartOfString);
+        return;
+    }
+
+    if (CommandCount > 0 && !MakeBuildDbRecordToolDirectories(MakeContext)) {
+        DeleteFile(MakeContext->BuildDbFileName.StartOfString);
+        return;
+    }
+
+    //
+    //  Calculate the size of the database, assuming each object may need
+    //  every type of record.
+    //
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbPathList, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_BUILD_DB_PATH, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbPathList, ListEntry);
+        BufferSize = BufferSize + 4 * MakeBuildDbRecordSize(&Entry->Path);
+    }
+
+    Buffer = YoriLibMalloc(BufferSize);
+    if (Buffer == NULL) {
+        return;
+    }
+
+    Header = (PMAKE_BUILD_DB_HEADER)Buffer;
+    ZeroMemory(Header, sizeof(MAKE_BUILD_DB_HEADER));
+    Header->Signature = MAKE_BUILD_DB_SIGNATURE;
+    Header->Version = MAKE_BUILD_DB_VERSION;
+    Header->Key = MakeContext->BuildDbKey;
+    Header->EnvironmentKey = MakeContext->BuildDbEnvironmentKey;
+    if (UpToDate) {
+        Header->Flags = MAKE_BUILD_DB_FLAG_UP_TO_DATE;
+    }
+
+    //
+    //  If the build did something, only the records needed to validate
+    //  command results are meaningful.
+    //
+
+    Success = TRUE;
+    Offset = sizeof(MAKE_BUILD_DB_HEADER);
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbPathList, NULL);
+    while (ListEntry != NULL && Success) {
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_BUILD_DB_PATH, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbPathList, ListEntry);
+
+        for (Type = MAKE_BUILD_DB_PATH_INPUT; Type <= MAKE_BUILD_DB_PATH_TOOL_DIRECTORY; Type = Type << 1) {
+            if ((Entry->Flags & Type) == 0) {
+                continue;
+            }
+
+            if (!UpToDate && Type != MAKE_BUILD_DB_PATH_TOOL_DIRECTORY) {
+                continue;
+            }
+
+            Record = (PMAKE_BUILD_DB_RECORD)(Buffer + Offset);
+            if (!MakeBuildDbPopulateRecord(MakeContext, Type, &Entry->Path, 0, Record)) {
+                Success = FALSE;
+                break;
+            }
+
+            Offset = Offset + Record->RecordSize;
+            Header->RecordCount++;
+        }
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheList, NULL);
+    while (ListEntry != NULL && Success) {
+        Cmd = CONTAINING_RECORD(ListEntry, MAKE_CMD_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheList, ListEntry);
+        if (Cmd->State != MakeCmdCacheComplete || !Cmd->Requested || !MakeContext->ReuseCommandResults) {
+            continue;
+        }
+
+        Record = (PMAKE_BUILD_DB_RECORD)(Buffer + Offset);
+        MakeBuildDbPopulateRecord(MakeContext, MAKE_BUILD_DB_PATH_COMMAND, &Cmd->Cmd, Cmd->ExitCode, Record);
+        Offset = Offset + Record->RecordSize;
+        Header->RecordCount++;
+    }
+
+    Header->TotalSize = Offset;
+
+    if (Success) {
+        hFile = CreateFile(MakeContext->BuildDbFileName.StartOfString, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile != INVALID_HANDLE_VALUE) {
+            if (!WriteFile(hFile, Buffer, Offset, &BytesWritten, NULL) || BytesWritten != Offset) {
+                Success = FALSE;
+            }
+            CloseHandle(hFile);
+            if (!Success) {
+                DeleteFile(MakeContext->BuildDbFileName.StartOfString);
+            }
+        }
+    } else {
+        DeleteFile(MakeContext->BuildDbFileName.StartOfString);
+    }
+
+    YoriLibFree(Buffer);
+}
+
+/**
+ Free all state associated with the build database.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeBuildDbCleanup(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_BUILD_DB_PATH Entry;
+
+    if (MakeContext->BuildDbPaths != NULL) {
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbPathList, NULL);
+        while (ListEntry != NULL) {
+            Entry = CONTAINING_RECORD(ListEntry, MAKE_BUILD_DB_PATH, ListEntry);
+            ListEntry = YoriLibGetNextListEntry(&MakeContext->BuildDbPathList, ListEntry);
+            YoriLibRemoveListItem(&Entry->ListEntry);
+            YoriLibHashRemoveByEntry(&Entry->HashEntry);
+            YoriLibDereference(Entry);
+        }
+
+        YoriLibFreeEmptyHashTable(MakeContext->BuildDbPaths);
+        MakeContext->BuildDbPaths = NULL;
+    }
+
+    YoriLibFreeStringContents(&MakeContext->BuildDbFileName);
+}
+
+// vim:sw=4:ts=4:et:
@@ -0,0 +1,426 @@
+/**
+ * @file make/cmdcache.c
+ *
+ * Yori shell make cache of preprocessor command results
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "make.h"
+
+/**
+ The exit code used for a command that cannot execute.  Because DOS.
+ */
+#define MAKE_CMD_CACHE_LAUNCH_FAILURE 255
+
+/**
+ Allocate the hash table used to find previously executed preprocessor
+ commands.
+
+ @param MakeContext Pointer to the context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeCmdCacheInitialize(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    YoriLibInitializeListHead(&MakeContext->CmdCacheList);
+    YoriLibInitializeListHead(&MakeContext->CmdCacheQueue);
+    MakeContext->CmdCache = YoriLibAllocateHashTable(250);
+    if (MakeContext->CmdCache == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Find or create the cache entry for a preprocessor command.  Because hash
+ table lookups are case insensitive, and commands are not, if a command is
+ found which differs only by case, the command is not cached.
+
+ @param MakeContext Pointer to the context.
+
+ @param Cmd Pointer to the command line.
+
+ @return Pointer to the cache entry, or NULL if the command cannot be
+         cached.
+ */
+PMAKE_CMD_CACHE_ENTRY
+MakeCmdCacheLookupOrCreate(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd
+    )
+{
+    PMAKE_CMD_CACHE_ENTRY Entry;
+    PYORI_HASH_ENTRY HashEntry;
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->CmdCache, Cmd);
+    if (HashEntry != NULL) {
+        Entry = HashEntry->Context;
+        if (YoriLibCompareString(&Entry->Cmd, Cmd) != 0) {
+            return NULL;
+        }
+        return Entry;
+    }
+
+    Entry = YoriLibReferencedMalloc(sizeof(MAKE_CMD_CACHE_ENTRY) + (Cmd->LengthInChars + 1) * sizeof(TCHAR));
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    Entry->State = MakeCmdCacheNotStarted;
+    Entry->hProcess = NULL;
+    Entry->ExitCode = MAKE_CMD_CACHE_LAUNCH_FAILURE;
+    Entry->Requested = FALSE;
+    YoriLibInitializeListHead(&Entry->QueueEntry);
+    YoriLibInitEmptyString(&Entry->Cmd);
+    Entry->Cmd.StartOfString = (LPTSTR)(Entry + 1);
+    Entry->Cmd.LengthInChars = Cmd->LengthInChars;
+    Entry->Cmd.LengthAllocated = Cmd->LengthInChars + 1;
+    memcpy(Entry->Cmd.StartOfString, Cmd->StartOfString, Cmd->LengthInChars * sizeof(TCHAR));
+    Entry->Cmd.StartOfString[Cmd->LengthInChars] = '\0';
+
+    YoriLibHashInsertByKey(MakeContext->CmdCache, &Entry->Cmd, Entry, &Entry->HashEntry);
+    YoriLibAppendList(&MakeContext->CmdCacheList, &Entry->ListEntry);
+    return Entry;
+}
+
+/**
+ Launch a child process to execute a preprocessor command.  If the process
+ cannot be launched, the entry is marked complete with a failure exit code.
+
+ @param MakeContext Pointer to the context.
+
+ @param Cmd Pointer to the command to execute.
+
+ @param ProcessHandle On successful completion, updated to contain a handle
+        to the child process.
+
+ @return TRUE to indicate a process was launched, FALSE if it was not.
+ */
+__success(return)
+BOOLEAN
+MakeCmdCacheCreateProcess(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd,
+    __out PHANDLE ProcessHandle
+    )
+{
+    YORI_STRING EntireCmd;
+    STARTUPINFO si;
+    PROCESS_INFORMATION pi;
+
+    YoriLibInitEmptyString(&EntireCmd);
+    YoriLibYPrintf(&EntireCmd, _T("cmd /c %y"), Cmd);
+    if (EntireCmd.StartOfString == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+
+#if MAKE_DEBUG_PREPROCESSOR
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Executing preprocessor command: %y\n"), &EntireCmd);
+#endif
+
+    if (!CreateProcess(NULL, EntireCmd.StartOfString, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
+        YoriLibFreeStringContents(&EntireCmd);
+        return FALSE;
+    }
+
+    YoriLibFreeStringContents(&EntireCmd);
+    CloseHandle(pi.hThread);
+    *ProcessHandle = pi.hProcess;
+    MakeContext->CmdCacheLaunched++;
+    return TRUE;
+}
+
+/**
+ Start executing a cached command that has not yet been started.
+
+ @param MakeContext Pointer to the context.
+
+ @param Entry Pointer to the command to start.
+ */
+VOID
+MakeCmdCacheStart(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_CMD_CACHE_ENTRY Entry
+    )
+{
+    ASSERT(Entry->State == MakeCmdCacheNotStarted);
+
+    if (!YoriLibIsListEmpty(&Entry->QueueEntry)) {
+        YoriLibRemoveListItem(&Entry->QueueEntry);
+        YoriLibInitializeListHead(&Entry->QueueEntry);
+    }
+
+    if (MakeCmdCacheCreateProcess(MakeContext, &Entry->Cmd, &Entry->hProcess)) {
+        Entry->State = MakeCmdCacheRunning;
+        MakeContext->CmdCacheRunning++;
+    } else {
+        Entry->State = MakeCmdCacheComplete;
+        Entry->ExitCode = MAKE_CMD_CACHE_LAUNCH_FAILURE;
+    }
+}
+
+/**
+ Wait for a running command to complete and record its exit code.
+
+ @param MakeContext Pointer to the context.
+
+ @param Entry Pointer to the command to wait for.
+ */
+VOID
+MakeCmdCacheWait(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PMAKE_CMD_CACHE_ENTRY Entry
+    )
+{
+    ASSERT(Entry->State == MakeCmdCacheRunning);
+
+    WaitForSingleObject(Entry->hProcess, INFINITE);
+    if (!GetExitCodeProcess(Entry->hProcess, &Entry->ExitCode)) {
+        Entry->ExitCode = MAKE_CMD_CACHE_LAUNCH_FAILURE;
+    }
+    CloseHandle(Entry->hProcess);
+    Entry->hProcess = NULL;
+    Entry->State = MakeCmdCacheComplete;
+    MakeContext->CmdCacheRunning--;
+}
+
+/**
+ Launch commands that have been found ahead of the current point in a
+ makefile, up to the number of concurrent processes allowed.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeCmdCacheStartQueued(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_CMD_CACHE_ENTRY Entry;
+
+    while (MakeContext->CmdCacheRunning < MakeContext->NumberProcesses) {
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheQueue, NULL);
+        if (ListEntry == NULL) {
+            break;
+        }
+
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_CMD_CACHE_ENTRY, QueueEntry);
+        MakeCmdCacheStart(MakeContext, Entry);
+    }
+}
+
+/**
+ Indicate that a command is likely to be needed by the preprocessor soon.
+ If speculation has been requested, the command is executed in the
+ background if the number of concurrent processes allows it, and its result
+ is used if the preprocessor later requests exactly the same command.  A
+ command that is never reached still executes, so this is only performed
+ when the user has opted in.
+
+ @param MakeContext Pointer to the context.
+
+ @param Cmd Pointer to the command line.
+ */
+VOID
+MakeCmdCacheSpeculate(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd
+    )
+{
+    PMAKE_CMD_CACHE_ENTRY Entry;
+
+    if (!MakeContext->SpeculateCommands || MakeContext->NumberProcesses <= 1) {
+        return;
+    }
+
+    Entry = MakeCmdCacheLookupOrCreate(MakeContext, Cmd);
+    if (Entry == NULL) {
+        return;
+    }
+
+    if (Entry->State == MakeCmdCacheNotStarted && YoriLibIsListEmpty(&Entry->QueueEntry)) {
+        YoriLibAppendList(&MakeContext->CmdCacheQueue, &Entry->QueueEntry);
+    }
+
+    MakeCmdCacheStartQueued(MakeContext);
+}
+
+/**
+ Record the result of a command from a previous invocation.
+
+ @param MakeContext Pointer to the context.
+
+ @param Cmd Pointer to the command line.
+
+ @param ExitCode The exit code of the command.
+ */
+VOID
+MakeCmdCacheAddResult(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd,
+    __in DWORD ExitCode
+    )
+{
+    PMAKE_CMD_CACHE_ENTRY Entry;
+
+    Entry = MakeCmdCacheLookupOrCreate(MakeContext, Cmd);
+    if (Entry == NULL || Entry->State != MakeCmdCacheNotStarted) {
+        return;
+    }
+
+    Entry->State = MakeCmdCacheComplete;
+    Entry->ExitCode = ExitCode;
+    Entry->Requested = TRUE;
+}
+
+/**
+ Execute a preprocessor command and return its exit code.  If the same
+ command has been executed before, including by a different scope or, if
+ the user requested it, a previous invocation, the previous result is
+ returned.  If the command was
+ started speculatively, this waits for it to complete.
+
+ @param MakeContext Pointer to the context.
+
+ @param Cmd Pointer to the command to execute.
+
+ @return The exit code from the process, or 255 being the DOS exit code for
+         a command that cannot execute.
+ */
+DWORD
+MakeCmdCacheGetExitCode(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd
+    )
+{
+    PMAKE_CMD_CACHE_ENTRY Entry;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    HANDLE ProcessHandle;
+    DWORD ExitCode;
+
+    QueryPerformanceCounter(&StartTime);
+    Entry = MakeCmdCacheLookupOrCreate(MakeContext, Cmd);
+
+    //
+    //  If the command can't be cached, execute it directly.  The build
+    //  database has no record of it, so it can't describe this build.
+    //
+
+    if (Entry == NULL) {
+        MakeContext->BuildDbRecordingFailed = TRUE;
+        ExitCode = MAKE_CMD_CACHE_LAUNCH_FAILURE;
+        if (MakeCmdCacheCreateProcess(MakeContext, Cmd, &ProcessHandle)) {
+            WaitForSingleObject(ProcessHandle, INFINITE);
+            if (!GetExitCodeProcess(ProcessHandle, &ExitCode)) {
+                ExitCode = MAKE_CMD_CACHE_LAUNCH_FAILURE;
+            }
+            CloseHandle(ProcessHandle);
+        }
+    } else {
+        Entry->Requested = TRUE;
+        if (Entry->State == MakeCmdCacheComplete) {
+            MakeContext->CmdCacheHits++;
+        } else {
+            if (Entry->State == MakeCmdCacheNotStarted) {
+                MakeCmdCacheStart(MakeContext, Entry);
+            }
+
+            if (Entry->State == MakeCmdCacheRunning) {
+                MakeCmdCacheWait(MakeContext, Entry);
+            }
+        }
+        ExitCode = Entry->ExitCode;
+    }
+
+    QueryPerformanceCounter(&EndTime);
+    MakeContext->TimeInPreprocessorCreateProcess = MakeContext->TimeInPreprocessorCreateProcess + EndTime.QuadPart - StartTime.QuadPart;
+#if MAKE_DEBUG_PREPROCESSOR
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("...took %lli\n"), EndTime.QuadPart - StartTime.QuadPart);
+#endif
+
+    //
+    //  Commands may have created or modified files, so discard any cached
+    //  knowledge of the file system.
+    //
+
+    if (MakeContext->CmdCacheLaunched != MakeContext->CmdCacheLaunchedAtLastInvalidate) {
+        MakeContext->CmdCacheLaunchedAtLastInvalidate = MakeContext->CmdCacheLaunched;
+        MakeStatCacheInvalidate(MakeContext);
+    }
+
+    //
+    //  Now that a process has completed, start more speculative commands.
+    //
+
+    MakeCmdCacheStartQueued(MakeContext);
+
+    return ExitCode;
+}
+
+/**
+ Wait for any commands that are still executing and free all state
+ associated with the cache.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeCmdCacheCleanup(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_CMD_CACHE_ENTRY Entry;
+
+    if (MakeContext->CmdCache == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheList, NULL);
+    while (ListEntry != NULL) {
+        Entry = CONTAINING_RECORD(ListEntry, MAKE_CMD_CACHE_ENTRY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->CmdCacheList, ListEntry);
+        if (Entry->State == MakeCmdCacheRunning) {
+            MakeCmdCacheWait(MakeContext, Entry);
+        }
+        if (!YoriLibIsListEmpty(&Entry->QueueEntry)) {
+            YoriLibRemoveListItem(&Entry->QueueEntry);
+        }
+        YoriLibRemoveListItem(&Entry->ListEntry);
+        YoriLibHashRemoveByEntry(&Entry->HashEntry);
+        YoriLibDereference(Entry);
+    }
+
+    YoriLibFreeEmptyHashTable(MakeContext->CmdCache);
+    MakeContext->CmdCache = NULL;
+}
+
+// vim:sw=4:ts=4:et:
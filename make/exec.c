@@ -48,6 +48,25 @@ typedef struct _MAKE_CHILD_PROCESS {
      the process, providing something to wait on.
      */
     PROCESS_INFORMATION ProcessInfo;
+
+    /**
+     A completion port to notify when the child process terminates.  If
+     NULL, the caller waits on process handles directly, which limits the
+     number of concurrent children to MAXIMUM_WAIT_OBJECTS.
+     */
+    HANDLE CompletionPort;
+
+    /**
+     A handle to a registered wait on the child process, used to post to
+     CompletionPort when the process terminates.
+     */
+    HANDLE WaitHandle;
+
+    /**
+     TRUE if this structure describes a target currently being built.
+     FALSE if this structure is available for a new target.
+     */
+    BOOLEAN Active;
 } MAKE_CHILD_PROCESS, *PMAKE_CHILD_PROCESS;
 
 /**
@@ -223,6 +242,63 @@ MakeProcessIf(
     return TRUE;
 }
 
+/**
+ A callback invoked from the thread pool when a child process terminates.
+ This posts the child to the completion port so the main thread can
+ process it.
+
+ @param Context Pointer to the child process structure.
+
+ @param TimedOut Ignored, since the wait is infinite.
+ */
+VOID WINAPI
+MakeChildProcessTerminated(
+    __in PVOID Context,
+    __in BOOLEAN TimedOut
+    )
+{
+    PMAKE_CHILD_PROCESS ChildProcess;
+
+    UNREFERENCED_PARAMETER(TimedOut);
+
+    ChildProcess = (PMAKE_CHILD_PROCESS)Context;
+    DllKernel32.pPostQueuedCompletionStatus(ChildProcess->CompletionPort, 0, (DWORD_PTR)ChildProcess, NULL);
+}
+
+/**
+ Arrange for the completion port to be notified when the current command
+ of a child process completes.  If the command has already completed,
+ because it was a builtin or failed to launch in a way that is tolerable,
+ the port is notified immediately.  If the system can't monitor the
+ process asynchronously, this waits for it to complete.
+
+ @param ChildProcess Pointer to the child process structure.
+ */
+VOID
+MakeNotifyOnChildCompletion(
+    __in PMAKE_CHILD_PROCESS ChildProcess
+    )
+{
+    ASSERT(ChildProcess->CompletionPort != NULL);
+
+    ChildProcess->WaitHandle = NULL;
+    if (ChildProcess->ProcessInfo.hProcess != NULL) {
+        if (DllKernel32.pRegisterWaitForSingleObject(&ChildProcess->WaitHandle,
+                                                     ChildProcess->ProcessInfo.hProcess,
+                                                     MakeChildProcessTerminated,
+                                                     ChildProcess,
+                                                     INFINITE,
+                                                     WT_EXECUTEONLYONCE)) {
+            return;
+        }
+
+        ChildProcess->WaitHandle = NULL;
+        WaitForSingleObject(ChildProcess->ProcessInfo.hProcess, INFINITE);
+    }
+
+    DllKernel32.pPostQueuedCompletionStatus(ChildProcess->CompletionPort, 0, (DWORD_PTR)ChildProcess, NULL);
+}
+
 /**
  Start executing the next command within a target.
 
@@ -270,6 +346,7 @@ MakeLaunchNextCmd(
 
     ASSERT(ListEntry != NULL);
     ChildProcess->Cmd = CONTAINING_RECORD(ListEntry, MAKE_CMD_TO_EXEC, ListEntry);
+    Target->ScopeContext->MakeContext->CommandsLaunched++;
 
     ZeroMemory(&si, sizeof(si));
     si.cb = sizeof(si);
@@ -339,6 +416,9 @@ MakeLaunchNextCmd(
 
         if (ExecutedBuiltin) {
             YoriLibFreeStringContents(&CmdToParse);
+            if (ChildProcess->CompletionPort != NULL) {
+                MakeNotifyOnChildCompletion(ChildProcess);
+            }
             return TRUE;
         }
 
@@ -350,6 +430,9 @@ MakeLaunchNextCmd(
             YoriLibFreeStringContents(&CmdToParse);
             ChildProcess->ProcessInfo.hProcess = NULL;
             ChildProcess->ProcessInfo.hThread = NULL;
+            if (ChildProcess->CompletionPort != NULL) {
+                MakeNotifyOnChildCompletion(ChildProcess);
+            }
             return TRUE;
         }
     }
@@ -414,12 +497,105 @@ MakeLaunchNextCmd(
     YoriLibFreeStringContents(&ExecString);
     YoriLibFreeStringContents(&CmdToParse);
 
+    if (ChildProcess->CompletionPort != NULL) {
+        MakeNotifyOnChildCompletion(ChildProcess);
+    }
+
     return TRUE;
 
 }
 
 /**
- Launch the recipe for the next ready target.
+ Calculate the length of the longest chain of commands that must execute
+ after and including the specified target before the build is complete.
+ Targets that are ready to execute with the longest chain are launched
+ first, so that the build is not left waiting on a long serial chain after
+ all other work has completed.
+
+ @param Target Pointer to the target to calculate the critical path for.
+
+ @return The number of commands along the longest chain starting from this
+         target.
+ */
+DWORD
+MakeCalculateCriticalPath(
+    __in PMAKE_TARGET Target
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET_DEPENDENCY Dependency;
+    DWORD LongestChild;
+    DWORD ChildLength;
+    DWORD CommandCount;
+
+    if (Target->CriticalPathEvaluated) {
+        return Target->CriticalPathLength;
+    }
+
+    //
+    //  Mark the target as evaluated before looking at children so that a
+    //  cycle in the graph can't recurse forever.
+    //
+
+    Target->CriticalPathEvaluated = TRUE;
+    Target->CriticalPathLength = 0;
+
+    LongestChild = 0;
+    ListEntry = YoriLibGetNextListEntry(&Target->ChildDependents, NULL);
+    while (ListEntry != NULL) {
+        Dependency = CONTAINING_RECORD(ListEntry, MAKE_TARGET_DEPENDENCY, ParentDependents);
+        if (Dependency->Child->RebuildRequired) {
+            ChildLength = MakeCalculateCriticalPath(Dependency->Child);
+            if (ChildLength > LongestChild) {
+                LongestChild = ChildLength;
+            }
+        }
+        ListEntry = YoriLibGetNextListEntry(&Target->ChildDependents, ListEntry);
+    }
+
+    CommandCount = 0;
+    ListEntry = YoriLibGetNextListEntry(&Target->ExecCmds, NULL);
+    while (ListEntry != NULL) {
+        CommandCount++;
+        ListEntry = YoriLibGetNextListEntry(&Target->ExecCmds, ListEntry);
+    }
+
+    Target->CriticalPathLength = LongestChild + CommandCount;
+    return Target->CriticalPathLength;
+}
+
+/**
+ Calculate the critical path for every target that needs to be rebuilt.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeCalculateCriticalPaths(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_TARGET Target;
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        MakeCalculateCriticalPath(Target);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, ListEntry);
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsWaiting, NULL);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        MakeCalculateCriticalPath(Target);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsWaiting, ListEntry);
+    }
+}
+
+/**
+ Launch the recipe for the next ready target.  The target chosen is the one
+ with the longest critical path, with ties resolved in favor of the target
+ that became ready first.
 
  @param MakeContext Pointer to the context.
 
@@ -436,8 +612,10 @@ MakeLaunchNextTarget(
     )
 {
     PMAKE_TARGET Target;
+    PMAKE_TARGET BestTarget;
     PYORI_LIST_ENTRY ListEntry;
 
+    BestTarget = NULL;
     ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
 
     //
@@ -449,9 +627,19 @@ MakeLaunchNextTarget(
         return FALSE;
     }
 
-    YoriLibRemoveListItem(ListEntry);
-    YoriLibAppendList(&MakeContext->TargetsRunning, ListEntry);
-    Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+    while (ListEntry != NULL) {
+        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+        if (BestTarget == NULL ||
+            Target->CriticalPathLength > BestTarget->CriticalPathLength) {
+
+            BestTarget = Target;
+        }
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, ListEntry);
+    }
+
+    Target = BestTarget;
+    YoriLibRemoveListItem(&Target->RebuildList);
+    YoriLibAppendList(&MakeContext->TargetsRunning, &Target->RebuildList);
 
     ChildProcess->Target = Target;
     ChildProcess->Cmd = NULL;
@@ -511,11 +699,17 @@ MakeProcessCompletion(
 {
     DWORD ExitCode;
 
+    if (ChildProcess->WaitHandle != NULL) {
+        DllKernel32.pUnregisterWaitEx(ChildProcess->WaitHandle, INVALID_HANDLE_VALUE);
+        ChildProcess->WaitHandle = NULL;
+    }
+
     ExitCode = EXIT_SUCCESS;
     if (ChildProcess->ProcessInfo.hProcess != NULL) {
         ExitCode = 255;
         GetExitCodeProcess(ChildProcess->ProcessInfo.hProcess, &ExitCode);
         CloseHandle(ChildProcess->ProcessInfo.hProcess);
+        ChildProcess->ProcessInfo.hProcess = NULL;
     }
 
     if (!ChildProcess->Cmd->IgnoreErrors && ExitCode != 0) {
@@ -528,19 +722,17 @@ MakeProcessCompletion(
 
 
 /**
- Remove all targets that are in the front of the ready queue but really have
- no actions to perform.
+ Remove all targets in the ready queue that really have no actions to
+ perform.  Completing these can cause other targets to become ready, which
+ are also checked.
 
  MSFIX This process should probably occur earlier, when a target moves from
- waiting it can move directly to completed if there is nothing to do.  This
- allows targets that depend on it to immediately become ready rather than
- waiting for that target to reach the front of the queue before realizing
- that there are other actions that can be performed.
+ waiting it can move directly to completed if there is nothing to do.
 
  @param MakeContext Pointer to the context.
 
  @return TRUE to indicate one or more targets were processed, FALSE to
-         indicate that the next target has an action to perform.
+         indicate that every ready target has an action to perform.
  */
 BOOLEAN
 MakeCompleteReadyWithNoRecipe(
@@ -548,25 +740,139 @@ MakeCompleteReadyWithNoRecipe(
     )
 {
     PYORI_LIST_ENTRY ListEntry;
+    PYORI_LIST_ENTRY NextEntry;
     PMAKE_TARGET Target;
     BOOLEAN RemovedItem;
+    BOOLEAN RemovedItemThisPass;
 
     RemovedItem = FALSE;
-    ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
-    while (ListEntry != NULL) {
-        Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
-        if (YoriLibIsListEmpty(&Target->ExecCmds)) {
-            RemovedItem = TRUE;
-            MakeUpdateDependenciesForTarget(MakeContext, Target);
-        } else {
-            break;
-        }
+    do {
+        RemovedItemThisPass = FALSE;
         ListEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, NULL);
-    }
+        while (ListEntry != NULL) {
+            NextEntry = YoriLibGetNextListEntry(&MakeContext->TargetsReady, ListEntry);
+            Target = CONTAINING_RECORD(ListEntry, MAKE_TARGET, RebuildList);
+            if (YoriLibIsListEmpty(&Target->ExecCmds)) {
+                RemovedItem = TRUE;
+                RemovedItemThisPass = TRUE;
+                MakeUpdateDependenciesForTarget(MakeContext, Target);
+            }
+            ListEntry = NextEntry;
+        }
+    } while (RemovedItemThisPass);
 
     return RemovedItem;
 }
 
+/**
+ Find a slot in the child process array that is not currently in use.
+
+ @param ChildProcessArray Pointer to the array of child processes.
+
+ @param NumberProcesses The number of elements in the array.
+
+ @return Pointer to an unused child process, or NULL if all are in use.
+ */
+PMAKE_CHILD_PROCESS
+MakeFindInactiveChild(
+    __in PMAKE_CHILD_PROCESS ChildProcessArray,
+    __in DWORD NumberProcesses
+    )
+{
+    DWORD Index;
+
+    for (Index = 0; Index < NumberProcesses; Index++) {
+        if (!ChildProcessArray[Index].Active) {
+            return &ChildProcessArray[Index];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ Wait for any active child process to complete its current command.
+
+ @param ChildProcessArray Pointer to the array of child processes.
+
+ @param NumberProcesses The number of elements in the array.
+
+ @param CompletionPort If non-NULL, a completion port which is notified
+        when each child completes.  If NULL, or if the port cannot be waited
+        on, process handles are waited on directly.  If there are more
+        children than can be waited on at once, only the first
+        MAXIMUM_WAIT_OBJECTS are waited on.
+
+ @param ProcessHandleArray Pointer to an array of handles, with one element
+        per child process, that is used to wait for processes when a
+        completion port is not in use.
+
+ @param ChildIndexArray Pointer to an array with one element per child
+        process that is used to map a handle back to a child process when a
+        completion port is not in use.
+
+ @return Pointer to the child process that has completed.
+ */
+PMAKE_CHILD_PROCESS
+MakeWaitForChildCompletion(
+    __in PMAKE_CHILD_PROCESS ChildProcessArray,
+    __in DWORD NumberProcesses,
+    __in_opt HANDLE CompletionPort,
+    __in HANDLE *ProcessHandleArray,
+    __in PDWORD ChildIndexArray
+    )
+{
+    DWORD Index;
+    DWORD HandleCount;
+    DWORD BytesTransferred;
+    DWORD_PTR CompletionKey;
+    LPOVERLAPPED Overlapped;
+
+    if (CompletionPort != NULL) {
+        CompletionKey = 0;
+        Overlapped = NULL;
+        DllKernel32.pGetQueuedCompletionStatus(CompletionPort, &BytesTransferred, &CompletionKey, &Overlapped, INFINITE);
+        if (CompletionKey != 0) {
+            return (PMAKE_CHILD_PROCESS)CompletionKey;
+        }
+
+        //
+        //  Every completion is posted with a child process as its key, and
+        //  the wait has no timeout, so returning without a key means the
+        //  port can't be waited on.  Rather than retry, wait on the process
+        //  handles directly.
+        //
+    }
+
+    //
+    //  A process handle can be NULL if either a command failed to
+    //  launch but was prefixed with - indicating failures should be
+    //  ignored; or if it's a builtin command that completed
+    //  synchronously.  In either case rather than wait, just process
+    //  as if this command completed and move to the next command or
+    //  target.
+    //
+
+    HandleCount = 0;
+    for (Index = 0; Index < NumberProcesses && HandleCount < MAXIMUM_WAIT_OBJECTS; Index++) {
+        if (ChildProcessArray[Index].Active) {
+            if (ChildProcessArray[Index].ProcessInfo.hProcess == NULL) {
+                return &ChildProcessArray[Index];
+            }
+            ProcessHandleArray[HandleCount] = ChildProcessArray[Index].ProcessInfo.hProcess;
+            ChildIndexArray[HandleCount] = Index;
+            HandleCount++;
+        }
+    }
+
+    ASSERT(HandleCount > 0 && HandleCount <= MAXIMUM_WAIT_OBJECTS);
+
+    Index = WaitForMultipleObjects(HandleCount, ProcessHandleArray, FALSE, INFINITE);
+    ASSERT(Index >= WAIT_OBJECT_0 && Index < (WAIT_OBJECT_0 + HandleCount));
+    Index = Index - WAIT_OBJECT_0;
+    return &ChildProcessArray[ChildIndexArray[Index]];
+}
+
 /**
  Execute commands required to build the requested target.
 
@@ -583,36 +889,74 @@ MakeExecuteRequiredTargets(
     DWORD NumberActiveProcesses;
     DWORD Index;
     HANDLE *ProcessHandleArray;
+    PDWORD ChildIndexArray;
+    HANDLE CompletionPort;
     PMAKE_CHILD_PROCESS ChildProcessArray;
+    PMAKE_CHILD_PROCESS ChildProcess;
     BOOLEAN Result;
     BOOLEAN MoveToNextTarget;
 
     NumberActiveProcesses = 0;
 
-    ProcessHandleArray = YoriLibMalloc(MakeContext->NumberProcesses * sizeof(HANDLE));
+    //
+    //  If the system supports it, use a completion port to find out when
+    //  children terminate, which has no limit on the number of children.
+    //  Otherwise, fall back to waiting on the handles directly.
+    //
+
+    CompletionPort = NULL;
+    if (DllKernel32.pCreateIoCompletionPort != NULL &&
+        DllKernel32.pGetQueuedCompletionStatus != NULL &&
+        DllKernel32.pPostQueuedCompletionStatus != NULL &&
+        DllKernel32.pRegisterWaitForSingleObject != NULL &&
+        DllKernel32.pUnregisterWaitEx != NULL) {
+
+        CompletionPort = DllKernel32.pCreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    }
+
+    if (CompletionPort == NULL && MakeContext->NumberProcesses > MAXIMUM_WAIT_OBJECTS) {
+        MakeContext->NumberProcesses = MAXIMUM_WAIT_OBJECTS;
+    }
+
+    ProcessHandleArray = YoriLibMalloc(MakeContext->NumberProcesses * (sizeof(HANDLE) + sizeof(DWORD)));
     if (ProcessHandleArray == NULL) {
+        if (CompletionPort != NULL) {
+            CloseHandle(CompletionPort);
+        }
         return FALSE;
     }
 
-    ZeroMemory(ProcessHandleArray, MakeContext->NumberProcesses * sizeof(HANDLE));
+    ZeroMemory(ProcessHandleArray, MakeContext->NumberProcesses * (sizeof(HANDLE) + sizeof(DWORD)));
+    ChildIndexArray = (PDWORD)(ProcessHandleArray + MakeContext->NumberProcesses);
 
     ChildProcessArray = YoriLibMalloc(MakeContext->NumberProcesses * sizeof(MAKE_CHILD_PROCESS));
     if (ChildProcessArray == NULL) {
         YoriLibFree(ProcessHandleArray);
+        if (CompletionPort != NULL) {
+            CloseHandle(CompletionPort);
+        }
         return FALSE;
     }
 
     ZeroMemory(ChildProcessArray, MakeContext->NumberProcesses * sizeof(MAKE_CHILD_PROCESS));
+    for (Index = 0; Index < MakeContext->NumberProcesses; Index++) {
+        ChildProcessArray[Index].CompletionPort = CompletionPort;
+    }
     Result = TRUE;
 
+    MakeCalculateCriticalPaths(MakeContext);
+
     while (TRUE) {
 
         while (NumberActiveProcesses < MakeContext->NumberProcesses && !YoriLibIsListEmpty(&MakeContext->TargetsReady)) {
             if (!MakeCompleteReadyWithNoRecipe(MakeContext)) {
-                if (!MakeLaunchNextTarget(MakeContext, &ChildProcessArray[NumberActiveProcesses])) {
+                ChildProcess = MakeFindInactiveChild(ChildProcessArray, MakeContext->NumberProcesses);
+                ASSERT(ChildProcess != NULL);
+                if (!MakeLaunchNextTarget(MakeContext, ChildProcess)) {
                     Result = FALSE;
                     goto Drain;
                 }
+                ChildProcess->Active = TRUE;
                 NumberActiveProcesses++;
             }
         }
@@ -623,26 +967,7 @@ MakeExecuteRequiredTargets(
                 break;
             }
 
-            //
-            //  A process handle can be NULL if either a command failed to
-            //  launch but was prefixed with - indicating failures should be
-            //  ignored; or if it's a builtin command that completed
-            //  synchronously.  In either case rather than wait, just process
-            //  as if this command completed and move to the next command or
-            //  target.
-            //
-
-            for (Index = 0; Index < NumberActiveProcesses; Index++) {
-                ProcessHandleArray[Index] = ChildProcessArray[Index].ProcessInfo.hProcess;
-                if (ProcessHandleArray[Index] == NULL) {
-                    break;
-                }
-            }
-
-            if (Index == NumberActiveProcesses) {
-                Index = WaitForMultipleObjects(NumberActiveProcesses, ProcessHandleArray, FALSE, INFINITE);
-                Index = Index - WAIT_OBJECT_0;
-            }
+            ChildProcess = MakeWaitForChildCompletion(ChildProcessArray, MakeContext->NumberProcesses, CompletionPort, ProcessHandleArray, ChildIndexArray);
 
             //
             //  Check if the process succeeded.  If so, and there are more
@@ -650,10 +975,10 @@ MakeExecuteRequiredTargets(
             //
 
             MoveToNextTarget = TRUE;
-            Result = MakeProcessCompletion(&ChildProcessArray[Index]);
+            Result = MakeProcessCompletion(ChildProcess);
             if (Result) {
-                if (MakeDoesTargetHaveMoreCommands(&ChildProcessArray[Index])) {
-                    if (MakeLaunchNextCmd(&ChildProcessArray[Index])) {
+                if (MakeDoesTargetHaveMoreCommands(ChildProcess)) {
+                    if (MakeLaunchNextCmd(ChildProcess)) {
                         MoveToNextTarget = FALSE;
                     } else {
                         Result = FALSE;
@@ -662,23 +987,16 @@ MakeExecuteRequiredTargets(
             }
 
             //
-            //  If we are moving to the next target, overwrite this child
-            //  process with the executing ones, and launch a new target.
-            //  If we failed, we still need to move up all of the executing
-            //  ones to facilitate drain.
+            //  If we are moving to the next target, release this child
+            //  process so it can be used to launch a new target.
             //
 
             if (MoveToNextTarget) {
                 if (Result) {
-                    MakeUpdateDependenciesForTarget(MakeContext, ChildProcessArray[Index].Target);
-                }
-
-                if (NumberActiveProcesses > Index + 1) {
-                    memmove(&ChildProcessArray[Index],
-                            &ChildProcessArray[Index + 1],
-                            (NumberActiveProcesses - Index - 1) * sizeof(MAKE_CHILD_PROCESS));
+                    MakeUpdateDependenciesForTarget(MakeContext, ChildProcess->Target);
                 }
 
+                ChildProcess->Active = FALSE;
                 NumberActiveProcesses--;
             }
 
@@ -702,33 +1020,28 @@ MakeExecuteRequiredTargets(
 Drain:
 
     while (NumberActiveProcesses > 0) {
-        for (Index = 0; Index < NumberActiveProcesses; Index++) {
-            if (ChildProcessArray[Index].ProcessInfo.hProcess == NULL) {
-                break;
-            }
-            ProcessHandleArray[Index] = ChildProcessArray[Index].ProcessInfo.hProcess;
-        }
-
-        if (Index == NumberActiveProcesses) {
-            Index = WaitForMultipleObjects(NumberActiveProcesses, ProcessHandleArray, FALSE, INFINITE);
-            Index = Index - WAIT_OBJECT_0;
+        ChildProcess = MakeWaitForChildCompletion(ChildProcessArray, MakeContext->NumberProcesses, CompletionPort, ProcessHandleArray, ChildIndexArray);
 
-            CloseHandle(ChildProcessArray[Index].ProcessInfo.hProcess);
-            ChildProcessArray[Index].ProcessInfo.hProcess = NULL;
+        if (ChildProcess->WaitHandle != NULL) {
+            DllKernel32.pUnregisterWaitEx(ChildProcess->WaitHandle, INVALID_HANDLE_VALUE);
+            ChildProcess->WaitHandle = NULL;
         }
 
-        if (NumberActiveProcesses > Index + 1) {
-            memmove(&ChildProcessArray[Index],
-                    &ChildProcessArray[Index + 1],
-                    (NumberActiveProcesses - Index - 1) * sizeof(MAKE_CHILD_PROCESS));
+        if (ChildProcess->ProcessInfo.hProcess != NULL) {
+            CloseHandle(ChildProcess->ProcessInfo.hProcess);
+            ChildProcess->ProcessInfo.hProcess = NULL;
         }
 
+        ChildProcess->Active = FALSE;
         NumberActiveProcesses--;
     }
 
     YoriLibFree(ChildProcessArray);
     YoriLibFree(ProcessHandleArray);
 
+    if (CompletionPort != NULL) {
+        CloseHandle(CompletionPort);
+    }
 
     return Result;
 }
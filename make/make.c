@@ -36,11 +36,19 @@ CHAR strMakeHelpText[] =
         "\n"
         "Execute makefiles.\n"
         "\n"
-        "YMAKE [-license] [-f file] [-j n] [var=value] [target]\n"
+        "YMAKE [-license] [-f file] [-j n] [-nodb] [-perf] [-reusecmds] [-speculate] [-stats] [var=value] [target]\n"
         "\n"
         "   --             Treat all further arguments as display parameters\n"
         "   -f             Name of the makefile to use, default YMkFile or Makefile\n"
-        "   -j             The number of child processes, default number of processors+1\n";
+        "   -j             The number of child processes, default number of processors+1\n"
+        "   -nodb          Evaluate all makefiles even if nothing has changed since the\n"
+        "                    last build found nothing to do\n"
+        "   -perf          Display time spent in each phase of execution\n"
+        "   -reusecmds     Use the results of commands in preprocessor conditions from\n"
+        "                    the previous build if the environment and path are unchanged\n"
+        "   -speculate     Execute commands in preprocessor conditions in the\n"
+        "                    background before the conditions are reached\n"
+        "   -stats         Display file system probes issued and cache hits\n";
 
 
 /**
@@ -175,6 +183,21 @@ ENTRYPOINT(
         goto Cleanup;
     }
 
+    if (!MakeStatCacheInitialize(&MakeContext)) {
+        Result = EXIT_FAILURE;
+        goto Cleanup;
+    }
+
+    if (!MakeBuildDbInitialize(&MakeContext)) {
+        Result = EXIT_FAILURE;
+        goto Cleanup;
+    }
+
+    if (!MakeCmdCacheInitialize(&MakeContext)) {
+        Result = EXIT_FAILURE;
+        goto Cleanup;
+    }
+
     for (i = 0; i < sizeof(MakeDefaultMacros)/sizeof(MakeDefaultMacros[0]); i++) {
         MakeSetVariable(MakeContext.RootScope, &MakeDefaultMacros[i].Variable, &MakeDefaultMacros[i].Value, TRUE, MakeVariablePrecedencePredefined);
     }
@@ -215,9 +238,21 @@ ENTRYPOINT(
                         ArgumentUnderstood = TRUE;
                     }
                 }
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("nodb")) == 0) {
+                MakeContext.BuildDbDisabled = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("perf")) == 0) {
                 MakeContext.PerfDisplay = TRUE;
                 ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("reusecmds")) == 0) {
+                MakeContext.ReuseCommandResults = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("speculate")) == 0) {
+                MakeContext.SpeculateCommands = TRUE;
+                ArgumentUnderstood = TRUE;
+            } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("stats")) == 0) {
+                MakeContext.StatsDisplay = TRUE;
+                ArgumentUnderstood = TRUE;
             } else if (YoriLibCompareStringWithLiteralInsensitive(&Arg, _T("-")) == 0) {
                 StartArg = i + 1;
                 ArgumentUnderstood = TRUE;
@@ -266,13 +301,11 @@ ENTRYPOINT(
     }
 
     //
-    //  WaitForMultipleObjects has a limit of 64 things to wait for, so this
-    //  program can't currently have more than 64 children.
+    //  If the system doesn't support completion ports, the number of
+    //  children is limited when targets are executed.
     //
 
-    if (MakeContext.NumberProcesses > 64) {
-        MakeContext.NumberProcesses = 64;
-    }
+    YoriLibLoadKernel32Functions();
 
     MakeContext.ActiveScope = MakeContext.RootScope;
 
@@ -366,9 +399,29 @@ ENTRYPOINT(
         Result = EXIT_FAILURE;
         goto Cleanup;
     }
-    YoriLibFreeStringContents(&FullFileName);
+
+    //
+    //  If a previous build with the same makefiles, command line and
+    //  environment found nothing to do, and no file it looked at has
+    //  changed since, there is still nothing to do.
+    //
+
+    if (!MakeContext.BuildDbDisabled) {
+        QueryPerformanceCounter(&StartTime);
+        if (MakeBuildDbOpen(&MakeContext, ArgC, ArgV, &FullFileName)) {
+            QueryPerformanceCounter(&EndTime);
+            MakeContext.TimeInPreprocessor = EndTime.QuadPart - StartTime.QuadPart;
+            CloseHandle(hStream);
+            YoriLibFreeStringContents(&FullFileName);
+            Result = EXIT_SUCCESS;
+            goto Cleanup;
+        }
+        MakeBuildDbRecordPath(&MakeContext, &FullFileName, MAKE_BUILD_DB_PATH_INPUT);
+    }
 
     QueryPerformanceCounter(&StartTime);
+    MakePreprocessorSpeculateCommands(MakeContext.RootScope, &FullFileName);
+    YoriLibFreeStringContents(&FullFileName);
     MakeProcessStream(hStream, &MakeContext);
     QueryPerformanceCounter(&EndTime);
 
@@ -400,6 +453,7 @@ ENTRYPOINT(
     QueryPerformanceCounter(&EndTime);
     MakeContext.TimeInExecute = EndTime.QuadPart - StartTime.QuadPart;
 
+    MakeBuildDbSave(&MakeContext, (BOOLEAN)(MakeContext.CommandsLaunched == 0));
 
     Result = EXIT_SUCCESS;
 
@@ -426,6 +480,9 @@ Cleanup:
     MakeDeleteAllScopes(&MakeContext);
 
     YoriLibFreeStringContents(&MakeContext.FileToProbe);
+    MakeCmdCacheCleanup(&MakeContext);
+    MakeStatCacheCleanup(&MakeContext);
+    MakeBuildDbCleanup(&MakeContext);
 
     if (MakeContext.ErrorTermination) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Parse error!!\n"));
@@ -462,6 +519,15 @@ Cleanup:
 #endif
     }
 
+    if (MakeContext.StatsDisplay && Result == EXIT_SUCCESS) {
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("\n"));
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("File system probes: %i\n"), MakeContext.StatCacheProbes);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("File system cache hits: %i\n"), MakeContext.StatCacheHits);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Build database up to date: %s\n"), MakeContext.BuildDbUpToDate?_T("yes"):_T("no"));
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Preprocessor commands executed: %i\n"), MakeContext.CmdCacheLaunched);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Preprocessor command cache hits: %i\n"), MakeContext.CmdCacheHits);
+    }
+
     return Result;
 }
 
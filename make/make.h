@@ -81,6 +81,199 @@ typedef struct _MAKE_SLAB_ALLOC {
     PVOID Buffer;
 } MAKE_SLAB_ALLOC, *PMAKE_SLAB_ALLOC;
 
+/**
+ A single object found when enumerating a directory to determine file
+ timestamps.
+ */
+typedef struct _MAKE_STAT_CACHE_FILE {
+
+    /**
+     The entry for this file within the directory's hash table of files.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entry for this file within the directory's list of files, used to
+     facilitate bulk delete.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The name of the file within the directory.  The buffer for this string
+     follows the structure.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The time the file was last modified.
+     */
+    LARGE_INTEGER ModifiedTime;
+} MAKE_STAT_CACHE_FILE, *PMAKE_STAT_CACHE_FILE;
+
+/**
+ A directory whose contents have been enumerated to determine file
+ timestamps.
+ */
+typedef struct _MAKE_STAT_CACHE_DIRECTORY {
+
+    /**
+     The entry for this directory within the hash table of cached
+     directories.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entry for this directory within the list of cached directories,
+     used to facilitate bulk delete.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The fully qualified name of the directory including a trailing
+     separator.  The buffer for this string follows the structure.
+     */
+    YORI_STRING DirectoryName;
+
+    /**
+     A hash table of files within the directory, keyed by file name.
+     */
+    PYORI_HASH_TABLE Files;
+
+    /**
+     A list of files within the directory.
+     */
+    YORI_LIST_ENTRY FileList;
+
+    /**
+     The number of files within the directory.
+     */
+    DWORD FileCount;
+
+    /**
+     A hash of the names, sizes and timestamps of every object within the
+     directory.  This is used to determine whether the directory has changed
+     since a previous build.
+     */
+    DWORDLONG Fingerprint;
+} MAKE_STAT_CACHE_DIRECTORY, *PMAKE_STAT_CACHE_DIRECTORY;
+
+/**
+ The state of a preprocessor command.
+ */
+typedef enum _MAKE_CMD_CACHE_STATE {
+    MakeCmdCacheNotStarted = 0,
+    MakeCmdCacheRunning = 1,
+    MakeCmdCacheComplete = 2
+} MAKE_CMD_CACHE_STATE;
+
+/**
+ A command executed by the preprocessor to evaluate a condition, and its
+ result.
+ */
+typedef struct _MAKE_CMD_CACHE_ENTRY {
+
+    /**
+     The entry for this command within the hash table of commands.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entry for this command within the list of commands, used to
+     facilitate bulk delete.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The entry for this command within the list of commands found ahead of
+     the current point in a makefile which have not yet been started.
+     */
+    YORI_LIST_ENTRY QueueEntry;
+
+    /**
+     Whether the command has been started or has completed.
+     */
+    MAKE_CMD_CACHE_STATE State;
+
+    /**
+     A handle to the child process while the command is running.
+     */
+    HANDLE hProcess;
+
+    /**
+     The exit code of the command once it has completed.
+     */
+    DWORD ExitCode;
+
+    /**
+     TRUE if the result of the command has been requested by the
+     preprocessor, either in this run or a previous one.  Results of
+     speculated commands that were never reached are not saved.
+     */
+    BOOLEAN Requested;
+
+    /**
+     The command line.  The buffer for this string follows the structure.
+     */
+    YORI_STRING Cmd;
+} MAKE_CMD_CACHE_ENTRY, *PMAKE_CMD_CACHE_ENTRY;
+
+/**
+ Indicates that the object is a makefile that was parsed.
+ */
+#define MAKE_BUILD_DB_PATH_INPUT     0x00000001
+
+/**
+ Indicates that the object is a directory whose contents were enumerated.
+ */
+#define MAKE_BUILD_DB_PATH_DIRECTORY 0x00000002
+
+/**
+ Indicates that the object is a file whose existence and timestamp was
+ determined by opening it.
+ */
+#define MAKE_BUILD_DB_PATH_PROBE     0x00000004
+
+/**
+ Indicates that the object is a directory that may contain programs used
+ by preprocessor commands.
+ */
+#define MAKE_BUILD_DB_PATH_TOOL_DIRECTORY 0x00000008
+
+/**
+ Indicates that the object is a preprocessor command and its result.
+ */
+#define MAKE_BUILD_DB_PATH_COMMAND   0x00000010
+
+/**
+ An object whose state was used by this build.  If the build finds there is
+ nothing to do, these are written to the build database so a subsequent
+ build can determine whether anything has changed.
+ */
+typedef struct _MAKE_BUILD_DB_PATH {
+
+    /**
+     The entry for this object within the hash table of objects.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The entry for this object within the list of objects.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     A combination of MAKE_BUILD_DB_PATH_ flags indicating how the object
+     was used.
+     */
+    DWORD Flags;
+
+    /**
+     The fully qualified path to the object.  The buffer for this string
+     follows the structure.
+     */
+    YORI_STRING Path;
+} MAKE_BUILD_DB_PATH, *PMAKE_BUILD_DB_PATH;
+
 /**
  Context describing a scope.  In this program a scope generally refers to
  a single makefile, although note that one makefile can include others
@@ -479,6 +672,18 @@ typedef struct _MAKE_TARGET {
      */
     BOOLEAN InferenceRulePseudoTarget;
 
+    /**
+     TRUE if the critical path length for this target has been calculated.
+     */
+    BOOLEAN CriticalPathEvaluated;
+
+    /**
+     The number of commands along the longest chain of targets that depend
+     on this target, including this target's own commands.  Targets with a
+     longer critical path are launched first.
+     */
+    DWORD CriticalPathLength;
+
     /**
      The timestamp of the file.  This is only meaningful if FileExists is
      TRUE.
@@ -585,6 +790,66 @@ typedef struct _MAKE_CONTEXT {
      */
     YORI_LIST_ENTRY TargetsWaiting;
 
+    /**
+     A hash table of directories whose contents have been enumerated to
+     determine file existence and timestamps.  The key of this hash table is
+     fully qualified path.
+     */
+    PYORI_HASH_TABLE StatCacheDirectories;
+
+    /**
+     A list of directories whose contents have been enumerated, used to
+     facilitate bulk delete.
+     */
+    YORI_LIST_ENTRY StatCacheDirectoryList;
+
+    /**
+     A hash table of objects whose state was used by this build.  The key
+     of this hash table is fully qualified path.
+     */
+    PYORI_HASH_TABLE BuildDbPaths;
+
+    /**
+     A list of objects whose state was used by this build, in the order they
+     were first used.
+     */
+    YORI_LIST_ENTRY BuildDbPathList;
+
+    /**
+     The fully qualified path to the build database for this makefile.
+     */
+    YORI_STRING BuildDbFileName;
+
+    /**
+     A hash of the command line, environment and makefile location, which
+     must match for a build database to be used.
+     */
+    DWORDLONG BuildDbKey;
+
+    /**
+     A hash table of commands executed by the preprocessor.  The key of this
+     hash table is the command line.
+     */
+    PYORI_HASH_TABLE CmdCache;
+
+    /**
+     A list of commands executed by the preprocessor, used to facilitate
+     bulk delete.
+     */
+    YORI_LIST_ENTRY CmdCacheList;
+
+    /**
+     A list of commands found ahead of the current point in a makefile that
+     have not yet been started.
+     */
+    YORI_LIST_ENTRY CmdCacheQueue;
+
+    /**
+     A hash of the environment, which must match for the results of
+     preprocessor commands from a build database to be used.
+     */
+    DWORDLONG BuildDbEnvironmentKey;
+
     /**
      An allocation used to generate files to look for when determining which
      inference rules to apply.  Because this is very temporary, it is only
@@ -647,9 +912,50 @@ typedef struct _MAKE_CONTEXT {
      */
     DWORD AllocExpandedLine;
 
+    /**
+     The number of file system operations issued to determine file existence
+     and timestamps.
+     */
+    DWORD StatCacheProbes;
+
+    /**
+     The number of queries for file existence and timestamps that were
+     satisfied from previously enumerated directories.
+     */
+    DWORD StatCacheHits;
+
+    /**
+     The number of commands launched to build targets.
+     */
+    DWORD CommandsLaunched;
+
+    /**
+     The number of preprocessor commands currently executing.
+     */
+    DWORD CmdCacheRunning;
+
+    /**
+     The number of child processes launched to evaluate preprocessor
+     commands.
+     */
+    DWORD CmdCacheLaunched;
+
+    /**
+     The value of CmdCacheLaunched when the stat cache was last discarded
+     due to preprocessor commands.
+     */
+    DWORD CmdCacheLaunchedAtLastInvalidate;
+
+    /**
+     The number of preprocessor commands whose result was already known
+     when requested.
+     */
+    DWORD CmdCacheHits;
+
     /**
      The number of child processes to execute concurrently.  This defaults
-     to the number of logical processors, but is limited to 64 due to
+     to the number of logical processors.  If the system cannot notify a
+     completion port when processes terminate, it is limited to 64 due to
      WaitForMultipleObjects.
      */
     DWORD NumberProcesses;
@@ -665,6 +971,50 @@ typedef struct _MAKE_CONTEXT {
      */
     BOOLEAN PerfDisplay;
 
+    /**
+     TRUE to display the effectiveness of caches on exit.
+     */
+    BOOLEAN StatsDisplay;
+
+    /**
+     TRUE if the build database should not be used or updated.
+     */
+    BOOLEAN BuildDbDisabled;
+
+    /**
+     TRUE if commands in preprocessor conditions can be executed before the
+     condition is reached.  Since these commands may not be reached at all,
+     and may have side effects, this is only done when explicitly requested.
+     */
+    BOOLEAN SpeculateCommands;
+
+    /**
+     TRUE if the results of preprocessor commands from a previous build can
+     be used instead of executing the commands again.  The build database
+     can only detect changes to the environment and the directories that
+     contain programs, not to anything else a command reads, so this is
+     only done when explicitly requested.
+     */
+    BOOLEAN ReuseCommandResults;
+
+    /**
+     TRUE if objects used by the build are being recorded so that a build
+     database can be written.
+     */
+    BOOLEAN BuildDbRecording;
+
+    /**
+     TRUE if an object used by the build could not be recorded, so a build
+     database cannot be written.
+     */
+    BOOLEAN BuildDbRecordingFailed;
+
+    /**
+     TRUE if the build database indicated that nothing had changed since a
+     previous build which had nothing to do.
+     */
+    BOOLEAN BuildDbUpToDate;
+
 } MAKE_CONTEXT, *PMAKE_CONTEXT;
 
 // *** ALLOC.C ***
@@ -722,6 +1072,82 @@ MakeExecuteSetVariable(
     __in PYORI_STRING Line
     );
 
+// *** BUILDDB.C ***
+
+DWORDLONG
+MakeBuildDbHashBuffer(
+    __in DWORDLONG Hash,
+    __in PVOID Buffer,
+    __in DWORD Length
+    );
+
+DWORDLONG
+MakeBuildDbHashFindData(
+    __in PWIN32_FIND_DATA FindData
+    );
+
+BOOLEAN
+MakeBuildDbInitialize(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+VOID
+MakeBuildDbRecordPath(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Path,
+    __in DWORD Flag
+    );
+
+BOOLEAN
+MakeBuildDbOpen(
+    __in PMAKE_CONTEXT MakeContext,
+    __in DWORD ArgC,
+    __in YORI_STRING ArgV[],
+    __in PYORI_STRING MakefileName
+    );
+
+VOID
+MakeBuildDbSave(
+    __in PMAKE_CONTEXT MakeContext,
+    __in BOOLEAN UpToDate
+    );
+
+VOID
+MakeBuildDbCleanup(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+// *** CMDCACHE.C ***
+
+BOOLEAN
+MakeCmdCacheInitialize(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+VOID
+MakeCmdCacheSpeculate(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd
+    );
+
+VOID
+MakeCmdCacheAddResult(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd,
+    __in DWORD ExitCode
+    );
+
+DWORD
+MakeCmdCacheGetExitCode(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PCYORI_STRING Cmd
+    );
+
+VOID
+MakeCmdCacheCleanup(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
 // *** PREPROC.C ***
 
 VOID
@@ -729,6 +1155,12 @@ MakeTrimWhitespace(
     __in PYORI_STRING String
     );
 
+VOID
+MakePreprocessorSpeculateCommands(
+    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+    __in PYORI_STRING FileName
+    );
+
 __success(return)
 BOOLEAN
 MakeFindMakefileInDirectory(
@@ -783,6 +1215,39 @@ MakeDeleteAllScopes(
     __inout PMAKE_CONTEXT MakeContext
     );
 
+// *** STATCACHE.C ***
+
+BOOLEAN
+MakeStatCacheInitialize(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+__success(return)
+BOOLEAN
+MakeStatCacheQueryFile(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath,
+    __out PLARGE_INTEGER ModifiedTime
+    );
+
+__success(return)
+BOOLEAN
+MakeStatCacheGetDirectoryFingerprint(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirectoryName,
+    __out PDWORDLONG Fingerprint
+    );
+
+VOID
+MakeStatCacheInvalidate(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
+VOID
+MakeStatCacheCleanup(
+    __in PMAKE_CONTEXT MakeContext
+    );
+
 // *** TARGET.C ***
 
 VOID
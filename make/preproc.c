@@ -594,66 +594,128 @@ MakeBeginNestedConditionFalse(
 }
 
 /**
- Execute a subcommand and capture the result.  Currently this is used to
- evaluate preprocessor if statements only.
+ Scan a makefile ahead of parsing it for preprocessor conditions that
+ execute commands, and start executing those commands in the background.
+ The commands are expanded using the variables defined at this point, so
+ if a variable changes before the condition is reached, the command that
+ is actually needed will differ and will be executed when it is reached.
+ Results are only consumed when parsing reaches the condition, but commands
+ may execute early or in branches that are never taken, so this is only
+ performed when the user has requested speculation.
 
- @param MakeContext Pointer to the context.
-
- @param Cmd Pointer to the command to execute.
+ @param ScopeContext Pointer to the scope context.
 
- @return The exit code from the process, or 255 being the DOS exit code for
-         a command that cannot execute.
+ @param FileName Pointer to the fully qualified path to the makefile.
  */
-DWORD
-MakeExecuteCommandCaptureExitCode(
-    __in PMAKE_CONTEXT MakeContext,
-    __in PYORI_STRING Cmd
+VOID
+MakePreprocessorSpeculateCommands(
+    __in PMAKE_SCOPE_CONTEXT ScopeContext,
+    __in PYORI_STRING FileName
     )
 {
-    YORI_STRING EntireCmd;
-    STARTUPINFO si;
-    PROCESS_INFORMATION pi;
-    LARGE_INTEGER StartTime;
-    LARGE_INTEGER EndTime;
-    DWORD ExitCode;
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    YORI_STRING JoinedLine;
+    YORI_STRING LineToProcess;
+    YORI_STRING Arg;
+    YORI_STRING ExpandedArg;
+    YORI_STRING Cmd;
+    MAKE_PREPROCESSOR_LINE_TYPE PreprocessorLineType;
+    DWORD ArgOffset;
+    DWORD Index;
+    DWORD CmdStart;
+    HANDLE hStream;
+    BOOLEAN MoreLinesNeeded;
 
-    //
-    //  Because DOS
-    //
-    ExitCode = 255;
+    if (!ScopeContext->MakeContext->SpeculateCommands ||
+        ScopeContext->MakeContext->NumberProcesses <= 1) {
 
-    YoriLibInitEmptyString(&EntireCmd);
-    YoriLibYPrintf(&EntireCmd, _T("cmd /c %y"), Cmd);
-    if (EntireCmd.StartOfString == NULL) {
-        return ExitCode;
+        return;
     }
 
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
+    hStream = CreateFile(FileName->StartOfString, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (hStream == INVALID_HANDLE_VALUE) {
+        return;
+    }
 
-#if MAKE_DEBUG_PREPROCESSOR
-    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Executing preprocessor command: %y\n"), &EntireCmd);
-#endif
+    YoriLibInitEmptyString(&LineString);
+    YoriLibInitEmptyString(&JoinedLine);
+    YoriLibInitEmptyString(&LineToProcess);
+    YoriLibInitEmptyString(&ExpandedArg);
 
-    QueryPerformanceCounter(&StartTime);
-    if (!CreateProcess(NULL, EntireCmd.StartOfString, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
-        YoriLibFreeStringContents(&EntireCmd);
-        return ExitCode;
-    }
+    while (TRUE) {
 
-    YoriLibFreeStringContents(&EntireCmd);
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    QueryPerformanceCounter(&EndTime);
-    MakeContext->TimeInPreprocessorCreateProcess = MakeContext->TimeInPreprocessorCreateProcess + EndTime.QuadPart - StartTime.QuadPart;
-#if MAKE_DEBUG_PREPROCESSOR
-    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("...took %lli\n"), EndTime.QuadPart - StartTime.QuadPart);
-#endif
+        if (!YoriLibReadLineToString(&LineString, &LineContext, hStream)) {
+            break;
+        }
 
-    GetExitCodeProcess(pi.hProcess, &ExitCode);
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
+        LineToProcess.StartOfString = LineString.StartOfString;
+        LineToProcess.LengthInChars = LineString.LengthInChars;
+        MakeTruncateComments(&LineToProcess);
+        MakeTrimWhitespace(&LineToProcess);
 
-    return ExitCode;
+        MoreLinesNeeded = FALSE;
+        if (LineToProcess.LengthInChars > 0 && LineToProcess.StartOfString[LineToProcess.LengthInChars - 1] == '\\') {
+            MoreLinesNeeded = TRUE;
+        }
+
+        if (JoinedLine.LengthInChars > 0 || MoreLinesNeeded) {
+            MakeJoinLines(&JoinedLine, &LineToProcess);
+            if (MoreLinesNeeded) {
+                continue;
+            }
+            LineToProcess.StartOfString = JoinedLine.StartOfString;
+            LineToProcess.LengthInChars = JoinedLine.LengthInChars;
+        }
+
+        if (LineToProcess.LengthInChars == 0 || LineToProcess.StartOfString[0] != '!') {
+            JoinedLine.LengthInChars = 0;
+            continue;
+        }
+
+        PreprocessorLineType = MakeDeterminePreprocessorLineType(&LineToProcess, &ArgOffset);
+        if ((PreprocessorLineType != MakePreprocessorLineTypeIf &&
+             PreprocessorLineType != MakePreprocessorLineTypeElseIf) ||
+            ArgOffset >= LineToProcess.LengthInChars) {
+
+            JoinedLine.LengthInChars = 0;
+            continue;
+        }
+
+        YoriLibInitEmptyString(&Arg);
+        Arg.StartOfString = &LineToProcess.StartOfString[ArgOffset];
+        Arg.LengthInChars = LineToProcess.LengthInChars - ArgOffset;
+
+        if (MakeExpandVariables(ScopeContext, NULL, &ExpandedArg, &Arg)) {
+
+            //
+            //  Find each bracketed command within the expression.
+            //
+
+            CmdStart = 0;
+            for (Index = 0; Index < ExpandedArg.LengthInChars; Index++) {
+                if (ExpandedArg.StartOfString[Index] == '[' && CmdStart == 0) {
+                    CmdStart = Index + 1;
+                } else if (ExpandedArg.StartOfString[Index] == ']' && CmdStart != 0) {
+                    YoriLibInitEmptyString(&Cmd);
+                    Cmd.StartOfString = &ExpandedArg.StartOfString[CmdStart];
+                    Cmd.LengthInChars = Index - CmdStart;
+                    if (Cmd.LengthInChars > 0) {
+                        MakeCmdCacheSpeculate(ScopeContext->MakeContext, &Cmd);
+                    }
+                    CmdStart = 0;
+                }
+            }
+        }
+
+        JoinedLine.LengthInChars = 0;
+    }
+
+    YoriLibLineReadClose(LineContext);
+    YoriLibFreeStringContents(&LineString);
+    YoriLibFreeStringContents(&JoinedLine);
+    YoriLibFreeStringContents(&ExpandedArg);
+    CloseHandle(hStream);
 }
 
 /**
@@ -893,7 +955,7 @@ MakePreprocessorEvaluateCondition(
             YoriLibInitEmptyString(&Substring);
             Substring.StartOfString = &FirstPart.StartOfString[1];
             Substring.LengthInChars = FirstPart.LengthInChars - 2;
-            FirstNumber = MakeExecuteCommandCaptureExitCode(MakeContext, &Substring);
+            FirstNumber = MakeCmdCacheGetExitCode(MakeContext, &Substring);
         } else {
             if (!YoriLibStringToNumber(&FirstPart, TRUE, &FirstNumber, &CharsConsumed) || CharsConsumed == 0) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Syntax error in expression: %y\n"), Expression);
@@ -911,7 +973,7 @@ MakePreprocessorEvaluateCondition(
             YoriLibInitEmptyString(&Substring);
             Substring.StartOfString = &SecondPart.StartOfString[1];
             Substring.LengthInChars = SecondPart.LengthInChars - 2;
-            SecondNumber = MakeExecuteCommandCaptureExitCode(MakeContext, &Substring);
+            SecondNumber = MakeCmdCacheGetExitCode(MakeContext, &Substring);
         } else {
             if (!YoriLibStringToNumber(&SecondPart, TRUE, &SecondNumber, &CharsConsumed) || CharsConsumed == 0) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Syntax error in expression: %y\n"), Expression);
@@ -1029,6 +1091,9 @@ MakeInclude(
         return FALSE;
     }
 
+    MakeBuildDbRecordPath(ScopeContext->MakeContext, &FullPath, MAKE_BUILD_DB_PATH_INPUT);
+    MakePreprocessorSpeculateCommands(ScopeContext, &FullPath);
+
     memcpy(&SavedCurrentIncludeDirectory, &ScopeContext->CurrentIncludeDirectory, sizeof(YORI_STRING));
     YoriLibCloneString(&ScopeContext->CurrentIncludeDirectory, &FullPath);
     ScopeContext->CurrentIncludeDirectory.LengthInChars = (DWORD)((FilePart - ScopeContext->CurrentIncludeDirectory.StartOfString) - 1);
@@ -1294,6 +1359,7 @@ MakeFindMakefileInDirectory(
     )
 {
     YORI_STRING ProbeName;
+    LARGE_INTEGER ModifiedTime;
     DWORD Index;
     DWORD LongestName;
 
@@ -1310,7 +1376,7 @@ MakeFindMakefileInDirectory(
 
     for (Index = 0; Index < sizeof(MakefileNameCandidates)/sizeof(MakefileNameCandidates[0]); Index++) {
         ProbeName.LengthInChars = YoriLibSPrintf(ProbeName.StartOfString, _T("%y\\%y"), &ScopeContext->HashEntry.Key, &MakefileNameCandidates[Index]);
-        if (GetFileAttributes(ProbeName.StartOfString) != (DWORD)-1) {
+        if (MakeStatCacheQueryFile(ScopeContext->MakeContext, &ProbeName, &ModifiedTime)) {
             memcpy(FileName, &ProbeName, sizeof(YORI_STRING));
             return TRUE;
         }
@@ -1509,6 +1575,8 @@ MakeCreateFileListDependency(
         return FALSE;
     }
 
+    MakeBuildDbRecordPath(MakeContext, &FullPath, MAKE_BUILD_DB_PATH_INPUT);
+
     LineContext = NULL;
     Result = TRUE;
     YoriLibInitEmptyString(&LineString);
@@ -1584,6 +1652,9 @@ MakeCreateSubdirectoryDependency(
             goto Exit;
         }
 
+        MakeBuildDbRecordPath(MakeContext, &FullPath, MAKE_BUILD_DB_PATH_INPUT);
+        MakePreprocessorSpeculateCommands(MakeContext->ActiveScope, &FullPath);
+
         if (!MakeProcessStream(hStream, MakeContext)) {
 #if MAKE_DEBUG_PREPROCESSOR
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("ERROR: MakeProcessStream failed: %y\n"), &FullPath);
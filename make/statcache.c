@@ -0,0 +1,479 @@
+/**
+ * @file make/statcache.c
+ *
+ * Yori shell make cache of file existence and timestamps
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <yoripch.h>
+#include <yorilib.h>
+#include "make.h"
+
+/**
+ Allocate the hash table used to find cached directories.
+
+ @param MakeContext Pointer to the context.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeStatCacheInitialize(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    YoriLibInitializeListHead(&MakeContext->StatCacheDirectoryList);
+    MakeContext->StatCacheDirectories = YoriLibAllocateHashTable(1000);
+    if (MakeContext->StatCacheDirectories == NULL) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Allocate a cache entry for a single file found in a directory and add it to
+ the directory's list of files.  The entry is not inserted into a hash table
+ here because the number of files in the directory is not known yet.
+
+ @param Directory Pointer to the directory that contains the file.
+
+ @param FileName Pointer to a NULL terminated file name.
+
+ @param FindData Pointer to the information returned from enumerate.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOLEAN
+MakeStatCacheAddFile(
+    __in PMAKE_STAT_CACHE_DIRECTORY Directory,
+    __in LPCTSTR FileName,
+    __in PWIN32_FIND_DATA FindData
+    )
+{
+    PMAKE_STAT_CACHE_FILE File;
+    DWORD NameLength;
+
+    NameLength = (DWORD)_tcslen(FileName);
+
+    File = YoriLibReferencedMalloc(sizeof(MAKE_STAT_CACHE_FILE) + (NameLength + 1) * sizeof(TCHAR));
+    if (File == NULL) {
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&File->FileName);
+    File->FileName.StartOfString = (LPTSTR)(File + 1);
+    File->FileName.LengthInChars = NameLength;
+    File->FileName.LengthAllocated = NameLength + 1;
+    memcpy(File->FileName.StartOfString, FileName, (NameLength + 1) * sizeof(TCHAR));
+
+    File->ModifiedTime.LowPart = FindData->ftLastWriteTime.dwLowDateTime;
+    File->ModifiedTime.HighPart = FindData->ftLastWriteTime.dwHighDateTime;
+
+    YoriLibAppendList(&Directory->FileList, &File->ListEntry);
+    Directory->FileCount++;
+    return TRUE;
+}
+
+/**
+ Free a cached directory and all of the files that were found within it.
+
+ @param Directory Pointer to the directory to free.
+ */
+VOID
+MakeStatCacheFreeDirectory(
+    __in PMAKE_STAT_CACHE_DIRECTORY Directory
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_STAT_CACHE_FILE File;
+
+    ListEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+    while (ListEntry != NULL) {
+        File = CONTAINING_RECORD(ListEntry, MAKE_STAT_CACHE_FILE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&Directory->FileList, ListEntry);
+        YoriLibRemoveListItem(&File->ListEntry);
+        if (Directory->Files != NULL) {
+            YoriLibHashRemoveByEntry(&File->HashEntry);
+        }
+        YoriLibDereference(File);
+    }
+
+    if (Directory->Files != NULL) {
+        YoriLibFreeEmptyHashTable(Directory->Files);
+    }
+
+    YoriLibHashRemoveByEntry(&Directory->HashEntry);
+    YoriLibRemoveListItem(&Directory->ListEntry);
+    YoriLibDereference(Directory);
+}
+
+/**
+ Enumerate a directory and record the timestamps of every object within it
+ in a new cache entry.  If the directory does not exist, an entry is still
+ created indicating that no files exist within it.  If it exists but cannot
+ be fully enumerated, for example due to access denied, no entry is created
+ so that the caller queries each file directly.
+
+ @param MakeContext Pointer to the context.
+
+ @param DirectoryName Pointer to the name of the directory, including a
+        trailing path separator.
+
+ @return Pointer to the cached directory, or NULL if the directory could not
+         be enumerated or on allocation failure.
+ */
+PMAKE_STAT_CACHE_DIRECTORY
+MakeStatCacheLoadDirectory(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirectoryName
+    )
+{
+    PMAKE_STAT_CACHE_DIRECTORY Directory;
+    PMAKE_STAT_CACHE_FILE File;
+    PYORI_LIST_ENTRY ListEntry;
+    WIN32_FIND_DATA FindData;
+    HANDLE hFind;
+    LPTSTR SearchString;
+    DWORD BucketCount;
+    DWORD Err;
+    BOOLEAN Incomplete;
+
+    Directory = YoriLibReferencedMalloc(sizeof(MAKE_STAT_CACHE_DIRECTORY) + (DirectoryName->LengthInChars + 2) * sizeof(TCHAR));
+    if (Directory == NULL) {
+        return NULL;
+    }
+
+    Incomplete = FALSE;
+    YoriLibInitializeListHead(&Directory->FileList);
+    Directory->FileCount = 0;
+    Directory->Fingerprint = 0;
+    Directory->Files = NULL;
+
+    //
+    //  The key is the directory name, followed by a wildcard which is not
+    //  part of the key but is used to enumerate the directory.
+    //
+
+    YoriLibInitEmptyString(&Directory->DirectoryName);
+    SearchString = (LPTSTR)(Directory + 1);
+    memcpy(SearchString, DirectoryName->StartOfString, DirectoryName->LengthInChars * sizeof(TCHAR));
+    SearchString[DirectoryName->LengthInChars] = '*';
+    SearchString[DirectoryName->LengthInChars + 1] = '\0';
+    Directory->DirectoryName.StartOfString = SearchString;
+    Directory->DirectoryName.LengthInChars = DirectoryName->LengthInChars;
+    Directory->DirectoryName.LengthAllocated = DirectoryName->LengthInChars + 2;
+
+    MakeContext->StatCacheProbes++;
+
+    hFind = FindFirstFile(SearchString, &FindData);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (_tcscmp(FindData.cFileName, _T(".")) == 0 ||
+                _tcscmp(FindData.cFileName, _T("..")) == 0) {
+                continue;
+            }
+
+            Directory->Fingerprint = Directory->Fingerprint + MakeBuildDbHashFindData(&FindData);
+
+            if (!MakeStatCacheAddFile(Directory, FindData.cFileName, &FindData)) {
+                Incomplete = TRUE;
+                break;
+            }
+
+            //
+            //  Makefiles may refer to objects by their short name, so
+            //  record that too.
+            //
+
+            if (FindData.cAlternateFileName[0] != '\0' &&
+                _tcsicmp(FindData.cAlternateFileName, FindData.cFileName) != 0) {
+
+                if (!MakeStatCacheAddFile(Directory, FindData.cAlternateFileName, &FindData)) {
+                    Incomplete = TRUE;
+                    break;
+                }
+            }
+        } while (FindNextFile(hFind, &FindData));
+
+        if (!Incomplete) {
+            Err = GetLastError();
+            if (Err != ERROR_NO_MORE_FILES) {
+                Incomplete = TRUE;
+            }
+        }
+        FindClose(hFind);
+    } else {
+        Err = GetLastError();
+        if (Err != ERROR_FILE_NOT_FOUND &&
+            Err != ERROR_PATH_NOT_FOUND &&
+            Err != ERROR_NO_MORE_FILES) {
+
+            Incomplete = TRUE;
+        }
+    }
+
+    //
+    //  Now that the number of files is known, build a hash table of an
+    //  appropriate size to find them.  If the set of files is incomplete,
+    //  either because the directory could not be read or memory could not
+    //  be allocated, don't cache it, since that would report files as
+    //  missing.
+    //
+
+    BucketCount = Directory->FileCount;
+    if (BucketCount < 16) {
+        BucketCount = 16;
+    }
+
+    if (!Incomplete) {
+        Directory->Files = YoriLibAllocateHashTable(BucketCount);
+    }
+
+    if (Directory->Files == NULL) {
+        ListEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+        while (ListEntry != NULL) {
+            File = CONTAINING_RECORD(ListEntry, MAKE_STAT_CACHE_FILE, ListEntry);
+            ListEntry = YoriLibGetNextListEntry(&Directory->FileList, ListEntry);
+            YoriLibDereference(File);
+        }
+        YoriLibDereference(Directory);
+        return NULL;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&Directory->FileList, NULL);
+    while (ListEntry != NULL) {
+        File = CONTAINING_RECORD(ListEntry, MAKE_STAT_CACHE_FILE, ListEntry);
+        YoriLibHashInsertByKey(Directory->Files, &File->FileName, File, &File->HashEntry);
+        ListEntry = YoriLibGetNextListEntry(&Directory->FileList, ListEntry);
+    }
+
+    YoriLibHashInsertByKey(MakeContext->StatCacheDirectories, &Directory->DirectoryName, Directory, &Directory->HashEntry);
+    YoriLibAppendList(&MakeContext->StatCacheDirectoryList, &Directory->ListEntry);
+
+    MakeBuildDbRecordPath(MakeContext, &Directory->DirectoryName, MAKE_BUILD_DB_PATH_DIRECTORY);
+
+    return Directory;
+}
+
+/**
+ Query the existence and last modified time of a file by opening it.  This
+ is used for objects that cannot be found via directory enumeration, such
+ as volume roots or named streams, or if the cache cannot be populated.
+
+ @param MakeContext Pointer to the context.
+
+ @param FullPath Pointer to the fully qualified path to the object.
+
+ @param ModifiedTime On successful completion, updated to contain the last
+        modified time of the object.
+
+ @return TRUE to indicate the object exists, FALSE if it does not.
+ */
+__success(return)
+BOOLEAN
+MakeStatCacheProbeFile(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath,
+    __out PLARGE_INTEGER ModifiedTime
+    )
+{
+    HANDLE FileHandle;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    BOOLEAN FileExists;
+
+    FileExists = FALSE;
+    MakeContext->StatCacheProbes++;
+    MakeBuildDbRecordPath(MakeContext, FullPath, MAKE_BUILD_DB_PATH_PROBE);
+
+    FileHandle = CreateFile(FullPath->StartOfString, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (FileHandle != INVALID_HANDLE_VALUE) {
+        if (GetFileInformationByHandle(FileHandle, &FileInfo)) {
+            FileExists = TRUE;
+            ModifiedTime->LowPart = FileInfo.ftLastWriteTime.dwLowDateTime;
+            ModifiedTime->HighPart = FileInfo.ftLastWriteTime.dwHighDateTime;
+        }
+        CloseHandle(FileHandle);
+    }
+
+    return FileExists;
+}
+
+/**
+ Determine whether a file exists and when it was last modified.  The first
+ query for any file within a directory will enumerate the entire directory,
+ so that subsequent queries for any file in that directory, from any scope,
+ can be answered from memory.
+
+ @param MakeContext Pointer to the context.
+
+ @param FullPath Pointer to the fully qualified path to the object.  This
+        must be NULL terminated.
+
+ @param ModifiedTime On successful completion, updated to contain the last
+        modified time of the object.
+
+ @return TRUE to indicate the object exists, FALSE if it does not.
+ */
+__success(return)
+BOOLEAN
+MakeStatCacheQueryFile(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING FullPath,
+    __out PLARGE_INTEGER ModifiedTime
+    )
+{
+    YORI_STRING DirectoryName;
+    YORI_STRING FileName;
+    LPTSTR FinalSeparator;
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_STAT_CACHE_DIRECTORY Directory;
+    PMAKE_STAT_CACHE_FILE File;
+
+    ASSERT(YoriLibIsStringNullTerminated(FullPath));
+
+    FinalSeparator = YoriLibFindRightMostCharacter(FullPath, '\\');
+    if (FinalSeparator == NULL) {
+        return MakeStatCacheProbeFile(MakeContext, FullPath, ModifiedTime);
+    }
+
+    YoriLibInitEmptyString(&DirectoryName);
+    DirectoryName.StartOfString = FullPath->StartOfString;
+    DirectoryName.LengthInChars = (DWORD)(FinalSeparator - FullPath->StartOfString + 1);
+
+    YoriLibInitEmptyString(&FileName);
+    FileName.StartOfString = FinalSeparator + 1;
+    FileName.LengthInChars = FullPath->LengthInChars - DirectoryName.LengthInChars;
+
+    //
+    //  Directory enumeration can't describe the root of a volume, named
+    //  streams, or wildcards, so let the file system interpret those.
+    //
+
+    if (FileName.LengthInChars == 0 ||
+        YoriLibFindLeftMostCharacter(&FileName, ':') != NULL ||
+        YoriLibFindLeftMostCharacter(&FileName, '*') != NULL ||
+        YoriLibFindLeftMostCharacter(&FileName, '?') != NULL) {
+
+        return MakeStatCacheProbeFile(MakeContext, FullPath, ModifiedTime);
+    }
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->StatCacheDirectories, &DirectoryName);
+    if (HashEntry != NULL) {
+        Directory = HashEntry->Context;
+        MakeContext->StatCacheHits++;
+    } else {
+        Directory = MakeStatCacheLoadDirectory(MakeContext, &DirectoryName);
+        if (Directory == NULL) {
+            return MakeStatCacheProbeFile(MakeContext, FullPath, ModifiedTime);
+        }
+    }
+
+    HashEntry = YoriLibHashLookupByKey(Directory->Files, &FileName);
+    if (HashEntry == NULL) {
+        return FALSE;
+    }
+
+    File = HashEntry->Context;
+    ModifiedTime->QuadPart = File->ModifiedTime.QuadPart;
+    return TRUE;
+}
+
+/**
+ Return the fingerprint of a directory's contents, enumerating the directory
+ if it has not been enumerated already.
+
+ @param MakeContext Pointer to the context.
+
+ @param DirectoryName Pointer to the fully qualified name of the directory,
+        including a trailing path separator.
+
+ @param Fingerprint On successful completion, updated to contain a hash of
+        the contents of the directory.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOLEAN
+MakeStatCacheGetDirectoryFingerprint(
+    __in PMAKE_CONTEXT MakeContext,
+    __in PYORI_STRING DirectoryName,
+    __out PDWORDLONG Fingerprint
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PMAKE_STAT_CACHE_DIRECTORY Directory;
+
+    HashEntry = YoriLibHashLookupByKey(MakeContext->StatCacheDirectories, DirectoryName);
+    if (HashEntry != NULL) {
+        Directory = HashEntry->Context;
+    } else {
+        Directory = MakeStatCacheLoadDirectory(MakeContext, DirectoryName);
+        if (Directory == NULL) {
+            return FALSE;
+        }
+    }
+
+    *Fingerprint = Directory->Fingerprint;
+    return TRUE;
+}
+
+/**
+ Discard all cached directory contents.  This is used when an external
+ process may have modified the file system, so subsequent queries must
+ observe the current state.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeStatCacheInvalidate(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMAKE_STAT_CACHE_DIRECTORY Directory;
+
+    ListEntry = YoriLibGetNextListEntry(&MakeContext->StatCacheDirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, MAKE_STAT_CACHE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&MakeContext->StatCacheDirectoryList, ListEntry);
+        MakeStatCacheFreeDirectory(Directory);
+    }
+}
+
+/**
+ Free all state associated with the cache.
+
+ @param MakeContext Pointer to the context.
+ */
+VOID
+MakeStatCacheCleanup(
+    __in PMAKE_CONTEXT MakeContext
+    )
+{
+    if (MakeContext->StatCacheDirectories != NULL) {
+        MakeStatCacheInvalidate(MakeContext);
+        YoriLibFreeEmptyHashTable(MakeContext->StatCacheDirectories);
+        MakeContext->StatCacheDirectories = NULL;
+    }
+}
+
+// vim:sw=4:ts=4:et:
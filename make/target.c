@@ -173,8 +173,6 @@ MakeLookupOrCreateTarget(
     YORI_STRING FullPath;
     PMAKE_TARGET Target;
     PYORI_HASH_ENTRY HashEntry;
-    HANDLE FileHandle;
-    BY_HANDLE_FILE_INFORMATION FileInfo;
     PMAKE_CONTEXT MakeContext;
 
     //
@@ -219,6 +217,8 @@ MakeLookupOrCreateTarget(
     Target->RebuildRequired = FALSE;
     Target->DependenciesEvaluated = FALSE;
     Target->InferenceRulePseudoTarget = FALSE;
+    Target->CriticalPathEvaluated = FALSE;
+    Target->CriticalPathLength = 0;
     Target->ModifiedTime.QuadPart = 0;
     Target->InferenceRule = NULL;
     Target->InferenceRuleParentTarget = NULL;
@@ -238,14 +238,10 @@ MakeLookupOrCreateTarget(
     //  clocks going backwards in time that produce false negatives.
     //
 
-    FileHandle = CreateFile(FullPath.StartOfString, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
-    if (FileHandle != INVALID_HANDLE_VALUE) {
-        if (GetFileInformationByHandle(FileHandle, &FileInfo)) {
-            Target->FileExists = TRUE;
-            Target->ModifiedTime.LowPart = FileInfo.ftLastWriteTime.dwLowDateTime;
-            Target->ModifiedTime.HighPart = FileInfo.ftLastWriteTime.dwHighDateTime;
-        }
-        CloseHandle(FileHandle);
+    if (MakeStatCacheQueryFile(MakeContext, &FullPath, &Target->ModifiedTime)) {
+        Target->FileExists = TRUE;
+    } else {
+        Target->ModifiedTime.QuadPart = 0;
     }
     YoriLibFreeStringContents(&FullPath);
 
@@ -534,6 +530,8 @@ MakeFindInferenceRuleForTarget(
     PMAKE_INFERENCE_RULE NestedRule;
     YORI_STRING TargetExt;
     PYORI_STRING FileToProbe;
+    YORI_STRING ProbeName;
+    LARGE_INTEGER ModifiedTime;
     DWORD Index;
     DWORD CharsNeeded;
     DWORD LongestSourceExt;
@@ -610,16 +608,21 @@ MakeFindInferenceRuleForTarget(
     FileToProbe->LengthInChars = Target->HashEntry.Key.LengthInChars - TargetExt.LengthInChars;
     memcpy(FileToProbe->StartOfString, Target->HashEntry.Key.StartOfString, FileToProbe->LengthInChars * sizeof(TCHAR));
 
+    YoriLibInitEmptyString(&ProbeName);
+    ProbeName.StartOfString = FileToProbe->StartOfString;
+    ProbeName.LengthAllocated = FileToProbe->LengthAllocated;
+
     FoundRuleWithTargetExtension = FALSE;
 
     InferenceRule = MakeGetNextInferenceRuleTargetExtension(ScopeContext, &TargetExt, NULL);
     while (InferenceRule != NULL) {
         FoundRuleWithTargetExtension = TRUE;
         YoriLibSPrintf(&FileToProbe->StartOfString[FileToProbe->LengthInChars], _T("%y"), &InferenceRule->SourceExtension);
+        ProbeName.LengthInChars = FileToProbe->LengthInChars + InferenceRule->SourceExtension.LengthInChars;
 #if MAKE_DEBUG_TARGETS
-        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("GetFileAttributes for: %s\n"), FileToProbe->StartOfString);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Probing for: %s\n"), FileToProbe->StartOfString);
 #endif
-        if (GetFileAttributes(FileToProbe->StartOfString) != (DWORD)-1) {
+        if (MakeStatCacheQueryFile(ScopeContext->MakeContext, &ProbeName, &ModifiedTime)) {
             FileToProbe->LengthInChars = FileToProbe->LengthInChars + InferenceRule->SourceExtension.LengthInChars;
             if (!MakeAssignInferenceRuleToTarget(ScopeContext, Target, InferenceRule, FileToProbe)) {
                 return FALSE;
@@ -650,11 +653,12 @@ MakeFindInferenceRuleForTarget(
         NestedRule = MakeGetNextInferenceRuleTargetExtension(ScopeContext, &InferenceRule->SourceExtension, NULL);
         while (NestedRule != NULL) {
             YoriLibSPrintf(&FileToProbe->StartOfString[FileToProbe->LengthInChars], _T("%y"), &NestedRule->SourceExtension);
+            ProbeName.LengthInChars = FileToProbe->LengthInChars + NestedRule->SourceExtension.LengthInChars;
 
 #if MAKE_DEBUG_TARGETS
-            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("GetFileAttributes for: %s\n"), FileToProbe->StartOfString);
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Probing for: %s\n"), FileToProbe->StartOfString);
 #endif
-            if (GetFileAttributes(FileToProbe->StartOfString) != (DWORD)-1) {
+            if (MakeStatCacheQueryFile(ScopeContext->MakeContext, &ProbeName, &ModifiedTime)) {
 
                 //
                 //  First, generate the outer rule, assigning the inference
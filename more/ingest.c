@@ -26,185 +26,830 @@
 
 #include "more.h"
 
+/**
+ Allocate a physical line from a buffer and populate it with a line of
+ input, expanding tabs and tracking the color in effect at the end of the
+ line.
+
+ @param MoreContext Pointer to the more context.
+
+ @param LineBuffer Pointer to the buffer to allocate the physical line from.
+        If the buffer has insufficient space, a new buffer is allocated and
+        this structure is updated to describe it.
+
+ @param LineString Pointer to the line of input.
+
+ @param LineNumber The number of the physical line.
+
+ @param Color On input, points to the color in effect at the beginning of
+        the line.  On output, updated to contain the color in effect at the
+        end of the line.
+
+ @return Pointer to the new physical line, or NULL on allocation failure.
+ */
+PMORE_PHYSICAL_LINE
+MoreAllocatePhysicalLine(
+    __in PMORE_CONTEXT MoreContext,
+    __inout PMORE_PHYSICAL_LINE_BUFFER LineBuffer,
+    __in PYORI_STRING LineString,
+    __in DWORDLONG LineNumber,
+    __inout PWORD Color
+    )
+{
+    PMORE_PHYSICAL_LINE NewLine;
+    DWORD TabCount;
+    DWORD CharIndex;
+    DWORD DestIndex;
+    DWORD TabIndex;
+    DWORD BytesRequired;
+    DWORD Alignment;
+    WORD PreviousColor;
+
+    //
+    //  Count the number of tabs.  These are replaced at ingestion time,
+    //  since the width can't change while the program is running and to
+    //  save the complexity of accounting for carryover spaces due to tab
+    //  expansion at end of logical line
+    //
+
+    TabCount = 0;
+    for (CharIndex = 0; CharIndex < LineString->LengthInChars; CharIndex++) {
+        if (LineString->StartOfString[CharIndex] == '\t') {
+            TabCount++;
+        }
+    }
+
+    //
+    //  We need space for the structure, all characters in the source, a NULL,
+    //  and since tabs will be replaced with spaces the number of spaces per
+    //  tab minus one (for the tab character being removed.)
+    //
+
+    BytesRequired = sizeof(MORE_PHYSICAL_LINE) + (LineString->LengthInChars + TabCount * (MoreContext->TabWidth - 1) + 1) * sizeof(TCHAR);
+
+    //
+    //  If we need a buffer, allocate a buffer that typically has space for
+    //  multiple lines
+    //
+
+    if (LineBuffer->Buffer == NULL || BytesRequired > LineBuffer->BytesRemainingInBuffer) {
+        if (LineBuffer->Buffer != NULL) {
+            YoriLibDereference(LineBuffer->Buffer);
+            LineBuffer->Buffer = NULL;
+        }
+        LineBuffer->BytesRemainingInBuffer = 64 * 1024;
+        if (BytesRequired > LineBuffer->BytesRemainingInBuffer) {
+            LineBuffer->BytesRemainingInBuffer = BytesRequired;
+        }
+        LineBuffer->BufferOffset = 0;
+
+        LineBuffer->Buffer = YoriLibReferencedMalloc(LineBuffer->BytesRemainingInBuffer);
+        if (LineBuffer->Buffer == NULL) {
+            LineBuffer->BytesRemainingInBuffer = 0;
+            return NULL;
+        }
+    }
+
+    //
+    //  Write this line into the current buffer
+    //
+
+    NewLine = (PMORE_PHYSICAL_LINE)YoriLibAddToPointer(LineBuffer->Buffer, LineBuffer->BufferOffset);
+    PreviousColor = *Color;
+
+    YoriLibReference(LineBuffer->Buffer);
+    NewLine->MemoryToFree = LineBuffer->Buffer;
+    NewLine->InitialColor = PreviousColor;
+    NewLine->LineNumber = LineNumber;
+    YoriLibReference(LineBuffer->Buffer);
+    NewLine->LineContents.MemoryToFree = LineBuffer->Buffer;
+    NewLine->LineContents.StartOfString = (LPTSTR)(NewLine + 1);
+
+    for (CharIndex = 0, DestIndex = 0; CharIndex < LineString->LengthInChars; CharIndex++) {
+        //
+        //  If the string is <ESC>[, then treat it as an escape sequence.
+        //  Look for the final letter after any numbers or semicolon.
+        //
+
+        if (LineString->LengthInChars > CharIndex + 2 &&
+            LineString->StartOfString[CharIndex] == 27 &&
+            LineString->StartOfString[CharIndex + 1] == '[') {
+
+            YORI_STRING EscapeSubset;
+            DWORD EndOfEscape;
+
+            YoriLibInitEmptyString(&EscapeSubset);
+            EscapeSubset.StartOfString = &LineString->StartOfString[CharIndex + 2];
+            EscapeSubset.LengthInChars = LineString->LengthInChars - CharIndex - 2;
+            EndOfEscape = YoriLibCountStringContainingChars(&EscapeSubset, _T("0123456789;"));
+
+            //
+            //  Count everything as consuming the source and needing buffer
+            //  space in the destination but consuming no display cells.  This
+            //  may include the final letter, if we found one.
+            //
+
+            if (LineString->LengthInChars > CharIndex + 2 + EndOfEscape) {
+                EscapeSubset.StartOfString -= 2;
+                EscapeSubset.LengthInChars = EndOfEscape + 3;
+                YoriLibVtFinalColorFromSequence(PreviousColor, &EscapeSubset, &PreviousColor);
+            }
+        }
+        if (LineString->StartOfString[CharIndex] == '\t') {
+            for (TabIndex = 0; TabIndex < MoreContext->TabWidth; TabIndex++) {
+                NewLine->LineContents.StartOfString[DestIndex] = ' ';
+                DestIndex++;
+            }
+        } else {
+            NewLine->LineContents.StartOfString[DestIndex] = LineString->StartOfString[CharIndex];
+            DestIndex++;
+        }
+    }
+    NewLine->LineContents.StartOfString[DestIndex] = '\0';
+    NewLine->LineContents.LengthInChars = DestIndex;
+    NewLine->LineContents.LengthAllocated = DestIndex + 1;
+
+    LineBuffer->BufferOffset += BytesRequired;
+    LineBuffer->BytesRemainingInBuffer -= BytesRequired;
+
+    //
+    //  Align the buffer to 8 bytes.  The allocation is assumed to be aligned
+    //  to 8 bytes, but a buffer sized for a single long line may not have
+    //  space for the padding, so it is treated as full.
+    //
+
+    Alignment = LineBuffer->BufferOffset % 8;
+    if (Alignment > 0) {
+        Alignment = 8 - Alignment;
+        LineBuffer->BufferOffset += Alignment;
+        if (LineBuffer->BytesRemainingInBuffer > Alignment) {
+            LineBuffer->BytesRemainingInBuffer -= Alignment;
+        } else {
+            LineBuffer->BytesRemainingInBuffer = 0;
+        }
+    }
+
+    *Color = PreviousColor;
+    return NewLine;
+}
+
+/**
+ Release the buffer that physical lines are being allocated from.  Any lines
+ allocated from the buffer retain their own references to it.
+
+ @param LineBuffer Pointer to the buffer to release.
+ */
+VOID
+MoreReleasePhysicalLineBuffer(
+    __inout PMORE_PHYSICAL_LINE_BUFFER LineBuffer
+    )
+{
+    if (LineBuffer->Buffer != NULL) {
+        YoriLibDereference(LineBuffer->Buffer);
+        LineBuffer->Buffer = NULL;
+    }
+    LineBuffer->BytesRemainingInBuffer = 0;
+    LineBuffer->BufferOffset = 0;
+}
+
+/**
+ Free the physical lines within a block.  The block itself remains in the
+ line index and its lines can be reloaded later if they came from a file.
+ Any logical lines derived from these physical lines hold their own
+ references, so remain valid.
+
+ @param Block Pointer to the block whose lines should be freed.
+ */
+VOID
+MoreDiscardLineBlockContents(
+    __inout PMORE_LINE_BLOCK Block
+    )
+{
+    PMORE_PHYSICAL_LINE PhysicalLine;
+    DWORD Index;
+
+    if (Block->Lines == NULL) {
+        return;
+    }
+
+    for (Index = 0; Index < Block->LineCount; Index++) {
+        PhysicalLine = Block->Lines[Index];
+        YoriLibFreeStringContents(&PhysicalLine->LineContents);
+        YoriLibDereference(PhysicalLine->MemoryToFree);
+    }
+
+    YoriLibFree(Block->Lines);
+    Block->Lines = NULL;
+}
+
+/**
+ Mark a block whose lines are in memory as the most recently used, and
+ discard the lines from the least recently used blocks if too many are in
+ memory.  The caller is expected to hold PhysicalLineMutex.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Block Pointer to the block which has been used.  This block must
+        contain lines from a file, since other lines cannot be discarded.
+ */
+VOID
+MoreMarkLineBlockRecentlyUsed(
+    __inout PMORE_CONTEXT MoreContext,
+    __inout PMORE_LINE_BLOCK Block
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMORE_LINE_BLOCK DiscardBlock;
+
+    ASSERT(Block->InputFile != NULL && Block->Lines != NULL);
+
+    if (YoriLibIsListEmpty(&Block->ResidentList)) {
+        MoreContext->ResidentBlockCount++;
+    } else {
+        YoriLibRemoveListItem(&Block->ResidentList);
+    }
+    YoriLibAppendList(&MoreContext->ResidentBlockList, &Block->ResidentList);
+
+    while (MoreContext->ResidentBlockCount > MORE_MAXIMUM_RESIDENT_BLOCKS) {
+        ListEntry = YoriLibGetNextListEntry(&MoreContext->ResidentBlockList, NULL);
+        ASSERT(ListEntry != NULL && ListEntry != &Block->ResidentList);
+        DiscardBlock = CONTAINING_RECORD(ListEntry, MORE_LINE_BLOCK, ResidentList);
+        YoriLibRemoveListItem(ListEntry);
+        YoriLibInitializeListHead(ListEntry);
+        MoreContext->ResidentBlockCount--;
+        MoreDiscardLineBlockContents(DiscardBlock);
+    }
+}
+
+/**
+ Allocate a new block of physical lines and add it to the end of the line
+ index.  The block initially contains no lines visible to the viewport.
+
+ @param MoreContext Pointer to the more context.
+
+ @param InputFile Optionally points to the file that the lines in this block
+        are being read from.  If NULL, the lines cannot be read again.
+
+ @param FileOffset The offset within InputFile of the first line in the
+        block.
+
+ @param InitialColor The color in effect at the beginning of the first line
+        in the block.
+
+ @return Pointer to the new block, or NULL on allocation failure.
+ */
+PMORE_LINE_BLOCK
+MoreAllocateLineBlock(
+    __inout PMORE_CONTEXT MoreContext,
+    __in_opt PMORE_INPUT_FILE InputFile,
+    __in DWORDLONG FileOffset,
+    __in WORD InitialColor
+    )
+{
+    PMORE_LINE_BLOCK Block;
+    PMORE_LINE_BLOCK * NewLineBlocks;
+    DWORD NewLineBlocksAllocated;
+
+    Block = YoriLibMalloc(sizeof(MORE_LINE_BLOCK));
+    if (Block == NULL) {
+        return NULL;
+    }
+
+    Block->Lines = YoriLibMalloc(MORE_LINES_PER_BLOCK * sizeof(PMORE_PHYSICAL_LINE));
+    if (Block->Lines == NULL) {
+        YoriLibFree(Block);
+        return NULL;
+    }
+
+    YoriLibInitializeListHead(&Block->ResidentList);
+    Block->InputFile = InputFile;
+    Block->FileOffset.QuadPart = FileOffset;
+    Block->LineCount = 0;
+    Block->InitialColor = InitialColor;
+
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+
+    if (MoreContext->LineBlockCount >= MoreContext->LineBlocksAllocated) {
+        NewLineBlocksAllocated = MoreContext->LineBlocksAllocated * 2;
+        if (NewLineBlocksAllocated < 256) {
+            NewLineBlocksAllocated = 256;
+        }
+
+        NewLineBlocks = YoriLibMalloc(NewLineBlocksAllocated * sizeof(PMORE_LINE_BLOCK));
+        if (NewLineBlocks == NULL) {
+            ReleaseMutex(MoreContext->PhysicalLineMutex);
+            YoriLibFree(Block->Lines);
+            YoriLibFree(Block);
+            return NULL;
+        }
+
+        if (MoreContext->LineBlockCount > 0) {
+            memcpy(NewLineBlocks, MoreContext->LineBlocks, MoreContext->LineBlockCount * sizeof(PMORE_LINE_BLOCK));
+        }
+        if (MoreContext->LineBlocks != NULL) {
+            YoriLibFree(MoreContext->LineBlocks);
+        }
+        MoreContext->LineBlocks = NewLineBlocks;
+        MoreContext->LineBlocksAllocated = NewLineBlocksAllocated;
+    }
+
+    Block->FirstLineNumber = MoreContext->LineCount + 1;
+    MoreContext->LineBlocks[MoreContext->LineBlockCount] = Block;
+    MoreContext->LineBlockCount++;
+
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    return Block;
+}
+
+/**
+ Make lines that the ingest thread has added to a block visible to the
+ viewport, and signal the viewport that new lines are available.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Block Pointer to the block containing new lines.
+
+ @param LinesInBlock The number of lines that have been populated into the
+        block.
+
+ @param BlockComplete TRUE if no further lines will be added to the block,
+        which allows its lines to be discarded if they came from a file.
+ */
+VOID
+MorePublishLineBlock(
+    __inout PMORE_CONTEXT MoreContext,
+    __inout PMORE_LINE_BLOCK Block,
+    __in DWORD LinesInBlock,
+    __in BOOLEAN BlockComplete
+    )
+{
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+    MoreContext->LineCount += LinesInBlock - Block->LineCount;
+    Block->LineCount = LinesInBlock;
+    MoreContext->PublishCount++;
+    if (BlockComplete && Block->InputFile != NULL) {
+        MoreMarkLineBlockRecentlyUsed(MoreContext, Block);
+    }
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    SetEvent(MoreContext->PhysicalLineAvailableEvent);
+}
+
+/**
+ Find the block containing a specified physical line.  The caller is
+ expected to hold PhysicalLineMutex.
+
+ @param MoreContext Pointer to the more context.
+
+ @param LineNumber The number of the physical line to find.
+
+ @return Pointer to the block containing the line, or NULL if no block
+         contains it.
+ */
+PMORE_LINE_BLOCK
+MoreFindLineBlock(
+    __in PMORE_CONTEXT MoreContext,
+    __in DWORDLONG LineNumber
+    )
+{
+    PMORE_LINE_BLOCK Block;
+    DWORDLONG BlockIndex;
+    DWORD Lower;
+    DWORD Upper;
+    DWORD Midpoint;
+
+    //
+    //  Every block is full unless it is the last block from its source, so
+    //  with a single source the block can be calculated directly.  With
+    //  multiple sources, fall back to searching.
+    //
+
+    BlockIndex = (LineNumber - 1) / MORE_LINES_PER_BLOCK;
+    if (BlockIndex < MoreContext->LineBlockCount) {
+        Block = MoreContext->LineBlocks[(DWORD)BlockIndex];
+        if (LineNumber >= Block->FirstLineNumber &&
+            LineNumber < Block->FirstLineNumber + Block->LineCount) {
+
+            return Block;
+        }
+    }
+
+    Lower = 0;
+    Upper = MoreContext->LineBlockCount;
+    while (Lower < Upper) {
+        Midpoint = Lower + (Upper - Lower) / 2;
+        Block = MoreContext->LineBlocks[Midpoint];
+        if (LineNumber < Block->FirstLineNumber) {
+            Upper = Midpoint;
+        } else if (LineNumber >= Block->FirstLineNumber + Block->LineCount) {
+            Lower = Midpoint + 1;
+        } else {
+            return Block;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ Reload the lines in a block from the file they were originally read from.
+ The caller is expected to hold PhysicalLineMutex.
+
+ @param MoreContext Pointer to the more context.
+
+ @param Block Pointer to the block whose lines should be reloaded.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+MoreLoadLineBlock(
+    __inout PMORE_CONTEXT MoreContext,
+    __inout PMORE_LINE_BLOCK Block
+    )
+{
+    PMORE_INPUT_FILE InputFile;
+    PMORE_PHYSICAL_LINE * Lines;
+    MORE_PHYSICAL_LINE_BUFFER LineBuffer;
+    LARGE_INTEGER FileOffset;
+    YORI_STRING LineString;
+    PVOID LineContext = NULL;
+    HANDLE FileHandle;
+    DWORD Index;
+    DWORD FreeIndex;
+    WORD Color;
+
+    InputFile = Block->InputFile;
+    ASSERT(Block->Lines == NULL && InputFile != NULL);
+
+    if (InputFile->FileHandle == NULL) {
+        FileHandle = CreateFile(InputFile->FilePath.StartOfString,
+                                GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                                NULL);
+
+        if (FileHandle == INVALID_HANDLE_VALUE) {
+            return FALSE;
+        }
+        InputFile->FileHandle = FileHandle;
+    }
+
+    FileOffset.QuadPart = Block->FileOffset.QuadPart;
+    FileOffset.LowPart = SetFilePointer(InputFile->FileHandle, FileOffset.LowPart, &FileOffset.HighPart, FILE_BEGIN);
+    if (FileOffset.LowPart == INVALID_SET_FILE_POINTER && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    Lines = YoriLibMalloc(Block->LineCount * sizeof(PMORE_PHYSICAL_LINE));
+    if (Lines == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(&LineBuffer, sizeof(LineBuffer));
+    YoriLibInitEmptyString(&LineString);
+    Color = Block->InitialColor;
+
+    for (Index = 0; Index < Block->LineCount; Index++) {
+
+        //
+        //  If the file has been truncated since it was indexed, supply
+        //  empty lines so the line numbering remains consistent.
+        //
+
+        if (!YoriLibReadLineToString(&LineString, &LineContext, InputFile->FileHandle)) {
+            LineString.LengthInChars = 0;
+        }
+
+        Lines[Index] = MoreAllocatePhysicalLine(MoreContext, &LineBuffer, &LineString, Block->FirstLineNumber + Index, &Color);
+        if (Lines[Index] == NULL) {
+            break;
+        }
+    }
+
+    MoreReleasePhysicalLineBuffer(&LineBuffer);
+    YoriLibLineReadClose(LineContext);
+    YoriLibFreeStringContents(&LineString);
+
+    if (Index < Block->LineCount) {
+        for (FreeIndex = 0; FreeIndex < Index; FreeIndex++) {
+            YoriLibFreeStringContents(&Lines[FreeIndex]->LineContents);
+            YoriLibDereference(Lines[FreeIndex]->MemoryToFree);
+        }
+        YoriLibFree(Lines);
+        return FALSE;
+    }
+
+    Block->Lines = Lines;
+    MoreMarkLineBlockRecentlyUsed(MoreContext, Block);
+    return TRUE;
+}
+
+/**
+ Return the physical line with a specified line number, reloading it from
+ its file if it has been discarded.  The caller is expected to hold
+ PhysicalLineMutex, and the physical line is only guaranteed to remain valid
+ while it is held unless the caller takes a reference to the line's
+ MemoryToFree.
+
+ @param MoreContext Pointer to the more context.
+
+ @param LineNumber The number of the physical line to return.  The first
+        line is one.
+
+ @return Pointer to the physical line, or NULL if the line does not exist or
+         could not be loaded.
+ */
+PMORE_PHYSICAL_LINE
+MoreGetPhysicalLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG LineNumber
+    )
+{
+    PMORE_LINE_BLOCK Block;
+
+    if (LineNumber == 0 || LineNumber > MoreContext->LineCount) {
+        return NULL;
+    }
+
+    Block = MoreFindLineBlock(MoreContext, LineNumber);
+    if (Block == NULL) {
+        return NULL;
+    }
+
+    if (Block->Lines == NULL) {
+        if (!MoreLoadLineBlock(MoreContext, Block)) {
+            return NULL;
+        }
+    } else if (!YoriLibIsListEmpty(&Block->ResidentList) &&
+               MoreContext->ResidentBlockList.Prev != &Block->ResidentList) {
+
+        MoreMarkLineBlockRecentlyUsed(MoreContext, Block);
+    }
+
+    return Block->Lines[(DWORD)(LineNumber - Block->FirstLineNumber)];
+}
+
+/**
+ Free all blocks of physical lines and the list of input files.  This is
+ called after the ingest thread has terminated.
+
+ @param MoreContext Pointer to the more context.
+ */
+VOID
+MoreFreeLineIndex(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PMORE_INPUT_FILE InputFile;
+    PMORE_LINE_BLOCK Block;
+    DWORD Index;
+
+    for (Index = 0; Index < MoreContext->LineBlockCount; Index++) {
+        Block = MoreContext->LineBlocks[Index];
+        MoreDiscardLineBlockContents(Block);
+        YoriLibFree(Block);
+    }
+
+    if (MoreContext->LineBlocks != NULL) {
+        YoriLibFree(MoreContext->LineBlocks);
+        MoreContext->LineBlocks = NULL;
+    }
+    MoreContext->LineBlockCount = 0;
+    MoreContext->LineBlocksAllocated = 0;
+    MoreContext->ResidentBlockCount = 0;
+    YoriLibInitializeListHead(&MoreContext->ResidentBlockList);
+
+    ListEntry = YoriLibGetNextListEntry(&MoreContext->InputFileList, NULL);
+    while (ListEntry != NULL) {
+        InputFile = CONTAINING_RECORD(ListEntry, MORE_INPUT_FILE, InputFileList);
+        YoriLibRemoveListItem(ListEntry);
+        if (InputFile->FileHandle != NULL) {
+            CloseHandle(InputFile->FileHandle);
+        }
+        YoriLibFree(InputFile);
+        ListEntry = YoriLibGetNextListEntry(&MoreContext->InputFileList, NULL);
+    }
+}
+
+/**
+ Record a file that lines are being read from, so that the lines can be
+ reloaded from it later.
+
+ @param MoreContext Pointer to the more context.
+
+ @param FilePath Pointer to the full path to the file.
+
+ @return Pointer to the input file, or NULL on allocation failure.
+ */
+PMORE_INPUT_FILE
+MoreAllocateInputFile(
+    __inout PMORE_CONTEXT MoreContext,
+    __in PYORI_STRING FilePath
+    )
+{
+    PMORE_INPUT_FILE InputFile;
+
+    InputFile = YoriLibMalloc(sizeof(MORE_INPUT_FILE) + (FilePath->LengthInChars + 1) * sizeof(TCHAR));
+    if (InputFile == NULL) {
+        return NULL;
+    }
+
+    InputFile->FileHandle = NULL;
+    YoriLibInitEmptyString(&InputFile->FilePath);
+    InputFile->FilePath.StartOfString = (LPTSTR)(InputFile + 1);
+    memcpy(InputFile->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+    InputFile->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+    InputFile->FilePath.LengthInChars = FilePath->LengthInChars;
+    InputFile->FilePath.LengthAllocated = FilePath->LengthInChars + 1;
+
+    YoriLibAppendList(&MoreContext->InputFileList, &InputFile->InputFileList);
+    return InputFile;
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
  the set requested by the user.
 
  @param hSource The opened source stream.
 
+ @param InputFile Optionally points to the file that the stream refers to.
+        If specified, lines are indexed by file offset so that they can be
+        discarded from memory and reloaded on demand.  If NULL, the stream
+        cannot be read again and all lines are retained in memory.
+
  @param MoreContext Pointer to context information specifying which lines to
         display.
- 
+
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 MoreProcessStream(
     __in HANDLE hSource,
+    __in_opt PMORE_INPUT_FILE InputFile,
     __in PMORE_CONTEXT MoreContext
     )
 {
     PVOID LineContext = NULL;
+    YORI_LIB_LINE_VIEW LineView;
+    YORI_LIB_LINE_ENDING LineEnding;
+    BOOL TimeoutReached;
     YORI_STRING LineString;
+    MORE_PHYSICAL_LINE_BUFFER LineBuffer;
+    PMORE_LINE_BLOCK Block;
     PMORE_PHYSICAL_LINE NewLine;
-    DWORD TabCount;
-    DWORD CharIndex;
-    DWORD DestIndex;
-    DWORD TabIndex;
-    DWORD BytesRequired;
-    PUCHAR Buffer = NULL;
-    DWORD BytesRemainingInBuffer = 0;
-    DWORD BufferOffset = 0;
-    DWORD Alignment;
+    DWORD LinesInBlock;
+    DWORD CharSize;
+    DWORDLONG LinesInStream;
+    DWORDLONG StreamOffset;
+    DWORDLONG BlockOffset;
+    DWORD FileType;
+    DWORD LastPublishTime;
     WORD PreviousColor;
 
     YoriLibInitEmptyString(&LineString);
+    ZeroMemory(&LineBuffer, sizeof(LineBuffer));
+    Block = NULL;
+    LinesInBlock = 0;
+    LinesInStream = 0;
+    StreamOffset = 0;
 
     MoreContext->FilesFound++;
     PreviousColor = MoreContext->InitialColor;
+    FileType = GetFileType(hSource);
+    LastPublishTime = GetTickCount();
 
-    while (TRUE) {
+    //
+    //  Any byte order mark is skipped when reading the first line and is
+    //  not included in the line, so check for one here in order to know the
+    //  file offset of later lines.
+    //
 
-        if (!YoriLibReadLineToString(&LineString, &LineContext, hSource)) {
-            break;
-        }
+    if (InputFile != NULL) {
+        CHAR BomBuffer[4];
+        DWORD BytesRead;
 
-        //
-        //  Count the number of tabs.  These are replaced at ingestion time, 
-        //  since the width can't change while the program is running and to
-        //  save the complexity of accounting for carryover spaces due to tab
-        //  expansion at end of logical line
-        //
-
-        TabCount = 0;
-        for (CharIndex = 0; CharIndex < LineString.LengthInChars; CharIndex++) {
-            if (LineString.StartOfString[CharIndex] == '\t') {
-                TabCount++;
-            }
+        if (ReadFile(hSource, BomBuffer, sizeof(BomBuffer), &BytesRead, NULL)) {
+            StreamOffset = YoriLibBytesInBom(BomBuffer, BytesRead);
         }
+        SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
+    }
 
-        //
-        //  We need space for the structure, all characters in the source, a NULL,
-        //  and since tabs will be replaced with spaces the number of spaces per
-        //  tab minus one (for the tab character being removed.)
-        //
-
-        BytesRequired = sizeof(MORE_PHYSICAL_LINE) + (LineString.LengthInChars + TabCount * (MoreContext->TabWidth - 1) + 1) * sizeof(TCHAR);
+    while (TRUE) {
 
         //
-        //  If we need a buffer, allocate a buffer that typically has space for
-        //  multiple lines
+        //  Lines from a pipe are published before any read that may need
+        //  to wait for the source, so a complete line is never held back
+        //  behind one that has only partially arrived.
         //
 
-        if (Buffer == NULL || BytesRequired > BytesRemainingInBuffer) {
-            if (Buffer != NULL) {
-                YoriLibDereference(Buffer);
-            }
-            BytesRemainingInBuffer = 64 * 1024;
-            if (BytesRequired > BytesRemainingInBuffer) {
-                BytesRemainingInBuffer = BytesRequired;
-            }
-            BufferOffset = 0;
+        if (InputFile == NULL &&
+            Block != NULL &&
+            Block->LineCount < LinesInBlock &&
+            !YoriLibLineReadIsLineBuffered(LineContext)) {
 
-            Buffer = YoriLibReferencedMalloc(BytesRemainingInBuffer);
-            if (Buffer == NULL) {
-                MoreContext->OutOfMemory = TRUE;
-                break;
-            }
+            MorePublishLineBlock(MoreContext, Block, LinesInBlock, FALSE);
+            LastPublishTime = GetTickCount();
         }
 
-        //
-        //  Write this line into the current buffer
-        //
+        if (!YoriLibReadLineToViewEx(&LineView, &LineContext, TRUE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
+            break;
+        }
 
-        NewLine = (PMORE_PHYSICAL_LINE)YoriLibAddToPointer(Buffer, BufferOffset);
+        if (!YoriLibLineViewToString(&LineView, &LineString)) {
+            MoreContext->OutOfMemory = TRUE;
+            break;
+        }
 
-        YoriLibReference(Buffer);
-        NewLine->MemoryToFree = Buffer;
-        NewLine->InitialColor = PreviousColor;
-        NewLine->LineNumber = MoreContext->LineCount + 1;
-        YoriLibReference(Buffer);
-        NewLine->LineContents.MemoryToFree = Buffer;
-        NewLine->LineContents.StartOfString = (LPTSTR)(NewLine + 1);
+        if (Block == NULL) {
 
-        for (CharIndex = 0, DestIndex = 0; CharIndex < LineString.LengthInChars; CharIndex++) {
             //
-            //  If the string is <ESC>[, then treat it as an escape sequence.
-            //  Look for the final letter after any numbers or semicolon.
+            //  The first block of a file starts at offset zero so that
+            //  reloading it skips any byte order mark in the same way as
+            //  the original read.
             //
-    
-            if (LineString.LengthInChars > CharIndex + 2 &&
-                LineString.StartOfString[CharIndex] == 27 &&
-                LineString.StartOfString[CharIndex + 1] == '[') {
-    
-                YORI_STRING EscapeSubset;
-                DWORD EndOfEscape;
-    
-                YoriLibInitEmptyString(&EscapeSubset);
-                EscapeSubset.StartOfString = &LineString.StartOfString[CharIndex + 2];
-                EscapeSubset.LengthInChars = LineString.LengthInChars - CharIndex - 2;
-                EndOfEscape = YoriLibCountStringContainingChars(&EscapeSubset, _T("0123456789;"));
-    
-                //
-                //  Count everything as consuming the source and needing buffer
-                //  space in the destination but consuming no display cells.  This
-                //  may include the final letter, if we found one.
-                //
-    
-                if (LineString.LengthInChars > CharIndex + 2 + EndOfEscape) {
-                    EscapeSubset.StartOfString -= 2;
-                    EscapeSubset.LengthInChars = EndOfEscape + 3;
-                    YoriLibVtFinalColorFromSequence(PreviousColor, &EscapeSubset, &PreviousColor);
-                }
+
+            BlockOffset = StreamOffset;
+            if (LinesInStream == 0) {
+                BlockOffset = 0;
             }
-            if (LineString.StartOfString[CharIndex] == '\t') {
-                for (TabIndex = 0; TabIndex < MoreContext->TabWidth; TabIndex++) {
-                    NewLine->LineContents.StartOfString[DestIndex] = ' ';
-                    DestIndex++;
-                }
-            } else {
-                NewLine->LineContents.StartOfString[DestIndex] = LineString.StartOfString[CharIndex];
-                DestIndex++;
+
+            Block = MoreAllocateLineBlock(MoreContext, InputFile, BlockOffset, PreviousColor);
+            if (Block == NULL) {
+                MoreContext->OutOfMemory = TRUE;
+                break;
             }
+            LinesInBlock = 0;
         }
-        NewLine->LineContents.StartOfString[DestIndex] = '\0';
-        NewLine->LineContents.LengthInChars = DestIndex;
-        NewLine->LineContents.LengthAllocated = DestIndex + 1;
 
-        BufferOffset += BytesRequired;
-        BytesRemainingInBuffer -= BytesRequired;
+        NewLine = MoreAllocatePhysicalLine(MoreContext, &LineBuffer, &LineString, Block->FirstLineNumber + LinesInBlock, &PreviousColor);
+        if (NewLine == NULL) {
+            MoreContext->OutOfMemory = TRUE;
+            break;
+        }
+
+        Block->Lines[LinesInBlock] = NewLine;
+        LinesInBlock++;
+        LinesInStream++;
 
         //
-        //  Align the buffer to 8 bytes.  There's no length checking because
-        //  the allocation is assumed to be aligned to 8 bytes.
+        //  The view doesn't include the line ending, so add it back to find
+        //  the offset of the next line.
         //
 
-        Alignment = BufferOffset % 8;
-        if (Alignment > 0) {
-            Alignment = 8 - Alignment;
-            BufferOffset += Alignment;
-            BytesRemainingInBuffer -= Alignment;
+        CharSize = sizeof(CHAR);
+        if (LineView.WideChars) {
+            CharSize = sizeof(WCHAR);
+        }
+        StreamOffset += LineView.LengthInChars * CharSize;
+        if (LineEnding == YoriLibLineEndingCRLF) {
+            StreamOffset += 2 * CharSize;
+        } else if (LineEnding != YoriLibLineEndingNone) {
+            StreamOffset += CharSize;
         }
 
         //
-        //  Insert the new line into the list
+        //  Lines from a file are published to the viewport a block at a
+        //  time, since they arrive as fast as they can be read.  Each file
+        //  block gets its own buffer so that discarding the block releases
+        //  its memory.
+        //
+        //  Lines from a pipe are published before reading more from the
+        //  pipe, since the source may be slow to produce more, or
+        //  periodically if the source is producing data faster than it can
+        //  be ingested.  This avoids acquiring the mutex and waking the
+        //  viewport for each line.  A console or other source that can't be
+        //  inspected is published line by line.
         //
 
-        WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
-        MoreContext->LineCount++;
-        YoriLibAppendList(&MoreContext->PhysicalLineList, &NewLine->LineList);
-        ReleaseMutex(MoreContext->PhysicalLineMutex);
-
-        SetEvent(MoreContext->PhysicalLineAvailableEvent);
+        if (LinesInBlock == MORE_LINES_PER_BLOCK) {
+            MorePublishLineBlock(MoreContext, Block, LinesInBlock, TRUE);
+            MoreReleasePhysicalLineBuffer(&LineBuffer);
+            Block = NULL;
+            LastPublishTime = GetTickCount();
+        } else if (InputFile == NULL) {
+            if (FileType != FILE_TYPE_PIPE ||
+                GetTickCount() - LastPublishTime >= MORE_PUBLISH_INTERVAL) {
+
+                MorePublishLineBlock(MoreContext, Block, LinesInBlock, FALSE);
+                LastPublishTime = GetTickCount();
+            }
+        }
 
         if (WaitForSingleObject(MoreContext->ShutdownEvent, 0) == WAIT_OBJECT_0) {
             break;
         }
     }
 
-    if (Buffer != NULL) {
-        YoriLibDereference(Buffer);
+    if (Block != NULL) {
+        MorePublishLineBlock(MoreContext, Block, LinesInBlock, TRUE);
     }
 
+    MoreReleasePhysicalLineBuffer(&LineBuffer);
     YoriLibLineReadClose(LineContext);
     YoriLibFreeStringContents(&LineString);
 
@@ -235,6 +880,7 @@ MoreFileFoundCallback(
     )
 {
     HANDLE FileHandle;
+    PMORE_INPUT_FILE InputFile;
     PMORE_CONTEXT MoreContext = (PMORE_CONTEXT)Context;
 
     UNREFERENCED_PARAMETER(Depth);
@@ -262,7 +908,17 @@ MoreFileFoundCallback(
             return TRUE;
         }
 
-        MoreProcessStream(FileHandle, MoreContext);
+        //
+        //  Only files on disk can be reread, so anything else is retained
+        //  in memory.
+        //
+
+        InputFile = NULL;
+        if (GetFileType(FileHandle) == FILE_TYPE_DISK) {
+            InputFile = MoreAllocateInputFile(MoreContext, FilePath);
+        }
+
+        MoreProcessStream(FileHandle, InputFile, MoreContext);
 
         CloseHandle(FileHandle);
     }
@@ -302,7 +958,7 @@ MoreIngestThread(
             return 0;
         }
 
-        MoreProcessStream(GetStdHandle(STD_INPUT_HANDLE), MoreContext);
+        MoreProcessStream(GetStdHandle(STD_INPUT_HANDLE), NULL, MoreContext);
     } else {
         MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS;
         if (MoreContext->Recursive) {
@@ -318,6 +974,8 @@ MoreIngestThread(
         }
     }
 
+    MoreContext->IngestEndTime = GetTickCount();
+
     if (MoreContext->FilesFound == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("more: no matching files found\n"));
         return 0;
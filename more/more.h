@@ -33,14 +33,10 @@
  */
 typedef struct _MORE_PHYSICAL_LINE {
 
-    /**
-     A list of physical lines.  Paired with MORE_CONTEXT::PhysicalLineList
-     and synchronized with MORE_CONTEXT::PhysicalLineMutex .
-     */
-    YORI_LIST_ENTRY LineList;
-
     /**
      Pointer to the referenced allocation that contains this physical line.
+     Each logical line derived from this physical line holds a reference to
+     this allocation.
      */
     PVOID MemoryToFree;
 
@@ -51,7 +47,7 @@ typedef struct _MORE_PHYSICAL_LINE {
 
     /**
      The number of this physical line within the input stream.  The first
-     line is zero.
+     line is one.
      */
     DWORDLONG LineNumber;
 
@@ -61,6 +57,128 @@ typedef struct _MORE_PHYSICAL_LINE {
     YORI_STRING LineContents;
 } MORE_PHYSICAL_LINE, *PMORE_PHYSICAL_LINE;
 
+/**
+ The number of physical lines described by each block in the line index.
+ */
+#define MORE_LINES_PER_BLOCK 1024
+
+/**
+ The maximum number of blocks of physical lines from files to keep in
+ memory.  Beyond this, the least recently used blocks are discarded and
+ reloaded from their file when they are next needed.
+ */
+#define MORE_MAXIMUM_RESIDENT_BLOCKS 64
+
+/**
+ The maximum time, in milliseconds, that lines from a pipe can be held by
+ the ingest thread before they are published to the viewport.  Lines are
+ published sooner if the pipe has no further data waiting.
+ */
+#define MORE_PUBLISH_INTERVAL 50
+
+/**
+ The minimum time, in milliseconds, between displaying newly ingested lines.
+ Notifications that arrive sooner are coalesced into a single update.
+ */
+#define MORE_REFRESH_INTERVAL 33
+
+/**
+ Information about a file being displayed, so that lines can be reloaded
+ from it after they have been discarded.
+ */
+typedef struct _MORE_INPUT_FILE {
+
+    /**
+     The list of input files.  Paired with MORE_CONTEXT::InputFileList.
+     */
+    YORI_LIST_ENTRY InputFileList;
+
+    /**
+     A handle to the file, opened when lines first need to be reloaded from
+     it.  NULL if the file has not been opened for reloading.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The full path to the file.
+     */
+    YORI_STRING FilePath;
+} MORE_INPUT_FILE, *PMORE_INPUT_FILE;
+
+/**
+ A block of up to MORE_LINES_PER_BLOCK consecutive physical lines from a
+ single input source.  The array of blocks in MORE_CONTEXT forms an index
+ that allows any physical line to be found from its line number.  Lines
+ that came from a file can be discarded and reloaded from the file offset
+ recorded here.  Lines that came from a pipe cannot be read again, so they
+ are never discarded.
+ */
+typedef struct _MORE_LINE_BLOCK {
+
+    /**
+     The list of blocks which are in memory and can be discarded, in least
+     recently used order.  Paired with MORE_CONTEXT::ResidentBlockList.  If
+     the block is not in the list, this entry points to itself.
+     */
+    YORI_LIST_ENTRY ResidentList;
+
+    /**
+     The file containing the lines in this block, or NULL if the lines came
+     from a source that cannot be read again.
+     */
+    PMORE_INPUT_FILE InputFile;
+
+    /**
+     The offset within InputFile of the first line in this block.
+     */
+    LARGE_INTEGER FileOffset;
+
+    /**
+     The number of the first physical line in this block.
+     */
+    DWORDLONG FirstLineNumber;
+
+    /**
+     The number of physical lines in this block which are visible to the
+     viewport.
+     */
+    DWORD LineCount;
+
+    /**
+     The color attribute at the beginning of the first line in this block.
+     */
+    WORD InitialColor;
+
+    /**
+     An array of pointers to the physical lines in this block, or NULL if
+     the lines have been discarded.
+     */
+    PMORE_PHYSICAL_LINE * Lines;
+} MORE_LINE_BLOCK, *PMORE_LINE_BLOCK;
+
+/**
+ A buffer that physical lines are carved from, so that many lines can share
+ a single referenced allocation.
+ */
+typedef struct _MORE_PHYSICAL_LINE_BUFFER {
+
+    /**
+     Pointer to the referenced allocation that new lines are carved from,
+     or NULL if no allocation has been made yet.
+     */
+    PUCHAR Buffer;
+
+    /**
+     The number of bytes in Buffer which have not been used yet.
+     */
+    DWORD BytesRemainingInBuffer;
+
+    /**
+     The offset within Buffer of the next line to allocate.
+     */
+    DWORD BufferOffset;
+} MORE_PHYSICAL_LINE_BUFFER, *PMORE_PHYSICAL_LINE_BUFFER;
+
 /**
  A logical line, meaning a line rendered for display on the console.
  */
@@ -121,19 +239,46 @@ typedef struct _MORE_LOGICAL_LINE {
 typedef struct _MORE_CONTEXT {
 
     /**
-     A linked list of physical lines.
+     An array of pointers to blocks of physical lines, in line number order.
+     */
+    PMORE_LINE_BLOCK * LineBlocks;
+
+    /**
+     The number of elements in LineBlocks which are populated.
+     */
+    DWORD LineBlockCount;
+
+    /**
+     The number of elements allocated in LineBlocks.
+     */
+    DWORD LineBlocksAllocated;
+
+    /**
+     The number of blocks in ResidentBlockList.
      */
-    YORI_LIST_ENTRY PhysicalLineList;
+    DWORD ResidentBlockCount;
 
     /**
-     Synchronization around PhysicalLineList.
+     A list of blocks whose lines are in memory and could be discarded, in
+     least recently used order.
+     */
+    YORI_LIST_ENTRY ResidentBlockList;
+
+    /**
+     A list of files that lines have been read from.  This is only modified
+     by the ingest thread and is torn down after it terminates.
+     */
+    YORI_LIST_ENTRY InputFileList;
+
+    /**
+     Synchronization around LineBlocks, ResidentBlockList and the lines
+     within each block.
      */
     HANDLE PhysicalLineMutex;
 
     /**
-     An event that is signalled when new lines are added to the
-     PhysicalLineList in case the viewport thread wants to update display
-     when lines are added.
+     An event that is signalled when new lines are added to LineBlocks in
+     case the viewport thread wants to update display when lines are added.
      */
     HANDLE PhysicalLineAvailableEvent;
 
@@ -163,14 +308,13 @@ typedef struct _MORE_CONTEXT {
 
     /**
      An array of size ViewportHeight of lines currently displayed.  Note these
-     refer to the strings in the PhysicalLineList.
+     refer to the strings in physical lines.
      */
     PMORE_LOGICAL_LINE DisplayViewportLines;
 
     /**
      An array of size ViewportHeight of lines that are being constructed to
-     display in future.  Note these refer to the strings in the
-     PhysicalLineList.
+     display in future.  Note these refer to the strings in physical lines.
      */
     PMORE_LOGICAL_LINE StagingViewportLines;
 
@@ -281,10 +425,29 @@ typedef struct _MORE_CONTEXT {
     DWORDLONG FilesFound;
 
     /**
-     Records the total number of lines processed.
+     Records the total number of lines processed.  This is synchronized with
+     PhysicalLineMutex.
      */
     DWORDLONG LineCount;
 
+    /**
+     The number of times the ingest thread has published new lines to the
+     viewport.  This is synchronized with PhysicalLineMutex.
+     */
+    DWORD PublishCount;
+
+    /**
+     The tick count when the ingest thread was started.
+     */
+    DWORD IngestStartTime;
+
+    /**
+     The tick count when the ingest thread completed, used to report
+     ingestion throughput in the debug display once the ingest thread has
+     terminated.
+     */
+    DWORD IngestEndTime;
+
 } MORE_CONTEXT, *PMORE_CONTEXT;
 
 VOID
@@ -324,11 +487,27 @@ MoreGracefulExit(
     __inout PMORE_CONTEXT MoreContext
     );
 
+PMORE_PHYSICAL_LINE
+MoreGetPhysicalLine(
+    __inout PMORE_CONTEXT MoreContext,
+    __in DWORDLONG LineNumber
+    );
+
+VOID
+MoreFreeLineIndex(
+    __inout PMORE_CONTEXT MoreContext
+    );
+
 DWORD WINAPI
 MoreIngestThread(
     __in LPVOID Context
     );
 
+VOID
+MoreFreeLogicalLine(
+    __inout PMORE_LOGICAL_LINE LogicalLine
+    );
+
 BOOL
 MoreViewportDisplay(
     __inout PMORE_CONTEXT MoreContext
@@ -150,7 +150,8 @@ MoreInitContext(
     MoreContext->SuspendPagination = SuspendPagination;
     MoreContext->TabWidth = 4;
 
-    YoriLibInitializeListHead(&MoreContext->PhysicalLineList);
+    YoriLibInitializeListHead(&MoreContext->ResidentBlockList);
+    YoriLibInitializeListHead(&MoreContext->InputFileList);
     MoreContext->PhysicalLineMutex = CreateMutex(NULL, FALSE, NULL);
     if (MoreContext->PhysicalLineMutex == NULL) {
         return FALSE;
@@ -189,6 +190,7 @@ MoreInitContext(
     MoreContext->InputSourceCount = ArgCount;
     MoreContext->InputSources = ArgStrings;
 
+    MoreContext->IngestStartTime = GetTickCount();
     MoreContext->IngestThread = CreateThread(NULL, 0, MoreIngestThread, MoreContext, 0, &ThreadId);
     if (MoreContext->IngestThread == NULL) {
         return FALSE;
@@ -253,23 +255,14 @@ MoreGracefulExit(
     __inout PMORE_CONTEXT MoreContext
     )
 {
-    PYORI_LIST_ENTRY ListEntry;
-    PMORE_PHYSICAL_LINE PhysicalLine;
     DWORD Index;
 
     SetEvent(MoreContext->ShutdownEvent);
     WaitForSingleObject(MoreContext->IngestThread, INFINITE);
     for (Index = 0; Index < MoreContext->ViewportHeight; Index++) {
-        YoriLibFreeStringContents(&MoreContext->DisplayViewportLines[Index].Line);
-    }
-    ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, NULL);
-    while (ListEntry != NULL) {
-        PhysicalLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
-        YoriLibRemoveListItem(ListEntry);
-        YoriLibFreeStringContents(&PhysicalLine->LineContents);
-        YoriLibDereference(PhysicalLine->MemoryToFree);
-        ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, NULL);
+        MoreFreeLogicalLine(&MoreContext->DisplayViewportLines[Index]);
     }
+    MoreFreeLineIndex(MoreContext);
 
     MoreCleanupContext(MoreContext);
 }
@@ -313,6 +313,24 @@ MoreCountLogicalLinesOnPhysicalLine(
     return Count;
 }
 
+/**
+ Free a logical line, releasing its string and its reference to the physical
+ line it was derived from.
+
+ @param LogicalLine Pointer to the logical line to free.
+ */
+VOID
+MoreFreeLogicalLine(
+    __inout PMORE_LOGICAL_LINE LogicalLine
+    )
+{
+    YoriLibFreeStringContents(&LogicalLine->Line);
+    if (LogicalLine->PhysicalLine != NULL) {
+        YoriLibDereference(LogicalLine->PhysicalLine->MemoryToFree);
+        LogicalLine->PhysicalLine = NULL;
+    }
+}
+
 /**
  Move a logical line from one memory location to another.  Logical lines
  are referenced, so the move implies dereferencing anything being overwritten,
@@ -330,9 +348,7 @@ MoreMoveLogicalLine(
     )
 {
     ASSERT(Dest != Src);
-    if (Dest->Line.MemoryToFree != NULL) {
-        YoriLibFreeStringContents(&Dest->Line);
-    }
+    MoreFreeLogicalLine(Dest);
     memcpy(Dest, Src, sizeof(MORE_LOGICAL_LINE));
     ZeroMemory(Src, sizeof(MORE_LOGICAL_LINE));
 }
@@ -353,13 +369,14 @@ MoreCloneLogicalLine(
     )
 {
     ASSERT(Dest != Src);
-    if (Dest->Line.MemoryToFree != NULL) {
-        YoriLibFreeStringContents(&Dest->Line);
-    }
+    MoreFreeLogicalLine(Dest);
     memcpy(Dest, Src, sizeof(MORE_LOGICAL_LINE));
     if (Dest->Line.MemoryToFree != NULL) {
         YoriLibReference(Dest->Line.MemoryToFree);
     }
+    if (Dest->PhysicalLine != NULL) {
+        YoriLibReference(Dest->PhysicalLine->MemoryToFree);
+    }
 }
 
 /**
@@ -581,6 +598,7 @@ MoreGenerateLogicalLinesFromPhysicalLine(
         LogicalLineLength = MoreGetLogicalLineLength(MoreContext, &Subset, MoreContext->ViewportWidth, InitialDisplayColor, InitialUserColor, CharactersRemainingInMatch, &LineEndContext);
         if (Count >= FirstLogicalLineIndex) {
             ThisLine = &OutputLines[Count - FirstLogicalLineIndex];
+            YoriLibReference(PhysicalLine->MemoryToFree);
             ThisLine->PhysicalLine = PhysicalLine;
             ThisLine->InitialUserColor = InitialUserColor;
             ThisLine->InitialDisplayColor = InitialDisplayColor;
@@ -693,15 +711,13 @@ MoreGetPreviousLogicalLines(
 
     while(Result && LinesRemaining > 0) {
         PMORE_PHYSICAL_LINE PreviousPhysicalLine;
-        PYORI_LIST_ENTRY ListEntry;
         DWORD LogicalLineCount;
 
-        ListEntry = YoriLibGetPreviousListEntry(&MoreContext->PhysicalLineList, &CurrentInputLine->PhysicalLine->LineList);
-        if (ListEntry == NULL) {
+        PreviousPhysicalLine = MoreGetPhysicalLine(MoreContext, CurrentInputLine->PhysicalLine->LineNumber - 1);
+        if (PreviousPhysicalLine == NULL) {
             break;
         }
 
-        PreviousPhysicalLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
         LogicalLineCount = MoreCountLogicalLinesOnPhysicalLine(MoreContext, PreviousPhysicalLine);
 
         if (LogicalLineCount > LinesRemaining) {
@@ -730,7 +746,7 @@ MoreGetPreviousLogicalLines(
         *NumberLinesGenerated = LinesToOutput - LinesRemaining;
     } else {
         for (LinesRemaining = 0; LinesRemaining < LinesToOutput; LinesRemaining++) {
-            YoriLibFreeStringContents(&OutputLines[LinesRemaining].Line);
+            MoreFreeLogicalLine(&OutputLines[LinesRemaining]);
         }
     }
     return Result;
@@ -823,20 +839,18 @@ MoreGetNextLogicalLines(
 
     while(Result && LinesRemaining > 0) {
         PMORE_PHYSICAL_LINE NextPhysicalLine;
-        PYORI_LIST_ENTRY ListEntry;
 
         if (CurrentInputLine != NULL) {
             ASSERT(CurrentInputLine->PhysicalLine != NULL);
-            ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, &CurrentInputLine->PhysicalLine->LineList);
+            NextPhysicalLine = MoreGetPhysicalLine(MoreContext, CurrentInputLine->PhysicalLine->LineNumber + 1);
         } else {
-            ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, NULL);
+            NextPhysicalLine = MoreGetPhysicalLine(MoreContext, 1);
         }
-        if (ListEntry == NULL) {
+        if (NextPhysicalLine == NULL) {
 
             break;
         }
 
-        NextPhysicalLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
         LogicalLineCount = MoreCountLogicalLinesOnPhysicalLine(MoreContext, NextPhysicalLine);
 
         LineIndexToCopy = 0;
@@ -860,7 +874,7 @@ MoreGetNextLogicalLines(
         *NumberLinesGenerated = LinesToOutput - LinesRemaining;
     } else {
         for (LinesRemaining = 0; LinesRemaining < LinesToOutput; LinesRemaining++) {
-            YoriLibFreeStringContents(&OutputLines[LinesRemaining].Line);
+            MoreFreeLogicalLine(&OutputLines[LinesRemaining]);
         }
     }
 
@@ -877,40 +891,38 @@ MoreGetNextLogicalLines(
  @param PreviousMatchLine Pointer to the logical line which is the most
         recent line to not look for matches within.
 
- @return Pointer to the next physical line containing a match, or NULL
-         if no further physical lines contain a match.
+ @return The line number of the next physical line containing a match, or
+         zero if no further physical lines contain a match.
  */
-PMORE_PHYSICAL_LINE
+DWORDLONG
 MoreFindNextLineWithSearchMatch(
     __in PMORE_CONTEXT MoreContext,
     __in_opt PMORE_LOGICAL_LINE PreviousMatchLine
     )
 {
     PMORE_PHYSICAL_LINE SearchLine;
-    PYORI_LIST_ENTRY ListEntry;
+    DWORDLONG LineNumber;
     DWORD MatchOffset;
 
     if (PreviousMatchLine == NULL) {
-        SearchLine = NULL;
-        ListEntry = NULL;
+        LineNumber = 0;
     } else {
-        SearchLine = PreviousMatchLine->PhysicalLine;
-        ListEntry = &SearchLine->LineList;
+        LineNumber = PreviousMatchLine->PhysicalLine->LineNumber;
     }
 
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
 
     while (TRUE) {
-        ListEntry = YoriLibGetNextListEntry(&MoreContext->PhysicalLineList, ListEntry);
-        if (ListEntry == NULL) {
+        LineNumber++;
+        SearchLine = MoreGetPhysicalLine(MoreContext, LineNumber);
+        if (SearchLine == NULL) {
             ReleaseMutex(MoreContext->PhysicalLineMutex);
-            return NULL;
+            return 0;
         }
 
-        SearchLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
         if (YoriLibFindFirstMatchingSubstringInsensitive(&SearchLine->LineContents, 1, &MoreContext->SearchString, &MatchOffset)) {
             ReleaseMutex(MoreContext->PhysicalLineMutex);
-            return SearchLine;
+            return LineNumber;
         }
     }
 }
@@ -964,12 +976,13 @@ MoreDrawStatusLine(
     DWORDLONG FirstViewportLine;
     DWORDLONG LastViewportLine;
     DWORDLONG TotalLines;
-    PYORI_LIST_ENTRY ListEntry;
-    PMORE_PHYSICAL_LINE LastPhysicalLine;
     BOOL PageFull;
     BOOL ThreadActive;
     LPTSTR StringToDisplay;
     YORI_STRING LineToDisplay;
+    YORI_STRING DebugStatus;
+    DWORD PublishCount;
+    DWORD IngestTime;
 
     //
     //  If the screen isn't full, there's no point displaying status
@@ -986,10 +999,9 @@ MoreDrawStatusLine(
     LastViewportLine = MoreContext->DisplayViewportLines[MoreContext->LinesInViewport - 1].PhysicalLine->LineNumber;
 
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
-    ListEntry = YoriLibGetPreviousListEntry(&MoreContext->PhysicalLineList, NULL);
-    LastPhysicalLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
-    TotalLines = LastPhysicalLine->LineNumber;
+    TotalLines = MoreContext->LineCount;
     MoreContext->TotalLinesInViewportStatus = TotalLines;
+    PublishCount = MoreContext->PublishCount;
     ReleaseMutex(MoreContext->PhysicalLineMutex);
 
     ASSERT(MoreContext->LinesInPage <= MoreContext->LinesInViewport);
@@ -1013,25 +1025,49 @@ MoreDrawStatusLine(
         StringToDisplay = _T("More");
     }
 
+    //
+    //  The debug display includes the rate that lines are being ingested
+    //  and the number of times they have been published to the viewport.
+    //
+
+    YoriLibInitEmptyString(&DebugStatus);
+    if (MoreContext->DebugDisplay) {
+        if (ThreadActive) {
+            IngestTime = GetTickCount() - MoreContext->IngestStartTime;
+        } else {
+            IngestTime = MoreContext->IngestEndTime - MoreContext->IngestStartTime;
+        }
+        if (IngestTime == 0) {
+            IngestTime = 1;
+        }
+        YoriLibYPrintf(&DebugStatus,
+                      _T(" [%lli lines/s, %i updates]"),
+                      TotalLines * 1000 / IngestTime,
+                      PublishCount);
+    }
+
     YoriLibInitEmptyString(&LineToDisplay);
     if (MoreContext->SearchString.LengthInChars > 0 || MoreContext->SearchMode) {
         YoriLibYPrintf(&LineToDisplay,
-                      _T(" --- %s --- (%lli-%lli of %lli, %i%%) Search: %y"),
+                      _T(" --- %s --- (%lli-%lli of %lli, %i%%)%y Search: %y"),
                       StringToDisplay,
                       FirstViewportLine,
                       LastViewportLine,
                       TotalLines,
                       (DWORD)(LastViewportLine * 100 / TotalLines),
+                      &DebugStatus,
                       &MoreContext->SearchString);
     } else {
         YoriLibYPrintf(&LineToDisplay,
-                      _T(" --- %s --- (%lli-%lli of %lli, %i%%)"),
+                      _T(" --- %s --- (%lli-%lli of %lli, %i%%)%y"),
                       StringToDisplay,
                       FirstViewportLine,
                       LastViewportLine,
                       TotalLines,
-                      (DWORD)(LastViewportLine * 100 / TotalLines));
+                      (DWORD)(LastViewportLine * 100 / TotalLines),
+                      &DebugStatus);
     }
+    YoriLibFreeStringContents(&DebugStatus);
 
     //
     //  If the status line would be more than a line, truncate it.  Add three
@@ -1218,6 +1254,7 @@ MoreDisplayChangedLinesInViewport(
     StdOutHandle = GetStdHandle(STD_OUTPUT_HANDLE);
     GetConsoleScreenBufferInfo(StdOutHandle, &ScreenInfo);
 
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
     if (!MoreGetNextLogicalLines(MoreContext,
                                  &MoreContext->DisplayViewportLines[0],
                                  FALSE,
@@ -1225,8 +1262,10 @@ MoreDisplayChangedLinesInViewport(
                                  MoreContext->StagingViewportLines,
                                  &NumberWritten)) {
 
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
         return 0;
     }
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
 
     //
     //  The data shouldn't already be in the viewport if it's unavailable.
@@ -1262,7 +1301,7 @@ MoreDisplayChangedLinesInViewport(
     }
 
     for (Index = 0; Index < MoreContext->LinesInViewport; Index++) {
-        YoriLibFreeStringContents(&MoreContext->StagingViewportLines[Index].Line);
+        MoreFreeLogicalLine(&MoreContext->StagingViewportLines[Index]);
     }
 
     //
@@ -1634,13 +1673,14 @@ MoreMoveViewportDown(
 
  @param MoreContext Pointer to the context describing the data to display.
 
- @param FirstPhysicalLine Pointer to the first physical line to display on
-        the first line of the regenerated display.
+ @param FirstLineNumber The number of the first physical line to display on
+        the first line of the regenerated display.  If zero, the display
+        starts from the first physical line.
  */
 VOID
 MoreRegenerateViewport(
     __inout PMORE_CONTEXT MoreContext,
-    __in_opt PMORE_PHYSICAL_LINE FirstPhysicalLine
+    __in DWORDLONG FirstLineNumber
     )
 {
     DWORD LinesReturned;
@@ -1649,14 +1689,25 @@ MoreRegenerateViewport(
     MORE_LOGICAL_LINE CurrentLogicalLine;
     MORE_LOGICAL_LINE PreviousLogicalLine;
     PMORE_LOGICAL_LINE LineToFollow;
+    PMORE_PHYSICAL_LINE FirstPhysicalLine;
 
     ZeroMemory(&CurrentLogicalLine, sizeof(CurrentLogicalLine));
     ZeroMemory(&PreviousLogicalLine, sizeof(PreviousLogicalLine));
-    CurrentLogicalLine.PhysicalLine = FirstPhysicalLine;
     CappedLinesToMove = MoreContext->ViewportHeight;
 
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
 
+    //
+    //  The current logical line is only used to find its predecessor, so it
+    //  doesn't hold a reference to the physical line.
+    //
+
+    FirstPhysicalLine = NULL;
+    if (FirstLineNumber != 0) {
+        FirstPhysicalLine = MoreGetPhysicalLine(MoreContext, FirstLineNumber);
+    }
+    CurrentLogicalLine.PhysicalLine = FirstPhysicalLine;
+
     LineToFollow = NULL;
     if (FirstPhysicalLine != NULL) {
         if (MoreGetPreviousLogicalLines(MoreContext, &CurrentLogicalLine, 1, &PreviousLogicalLine, &LinesReturned) && LinesReturned > 0) {
@@ -1667,7 +1718,7 @@ MoreRegenerateViewport(
     Success = MoreGetNextLogicalLines(MoreContext, LineToFollow, TRUE, CappedLinesToMove, MoreContext->StagingViewportLines, &LinesReturned);
 
     if (LineToFollow != NULL) {
-        YoriLibFreeStringContents(&LineToFollow->Line);
+        MoreFreeLogicalLine(LineToFollow);
     }
 
     ASSERT(LinesReturned <= CappedLinesToMove);
@@ -1694,7 +1745,7 @@ MoreMoveViewportToNextSearchMatch(
     __inout PMORE_CONTEXT MoreContext
     )
 {
-    PMORE_PHYSICAL_LINE NextMatch;
+    DWORDLONG NextMatch;
     PMORE_LOGICAL_LINE LineToFollow;
 
     LineToFollow = NULL;
@@ -1703,7 +1754,7 @@ MoreMoveViewportToNextSearchMatch(
     }
 
     NextMatch = MoreFindNextLineWithSearchMatch(MoreContext, LineToFollow);
-    if (NextMatch == NULL) {
+    if (NextMatch == 0) {
         return;
     }
 
@@ -1890,11 +1941,14 @@ MoreCopySelectionIfPresent(
         //  line.
         //
 
+        WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
         if (!MoreGetNextLogicalLines(MoreContext, StartLine, TRUE, Selection->CurrentlySelected.Bottom - Selection->CurrentlySelected.Top, &EntireLogicalLines[1], &LineCount)) {
-            YoriLibFreeStringContents(&EntireLogicalLines[0].Line);
+            ReleaseMutex(MoreContext->PhysicalLineMutex);
+            MoreFreeLogicalLine(&EntireLogicalLines[0]);
             YoriLibFree(EntireLogicalLines);
             return FALSE;
         }
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
         LineCount++;
         StartingLineIndex = 0;
 
@@ -1914,11 +1968,14 @@ MoreCopySelectionIfPresent(
         //  line.
         //
 
+        WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
         if (!MoreGetPreviousLogicalLines(MoreContext, StartLine, Selection->CurrentlySelected.Bottom - Selection->CurrentlySelected.Top, EntireLogicalLines, &LineCount)) {
-            YoriLibFreeStringContents(&EntireLogicalLines[Selection->CurrentlySelected.Bottom - Selection->CurrentlySelected.Top].Line);
+            ReleaseMutex(MoreContext->PhysicalLineMutex);
+            MoreFreeLogicalLine(&EntireLogicalLines[Selection->CurrentlySelected.Bottom - Selection->CurrentlySelected.Top]);
             YoriLibFree(EntireLogicalLines);
             return FALSE;
         }
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
         StartingLineIndex = Selection->CurrentlySelected.Bottom - Selection->CurrentlySelected.Top - LineCount;
         LineCount++;
     } else {
@@ -2046,7 +2103,7 @@ MoreCopySelectionIfPresent(
 
 Exit:
     for (LineIndex = StartingLineIndex; LineIndex < StartingLineIndex + LineCount; LineIndex++) {
-        YoriLibFreeStringContents(&EntireLogicalLines[LineIndex].Line);
+        MoreFreeLogicalLine(&EntireLogicalLines[LineIndex]);
     }
     YoriLibFree(EntireLogicalLines);
     YoriLibFreeStringContents(&HtmlText);
@@ -2072,8 +2129,6 @@ MoreAreMoreLinesAvailable(
 {
     DWORDLONG LastViewportLineNumber;
     DWORDLONG LastPhysicalLineNumber;
-    PYORI_LIST_ENTRY ListEntry;
-    PMORE_PHYSICAL_LINE LastPhysicalLine;
     PMORE_LOGICAL_LINE LastViewportLine;
 
     //
@@ -2106,9 +2161,7 @@ MoreAreMoreLinesAvailable(
     LastViewportLineNumber = LastViewportLine->PhysicalLine->LineNumber;
 
     WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
-    ListEntry = YoriLibGetPreviousListEntry(&MoreContext->PhysicalLineList, NULL);
-    LastPhysicalLine = CONTAINING_RECORD(ListEntry, MORE_PHYSICAL_LINE, LineList);
-    LastPhysicalLineNumber = LastPhysicalLine->LineNumber;
+    LastPhysicalLineNumber = MoreContext->LineCount;
     ReleaseMutex(MoreContext->PhysicalLineMutex);
 
     if (LastPhysicalLineNumber > LastViewportLineNumber) {
@@ -2118,6 +2171,107 @@ MoreAreMoreLinesAvailable(
     return FALSE;
 }
 
+/**
+ Move the viewport to display the first line of data.
+
+ @param MoreContext Pointer to the context describing the data to display.
+ */
+VOID
+MoreMoveViewportToFirstLine(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    PMORE_LOGICAL_LINE FirstLine;
+
+    if (MoreContext->LinesInViewport == 0) {
+        return;
+    }
+
+    FirstLine = &MoreContext->DisplayViewportLines[0];
+    if (FirstLine->PhysicalLine->LineNumber == 1 && FirstLine->LogicalLineIndex == 0) {
+        return;
+    }
+
+    MoreContext->LinesInPage = 0;
+    if (YoriLibIsSelectionActive(&MoreContext->Selection)) {
+        YoriLibClearSelection(&MoreContext->Selection);
+        YoriLibRedrawSelection(&MoreContext->Selection);
+    }
+
+    MoreRegenerateViewport(MoreContext, 1);
+}
+
+/**
+ Move the viewport to display the final lines of data that have been
+ ingested so far.
+
+ @param MoreContext Pointer to the context describing the data to display.
+ */
+VOID
+MoreMoveViewportToLastLine(
+    __inout PMORE_CONTEXT MoreContext
+    )
+{
+    PMORE_PHYSICAL_LINE LastPhysicalLine;
+    MORE_LOGICAL_LINE LastLogicalLine;
+    DWORD LogicalLineCount;
+    DWORD LinesReturned;
+    DWORD Index;
+    BOOL Success;
+
+    if (!MoreAreMoreLinesAvailable(MoreContext)) {
+        return;
+    }
+
+    ZeroMemory(&LastLogicalLine, sizeof(LastLogicalLine));
+    LinesReturned = 0;
+
+    WaitForSingleObject(MoreContext->PhysicalLineMutex, INFINITE);
+
+    LastPhysicalLine = MoreGetPhysicalLine(MoreContext, MoreContext->LineCount);
+    if (LastPhysicalLine == NULL) {
+        ReleaseMutex(MoreContext->PhysicalLineMutex);
+        return;
+    }
+
+    LogicalLineCount = MoreCountLogicalLinesOnPhysicalLine(MoreContext, LastPhysicalLine);
+    Success = MoreGenerateLogicalLinesFromPhysicalLine(MoreContext, LastPhysicalLine, LogicalLineCount - 1, 1, &LastLogicalLine);
+
+    if (Success && MoreContext->ViewportHeight > 1) {
+        Success = MoreGetPreviousLogicalLines(MoreContext, &LastLogicalLine, MoreContext->ViewportHeight - 1, MoreContext->StagingViewportLines, &LinesReturned);
+    }
+
+    ReleaseMutex(MoreContext->PhysicalLineMutex);
+
+    if (!Success) {
+        MoreFreeLogicalLine(&LastLogicalLine);
+        return;
+    }
+
+    //
+    //  Previous lines are returned at the end of the staging buffer, so put
+    //  the final line after them.  If all of the data fits in less than a
+    //  viewport, the existing display overlaps with it, so start again.
+    //
+
+    MoreMoveLogicalLine(&MoreContext->StagingViewportLines[MoreContext->ViewportHeight - 1], &LastLogicalLine);
+
+    if (LinesReturned + 1 < MoreContext->ViewportHeight) {
+        for (Index = 0; Index < MoreContext->LinesInViewport; Index++) {
+            MoreFreeLogicalLine(&MoreContext->DisplayViewportLines[Index]);
+        }
+        MoreContext->LinesInViewport = 0;
+    }
+
+    MoreContext->LinesInPage = 0;
+    if (YoriLibIsSelectionActive(&MoreContext->Selection)) {
+        YoriLibClearSelection(&MoreContext->Selection);
+        YoriLibRedrawSelection(&MoreContext->Selection);
+    }
+
+    MoreDisplayNewLinesInViewport(MoreContext, &MoreContext->StagingViewportLines[MoreContext->ViewportHeight - 1 - LinesReturned], LinesReturned + 1);
+}
+
 /**
  Process a key that is typically an enhanced key, including arrows, insert,
  delete, home, end, etc.  The "normal" placement of these keys is as enhanced,
@@ -2152,6 +2306,10 @@ MoreProcessEnhancedKeyDown(
         MoreMoveViewportDown(MoreContext, MoreContext->ViewportHeight);
     } else if (KeyCode == VK_PRIOR) {
         MoreMoveViewportUp(MoreContext, MoreContext->ViewportHeight);
+    } else if (KeyCode == VK_HOME) {
+        MoreMoveViewportToFirstLine(MoreContext);
+    } else if (KeyCode == VK_END) {
+        MoreMoveViewportToLastLine(MoreContext);
     }
 }
 
@@ -2303,7 +2461,7 @@ MoreProcessResizeViewport(
     HANDLE StdOutHandle;
     PMORE_LOGICAL_LINE NewDisplayViewportLines;
     PMORE_LOGICAL_LINE NewStagingViewportLines;
-    PMORE_PHYSICAL_LINE FirstPhysicalLine;
+    DWORDLONG FirstLineNumber;
     DWORD NewViewportHeight;
     DWORD NewViewportWidth;
     DWORD OldLinesInViewport;
@@ -2356,7 +2514,7 @@ MoreProcessResizeViewport(
 
             if (OldLinesInViewport > NewViewportHeight) {
                 for (Index = NewViewportHeight; Index < OldLinesInViewport; Index++) {
-                    YoriLibFreeStringContents(&OldDisplayViewportLines[Index].Line);
+                    MoreFreeLogicalLine(&OldDisplayViewportLines[Index]);
                 }
                 FillConsoleOutputCharacter(StdOutHandle, ' ', ScreenInfo.dwSize.X * (OldLinesInViewport - NewViewportHeight + 1), NewCursorPosition, &NumberWritten);
                 FillConsoleOutputAttribute(StdOutHandle, YoriLibVtGetDefaultColor(), ScreenInfo.dwSize.X * (OldLinesInViewport - NewViewportHeight + 1), NewCursorPosition, &NumberWritten);
@@ -2379,9 +2537,9 @@ MoreProcessResizeViewport(
             SetConsoleWindowInfo(GetStdHandle(STD_OUTPUT_HANDLE), TRUE, &NewWindow);
         }
     } else {
-        FirstPhysicalLine = NULL;
+        FirstLineNumber = 0;
         if (MoreContext->LinesInViewport > 0) {
-            FirstPhysicalLine = MoreContext->DisplayViewportLines[0].PhysicalLine;
+            FirstLineNumber = MoreContext->DisplayViewportLines[0].PhysicalLine->LineNumber;
         }
 
         MoreContext->LinesInPage = 0;
@@ -2391,10 +2549,10 @@ MoreProcessResizeViewport(
         MoreContext->ViewportHeight = NewViewportHeight;
         MoreContext->ViewportWidth = ScreenInfo.srWindow.Right - ScreenInfo.srWindow.Left + 1;
 
-        MoreRegenerateViewport(MoreContext, FirstPhysicalLine);
+        MoreRegenerateViewport(MoreContext, FirstLineNumber);
 
         for (Index = 0; Index < OldLinesInViewport; Index++) {
-            YoriLibFreeStringContents(&OldDisplayViewportLines[Index].Line);
+            MoreFreeLogicalLine(&OldDisplayViewportLines[Index]);
         }
     }
 
@@ -2900,8 +3058,11 @@ MoreViewportDisplay(
     DWORD PreviousMouseButtonState = 0;
     DWORD Timeout;
     DWORD InputFlags;
+    DWORD LastNewLinesTime;
+    DWORD TimeSinceNewLines;
     BOOL WaitForIngestThread = TRUE;
     BOOL WaitForNewLines = TRUE;
+    BOOL DeferNewLines;
 
     InHandle = CreateFile(_T("CONIN$"), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
     if (InHandle == INVALID_HANDLE_VALUE) {
@@ -2931,6 +3092,8 @@ MoreViewportDisplay(
 
     SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), ENABLE_PROCESSED_OUTPUT);
 
+    LastNewLinesTime = GetTickCount() - MORE_REFRESH_INTERVAL;
+
     while(TRUE) {
 
         //
@@ -2945,9 +3108,22 @@ MoreViewportDisplay(
             WaitForNewLines = TRUE;
         }
 
+        //
+        //  If new lines were displayed recently, don't wait for more until
+        //  the refresh interval has elapsed, so that a fast producer results
+        //  in one display update per interval rather than one per
+        //  notification.
+        //
+
+        DeferNewLines = FALSE;
+        TimeSinceNewLines = GetTickCount() - LastNewLinesTime;
+        if (WaitForNewLines && TimeSinceNewLines < MORE_REFRESH_INTERVAL) {
+            DeferNewLines = TRUE;
+        }
+
         HandleCountToWait = 0;
         ObjectsToWaitFor[HandleCountToWait++] = InHandle;
-        if (WaitForNewLines) {
+        if (WaitForNewLines && !DeferNewLines) {
             ObjectsToWaitFor[HandleCountToWait++] = MoreContext->PhysicalLineAvailableEvent;
         }
         if (WaitForIngestThread) {
@@ -2977,6 +3153,10 @@ MoreViewportDisplay(
             }
         }
 
+        if (DeferNewLines && Timeout > MORE_REFRESH_INTERVAL - TimeSinceNewLines) {
+            Timeout = MORE_REFRESH_INTERVAL - TimeSinceNewLines;
+        }
+
         WaitObject = WaitForMultipleObjects(HandleCountToWait, ObjectsToWaitFor, FALSE, Timeout);
 
         //
@@ -3009,6 +3189,7 @@ MoreViewportDisplay(
             if (ObjectsToWaitFor[WaitObject - WAIT_OBJECT_0] == MoreContext->PhysicalLineAvailableEvent) {
 
                 MoreAddNewLinesToViewport(MoreContext);
+                LastNewLinesTime = GetTickCount();
 
             } else if (ObjectsToWaitFor[WaitObject - WAIT_OBJECT_0] == MoreContext->IngestThread) {
 
@@ -55,6 +55,7 @@ YoriPkgUpgradeInstalledPackages(
     BOOL Result;
     BOOL UpgradeThisPackage;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -65,8 +66,15 @@ YoriPkgUpgradeInstalledPackages(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
@@ -74,11 +82,12 @@ YoriPkgUpgradeInstalledPackages(
     if (!YoriLibAllocateString(&UpgradePath, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&InstalledSection);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -97,7 +106,7 @@ YoriPkgUpgradeInstalledPackages(
             YoriLibInitEmptyString(&InstalledVersion);
         }
 
-        UpgradePath.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("UpgradePath"), _T(""), UpgradePath.StartOfString, UpgradePath.LengthAllocated, PkgIniFile.StartOfString);
+        UpgradePath.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, _T("UpgradePath"), _T(""), UpgradePath.StartOfString, UpgradePath.LengthAllocated);
         if (UpgradePath.LengthInChars > 0) {
             UpgradeThisPackage = TRUE;
             YoriLibInitEmptyString(&RedirectedPath);
@@ -149,6 +158,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&UpgradePath);
@@ -177,6 +187,7 @@ YoriPkgUpgradeSinglePackage(
     BOOL Result;
     DWORD Error;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -187,25 +198,34 @@ YoriPkgUpgradeSinglePackage(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(_T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, _T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y is not installed\n"), PackageName);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("UpgradePath"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("UpgradePath"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
 
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y does not specify an upgrade path\n"), PackageName);
@@ -232,6 +252,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&IniValue);
 
@@ -259,6 +280,7 @@ YoriPkgInstallSinglePackage(
     BOOL Result;
     DWORD Error;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -269,6 +291,12 @@ YoriPkgInstallSinglePackage(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     Result = FALSE;
     if (YoriLibIsPathUrl(PackagePath)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading %y...\n"), PackagePath);
@@ -288,6 +316,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
 
     return Result;
@@ -313,6 +342,7 @@ YoriPkgInstallSourceForInstalledPackages(
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -323,8 +353,15 @@ YoriPkgInstallSourceForInstalledPackages(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
@@ -332,11 +369,12 @@ YoriPkgInstallSourceForInstalledPackages(
     if (!YoriLibAllocateString(&SourcePath, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&InstalledSection);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -353,7 +391,7 @@ YoriPkgInstallSourceForInstalledPackages(
             PkgNameOnly.LengthInChars = LineLength;
         }
 
-        SourcePath.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("SourcePath"), _T(""), SourcePath.StartOfString, SourcePath.LengthAllocated, PkgIniFile.StartOfString);
+        SourcePath.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, _T("SourcePath"), _T(""), SourcePath.StartOfString, SourcePath.LengthAllocated);
         if (SourcePath.LengthInChars > 0) {
             if (YoriLibIsPathUrl(&SourcePath)) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading source for %y from %y...\n"), &PkgNameOnly, &SourcePath);
@@ -390,6 +428,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&SourcePath);
@@ -414,6 +453,7 @@ YoriPkgInstallSourceForSinglePackage(
     BOOL Result;
     DWORD Error;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -424,25 +464,34 @@ YoriPkgInstallSourceForSinglePackage(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(_T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, _T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y is not installed\n"), PackageName);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("SourcePath"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("SourcePath"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
 
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y does not specify a source path\n"), PackageName);
@@ -468,6 +517,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&IniValue);
 
@@ -494,6 +544,7 @@ YoriPkgInstallSymbolsForInstalledPackages(
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -504,8 +555,15 @@ YoriPkgInstallSymbolsForInstalledPackages(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
@@ -513,11 +571,12 @@ YoriPkgInstallSymbolsForInstalledPackages(
     if (!YoriLibAllocateString(&SymbolPath, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
         YoriLibFreeStringContents(&InstalledSection);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -535,7 +594,7 @@ YoriPkgInstallSymbolsForInstalledPackages(
             PkgNameOnly.LengthInChars = LineLength;
         }
 
-        SymbolPath.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("SymbolPath"), _T(""), SymbolPath.StartOfString, SymbolPath.LengthAllocated, PkgIniFile.StartOfString);
+        SymbolPath.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, _T("SymbolPath"), _T(""), SymbolPath.StartOfString, SymbolPath.LengthAllocated);
         if (SymbolPath.LengthInChars > 0) {
             if (YoriLibIsPathUrl(&SymbolPath)) {
                 YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("Downloading symbols for %y from %y...\n"), &PkgNameOnly, &SymbolPath);
@@ -573,6 +632,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&SymbolPath);
@@ -597,6 +657,7 @@ YoriPkgInstallSymbolForSinglePackage(
     DWORD Error;
     BOOL Result;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
+    PVOID IniDocument;
 
     if (!YoriPkgInitializePendingPackages(&PendingPackages)) {
         return FALSE;
@@ -607,25 +668,34 @@ YoriPkgInstallSymbolForSinglePackage(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(_T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, _T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y is not installed\n"), PackageName);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("SymbolPath"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("SymbolPath"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
 
     if (IniValue.LengthInChars == 0) {
         YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y does not specify a source path\n"), PackageName);
@@ -651,6 +721,7 @@ Exit:
 
     YoriPkgDeletePendingPackages(&PendingPackages);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&IniValue);
 
@@ -677,23 +748,31 @@ YoriPkgListInstalledPackages(
     YORI_STRING PkgNameOnly;
     YORI_STRING PkgVersion;
     YORI_STRING PkgArch;
+    PVOID IniDocument;
 
     if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
     if (!YoriLibAllocateString(&PkgArch, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriLibFreeStringContents(&InstalledSection);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     YoriLibInitEmptyString(&PkgVersion);
@@ -717,7 +796,7 @@ YoriPkgListInstalledPackages(
 
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        PkgArch.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, _T("Architecture"), _T(""), PkgArch.StartOfString, PkgArch.LengthAllocated, PkgIniFile.StartOfString);
+        PkgArch.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, _T("Architecture"), _T(""), PkgArch.StartOfString, PkgArch.LengthAllocated);
 
         if (Verbose) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y %y (%y)\n"), &PkgNameOnly, &PkgVersion, &PkgArch);
@@ -726,6 +805,7 @@ YoriPkgListInstalledPackages(
         }
     }
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&PkgArch);
@@ -758,35 +838,45 @@ YoriPkgDeletePackage(
     YORI_STRING IniValue;
     DWORD FileCount;
     BOOL Result;
+    PVOID IniDocument;
 
     if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(_T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile.StartOfString);
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, _T("Installed"), PackageName->StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
     if (IniValue.LengthInChars == 0) {
         if (WarnIfNotInstalled) {
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y is not an installed package\n"), PackageName);
         }
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
     }
 
-    FileCount = GetPrivateProfileInt(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile.StartOfString);
+    FileCount = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("FileCount"), 0);
     if (FileCount == 0) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("%y contains nothing to remove\n"), PackageName);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
     }
 
     Result = YoriPkgDeletePackageInternal(&PkgIniFile, TargetDirectory, PackageName, FALSE);
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&IniValue);
     return Result;
@@ -807,17 +897,24 @@ YoriPkgDeleteAllPackages(
     LPTSTR Equals;
     YORI_STRING PkgNameOnly;
     BOOL Result;
+    PVOID IniDocument;
 
     if (!YoriPkgGetPackageIniFile(NULL, &PkgIniFile)) {
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -850,13 +947,14 @@ YoriPkgDeleteAllPackages(
     }
 
     if (!Result) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PkgIniFile);
         YoriLibFreeStringContents(&InstalledSection);
 
         return Result;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile.StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -882,6 +980,7 @@ YoriPkgDeleteAllPackages(
         }
     }
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&InstalledSection);
 
@@ -923,27 +1022,36 @@ YoriPkgInstallPseudoPackage(
     YORI_STRING PkgIniFile;
     DWORD FileIndex;
     TCHAR FileIndexString[16];
+    PVOID IniDocument;
+    BOOL Result;
 
     if (!YoriPkgGetPackageIniFile(TargetDirectory, &PkgIniFile)) {
         return FALSE;
     }
 
-    WritePrivateProfileString(_T("Installed"), Name->StartOfString, Version->StartOfString, PkgIniFile.StartOfString);
-    WritePrivateProfileString(Name->StartOfString, _T("Version"), Version->StartOfString, PkgIniFile.StartOfString);
-    WritePrivateProfileString(Name->StartOfString, _T("Architecture"), Architecture->StartOfString, PkgIniFile.StartOfString);
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgIniFile);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Installed"), Name->StartOfString, Version->StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("Version"), Version->StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("Architecture"), Architecture->StartOfString);
 
     for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
-        WritePrivateProfileString(Name->StartOfString, FileIndexString, FileArray[FileIndex - 1].StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(IniDocument, Name->StartOfString, FileIndexString, FileArray[FileIndex - 1].StartOfString);
     }
     YoriLibSPrintf(FileIndexString, _T("%i"), FileCount);
-    WritePrivateProfileString(Name->StartOfString, _T("FileCount"), FileIndexString, PkgIniFile.StartOfString);
+    YoriLibIniSetString(IniDocument, Name->StartOfString, _T("FileCount"), FileIndexString);
 
+    Result = YoriLibIniCommit(IniDocument);
 
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PkgIniFile);
 
-    return TRUE;
+    return Result;
 }
 
 /**
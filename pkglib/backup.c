@@ -94,7 +94,9 @@ YoriPkgDeleteRenamedFiles(
  this also restores each file entry back into the INI file.  Note this routine
  is best effort and continues on error.
 
- @param IniPath Pointer to the system global INI file.
+ @param IniDocument Optionally points to the system global INI document.
+        This is only required if RestoreIni is TRUE.  The caller is
+        responsible for committing any changes to the document.
 
  @param PackageBackup Pointer to the backed up package.
 
@@ -104,7 +106,7 @@ YoriPkgDeleteRenamedFiles(
  */
 VOID
 YoriPkgRollbackRenamedFiles(
-    __in PYORI_STRING IniPath,
+    __in_opt PVOID IniDocument,
     __in PYORIPKG_BACKUP_PACKAGE PackageBackup,
     __in BOOL RestoreIni
     )
@@ -122,9 +124,9 @@ YoriPkgRollbackRenamedFiles(
         ASSERT(YoriLibIsStringNullTerminated(&BackupFile->OriginalName));
         ASSERT(YoriLibIsStringNullTerminated(&BackupFile->OriginalRelativeName));
 
-        if (RestoreIni) {
+        if (RestoreIni && IniDocument != NULL) {
             YoriLibSPrintf(FileIndexString, _T("File%i"), Index);
-            WritePrivateProfileString(PackageBackup->PackageName.StartOfString, FileIndexString, BackupFile->OriginalRelativeName.StartOfString, IniPath->StartOfString);
+            YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, FileIndexString, BackupFile->OriginalRelativeName.StartOfString);
 
         }
 
@@ -167,6 +169,7 @@ YoriPkgRollbackPackage(
     )
 {
     TCHAR FileCountString[16];
+    PVOID IniDocument;
 
     ASSERT(YoriLibIsStringNullTerminated(IniPath));
 
@@ -178,55 +181,62 @@ YoriPkgRollbackPackage(
     ASSERT(PackageBackup->Version.LengthInChars > 0);
     ASSERT(PackageBackup->Architecture.LengthInChars > 0);
 
+    if (!YoriPkgOpenIniFile(IniPath, &IniDocument)) {
+        return;
+    }
+
     //
     //  Delete the entire existing section.  This will clear out any files
     //  added there that aren't part of the backed up package.
     //
 
-    WritePrivateProfileString(PackageBackup->PackageName.StartOfString, NULL, NULL, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, NULL, NULL);
 
     //
     //  Put back the files and recreate their INI entries.
     //
 
-    YoriPkgRollbackRenamedFiles(IniPath, PackageBackup, TRUE);
+    YoriPkgRollbackRenamedFiles(IniDocument, PackageBackup, TRUE);
     YoriLibSPrintf(FileCountString, _T("%i"), PackageBackup->FileCount);
 
     //
     //  Restore all of the fixed headers for the package.
     //
 
-    WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("FileCount"), FileCountString, IniPath->StartOfString);
-    WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("Version"), PackageBackup->Version.StartOfString, IniPath->StartOfString);
-    WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("Architecture"), PackageBackup->Architecture.StartOfString, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("FileCount"), FileCountString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("Version"), PackageBackup->Version.StartOfString);
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("Architecture"), PackageBackup->Architecture.StartOfString);
 
     //
     //  Restore any optional headers for the package.
     //
 
     if (PackageBackup->UpgradePath.LengthInChars > 0) {
-        WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("UpgradePath"), PackageBackup->UpgradePath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradePath"), PackageBackup->UpgradePath.StartOfString);
     } else {
-        WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("UpgradePath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("UpgradePath"), NULL);
     }
 
     if (PackageBackup->SourcePath.LengthInChars > 0) {
-        WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("SourcePath"), PackageBackup->SourcePath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SourcePath"), PackageBackup->SourcePath.StartOfString);
     } else {
-        WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("SourcePath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SourcePath"), NULL);
     }
 
     if (PackageBackup->SymbolPath.LengthInChars > 0) {
-        WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("SymbolPath"), PackageBackup->SymbolPath.StartOfString, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SymbolPath"), PackageBackup->SymbolPath.StartOfString);
     } else {
-        WritePrivateProfileString(PackageBackup->PackageName.StartOfString, _T("SymbolPath"), NULL, IniPath->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, _T("SymbolPath"), NULL);
     }
 
     //
     //  Indicate the package is installed.
     //
 
-    WritePrivateProfileString(_T("Installed"), PackageBackup->PackageName.StartOfString, PackageBackup->Version.StartOfString, IniPath->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Installed"), PackageBackup->PackageName.StartOfString, PackageBackup->Version.StartOfString);
+
+    YoriLibIniCommit(IniDocument);
+    YoriPkgCloseIniFile(IniDocument);
 }
 
 /**
@@ -267,6 +277,7 @@ YoriPkgBackupPackage(
     DWORD FileIndex;
     DWORD Err;
     TCHAR FileIndexString[16];
+    PVOID IniDocument;
 
     Context = YoriLibMalloc(sizeof(YORIPKG_BACKUP_PACKAGE));
     if (Context == NULL) {
@@ -300,21 +311,30 @@ YoriPkgBackupPackage(
     Context->PackageName.LengthInChars = PackageName->LengthInChars;
     Context->PackageName.StartOfString[PackageName->LengthInChars] = '\0';
 
+    if (!YoriPkgOpenIniFile(IniPath, &IniDocument)) {
+        YoriLibFreeStringContents(&FullTargetDirectory);
+        YoriPkgFreeBackupPackage(Context);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
     if (!YoriPkgGetInstalledPackageInfo(IniPath, &Context->PackageName, &Context->Version, &Context->Architecture, &Context->UpgradePath, &Context->SourcePath, &Context->SymbolPath)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
         return ERROR_NOT_ENOUGH_MEMORY;
     }
 
-    Context->FileCount = GetPrivateProfileInt(Context->PackageName.StartOfString, _T("FileCount"), 0, IniPath->StartOfString);
+    Context->FileCount = YoriLibIniGetInt(IniDocument, Context->PackageName.StartOfString, _T("FileCount"), 0);
     if (Context->FileCount == 0) {
-        Err = GetLastError();
+        Err = ERROR_FILE_NOT_FOUND;
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
         return Err;
     }
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&FullTargetDirectory);
         YoriPkgFreeBackupPackage(Context);
         return ERROR_NOT_ENOUGH_MEMORY;
@@ -323,7 +343,7 @@ YoriPkgBackupPackage(
     for (FileIndex = 1; FileIndex <= Context->FileCount; FileIndex++) {
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
-        IniValue.LengthInChars = GetPrivateProfileString(Context->PackageName.StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, IniPath->StartOfString);
+        IniValue.LengthInChars = YoriLibIniGetString(IniDocument, Context->PackageName.StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
 
         //
         //  Don't backup files with absolute paths
@@ -335,7 +355,8 @@ YoriPkgBackupPackage(
 
         BackupFile = YoriLibReferencedMalloc(sizeof(YORIPKG_BACKUP_FILE));
         if (BackupFile == NULL) {
-            YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
+            YoriPkgRollbackRenamedFiles(NULL, Context, FALSE);
+            YoriPkgCloseIniFile(IniDocument);
             YoriLibFreeStringContents(&FullTargetDirectory);
             YoriLibFreeStringContents(&IniValue);
             YoriPkgFreeBackupPackage(Context);
@@ -346,7 +367,8 @@ YoriPkgBackupPackage(
 
         YoriLibYPrintf(&BackupFile->OriginalName, _T("%y\\%y"), &FullTargetDirectory, &IniValue);
         if (BackupFile->OriginalName.LengthInChars == 0) {
-            YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
+            YoriPkgRollbackRenamedFiles(NULL, Context, FALSE);
+            YoriPkgCloseIniFile(IniDocument);
             YoriLibFreeStringContents(&FullTargetDirectory);
             YoriLibFreeStringContents(&IniValue);
             YoriLibDereference(BackupFile);
@@ -362,8 +384,9 @@ YoriPkgBackupPackage(
         if (!YoriLibRenameFileToBackupName(&BackupFile->OriginalName, &BackupFile->BackupName)) {
             Err = GetLastError();
             if (Err != ERROR_FILE_NOT_FOUND) {
-                YoriPkgRollbackRenamedFiles(IniPath, Context, FALSE);
+                YoriPkgRollbackRenamedFiles(NULL, Context, FALSE);
                 YoriLibFreeStringContents(&BackupFile->OriginalName);
+                YoriPkgCloseIniFile(IniDocument);
                 YoriLibFreeStringContents(&FullTargetDirectory);
                 YoriLibFreeStringContents(&IniValue);
                 YoriLibDereference(BackupFile);
@@ -375,6 +398,7 @@ YoriPkgBackupPackage(
         YoriLibAppendList(&Context->FileList, &BackupFile->ListEntry);
 
     }
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&FullTargetDirectory);
     YoriLibFreeStringContents(&IniValue);
 
@@ -399,8 +423,16 @@ YoriPkgRemoveSystemReferencesToPackage(
     __in PYORIPKG_BACKUP_PACKAGE PackageBackup
     )
 {
-    WritePrivateProfileString(PackageBackup->PackageName.StartOfString, NULL, NULL, IniPath->StartOfString);
-    WritePrivateProfileString(_T("Installed"), PackageBackup->PackageName.StartOfString, NULL, IniPath->StartOfString);
+    PVOID IniDocument;
+
+    if (!YoriPkgOpenIniFile(IniPath, &IniDocument)) {
+        return;
+    }
+
+    YoriLibIniSetString(IniDocument, PackageBackup->PackageName.StartOfString, NULL, NULL);
+    YoriLibIniSetString(IniDocument, _T("Installed"), PackageBackup->PackageName.StartOfString, NULL);
+    YoriLibIniCommit(IniDocument);
+    YoriPkgCloseIniFile(IniDocument);
 }
 
 /**
@@ -502,7 +534,11 @@ YoriPkgAddExistingFileToPendingPackages(
     ExistingFile->RelativeFileName.StartOfString[ExistingFile->RelativeFileName.LengthInChars] = '\0';
     ExistingFile->RelativeFileName.LengthAllocated = RelativeFileName->LengthInChars + 1;
 
-    YoriLibHashInsertByKey(PendingPackages->ExistingFilesTable, &ExistingFile->RelativeFileName, ExistingFile, &ExistingFile->HashEntry);
+    if (!YoriLibHashInsertByKey(PendingPackages->ExistingFilesTable, &ExistingFile->RelativeFileName, ExistingFile, &ExistingFile->HashEntry)) {
+        YoriLibDereference(ExistingFile);
+        return FALSE;
+    }
+    YoriLibAppendList(&PendingPackages->ExistingFilesList, &ExistingFile->ListEntry);
     return TRUE;
 }
 
@@ -517,17 +553,16 @@ YoriPkgFreeExistingFiles(
     __in PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages
     )
 {
-    DWORD BucketIndex;
-    PYORI_HASH_BUCKET Bucket;
+    PYORI_LIST_ENTRY ListEntry;
     PYORIPKG_EXISTING_FILE ExistingFile;
 
-    for (BucketIndex = 0; BucketIndex < PendingPackages->ExistingFilesTable->NumberBuckets; BucketIndex++) {
-        Bucket = &PendingPackages->ExistingFilesTable->Buckets[BucketIndex];
-        while (!YoriLibIsListEmpty(&Bucket->ListHead)) {
-            ExistingFile = CONTAINING_RECORD(Bucket->ListHead.Next, YORIPKG_EXISTING_FILE, HashEntry.ListEntry);
-            YoriLibHashRemoveByEntry(&ExistingFile->HashEntry);
-            YoriLibDereference(ExistingFile);
-        }
+    ListEntry = YoriLibGetNextListEntry(&PendingPackages->ExistingFilesList, NULL);
+    while (ListEntry != NULL) {
+        ExistingFile = CONTAINING_RECORD(ListEntry, YORIPKG_EXISTING_FILE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&PendingPackages->ExistingFilesList, ListEntry);
+        YoriLibRemoveListItem(&ExistingFile->ListEntry);
+        YoriLibHashRemoveByEntry(&ExistingFile->HashEntry);
+        YoriLibDereference(ExistingFile);
     }
 }
 
@@ -585,17 +620,24 @@ YoriPkgAddExistingFilesToPendingPackages(
     DWORD FileCount;
     DWORD FileIndex;
     TCHAR FileIndexString[16];
+    PVOID IniDocument;
+
+    if (!YoriPkgOpenIniFile(PkgIniFile, &IniDocument)) {
+        return FALSE;
+    }
 
     if (!YoriLibAllocateString(&InstalledSection, YORIPKG_MAX_SECTION_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriLibFreeStringContents(&InstalledSection);
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
-    InstalledSection.LengthInChars = GetPrivateProfileSection(_T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated, PkgIniFile->StartOfString);
+    InstalledSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Installed"), InstalledSection.StartOfString, InstalledSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = InstalledSection.StartOfString;
@@ -613,15 +655,16 @@ YoriPkgAddExistingFilesToPendingPackages(
         ThisLine++;
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        FileCount = GetPrivateProfileInt(PkgNameOnly.StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
+        FileCount = YoriLibIniGetInt(IniDocument, PkgNameOnly.StartOfString, _T("FileCount"), 0);
 
         for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
             YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
-            IniValue.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile->StartOfString);
+            IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
             if (!YoriPkgAddExistingFileToPendingPackages(PendingPackages, &IniValue)) {
                 YoriLibFreeStringContents(&InstalledSection);
                 YoriLibFreeStringContents(&IniValue);
+                YoriPkgCloseIniFile(IniDocument);
                 return FALSE;
             }
         }
@@ -629,6 +672,7 @@ YoriPkgAddExistingFilesToPendingPackages(
 
     YoriLibFreeStringContents(&InstalledSection);
     YoriLibFreeStringContents(&IniValue);
+    YoriPkgCloseIniFile(IniDocument);
 
     return TRUE;
 }
@@ -650,6 +694,7 @@ YoriPkgInitializePendingPackages(
     YoriLibInitializeListHead(&PendingPackages->PackageList);
     YoriLibInitializeListHead(&PendingPackages->BackupPackages);
     YoriLibInitializeListHead(&PendingPackages->KnownPackages);
+    YoriLibInitializeListHead(&PendingPackages->ExistingFilesList);
     PendingPackages->ExistingFilesTable = YoriLibAllocateHashTable(253);
     if (PendingPackages->ExistingFilesTable == NULL) {
         return FALSE;
@@ -783,6 +828,7 @@ YoriPkgPreparePackageForInstall(
     LPTSTR ThisLine;
     LPTSTR Equals;
     PYORIPKG_BACKUP_PACKAGE BackupPackage;
+    PVOID IniDocument;
     DWORD Result = ERROR_SUCCESS;
 
     YoriLibConstantString(&PkgInfoFile, _T("pkginfo.ini"));
@@ -855,7 +901,14 @@ YoriPkgPreparePackageForInstall(
         goto Exit;
     }
 
-    PkgInstalled.LengthInChars = GetPrivateProfileString(_T("Installed"), PendingPackage->PackageName.StartOfString, _T(""), PkgInstalled.StartOfString, PkgInstalled.LengthAllocated, PkgIniFile->StartOfString);
+    if (!YoriPkgOpenIniFile(PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&PkgInstalled);
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
+    PkgInstalled.LengthInChars = YoriLibIniGetString(IniDocument, _T("Installed"), PendingPackage->PackageName.StartOfString, _T(""), PkgInstalled.StartOfString, PkgInstalled.LengthAllocated);
+    YoriPkgCloseIniFile(IniDocument);
 
     //
     //  If the version being installed is already there, we're done.
@@ -918,10 +971,25 @@ YoriPkgPreparePackageForInstall(
         goto Exit;
     }
 
+    if (!YoriPkgOpenIniFile(&TempPath, &IniDocument)) {
+        YoriLibFreeStringContents(&ReplacesList);
+        YoriLibFreeStringContents(&PkgInstalled);
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
     YoriLibInitEmptyString(&PkgToReplace);
-    ReplacesList.LengthInChars = GetPrivateProfileSection(_T("Replaces"), ReplacesList.StartOfString, ReplacesList.LengthAllocated, TempPath.StartOfString);
+    ReplacesList.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Replaces"), ReplacesList.StartOfString, ReplacesList.LengthAllocated);
+    YoriPkgCloseIniFile(IniDocument);
     ThisLine = ReplacesList.StartOfString;
 
+    if (!YoriPkgOpenIniFile(PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&ReplacesList);
+        YoriLibFreeStringContents(&PkgInstalled);
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
     while (*ThisLine != '\0') {
         LineLength = _tcslen(ThisLine);
         PkgToReplace.StartOfString = ThisLine;
@@ -938,10 +1006,11 @@ YoriPkgPreparePackageForInstall(
         //  is installed, and if so, back it up too
         //
 
-        PkgInstalled.LengthInChars = GetPrivateProfileString(_T("Installed"), PkgToReplace.StartOfString, _T(""), PkgInstalled.StartOfString, PkgInstalled.LengthAllocated, PkgIniFile->StartOfString);
+        PkgInstalled.LengthInChars = YoriLibIniGetString(IniDocument, _T("Installed"), PkgToReplace.StartOfString, _T(""), PkgInstalled.StartOfString, PkgInstalled.LengthAllocated);
         if (PkgInstalled.LengthInChars > 0) {
             Result = YoriPkgBackupPackage(PkgIniFile, &PkgToReplace, TargetDirectory, &BackupPackage);
             if (Result != ERROR_SUCCESS) {
+                YoriPkgCloseIniFile(IniDocument);
                 YoriLibFreeStringContents(&ReplacesList);
                 goto Exit;
             }
@@ -950,6 +1019,7 @@ YoriPkgPreparePackageForInstall(
         }
         ThisLine += LineLength + 1;
     }
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&ReplacesList);
     YoriLibFreeStringContents(&PkgInstalled);
 
@@ -94,6 +94,8 @@ YoriPkgCreateBinaryPackage(
     PVOID LineContext = NULL;
     HANDLE FileListSource;
     DWORD Count;
+    PVOID IniDocument;
+    BOOL Result;
 
     PVOID CabHandle;
 
@@ -125,27 +127,41 @@ YoriPkgCreateBinaryPackage(
     TempFile.LengthInChars = _tcslen(TempFile.StartOfString);
     YoriLibFreeStringContents(&TempPath);
 
-    WritePrivateProfileString(_T("Package"), _T("Name"), PackageName->StartOfString, TempFile.StartOfString);
-    WritePrivateProfileString(_T("Package"), _T("Architecture"), Architecture->StartOfString, TempFile.StartOfString);
-    WritePrivateProfileString(_T("Package"), _T("Version"), Version->StartOfString, TempFile.StartOfString);
+    if (!YoriLibIniOpen(&TempFile, &IniDocument)) {
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Name"), PackageName->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Architecture"), Architecture->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Version"), Version->StartOfString);
     if (MinimumOSBuild != NULL) {
-        WritePrivateProfileString(_T("Package"), _T("MinimumOSBuild"), MinimumOSBuild->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("MinimumOSBuild"), MinimumOSBuild->StartOfString);
         if (PackagePathForOlderBuilds != NULL) {
-            WritePrivateProfileString(_T("Package"), _T("PackagePathForOlderBuilds"), PackagePathForOlderBuilds->StartOfString, TempFile.StartOfString);
+            YoriLibIniSetString(IniDocument, _T("Package"), _T("PackagePathForOlderBuilds"), PackagePathForOlderBuilds->StartOfString);
         }
     }
     if (UpgradePath != NULL) {
-        WritePrivateProfileString(_T("Package"), _T("UpgradePath"), UpgradePath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("UpgradePath"), UpgradePath->StartOfString);
     }
     if (SourcePath != NULL) {
-        WritePrivateProfileString(_T("Package"), _T("SourcePath"), SourcePath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("SourcePath"), SourcePath->StartOfString);
     }
     if (SymbolPath != NULL) {
-        WritePrivateProfileString(_T("Package"), _T("SymbolPath"), SymbolPath->StartOfString, TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Package"), _T("SymbolPath"), SymbolPath->StartOfString);
     }
 
     for (Count = 0; Count < ReplaceCount; Count++) {
-        WritePrivateProfileString(_T("Replaces"), Replaces[Count].StartOfString, _T("1"), TempFile.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Replaces"), Replaces[Count].StartOfString, _T("1"));
+    }
+
+    Result = YoriLibIniCommit(IniDocument);
+    YoriLibIniClose(IniDocument);
+    if (!Result) {
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
     }
 
     if (!YoriLibUserStringToSingleFilePath(FileListFile, TRUE, &FullFileListFile)) {
@@ -534,6 +550,8 @@ YoriPkgCreateSourcePackage(
     YORI_STRING PkgInfoName;
     YORI_STRING ExcludeFilePath;
     YORIPKG_CREATE_SOURCE_CONTEXT CreateSourceContext;
+    PVOID IniDocument;
+    BOOL Result;
 
     ZeroMemory(&CreateSourceContext, sizeof(CreateSourceContext));
     YoriLibInitializeListHead(&CreateSourceContext.ExcludeList);
@@ -567,9 +585,23 @@ YoriPkgCreateSourcePackage(
     TempFile.LengthInChars = _tcslen(TempFile.StartOfString);
     YoriLibFreeStringContents(&TempPath);
 
-    WritePrivateProfileString(_T("Package"), _T("Name"), PackageName->StartOfString, TempFile.StartOfString);
-    WritePrivateProfileString(_T("Package"), _T("Version"), Version->StartOfString, TempFile.StartOfString);
-    WritePrivateProfileString(_T("Package"), _T("Architecture"), _T("noarch"), TempFile.StartOfString);
+    if (!YoriLibIniOpen(&TempFile, &IniDocument)) {
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
+
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Name"), PackageName->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Version"), Version->StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Package"), _T("Architecture"), _T("noarch"));
+
+    Result = YoriLibIniCommit(IniDocument);
+    YoriLibIniClose(IniDocument);
+    if (!Result) {
+        DeleteFile(TempFile.StartOfString);
+        YoriLibFreeStringContents(&TempFile);
+        return FALSE;
+    }
 
     if (!YoriLibCreateCab(FileName, &CreateSourceContext.CabHandle)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("YoriLibCreateCab failure\n"));
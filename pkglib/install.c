@@ -135,18 +135,26 @@ YoriPkgCheckIfPackageDeleteable(
     DWORD FileIndex;
     TCHAR FileIndexString[16];
     BOOL DeleteResult;
+    PVOID IniDocument;
+
+    if (!YoriPkgOpenIniFile(PkgIniFile, &IniDocument)) {
+        return FALSE;
+    }
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     if (TargetDirectory == NULL) {
         if (!YoriPkgGetApplicationDirectory(&AppPath)) {
             YoriLibFreeStringContents(&IniValue);
+            YoriPkgCloseIniFile(IniDocument);
             return FALSE;
         }
     } else {
         if (!YoriLibAllocateString(&AppPath, TargetDirectory->LengthInChars + MAX_PATH)) {
+            YoriPkgCloseIniFile(IniDocument);
             return FALSE;
         }
         memcpy(AppPath.StartOfString, TargetDirectory->StartOfString, TargetDirectory->LengthInChars * sizeof(TCHAR));
@@ -154,10 +162,11 @@ YoriPkgCheckIfPackageDeleteable(
         AppPath.LengthInChars = TargetDirectory->LengthInChars;
     }
 
-    FileCount = GetPrivateProfileInt(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
+    FileCount = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("FileCount"), 0);
     if (FileCount == 0) {
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
@@ -165,13 +174,14 @@ YoriPkgCheckIfPackageDeleteable(
     if (!YoriLibAllocateString(&FileToDelete, AppPath.LengthInChars + YORIPKG_MAX_FIELD_LENGTH)) {
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
-        IniValue.LengthInChars = GetPrivateProfileString(PackageName->StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile->StartOfString);
+        IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
         if (IniValue.LengthInChars > 0) {
             if (!YoriLibIsPathPrefixed(&IniValue)) {
                 YoriLibYPrintf(&FileToDelete, _T("%y\\%y"), &AppPath, &IniValue);
@@ -185,6 +195,7 @@ YoriPkgCheckIfPackageDeleteable(
                 YORI_STRING ModuleName;
 
                 if (!YoriPkgGetExecutableFile(&ModuleName)) {
+                    YoriPkgCloseIniFile(IniDocument);
                     return FALSE;
                 }
 
@@ -208,6 +219,7 @@ YoriPkgCheckIfPackageDeleteable(
                 YoriLibFreeStringContents(&IniValue);
                 YoriLibFreeStringContents(&AppPath);
                 YoriLibFreeStringContents(&FileToDelete);
+                YoriPkgCloseIniFile(IniDocument);
                 return FALSE;
             }
         }
@@ -217,6 +229,7 @@ YoriPkgCheckIfPackageDeleteable(
     YoriLibFreeStringContents(&AppPath);
     YoriLibFreeStringContents(&FileToDelete);
 
+    YoriPkgCloseIniFile(IniDocument);
     return TRUE;
 }
 
@@ -330,18 +343,26 @@ YoriPkgDeletePackageInternal(
     DWORD FileIndex;
     TCHAR FileIndexString[16];
     BOOL DeleteResult;
+    PVOID IniDocument;
+
+    if (!YoriPkgOpenIniFile(PkgIniFile, &IniDocument)) {
+        return FALSE;
+    }
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     if (TargetDirectory == NULL) {
         if (!YoriPkgGetApplicationDirectory(&AppPath)) {
             YoriLibFreeStringContents(&IniValue);
+            YoriPkgCloseIniFile(IniDocument);
             return FALSE;
         }
     } else {
         if (!YoriLibAllocateString(&AppPath, TargetDirectory->LengthInChars + MAX_PATH)) {
+            YoriPkgCloseIniFile(IniDocument);
             return FALSE;
         }
         memcpy(AppPath.StartOfString, TargetDirectory->StartOfString, TargetDirectory->LengthInChars * sizeof(TCHAR));
@@ -349,10 +370,11 @@ YoriPkgDeletePackageInternal(
         AppPath.LengthInChars = TargetDirectory->LengthInChars;
     }
 
-    FileCount = GetPrivateProfileInt(PackageName->StartOfString, _T("FileCount"), 0, PkgIniFile->StartOfString);
+    FileCount = YoriLibIniGetInt(IniDocument, PackageName->StartOfString, _T("FileCount"), 0);
     if (FileCount == 0) {
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
@@ -360,13 +382,14 @@ YoriPkgDeletePackageInternal(
     if (!YoriLibAllocateString(&FileToDelete, AppPath.LengthInChars + YORIPKG_MAX_FIELD_LENGTH)) {
         YoriLibFreeStringContents(&AppPath);
         YoriLibFreeStringContents(&IniValue);
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     for (FileIndex = 1; FileIndex <= FileCount; FileIndex++) {
         YoriLibSPrintf(FileIndexString, _T("File%i"), FileIndex);
 
-        IniValue.LengthInChars = GetPrivateProfileString(PackageName->StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile->StartOfString);
+        IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, FileIndexString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
         if (IniValue.LengthInChars > 0) {
             if (!YoriLibIsPathPrefixed(&IniValue)) {
                 YoriLibYPrintf(&FileToDelete, _T("%y\\%y"), &AppPath, &IniValue);
@@ -380,6 +403,8 @@ YoriPkgDeletePackageInternal(
                 YORI_STRING ModuleName;
 
                 if (!YoriPkgGetExecutableFile(&ModuleName)) {
+                    YoriLibIniCommit(IniDocument);
+                    YoriPkgCloseIniFile(IniDocument);
                     return FALSE;
                 }
 
@@ -405,28 +430,31 @@ YoriPkgDeletePackageInternal(
                 YoriLibFreeStringContents(&IniValue);
                 YoriLibFreeStringContents(&AppPath);
                 YoriLibFreeStringContents(&FileToDelete);
+                YoriPkgCloseIniFile(IniDocument);
                 return FALSE;
             }
         }
 
-        WritePrivateProfileString(PackageName->StartOfString, FileIndexString, NULL, PkgIniFile->StartOfString);
+        YoriLibIniSetString(IniDocument, PackageName->StartOfString, FileIndexString, NULL);
     }
 
-    WritePrivateProfileString(PackageName->StartOfString, _T("FileCount"), NULL, PkgIniFile->StartOfString);
-    WritePrivateProfileString(PackageName->StartOfString, _T("Architecture"), NULL, PkgIniFile->StartOfString);
-    WritePrivateProfileString(PackageName->StartOfString, _T("UpgradePath"), NULL, PkgIniFile->StartOfString);
-    WritePrivateProfileString(PackageName->StartOfString, _T("SourcePath"), NULL, PkgIniFile->StartOfString);
-    WritePrivateProfileString(PackageName->StartOfString, _T("SymbolPath"), NULL, PkgIniFile->StartOfString);
-    WritePrivateProfileString(PackageName->StartOfString, _T("Version"), NULL, PkgIniFile->StartOfString);
-    WritePrivateProfileString(_T("Installed"), PackageName->StartOfString, NULL, PkgIniFile->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("FileCount"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("Architecture"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("UpgradePath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("SourcePath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("SymbolPath"), NULL);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, _T("Version"), NULL);
+    YoriLibIniSetString(IniDocument, _T("Installed"), PackageName->StartOfString, NULL);
 
-    WritePrivateProfileString(PackageName->StartOfString, NULL, NULL, PkgIniFile->StartOfString);
+    YoriLibIniSetString(IniDocument, PackageName->StartOfString, NULL, NULL);
+    DeleteResult = YoriLibIniCommit(IniDocument);
+    YoriPkgCloseIniFile(IniDocument);
 
     YoriLibFreeStringContents(&IniValue);
     YoriLibFreeStringContents(&AppPath);
     YoriLibFreeStringContents(&FileToDelete);
 
-    return TRUE;
+    return DeleteResult;
 }
 
 
@@ -443,9 +471,9 @@ typedef struct _YORIPKG_INSTALL_PKG_CONTEXT {
     PYORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
 
     /**
-     Path to the INI file recording package installation.
+     The parsed INI file recording package installation.
      */
-    PYORI_STRING IniFileName;
+    PVOID IniDocument;
 
     /**
      The name of the package being installed.
@@ -468,6 +496,12 @@ typedef struct _YORIPKG_INSTALL_PKG_CONTEXT {
      */
     BOOL ConflictingFileFound;
 
+    /**
+     If TRUE, installation is aborted because the list of installed files
+     could not be written.
+     */
+    BOOL CommitFailed;
+
     /**
      Context for background compression threads.
      */
@@ -497,7 +531,7 @@ YoriPkgInstallPackageFileCallback(
     PYORIPKG_INSTALL_PKG_CONTEXT InstallContext = (PYORIPKG_INSTALL_PKG_CONTEXT)Context;
     TCHAR FileIndexString[16];
 
-    if (InstallContext->ConflictingFileFound) {
+    if (InstallContext->ConflictingFileFound || InstallContext->CommitFailed) {
         return FALSE;
     }
 
@@ -516,7 +550,25 @@ YoriPkgInstallPackageFileCallback(
     InstallContext->NumberFiles++;
     YoriLibSPrintf(FileIndexString, _T("File%i"), InstallContext->NumberFiles);
 
-    WritePrivateProfileString(InstallContext->PackageName->StartOfString, FileIndexString, RelativePath->StartOfString, InstallContext->IniFileName->StartOfString);
+    YoriLibIniSetString(InstallContext->IniDocument, InstallContext->PackageName->StartOfString, FileIndexString, RelativePath->StartOfString);
+
+    //
+    //  This is called before the file is extracted.  Write the file list
+    //  for the first file and periodically after that, so that if the
+    //  process terminates, most extracted files are recorded and can be
+    //  cleaned up.
+    //
+
+    if ((InstallContext->NumberFiles % YORIPKG_FILES_PER_COMMIT) == 1) {
+        if (!YoriLibIniCommit(InstallContext->IniDocument)) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Could not record installed files for package %y\n"), InstallContext->PackageName);
+            YoriLibIniSetString(InstallContext->IniDocument, InstallContext->PackageName->StartOfString, FileIndexString, NULL);
+            InstallContext->NumberFiles--;
+            InstallContext->CommitFailed = TRUE;
+            return FALSE;
+        }
+    }
+
     return TRUE;
 }
 
@@ -599,6 +651,10 @@ YoriPkgInstallPackage(
         goto Exit;
     }
 
+    if (!YoriPkgOpenIniFile(&PkgIniFile, &InstallContext.IniDocument)) {
+        goto Exit;
+    }
+
     if (TargetDirectory != NULL) {
         if (!YoriLibUserStringToSingleFilePath(TargetDirectory, FALSE, &FullTargetDirectory)) {
             goto Exit;
@@ -624,7 +680,7 @@ YoriPkgInstallPackage(
             goto Exit;
         }
 
-        PkgToDelete.LengthInChars = GetPrivateProfileString(_T("Installed"), Package->PackageName.StartOfString, _T(""), PkgToDelete.StartOfString, PkgToDelete.LengthAllocated, PkgIniFile.StartOfString);
+        PkgToDelete.LengthInChars = YoriLibIniGetString(InstallContext.IniDocument, _T("Installed"), Package->PackageName.StartOfString, _T(""), PkgToDelete.StartOfString, PkgToDelete.LengthAllocated);
 
         //
         //  If the version being installed is already there, we're done.
@@ -651,9 +707,13 @@ YoriPkgInstallPackage(
     //  upgrade will detect a new version and will retry.
     //
 
-    WritePrivateProfileString(_T("Installed"), Package->PackageName.StartOfString, _T("0"), PkgIniFile.StartOfString);
+    YoriLibIniSetString(InstallContext.IniDocument, _T("Installed"), Package->PackageName.StartOfString, _T("0"));
     if (Package->UpgradePath.LengthInChars > 0) {
-        WritePrivateProfileString(Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString);
+    }
+
+    if (!YoriLibIniCommit(InstallContext.IniDocument)) {
+        goto Exit;
     }
 
     if (YoriLibGetWofVersionAvailable(&FullTargetDirectory)) {
@@ -673,44 +733,63 @@ YoriPkgInstallPackage(
     //
 
     InstallContext.PendingPackages = PendingPackages;
-    InstallContext.IniFileName = &PkgIniFile;
     InstallContext.PackageName = &Package->PackageName;
     InstallContext.NumberFiles = 0;
     InstallContext.ConflictingFileFound = FALSE;
+    InstallContext.CommitFailed = FALSE;
     YoriLibInitEmptyString(&ErrorString);
     if (!YoriLibExtractCab(&Package->LocalPackagePath, &FullTargetDirectory, TRUE, 1, &PkgInfoFile, 0, NULL, YoriPkgInstallPackageFileCallback, YoriPkgCompressPackageFileCallback, &InstallContext, &ErrorString)) {
-        WritePrivateProfileString(_T("Installed"), Package->PackageName.StartOfString, NULL, PkgIniFile.StartOfString);
+        YoriLibIniSetString(InstallContext.IniDocument, _T("Installed"), Package->PackageName.StartOfString, NULL);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Could not create or write to file %y: %y\n"), &Package->LocalPackagePath, &ErrorString);
         YoriLibFreeStringContents(&ErrorString);
         goto Exit;
     }
 
     if (InstallContext.ConflictingFileFound) {
-        WritePrivateProfileString(_T("Installed"), Package->PackageName.StartOfString, NULL, PkgIniFile.StartOfString);
+        YoriLibIniSetString(InstallContext.IniDocument, _T("Installed"), Package->PackageName.StartOfString, NULL);
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Install aborted due to file conflict\n"));
         goto Exit;
     }
 
-    WritePrivateProfileString(Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString, PkgIniFile.StartOfString);
-    WritePrivateProfileString(Package->PackageName.StartOfString, _T("Architecture"), Package->Architecture.StartOfString, PkgIniFile.StartOfString);
+    if (InstallContext.CommitFailed) {
+        YoriLibIniSetString(InstallContext.IniDocument, _T("Installed"), Package->PackageName.StartOfString, NULL);
+        goto Exit;
+    }
+
+    YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString);
+    YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("Architecture"), Package->Architecture.StartOfString);
     if (Package->UpgradePath.LengthInChars > 0) {
-        WritePrivateProfileString(Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("UpgradePath"), Package->UpgradePath.StartOfString);
     }
     if (Package->SourcePath.LengthInChars > 0) {
-        WritePrivateProfileString(Package->PackageName.StartOfString, _T("SourcePath"), Package->SourcePath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("SourcePath"), Package->SourcePath.StartOfString);
     }
     if (Package->SymbolPath.LengthInChars > 0) {
-        WritePrivateProfileString(Package->PackageName.StartOfString, _T("SymbolPath"), Package->SymbolPath.StartOfString, PkgIniFile.StartOfString);
+        YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("SymbolPath"), Package->SymbolPath.StartOfString);
     }
 
     YoriLibSPrintf(FileIndexString, _T("%i"), InstallContext.NumberFiles);
 
-    WritePrivateProfileString(Package->PackageName.StartOfString, _T("FileCount"), FileIndexString, PkgIniFile.StartOfString);
-    WritePrivateProfileString(_T("Installed"), Package->PackageName.StartOfString, Package->Version.StartOfString, PkgIniFile.StartOfString);
+    YoriLibIniSetString(InstallContext.IniDocument, Package->PackageName.StartOfString, _T("FileCount"), FileIndexString);
+    YoriLibIniSetString(InstallContext.IniDocument, _T("Installed"), Package->PackageName.StartOfString, Package->Version.StartOfString);
 
     Result = TRUE;
 
 Exit:
+
+    //
+    //  File entries are written periodically as the package is extracted,
+    //  and the remainder are written along with the final package state.
+    //  On failure, this records the files that were extracted so they can
+    //  be cleaned up.
+    //
+
+    if (InstallContext.IniDocument != NULL) {
+        if (!YoriLibIniCommit(InstallContext.IniDocument)) {
+            Result = FALSE;
+        }
+        YoriPkgCloseIniFile(InstallContext.IniDocument);
+    }
     YoriLibFreeStringContents(&PkgIniFile);
     YoriLibFreeStringContents(&FullTargetDirectory);
     if (InstallContext.CompressFiles) {
@@ -752,12 +831,19 @@ YoriPkgBuildUpgradeLocationForNewArchitecture(
 {
     YORI_STRING IniValue;
     YORI_STRING ExistingArchAndExtension;
+    PVOID IniDocument;
 
     if (!YoriLibAllocateString(&IniValue, YORIPKG_MAX_FIELD_LENGTH)) {
         return FALSE;
     }
 
-    IniValue.LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("Architecture"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated, PkgIniFile->StartOfString);
+    if (!YoriPkgOpenIniFile(PkgIniFile, &IniDocument)) {
+        YoriLibFreeStringContents(&IniValue);
+        return FALSE;
+    }
+
+    IniValue.LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("Architecture"), _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
+    YoriPkgCloseIniFile(IniDocument);
     if (IniValue.LengthInChars == 0) {
         YoriLibFreeStringContents(&IniValue);
         return FALSE;
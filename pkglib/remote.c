@@ -343,6 +343,7 @@ YoriPkgCollectSourcesFromIni(
     PYORIPKG_REMOTE_SOURCE ExistingSource;
     PYORI_LIST_ENTRY ListEntry;
     BOOL DuplicateFound;
+    PVOID IniDocument = NULL;
 
     YoriLibInitEmptyString(&IniValue);
     YoriLibInitEmptyString(&IniKey);
@@ -356,10 +357,14 @@ YoriPkgCollectSourcesFromIni(
     }
 
     if (SourcesList != NULL) {
+        if (!YoriPkgOpenIniFile(IniPath, &IniDocument)) {
+            goto Exit;
+        }
+
         Index = 1;
         while (TRUE) {
             IniKey.LengthInChars = YoriLibSPrintf(IniKey.StartOfString, _T("Source%i"), Index);
-            IniValue.LengthInChars = GetPrivateProfileString(_T("Sources"), IniKey.StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated, IniPath->StartOfString);
+            IniValue.LengthInChars = YoriLibIniGetString(IniDocument, _T("Sources"), IniKey.StartOfString, _T(""), IniValue.StartOfString, IniValue.LengthAllocated);
             if (IniValue.LengthInChars == 0) {
                 break;
             }
@@ -393,6 +398,9 @@ YoriPkgCollectSourcesFromIni(
 
     Result = TRUE;
 Exit:
+    if (IniDocument != NULL) {
+        YoriPkgCloseIniFile(IniDocument);
+    }
     YoriLibFreeStringContents(&IniValue);
     YoriLibFreeStringContents(&IniKey);
     return Result;
@@ -494,6 +502,7 @@ YoriPkgCollectPackagesFromSource(
     TCHAR IniKey[sizeof("noarch.packagepathforolderbuilds")];
     DWORD ArchIndex;
     DWORD Result;
+    PVOID IniDocument = NULL;
 
     YoriLibInitEmptyString(&LocalPath);
     YoriLibInitEmptyString(&ProvidesSection);
@@ -526,10 +535,15 @@ YoriPkgCollectPackagesFromSource(
     YoriLibCloneString(&PackagePathForOlderBuilds, &MinimumOSBuild);
     PackagePathForOlderBuilds.StartOfString += YORIPKG_MAX_SECTION_LENGTH;
 
-    ProvidesSection.LengthInChars = GetPrivateProfileSection(_T("Provides"),
-                                                             ProvidesSection.StartOfString,
-                                                             ProvidesSection.LengthAllocated,
-                                                             LocalPath.StartOfString);
+    if (!YoriPkgOpenIniFile(&LocalPath, &IniDocument)) {
+        Result = ERROR_NOT_ENOUGH_MEMORY;
+        goto Exit;
+    }
+
+    ProvidesSection.LengthInChars = YoriLibIniGetSection(IniDocument,
+                                                         _T("Provides"),
+                                                         ProvidesSection.StartOfString,
+                                                         ProvidesSection.LengthAllocated);
 
     YoriLibInitEmptyString(&PkgNameOnly);
     ThisLine = ProvidesSection.StartOfString;
@@ -548,22 +562,22 @@ YoriPkgCollectPackagesFromSource(
 
         PkgNameOnly.StartOfString[PkgNameOnly.LengthInChars] = '\0';
 
-        PkgVersion.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString,
-                                                           _T("Version"),
-                                                           _T(""),
-                                                           PkgVersion.StartOfString,
-                                                           PkgVersion.LengthAllocated,
-                                                           LocalPath.StartOfString);
+        PkgVersion.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                       PkgNameOnly.StartOfString,
+                                                       _T("Version"),
+                                                       _T(""),
+                                                       PkgVersion.StartOfString,
+                                                       PkgVersion.LengthAllocated);
 
         if (PkgVersion.LengthInChars > 0) {
             for (ArchIndex = 0; ArchIndex < sizeof(KnownArchitectures)/sizeof(KnownArchitectures[0]); ArchIndex++) {
                 YoriLibConstantString(&Architecture, KnownArchitectures[ArchIndex]);
-                IniValue.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString,
-                                                                 Architecture.StartOfString,
-                                                                 _T(""),
-                                                                 IniValue.StartOfString,
-                                                                 IniValue.LengthAllocated,
-                                                                 LocalPath.StartOfString);
+                IniValue.LengthInChars = YoriLibIniGetString(IniDocument,
+                                                             PkgNameOnly.StartOfString,
+                                                             Architecture.StartOfString,
+                                                             _T(""),
+                                                             IniValue.StartOfString,
+                                                             IniValue.LengthAllocated);
                 if (IniValue.LengthInChars > 0) {
                     PYORIPKG_REMOTE_PACKAGE Package;
 
@@ -571,10 +585,10 @@ YoriPkgCollectPackagesFromSource(
 
                     YoriLibSPrintf(IniKey, _T("%y.minimumosbuild"), &Architecture);
 
-                    MinimumOSBuild.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, IniKey, _T(""), MinimumOSBuild.StartOfString, MinimumOSBuild.LengthAllocated, LocalPath.StartOfString);
+                    MinimumOSBuild.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, IniKey, _T(""), MinimumOSBuild.StartOfString, MinimumOSBuild.LengthAllocated);
                     if (MinimumOSBuild.LengthInChars > 0) {
                         YoriLibSPrintf(IniKey, _T("%y.packagepathforolderbuilds"), &Architecture);
-                        PackagePathForOlderBuilds.LengthInChars = GetPrivateProfileString(PkgNameOnly.StartOfString, IniKey, _T(""), PackagePathForOlderBuilds.StartOfString, PackagePathForOlderBuilds.LengthAllocated, LocalPath.StartOfString);
+                        PackagePathForOlderBuilds.LengthInChars = YoriLibIniGetString(IniDocument, PkgNameOnly.StartOfString, IniKey, _T(""), PackagePathForOlderBuilds.StartOfString, PackagePathForOlderBuilds.LengthAllocated);
                     }
 
 
@@ -600,6 +614,9 @@ YoriPkgCollectPackagesFromSource(
     }
 
 Exit:
+    if (IniDocument != NULL) {
+        YoriPkgCloseIniFile(IniDocument);
+    }
     if (DeleteWhenFinished) {
         DeleteFile(LocalPath.StartOfString);
     }
@@ -795,6 +812,7 @@ YoriPkgDownloadRemotePackages(
     DWORD Index;
     DWORD Err;
     BOOL DeleteWhenFinished;
+    PVOID IniDocument;
 
     YoriPkgCollectAllSourcesAndPackages(Source, NULL, &SourcesList, &PackageList);
 
@@ -805,6 +823,12 @@ YoriPkgDownloadRemotePackages(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PackagesIni, &IniDocument)) {
+        YoriPkgFreeAllSourcesAndPackages(&SourcesList, &PackageList);
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
     //
     //  Download the packages we found.
     //
@@ -867,15 +891,15 @@ YoriPkgDownloadRemotePackages(
 
             if (Err == ERROR_SUCCESS) {
                 YORI_STRING TempKeyString;
-                WritePrivateProfileString(_T("Provides"), Package->PackageName.StartOfString, Package->Version.StartOfString, PackagesIni.StartOfString);
-                WritePrivateProfileString(Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString, PackagesIni.StartOfString);
-                WritePrivateProfileString(Package->PackageName.StartOfString, Package->Architecture.StartOfString, FinalFileName.StartOfString, PackagesIni.StartOfString);
+                YoriLibIniSetString(IniDocument, _T("Provides"), Package->PackageName.StartOfString, Package->Version.StartOfString);
+                YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, _T("Version"), Package->Version.StartOfString);
+                YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, Package->Architecture.StartOfString, FinalFileName.StartOfString);
 
                 if (Package->MinimumOSBuild.LengthInChars != 0) {
                     YoriLibInitEmptyString(&TempKeyString);
                     YoriLibYPrintf(&TempKeyString, _T("%y.minimumosbuild"), &Package->Architecture);
                     if (TempKeyString.LengthInChars > 0) {
-                        WritePrivateProfileString(Package->PackageName.StartOfString, TempKeyString.StartOfString, Package->MinimumOSBuild.StartOfString, PackagesIni.StartOfString);
+                        YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, TempKeyString.StartOfString, Package->MinimumOSBuild.StartOfString);
                         YoriLibFreeStringContents(&TempKeyString);
                     }
 
@@ -885,7 +909,7 @@ YoriPkgDownloadRemotePackages(
                     YoriLibInitEmptyString(&TempKeyString);
                     YoriLibYPrintf(&TempKeyString, _T("%y.packagepathforolderbuilds"), &Package->Architecture);
                     if (TempKeyString.LengthInChars > 0) {
-                        WritePrivateProfileString(Package->PackageName.StartOfString, TempKeyString.StartOfString, Package->PackagePathForOlderBuilds.StartOfString, PackagesIni.StartOfString);
+                        YoriLibIniSetString(IniDocument, Package->PackageName.StartOfString, TempKeyString.StartOfString, Package->PackagePathForOlderBuilds.StartOfString);
                         YoriLibFreeStringContents(&TempKeyString);
                     }
 
@@ -905,6 +929,9 @@ YoriPkgDownloadRemotePackages(
         PackageEntry = YoriLibGetNextListEntry(&PackageList, PackageEntry);
     }
 
+    YoriLibIniCommit(IniDocument);
+    YoriPkgCloseIniFile(IniDocument);
+
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, &PackageList);
     YoriLibFreeStringContents(&PackagesIni);
 
@@ -1163,6 +1190,7 @@ YoriPkgInstallRemotePackages(
     YORI_STRING IniValue;
     YORIPKG_PACKAGES_PENDING_INSTALL PendingPackages;
     DWORD Error;
+    PVOID IniDocument;
 
     Result = FALSE;
 
@@ -1181,6 +1209,18 @@ YoriPkgInstallRemotePackages(
         return Result;
     }
 
+    //
+    //  Hold the package INI file open so each package operation below
+    //  shares a single parsed copy.
+    //
+
+    if (!YoriPkgOpenIniFile(&IniFile, &IniDocument)) {
+        YoriPkgDeletePendingPackages(&PendingPackages);
+        YoriLibFreeStringContents(&IniFile);
+        YoriLibFreeStringContents(&IniValue);
+        return Result;
+    }
+
     YoriLibInitializeListHead(&PackagesMatchingCriteria);
 
     //
@@ -1237,6 +1277,7 @@ Exit:
     YoriPkgDeletePendingPackages(&PendingPackages);
 
     YoriPkgFreeAllSourcesAndPackages(NULL, &PackagesMatchingCriteria);
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&IniFile);
     YoriLibFreeStringContents(&IniValue);
 
@@ -1636,6 +1677,8 @@ YoriPkgAddNewSource(
     YORI_STRING PackagesIni;
     DWORD Index;
     YORI_STRING IniKey;
+    PVOID IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&SourcesList);
 
@@ -1643,7 +1686,13 @@ YoriPkgAddNewSource(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PackagesIni, &IniDocument)) {
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
     if (!YoriPkgCollectSourcesFromIniWithDefaults(&PackagesIni, &SourcesList, &DefaultsUsed)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
@@ -1680,10 +1729,11 @@ YoriPkgAddNewSource(
 
     if (!YoriLibAllocateString(&IniKey, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
-    WritePrivateProfileString(_T("Sources"), NULL, NULL, PackagesIni.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Sources"), NULL, NULL);
     SourceEntry = NULL;
     Index = 1;
     SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
@@ -1691,15 +1741,18 @@ YoriPkgAddNewSource(
         Source = CONTAINING_RECORD(SourceEntry, YORIPKG_REMOTE_SOURCE, SourceList);
         SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
         IniKey.LengthInChars = YoriLibSPrintf(IniKey.StartOfString, _T("Source%i"), Index);
-        WritePrivateProfileString(_T("Sources"), IniKey.StartOfString, Source->SourceRootUrl.StartOfString, PackagesIni.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Sources"), IniKey.StartOfString, Source->SourceRootUrl.StartOfString);
         Index++;
     }
 
+    Result = YoriLibIniCommit(IniDocument);
+
     YoriLibFreeStringContents(&IniKey);
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PackagesIni);
 
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -1721,6 +1774,8 @@ YoriPkgDeleteSource(
     YORI_STRING PackagesIni;
     DWORD Index;
     YORI_STRING IniKey;
+    PVOID IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&SourcesList);
 
@@ -1728,7 +1783,13 @@ YoriPkgDeleteSource(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PackagesIni, &IniDocument)) {
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
     if (!YoriPkgCollectSourcesFromIniWithDefaults(&PackagesIni, &SourcesList, &DefaultsUsed)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return TRUE;
     }
@@ -1754,10 +1815,11 @@ YoriPkgDeleteSource(
 
     if (!YoriLibAllocateString(&IniKey, YORIPKG_MAX_FIELD_LENGTH)) {
         YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
-    WritePrivateProfileString(_T("Sources"), NULL, NULL, PackagesIni.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Sources"), NULL, NULL);
     SourceEntry = NULL;
     Index = 1;
     SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
@@ -1765,15 +1827,18 @@ YoriPkgDeleteSource(
         Source = CONTAINING_RECORD(SourceEntry, YORIPKG_REMOTE_SOURCE, SourceList);
         SourceEntry = YoriLibGetNextListEntry(&SourcesList, SourceEntry);
         IniKey.LengthInChars = YoriLibSPrintf(IniKey.StartOfString, _T("Source%i"), Index);
-        WritePrivateProfileString(_T("Sources"), IniKey.StartOfString, Source->SourceRootUrl.StartOfString, PackagesIni.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Sources"), IniKey.StartOfString, Source->SourceRootUrl.StartOfString);
         Index++;
     }
 
+    Result = YoriLibIniCommit(IniDocument);
+
     YoriLibFreeStringContents(&IniKey);
     YoriPkgFreeAllSourcesAndPackages(&SourcesList, NULL);
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PackagesIni);
 
-    return TRUE;
+    return Result;
 }
 
 // vim:sw=4:ts=4:et:
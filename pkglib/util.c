@@ -141,6 +141,112 @@ YoriPkgGetPackageIniFile(
     return TRUE;
 }
 
+/**
+ A parsed INI file which is shared by each caller that opens the same file
+ while it remains open.  This allows an operation to open the system INI
+ file once and have every routine it calls query and update the same parsed
+ copy, rather than parsing the file for every value.
+ */
+typedef struct _YORIPKG_INI_CACHE {
+
+    /**
+     The full path to the file which is currently cached.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The parsed file, or NULL if no file is cached.
+     */
+    PVOID IniDocument;
+
+    /**
+     The number of callers which currently have the file open.  When this
+     drops to zero, the parsed file is discarded.
+     */
+    DWORD ReferenceCount;
+} YORIPKG_INI_CACHE, *PYORIPKG_INI_CACHE;
+
+/**
+ The INI file which is currently cached.
+ */
+YORIPKG_INI_CACHE YoriPkgIniCache;
+
+/**
+ Open and parse an INI file.  If the file is already open, the existing
+ parsed copy is returned, including any changes made to it.  Callers which
+ update the file are expected to call YoriLibIniCommit before closing it.
+
+ @param IniPath Pointer to the full path to the INI file.
+
+ @param IniDocument On successful completion, updated to point to the parsed
+        INI file.  This should be closed with @ref YoriPkgCloseIniFile .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriPkgOpenIniFile(
+    __in PYORI_STRING IniPath,
+    __out PVOID *IniDocument
+    )
+{
+    if (YoriPkgIniCache.ReferenceCount > 0 &&
+        YoriLibCompareStringInsensitive(&YoriPkgIniCache.FileName, IniPath) == 0) {
+
+        YoriPkgIniCache.ReferenceCount++;
+        *IniDocument = YoriPkgIniCache.IniDocument;
+        return TRUE;
+    }
+
+    if (!YoriLibIniOpen(IniPath, IniDocument)) {
+        return FALSE;
+    }
+
+    //
+    //  Only one file is cached at a time.  If another file is already open,
+    //  this one is returned without being cached.
+    //
+
+    if (YoriPkgIniCache.ReferenceCount == 0) {
+        if (YoriLibAllocateString(&YoriPkgIniCache.FileName, IniPath->LengthInChars + 1)) {
+            memcpy(YoriPkgIniCache.FileName.StartOfString, IniPath->StartOfString, IniPath->LengthInChars * sizeof(TCHAR));
+            YoriPkgIniCache.FileName.StartOfString[IniPath->LengthInChars] = '\0';
+            YoriPkgIniCache.FileName.LengthInChars = IniPath->LengthInChars;
+            YoriPkgIniCache.IniDocument = *IniDocument;
+            YoriPkgIniCache.ReferenceCount = 1;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Close an INI file opened with @ref YoriPkgOpenIniFile .  Any changes which
+ have not been committed are discarded when the final caller closes the
+ file.
+
+ @param IniDocument Pointer to the parsed INI file.
+ */
+VOID
+YoriPkgCloseIniFile(
+    __in PVOID IniDocument
+    )
+{
+    if (YoriPkgIniCache.ReferenceCount > 0 &&
+        YoriPkgIniCache.IniDocument == IniDocument) {
+
+        YoriPkgIniCache.ReferenceCount--;
+        if (YoriPkgIniCache.ReferenceCount > 0) {
+            return;
+        }
+
+        YoriLibFreeStringContents(&YoriPkgIniCache.FileName);
+        YoriPkgIniCache.IniDocument = NULL;
+    }
+
+    YoriLibIniClose(IniDocument);
+}
+
 /**
  Given a fully qualified path to a package's INI file, extract package
  information.
@@ -191,59 +297,66 @@ YoriPkgGetPackageInfo(
 {
     YORI_STRING TempBuffer;
     DWORD MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
+    PVOID IniDocument;
+
+    if (!YoriPkgOpenIniFile(IniPath, &IniDocument)) {
+        return FALSE;
+    }
 
     if (!YoriLibAllocateString(&TempBuffer, 8 * MaxFieldSize)) {
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     YoriLibCloneString(PackageName, &TempBuffer);
     PackageName->LengthAllocated = MaxFieldSize;
 
-    PackageName->LengthInChars = GetPrivateProfileString(_T("Package"), _T("Name"), _T(""), PackageName->StartOfString, PackageName->LengthAllocated, IniPath->StartOfString);
+    PackageName->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("Name"), _T(""), PackageName->StartOfString, PackageName->LengthAllocated);
 
     YoriLibCloneString(PackageVersion, &TempBuffer);
     PackageVersion->StartOfString += 1 * MaxFieldSize;
     PackageVersion->LengthAllocated = MaxFieldSize;
 
-    PackageVersion->LengthInChars = GetPrivateProfileString(_T("Package"), _T("Version"), _T(""), PackageVersion->StartOfString, PackageVersion->LengthAllocated, IniPath->StartOfString);
+    PackageVersion->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("Version"), _T(""), PackageVersion->StartOfString, PackageVersion->LengthAllocated);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 2 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
 
-    PackageArch->LengthInChars = GetPrivateProfileString(_T("Package"), _T("Architecture"), _T(""), PackageArch->StartOfString, PackageArch->LengthAllocated, IniPath->StartOfString);
+    PackageArch->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("Architecture"), _T(""), PackageArch->StartOfString, PackageArch->LengthAllocated);
 
     YoriLibCloneString(MinimumOSBuild, &TempBuffer);
     MinimumOSBuild->StartOfString += 3 * MaxFieldSize;
     MinimumOSBuild->LengthAllocated = MaxFieldSize;
 
-    MinimumOSBuild->LengthInChars = GetPrivateProfileString(_T("Package"), _T("MinimumOSBuild"), _T(""), MinimumOSBuild->StartOfString, MinimumOSBuild->LengthAllocated, IniPath->StartOfString);
+    MinimumOSBuild->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("MinimumOSBuild"), _T(""), MinimumOSBuild->StartOfString, MinimumOSBuild->LengthAllocated);
 
     YoriLibCloneString(PackagePathForOlderBuilds, &TempBuffer);
     PackagePathForOlderBuilds->StartOfString += 4 * MaxFieldSize;
     PackagePathForOlderBuilds->LengthAllocated = MaxFieldSize;
 
-    PackagePathForOlderBuilds->LengthInChars = GetPrivateProfileString(_T("Package"), _T("PackagePathForOlderBuilds"), _T(""), PackagePathForOlderBuilds->StartOfString, PackagePathForOlderBuilds->LengthAllocated, IniPath->StartOfString);
+    PackagePathForOlderBuilds->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("PackagePathForOlderBuilds"), _T(""), PackagePathForOlderBuilds->StartOfString, PackagePathForOlderBuilds->LengthAllocated);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 5 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
 
-    UpgradePath->LengthInChars = GetPrivateProfileString(_T("Package"), _T("UpgradePath"), _T(""), UpgradePath->StartOfString, UpgradePath->LengthAllocated, IniPath->StartOfString);
+    UpgradePath->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("UpgradePath"), _T(""), UpgradePath->StartOfString, UpgradePath->LengthAllocated);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 6 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
 
-    SourcePath->LengthInChars = GetPrivateProfileString(_T("Package"), _T("SourcePath"), _T(""), SourcePath->StartOfString, SourcePath->LengthAllocated, IniPath->StartOfString);
+    SourcePath->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("SourcePath"), _T(""), SourcePath->StartOfString, SourcePath->LengthAllocated);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 7 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
 
-    SymbolPath->LengthInChars = GetPrivateProfileString(_T("Package"), _T("SymbolPath"), _T(""), SymbolPath->StartOfString, SymbolPath->LengthAllocated, IniPath->StartOfString);
+    SymbolPath->LengthInChars = YoriLibIniGetString(IniDocument, _T("Package"), _T("SymbolPath"), _T(""), SymbolPath->StartOfString, SymbolPath->LengthAllocated);
 
     YoriLibFreeStringContents(&TempBuffer);
+    YoriPkgCloseIniFile(IniDocument);
     return TRUE;
 }
 
@@ -286,44 +399,51 @@ YoriPkgGetInstalledPackageInfo(
 {
     YORI_STRING TempBuffer;
     DWORD MaxFieldSize = YORIPKG_MAX_FIELD_LENGTH;
+    PVOID IniDocument;
 
     ASSERT(YoriLibIsStringNullTerminated(IniPath));
     ASSERT(YoriLibIsStringNullTerminated(PackageName));
 
+    if (!YoriPkgOpenIniFile(IniPath, &IniDocument)) {
+        return FALSE;
+    }
+
     if (!YoriLibAllocateString(&TempBuffer, 5 * MaxFieldSize)) {
+        YoriPkgCloseIniFile(IniDocument);
         return FALSE;
     }
 
     YoriLibCloneString(PackageVersion, &TempBuffer);
     PackageVersion->LengthAllocated = MaxFieldSize;
 
-    PackageVersion->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("Version"), _T(""), PackageVersion->StartOfString, PackageVersion->LengthAllocated, IniPath->StartOfString);
+    PackageVersion->LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("Version"), _T(""), PackageVersion->StartOfString, PackageVersion->LengthAllocated);
 
     YoriLibCloneString(PackageArch, &TempBuffer);
     PackageArch->StartOfString += 1 * MaxFieldSize;
     PackageArch->LengthAllocated = MaxFieldSize;
 
-    PackageArch->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("Architecture"), _T(""), PackageArch->StartOfString, PackageArch->LengthAllocated, IniPath->StartOfString);
+    PackageArch->LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("Architecture"), _T(""), PackageArch->StartOfString, PackageArch->LengthAllocated);
 
     YoriLibCloneString(UpgradePath, &TempBuffer);
     UpgradePath->StartOfString += 2 * MaxFieldSize;
     UpgradePath->LengthAllocated = MaxFieldSize;
 
-    UpgradePath->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("UpgradePath"), _T(""), UpgradePath->StartOfString, UpgradePath->LengthAllocated, IniPath->StartOfString);
+    UpgradePath->LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("UpgradePath"), _T(""), UpgradePath->StartOfString, UpgradePath->LengthAllocated);
 
     YoriLibCloneString(SourcePath, &TempBuffer);
     SourcePath->StartOfString += 3 * MaxFieldSize;
     SourcePath->LengthAllocated = MaxFieldSize;
 
-    SourcePath->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("SourcePath"), _T(""), SourcePath->StartOfString, SourcePath->LengthAllocated, IniPath->StartOfString);
+    SourcePath->LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("SourcePath"), _T(""), SourcePath->StartOfString, SourcePath->LengthAllocated);
 
     YoriLibCloneString(SymbolPath, &TempBuffer);
     SymbolPath->StartOfString += 4 * MaxFieldSize;
     SymbolPath->LengthAllocated = MaxFieldSize;
 
-    SymbolPath->LengthInChars = GetPrivateProfileString(PackageName->StartOfString, _T("SymbolPath"), _T(""), SymbolPath->StartOfString, SymbolPath->LengthAllocated, IniPath->StartOfString);
+    SymbolPath->LengthInChars = YoriLibIniGetString(IniDocument, PackageName->StartOfString, _T("SymbolPath"), _T(""), SymbolPath->StartOfString, SymbolPath->LengthAllocated);
 
     YoriLibFreeStringContents(&TempBuffer);
+    YoriPkgCloseIniFile(IniDocument);
     return TRUE;
 }
 
@@ -374,6 +494,7 @@ YoriPkgLoadMirrorsFromIni(
     BOOL Result = FALSE;
     DWORD Index;
     PYORIPKG_MIRROR Mirror;
+    PVOID IniDocument;
 
     YoriLibInitEmptyString(&IniSection);
     YoriLibInitEmptyString(&Find);
@@ -383,7 +504,12 @@ YoriPkgLoadMirrorsFromIni(
         goto Exit;
     }
 
-    IniSection.LengthInChars = GetPrivateProfileSection(_T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated, IniFilePath->StartOfString);
+    if (!YoriPkgOpenIniFile(IniFilePath, &IniDocument)) {
+        goto Exit;
+    }
+
+    IniSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated);
+    YoriPkgCloseIniFile(IniDocument);
 
     ThisLine = IniSection.StartOfString;
 
@@ -551,6 +677,8 @@ YoriPkgAddNewMirror(
     PYORIPKG_MIRROR NewMirror;
     YORI_STRING PackagesIni;
     DWORD Index;
+    PVOID IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&MirrorsList);
 
@@ -558,7 +686,13 @@ YoriPkgAddNewMirror(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PackagesIni, &IniDocument)) {
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
     if (!YoriPkgLoadMirrorsFromIni(&PackagesIni, &MirrorsList)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
@@ -569,6 +703,8 @@ YoriPkgAddNewMirror(
 
     NewMirror = YoriLibReferencedMalloc(sizeof(YORIPKG_MIRROR) + (SourceName->LengthInChars + 1 + TargetName->LengthInChars + 1) * sizeof(TCHAR));
     if (NewMirror == NULL) {
+        YoriPkgFreeMirrorList(&MirrorsList);
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
@@ -650,22 +786,25 @@ YoriPkgAddNewMirror(
     //  Rewrite the section
     //
 
-    WritePrivateProfileString(_T("Mirrors"), NULL, NULL, PackagesIni.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Mirrors"), NULL, NULL);
     MirrorEntry = NULL;
     MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
     while (MirrorEntry != NULL) {
         Mirror = CONTAINING_RECORD(MirrorEntry, YORIPKG_MIRROR, MirrorList);
         MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
-        WritePrivateProfileString(_T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString, PackagesIni.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString);
     }
 
+    Result = YoriLibIniCommit(IniDocument);
+
     //
     //  Free the mirrors we found.
     //
 
     YoriPkgFreeMirrorList(&MirrorsList);
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PackagesIni);
-    return TRUE;
+    return Result;
 }
 
 /**
@@ -685,6 +824,8 @@ YoriPkgDeleteMirror(
     PYORIPKG_MIRROR Mirror;
     YORI_STRING PackagesIni;
     DWORD Index;
+    PVOID IniDocument;
+    BOOL Result;
 
     YoriLibInitializeListHead(&MirrorsList);
 
@@ -692,7 +833,13 @@ YoriPkgDeleteMirror(
         return FALSE;
     }
 
+    if (!YoriPkgOpenIniFile(&PackagesIni, &IniDocument)) {
+        YoriLibFreeStringContents(&PackagesIni);
+        return FALSE;
+    }
+
     if (!YoriPkgLoadMirrorsFromIni(&PackagesIni, &MirrorsList)) {
+        YoriPkgCloseIniFile(IniDocument);
         YoriLibFreeStringContents(&PackagesIni);
         return FALSE;
     }
@@ -734,22 +881,25 @@ YoriPkgDeleteMirror(
     //  Rewrite the section
     //
 
-    WritePrivateProfileString(_T("Mirrors"), NULL, NULL, PackagesIni.StartOfString);
+    YoriLibIniSetString(IniDocument, _T("Mirrors"), NULL, NULL);
     MirrorEntry = NULL;
     MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
     while (MirrorEntry != NULL) {
         Mirror = CONTAINING_RECORD(MirrorEntry, YORIPKG_MIRROR, MirrorList);
         MirrorEntry = YoriLibGetNextListEntry(&MirrorsList, MirrorEntry);
-        WritePrivateProfileString(_T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString, PackagesIni.StartOfString);
+        YoriLibIniSetString(IniDocument, _T("Mirrors"), Mirror->SourceName.StartOfString, Mirror->TargetName.StartOfString);
     }
 
+    Result = YoriLibIniCommit(IniDocument);
+
     //
     //  Free the mirrors we found.
     //
 
     YoriPkgFreeMirrorList(&MirrorsList);
+    YoriPkgCloseIniFile(IniDocument);
     YoriLibFreeStringContents(&PackagesIni);
-    return TRUE;
+    return Result;
 }
 
 
@@ -788,6 +938,7 @@ YoriPkgConvertUserPackagePathToMirroredPath(
     BOOL Result = FALSE;
     BOOL ReturnHumanPathIfNoMirrorFound = FALSE;
     DWORD Index;
+    PVOID IniDocument;
 
     YoriLibInitEmptyString(&IniSection);
     YoriLibInitEmptyString(&HumanFullPath);
@@ -808,7 +959,12 @@ YoriPkgConvertUserPackagePathToMirroredPath(
         YoriLibCloneString(&HumanFullPath, PackagePath);
     }
 
-    IniSection.LengthInChars = GetPrivateProfileSection(_T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated, IniFilePath->StartOfString);
+    if (!YoriPkgOpenIniFile(IniFilePath, &IniDocument)) {
+        goto Exit;
+    }
+
+    IniSection.LengthInChars = YoriLibIniGetSection(IniDocument, _T("Mirrors"), IniSection.StartOfString, IniSection.LengthAllocated);
+    YoriPkgCloseIniFile(IniDocument);
 
     ThisLine = IniSection.StartOfString;
 
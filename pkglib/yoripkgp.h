@@ -129,6 +129,12 @@ typedef struct _YORIPKG_EXISTING_FILE {
      */
     YORI_HASH_ENTRY HashEntry;
 
+    /**
+     The linkage for this file within the list of installed files.  Paired
+     with @ref YORIPKG_PACKAGES_PENDING_INSTALL::ExistingFilesList .
+     */
+    YORI_LIST_ENTRY ListEntry;
+
     /**
      The relative name for the file.  This string contains a reference on
      the parent structure.
@@ -173,6 +179,13 @@ typedef struct _YORIPKG_PACKAGES_PENDING_INSTALL {
      */
     PYORI_HASH_TABLE ExistingFilesTable;
 
+    /**
+     A list of files that are currently installed by other packages, used to
+     free the entries in @ref ExistingFilesTable .  Paired with
+     @ref YORIPKG_EXISTING_FILE::ListEntry .
+     */
+    YORI_LIST_ENTRY ExistingFilesList;
+
 } YORIPKG_PACKAGES_PENDING_INSTALL, *PYORIPKG_PACKAGES_PENDING_INSTALL;
 
 /**
@@ -259,6 +272,13 @@ typedef struct _YORIPKG_PACKAGE_PENDING_INSTALL {
  */
 #define YORIPKG_MAX_SECTION_LENGTH (64 * 1024)
 
+/**
+ The number of files to extract from a package between writes of the
+ installed file list, which bounds the number of extracted files that are
+ not recorded if the process terminates during installation.
+ */
+#define YORIPKG_FILES_PER_COMMIT (32)
+
 __success(return)
 BOOL
 YoriPkgGetExecutableFile(
@@ -278,6 +298,18 @@ YoriPkgGetPackageIniFile(
     __out PYORI_STRING IniFileName
     );
 
+__success(return)
+BOOL
+YoriPkgOpenIniFile(
+    __in PYORI_STRING IniPath,
+    __out PVOID *IniDocument
+    );
+
+VOID
+YoriPkgCloseIniFile(
+    __in PVOID IniDocument
+    );
+
 __success(return)
 BOOL
 YoriPkgGetPackageInfo(
@@ -399,7 +399,10 @@ SdirParseOpt (
         } else {
         }
     } else if (Opt[0] == 'p') {
-        if (Opt[1] == 'n') {
+        if (_tcsicmp(Opt, _T("perf")) == 0) {
+            Opts->PerfDisplay = TRUE;
+            OptParsed = TRUE;
+        } else if (Opt[1] == 'n') {
             Opts->EnablePause = FALSE;
             OptParsed = TRUE;
         } else if (Opt[1] == '\0') {
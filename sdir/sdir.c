@@ -87,6 +87,9 @@ SDIR_GLOBAL SdirGlobal;
 BOOL
 SdirDisplayCollection();
 
+BOOL
+SdirSortCollection();
+
 /**
  Capture all required information from a file found by the system into a
  directory entry.
@@ -213,8 +216,6 @@ SdirAddToCollection (
     ) 
 {
     PYORI_FILE_INFO CurrentEntry;
-    DWORD i, j;
-    DWORD CompareResult = 0;
 
     if (SdirDirCollectionCurrent >= SdirAllocatedDirents) {
         if (SdirDirCollectionCurrent < UINT_MAX) {
@@ -246,46 +247,161 @@ SdirAddToCollection (
     }
 
     //
-    //  Now that our internal entry is fully poulated, insert it into the
-    //  correct sorted position.  As an optimization, check if we just need
-    //  to insert at the end (for file name sort on NTFS, this is the
-    //  common case.)
+    //  Entries are appended in enumeration order.  The sorted array is
+    //  ordered in a single pass by @ref SdirSortCollection once the
+    //  collection is complete.
     //
 
-    if (SdirDirCollectionCurrent > 1 &&
-        Opts->Sort[0].CompareFn(SdirDirSorted[SdirDirCollectionCurrent - 2], CurrentEntry) == Opts->Sort[0].CompareInverseCondition) {
+    SdirDirSorted[SdirDirCollectionCurrent - 1] = CurrentEntry;
+    return TRUE;
+}
+
+/**
+ Compare two directory entries using the full set of user specified sort
+ criteria.
+
+ @param Left Pointer to the first entry to compare.
+
+ @param Right Pointer to the second entry to compare.
 
-        SdirDirSorted[SdirDirCollectionCurrent - 1] = CurrentEntry;
+ @return YORI_LIB_LESS_THAN if Left should be displayed before Right,
+         YORI_LIB_GREATER_THAN if Right should be displayed before Left,
+         or YORI_LIB_EQUAL if the criteria do not distinguish them.
+ */
+DWORD
+SdirCompareCollectionEntries(
+    __in PYORI_FILE_INFO Left,
+    __in PYORI_FILE_INFO Right
+    )
+{
+    DWORD CompareResult;
+    DWORD Index;
+
+    for (Index = 0; Index < Opts->CurrentSort; Index++) {
+        CompareResult = Opts->Sort[Index].CompareFn(Left, Right);
+
+        if (CompareResult == Opts->Sort[Index].CompareBreakCondition) {
+            return YORI_LIB_GREATER_THAN;
+        }
+        if (CompareResult == Opts->Sort[Index].CompareInverseCondition) {
+            return YORI_LIB_LESS_THAN;
+        }
+    }
+
+    return YORI_LIB_EQUAL;
+}
+
+/**
+ Sort the array of pointers to collected entries according to the user's
+ sort criteria.  This is a bottom up merge sort, so it requires O(n log n)
+ comparisons and is stable, meaning entries that compare equal are
+ displayed in the order they were enumerated.  Since the common case is
+ a name sort on a file system that returns entries in name order, the
+ array is checked first and left alone if it is already in order.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+BOOL
+SdirSortCollection()
+{
+    PYORI_FILE_INFO * Source;
+    PYORI_FILE_INFO * Target;
+    PYORI_FILE_INFO * Swap;
+    PYORI_FILE_INFO * Scratch;
+    DWORD Count;
+    DWORD Width;
+    DWORD Start;
+    DWORD Middle;
+    DWORD End;
+    DWORD LeftIndex;
+    DWORD RightIndex;
+    DWORD TargetIndex;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+
+    Count = SdirDirCollectionCurrent;
+    if (Count > SdirAllocatedDirents) {
+        Count = SdirAllocatedDirents;
+    }
+
+    if (Count < 2) {
         return TRUE;
     }
 
-    //
-    //  Currently sorting is done very inefficiently by a selection sort
-    //  type algorithm.  Generally this doesn't run due to the optimization
-    //  above.  When a different sort order is requested, performance could
-    //  be improved by using a better algorithm here.
-    //
+    QueryPerformanceCounter(&StartTime);
 
-    for (i = 0; i < SdirDirCollectionCurrent - 1; i++) {
+    for (LeftIndex = 1; LeftIndex < Count; LeftIndex++) {
+        if (SdirCompareCollectionEntries(SdirDirSorted[LeftIndex - 1], SdirDirSorted[LeftIndex]) == YORI_LIB_GREATER_THAN) {
+            break;
+        }
+    }
 
-        for (j = 0; j < Opts->CurrentSort; j++) {
-            CompareResult = Opts->Sort[j].CompareFn(SdirDirSorted[i], CurrentEntry);
+    if (LeftIndex == Count) {
+        QueryPerformanceCounter(&EndTime);
+        SdirGlobal.TimeSorting.QuadPart += EndTime.QuadPart - StartTime.QuadPart;
+        return TRUE;
+    }
 
-            if (CompareResult == Opts->Sort[j].CompareBreakCondition ||
-                CompareResult == Opts->Sort[j].CompareInverseCondition) {
-                break;
+    Scratch = YoriLibMalloc(Count * sizeof(PYORI_FILE_INFO));
+    if (Scratch == NULL) {
+        SdirDisplayError(GetLastError(), _T("YoriLibMalloc"));
+        return FALSE;
+    }
+
+    Source = SdirDirSorted;
+    Target = Scratch;
+
+    for (Width = 1; Width < Count; Width = Width * 2) {
+        for (Start = 0; Start < Count; Start = End) {
+            Middle = Start + Width;
+            if (Middle > Count) {
+                Middle = Count;
+            }
+            End = Middle + Width;
+            if (End > Count || End < Middle) {
+                End = Count;
             }
-        }
 
-        if (CompareResult == Opts->Sort[j].CompareBreakCondition) {
-            for (j = SdirDirCollectionCurrent - 1; j > i; j--) {
-                SdirDirSorted[j] = SdirDirSorted[j - 1];
+            LeftIndex = Start;
+            RightIndex = Middle;
+            TargetIndex = Start;
+
+            //
+            //  Take from the left run unless the right run has an entry
+            //  that strictly sorts earlier, which preserves enumeration
+            //  order for equal entries.
+            //
+
+            while (LeftIndex < Middle && RightIndex < End) {
+                if (SdirCompareCollectionEntries(Source[LeftIndex], Source[RightIndex]) == YORI_LIB_GREATER_THAN) {
+                    Target[TargetIndex++] = Source[RightIndex++];
+                } else {
+                    Target[TargetIndex++] = Source[LeftIndex++];
+                }
+            }
+
+            while (LeftIndex < Middle) {
+                Target[TargetIndex++] = Source[LeftIndex++];
+            }
+
+            while (RightIndex < End) {
+                Target[TargetIndex++] = Source[RightIndex++];
             }
-            SdirDirSorted[i] = CurrentEntry;
-            return TRUE;
         }
+
+        Swap = Source;
+        Source = Target;
+        Target = Swap;
     }
-    SdirDirSorted[SdirDirCollectionCurrent - 1] = CurrentEntry;
+
+    if (Source != SdirDirSorted) {
+        memcpy(SdirDirSorted, Source, Count * sizeof(PYORI_FILE_INFO));
+    }
+
+    YoriLibFree(Scratch);
+
+    QueryPerformanceCounter(&EndTime);
+    SdirGlobal.TimeSorting.QuadPart += EndTime.QuadPart - StartTime.QuadPart;
     return TRUE;
 }
 
@@ -1300,18 +1416,31 @@ SdirEnumerateAndDisplay (
     __in YORI_STRING ArgV[]
     )
 {
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+
+    QueryPerformanceCounter(&StartTime);
     if (!SdirForEachPathSpec(ArgC, ArgV, SdirEnumeratePath)) {
         return FALSE;
     }
+    QueryPerformanceCounter(&EndTime);
+    SdirGlobal.TimeEnumerating.QuadPart += EndTime.QuadPart - StartTime.QuadPart;
 
     if (SdirDirCollectionCurrent == 0) {
         SdirDisplayError(ERROR_FILE_NOT_FOUND, NULL);
         return FALSE;
     }
 
+    if (!SdirSortCollection()) {
+        return FALSE;
+    }
+
+    QueryPerformanceCounter(&StartTime);
     if (!SdirDisplayCollection()) {
         return FALSE;
     }
+    QueryPerformanceCounter(&EndTime);
+    SdirGlobal.TimeDisplaying.QuadPart += EndTime.QuadPart - StartTime.QuadPart;
     
     return TRUE;
 }
@@ -1353,6 +1482,8 @@ SdirEnumerateAndDisplaySubtree (
     WIN32_FIND_DATA FindData;
     SDIR_SUMMARY SummaryOnEntry;
     LPTSTR szFormatStr;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
 
     YoriLibInitEmptyString(&ParentDirectory);
     YoriLibInitEmptyString(&SearchCriteria);
@@ -1400,6 +1531,7 @@ SdirEnumerateAndDisplaySubtree (
         return FALSE;
     }
 
+    QueryPerformanceCounter(&StartTime);
     if (!SdirEnumeratePathWithDepth(&NextSubDir, Depth)) {
         DWORD Err = GetLastError();
         if (SdirIsReportableError(Err)) {
@@ -1412,6 +1544,8 @@ SdirEnumerateAndDisplaySubtree (
             return FALSE;
         }
     }
+    QueryPerformanceCounter(&EndTime);
+    SdirGlobal.TimeEnumerating.QuadPart += EndTime.QuadPart - StartTime.QuadPart;
 
     //
     //  If we have something to display, display it.
@@ -1436,10 +1570,18 @@ SdirEnumerateAndDisplaySubtree (
             return FALSE;
         }
 
+        if (!SdirSortCollection()) {
+            YoriLibFreeStringContents(&NextSubDir);
+            return FALSE;
+        }
+
+        QueryPerformanceCounter(&StartTime);
         if (!SdirDisplayCollection()) {
             YoriLibFreeStringContents(&NextSubDir);
             return FALSE;
         }
+        QueryPerformanceCounter(&EndTime);
+        SdirGlobal.TimeDisplaying.QuadPart += EndTime.QuadPart - StartTime.QuadPart;
     }
 
     //
@@ -1616,6 +1758,9 @@ ENTRYPOINT(
     SdirDirCollectionLongest = 0;
     SdirDirCollectionTotalNameLength = 0;
     SdirWriteStringLinesDisplayed = 0;
+    SdirGlobal.TimeEnumerating.QuadPart = 0;
+    SdirGlobal.TimeSorting.QuadPart = 0;
+    SdirGlobal.TimeDisplaying.QuadPart = 0;
 
     if (!SdirInit(ArgC, ArgV)) {
         goto restore_and_exit;
@@ -1640,6 +1785,19 @@ ENTRYPOINT(
         SdirDisplaySummary(Opts->FtSummary.HighlightColor);
     }
 
+    if (Opts->PerfDisplay) {
+        LARGE_INTEGER Frequency;
+        QueryPerformanceFrequency(&Frequency);
+
+        SdirGlobal.TimeEnumerating.QuadPart = SdirGlobal.TimeEnumerating.QuadPart * 1000 / Frequency.QuadPart;
+        SdirGlobal.TimeSorting.QuadPart = SdirGlobal.TimeSorting.QuadPart * 1000 / Frequency.QuadPart;
+        SdirGlobal.TimeDisplaying.QuadPart = SdirGlobal.TimeDisplaying.QuadPart * 1000 / Frequency.QuadPart;
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("\n"));
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Time enumerating: %lli ms\n"), SdirGlobal.TimeEnumerating.QuadPart);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Time sorting: %lli ms\n"), SdirGlobal.TimeSorting.QuadPart);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Time displaying: %lli ms\n"), SdirGlobal.TimeDisplaying.QuadPart);
+    }
+
 restore_and_exit:
 
     if (Opts != NULL) {
@@ -498,6 +498,12 @@ typedef struct _SDIR_OPTS {
      */
     BOOLEAN         BasicEnumeration:1;
 
+    /**
+     TRUE if the time spent enumerating, sorting and displaying should be
+     reported on completion.
+     */
+    BOOLEAN         PerfDisplay:1;
+
     /**
      The color attributes from when the program was started, that should
      be restored on exit.
@@ -662,6 +668,24 @@ typedef struct _SDIR_GLOBAL {
      which files to hide.
      */
     YORI_LIB_FILE_FILTER FileHideCriteria;
+
+    /**
+     The amount of time spent enumerating files, in performance counter
+     units.
+     */
+    LARGE_INTEGER TimeEnumerating;
+
+    /**
+     The amount of time spent sorting enumerated files, in performance
+     counter units.
+     */
+    LARGE_INTEGER TimeSorting;
+
+    /**
+     The amount of time spent rendering sorted files, in performance counter
+     units.
+     */
+    LARGE_INTEGER TimeDisplaying;
 } SDIR_GLOBAL, *PSDIR_GLOBAL;
 
 extern SDIR_GLOBAL SdirGlobal;
@@ -477,6 +477,13 @@ YoriShExecuteInProc(
     YoriShGlobal.EscapedCmdContext = OriginalCmdContext;
     YoriShGlobal.RecursionDepth++;
     ExitCode = Fn(ArgC, ArgV);
+
+    //
+    //  If the builtin buffered its output, write it out now, before the
+    //  handles it was writing to are closed.
+    //
+
+    YoriLibOutputDisableBuffering();
     YoriShGlobal.RecursionDepth--;
     YoriShGlobal.EscapedCmdContext = SavedEscapedCmdContext;
     YoriShRevertRedirection(&PreviousRedirectContext);
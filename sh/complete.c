@@ -123,6 +123,8 @@ YoriShPerformHistoryTabCompletion(
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
     PYORI_SH_TAB_COMPLETE_MATCH Match;
     PYORI_HASH_ENTRY PriorEntry;
+    YORI_STRING Prefix;
+    DWORD OffsetOfMatch;
 
     UNREFERENCED_PARAMETER(ExpandFullPath);
 
@@ -138,6 +140,10 @@ YoriShPerformHistoryTabCompletion(
     }
     FoundPath = NULL;
 
+    YoriLibInitEmptyString(&Prefix);
+    Prefix.StartOfString = TabContext->SearchString.StartOfString;
+    Prefix.LengthInChars = CompareLength;
+
     //
     //  Search the list of history.
     //
@@ -146,6 +152,19 @@ YoriShPerformHistoryTabCompletion(
     while (ListEntry != NULL) {
         HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
 
+        //
+        //  Skip directly to the next entry containing the prefix, which can
+        //  use the history index rather than comparing every entry.
+        //
+
+        if (Prefix.LengthInChars > 0) {
+            HistoryEntry = YoriShFindHistoryEntryContaining(&Prefix, HistoryEntry, &OffsetOfMatch);
+            if (HistoryEntry == NULL) {
+                break;
+            }
+            ListEntry = &HistoryEntry->ListEntry;
+        }
+
         if (YoriLibCompareStringInsensitiveCount(&HistoryEntry->CmdLine, &TabContext->SearchString, CompareLength) == 0) {
 
             //
@@ -466,15 +485,21 @@ YoriShPerformExecutableTabCompletion(
 
     //
     //  Secondly, search for the object in the PATH, resuming after the
-    //  previous search
+    //  previous search.  If the path cache is current, it can answer this
+    //  without touching the disk.
     //
 
-    YoriLibInitEmptyString(&FoundExecutable);
-    Result = YoriLibLocateExecutableInPath(&SearchString,
-                                           YoriShAddExecutableToTabList,
-                                           &ExecTabContext,
-                                           &FoundExecutable);
-    ASSERT(FoundExecutable.StartOfString == NULL);
+    if (!YoriShPathCacheFindExecutables(&SearchString,
+                                        YoriShAddExecutableToTabList,
+                                        &ExecTabContext)) {
+
+        YoriLibInitEmptyString(&FoundExecutable);
+        Result = YoriLibLocateExecutableInPath(&SearchString,
+                                               YoriShAddExecutableToTabList,
+                                               &ExecTabContext,
+                                               &FoundExecutable);
+        ASSERT(FoundExecutable.StartOfString == NULL);
+    }
 
     //
     //  Thirdly, search the table of builtins.
@@ -1014,12 +1039,17 @@ YoriShFindMatchingStreamsForStringOrCursorPosition(
     DWORD Index;
 
     //
-    //  First check for a match for the whole string
+    //  First check for a match for the whole string.  A simple prefix in
+    //  the current directory can be answered by the path cache.
     //
 
     EnumContext->SearchString = SearchString->StartOfString;
-    if (!YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext)) {
-        return;
+    if (EnumContext->ExpandFullPath ||
+        !YoriShPathCacheFindFiles(SearchString, MatchFlags, YoriShFileTabCompletionCallback, EnumContext)) {
+
+        if (!YoriLibForEachStream(SearchString, MatchFlags, 0, YoriShFileTabCompletionCallback, YoriShFileTabCompletionErrorCallback, EnumContext)) {
+            return;
+        }
     }
 
     if (EnumContext->AbortMatching) {
@@ -1947,6 +1977,15 @@ YoriShPopulateTabCompletionMatches(
     YoriLibInitializeListHead(&Buffer->TabContext.MatchList);
     Buffer->TabContext.PreviousMatch = NULL;
 
+    //
+    //  Make sure the path cache knows about the current directory and
+    //  path.  Anything it hasn't loaded yet is searched on disk.
+    //
+
+    if (!SearchHistory) {
+        YoriShPathCacheRefresh();
+    }
+
     if (CmdContext->CurrentArg < CmdContext->ArgC) {
         memcpy(&CurrentArgString, &CmdContext->ArgV[CmdContext->CurrentArg], sizeof(YORI_STRING));
     }
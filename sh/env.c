@@ -93,6 +93,8 @@ YoriShGetEnvironmentVariableWithoutSubstitution(
             Length = YoriLibSPrintfS(NumString, sizeof(NumString)/sizeof(NumString[0]), _T("%i"), YoriShGlobal.PreviousJobId);
             Length++;
         }
+    } else if (tcsicmp(Name, _T("YORIPATHCACHE")) == 0) {
+        Length = YoriShPathCacheGetStatistics(Variable, Size);
     } else if (tcsicmp(Name, _T("YORIPID")) == 0) {
         if (Variable != NULL) {
             Length = YoriLibSPrintfS(Variable, Size, _T("0x%x"), GetCurrentProcessId());
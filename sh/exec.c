@@ -1968,6 +1968,125 @@ YoriShExpandBackquotes(
     return TRUE;
 }
 
+/**
+ The number of previously parsed expressions to retain.
+ */
+#define YORI_SH_PARSE_CACHE_SLOTS (64)
+
+/**
+ A previously parsed expression, retained so that executing the same
+ expression again, as commonly happens when a script loops, does not need to
+ parse it again.
+ */
+typedef struct _YORI_SH_PARSE_CACHE_ENTRY {
+
+    /**
+     The expression that was parsed.
+     */
+    YORI_STRING Expression;
+
+    /**
+     The arguments parsed from the expression, before any environment
+     variables are expanded.
+     */
+    YORI_SH_CMD_CONTEXT CmdContext;
+} YORI_SH_PARSE_CACHE_ENTRY, *PYORI_SH_PARSE_CACHE_ENTRY;
+
+/**
+ Previously parsed expressions, indexed by a hash of the expression.
+ */
+YORI_SH_PARSE_CACHE_ENTRY YoriShParseCache[YORI_SH_PARSE_CACHE_SLOTS];
+
+/**
+ Free the contents of a single slot in the cache of parsed expressions.
+
+ @param CacheEntry Pointer to the slot to free.
+ */
+VOID
+YoriShFreeParseCacheEntry(
+    __in PYORI_SH_PARSE_CACHE_ENTRY CacheEntry
+    )
+{
+    if (CacheEntry->Expression.LengthInChars > 0) {
+        YoriShFreeCmdContext(&CacheEntry->CmdContext);
+    }
+    YoriLibFreeStringContents(&CacheEntry->Expression);
+}
+
+/**
+ Parse an expression into a command context and expand any environment
+ variables.  If the same expression has been parsed recently, the arguments
+ are referenced from the earlier parse.  Environment variables are expanded
+ each time, since their values may have changed.
+
+ @param Expression Pointer to the expression to parse.
+
+ @param CmdContext On successful completion, populated with the arguments
+        from the expression.  The caller should free this with
+        @ref YoriShFreeCmdContext .
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShParseCmdlineToCmdContextWithCache(
+    __in PYORI_STRING Expression,
+    __out PYORI_SH_CMD_CONTEXT CmdContext
+    )
+{
+    PYORI_SH_PARSE_CACHE_ENTRY CacheEntry;
+
+    CacheEntry = &YoriShParseCache[YoriLibHashString(Expression) % YORI_SH_PARSE_CACHE_SLOTS];
+
+    if (CacheEntry->Expression.LengthInChars > 0 &&
+        YoriLibCompareString(&CacheEntry->Expression, Expression) == 0) {
+
+        if (!YoriShCopyCmdContext(CmdContext, &CacheEntry->CmdContext)) {
+            return FALSE;
+        }
+        CmdContext->TrailingChars = CacheEntry->CmdContext.TrailingChars;
+    } else {
+        if (!YoriShParseCmdlineToCmdContext(Expression, 0, FALSE, CmdContext)) {
+            return FALSE;
+        }
+
+        //
+        //  Replace whatever was in this slot with the new expression.  If
+        //  this fails, the slot is left empty, which is harmless.
+        //
+
+        YoriShFreeParseCacheEntry(CacheEntry);
+        if (CmdContext->ArgC > 0 &&
+            YoriLibAllocateString(&CacheEntry->Expression, Expression->LengthInChars + 1)) {
+
+            if (YoriShCopyCmdContext(&CacheEntry->CmdContext, CmdContext)) {
+                CacheEntry->CmdContext.TrailingChars = CmdContext->TrailingChars;
+                memcpy(CacheEntry->Expression.StartOfString, Expression->StartOfString, Expression->LengthInChars * sizeof(TCHAR));
+                CacheEntry->Expression.StartOfString[Expression->LengthInChars] = '\0';
+                CacheEntry->Expression.LengthInChars = Expression->LengthInChars;
+            } else {
+                YoriLibFreeStringContents(&CacheEntry->Expression);
+            }
+        }
+    }
+
+    YoriShExpandEnvironmentVariablesInCmdContext(CmdContext);
+    return TRUE;
+}
+
+/**
+ Free all previously parsed expressions.
+ */
+VOID
+YoriShDiscardParseCache()
+{
+    DWORD Index;
+
+    for (Index = 0; Index < YORI_SH_PARSE_CACHE_SLOTS; Index++) {
+        YoriShFreeParseCacheEntry(&YoriShParseCache[Index]);
+    }
+}
+
 /**
  Parse and execute a command string.  This will internally perform parsing
  and redirection, as well as execute multiple subprocesses as needed.  This
@@ -2003,7 +2122,7 @@ YoriShExecuteExpression(
     //  Parse the expression we're trying to execute.
     //
 
-    if (!YoriShParseCmdlineToCmdContext(&CurrentFullExpression, 0, TRUE, &CmdContext)) {
+    if (!YoriShParseCmdlineToCmdContextWithCache(&CurrentFullExpression, &CmdContext)) {
         YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("Parse error\n"));
         YoriLibFreeStringContents(&CurrentFullExpression);
         return FALSE;
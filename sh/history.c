@@ -48,6 +48,426 @@ HANDLE YoriShHistoryLock;
  */
 BOOL YoriShHistoryInitialized;
 
+/**
+ The sequence number to assign to the next entry added to history.
+ */
+DWORD YoriShHistoryNextSequence;
+
+/**
+ The fully qualified name of the history file that commands are appended to
+ as they are entered.  This is empty if commands are only written when the
+ shell exits, or not written at all.
+ */
+YORI_STRING YoriShHistoryLogFile;
+
+/**
+ The number of times to attempt to append to the history file if another
+ process is holding it open exclusively, typically to compact it.
+ */
+#define YORI_SH_HISTORY_LOG_ATTEMPTS (5)
+
+/**
+ The number of characters in each key of the history index.
+ */
+#define YORI_SH_HISTORY_INDEX_KEY_LENGTH (3)
+
+/**
+ A set of history entries that all contain a specific sequence of characters.
+ */
+typedef struct _YORI_SH_HISTORY_INDEX_KEY {
+
+    /**
+     The entry for this key in the hash table of all keys.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The links of this key within the list of all keys, used to tear down
+     the index.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The characters that form this key.  The hash table refers to this
+     storage.
+     */
+    TCHAR KeyChars[YORI_SH_HISTORY_INDEX_KEY_LENGTH];
+
+    /**
+     The index of the first populated element in Entries.  Entries are
+     normally removed from the oldest end as history is trimmed, so this
+     allows that to happen without moving the remaining elements.
+     */
+    DWORD Start;
+
+    /**
+     The number of populated elements in Entries.
+     */
+    DWORD Count;
+
+    /**
+     The number of elements allocated in Entries.
+     */
+    DWORD Allocated;
+
+    /**
+     An array of history entries containing this key, in the order they were
+     added to history.
+     */
+    PYORI_SH_HISTORY_ENTRY *Entries;
+} YORI_SH_HISTORY_INDEX_KEY, *PYORI_SH_HISTORY_INDEX_KEY;
+
+/**
+ A hash table of each sequence of characters found in history, used to
+ quickly find entries containing a substring.  This is NULL until the first
+ substring search, and is maintained as entries are added or removed after
+ that point.
+ */
+PYORI_HASH_TABLE YoriShHistoryIndex;
+
+/**
+ A list of all keys in the history index.
+ */
+YORI_LIST_ENTRY YoriShHistoryIndexKeys;
+
+/**
+ Free the index of history entries.  Any subsequent search will rebuild it.
+ */
+VOID
+YoriShFreeHistoryIndex()
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_HISTORY_INDEX_KEY IndexKey;
+
+    if (YoriShHistoryIndex == NULL) {
+        return;
+    }
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShHistoryIndexKeys, NULL);
+    while (ListEntry != NULL) {
+        IndexKey = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_INDEX_KEY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShHistoryIndexKeys, ListEntry);
+        YoriLibRemoveListItem(&IndexKey->ListEntry);
+        YoriLibHashRemoveByEntry(&IndexKey->HashEntry);
+        if (IndexKey->Entries != NULL) {
+            YoriLibFree(IndexKey->Entries);
+        }
+        YoriLibFree(IndexKey);
+    }
+
+    YoriLibFreeEmptyHashTable(YoriShHistoryIndex);
+    YoriShHistoryIndex = NULL;
+}
+
+/**
+ Find the position within an index key of the first entry whose sequence
+ number is greater than or equal to a specified sequence number.
+
+ @param IndexKey Pointer to the index key to search.
+
+ @param Sequence The sequence number to search for.
+
+ @return The offset from the start of the populated range of the index key.
+         This is equal to the number of populated elements if all entries
+         are older than the specified sequence number.
+ */
+DWORD
+YoriShFindHistoryIndexPosition(
+    __in PYORI_SH_HISTORY_INDEX_KEY IndexKey,
+    __in DWORD Sequence
+    )
+{
+    DWORD Low;
+    DWORD High;
+    DWORD Mid;
+
+    Low = 0;
+    High = IndexKey->Count;
+    while (Low < High) {
+        Mid = Low + (High - Low) / 2;
+        if (IndexKey->Entries[IndexKey->Start + Mid]->Sequence < Sequence) {
+            Low = Mid + 1;
+        } else {
+            High = Mid;
+        }
+    }
+
+    return Low;
+}
+
+/**
+ Add a history entry to the index of history entries.  Entries must be added
+ in the order they were added to history.
+
+ @param HistoryEntry Pointer to the history entry to add.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShAddToHistoryIndex(
+    __in PYORI_SH_HISTORY_ENTRY HistoryEntry
+    )
+{
+    DWORD Index;
+    YORI_STRING KeyString;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_SH_HISTORY_INDEX_KEY IndexKey;
+    PYORI_SH_HISTORY_ENTRY *NewEntries;
+    DWORD NewAllocated;
+
+    YoriLibInitEmptyString(&KeyString);
+    KeyString.LengthInChars = YORI_SH_HISTORY_INDEX_KEY_LENGTH;
+
+    for (Index = 0; Index + YORI_SH_HISTORY_INDEX_KEY_LENGTH <= HistoryEntry->CmdLine.LengthInChars; Index++) {
+        KeyString.StartOfString = &HistoryEntry->CmdLine.StartOfString[Index];
+        HashEntry = YoriLibHashLookupByKey(YoriShHistoryIndex, &KeyString);
+        if (HashEntry == NULL) {
+            IndexKey = YoriLibMalloc(sizeof(YORI_SH_HISTORY_INDEX_KEY));
+            if (IndexKey == NULL) {
+                return FALSE;
+            }
+            ZeroMemory(IndexKey, sizeof(YORI_SH_HISTORY_INDEX_KEY));
+            memcpy(IndexKey->KeyChars, KeyString.StartOfString, YORI_SH_HISTORY_INDEX_KEY_LENGTH * sizeof(TCHAR));
+            KeyString.StartOfString = IndexKey->KeyChars;
+            if (!YoriLibHashInsertByKey(YoriShHistoryIndex, &KeyString, IndexKey, &IndexKey->HashEntry)) {
+                YoriLibFree(IndexKey);
+                return FALSE;
+            }
+            YoriLibAppendList(&YoriShHistoryIndexKeys, &IndexKey->ListEntry);
+        } else {
+            IndexKey = HashEntry->Context;
+
+            //
+            //  If the key occurs more than once in this entry, the entry
+            //  only needs to be recorded once.
+            //
+
+            if (IndexKey->Count > 0 &&
+                IndexKey->Entries[IndexKey->Start + IndexKey->Count - 1] == HistoryEntry) {
+
+                continue;
+            }
+        }
+
+        if (IndexKey->Start + IndexKey->Count >= IndexKey->Allocated) {
+
+            //
+            //  If most of the array is unused because old entries have been
+            //  removed, move the remaining entries back to the start.
+            //  Otherwise, grow it.
+            //
+
+            if (IndexKey->Start > IndexKey->Count) {
+                memmove(IndexKey->Entries, &IndexKey->Entries[IndexKey->Start], IndexKey->Count * sizeof(PYORI_SH_HISTORY_ENTRY));
+                IndexKey->Start = 0;
+            } else {
+                NewAllocated = IndexKey->Allocated * 2;
+                if (NewAllocated < 4) {
+                    NewAllocated = 4;
+                }
+                NewEntries = YoriLibMalloc(NewAllocated * sizeof(PYORI_SH_HISTORY_ENTRY));
+                if (NewEntries == NULL) {
+                    return FALSE;
+                }
+                if (IndexKey->Entries != NULL) {
+                    memcpy(NewEntries, &IndexKey->Entries[IndexKey->Start], IndexKey->Count * sizeof(PYORI_SH_HISTORY_ENTRY));
+                    YoriLibFree(IndexKey->Entries);
+                }
+                IndexKey->Entries = NewEntries;
+                IndexKey->Allocated = NewAllocated;
+                IndexKey->Start = 0;
+            }
+        }
+
+        IndexKey->Entries[IndexKey->Start + IndexKey->Count] = HistoryEntry;
+        IndexKey->Count++;
+    }
+
+    return TRUE;
+}
+
+/**
+ Remove a history entry from the index of history entries.
+
+ @param HistoryEntry Pointer to the history entry to remove.
+ */
+VOID
+YoriShRemoveFromHistoryIndex(
+    __in PYORI_SH_HISTORY_ENTRY HistoryEntry
+    )
+{
+    DWORD Index;
+    DWORD Position;
+    YORI_STRING KeyString;
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_SH_HISTORY_INDEX_KEY IndexKey;
+
+    YoriLibInitEmptyString(&KeyString);
+    KeyString.LengthInChars = YORI_SH_HISTORY_INDEX_KEY_LENGTH;
+
+    for (Index = 0; Index + YORI_SH_HISTORY_INDEX_KEY_LENGTH <= HistoryEntry->CmdLine.LengthInChars; Index++) {
+        KeyString.StartOfString = &HistoryEntry->CmdLine.StartOfString[Index];
+        HashEntry = YoriLibHashLookupByKey(YoriShHistoryIndex, &KeyString);
+        if (HashEntry == NULL) {
+            continue;
+        }
+
+        IndexKey = HashEntry->Context;
+        Position = YoriShFindHistoryIndexPosition(IndexKey, HistoryEntry->Sequence);
+
+        //
+        //  If the key occurs more than once in this entry, it may have been
+        //  removed already.
+        //
+
+        if (Position >= IndexKey->Count ||
+            IndexKey->Entries[IndexKey->Start + Position] != HistoryEntry) {
+
+            continue;
+        }
+
+        if (Position == 0) {
+            IndexKey->Start++;
+        } else {
+            memmove(&IndexKey->Entries[IndexKey->Start + Position],
+                    &IndexKey->Entries[IndexKey->Start + Position + 1],
+                    (IndexKey->Count - Position - 1) * sizeof(PYORI_SH_HISTORY_ENTRY));
+        }
+        IndexKey->Count--;
+
+        if (IndexKey->Count == 0) {
+            YoriLibRemoveListItem(&IndexKey->ListEntry);
+            YoriLibHashRemoveByEntry(&IndexKey->HashEntry);
+            YoriLibFree(IndexKey->Entries);
+            YoriLibFree(IndexKey);
+        }
+    }
+}
+
+/**
+ Build the index of history entries from all of the entries currently in
+ history.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShBuildHistoryIndex()
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_HISTORY_ENTRY HistoryEntry;
+
+    if (YoriShHistoryIndex != NULL) {
+        return TRUE;
+    }
+
+    YoriShHistoryIndex = YoriLibAllocateHashTable(4000);
+    if (YoriShHistoryIndex == NULL) {
+        return FALSE;
+    }
+    YoriLibInitializeListHead(&YoriShHistoryIndexKeys);
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
+    while (ListEntry != NULL) {
+        HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+        if (!YoriShAddToHistoryIndex(HistoryEntry)) {
+            YoriShFreeHistoryIndex();
+            return FALSE;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
+    }
+
+    return TRUE;
+}
+
+/**
+ Free a single history entry.  The entry is expected to have been removed
+ from the list of history entries and the history index already.
+
+ @param HistoryEntry Pointer to the history entry to free.
+ */
+VOID
+YoriShFreeHistoryEntry(
+    __in PYORI_SH_HISTORY_ENTRY HistoryEntry
+    )
+{
+    YoriLibFreeStringContents(&HistoryEntry->CmdLine);
+    YoriLibDereference(HistoryEntry);
+}
+
+/**
+ Append a command to the history file.  The file is opened for append only
+ so that each write is placed at the end of the file, even if another shell
+ process has written to it since.
+
+ @param CmdLine Pointer to the command to append.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShAppendToHistoryFile(
+    __in PYORI_STRING CmdLine
+    )
+{
+    HANDLE FileHandle;
+    DWORD Attempt;
+    BOOL Result;
+
+    for (Attempt = 0; TRUE; Attempt++) {
+        FileHandle = CreateFile(YoriShHistoryLogFile.StartOfString,
+                                FILE_APPEND_DATA,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL);
+
+        if (FileHandle != INVALID_HANDLE_VALUE) {
+            break;
+        }
+
+        if (GetLastError() != ERROR_SHARING_VIOLATION ||
+            Attempt + 1 >= YORI_SH_HISTORY_LOG_ATTEMPTS) {
+
+            return FALSE;
+        }
+
+        Sleep(20);
+    }
+
+    Result = YoriLibOutputToDevice(FileHandle, 0, _T("%y\n"), CmdLine);
+    CloseHandle(FileHandle);
+    return Result;
+}
+
+/**
+ Start appending commands to the history file as they are entered.  All
+ entries currently in history are assumed to be in the file already.
+
+ @param FilePath Pointer to the fully qualified path to the history file.
+        On success, this string is referenced by the history module.
+ */
+VOID
+YoriShStartHistoryFile(
+    __in PYORI_STRING FilePath
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_HISTORY_ENTRY HistoryEntry;
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
+    while (ListEntry != NULL) {
+        HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+        HistoryEntry->Logged = TRUE;
+        ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
+    }
+
+    YoriLibFreeStringContents(&YoriShHistoryLogFile);
+    YoriLibCloneString(&YoriShHistoryLogFile, FilePath);
+}
+
 /**
  Add an entered command into the command history buffer.
 
@@ -75,7 +495,13 @@ YoriShAddToHistory(
         return TRUE;
     }
 
-    LengthToAllocate = sizeof(YORI_SH_HISTORY_ENTRY);
+    //
+    //  The command is copied into the same allocation as the entry.  The
+    //  caller's buffer is typically sized for editing and would be much
+    //  larger than the command it contains.
+    //
+
+    LengthToAllocate = sizeof(YORI_SH_HISTORY_ENTRY) + (NewCmd->LengthInChars + 1) * sizeof(TCHAR);
 
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
 
@@ -95,16 +521,36 @@ YoriShAddToHistory(
             }
         }
 
-        NewHistoryEntry = YoriLibMalloc(LengthToAllocate);
+        NewHistoryEntry = YoriLibReferencedMalloc(LengthToAllocate);
         if (NewHistoryEntry == NULL) {
             ReleaseMutex(YoriShHistoryLock);
             return FALSE;
         }
 
-        YoriLibCloneString(&NewHistoryEntry->CmdLine, NewCmd);
+        YoriLibReference(NewHistoryEntry);
+        YoriLibInitEmptyString(&NewHistoryEntry->CmdLine);
+        NewHistoryEntry->CmdLine.MemoryToFree = NewHistoryEntry;
+        NewHistoryEntry->CmdLine.StartOfString = (LPTSTR)(NewHistoryEntry + 1);
+        NewHistoryEntry->CmdLine.LengthAllocated = NewCmd->LengthInChars + 1;
+        memcpy(NewHistoryEntry->CmdLine.StartOfString, NewCmd->StartOfString, NewCmd->LengthInChars * sizeof(TCHAR));
+        NewHistoryEntry->CmdLine.StartOfString[NewCmd->LengthInChars] = '\0';
+        NewHistoryEntry->CmdLine.LengthInChars = NewCmd->LengthInChars;
+        NewHistoryEntry->Sequence = YoriShHistoryNextSequence++;
+        NewHistoryEntry->Logged = FALSE;
 
         YoriLibAppendList(&YoriShGlobal.CommandHistory, &NewHistoryEntry->ListEntry);
         YoriShCommandHistoryCount++;
+
+        if (YoriShHistoryIndex != NULL &&
+            !YoriShAddToHistoryIndex(NewHistoryEntry)) {
+
+            YoriShFreeHistoryIndex();
+        }
+
+        if (YoriShHistoryLogFile.LengthInChars > 0) {
+            NewHistoryEntry->Logged = (BOOLEAN)YoriShAppendToHistoryFile(&NewHistoryEntry->CmdLine);
+        }
+
         while (YoriShCommandHistoryCount > YoriShCommandHistoryMax) {
             PYORI_LIST_ENTRY ListEntry;
             PYORI_SH_HISTORY_ENTRY OldHistoryEntry;
@@ -112,8 +558,10 @@ YoriShAddToHistory(
             ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
             OldHistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
             YoriLibRemoveListItem(ListEntry);
-            YoriLibFreeStringContents(&OldHistoryEntry->CmdLine);
-            YoriLibFree(OldHistoryEntry);
+            if (YoriShHistoryIndex != NULL) {
+                YoriShRemoveFromHistoryIndex(OldHistoryEntry);
+            }
+            YoriShFreeHistoryEntry(OldHistoryEntry);
             YoriShCommandHistoryCount--;
         }
         ReleaseMutex(YoriShHistoryLock);
@@ -134,15 +582,19 @@ YoriShRemoveOneHistoryEntry(
 {
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
         YoriLibRemoveListItem(&HistoryEntry->ListEntry);
-        YoriLibFreeStringContents(&HistoryEntry->CmdLine);
-        YoriLibFree(HistoryEntry);
+        if (YoriShHistoryIndex != NULL) {
+            YoriShRemoveFromHistoryIndex(HistoryEntry);
+        }
+        YoriShFreeHistoryEntry(HistoryEntry);
         YoriShCommandHistoryCount--;
         ReleaseMutex(YoriShHistoryLock);
     }
 }
 
 /**
- Free all command history.
+ Free all command history.  Since the history file no longer reflects the
+ history being retained, any subsequent commands are not appended to it, and
+ it is rewritten in full when the shell exits.
  */
 VOID
 YoriShClearAllHistory()
@@ -151,13 +603,14 @@ YoriShClearAllHistory()
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
 
     if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
+        YoriShFreeHistoryIndex();
+        YoriLibFreeStringContents(&YoriShHistoryLogFile);
         ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
         while (ListEntry != NULL) {
             HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
             ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
             YoriLibRemoveListItem(&HistoryEntry->ListEntry);
-            YoriLibFreeStringContents(&HistoryEntry->CmdLine);
-            YoriLibFree(HistoryEntry);
+            YoriShFreeHistoryEntry(HistoryEntry);
             YoriShCommandHistoryCount--;
         }
         ReleaseMutex(YoriShHistoryLock);
@@ -229,32 +682,25 @@ YoriShInitHistory()
 }
 
 /**
- Load history from a file if the user has requested this behavior by
- setting YORIHISTFILE.  Configure the maximum amount of history to retain
- if the user has requested this behavior by setting YORIHISTSIZE.
+ Return the fully qualified path to the history file if the user has
+ requested history be saved by setting YORIHISTFILE.
+
+ @param FilePath On successful completion, populated with the path to the
+        history file.  This is an empty string if the user has not
+        requested history be saved.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 __success(return)
 BOOL
-YoriShLoadHistoryFromFile()
+YoriShGetHistoryFilePath(
+    __out PYORI_STRING FilePath
+    )
 {
     DWORD EnvVarLength;
     YORI_STRING UserHistFileName;
-    YORI_STRING FilePath;
-    HANDLE FileHandle;
-    PVOID LineContext = NULL;
-    YORI_STRING LineString;
-
-    if (YoriShHistoryInitialized) {
-        return TRUE;
-    }
 
-    YoriShInitHistory();
-
-    //
-    //  Check if there's a file to load saved history from.
-    //
+    YoriLibInitEmptyString(FilePath);
 
     EnvVarLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIHISTFILE"), NULL, 0, NULL);
     if (EnvVarLength == 0) {
@@ -272,35 +718,115 @@ YoriShLoadHistoryFromFile()
         return FALSE;
     }
 
-    if (!YoriLibUserStringToSingleFilePath(&UserHistFileName, TRUE, &FilePath)) {
+    if (!YoriLibUserStringToSingleFilePath(&UserHistFileName, TRUE, FilePath)) {
         YoriLibFreeStringContents(&UserHistFileName);
         return FALSE;
     }
 
     YoriLibFreeStringContents(&UserHistFileName);
+    return TRUE;
+}
 
+/**
+ Load history from a file if the user has requested this behavior by
+ setting YORIHISTFILE.  Configure the maximum amount of history to retain
+ if the user has requested this behavior by setting YORIHISTSIZE.
+
+ Once loaded, each command is appended to the file as it is entered, so
+ multiple concurrent shells can share a history file without one
+ overwriting another.  Since the file only grows, when it contains much
+ more than the amount of history being retained it is rewritten here to
+ contain only the retained entries.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShLoadHistoryFromFile()
+{
+    YORI_STRING FilePath;
+    HANDLE FileHandle;
+    PVOID LineContext = NULL;
+    YORI_STRING LineString;
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_HISTORY_ENTRY HistoryEntry;
+    DWORD LinesRead;
+    BOOLEAN CanCompact;
+
+    //
+    //  If history has already been initialized, it was restored from a
+    //  previous instance of the shell which will have loaded the file
+    //  already.  Continue appending to it.
+    //
+
+    if (YoriShHistoryInitialized) {
+        if (YoriShGetHistoryFilePath(&FilePath)) {
+            if (FilePath.LengthInChars > 0) {
+                YoriShStartHistoryFile(&FilePath);
+            }
+            YoriLibFreeStringContents(&FilePath);
+        }
+        return TRUE;
+    }
+
+    YoriShInitHistory();
+
+    //
+    //  Check if there's a file to load saved history from.
+    //
+
+    if (!YoriShGetHistoryFilePath(&FilePath)) {
+        return FALSE;
+    }
+
+    if (FilePath.LengthInChars == 0) {
+        return TRUE;
+    }
+
+    //
+    //  Try to open the file exclusively for write so it can be compacted
+    //  after it is read.  If another shell is using it, read it without
+    //  compacting.
+    //
+
+    CanCompact = TRUE;
     FileHandle = CreateFile(FilePath.StartOfString,
-                            GENERIC_READ,
-                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ,
                             NULL,
                             OPEN_EXISTING,
                             FILE_ATTRIBUTE_NORMAL,
                             NULL);
 
+    if (FileHandle == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_NOT_FOUND) {
+        CanCompact = FALSE;
+        FileHandle = CreateFile(FilePath.StartOfString,
+                                GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL,
+                                NULL);
+    }
+
     if (FileHandle == NULL || FileHandle == INVALID_HANDLE_VALUE) {
         DWORD LastError = GetLastError();
-        if (LastError != ERROR_FILE_NOT_FOUND) {
+        if (LastError == ERROR_FILE_NOT_FOUND) {
+            YoriShStartHistoryFile(&FilePath);
+            YoriLibFreeStringContents(&FilePath);
+            return TRUE;
+        }
+        {
             LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
             YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("yori: open of %y failed: %s"), &FilePath, ErrText);
             YoriLibFreeWinErrorText(ErrText);
-            YoriLibFreeStringContents(&FilePath);
         }
+        YoriLibFreeStringContents(&FilePath);
         return FALSE;
     }
 
-    YoriLibFreeStringContents(&FilePath);
-
     YoriLibInitEmptyString(&LineString);
+    LinesRead = 0;
 
     while (TRUE) {
 
@@ -308,29 +834,46 @@ YoriShLoadHistoryFromFile()
             break;
         }
 
+        LinesRead++;
+
         //
-        //  If we fail to add to history, stop.  If it is added to history,
-        //  that string is now owned by the history buffer, so reinitialize
-        //  between lines.  The free below is really just a dereference.
+        //  If we fail to add to history, stop.  The history entry contains
+        //  a copy of the string, so the line buffer can be reused.
         //
 
         if (!YoriShAddToHistory(&LineString, FALSE)) {
             break;
         }
-
-        YoriLibFreeStringContents(&LineString);
-        YoriLibInitEmptyString(&LineString);
     }
 
     YoriLibLineReadClose(LineContext);
     YoriLibFreeStringContents(&LineString);
+
+    if (CanCompact && LinesRead > 2 * YoriShCommandHistoryCount) {
+        if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
+            SetFilePointer(FileHandle, 0, NULL, FILE_BEGIN);
+            ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
+            while (ListEntry != NULL) {
+                HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+                YoriLibOutputToDevice(FileHandle, 0, _T("%y\n"), &HistoryEntry->CmdLine);
+                ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
+            }
+            SetEndOfFile(FileHandle);
+            ReleaseMutex(YoriShHistoryLock);
+        }
+    }
+
     CloseHandle(FileHandle);
+    YoriShStartHistoryFile(&FilePath);
+    YoriLibFreeStringContents(&FilePath);
     return TRUE;
 }
 
 /**
  Write the current command history buffer to a file, if the user has requested
- this behavior by configuring the YORIHISTFILE environment variable.
+ this behavior by configuring the YORIHISTFILE environment variable.  If
+ commands have been appended to the file as they were entered, this only
+ writes any commands which could not be written at the time.
 
  @return TRUE to indicate success, FALSE to indicate failure.
  */
@@ -338,35 +881,47 @@ __success(return)
 BOOL
 YoriShSaveHistoryToFile()
 {
-    DWORD FileNameLength;
-    YORI_STRING UserHistFileName;
     YORI_STRING FilePath;
     HANDLE FileHandle;
     PYORI_LIST_ENTRY ListEntry;
     PYORI_SH_HISTORY_ENTRY HistoryEntry;
 
-    FileNameLength = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIHISTFILE"), NULL, 0, NULL);
-    if (FileNameLength == 0) {
-        return TRUE;
-    }
-
-    if (!YoriLibAllocateString(&UserHistFileName, FileNameLength)) {
+    if (!YoriShGetHistoryFilePath(&FilePath)) {
         return FALSE;
     }
 
-    UserHistFileName.LengthInChars = YoriShGetEnvironmentVariableWithoutSubstitution(_T("YORIHISTFILE"), UserHistFileName.StartOfString, UserHistFileName.LengthAllocated, NULL);
+    //
+    //  If the history file is the one being appended to, append anything
+    //  that is missing.  Either way, stop appending.
+    //
 
-    if (UserHistFileName.LengthInChars == 0 || UserHistFileName.LengthInChars >= UserHistFileName.LengthAllocated) {
-        YoriLibFreeStringContents(&UserHistFileName);
-        return FALSE;
-    }
+    if (YoriShHistoryLogFile.LengthInChars > 0) {
+        if (YoriLibCompareStringInsensitive(&FilePath, &YoriShHistoryLogFile) == 0) {
+            YoriLibFreeStringContents(&FilePath);
+            if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
+                ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, NULL);
+                while (ListEntry != NULL) {
+                    HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+                    if (!HistoryEntry->Logged) {
+                        HistoryEntry->Logged = (BOOLEAN)YoriShAppendToHistoryFile(&HistoryEntry->CmdLine);
+                    }
+                    ListEntry = YoriLibGetNextListEntry(&YoriShGlobal.CommandHistory, ListEntry);
+                }
+                YoriLibFreeStringContents(&YoriShHistoryLogFile);
+                ReleaseMutex(YoriShHistoryLock);
+            }
+            return TRUE;
+        }
 
-    if (!YoriLibUserStringToSingleFilePath(&UserHistFileName, TRUE, &FilePath)) {
-        YoriLibFreeStringContents(&UserHistFileName);
-        return FALSE;
+        if (WaitForSingleObject(YoriShHistoryLock, 0) == WAIT_OBJECT_0) {
+            YoriLibFreeStringContents(&YoriShHistoryLogFile);
+            ReleaseMutex(YoriShHistoryLock);
+        }
     }
 
-    YoriLibFreeStringContents(&UserHistFileName);
+    if (FilePath.LengthInChars == 0) {
+        return TRUE;
+    }
 
     FileHandle = CreateFile(FilePath.StartOfString,
                             GENERIC_WRITE,
@@ -407,6 +962,103 @@ YoriShSaveHistoryToFile()
     return TRUE;
 }
 
+/**
+ Find the most recent history entry containing a substring.  If the search
+ string is long enough, candidate entries are found through the history
+ index, which is built on first use; otherwise each entry is checked.
+
+ @param SearchString Pointer to the string to search for.  Comparison is
+        case insensitive.
+
+ @param StartFrom Optionally points to the most recent entry to consider.
+        If NULL, the search starts from the most recent entry in history.
+
+ @param OffsetOfMatch On successful completion, populated with the offset
+        within the entry's command of the match.
+
+ @return Pointer to the matching history entry, or NULL if no entry
+         contains the search string.
+ */
+PYORI_SH_HISTORY_ENTRY
+YoriShFindHistoryEntryContaining(
+    __in PYORI_STRING SearchString,
+    __in_opt PYORI_SH_HISTORY_ENTRY StartFrom,
+    __out PDWORD OffsetOfMatch
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_HISTORY_ENTRY HistoryEntry;
+    PYORI_SH_HISTORY_INDEX_KEY IndexKey;
+    PYORI_SH_HISTORY_INDEX_KEY BestKey;
+    PYORI_HASH_ENTRY HashEntry;
+    YORI_STRING KeyString;
+    DWORD Index;
+    DWORD Position;
+
+    if (SearchString->LengthInChars == 0 ||
+        YoriShGlobal.CommandHistory.Next == NULL) {
+
+        return NULL;
+    }
+
+    if (SearchString->LengthInChars >= YORI_SH_HISTORY_INDEX_KEY_LENGTH &&
+        YoriShBuildHistoryIndex()) {
+
+        //
+        //  Every match must contain every key in the search string, so
+        //  only the entries containing the least common key need to be
+        //  checked.
+        //
+
+        BestKey = NULL;
+        YoriLibInitEmptyString(&KeyString);
+        KeyString.LengthInChars = YORI_SH_HISTORY_INDEX_KEY_LENGTH;
+        for (Index = 0; Index + YORI_SH_HISTORY_INDEX_KEY_LENGTH <= SearchString->LengthInChars; Index++) {
+            KeyString.StartOfString = &SearchString->StartOfString[Index];
+            HashEntry = YoriLibHashLookupByKey(YoriShHistoryIndex, &KeyString);
+            if (HashEntry == NULL) {
+                return NULL;
+            }
+            IndexKey = HashEntry->Context;
+            if (BestKey == NULL || IndexKey->Count < BestKey->Count) {
+                BestKey = IndexKey;
+            }
+        }
+
+        if (StartFrom != NULL) {
+            Position = YoriShFindHistoryIndexPosition(BestKey, StartFrom->Sequence + 1);
+        } else {
+            Position = BestKey->Count;
+        }
+
+        while (Position > 0) {
+            Position--;
+            HistoryEntry = BestKey->Entries[BestKey->Start + Position];
+            if (YoriLibFindFirstMatchingSubstringInsensitive(&HistoryEntry->CmdLine, 1, SearchString, OffsetOfMatch)) {
+                return HistoryEntry;
+            }
+        }
+
+        return NULL;
+    }
+
+    if (StartFrom != NULL) {
+        ListEntry = &StartFrom->ListEntry;
+    } else {
+        ListEntry = YoriLibGetPreviousListEntry(&YoriShGlobal.CommandHistory, NULL);
+    }
+
+    while (ListEntry != NULL) {
+        HistoryEntry = CONTAINING_RECORD(ListEntry, YORI_SH_HISTORY_ENTRY, ListEntry);
+        if (YoriLibFindFirstMatchingSubstringInsensitive(&HistoryEntry->CmdLine, 1, SearchString, OffsetOfMatch)) {
+            return HistoryEntry;
+        }
+        ListEntry = YoriLibGetPreviousListEntry(&YoriShGlobal.CommandHistory, ListEntry);
+    }
+
+    return NULL;
+}
+
 /**
  Build history into an array of NULL terminated strings terminated by an
  additional NULL terminator.  The result must be freed with a subsequent
@@ -484,7 +1136,9 @@ YoriShGetHistoryStrings(
 
 /**
  Add an entered command into the command history buffer and reallocate the
- string such that the caller's buffer is subsequently unreferenced.
+ string such that the caller's buffer is subsequently unreferenced.  History
+ entries always contain a copy of the command, so this is equivalent to
+ @ref YoriShAddToHistory .
 
  @param NewCmd Pointer to a Yori string corresponding to the new
         entry to add to history.
@@ -498,31 +1152,11 @@ YoriShAddToHistoryAndReallocate(
     __in PYORI_STRING NewCmd
     )
 {
-    YORI_STRING NewString;
-
     if (NewCmd->LengthInChars == 0) {
         return FALSE;
     }
 
-    if (!YoriLibAllocateString(&NewString, NewCmd->LengthInChars)) {
-        return FALSE;
-    }
-
-    memcpy(NewString.StartOfString, NewCmd->StartOfString, NewCmd->LengthInChars * sizeof(TCHAR));
-    NewString.LengthInChars = NewCmd->LengthInChars;
-
-    //
-    //  This function will reference the string if it uses it, so this
-    //  function can unconditionally dereference the string
-    //
-
-    if (!YoriShAddToHistory(&NewString, FALSE)) {
-        YoriLibFreeStringContents(&NewString);
-        return FALSE;
-    }
-
-    YoriLibFreeStringContents(&NewString);
-    return TRUE;
+    return YoriShAddToHistory(NewCmd, FALSE);
 }
 
 
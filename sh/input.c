@@ -769,9 +769,55 @@ YoriShClearInput(
     Buffer->String.LengthInChars = 0;
     Buffer->CurrentOffset = 0;
     Buffer->SearchMode = FALSE;
+    Buffer->HistorySearchMode = FALSE;
+    Buffer->HistorySearchMatch = NULL;
     YoriShClearInputSelections(Buffer);
 }
 
+/**
+ Find the most recent history entry containing the search text, and
+ replace the contents of the input buffer with it.  If no entry matches,
+ the input buffer is left unchanged.
+
+ @param Buffer Pointer to the input buffer to update.
+
+ @param StartFrom Optionally points to the most recent history entry to
+        consider.  If NULL, all history entries are considered.
+ */
+VOID
+YoriShUpdateInputWithHistorySearchResult(
+    __inout PYORI_SH_INPUT_BUFFER Buffer,
+    __in_opt PYORI_SH_HISTORY_ENTRY StartFrom
+    )
+{
+    PYORI_SH_HISTORY_ENTRY HistoryEntry;
+    DWORD StringOffsetOfMatch;
+
+    HistoryEntry = YoriShFindHistoryEntryContaining(&Buffer->SearchString, StartFrom, &StringOffsetOfMatch);
+    if (HistoryEntry == NULL) {
+        return;
+    }
+
+    if (!YoriShEnsureStringHasEnoughCharacters(&Buffer->String, HistoryEntry->CmdLine.LengthInChars)) {
+        return;
+    }
+
+    Buffer->HistorySearchMatch = HistoryEntry;
+    Buffer->HistoryEntryToUse = &HistoryEntry->ListEntry;
+
+    Buffer->SuggestionPopulated = FALSE;
+    YoriLibFreeStringContents(&Buffer->SuggestionString);
+    YoriShClearTabCompletionMatches(Buffer);
+
+    if (Buffer->String.LengthInChars > 0) {
+        YoriShExtendDirtyRangeToCover(Buffer, 0, Buffer->String.LengthInChars);
+    }
+    memcpy(Buffer->String.StartOfString, HistoryEntry->CmdLine.StartOfString, HistoryEntry->CmdLine.LengthInChars * sizeof(TCHAR));
+    Buffer->String.LengthInChars = HistoryEntry->CmdLine.LengthInChars;
+    YoriShExtendDirtyRangeToCover(Buffer, 0, Buffer->String.LengthInChars);
+    Buffer->CurrentOffset = StringOffsetOfMatch + Buffer->SearchString.LengthInChars;
+}
+
 /**
  Based on the search text entered so far, find the first match within the
  main string and set the current offset to it.
@@ -785,6 +831,11 @@ YoriShUpdateSelectionWithSearchResult(
 {
     DWORD StringOffsetOfMatch;
 
+    if (Buffer->HistorySearchMode) {
+        YoriShUpdateInputWithHistorySearchResult(Buffer, Buffer->HistorySearchMatch);
+        return;
+    }
+
     //
     //  MSFIX Would like to do something with selection for this, but that
     //  implies having a selection that follows text around lines rather
@@ -940,6 +991,12 @@ YoriShBackspace(
 
         Buffer->SearchString.LengthInChars -= CountToUse;
 
+        //
+        //  A shorter search string may match a more recent history entry,
+        //  so restart the search from the most recent entry.
+        //
+
+        Buffer->HistorySearchMatch = NULL;
         YoriShUpdateSelectionWithSearchResult(Buffer);
         return;
     }
@@ -1966,6 +2023,8 @@ YoriShProcessEnhancedKeyDown(
     } else if (KeyCode == VK_RETURN) {
         if (Buffer->SearchMode) {
             Buffer->SearchMode = FALSE;
+            Buffer->HistorySearchMode = FALSE;
+            Buffer->HistorySearchMatch = NULL;
             YoriLibFreeStringContents(&Buffer->SearchString);
         } else {
             if (!YoriLibCopySelectionIfPresent(&Buffer->Selection)) {
@@ -2119,6 +2178,8 @@ YoriShProcessKeyDown(
         if (Char == '\r') {
             if (Buffer->SearchMode) {
                 Buffer->SearchMode = FALSE;
+                Buffer->HistorySearchMode = FALSE;
+                Buffer->HistorySearchMatch = NULL;
                 YoriLibFreeStringContents(&Buffer->SearchString);
             } else {
                 if (!YoriLibCopySelectionIfPresent(&Buffer->Selection)) {
@@ -2128,7 +2189,10 @@ YoriShProcessKeyDown(
                 return TRUE;
             }
         } else if (Char == 27) {
-            if (Buffer->SearchMode) {
+            if (Buffer->HistorySearchMode) {
+                YoriShClearInput(Buffer);
+                Buffer->HistoryEntryToUse = NULL;
+            } else if (Buffer->SearchMode) {
                 Buffer->SearchMode = FALSE;
                 Buffer->CurrentOffset = Buffer->PreSearchOffset;
                 YoriLibFreeStringContents(&Buffer->SearchString);
@@ -2224,6 +2288,30 @@ YoriShProcessKeyDown(
             ClearSelection = TRUE;
         } else if (KeyCode == 'L') {
             YoriShClearScreen(Buffer);
+        } else if (KeyCode == 'R') {
+
+            //
+            //  Search history for a command containing the search string.
+            //  If already searching history, find the next older match.
+            //
+
+            if (Buffer->HistorySearchMode) {
+                if (Buffer->HistorySearchMatch != NULL) {
+                    PYORI_LIST_ENTRY OlderEntry;
+                    OlderEntry = YoriLibGetPreviousListEntry(&YoriShGlobal.CommandHistory, &Buffer->HistorySearchMatch->ListEntry);
+                    if (OlderEntry != NULL) {
+                        YoriShUpdateInputWithHistorySearchResult(Buffer, CONTAINING_RECORD(OlderEntry, YORI_SH_HISTORY_ENTRY, ListEntry));
+                    }
+                }
+            } else if (YoriShGlobal.CommandHistory.Next != NULL) {
+                if (Buffer->SearchMode) {
+                    YoriLibFreeStringContents(&Buffer->SearchString);
+                }
+                Buffer->SearchMode = TRUE;
+                Buffer->HistorySearchMode = TRUE;
+                Buffer->HistorySearchMatch = NULL;
+                Buffer->PreSearchOffset = Buffer->CurrentOffset;
+            }
         } else if (KeyCode == 'V') {
             YORI_STRING ClipboardData;
             YoriLibInitEmptyString(&ClipboardData);
@@ -680,29 +680,48 @@ YoriShParseCmdlineToCmdContext(
     //
 
     if (ExpandEnvironmentVariables) {
-        for (ArgCount = 0; ArgCount < CmdContext->ArgC; ArgCount++) {
-            YORI_STRING EnvExpandedString;
-            ASSERT(YoriLibIsStringNullTerminated(&CmdContext->ArgV[ArgCount]));
-    
-            ArgOffset = 0;
-            if (ArgCount == CmdContext->CurrentArg) {
-                ArgOffset = CmdContext->CurrentArgOffset;
-            }
-            if (YoriShExpandEnvironmentVariables(&CmdContext->ArgV[ArgCount], &EnvExpandedString, &ArgOffset)) {
-                if (EnvExpandedString.StartOfString != CmdContext->ArgV[ArgCount].StartOfString) {
-                    if (ArgCount == CmdContext->CurrentArg) {
-                        CmdContext->CurrentArgOffset = ArgOffset;
-                    }
-    
-                    YoriLibFreeStringContents(&CmdContext->ArgV[ArgCount]);
-                    memcpy(&CmdContext->ArgV[ArgCount], &EnvExpandedString, sizeof(YORI_STRING));
-                    ASSERT(YoriLibIsStringNullTerminated(&CmdContext->ArgV[ArgCount]));
+        YoriShExpandEnvironmentVariablesInCmdContext(CmdContext);
+    }
+
+    return TRUE;
+}
+
+/**
+ Expand any environment variables in each of the arguments of a command
+ context.  Arguments containing variables are replaced with newly allocated
+ strings, so any other command context referencing the original arguments
+ is unaffected.
+
+ @param CmdContext Pointer to the command context to expand variables in.
+ */
+VOID
+YoriShExpandEnvironmentVariablesInCmdContext(
+    __inout PYORI_SH_CMD_CONTEXT CmdContext
+    )
+{
+    DWORD ArgCount;
+    DWORD ArgOffset;
+
+    for (ArgCount = 0; ArgCount < CmdContext->ArgC; ArgCount++) {
+        YORI_STRING EnvExpandedString;
+        ASSERT(YoriLibIsStringNullTerminated(&CmdContext->ArgV[ArgCount]));
+
+        ArgOffset = 0;
+        if (ArgCount == CmdContext->CurrentArg) {
+            ArgOffset = CmdContext->CurrentArgOffset;
+        }
+        if (YoriShExpandEnvironmentVariables(&CmdContext->ArgV[ArgCount], &EnvExpandedString, &ArgOffset)) {
+            if (EnvExpandedString.StartOfString != CmdContext->ArgV[ArgCount].StartOfString) {
+                if (ArgCount == CmdContext->CurrentArg) {
+                    CmdContext->CurrentArgOffset = ArgOffset;
                 }
+
+                YoriLibFreeStringContents(&CmdContext->ArgV[ArgCount]);
+                memcpy(&CmdContext->ArgV[ArgCount], &EnvExpandedString, sizeof(YORI_STRING));
+                ASSERT(YoriLibIsStringNullTerminated(&CmdContext->ArgV[ArgCount]));
             }
         }
     }
-
-    return TRUE;
 }
 
 /**
@@ -1871,7 +1890,7 @@ YoriShResolveCommandToExecutable(
 
     YoriShExpandAlias(CmdContext);
 
-    if (YoriLibLocateExecutableInPath(&CmdContext->ArgV[0], NULL, NULL, &FoundExecutable) && FoundExecutable.LengthInChars > 0) {
+    if (YoriShPathCacheLocateExecutable(&CmdContext->ArgV[0], &FoundExecutable) && FoundExecutable.LengthInChars > 0) {
         YoriLibFreeStringContents(&CmdContext->ArgV[0]);
         memcpy(&CmdContext->ArgV[0], &FoundExecutable, sizeof(YORI_STRING));
         *ExecutableFound = TRUE;
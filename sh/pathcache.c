@@ -0,0 +1,2592 @@
+/**
+ * @file sh/pathcache.c
+ *
+ * Yori shell cache of the contents of directories in the path and recently
+ * visited directories
+ *
+ * Copyright (c) 2020 Malcolm J. Smith
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "yori.h"
+
+/**
+ The number of recently visited directories to keep cached, in addition to
+ the directories in the path.
+ */
+#define YORI_SH_PATH_CACHE_RECENT_DIRECTORIES (8)
+
+/**
+ The number of directories that the background thread can monitor for
+ changes.  The thread waits on a shutdown event, a wake event, and one
+ change notification per directory.
+ */
+#define YORI_SH_PATH_CACHE_MAX_MONITORED (MAXIMUM_WAIT_OBJECTS - 2)
+
+/**
+ The time to wait after a directory changes before enumerating it again, in
+ milliseconds.  Changes tend to occur in bursts, and this allows a burst to
+ be cached with a single enumerate.
+ */
+#define YORI_SH_PATH_CACHE_SETTLE_TIME (100)
+
+/**
+ The time to wait before checking again whether a directory that did not
+ exist has been created, in milliseconds.
+ */
+#define YORI_SH_PATH_CACHE_MISSING_RECHECK_TIME (30000)
+
+/**
+ A single file found within a cached directory.
+ */
+typedef struct _YORI_SH_PATH_CACHE_FILE {
+
+    /**
+     The hash entry for this file within the directory.
+     */
+    YORI_HASH_ENTRY HashEntry;
+
+    /**
+     The name that the file can be found by, which is the key for the hash
+     entry.  This may be its short name.
+     */
+    YORI_STRING KeyName;
+
+    /**
+     The name of the file as returned from enumerate, which is the name that
+     should be used to refer to it.
+     */
+    YORI_STRING FileName;
+
+    /**
+     The attributes of the file.
+     */
+    DWORD FileAttributes;
+
+    /**
+     TRUE if this entry describes a file by its short name.  Short names
+     are only considered when the command specifies an extension.
+     */
+    BOOLEAN ShortName;
+
+} YORI_SH_PATH_CACHE_FILE, *PYORI_SH_PATH_CACHE_FILE;
+
+/**
+ A single cached directory, which is either in the path or was recently the
+ current directory.
+ */
+typedef struct _YORI_SH_PATH_CACHE_DIRECTORY {
+
+    /**
+     The list of cached directories.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The name of the directory.  This is fully qualified unless the
+     directory is uncacheable.  It is not modified once the directory has
+     been allocated, so it can be used without holding the lock.
+     */
+    YORI_STRING DirectoryName;
+
+    /**
+     The number of references to the directory.  One reference is held by
+     the list of cached directories, and the background thread holds a
+     reference to any directory it is loading or waiting on.
+     */
+    DWORD ReferenceCount;
+
+    /**
+     A handle which is signalled when files are added to or removed from the
+     directory.  NULL if the directory has not been loaded or does not
+     exist.  This handle is retained across enumerations and only closed
+     when the directory is freed, since the background thread may be
+     waiting on it.
+     */
+    HANDLE ChangeNotification;
+
+    /**
+     A hash table of files within the directory.  NULL if the directory
+     contents have not been loaded or it is empty.
+     */
+    PYORI_HASH_TABLE FileHash;
+
+    /**
+     The number of files within the directory.  A file with a distinct
+     short name is counted twice.
+     */
+    DWORD FileCount;
+
+    /**
+     An array of files within the directory, sorted by the name that each
+     can be found by.
+     */
+    PYORI_SH_PATH_CACHE_FILE *Files;
+
+    /**
+     A counter indicating when this directory was last the current
+     directory.  Used to discard the least recently used directory.
+     */
+    DWORD LastUsed;
+
+    /**
+     TRUE if the directory is referenced by the path.
+     */
+    BOOLEAN InPath;
+
+    /**
+     TRUE if the directory is one of the recently visited directories.
+     */
+    BOOLEAN Recent;
+
+    /**
+     TRUE once the directory has been enumerated.
+     */
+    BOOLEAN Loaded;
+
+    /**
+     TRUE while a thread is enumerating the directory.  The previous
+     contents may be stale, so they are not used until the enumerate
+     completes.
+     */
+    BOOLEAN LoadInProgress;
+
+    /**
+     TRUE if the directory did not exist when it was loaded.  It is treated
+     as empty, and the background thread periodically checks whether it has
+     been created.
+     */
+    BOOLEAN Missing;
+
+    /**
+     Set to TRUE if the directory contents cannot be cached, because it is
+     not a fully specified path or change notifications are not available.
+     Such directories are searched every time a command is resolved.
+     */
+    BOOLEAN Uncacheable;
+
+} YORI_SH_PATH_CACHE_DIRECTORY, *PYORI_SH_PATH_CACHE_DIRECTORY;
+
+/**
+ State describing cached directories and their contents.  The directory
+ list and the contents of each directory are protected by Mutex.  Since
+ this is a mutex, the thread resolving commands can enumerate a directory
+ while holding it.
+ */
+typedef struct _YORI_SH_PATH_CACHE {
+
+    /**
+     A mutex protecting the directory list and directory contents.
+     */
+    HANDLE Mutex;
+
+    /**
+     An event signalled when new directories need to be loaded by the
+     background thread or old ones are no longer needed.
+     */
+    HANDLE WakeEvent;
+
+    /**
+     An event signalled when the background thread should terminate.
+     */
+    HANDLE ShutdownEvent;
+
+    /**
+     A handle to the background thread, which keeps cached directories
+     current so that tab completion can be answered without accessing the
+     disk.  NULL if the thread has not been started.
+     */
+    HANDLE Thread;
+
+    /**
+     TRUE if the mutex could not be created, in which case the cache is not
+     used.
+     */
+    BOOLEAN InitializeFailed;
+
+    /**
+     TRUE if the background thread could not be started.
+     */
+    BOOLEAN StartFailed;
+
+    /**
+     TRUE once the path has been parsed.
+     */
+    BOOLEAN Initialized;
+
+    /**
+     TRUE if a component of the path cannot be cached because it is not a
+     fully specified path.
+     */
+    BOOLEAN PathIncomplete;
+
+    /**
+     The list of cached directories.
+     */
+    YORI_LIST_ENTRY DirectoryList;
+
+    /**
+     The environment generation when the PATH and PATHEXT variables were
+     last checked.
+     */
+    DWORD EnvironmentGeneration;
+
+    /**
+     The contents of the PATH variable that the directories were parsed
+     from.
+     */
+    YORI_STRING PathVariable;
+
+    /**
+     The contents of the PATHEXT variable that the extensions were parsed
+     from.
+     */
+    YORI_STRING PathExtVariable;
+
+    /**
+     The number of directories in the path.
+     */
+    DWORD DirectoryCount;
+
+    /**
+     An array of directories in the path, in search order.
+     */
+    PYORI_SH_PATH_CACHE_DIRECTORY *Directories;
+
+    /**
+     The number of extensions in PATHEXT.
+     */
+    DWORD ExtensionCount;
+
+    /**
+     An array of extensions, in search order.  These refer to
+     PathExtVariable, or to the default extension list.
+     */
+    PYORI_STRING Extensions;
+
+    /**
+     The length of the longest extension, in characters.
+     */
+    DWORD MaximumExtensionLength;
+
+    /**
+     The directory that was current when the cache was last refreshed for
+     tab completion.
+     */
+    PYORI_SH_PATH_CACHE_DIRECTORY CurrentDirectory;
+
+    /**
+     A buffer used to query the current directory.
+     */
+    YORI_STRING CurrentDirectoryName;
+
+    /**
+     The number of directories marked as recently visited.
+     */
+    DWORD RecentCount;
+
+    /**
+     A counter which is incremented each time the current directory is
+     found to have changed.
+     */
+    DWORD UseCounter;
+
+    /**
+     The number of commands resolved without needing to search any
+     directory.
+     */
+    DWORD WarmLookups;
+
+    /**
+     The number of commands resolved which needed to search at least one
+     directory.
+     */
+    DWORD ColdLookups;
+
+    /**
+     The total time spent resolving commands without searching any
+     directory, in performance counter units.
+     */
+    LONGLONG WarmTime;
+
+    /**
+     The total time spent resolving commands which needed to search a
+     directory, in performance counter units.
+     */
+    LONGLONG ColdTime;
+
+} YORI_SH_PATH_CACHE, *PYORI_SH_PATH_CACHE;
+
+/**
+ The cache of directories for this shell process.
+ */
+YORI_SH_PATH_CACHE YoriShPathCache;
+
+/**
+ Free an array of files, the files it contains, and the hash table that
+ refers to them.
+
+ @param FileHash Pointer to the hash table.  This can be NULL.
+
+ @param Files Pointer to the array of files.  This can be NULL.
+
+ @param FileCount The number of files in the array.
+ */
+VOID
+YoriShPathCacheFreeFiles(
+    __in_opt PYORI_HASH_TABLE FileHash,
+    __in_opt PYORI_SH_PATH_CACHE_FILE *Files,
+    __in DWORD FileCount
+    )
+{
+    DWORD Index;
+
+    if (Files != NULL) {
+        for (Index = 0; Index < FileCount; Index++) {
+            if (FileHash != NULL) {
+                YoriLibHashRemoveByEntry(&Files[Index]->HashEntry);
+            }
+            YoriLibFree(Files[Index]);
+        }
+        YoriLibFree(Files);
+    }
+
+    if (FileHash != NULL) {
+        YoriLibFreeEmptyHashTable(FileHash);
+    }
+}
+
+/**
+ Release a reference on a directory, and free it if this was the last
+ reference.  This is called with the lock held.
+
+ @param Directory Pointer to the directory.
+ */
+VOID
+YoriShPathCacheDereferenceDirectory(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory
+    )
+{
+    ASSERT(Directory->ReferenceCount > 0);
+    Directory->ReferenceCount--;
+    if (Directory->ReferenceCount > 0) {
+        return;
+    }
+
+    if (Directory->ChangeNotification != NULL) {
+        FindCloseChangeNotification(Directory->ChangeNotification);
+    }
+    YoriShPathCacheFreeFiles(Directory->FileHash, Directory->Files, Directory->FileCount);
+    YoriLibFree(Directory);
+}
+
+/**
+ Remove a directory from the cache if it is neither in the path nor
+ recently visited.  This is called with the lock held.
+
+ @param Directory Pointer to the directory.
+ */
+VOID
+YoriShPathCacheDiscardIfUnused(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory
+    )
+{
+    if (Directory->InPath || Directory->Recent) {
+        return;
+    }
+
+    YoriLibRemoveListItem(&Directory->ListEntry);
+    YoriShPathCacheDereferenceDirectory(Directory);
+}
+
+/**
+ Remove every directory from the cache which is neither in the path nor
+ recently visited.  This is called with the lock held.
+ */
+VOID
+YoriShPathCacheDiscardUnusedDirectories()
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, YORI_SH_PATH_CACHE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, ListEntry);
+        YoriShPathCacheDiscardIfUnused(Directory);
+    }
+}
+
+/**
+ Find a cached directory by name, or allocate one if it is not cached.
+ This is called with the lock held.
+
+ @param DirectoryName Pointer to the name of the directory.  Any quotes
+        should have been removed.
+
+ @param Uncacheable TRUE if the directory name is not fully specified, so
+        its contents cannot be cached.
+
+ @return Pointer to the directory, or NULL on allocation failure.
+ */
+PYORI_SH_PATH_CACHE_DIRECTORY
+YoriShPathCacheFindOrCreateDirectory(
+    __in PYORI_STRING DirectoryName,
+    __in BOOLEAN Uncacheable
+    )
+{
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    PYORI_LIST_ENTRY ListEntry;
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, YORI_SH_PATH_CACHE_DIRECTORY, ListEntry);
+        if (YoriLibCompareStringInsensitive(&Directory->DirectoryName, DirectoryName) == 0) {
+            return Directory;
+        }
+        ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, ListEntry);
+    }
+
+    Directory = YoriLibMalloc(sizeof(YORI_SH_PATH_CACHE_DIRECTORY) + (DirectoryName->LengthInChars + 1) * sizeof(TCHAR));
+    if (Directory == NULL) {
+        return NULL;
+    }
+
+    ZeroMemory(Directory, sizeof(YORI_SH_PATH_CACHE_DIRECTORY));
+    YoriLibInitEmptyString(&Directory->DirectoryName);
+    Directory->DirectoryName.StartOfString = (LPTSTR)(Directory + 1);
+    Directory->DirectoryName.LengthInChars = DirectoryName->LengthInChars;
+    Directory->DirectoryName.LengthAllocated = DirectoryName->LengthInChars + 1;
+    memcpy(Directory->DirectoryName.StartOfString, DirectoryName->StartOfString, DirectoryName->LengthInChars * sizeof(TCHAR));
+    Directory->DirectoryName.StartOfString[DirectoryName->LengthInChars] = '\0';
+    Directory->Uncacheable = Uncacheable;
+    Directory->ReferenceCount = 1;
+
+    YoriLibAppendList(&YoriShPathCache.DirectoryList, &Directory->ListEntry);
+    return Directory;
+}
+
+/**
+ Release the directories and extensions parsed from the path, so that they
+ will be parsed from the environment again on next use.  Directories which
+ are no longer needed are not discarded until the new path has been parsed,
+ so that directories present in both remain loaded.  Statistics are
+ retained.  This is called with the lock held.
+ */
+VOID
+YoriShPathCacheReleasePath()
+{
+    DWORD Index;
+
+    for (Index = 0; Index < YoriShPathCache.DirectoryCount; Index++) {
+        YoriShPathCache.Directories[Index]->InPath = FALSE;
+    }
+
+    if (YoriShPathCache.Directories != NULL) {
+        YoriLibFree(YoriShPathCache.Directories);
+        YoriShPathCache.Directories = NULL;
+    }
+    YoriShPathCache.DirectoryCount = 0;
+    YoriShPathCache.PathIncomplete = FALSE;
+
+    if (YoriShPathCache.Extensions != NULL) {
+        YoriLibFree(YoriShPathCache.Extensions);
+        YoriShPathCache.Extensions = NULL;
+    }
+    YoriShPathCache.ExtensionCount = 0;
+    YoriShPathCache.MaximumExtensionLength = 0;
+
+    YoriLibFreeStringContents(&YoriShPathCache.PathVariable);
+    YoriLibFreeStringContents(&YoriShPathCache.PathExtVariable);
+    YoriShPathCache.Initialized = FALSE;
+}
+
+/**
+ Query an environment variable into a newly allocated string.
+
+ @param Name The name of the variable.
+
+ @param Value On successful completion, updated to contain the value of the
+        variable.  If the variable is not defined, this is an empty string.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheQueryVariable(
+    __in LPCTSTR Name,
+    __out PYORI_STRING Value
+    )
+{
+    DWORD LengthNeeded;
+
+    YoriLibInitEmptyString(Value);
+    LengthNeeded = GetEnvironmentVariable(Name, NULL, 0);
+    if (LengthNeeded == 0) {
+        return TRUE;
+    }
+
+    if (!YoriLibAllocateString(Value, LengthNeeded)) {
+        return FALSE;
+    }
+
+    Value->LengthInChars = GetEnvironmentVariable(Name, Value->StartOfString, Value->LengthAllocated);
+    if (Value->LengthInChars >= Value->LengthAllocated) {
+        Value->LengthInChars = 0;
+    }
+    Value->StartOfString[Value->LengthInChars] = '\0';
+    return TRUE;
+}
+
+/**
+ Find or allocate the cached directory for a single directory in the path.
+
+ @param DirectoryName Pointer to the name of the directory.  Any quotes
+        should have been removed.
+
+ @return Pointer to the directory, or NULL on allocation failure.
+ */
+PYORI_SH_PATH_CACHE_DIRECTORY
+YoriShPathCacheReferencePathDirectory(
+    __in PYORI_STRING DirectoryName
+    )
+{
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    YORI_STRING FullName;
+
+    //
+    //  A relative path refers to a different directory whenever the current
+    //  directory changes, so it can't be cached.
+    //
+
+    if (!YoriLibIsDriveLetterWithColonAndSlash(DirectoryName) &&
+        !YoriLibIsFullPathUnc(DirectoryName) &&
+        !YoriLibIsPathPrefixed(DirectoryName)) {
+
+        YoriShPathCache.PathIncomplete = TRUE;
+        return YoriShPathCacheFindOrCreateDirectory(DirectoryName, TRUE);
+    }
+
+    //
+    //  Use the same form of the name as the current directory, so that a
+    //  directory in the path that is also visited is only cached once.
+    //
+
+    YoriLibInitEmptyString(&FullName);
+    if (!YoriLibGetFullPathNameReturnAllocation(DirectoryName, FALSE, &FullName, NULL)) {
+        return NULL;
+    }
+
+    if (FullName.LengthInChars > 3 &&
+        YoriLibIsSep(FullName.StartOfString[FullName.LengthInChars - 1])) {
+
+        FullName.LengthInChars--;
+    }
+
+    Directory = YoriShPathCacheFindOrCreateDirectory(&FullName, FALSE);
+    YoriLibFreeStringContents(&FullName);
+    return Directory;
+}
+
+/**
+ Parse the PATH and PATHEXT variables into arrays of directories and
+ extensions.  This is called with the lock held.
+
+ @param PathVariable The contents of the PATH variable.  On success, this is
+        owned by the cache.
+
+ @param PathExtVariable The contents of the PATHEXT variable.  On success,
+        this is owned by the cache.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheParseEnvironment(
+    __in PYORI_STRING PathVariable,
+    __in PYORI_STRING PathExtVariable
+    )
+{
+    YORI_STRING Remaining;
+    YORI_STRING Component;
+    YORI_STRING DefaultPathExt;
+    PYORI_STRING PathExt;
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    DWORD Count;
+    DWORD Pass;
+
+    memcpy(&YoriShPathCache.PathVariable, PathVariable, sizeof(YORI_STRING));
+    memcpy(&YoriShPathCache.PathExtVariable, PathExtVariable, sizeof(YORI_STRING));
+    YoriShPathCache.Initialized = TRUE;
+
+    //
+    //  Count the directories on the first pass, and reference them on the
+    //  second.
+    //
+
+    for (Pass = 0; Pass < 2; Pass++) {
+        Count = 0;
+        YoriLibInitEmptyString(&Remaining);
+        Remaining.StartOfString = PathVariable->StartOfString;
+        Remaining.LengthInChars = PathVariable->LengthInChars;
+
+        while (Remaining.LengthInChars > 0) {
+            YoriLibInitEmptyString(&Component);
+            Component.StartOfString = Remaining.StartOfString;
+            Component.LengthInChars = YoriLibCountStringNotContainingChars(&Remaining, _T(";"));
+
+            Remaining.StartOfString += Component.LengthInChars;
+            Remaining.LengthInChars -= Component.LengthInChars;
+            if (Remaining.LengthInChars > 0) {
+                Remaining.StartOfString++;
+                Remaining.LengthInChars--;
+            }
+
+            if (Component.LengthInChars >= 2 &&
+                Component.StartOfString[0] == '"' &&
+                Component.StartOfString[Component.LengthInChars - 1] == '"') {
+
+                Component.StartOfString++;
+                Component.LengthInChars -= 2;
+            }
+
+            if (Component.LengthInChars == 0) {
+                continue;
+            }
+
+            if (Pass == 1) {
+                Directory = YoriShPathCacheReferencePathDirectory(&Component);
+                if (Directory == NULL) {
+                    return FALSE;
+                }
+                Directory->InPath = TRUE;
+                YoriShPathCache.Directories[Count] = Directory;
+                YoriShPathCache.DirectoryCount++;
+            }
+            Count++;
+        }
+
+        if (Pass == 0 && Count > 0) {
+            YoriShPathCache.Directories = YoriLibMalloc(Count * sizeof(PYORI_SH_PATH_CACHE_DIRECTORY));
+            if (YoriShPathCache.Directories == NULL) {
+                return FALSE;
+            }
+        } else if (Count == 0) {
+            break;
+        }
+    }
+
+    //
+    //  Parse the extensions in the same way.  If PATHEXT isn't defined, use
+    //  the same default as path searches elsewhere.
+    //
+
+    PathExt = PathExtVariable;
+    if (PathExtVariable->LengthInChars == 0) {
+        YoriLibConstantString(&DefaultPathExt, YoriLibDefaultPathExt);
+        PathExt = &DefaultPathExt;
+    }
+
+    for (Pass = 0; Pass < 2; Pass++) {
+        Count = 0;
+        YoriLibInitEmptyString(&Remaining);
+        Remaining.StartOfString = PathExt->StartOfString;
+        Remaining.LengthInChars = PathExt->LengthInChars;
+
+        while (Remaining.LengthInChars > 0) {
+            YoriLibInitEmptyString(&Component);
+            Component.StartOfString = Remaining.StartOfString;
+            Component.LengthInChars = YoriLibCountStringNotContainingChars(&Remaining, _T(";"));
+
+            Remaining.StartOfString += Component.LengthInChars;
+            Remaining.LengthInChars -= Component.LengthInChars;
+            if (Remaining.LengthInChars > 0) {
+                Remaining.StartOfString++;
+                Remaining.LengthInChars--;
+            }
+
+            if (Component.LengthInChars == 0) {
+                continue;
+            }
+
+            if (Pass == 1) {
+                memcpy(&YoriShPathCache.Extensions[Count], &Component, sizeof(YORI_STRING));
+                if (Component.LengthInChars > YoriShPathCache.MaximumExtensionLength) {
+                    YoriShPathCache.MaximumExtensionLength = Component.LengthInChars;
+                }
+                YoriShPathCache.ExtensionCount++;
+            }
+            Count++;
+        }
+
+        if (Pass == 0 && Count > 0) {
+            YoriShPathCache.Extensions = YoriLibMalloc(Count * sizeof(YORI_STRING));
+            if (YoriShPathCache.Extensions == NULL) {
+                return FALSE;
+            }
+        } else if (Count == 0) {
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Check whether the PATH or PATHEXT variables have changed since the cache
+ was populated, and if so, update the set of directories in the path.  This
+ is called with the lock held.
+
+ @param Changed On successful completion, set to TRUE if the set of cached
+        directories changed.  Not modified otherwise.
+
+ @return TRUE to indicate the cache is usable, FALSE if it is not.
+ */
+__success(return)
+BOOL
+YoriShPathCacheCheckEnvironment(
+    __inout PBOOLEAN Changed
+    )
+{
+    YORI_STRING PathVariable;
+    YORI_STRING PathExtVariable;
+    BOOL Result;
+
+    if (YoriShPathCache.Initialized &&
+        YoriShPathCache.EnvironmentGeneration == YoriShGlobal.EnvironmentGeneration) {
+
+        return TRUE;
+    }
+
+    if (!YoriShPathCacheQueryVariable(_T("PATH"), &PathVariable)) {
+        return FALSE;
+    }
+
+    if (!YoriShPathCacheQueryVariable(_T("PATHEXT"), &PathExtVariable)) {
+        YoriLibFreeStringContents(&PathVariable);
+        return FALSE;
+    }
+
+    //
+    //  Most environment changes don't touch either variable, so the cached
+    //  directory contents remain valid.
+    //
+
+    if (YoriShPathCache.Initialized &&
+        YoriLibCompareString(&PathVariable, &YoriShPathCache.PathVariable) == 0 &&
+        YoriLibCompareString(&PathExtVariable, &YoriShPathCache.PathExtVariable) == 0) {
+
+        YoriLibFreeStringContents(&PathVariable);
+        YoriLibFreeStringContents(&PathExtVariable);
+        YoriShPathCache.EnvironmentGeneration = YoriShGlobal.EnvironmentGeneration;
+        return TRUE;
+    }
+
+    YoriShPathCacheReleasePath();
+    Result = YoriShPathCacheParseEnvironment(&PathVariable, &PathExtVariable);
+    if (!Result) {
+        YoriShPathCacheReleasePath();
+    }
+
+    YoriShPathCacheDiscardUnusedDirectories();
+    *Changed = TRUE;
+
+    if (!Result) {
+        return FALSE;
+    }
+
+    YoriShPathCache.EnvironmentGeneration = YoriShGlobal.EnvironmentGeneration;
+    return TRUE;
+}
+
+/**
+ Record the current directory as recently visited, so that it is cached.
+ If too many directories have been visited, the least recently used one is
+ discarded.  This is called with the lock held.
+
+ @return TRUE if the set of cached directories changed, FALSE if it did
+         not.
+ */
+BOOL
+YoriShPathCacheNoteCurrentDirectory()
+{
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    PYORI_SH_PATH_CACHE_DIRECTORY Oldest;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD LengthNeeded;
+
+    LengthNeeded = GetCurrentDirectory(0, NULL);
+    if (LengthNeeded == 0) {
+        return FALSE;
+    }
+
+    if (LengthNeeded > YoriShPathCache.CurrentDirectoryName.LengthAllocated) {
+        YoriLibFreeStringContents(&YoriShPathCache.CurrentDirectoryName);
+        if (!YoriLibAllocateString(&YoriShPathCache.CurrentDirectoryName, LengthNeeded + 0x40)) {
+            return FALSE;
+        }
+    }
+
+    YoriShPathCache.CurrentDirectoryName.LengthInChars = GetCurrentDirectory(YoriShPathCache.CurrentDirectoryName.LengthAllocated, YoriShPathCache.CurrentDirectoryName.StartOfString);
+    if (YoriShPathCache.CurrentDirectoryName.LengthInChars == 0 ||
+        YoriShPathCache.CurrentDirectoryName.LengthInChars >= YoriShPathCache.CurrentDirectoryName.LengthAllocated) {
+
+        YoriShPathCache.CurrentDirectory = NULL;
+        return FALSE;
+    }
+
+    if (YoriShPathCache.CurrentDirectory != NULL &&
+        YoriLibCompareStringInsensitive(&YoriShPathCache.CurrentDirectory->DirectoryName, &YoriShPathCache.CurrentDirectoryName) == 0) {
+
+        return FALSE;
+    }
+
+    Directory = YoriShPathCacheFindOrCreateDirectory(&YoriShPathCache.CurrentDirectoryName, FALSE);
+    YoriShPathCache.CurrentDirectory = Directory;
+    if (Directory == NULL) {
+        return FALSE;
+    }
+
+    YoriShPathCache.UseCounter++;
+    Directory->LastUsed = YoriShPathCache.UseCounter;
+    if (Directory->Recent) {
+        return FALSE;
+    }
+
+    Directory->Recent = TRUE;
+    YoriShPathCache.RecentCount++;
+
+    if (YoriShPathCache.RecentCount > YORI_SH_PATH_CACHE_RECENT_DIRECTORIES) {
+        Oldest = NULL;
+        ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, NULL);
+        while (ListEntry != NULL) {
+            Directory = CONTAINING_RECORD(ListEntry, YORI_SH_PATH_CACHE_DIRECTORY, ListEntry);
+            if (Directory->Recent &&
+                (Oldest == NULL || Directory->LastUsed < Oldest->LastUsed)) {
+
+                Oldest = Directory;
+            }
+            ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, ListEntry);
+        }
+
+        ASSERT(Oldest != YoriShPathCache.CurrentDirectory);
+        if (Oldest != NULL) {
+            Oldest->Recent = FALSE;
+            YoriShPathCache.RecentCount--;
+            YoriShPathCacheDiscardIfUnused(Oldest);
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Compare a file name against a name composed of a base name and an
+ extension, without regard to case.  The ordering is the same as
+ @ref YoriLibCompareStringInsensitive applied to the composed name.
+
+ @param FileName Pointer to the file name.
+
+ @param BaseName Pointer to the first part of the name to compare against.
+
+ @param Extension Pointer to the second part of the name to compare against.
+        This may be an empty string.
+
+ @return Zero if the names are equal, negative if the file name is earlier,
+         positive if the file name is later.
+ */
+int
+YoriShPathCacheCompareName(
+    __in PYORI_STRING FileName,
+    __in PYORI_STRING BaseName,
+    __in PYORI_STRING Extension
+    )
+{
+    DWORD Index;
+    DWORD ComposedLength;
+    TCHAR FileChar;
+    TCHAR ComposedChar;
+
+    ComposedLength = BaseName->LengthInChars + Extension->LengthInChars;
+
+    for (Index = 0; ; Index++) {
+        if (Index == FileName->LengthInChars) {
+            if (Index == ComposedLength) {
+                return 0;
+            }
+            return -1;
+        } else if (Index == ComposedLength) {
+            return 1;
+        }
+
+        if (Index < BaseName->LengthInChars) {
+            ComposedChar = BaseName->StartOfString[Index];
+        } else {
+            ComposedChar = Extension->StartOfString[Index - BaseName->LengthInChars];
+        }
+
+        FileChar = YoriLibUpcaseChar(FileName->StartOfString[Index]);
+        ComposedChar = YoriLibUpcaseChar(ComposedChar);
+
+        if (FileChar < ComposedChar) {
+            return -1;
+        } else if (FileChar > ComposedChar) {
+            return 1;
+        }
+    }
+}
+
+/**
+ Sort an array of files by the name they can be found by, without regard
+ to case.
+
+ @param Files Pointer to the array of files.
+
+ @param FileCount The number of files in the array.
+ */
+VOID
+YoriShPathCacheSortFiles(
+    __inout_ecount(FileCount) PYORI_SH_PATH_CACHE_FILE *Files,
+    __in DWORD FileCount
+    )
+{
+    PYORI_SH_PATH_CACHE_FILE Swap;
+    PYORI_STRING PivotName;
+    DWORD Index;
+    DWORD BreakPoint;
+
+    while (FileCount > 1) {
+
+        //
+        //  Use the middle element as the pivot, so input that is already
+        //  sorted, which is common, divides evenly.
+        //
+
+        Swap = Files[FileCount / 2];
+        Files[FileCount / 2] = Files[0];
+        Files[0] = Swap;
+        PivotName = &Files[0]->KeyName;
+
+        BreakPoint = 0;
+        for (Index = 1; Index < FileCount; Index++) {
+            if (YoriLibCompareStringInsensitive(&Files[Index]->KeyName, PivotName) < 0) {
+                BreakPoint++;
+                Swap = Files[BreakPoint];
+                Files[BreakPoint] = Files[Index];
+                Files[Index] = Swap;
+            }
+        }
+
+        Swap = Files[BreakPoint];
+        Files[BreakPoint] = Files[0];
+        Files[0] = Swap;
+
+        //
+        //  Recurse into the smaller side and loop on the larger, so the
+        //  stack depth is bounded.
+        //
+
+        if (BreakPoint < FileCount - BreakPoint - 1) {
+            YoriShPathCacheSortFiles(Files, BreakPoint);
+            Files = &Files[BreakPoint + 1];
+            FileCount = FileCount - BreakPoint - 1;
+        } else {
+            YoriShPathCacheSortFiles(&Files[BreakPoint + 1], FileCount - BreakPoint - 1);
+            FileCount = BreakPoint;
+        }
+    }
+}
+
+/**
+ Find the first file in a directory whose name is not less than a name
+ composed of a base name and an extension.  This is called with the lock
+ held.
+
+ @param Directory Pointer to the directory, whose contents must be loaded.
+
+ @param BaseName Pointer to the first part of the name to search for.
+
+ @param Extension Pointer to the second part of the name to search for.
+
+ @return The index of the first file whose name is not less than the name
+         being searched for.  This is the number of files if there is no
+         such file.
+ */
+DWORD
+YoriShPathCacheLowerBound(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __in PYORI_STRING BaseName,
+    __in PYORI_STRING Extension
+    )
+{
+    DWORD Low;
+    DWORD High;
+    DWORD Middle;
+
+    Low = 0;
+    High = Directory->FileCount;
+    while (Low < High) {
+        Middle = Low + (High - Low) / 2;
+        if (YoriShPathCacheCompareName(&Directory->Files[Middle]->KeyName, BaseName, Extension) < 0) {
+            Low = Middle + 1;
+        } else {
+            High = Middle;
+        }
+    }
+
+    return Low;
+}
+
+/**
+ Allocate a cache entry for a single file found in a directory.
+
+ @param KeyName Pointer to a NULL terminated name that the file can be found
+        by.
+
+ @param FindData Pointer to information about the file.
+
+ @param ShortName TRUE if KeyName is the short name of the file.
+
+ @return Pointer to the file, or NULL on allocation failure.
+ */
+PYORI_SH_PATH_CACHE_FILE
+YoriShPathCacheAllocateFile(
+    __in LPCTSTR KeyName,
+    __in PWIN32_FIND_DATA FindData,
+    __in BOOLEAN ShortName
+    )
+{
+    PYORI_SH_PATH_CACHE_FILE File;
+    DWORD KeyLength;
+    DWORD NameLength;
+
+    KeyLength = _tcslen(KeyName);
+    NameLength = _tcslen(FindData->cFileName);
+
+    File = YoriLibMalloc(sizeof(YORI_SH_PATH_CACHE_FILE) + (KeyLength + NameLength + 2) * sizeof(TCHAR));
+    if (File == NULL) {
+        return NULL;
+    }
+
+    YoriLibInitEmptyString(&File->FileName);
+    File->FileName.StartOfString = (LPTSTR)(File + 1);
+    File->FileName.LengthInChars = NameLength;
+    File->FileName.LengthAllocated = NameLength + 1;
+    memcpy(File->FileName.StartOfString, FindData->cFileName, (NameLength + 1) * sizeof(TCHAR));
+
+    YoriLibInitEmptyString(&File->KeyName);
+    File->KeyName.StartOfString = File->FileName.StartOfString + NameLength + 1;
+    File->KeyName.LengthInChars = KeyLength;
+    File->KeyName.LengthAllocated = KeyLength + 1;
+    memcpy(File->KeyName.StartOfString, KeyName, (KeyLength + 1) * sizeof(TCHAR));
+
+    File->FileAttributes = FindData->dwFileAttributes;
+    File->ShortName = ShortName;
+    return File;
+}
+
+/**
+ Add a file to a growable array of files.
+
+ @param Files Pointer to the array of files, which is reallocated as
+        needed.
+
+ @param FileCount Pointer to the number of files in the array.
+
+ @param FilesAllocated Pointer to the number of files the array can hold.
+
+ @param File Pointer to the file to add.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheAppendFile(
+    __inout PYORI_SH_PATH_CACHE_FILE **Files,
+    __inout PDWORD FileCount,
+    __inout PDWORD FilesAllocated,
+    __in PYORI_SH_PATH_CACHE_FILE File
+    )
+{
+    PYORI_SH_PATH_CACHE_FILE *NewFiles;
+    DWORD NewAllocated;
+
+    if (*FileCount == *FilesAllocated) {
+        if (*FilesAllocated == 0) {
+            NewAllocated = 0x100;
+        } else {
+            NewAllocated = *FilesAllocated * 2;
+        }
+        NewFiles = YoriLibMalloc(NewAllocated * sizeof(PYORI_SH_PATH_CACHE_FILE));
+        if (NewFiles == NULL) {
+            return FALSE;
+        }
+        if (*Files != NULL) {
+            memcpy(NewFiles, *Files, *FileCount * sizeof(PYORI_SH_PATH_CACHE_FILE));
+            YoriLibFree(*Files);
+        }
+        *Files = NewFiles;
+        *FilesAllocated = NewAllocated;
+    }
+
+    (*Files)[*FileCount] = File;
+    (*FileCount)++;
+    return TRUE;
+}
+
+/**
+ Returns TRUE if a directory needs to be enumerated.  This is called with
+ the lock held.
+
+ @param Directory Pointer to the directory.
+
+ @return TRUE if the directory has not been loaded or has changed since it
+         was loaded.
+ */
+BOOL
+YoriShPathCacheDirectoryNeedsLoad(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory
+    )
+{
+    if (Directory->Uncacheable || Directory->LoadInProgress) {
+        return FALSE;
+    }
+
+    if (!Directory->Loaded) {
+        return TRUE;
+    }
+
+    if (Directory->ChangeNotification != NULL &&
+        WaitForSingleObject(Directory->ChangeNotification, 0) == WAIT_OBJECT_0) {
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Returns TRUE if the cached contents of a directory are current and can be
+ used to answer a search.  This is called with the lock held.
+
+ @param Directory Pointer to the directory.
+
+ @return TRUE if the cached contents are current, FALSE if the directory
+         should be searched on disk.
+ */
+BOOL
+YoriShPathCacheIsDirectoryCurrent(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory
+    )
+{
+    if (!Directory->Loaded || Directory->LoadInProgress || Directory->Uncacheable) {
+        return FALSE;
+    }
+
+    if (Directory->ChangeNotification != NULL &&
+        WaitForSingleObject(Directory->ChangeNotification, 0) == WAIT_OBJECT_0) {
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Enumerate a directory and install its contents into the cache.  The
+ background thread calls this without the lock held, holding a reference on
+ the directory, so that a slow directory does not block the input thread.
+ Command resolution calls this with the lock held.  If the directory is
+ already being loaded by another thread, this returns without waiting.
+
+ @param Directory Pointer to the directory to load.
+ */
+VOID
+YoriShPathCacheLoadDirectory(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory
+    )
+{
+    PYORI_SH_PATH_CACHE_FILE *Files;
+    PYORI_SH_PATH_CACHE_FILE *OldFiles;
+    PYORI_SH_PATH_CACHE_FILE File;
+    PYORI_HASH_TABLE FileHash;
+    PYORI_HASH_TABLE OldFileHash;
+    HANDLE ChangeNotification;
+    HANDLE NewChangeNotification;
+    HANDLE hFind;
+    WIN32_FIND_DATA FindData;
+    YORI_STRING SearchString;
+    DWORD FileCount;
+    DWORD OldFileCount;
+    DWORD FilesAllocated;
+    DWORD BucketCount;
+    DWORD Err;
+    DWORD Index;
+    BOOLEAN Missing;
+    BOOLEAN Failed;
+
+    WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+    if (!YoriShPathCacheDirectoryNeedsLoad(Directory)) {
+        ReleaseMutex(YoriShPathCache.Mutex);
+        return;
+    }
+    Directory->LoadInProgress = TRUE;
+    ChangeNotification = Directory->ChangeNotification;
+    ReleaseMutex(YoriShPathCache.Mutex);
+
+    Files = NULL;
+    FileHash = NULL;
+    FileCount = 0;
+    FilesAllocated = 0;
+    NewChangeNotification = NULL;
+    Missing = FALSE;
+    Failed = FALSE;
+
+    //
+    //  Register for notifications, or rearm the existing registration,
+    //  before enumerating, so any change that occurs while enumerating
+    //  causes the directory to be enumerated again.
+    //
+
+    if (ChangeNotification != NULL) {
+        if (!FindNextChangeNotification(ChangeNotification)) {
+            Failed = TRUE;
+        }
+    } else {
+        NewChangeNotification = FindFirstChangeNotification(Directory->DirectoryName.StartOfString, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+        if (NewChangeNotification == INVALID_HANDLE_VALUE || NewChangeNotification == NULL) {
+            NewChangeNotification = NULL;
+            Err = GetLastError();
+            if (Err == ERROR_FILE_NOT_FOUND || Err == ERROR_PATH_NOT_FOUND) {
+                Missing = TRUE;
+            } else {
+                Failed = TRUE;
+            }
+        }
+    }
+
+    if (!Failed && !Missing) {
+        if (!YoriLibAllocateString(&SearchString, Directory->DirectoryName.LengthInChars + 3)) {
+            Failed = TRUE;
+        } else {
+            if (Directory->DirectoryName.LengthInChars > 0 &&
+                YoriLibIsSep(Directory->DirectoryName.StartOfString[Directory->DirectoryName.LengthInChars - 1])) {
+                SearchString.LengthInChars = YoriLibSPrintf(SearchString.StartOfString, _T("%y*"), &Directory->DirectoryName);
+            } else {
+                SearchString.LengthInChars = YoriLibSPrintf(SearchString.StartOfString, _T("%y\\*"), &Directory->DirectoryName);
+            }
+
+            hFind = FindFirstFile(SearchString.StartOfString, &FindData);
+            YoriLibFreeStringContents(&SearchString);
+
+            if (hFind == INVALID_HANDLE_VALUE) {
+                if (GetLastError() != ERROR_FILE_NOT_FOUND) {
+                    Failed = TRUE;
+                }
+            } else {
+                do {
+                    if (_tcscmp(FindData.cFileName, _T(".")) == 0 ||
+                        _tcscmp(FindData.cFileName, _T("..")) == 0) {
+                        continue;
+                    }
+
+                    File = YoriShPathCacheAllocateFile(FindData.cFileName, &FindData, FALSE);
+                    if (File == NULL) {
+                        Failed = TRUE;
+                        break;
+                    }
+                    if (!YoriShPathCacheAppendFile(&Files, &FileCount, &FilesAllocated, File)) {
+                        YoriLibFree(File);
+                        Failed = TRUE;
+                        break;
+                    }
+
+                    if (FindData.cAlternateFileName[0] != '\0' &&
+                        _tcsicmp(FindData.cAlternateFileName, FindData.cFileName) != 0) {
+
+                        File = YoriShPathCacheAllocateFile(FindData.cAlternateFileName, &FindData, TRUE);
+                        if (File == NULL) {
+                            Failed = TRUE;
+                            break;
+                        }
+                        if (!YoriShPathCacheAppendFile(&Files, &FileCount, &FilesAllocated, File)) {
+                            YoriLibFree(File);
+                            Failed = TRUE;
+                            break;
+                        }
+                    }
+
+                } while (FindNextFile(hFind, &FindData));
+                FindClose(hFind);
+            }
+        }
+    }
+
+    if (!Failed && FileCount > 0) {
+        BucketCount = FileCount;
+        if (BucketCount < 16) {
+            BucketCount = 16;
+        }
+
+        FileHash = YoriLibAllocateHashTable(BucketCount);
+        if (FileHash == NULL) {
+            Failed = TRUE;
+        } else {
+            for (Index = 0; Index < FileCount; Index++) {
+                File = Files[Index];
+                YoriLibHashInsertByKey(FileHash, &File->KeyName, File, &File->HashEntry);
+            }
+            YoriShPathCacheSortFiles(Files, FileCount);
+        }
+    }
+
+    if (Failed) {
+        YoriShPathCacheFreeFiles(FileHash, Files, FileCount);
+        Files = NULL;
+        FileHash = NULL;
+        FileCount = 0;
+    }
+
+    //
+    //  Swap the new contents in, and free the old contents after the lock
+    //  is released.
+    //
+
+    WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+
+    OldFiles = Directory->Files;
+    OldFileCount = Directory->FileCount;
+    OldFileHash = Directory->FileHash;
+
+    if (NewChangeNotification != NULL) {
+        ASSERT(Directory->ChangeNotification == NULL);
+        Directory->ChangeNotification = NewChangeNotification;
+    }
+    Directory->Files = Files;
+    Directory->FileCount = FileCount;
+    Directory->FileHash = FileHash;
+    Directory->Missing = Missing;
+    if (Failed) {
+        Directory->Uncacheable = TRUE;
+    }
+    Directory->Loaded = TRUE;
+    Directory->LoadInProgress = FALSE;
+
+    ReleaseMutex(YoriShPathCache.Mutex);
+
+    YoriShPathCacheFreeFiles(OldFileHash, OldFiles, OldFileCount);
+}
+
+/**
+ Ensure the contents of a path directory are loaded and current so that a
+ command can be resolved from them.  This is called with the lock held.
+
+ @param Directory Pointer to the directory.
+
+ @param Enumerated On successful completion, set to TRUE if the directory
+        needed to be enumerated.  Not modified otherwise.
+
+ @return TRUE to indicate the cached contents can be used, FALSE if the
+         directory should be searched directly.
+ */
+__success(return)
+BOOL
+YoriShPathCachePrepareDirectory(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __inout PBOOLEAN Enumerated
+    )
+{
+    if (YoriShPathCacheDirectoryNeedsLoad(Directory)) {
+        *Enumerated = TRUE;
+        YoriShPathCacheLoadDirectory(Directory);
+    }
+
+    //
+    //  A directory that did not exist is probed, since nothing may be
+    //  checking whether it has been created.
+    //
+
+    if (!YoriShPathCacheIsDirectoryCurrent(Directory) || Directory->Missing) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Search a directory on disk for a command, without using cached contents.
+ This is used for the current directory and any path directory that cannot
+ be cached.
+
+ @param DirectoryName Pointer to the name of the directory.
+
+ @param SearchFor Pointer to the command name.
+
+ @param ExactName If TRUE, look for a file whose name is exactly the command
+        name.  If FALSE, look for a file whose name is the command name
+        followed by one of the extensions in PATHEXT.
+
+ @param FoundData On successful completion, populated with information about
+        the file that was found.
+
+ @return TRUE to indicate a file was found, FALSE if it was not.
+ */
+__success(return)
+BOOL
+YoriShPathCacheProbeDirectory(
+    __in PYORI_STRING DirectoryName,
+    __in PYORI_STRING SearchFor,
+    __in BOOLEAN ExactName,
+    __out PWIN32_FIND_DATA FoundData
+    )
+{
+    YORI_STRING SearchString;
+    WIN32_FIND_DATA FindData;
+    HANDLE hFind;
+    DWORD NameLength;
+    DWORD Index;
+    DWORD BestIndex;
+
+    if (!YoriLibAllocateString(&SearchString, DirectoryName->LengthInChars + 1 + SearchFor->LengthInChars + 2)) {
+        return FALSE;
+    }
+
+    if (DirectoryName->LengthInChars == 0 ||
+        YoriLibIsSep(DirectoryName->StartOfString[DirectoryName->LengthInChars - 1]) ||
+        (DirectoryName->LengthInChars == 2 && DirectoryName->StartOfString[1] == ':')) {
+
+        SearchString.LengthInChars = YoriLibSPrintf(SearchString.StartOfString, _T("%y%y%s"), DirectoryName, SearchFor, ExactName?_T(""):_T("*"));
+    } else {
+        SearchString.LengthInChars = YoriLibSPrintf(SearchString.StartOfString, _T("%y\\%y%s"), DirectoryName, SearchFor, ExactName?_T(""):_T("*"));
+    }
+
+    hFind = FindFirstFile(SearchString.StartOfString, &FindData);
+    YoriLibFreeStringContents(&SearchString);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (ExactName) {
+        FindClose(hFind);
+        memcpy(FoundData, &FindData, sizeof(WIN32_FIND_DATA));
+        return TRUE;
+    }
+
+    //
+    //  Of all of the files beginning with the command name, find the one
+    //  whose extension is earliest in PATHEXT.
+    //
+
+    BestIndex = YoriShPathCache.ExtensionCount;
+    do {
+        NameLength = _tcslen(FindData.cFileName);
+        for (Index = 0; Index < BestIndex; Index++) {
+            if (NameLength == SearchFor->LengthInChars + YoriShPathCache.Extensions[Index].LengthInChars &&
+                _tcsnicmp(&FindData.cFileName[SearchFor->LengthInChars], YoriShPathCache.Extensions[Index].StartOfString, YoriShPathCache.Extensions[Index].LengthInChars) == 0) {
+
+                BestIndex = Index;
+                memcpy(FoundData, &FindData, sizeof(WIN32_FIND_DATA));
+                break;
+            }
+        }
+    } while (BestIndex > 0 && FindNextFile(hFind, &FindData));
+
+    FindClose(hFind);
+
+    if (BestIndex < YoriShPathCache.ExtensionCount) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ Search the cached contents of a directory for a command.
+
+ @param Directory Pointer to the directory, whose contents must be loaded.
+
+ @param SearchFor Pointer to the command name.
+
+ @param ExactName If TRUE, look for a file whose name is exactly the command
+        name.  If FALSE, look for a file whose name is the command name
+        followed by one of the extensions in PATHEXT.
+
+ @param ScratchName Pointer to a string with enough space to hold the command
+        name followed by any extension.
+
+ @return Pointer to the file that was found, or NULL if none was found.
+ */
+PYORI_SH_PATH_CACHE_FILE
+YoriShPathCacheSearchDirectory(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __in PYORI_STRING SearchFor,
+    __in BOOLEAN ExactName,
+    __inout PYORI_STRING ScratchName
+    )
+{
+    PYORI_HASH_ENTRY HashEntry;
+    PYORI_SH_PATH_CACHE_FILE File;
+    DWORD Index;
+
+    if (Directory->FileHash == NULL) {
+        return NULL;
+    }
+
+    if (ExactName) {
+        HashEntry = YoriLibHashLookupByKey(Directory->FileHash, SearchFor);
+        if (HashEntry != NULL) {
+            return HashEntry->Context;
+        }
+        return NULL;
+    }
+
+    memcpy(ScratchName->StartOfString, SearchFor->StartOfString, SearchFor->LengthInChars * sizeof(TCHAR));
+    for (Index = 0; Index < YoriShPathCache.ExtensionCount; Index++) {
+        memcpy(&ScratchName->StartOfString[SearchFor->LengthInChars],
+               YoriShPathCache.Extensions[Index].StartOfString,
+               YoriShPathCache.Extensions[Index].LengthInChars * sizeof(TCHAR));
+        ScratchName->LengthInChars = SearchFor->LengthInChars + YoriShPathCache.Extensions[Index].LengthInChars;
+
+        HashEntry = YoriLibHashLookupByKey(Directory->FileHash, ScratchName);
+        if (HashEntry != NULL) {
+            File = HashEntry->Context;
+            if (!File->ShortName) {
+                return File;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ Construct the full path to a file that was found in a directory.
+
+ @param DirectoryName Pointer to the directory containing the file.
+
+ @param FileName Pointer to the name of the file.
+
+ @param PathName On successful completion, updated to contain a newly
+        allocated full path to the file.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheBuildFullName(
+    __in PYORI_STRING DirectoryName,
+    __in PYORI_STRING FileName,
+    __out PYORI_STRING PathName
+    )
+{
+    YORI_STRING RelativeName;
+    BOOL Result;
+
+    if (!YoriLibAllocateString(&RelativeName, DirectoryName->LengthInChars + 1 + FileName->LengthInChars + 1)) {
+        return FALSE;
+    }
+
+    if (YoriLibIsSep(DirectoryName->StartOfString[DirectoryName->LengthInChars - 1]) ||
+        (DirectoryName->LengthInChars == 2 && DirectoryName->StartOfString[1] == ':')) {
+
+        RelativeName.LengthInChars = YoriLibSPrintf(RelativeName.StartOfString, _T("%y%y"), DirectoryName, FileName);
+    } else {
+        RelativeName.LengthInChars = YoriLibSPrintf(RelativeName.StartOfString, _T("%y\\%y"), DirectoryName, FileName);
+    }
+
+    YoriLibInitEmptyString(PathName);
+    Result = YoriLibGetFullPathNameReturnAllocation(&RelativeName, FALSE, PathName, NULL);
+    YoriLibFreeStringContents(&RelativeName);
+    return Result;
+}
+
+/**
+ Search the current directory followed by each directory in the path for
+ a command.  This is called with the lock held.
+
+ @param SearchFor Pointer to the command name.
+
+ @param ExactName If TRUE, look for a file whose name is exactly the command
+        name.  If FALSE, look for a file whose name is the command name
+        followed by one of the extensions in PATHEXT.
+
+ @param ScratchName Pointer to a string with enough space to hold the command
+        name followed by any extension.
+
+ @param Enumerated On successful completion, set to TRUE if any directory
+        in the path was searched on disk.  Not modified otherwise.
+
+ @param PathName On successful completion, updated to contain a newly
+        allocated full path to the file if one was found.  If no file was
+        found, this is an empty string.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheSearch(
+    __in PYORI_STRING SearchFor,
+    __in BOOLEAN ExactName,
+    __inout PYORI_STRING ScratchName,
+    __inout PBOOLEAN Enumerated,
+    __out PYORI_STRING PathName
+    )
+{
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    PYORI_SH_PATH_CACHE_FILE File;
+    WIN32_FIND_DATA FindData;
+    YORI_STRING CurrentDirectory;
+    YORI_STRING FoundName;
+    DWORD Index;
+
+    YoriLibInitEmptyString(PathName);
+
+    //
+    //  The current directory is searched first.  Since it changes, its
+    //  contents are not cached.
+    //
+
+    YoriLibConstantString(&CurrentDirectory, _T("."));
+    if (YoriShPathCacheProbeDirectory(&CurrentDirectory, SearchFor, ExactName, &FindData)) {
+        YoriLibConstantString(&FoundName, FindData.cFileName);
+        return YoriShPathCacheBuildFullName(&CurrentDirectory, &FoundName, PathName);
+    }
+
+    for (Index = 0; Index < YoriShPathCache.DirectoryCount; Index++) {
+        Directory = YoriShPathCache.Directories[Index];
+        if (YoriShPathCachePrepareDirectory(Directory, Enumerated)) {
+            File = YoriShPathCacheSearchDirectory(Directory, SearchFor, ExactName, ScratchName);
+            if (File != NULL) {
+                return YoriShPathCacheBuildFullName(&Directory->DirectoryName, &File->FileName, PathName);
+            }
+        } else {
+            *Enumerated = TRUE;
+            if (YoriShPathCacheProbeDirectory(&Directory->DirectoryName, SearchFor, ExactName, &FindData)) {
+                YoriLibConstantString(&FoundName, FindData.cFileName);
+                return YoriShPathCacheBuildFullName(&Directory->DirectoryName, &FoundName, PathName);
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ The background thread.  This loads any cached directory that has not been
+ loaded, and waits for cached directories to change so that they can be
+ loaded again before they are next needed.
+
+ @param Context Ignored.
+
+ @return Thread return code, which is ignored for this thread.
+ */
+DWORD WINAPI
+YoriShPathCacheWorker(
+    __in LPVOID Context
+    )
+{
+    HANDLE Handles[MAXIMUM_WAIT_OBJECTS];
+    PYORI_SH_PATH_CACHE_DIRECTORY WaitDirectories[MAXIMUM_WAIT_OBJECTS];
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    PYORI_SH_PATH_CACHE_DIRECTORY LoadDirectory;
+    PYORI_LIST_ENTRY ListEntry;
+    DWORD HandleCount;
+    DWORD DirectoryCount;
+    DWORD Timeout;
+    DWORD Result;
+    DWORD Index;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    Handles[0] = YoriShPathCache.ShutdownEvent;
+    Handles[1] = YoriShPathCache.WakeEvent;
+
+    while (TRUE) {
+
+        LoadDirectory = NULL;
+        HandleCount = 2;
+        DirectoryCount = 0;
+        Timeout = INFINITE;
+
+        //
+        //  Take a reference on each directory being loaded or waited on, so
+        //  that its change notification remains valid if the directory is
+        //  discarded by the input thread in the meantime.  Directories
+        //  beyond the number that can be monitored are left to be loaded
+        //  when they are used.
+        //
+
+        WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+
+        ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, NULL);
+        while (ListEntry != NULL && DirectoryCount < YORI_SH_PATH_CACHE_MAX_MONITORED) {
+            Directory = CONTAINING_RECORD(ListEntry, YORI_SH_PATH_CACHE_DIRECTORY, ListEntry);
+            ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, ListEntry);
+
+            if (Directory->Uncacheable) {
+                continue;
+            }
+
+            DirectoryCount++;
+            if (YoriShPathCacheDirectoryNeedsLoad(Directory)) {
+                if (LoadDirectory == NULL) {
+                    LoadDirectory = Directory;
+                    Directory->ReferenceCount++;
+                }
+            } else if (Directory->ChangeNotification != NULL) {
+                Handles[HandleCount] = Directory->ChangeNotification;
+                WaitDirectories[HandleCount] = Directory;
+                Directory->ReferenceCount++;
+                HandleCount++;
+            } else if (Directory->Missing) {
+                Timeout = YORI_SH_PATH_CACHE_MISSING_RECHECK_TIME;
+            }
+        }
+
+        ReleaseMutex(YoriShPathCache.Mutex);
+
+        //
+        //  Load one directory at a time, checking for shutdown in between,
+        //  so that a slow directory doesn't delay exit more than necessary.
+        //
+
+        Result = WAIT_OBJECT_0 + 1;
+        if (LoadDirectory != NULL) {
+            if (WaitForSingleObject(YoriShPathCache.ShutdownEvent, 0) == WAIT_OBJECT_0) {
+                Result = WAIT_OBJECT_0;
+            } else {
+                YoriShPathCacheLoadDirectory(LoadDirectory);
+            }
+        } else {
+            Result = WaitForMultipleObjects(HandleCount, Handles, FALSE, Timeout);
+        }
+
+        WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+
+        if (LoadDirectory != NULL) {
+            YoriShPathCacheDereferenceDirectory(LoadDirectory);
+        }
+        for (Index = 2; Index < HandleCount; Index++) {
+            YoriShPathCacheDereferenceDirectory(WaitDirectories[Index]);
+        }
+
+        //
+        //  Check whether any missing directory has been created.
+        //
+
+        if (Result == WAIT_TIMEOUT) {
+            ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, NULL);
+            while (ListEntry != NULL) {
+                Directory = CONTAINING_RECORD(ListEntry, YORI_SH_PATH_CACHE_DIRECTORY, ListEntry);
+                if (Directory->Missing) {
+                    Directory->Loaded = FALSE;
+                }
+                ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, ListEntry);
+            }
+        }
+
+        ReleaseMutex(YoriShPathCache.Mutex);
+
+        if (Result == WAIT_OBJECT_0 || Result == WAIT_FAILED) {
+            break;
+        }
+
+        if (Result > WAIT_OBJECT_0 + 1 && Result < WAIT_OBJECT_0 + HandleCount) {
+
+            //
+            //  A directory changed.  Give the change a moment to complete
+            //  before enumerating again.
+            //
+
+            if (WaitForSingleObject(YoriShPathCache.ShutdownEvent, YORI_SH_PATH_CACHE_SETTLE_TIME) == WAIT_OBJECT_0) {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ Create the lock protecting the cache if it has not been created.
+
+ @return TRUE if the cache can be used, FALSE if it cannot.
+ */
+BOOL
+YoriShPathCacheInitialize()
+{
+    if (YoriShPathCache.Mutex != NULL) {
+        return TRUE;
+    }
+
+    if (YoriShPathCache.InitializeFailed) {
+        return FALSE;
+    }
+
+    YoriShPathCache.Mutex = CreateMutex(NULL, FALSE, NULL);
+    if (YoriShPathCache.Mutex == NULL) {
+        YoriShPathCache.InitializeFailed = TRUE;
+        return FALSE;
+    }
+
+    YoriLibInitializeListHead(&YoriShPathCache.DirectoryList);
+    return TRUE;
+}
+
+/**
+ Start the background thread if it has not been started.
+
+ @return TRUE if the background thread is running, FALSE if it is not.
+ */
+BOOL
+YoriShPathCacheStart()
+{
+    DWORD ThreadId;
+
+    if (YoriShPathCache.Thread != NULL) {
+        return TRUE;
+    }
+
+    if (YoriShPathCache.StartFailed) {
+        return FALSE;
+    }
+
+    YoriShPathCache.WakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    YoriShPathCache.ShutdownEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if (YoriShPathCache.WakeEvent != NULL &&
+        YoriShPathCache.ShutdownEvent != NULL) {
+
+        YoriShPathCache.Thread = CreateThread(NULL, 0, YoriShPathCacheWorker, NULL, 0, &ThreadId);
+    }
+
+    if (YoriShPathCache.Thread == NULL) {
+        YoriShPathCache.StartFailed = TRUE;
+        if (YoriShPathCache.WakeEvent != NULL) {
+            CloseHandle(YoriShPathCache.WakeEvent);
+            YoriShPathCache.WakeEvent = NULL;
+        }
+        if (YoriShPathCache.ShutdownEvent != NULL) {
+            CloseHandle(YoriShPathCache.ShutdownEvent);
+            YoriShPathCache.ShutdownEvent = NULL;
+        }
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Search for a command in the current directory and the path, using cached
+ contents of path directories where possible.  This returns the same result
+ as @ref YoriLibLocateExecutableInPath .  Commands which specify a
+ directory or contain wildcards are passed to that function directly.
+
+ @param SearchFor The command name to search for.
+
+ @param PathName On successful completion, updated to point to a newly
+        allocated string containing the full path to the command.  If no
+        match is found, this is an empty string.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheLocateExecutable(
+    __in PYORI_STRING SearchFor,
+    __out PYORI_STRING PathName
+    )
+{
+    YORI_STRING ScratchName;
+    LARGE_INTEGER StartTime;
+    LARGE_INTEGER EndTime;
+    BOOLEAN ExactName;
+    BOOLEAN Enumerated;
+    BOOLEAN Changed;
+    BOOL Result;
+    DWORD Index;
+
+    ExactName = FALSE;
+    for (Index = 0; Index < SearchFor->LengthInChars; Index++) {
+        if (YoriLibIsSep(SearchFor->StartOfString[Index]) ||
+            SearchFor->StartOfString[Index] == ':' ||
+            SearchFor->StartOfString[Index] == '*' ||
+            SearchFor->StartOfString[Index] == '?') {
+
+            return YoriLibLocateExecutableInPath(SearchFor, NULL, NULL, PathName);
+        }
+        if (SearchFor->StartOfString[Index] == '.') {
+            ExactName = TRUE;
+        }
+    }
+
+    if (SearchFor->LengthInChars == 0 ||
+        !YoriShPathCacheInitialize()) {
+
+        return YoriLibLocateExecutableInPath(SearchFor, NULL, NULL, PathName);
+    }
+
+    WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+
+    Changed = FALSE;
+    if (!YoriShPathCacheCheckEnvironment(&Changed)) {
+        ReleaseMutex(YoriShPathCache.Mutex);
+        return YoriLibLocateExecutableInPath(SearchFor, NULL, NULL, PathName);
+    }
+
+    if (Changed && YoriShPathCache.Thread != NULL) {
+        SetEvent(YoriShPathCache.WakeEvent);
+    }
+
+    QueryPerformanceCounter(&StartTime);
+
+    if (!YoriLibAllocateString(&ScratchName, SearchFor->LengthInChars + YoriShPathCache.MaximumExtensionLength + 1)) {
+        ReleaseMutex(YoriShPathCache.Mutex);
+        return FALSE;
+    }
+
+    //
+    //  If the command has an extension, look for that file everywhere before
+    //  looking for it with any other extension.
+    //
+
+    Enumerated = FALSE;
+    Result = TRUE;
+    YoriLibInitEmptyString(PathName);
+    if (ExactName) {
+        Result = YoriShPathCacheSearch(SearchFor, TRUE, &ScratchName, &Enumerated, PathName);
+    }
+
+    if (Result && PathName->LengthInChars == 0) {
+        YoriLibFreeStringContents(PathName);
+        Result = YoriShPathCacheSearch(SearchFor, FALSE, &ScratchName, &Enumerated, PathName);
+    }
+
+    YoriLibFreeStringContents(&ScratchName);
+
+    QueryPerformanceCounter(&EndTime);
+    if (Enumerated) {
+        YoriShPathCache.ColdLookups++;
+        YoriShPathCache.ColdTime += EndTime.QuadPart - StartTime.QuadPart;
+    } else {
+        YoriShPathCache.WarmLookups++;
+        YoriShPathCache.WarmTime += EndTime.QuadPart - StartTime.QuadPart;
+    }
+
+    ReleaseMutex(YoriShPathCache.Mutex);
+    return Result;
+}
+
+/**
+ Bring the cache up to date with the current environment and current
+ directory for tab completion, starting the background thread if needed.
+ Any directory that is not yet loaded is loaded in the background; until
+ it is, searches that need it are performed on disk.
+ */
+VOID
+YoriShPathCacheRefresh()
+{
+    BOOLEAN Changed;
+
+    if (!YoriShPathCacheInitialize()) {
+        return;
+    }
+
+    if (!YoriShPathCacheStart()) {
+        return;
+    }
+
+    //
+    //  If the path can't be parsed, it is left uninitialized, so that
+    //  executable searches are performed on disk.
+    //
+
+    WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+    Changed = FALSE;
+    YoriShPathCacheCheckEnvironment(&Changed);
+    if (YoriShPathCacheNoteCurrentDirectory()) {
+        Changed = TRUE;
+    }
+    ReleaseMutex(YoriShPathCache.Mutex);
+
+    if (Changed) {
+        SetEvent(YoriShPathCache.WakeEvent);
+    }
+}
+
+/**
+ Check that a search string is a simple prefix followed by a single
+ trailing wildcard, which is the only form the cache can answer.
+
+ @param SearchFor Pointer to the search string.
+
+ @param Disallowed Pointer to a NULL terminated list of characters which
+        cannot be present in the prefix.
+
+ @param Prefix On successful completion, updated to refer to the search
+        string without its trailing wildcard.
+
+ @return TRUE if the cache can answer the search, FALSE if it cannot.
+ */
+__success(return)
+BOOL
+YoriShPathCacheGetSearchPrefix(
+    __in PYORI_STRING SearchFor,
+    __in LPCTSTR Disallowed,
+    __out PYORI_STRING Prefix
+    )
+{
+    if (SearchFor->LengthInChars == 0 ||
+        SearchFor->StartOfString[SearchFor->LengthInChars - 1] != '*') {
+
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(Prefix);
+    Prefix->StartOfString = SearchFor->StartOfString;
+    Prefix->LengthInChars = SearchFor->LengthInChars - 1;
+
+    if (YoriLibCountStringNotContainingChars(Prefix, Disallowed) != Prefix->LengthInChars) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ Build the fully qualified name of a file within a cached directory.
+
+ @param Directory Pointer to the directory.
+
+ @param FileName Pointer to the name of the file.
+
+ @param FullName Pointer to a string to populate with the full name.  This
+        is reallocated if it is not large enough.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+YoriShPathCacheBuildMatchName(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __in PYORI_STRING FileName,
+    __inout PYORI_STRING FullName
+    )
+{
+    DWORD LengthNeeded;
+
+    LengthNeeded = Directory->DirectoryName.LengthInChars + 1 + FileName->LengthInChars + 1;
+    if (LengthNeeded > FullName->LengthAllocated) {
+        YoriLibFreeStringContents(FullName);
+        if (!YoriLibAllocateString(FullName, LengthNeeded + MAX_PATH)) {
+            return FALSE;
+        }
+    }
+
+    if (Directory->DirectoryName.LengthInChars > 0 &&
+        YoriLibIsSep(Directory->DirectoryName.StartOfString[Directory->DirectoryName.LengthInChars - 1])) {
+
+        FullName->LengthInChars = YoriLibSPrintf(FullName->StartOfString, _T("%y%y"), &Directory->DirectoryName, FileName);
+    } else {
+        FullName->LengthInChars = YoriLibSPrintf(FullName->StartOfString, _T("%y\\%y"), &Directory->DirectoryName, FileName);
+    }
+
+    return TRUE;
+}
+
+/**
+ Find the file in a directory whose long name is exactly a name composed of
+ a base name and an extension.  This is called with the lock held.
+
+ @param Directory Pointer to the directory, whose contents must be loaded.
+
+ @param BaseName Pointer to the first part of the name to search for.
+
+ @param Extension Pointer to the second part of the name to search for.
+
+ @return Pointer to the file, or NULL if no file has this name.
+ */
+PYORI_SH_PATH_CACHE_FILE
+YoriShPathCacheFindComposedName(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __in PYORI_STRING BaseName,
+    __in PYORI_STRING Extension
+    )
+{
+    PYORI_SH_PATH_CACHE_FILE File;
+    DWORD Index;
+
+    Index = YoriShPathCacheLowerBound(Directory, BaseName, Extension);
+    for (; Index < Directory->FileCount; Index++) {
+        File = Directory->Files[Index];
+        if (YoriShPathCacheCompareName(&File->KeyName, BaseName, Extension) != 0) {
+            break;
+        }
+        if (!File->ShortName) {
+            return File;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ Report every executable within a cached directory that starts with a
+ prefix.  For each file whose extension is in PATHEXT, every file with the
+ same base name and any PATHEXT extension is reported, in PATHEXT order,
+ which matches the order used by path searches.  This is called with the
+ lock held.
+
+ @param Directory Pointer to the directory.
+
+ @param Prefix Pointer to the prefix to search for.
+
+ @param FullName Pointer to a string used to construct the full name of each
+        match.
+
+ @param MatchCallback The function to invoke for each match.
+
+ @param Context Context to pass to MatchCallback.
+
+ @return TRUE to continue searching, FALSE if the callback failed.
+ */
+BOOL
+YoriShPathCacheReportExecutables(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __in PYORI_STRING Prefix,
+    __inout PYORI_STRING FullName,
+    __in PYORI_LIB_PATH_MATCH_FN MatchCallback,
+    __in PVOID Context
+    )
+{
+    PYORI_SH_PATH_CACHE_FILE File;
+    PYORI_SH_PATH_CACHE_FILE Match;
+    PYORI_STRING Extension;
+    YORI_STRING NoExtension;
+    YORI_STRING BaseName;
+    DWORD Index;
+    DWORD ExtIndex;
+    DWORD MatchExtIndex;
+
+    YoriLibInitEmptyString(&NoExtension);
+
+    Index = YoriShPathCacheLowerBound(Directory, Prefix, &NoExtension);
+    for (; Index < Directory->FileCount; Index++) {
+        File = Directory->Files[Index];
+        if (YoriLibCompareStringInsensitiveCount(&File->KeyName, Prefix, Prefix->LengthInChars) != 0) {
+            break;
+        }
+
+        if (File->ShortName) {
+            continue;
+        }
+
+        for (ExtIndex = 0; ExtIndex < YoriShPathCache.ExtensionCount; ExtIndex++) {
+            Extension = &YoriShPathCache.Extensions[ExtIndex];
+            if (File->FileName.LengthInChars <= Extension->LengthInChars) {
+                continue;
+            }
+
+            YoriLibInitEmptyString(&BaseName);
+            BaseName.StartOfString = File->FileName.StartOfString;
+            BaseName.LengthInChars = File->FileName.LengthInChars - Extension->LengthInChars;
+
+            if (YoriShPathCacheCompareName(&File->FileName, &BaseName, Extension) != 0) {
+                continue;
+            }
+
+            for (MatchExtIndex = 0; MatchExtIndex < YoriShPathCache.ExtensionCount; MatchExtIndex++) {
+                Match = YoriShPathCacheFindComposedName(Directory, &BaseName, &YoriShPathCache.Extensions[MatchExtIndex]);
+                if (Match == NULL) {
+                    continue;
+                }
+
+                if (!YoriShPathCacheBuildMatchName(Directory, &Match->FileName, FullName)) {
+                    return FALSE;
+                }
+                if (!MatchCallback(FullName, Context)) {
+                    return FALSE;
+                }
+            }
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ Search the cache for executables in the current directory and the path
+ which match a search string, in execution order.  This answers the same
+ query as @ref YoriLibLocateExecutableInPath with a callback, but without
+ accessing the disk.
+
+ @param SearchFor Pointer to the search string, which must be a prefix
+        followed by a single trailing wildcard.
+
+ @param MatchCallback The function to invoke for each match.
+
+ @param Context Context to pass to MatchCallback.
+
+ @return TRUE if the cache was used to answer the search.  FALSE if the
+         search cannot be answered from the cache, in which case
+         MatchCallback has not been invoked and the caller should search on
+         disk.
+ */
+__success(return)
+BOOL
+YoriShPathCacheFindExecutables(
+    __in PYORI_STRING SearchFor,
+    __in PYORI_LIB_PATH_MATCH_FN MatchCallback,
+    __in PVOID Context
+    )
+{
+    YORI_STRING Prefix;
+    YORI_STRING FullName;
+    DWORD Index;
+
+    if (YoriShPathCache.Mutex == NULL) {
+        return FALSE;
+    }
+
+    //
+    //  Searches with a path component or an extension have different rules
+    //  about which files match, so leave those to the path search.
+    //
+
+    if (!YoriShPathCacheGetSearchPrefix(SearchFor, _T("*?<>\".:\\/"), &Prefix)) {
+        return FALSE;
+    }
+
+    WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+
+    if (!YoriShPathCache.Initialized ||
+        YoriShPathCache.PathIncomplete ||
+        YoriShPathCache.CurrentDirectory == NULL ||
+        !YoriShPathCacheIsDirectoryCurrent(YoriShPathCache.CurrentDirectory)) {
+
+        ReleaseMutex(YoriShPathCache.Mutex);
+        return FALSE;
+    }
+
+    for (Index = 0; Index < YoriShPathCache.DirectoryCount; Index++) {
+        if (!YoriShPathCacheIsDirectoryCurrent(YoriShPathCache.Directories[Index])) {
+            ReleaseMutex(YoriShPathCache.Mutex);
+            return FALSE;
+        }
+    }
+
+    YoriLibInitEmptyString(&FullName);
+    if (YoriShPathCacheReportExecutables(YoriShPathCache.CurrentDirectory, &Prefix, &FullName, MatchCallback, Context)) {
+        for (Index = 0; Index < YoriShPathCache.DirectoryCount; Index++) {
+            if (!YoriShPathCacheReportExecutables(YoriShPathCache.Directories[Index], &Prefix, &FullName, MatchCallback, Context)) {
+                break;
+            }
+        }
+    }
+
+    ReleaseMutex(YoriShPathCache.Mutex);
+    YoriLibFreeStringContents(&FullName);
+    return TRUE;
+}
+
+/**
+ Report a single file found in the cache to a file enumeration callback,
+ if its type is requested.  This is called with the lock held.
+
+ @param Directory Pointer to the directory containing the file.
+
+ @param File Pointer to the file.
+
+ @param MatchFlags Flags indicating whether files, directories, or both
+        should be reported.
+
+ @param FullName Pointer to a string used to construct the full name of the
+        file.
+
+ @param Callback The function to invoke for the file.
+
+ @param Context Context to pass to Callback.
+
+ @return TRUE to continue searching, FALSE if the callback indicated that
+         enumeration should stop.
+ */
+BOOL
+YoriShPathCacheReportFile(
+    __in PYORI_SH_PATH_CACHE_DIRECTORY Directory,
+    __in PYORI_SH_PATH_CACHE_FILE File,
+    __in DWORD MatchFlags,
+    __inout PYORI_STRING FullName,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in PVOID Context
+    )
+{
+    WIN32_FIND_DATA FindData;
+
+    if ((File->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        if ((MatchFlags & YORILIB_FILEENUM_RETURN_DIRECTORIES) == 0) {
+            return TRUE;
+        }
+    } else {
+        if ((MatchFlags & YORILIB_FILEENUM_RETURN_FILES) == 0) {
+            return TRUE;
+        }
+    }
+
+    if (!YoriShPathCacheBuildMatchName(Directory, &File->FileName, FullName)) {
+        return FALSE;
+    }
+
+    ZeroMemory(&FindData, sizeof(FindData));
+    FindData.dwFileAttributes = File->FileAttributes;
+    YoriLibSPrintfS(FindData.cFileName, sizeof(FindData.cFileName)/sizeof(FindData.cFileName[0]), _T("%y"), &File->FileName);
+    if (File->ShortName) {
+        YoriLibSPrintfS(FindData.cAlternateFileName, sizeof(FindData.cAlternateFileName)/sizeof(FindData.cAlternateFileName[0]), _T("%y"), &File->KeyName);
+    }
+
+    return Callback(FullName, &FindData, 0, Context);
+}
+
+/**
+ Search the cache for files in the current directory which match a search
+ string.  This answers the same query as @ref YoriLibForEachStream for a
+ simple file name prefix, but without accessing the disk.  Files are
+ reported in sorted order, and the information describing each file
+ contains only its names and attributes.
+
+ @param SearchFor Pointer to the search string, which must be a prefix
+        followed by a single trailing wildcard.
+
+ @param MatchFlags Flags indicating whether files, directories, or both
+        should be reported.  Other enumeration flags cannot be answered from
+        the cache.
+
+ @param Callback The function to invoke for each match.
+
+ @param Context Context to pass to Callback.
+
+ @return TRUE if the cache was used to answer the search.  FALSE if the
+         search cannot be answered from the cache, in which case Callback
+         has not been invoked and the caller should search on disk.
+ */
+__success(return)
+BOOL
+YoriShPathCacheFindFiles(
+    __in PYORI_STRING SearchFor,
+    __in DWORD MatchFlags,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in PVOID Context
+    )
+{
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    PYORI_SH_PATH_CACHE_FILE File;
+    YORI_STRING Prefix;
+    YORI_STRING NoExtension;
+    YORI_STRING FullName;
+    DWORD FirstIndex;
+    DWORD Index;
+
+    if (YoriShPathCache.Mutex == NULL) {
+        return FALSE;
+    }
+
+    if ((MatchFlags & ~(YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_RETURN_DIRECTORIES)) != 0) {
+        return FALSE;
+    }
+
+    //
+    //  Anything that the file enumerator would expand, or that would be
+    //  interpreted as a path, a stream, or a wildcard, needs to be searched
+    //  on disk.  A trailing period or space would be removed before
+    //  searching, and a leading tilde refers to a different directory.
+    //
+
+    if (!YoriShPathCacheGetSearchPrefix(SearchFor, _T("*?<>\":\\/[]{}"), &Prefix)) {
+        return FALSE;
+    }
+
+    if (Prefix.LengthInChars > 0) {
+        if (Prefix.StartOfString[0] == '~' ||
+            Prefix.StartOfString[Prefix.LengthInChars - 1] == '.' ||
+            Prefix.StartOfString[Prefix.LengthInChars - 1] == ' ') {
+
+            return FALSE;
+        }
+    }
+
+    WaitForSingleObject(YoriShPathCache.Mutex, INFINITE);
+
+    Directory = YoriShPathCache.CurrentDirectory;
+    if (Directory == NULL ||
+        !YoriShPathCacheIsDirectoryCurrent(Directory)) {
+
+        ReleaseMutex(YoriShPathCache.Mutex);
+        return FALSE;
+    }
+
+    YoriLibInitEmptyString(&NoExtension);
+    YoriLibInitEmptyString(&FullName);
+
+    //
+    //  Report files whose long name matches, followed by files whose short
+    //  name matches but long name does not.
+    //
+
+    FirstIndex = YoriShPathCacheLowerBound(Directory, &Prefix, &NoExtension);
+    for (Index = FirstIndex; Index < Directory->FileCount; Index++) {
+        File = Directory->Files[Index];
+        if (YoriLibCompareStringInsensitiveCount(&File->KeyName, &Prefix, Prefix.LengthInChars) != 0) {
+            break;
+        }
+        if (File->ShortName) {
+            continue;
+        }
+        if (!YoriShPathCacheReportFile(Directory, File, MatchFlags, &FullName, Callback, Context)) {
+            ReleaseMutex(YoriShPathCache.Mutex);
+            YoriLibFreeStringContents(&FullName);
+            return TRUE;
+        }
+    }
+
+    for (Index = FirstIndex; Index < Directory->FileCount; Index++) {
+        File = Directory->Files[Index];
+        if (YoriLibCompareStringInsensitiveCount(&File->KeyName, &Prefix, Prefix.LengthInChars) != 0) {
+            break;
+        }
+        if (!File->ShortName ||
+            YoriLibCompareStringInsensitiveCount(&File->FileName, &Prefix, Prefix.LengthInChars) == 0) {
+            continue;
+        }
+        if (!YoriShPathCacheReportFile(Directory, File, MatchFlags, &FullName, Callback, Context)) {
+            break;
+        }
+    }
+
+    ReleaseMutex(YoriShPathCache.Mutex);
+    YoriLibFreeStringContents(&FullName);
+    return TRUE;
+}
+
+/**
+ Return statistics about command resolution as a string, for the
+ YORIPATHCACHE variable.  This reports the number of commands resolved and
+ the average time taken in microseconds, both for commands which required
+ a directory to be searched and commands that could be resolved entirely
+ from cached directory contents.
+
+ @param Variable Pointer to the buffer to receive the string.  If NULL, the
+        length required is returned.
+
+ @param Size The length of Variable, in characters.
+
+ @return The number of characters copied (without NULL), or if the buffer
+         is too small, the number of characters needed (including NULL.)
+ */
+DWORD
+YoriShPathCacheGetStatistics(
+    __out_opt LPTSTR Variable,
+    __in DWORD Size
+    )
+{
+    TCHAR Buffer[100];
+    LARGE_INTEGER Frequency;
+    LONGLONG ColdAverage;
+    LONGLONG WarmAverage;
+    DWORD Length;
+
+    ColdAverage = 0;
+    WarmAverage = 0;
+    if (QueryPerformanceFrequency(&Frequency) && Frequency.QuadPart > 0) {
+        if (YoriShPathCache.ColdLookups > 0) {
+            ColdAverage = YoriShPathCache.ColdTime * 1000 * 1000 / Frequency.QuadPart / YoriShPathCache.ColdLookups;
+        }
+        if (YoriShPathCache.WarmLookups > 0) {
+            WarmAverage = YoriShPathCache.WarmTime * 1000 * 1000 / Frequency.QuadPart / YoriShPathCache.WarmLookups;
+        }
+    }
+
+    Length = YoriLibSPrintfS(Buffer,
+                             sizeof(Buffer)/sizeof(Buffer[0]),
+                             _T("cold=%i avg=%llius warm=%i avg=%llius"),
+                             YoriShPathCache.ColdLookups,
+                             ColdAverage,
+                             YoriShPathCache.WarmLookups,
+                             WarmAverage);
+
+    if (Variable == NULL || Length >= Size) {
+        return Length + 1;
+    }
+
+    memcpy(Variable, Buffer, (Length + 1) * sizeof(TCHAR));
+    return Length;
+}
+
+/**
+ Stop the background thread and free all state associated with the cache.
+ */
+VOID
+YoriShPathCacheCleanup()
+{
+    PYORI_SH_PATH_CACHE_DIRECTORY Directory;
+    PYORI_LIST_ENTRY ListEntry;
+
+    //
+    //  The thread may be enumerating a slow directory.  If it doesn't exit
+    //  promptly, leave the cache allocated, since the process is exiting
+    //  anyway.
+    //
+
+    if (YoriShPathCache.Thread != NULL) {
+        SetEvent(YoriShPathCache.ShutdownEvent);
+        if (WaitForSingleObject(YoriShPathCache.Thread, 1000) != WAIT_OBJECT_0) {
+            return;
+        }
+
+        CloseHandle(YoriShPathCache.Thread);
+        CloseHandle(YoriShPathCache.WakeEvent);
+        CloseHandle(YoriShPathCache.ShutdownEvent);
+        YoriShPathCache.Thread = NULL;
+        YoriShPathCache.WakeEvent = NULL;
+        YoriShPathCache.ShutdownEvent = NULL;
+    }
+
+    if (YoriShPathCache.Mutex == NULL) {
+        return;
+    }
+
+    YoriShPathCacheReleasePath();
+
+    ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, NULL);
+    while (ListEntry != NULL) {
+        Directory = CONTAINING_RECORD(ListEntry, YORI_SH_PATH_CACHE_DIRECTORY, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&YoriShPathCache.DirectoryList, ListEntry);
+        Directory->Recent = FALSE;
+        YoriShPathCacheDiscardIfUnused(Directory);
+    }
+
+    YoriShPathCache.CurrentDirectory = NULL;
+    YoriShPathCache.RecentCount = 0;
+    YoriLibFreeStringContents(&YoriShPathCache.CurrentDirectoryName);
+
+    CloseHandle(YoriShPathCache.Mutex);
+    YoriShPathCache.Mutex = NULL;
+}
+
+// vim:sw=4:ts=4:et:
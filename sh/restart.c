@@ -662,7 +662,6 @@ YoriShLoadSavedRestartState(
         LPTSTR ThisVar;
         LPTSTR ThisValue;
         YORI_STRING ThisEntry;
-        DWORD ValueLength;
 
         YoriShInitHistory();
 
@@ -675,13 +674,8 @@ YoriShLoadSavedRestartState(
                 if (ThisValue) {
                     ThisValue[0] = '\0';
                     ThisValue++;
-                    ValueLength = _tcslen(ThisValue);
-                    if (YoriLibAllocateString(&ThisEntry, ValueLength + 1)) {
-                        memcpy(ThisEntry.StartOfString, ThisValue, (ValueLength + 1) * sizeof(TCHAR));
-                        ThisEntry.LengthInChars = ValueLength;
-
-                        YoriShAddToHistory(&ThisEntry, FALSE);
-                    }
+                    YoriLibConstantString(&ThisEntry, ThisValue);
+                    YoriShAddToHistory(&ThisEntry, FALSE);
                 }
             }
         }
@@ -375,6 +375,16 @@ YoriShExpandBackquotes(
     __out PYORI_STRING ResultingExpression
     );
 
+__success(return)
+BOOL
+YoriShParseCmdlineToCmdContextWithCache(
+    __in PYORI_STRING Expression,
+    __out PYORI_SH_CMD_CONTEXT CmdContext
+    );
+
+VOID
+YoriShDiscardParseCache();
+
 __success(return)
 BOOL
 YoriShExecuteExpression(
@@ -416,6 +426,13 @@ __success(return)
 BOOL
 YoriShSaveHistoryToFile();
 
+PYORI_SH_HISTORY_ENTRY
+YoriShFindHistoryEntryContaining(
+    __in PYORI_STRING SearchString,
+    __in_opt PYORI_SH_HISTORY_ENTRY StartFrom,
+    __out PDWORD OffsetOfMatch
+    );
+
 __success(return)
 BOOL
 YoriShGetHistoryStrings(
@@ -531,6 +548,11 @@ YoriShParseCmdlineToCmdContext(
     __out PYORI_SH_CMD_CONTEXT CmdContext
     );
 
+VOID
+YoriShExpandEnvironmentVariablesInCmdContext(
+    __inout PYORI_SH_CMD_CONTEXT CmdContext
+    );
+
 __success(return)
 BOOLEAN
 YoriShBuildCmdlineFromCmdContext(
@@ -629,6 +651,44 @@ YoriShFindBestBackquoteSubstringAtOffset(
     __out PYORI_STRING CurrentSubset
     );
 
+// *** PATHCACHE.C ***
+
+__success(return)
+BOOL
+YoriShPathCacheLocateExecutable(
+    __in PYORI_STRING SearchFor,
+    __out PYORI_STRING PathName
+    );
+
+DWORD
+YoriShPathCacheGetStatistics(
+    __out_opt LPTSTR Variable,
+    __in DWORD Size
+    );
+
+VOID
+YoriShPathCacheRefresh();
+
+__success(return)
+BOOL
+YoriShPathCacheFindExecutables(
+    __in PYORI_STRING SearchFor,
+    __in PYORI_LIB_PATH_MATCH_FN MatchCallback,
+    __in PVOID Context
+    );
+
+__success(return)
+BOOL
+YoriShPathCacheFindFiles(
+    __in PYORI_STRING SearchFor,
+    __in DWORD MatchFlags,
+    __in PYORILIB_FILE_ENUM_FN Callback,
+    __in PVOID Context
+    );
+
+VOID
+YoriShPathCacheCleanup();
+
 // *** PROMPT.C ***
 BOOL
 YoriShDisplayPrompt();
@@ -428,9 +428,21 @@ typedef struct _YORI_SH_HISTORY_ENTRY {
     YORI_LIST_ENTRY ListEntry;
 
     /**
-     The command that was executed by the user.
+     The command that was executed by the user.  This refers to memory
+     within the same allocation as the history entry.
      */
     YORI_STRING CmdLine;
+
+    /**
+     A number which increases with each entry added to history, used to
+     order entries found via the history index.
+     */
+    DWORD Sequence;
+
+    /**
+     TRUE if this entry has been appended to the history file.
+     */
+    BOOLEAN Logged;
 } YORI_SH_HISTORY_ENTRY, *PYORI_SH_HISTORY_ENTRY;
 
 /**
@@ -714,6 +726,19 @@ typedef struct _YORI_SH_INPUT_BUFFER {
      */
     YORI_STRING SearchString;
 
+    /**
+     If TRUE, the search string is used to find a previous command in
+     history containing it, rather than to search within the buffer itself.
+     */
+    BOOL HistorySearchMode;
+
+    /**
+     When searching history, the history entry currently displayed in the
+     buffer because it contains the search string.  NULL if no match has
+     been found.
+     */
+    PYORI_SH_HISTORY_ENTRY HistorySearchMatch;
+
 } YORI_SH_INPUT_BUFFER, *PYORI_SH_INPUT_BUFFER;
 
 /**
@@ -160,6 +160,7 @@ SplitProcessStream(
     )
 {
     HANDLE hDestFile = NULL;
+    YORI_LIB_MAPPED_INPUT MappedInput;
 
     if (SplitContext->LinesMode) {
         PVOID LineContext = NULL;
@@ -196,6 +197,62 @@ SplitProcessStream(
 
         YoriLibLineReadClose(LineContext);
         YoriLibFreeStringContents(&LineString);
+    } else if (YoriLibMappedInputOpen(hSource, &MappedInput)) {
+        PVOID Buffer;
+        DWORD BytesInPiece;
+        DWORD BytesWritten;
+        LONGLONG BytesRemainingInPart;
+
+        //
+        //  If the source is a file, write each part directly from mapped
+        //  views of it rather than copying it through an allocation the
+        //  size of a part.
+        //
+
+        while (TRUE) {
+            BytesRemainingInPart = SplitContext->BytesPerPart;
+            if (!YoriLibMappedInputGetNext(&MappedInput, (DWORD)BytesRemainingInPart, &Buffer, &BytesInPiece)) {
+                break;
+            }
+
+            hDestFile = SplitOpenTargetForCurrentPart(SplitContext);
+            if (hDestFile == NULL) {
+                YoriLibMappedInputClose(&MappedInput);
+                return FALSE;
+            }
+            SplitContext->CurrentPartNumber++;
+
+            while (TRUE) {
+                if (!WriteFile(hDestFile, Buffer, BytesInPiece, &BytesWritten, NULL)) {
+                    DWORD LastError = GetLastError();
+                    LPTSTR ErrText = YoriLibGetWinErrorText(LastError);
+                    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: write failed: %s"), ErrText);
+                    YoriLibFreeWinErrorText(ErrText);
+                    CloseHandle(hDestFile);
+                    YoriLibMappedInputClose(&MappedInput);
+                    return FALSE;
+                }
+
+                BytesRemainingInPart = BytesRemainingInPart - BytesInPiece;
+                if (BytesRemainingInPart == 0) {
+                    break;
+                }
+
+                if (!YoriLibMappedInputGetNext(&MappedInput, (DWORD)BytesRemainingInPart, &Buffer, &BytesInPiece)) {
+                    break;
+                }
+            }
+
+            CloseHandle(hDestFile);
+        }
+
+        if (MappedInput.Failed) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("split: read failed\n"));
+            YoriLibMappedInputClose(&MappedInput);
+            return FALSE;
+        }
+
+        YoriLibMappedInputClose(&MappedInput);
     } else {
         PVOID Buffer;
         ULONG BytesRead;
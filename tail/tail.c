@@ -41,7 +41,8 @@ CHAR strTailHelpText[] =
         "\n"
         "   -b             Use basic search criteria for files only\n"
         "   -c             Specify a line to display context around instead of EOF\n"
-        "   -f             Wait for new output and continue outputting\n"
+        "   -f             Wait for new output and continue outputting, including if\n"
+        "                    files are truncated or replaced\n"
         "   -n             Specify the number of lines to display\n"
         "   -s             Process files from all subdirectories\n";
 
@@ -59,6 +60,69 @@ TailHelp()
     return TRUE;
 }
 
+/**
+ The interval to check followed files for changes, in milliseconds, if any
+ of them cannot be monitored with change notifications.
+ */
+#define TAIL_FOLLOW_POLL_INTERVAL 1000
+
+/**
+ The maximum number of directory change notifications that can be used to
+ monitor followed files.  One wait object is reserved for cancellation.
+ */
+#define TAIL_MAX_CHANGE_NOTIFICATIONS (MAXIMUM_WAIT_OBJECTS - 1)
+
+/**
+ Information about a file that is being followed for new output.
+ */
+typedef struct _TAIL_FOLLOW_FILE {
+
+    /**
+     The list of files being followed.  Paired with FollowFileList in
+     TAIL_CONTEXT.
+     */
+    YORI_LIST_ENTRY ListEntry;
+
+    /**
+     The full path to the file.  This is empty if the file was supplied as
+     standard input, in which case it cannot be reopened if it is rotated.
+     */
+    YORI_STRING FilePath;
+
+    /**
+     The path to the file to display in headers.
+     */
+    YORI_STRING DisplayPath;
+
+    /**
+     A handle to the file being read.
+     */
+    HANDLE FileHandle;
+
+    /**
+     The line read context for the file, which contains any partial line
+     that has been read but not yet output.
+     */
+    PVOID LineContext;
+
+    /**
+     The volume serial number of the file being read, used to detect if the
+     path now refers to a different file.
+     */
+    DWORD VolumeSerialNumber;
+
+    /**
+     The high 32 bits of the file index of the file being read.
+     */
+    DWORD FileIndexHigh;
+
+    /**
+     The low 32 bits of the file index of the file being read.
+     */
+    DWORD FileIndexLow;
+
+} TAIL_FOLLOW_FILE, *PTAIL_FOLLOW_FILE;
+
 /**
  Context passed to the callback which is invoked for each file found.
  */
@@ -117,8 +181,230 @@ typedef struct _TAIL_CONTEXT {
      */
     BOOLEAN Recursive;
 
+    /**
+     TRUE if one or more followed files could not be monitored with change
+     notifications, so they need to be checked periodically.
+     */
+    BOOLEAN PollRequired;
+
+    /**
+     The list of files being followed.  Paired with ListEntry in
+     TAIL_FOLLOW_FILE.
+     */
+    YORI_LIST_ENTRY FollowFileList;
+
+    /**
+     The number of files in FollowFileList.
+     */
+    DWORD FollowFileCount;
+
+    /**
+     The file that most recently generated output, used to determine when
+     a header is needed to indicate that output is from a different file.
+     */
+    PTAIL_FOLLOW_FILE LastOutputFile;
+
+    /**
+     The number of entries in ChangeNotifications.
+     */
+    DWORD ChangeNotificationCount;
+
+    /**
+     Change notifications monitoring the directories containing followed
+     files.
+     */
+    HANDLE ChangeNotifications[TAIL_MAX_CHANGE_NOTIFICATIONS];
+
+    /**
+     The directories monitored by each entry in ChangeNotifications.
+     */
+    YORI_STRING NotificationDirectories[TAIL_MAX_CHANGE_NOTIFICATIONS];
+
 } TAIL_CONTEXT, *PTAIL_CONTEXT;
 
+/**
+ If output is being generated from more than one followed file, and the
+ previous output was from a different file, output a header indicating the
+ file that the following lines are from.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FollowFile Pointer to the file that is about to generate output.
+ */
+VOID
+TailOutputHeaderIfNeeded(
+    __in PTAIL_CONTEXT TailContext,
+    __in PTAIL_FOLLOW_FILE FollowFile
+    )
+{
+    if (TailContext->LastOutputFile == FollowFile) {
+        return;
+    }
+
+    if (TailContext->FollowFileCount > 1) {
+        if (TailContext->LastOutputFile != NULL) {
+            YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("\n"));
+        }
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("==> %y <==\n"), &FollowFile->DisplayPath);
+    }
+    TailContext->LastOutputFile = FollowFile;
+}
+
+/**
+ The size of each block to read when scanning backwards from the end of a
+ file for line breaks, in bytes.
+ */
+#define TAIL_SCAN_BLOCK_SIZE (64 * 1024)
+
+/**
+ A value which contains the specified byte in every byte of a pointer sized
+ value.
+ */
+#define TAIL_REPEAT_BYTE(b) ((DWORD_PTR)-1 / 0xFF * (b))
+
+/**
+ Returns nonzero if any byte within a pointer sized value is zero.
+ */
+#define TAIL_HAS_ZERO_BYTE(v) (((v) - TAIL_REPEAT_BYTE(0x01)) & ~(v) & TAIL_REPEAT_BYTE(0x80))
+
+/**
+ Scan backwards from the end of a file to find the offset of the start of
+ the final lines within it.  Line breaks are a carriage return, a line feed,
+ or a carriage return followed by a line feed, matching the line reader.
+ This allows the final lines to be located by reading only the end of the
+ file, regardless of the size of the file or its lines.
+
+ @param hSource Handle to the file, which must support seeking.
+
+ @param LinesToFind The number of lines to locate at the end of the file.
+
+ @param StartOffset On successful completion, populated with the offset
+        within the file to read from.  Reading from this offset will return
+        at least the requested number of lines, or the entire file if it
+        contains fewer lines.  The caller is expected to discard any extra
+        lines at the beginning.
+
+ @return TRUE to indicate success, FALSE to indicate failure.
+ */
+__success(return)
+BOOL
+TailFindFinalLinesOffset(
+    __in HANDLE hSource,
+    __in DWORD LinesToFind,
+    __out PLARGE_INTEGER StartOffset
+    )
+{
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER BlockStart;
+    LARGE_INTEGER BlockEnd;
+    DWORD BytesInBlock;
+    DWORD BytesRead;
+    DWORD CharSize;
+    DWORD Index;
+    DWORD LineBreaksFound;
+    DWORD_PTR Word;
+    WCHAR ThisChar;
+    WCHAR NextChar;
+    PUCHAR Buffer;
+    PWCHAR WideBuffer;
+
+    FileSize.LowPart = GetFileSize(hSource, (LPDWORD)&FileSize.HighPart);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        return FALSE;
+    }
+
+    Buffer = YoriLibMalloc(TAIL_SCAN_BLOCK_SIZE);
+    if (Buffer == NULL) {
+        return FALSE;
+    }
+    WideBuffer = (PWCHAR)Buffer;
+
+    CharSize = sizeof(CHAR);
+    if (YoriLibGetMultibyteInputEncoding() == CP_UTF16) {
+        CharSize = sizeof(WCHAR);
+    }
+
+    //
+    //  The final line may or may not have a line break.  Either way, the
+    //  line break before the requested lines is at most LinesToFind + 1
+    //  line breaks from the end.
+    //
+
+    LineBreaksFound = 0;
+    NextChar = 0;
+    BlockEnd.QuadPart = FileSize.QuadPart - (FileSize.QuadPart % CharSize);
+    StartOffset->QuadPart = 0;
+
+    while (BlockEnd.QuadPart > 0) {
+
+        BytesInBlock = TAIL_SCAN_BLOCK_SIZE;
+        if (BlockEnd.QuadPart < BytesInBlock) {
+            BytesInBlock = BlockEnd.LowPart;
+        }
+        BlockStart.QuadPart = BlockEnd.QuadPart - BytesInBlock;
+
+        if (SetFilePointer(hSource, BlockStart.LowPart, &BlockStart.HighPart, FILE_BEGIN) == INVALID_SET_FILE_POINTER &&
+            GetLastError() != NO_ERROR) {
+
+            YoriLibFree(Buffer);
+            return FALSE;
+        }
+
+        for (Index = 0; Index < BytesInBlock; Index += BytesRead) {
+            if (!ReadFile(hSource, &Buffer[Index], BytesInBlock - Index, &BytesRead, NULL) ||
+                BytesRead == 0) {
+
+                YoriLibFree(Buffer);
+                return FALSE;
+            }
+        }
+
+        //
+        //  Walk backwards through the block.  For single byte encodings,
+        //  skip over aligned words which contain no line break characters
+        //  without inspecting each byte.
+        //
+
+        Index = BytesInBlock / CharSize;
+        while (Index > 0) {
+            if (CharSize == sizeof(CHAR)) {
+                while (Index >= sizeof(DWORD_PTR) && (Index % sizeof(DWORD_PTR)) == 0) {
+                    Word = *(DWORD_PTR *)&Buffer[Index - sizeof(DWORD_PTR)];
+                    if (TAIL_HAS_ZERO_BYTE(Word ^ TAIL_REPEAT_BYTE('\n')) ||
+                        TAIL_HAS_ZERO_BYTE(Word ^ TAIL_REPEAT_BYTE('\r'))) {
+                        break;
+                    }
+                    Index -= sizeof(DWORD_PTR);
+                    NextChar = Buffer[Index];
+                }
+                if (Index == 0) {
+                    break;
+                }
+                Index--;
+                ThisChar = Buffer[Index];
+            } else {
+                Index--;
+                ThisChar = WideBuffer[Index];
+            }
+
+            if (ThisChar == '\n' || (ThisChar == '\r' && NextChar != '\n')) {
+                LineBreaksFound++;
+                if (LineBreaksFound > LinesToFind) {
+                    StartOffset->QuadPart = BlockStart.QuadPart + (Index + 1) * CharSize;
+                    YoriLibFree(Buffer);
+                    return TRUE;
+                }
+            }
+            NextChar = ThisChar;
+        }
+
+        BlockEnd.QuadPart = BlockStart.QuadPart;
+    }
+
+    YoriLibFree(Buffer);
+    return TRUE;
+}
+
 /**
  Process a single opened stream, enumerating through all lines and displaying
  the set requested by the user.
@@ -127,13 +413,19 @@ typedef struct _TAIL_CONTEXT {
 
  @param TailContext Pointer to context information specifying which lines to
         display.
+
+ @param FollowFile Optionally points to a file which will be followed for
+        new output once this function returns.  If specified, the line read
+        context is retained in this structure so that any partial final
+        line is completed when more data arrives.
  
  @return TRUE to indicate success, FALSE to indicate failure.
  */
 BOOL
 TailProcessStream(
     __in HANDLE hSource,
-    __in PTAIL_CONTEXT TailContext
+    __in PTAIL_CONTEXT TailContext,
+    __in_opt PTAIL_FOLLOW_FILE FollowFile
     )
 {
     PVOID LineContext = NULL;
@@ -142,87 +434,78 @@ TailProcessStream(
     PYORI_STRING LineString;
     YORI_LIB_LINE_ENDING LineEnding;
     BOOL TimeoutReached;
-    DWORD SeekToEndOffset = 0;
+    LARGE_INTEGER StartOffset;
 
     DWORD FileType = GetFileType(hSource);
     FileType = FileType & ~(FILE_TYPE_REMOTE);
 
     //
-    //  If it's a file and we want the final few lines, start searching
-    //  from the end, assuming an average line size of 256 bytes.
+    //  If it's a file and we want the final few lines, scan backwards from
+    //  the end to find where they start.  If that fails, read the whole
+    //  file.
     //
 
     if (FileType == FILE_TYPE_DISK && TailContext->FinalLine == 0) {
-        SeekToEndOffset = 256 * TailContext->LinesToDisplay;
-    }
-
-    TailContext->FilesFound++;
-    TailContext->FilesFoundThisArg++;
-
-    while (TRUE) {
-
-        if (SeekToEndOffset != 0) {
-            if (!SetFilePointer(hSource, -1 * SeekToEndOffset, NULL, FILE_END)) {
-                SeekToEndOffset = 0;
-                SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
-            }
+        if (!TailFindFinalLinesOffset(hSource, TailContext->LinesToDisplay, &StartOffset)) {
+            StartOffset.QuadPart = 0;
         }
-        TailContext->LinesFound = 0;
+        SetFilePointer(hSource, StartOffset.LowPart, &StartOffset.HighPart, FILE_BEGIN);
+    }
 
-        while (TRUE) {
+    //
+    //  Followed files were counted when they were found.
+    //
 
-            if (!YoriLibReadLineToStringEx(&TailContext->LinesArray[TailContext->LinesFound % TailContext->LinesToDisplay], &LineContext, !TailContext->WaitForMore, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
-                break;
-            }
+    if (FollowFile == NULL) {
+        TailContext->FilesFound++;
+        TailContext->FilesFoundThisArg++;
+    }
 
-            TailContext->LinesFound++;
+    TailContext->LinesFound = 0;
 
-            if (TailContext->FinalLine != 0 && TailContext->LinesFound >= TailContext->FinalLine) {
-                break;
-            }
-        }
+    while (TRUE) {
 
-        if (TailContext->LinesFound > TailContext->LinesToDisplay) {
-            StartLine = TailContext->LinesFound - TailContext->LinesToDisplay;
+        if (!YoriLibReadLineToStringEx(&TailContext->LinesArray[TailContext->LinesFound % TailContext->LinesToDisplay], &LineContext, !TailContext->WaitForMore, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
             break;
-        } else if (SeekToEndOffset != 0) {
+        }
 
-            //
-            //  If we didn't get enough lines and we have a file that
-            //  supports arbitrary seeks, try to grab more data.  If
-            //  we've already hit our arbitrary maximum (a 4Kb average
-            //  line size) start scanning from the top.
-            //
+        TailContext->LinesFound++;
 
-            if (SeekToEndOffset < 4096 * TailContext->LinesToDisplay) {
-                SeekToEndOffset = 4096 * TailContext->LinesToDisplay;
-            } else {
-                SeekToEndOffset = 0;
-                SetFilePointer(hSource, 0, NULL, FILE_BEGIN);
-            }
-            YoriLibLineReadClose(LineContext);
-            LineContext = NULL;
-            continue;
-        } else {
-            StartLine = 0;
+        if (TailContext->FinalLine != 0 && TailContext->LinesFound >= TailContext->FinalLine) {
             break;
         }
     }
 
+    if (TailContext->LinesFound > TailContext->LinesToDisplay) {
+        StartLine = TailContext->LinesFound - TailContext->LinesToDisplay;
+    }
+
+    if (FollowFile != NULL) {
+        TailOutputHeaderIfNeeded(TailContext, FollowFile);
+    }
+
     for (CurrentLine = StartLine; CurrentLine < TailContext->LinesFound; CurrentLine++) {
         LineString = &TailContext->LinesArray[CurrentLine % TailContext->LinesToDisplay];
         YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), LineString);
     }
 
+    if (FollowFile != NULL) {
+        FollowFile->LineContext = LineContext;
+        return TRUE;
+    }
+
+    //
+    //  If following a pipe, a read waits for more data to arrive, so keep
+    //  reading until the source terminates.  Output should be visible as
+    //  soon as it arrives, so write out any buffered output before waiting
+    //  for more.
+    //
+
     if (TailContext->WaitForMore) {
         while (TRUE) {
-
+            YoriLibOutputFlush(GetStdHandle(STD_OUTPUT_HANDLE));
             if (!YoriLibReadLineToStringEx(&TailContext->LinesArray[0], &LineContext, FALSE, INFINITE, hSource, &LineEnding, &TimeoutReached)) {
-                if (YoriLibIsOperationCancelled()) {
-                    break;
-                }
-                Sleep(200);
-                continue;
+                break;
             }
             YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &TailContext->LinesArray[0]);
         }
@@ -232,6 +515,400 @@ TailProcessStream(
     return TRUE;
 }
 
+/**
+ Record the identity of the file that a followed file's handle refers to,
+ so that it can be compared against the file its path refers to later.
+
+ @param FollowFile Pointer to the followed file.
+ */
+VOID
+TailCaptureFileIdentity(
+    __inout PTAIL_FOLLOW_FILE FollowFile
+    )
+{
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+
+    if (GetFileInformationByHandle(FollowFile->FileHandle, &FileInfo)) {
+        FollowFile->VolumeSerialNumber = FileInfo.dwVolumeSerialNumber;
+        FollowFile->FileIndexHigh = FileInfo.nFileIndexHigh;
+        FollowFile->FileIndexLow = FileInfo.nFileIndexLow;
+    }
+}
+
+/**
+ Monitor the directory containing a followed file for changes.  Files in
+ the same directory share a single change notification.  If the directory
+ cannot be monitored, the file will be checked periodically instead.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FollowFile Pointer to the followed file.
+ */
+VOID
+TailMonitorDirectoryForFile(
+    __inout PTAIL_CONTEXT TailContext,
+    __in PTAIL_FOLLOW_FILE FollowFile
+    )
+{
+    YORI_STRING Directory;
+    LPTSTR FilePart;
+    DWORD Index;
+    HANDLE ChangeNotification;
+
+    FilePart = YoriLibFindRightMostCharacter(&FollowFile->FilePath, '\\');
+    if (FilePart == NULL) {
+        TailContext->PollRequired = TRUE;
+        return;
+    }
+
+    YoriLibInitEmptyString(&Directory);
+    Directory.StartOfString = FollowFile->FilePath.StartOfString;
+    Directory.LengthInChars = (DWORD)(FilePart - FollowFile->FilePath.StartOfString);
+
+    for (Index = 0; Index < TailContext->ChangeNotificationCount; Index++) {
+        if (YoriLibCompareStringInsensitive(&Directory, &TailContext->NotificationDirectories[Index]) == 0) {
+            return;
+        }
+    }
+
+    if (TailContext->ChangeNotificationCount >= TAIL_MAX_CHANGE_NOTIFICATIONS ||
+        !YoriLibAllocateString(&TailContext->NotificationDirectories[TailContext->ChangeNotificationCount], Directory.LengthInChars + 1)) {
+
+        TailContext->PollRequired = TRUE;
+        return;
+    }
+
+    Index = TailContext->ChangeNotificationCount;
+    memcpy(TailContext->NotificationDirectories[Index].StartOfString, Directory.StartOfString, Directory.LengthInChars * sizeof(TCHAR));
+    TailContext->NotificationDirectories[Index].StartOfString[Directory.LengthInChars] = '\0';
+    TailContext->NotificationDirectories[Index].LengthInChars = Directory.LengthInChars;
+
+    ChangeNotification = FindFirstChangeNotification(TailContext->NotificationDirectories[Index].StartOfString,
+                                                     FALSE,
+                                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+
+    if (ChangeNotification == INVALID_HANDLE_VALUE || ChangeNotification == NULL) {
+        YoriLibFreeStringContents(&TailContext->NotificationDirectories[Index]);
+        TailContext->PollRequired = TRUE;
+        return;
+    }
+
+    TailContext->ChangeNotifications[Index] = ChangeNotification;
+    TailContext->ChangeNotificationCount++;
+}
+
+/**
+ Add a file to the set of files to follow for new output.  The file is not
+ output until all files have been found, so that headers can be displayed
+ if more than one file is being followed.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FilePath Optionally points to the full path to the file.  If NULL,
+        the file is standard input, which cannot be reopened if it is
+        rotated.
+
+ @param FileHandle Handle to the opened file.  On success, ownership of
+        this handle is transferred to the followed file.
+
+ @return TRUE to indicate the file will be followed, FALSE if it could not
+         be added.
+ */
+BOOL
+TailAddFollowFile(
+    __inout PTAIL_CONTEXT TailContext,
+    __in_opt PYORI_STRING FilePath,
+    __in HANDLE FileHandle
+    )
+{
+    PTAIL_FOLLOW_FILE FollowFile;
+
+    FollowFile = YoriLibMalloc(sizeof(TAIL_FOLLOW_FILE));
+    if (FollowFile == NULL) {
+        return FALSE;
+    }
+
+    ZeroMemory(FollowFile, sizeof(TAIL_FOLLOW_FILE));
+    YoriLibInitEmptyString(&FollowFile->FilePath);
+    YoriLibInitEmptyString(&FollowFile->DisplayPath);
+
+    if (FilePath != NULL) {
+        if (!YoriLibAllocateString(&FollowFile->FilePath, FilePath->LengthInChars + 1)) {
+            YoriLibFree(FollowFile);
+            return FALSE;
+        }
+        memcpy(FollowFile->FilePath.StartOfString, FilePath->StartOfString, FilePath->LengthInChars * sizeof(TCHAR));
+        FollowFile->FilePath.StartOfString[FilePath->LengthInChars] = '\0';
+        FollowFile->FilePath.LengthInChars = FilePath->LengthInChars;
+
+        if (!YoriLibUnescapePath(&FollowFile->FilePath, &FollowFile->DisplayPath)) {
+            FollowFile->DisplayPath.StartOfString = FollowFile->FilePath.StartOfString;
+            FollowFile->DisplayPath.LengthInChars = FollowFile->FilePath.LengthInChars;
+        }
+    } else {
+        YoriLibConstantString(&FollowFile->DisplayPath, _T("standard input"));
+    }
+
+    FollowFile->FileHandle = FileHandle;
+    TailCaptureFileIdentity(FollowFile);
+
+    if (FilePath != NULL) {
+        TailMonitorDirectoryForFile(TailContext, FollowFile);
+    } else {
+        TailContext->PollRequired = TRUE;
+    }
+
+    YoriLibAppendList(&TailContext->FollowFileList, &FollowFile->ListEntry);
+    TailContext->FollowFileCount++;
+    TailContext->FilesFound++;
+    TailContext->FilesFoundThisArg++;
+    return TRUE;
+}
+
+/**
+ Output any complete lines which have been added to a followed file since
+ it was last checked.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FollowFile Pointer to the followed file.
+
+ @param ReturnFinalNonTerminatedLine If TRUE, output any partial line at the
+        end of the file.  This is used when the file has been replaced, so
+        no further data will be added to it.
+ */
+VOID
+TailOutputNewLines(
+    __inout PTAIL_CONTEXT TailContext,
+    __inout PTAIL_FOLLOW_FILE FollowFile,
+    __in BOOL ReturnFinalNonTerminatedLine
+    )
+{
+    YORI_LIB_LINE_ENDING LineEnding;
+    BOOL TimeoutReached;
+
+    while (YoriLibReadLineToStringEx(&TailContext->LinesArray[0], &FollowFile->LineContext, ReturnFinalNonTerminatedLine, INFINITE, FollowFile->FileHandle, &LineEnding, &TimeoutReached)) {
+        TailOutputHeaderIfNeeded(TailContext, FollowFile);
+        YoriLibOutput(YORI_LIB_OUTPUT_STDOUT, _T("%y\n"), &TailContext->LinesArray[0]);
+    }
+}
+
+/**
+ Check a followed file for new data, truncation, or replacement, and output
+ any new lines.
+
+ @param TailContext Pointer to the tail context.
+
+ @param FollowFile Pointer to the followed file.
+ */
+VOID
+TailCheckFollowFile(
+    __inout PTAIL_CONTEXT TailContext,
+    __inout PTAIL_FOLLOW_FILE FollowFile
+    )
+{
+    LARGE_INTEGER FileSize;
+    LARGE_INTEGER CurrentOffset;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    HANDLE NewFileHandle;
+    BOOL SizeValid;
+
+    //
+    //  If the file is now smaller than the data that has been read from it,
+    //  it has been truncated, so start again from the beginning.
+    //
+
+    SizeValid = TRUE;
+    CurrentOffset.HighPart = 0;
+    CurrentOffset.LowPart = SetFilePointer(FollowFile->FileHandle, 0, &CurrentOffset.HighPart, FILE_CURRENT);
+    if (CurrentOffset.LowPart == INVALID_SET_FILE_POINTER && GetLastError() != NO_ERROR) {
+        SizeValid = FALSE;
+    }
+
+    FileSize.LowPart = GetFileSize(FollowFile->FileHandle, (LPDWORD)&FileSize.HighPart);
+    if (FileSize.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR) {
+        SizeValid = FALSE;
+    }
+
+    if (SizeValid && FileSize.QuadPart < CurrentOffset.QuadPart) {
+
+        YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tail: %y: file truncated\n"), &FollowFile->DisplayPath);
+        YoriLibLineReadClose(FollowFile->LineContext);
+        FollowFile->LineContext = NULL;
+        SetFilePointer(FollowFile->FileHandle, 0, NULL, FILE_BEGIN);
+    }
+
+    TailOutputNewLines(TailContext, FollowFile, FALSE);
+
+    //
+    //  If the path now refers to a different file, the file has been
+    //  renamed and a new one created in its place.  Output anything that
+    //  remains in the previous file, and continue from the start of the new
+    //  one.  If there is nothing at the path, the previous file may have
+    //  been renamed but a new one has not yet been created, so keep
+    //  reading the previous one.
+    //
+
+    if (FollowFile->FilePath.LengthInChars == 0) {
+        return;
+    }
+
+    NewFileHandle = CreateFile(FollowFile->FilePath.StartOfString,
+                               GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL,
+                               OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_BACKUP_SEMANTICS,
+                               NULL);
+
+    if (NewFileHandle == NULL || NewFileHandle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    if (!GetFileInformationByHandle(NewFileHandle, &FileInfo) ||
+        (FileInfo.dwVolumeSerialNumber == FollowFile->VolumeSerialNumber &&
+         FileInfo.nFileIndexHigh == FollowFile->FileIndexHigh &&
+         FileInfo.nFileIndexLow == FollowFile->FileIndexLow)) {
+
+        CloseHandle(NewFileHandle);
+        return;
+    }
+
+    TailOutputNewLines(TailContext, FollowFile, TRUE);
+    YoriLibLineReadClose(FollowFile->LineContext);
+    FollowFile->LineContext = NULL;
+    CloseHandle(FollowFile->FileHandle);
+
+    YoriLibOutput(YORI_LIB_OUTPUT_STDERR, _T("tail: %y has been replaced, following new file\n"), &FollowFile->DisplayPath);
+    FollowFile->FileHandle = NewFileHandle;
+    FollowFile->VolumeSerialNumber = FileInfo.dwVolumeSerialNumber;
+    FollowFile->FileIndexHigh = FileInfo.nFileIndexHigh;
+    FollowFile->FileIndexLow = FileInfo.nFileIndexLow;
+
+    TailOutputNewLines(TailContext, FollowFile, FALSE);
+}
+
+/**
+ Output the final lines of each followed file, and then wait for changes to
+ any of them and output new lines as they arrive.  This returns when the
+ operation is cancelled.
+
+ @param TailContext Pointer to the tail context.
+ */
+VOID
+TailFollowFiles(
+    __inout PTAIL_CONTEXT TailContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PTAIL_FOLLOW_FILE FollowFile;
+    HANDLE WaitHandles[MAXIMUM_WAIT_OBJECTS];
+    HANDLE CancelEvent;
+    DWORD HandleCount;
+    DWORD Timeout;
+    DWORD WaitResult;
+    DWORD Index;
+
+    ListEntry = YoriLibGetNextListEntry(&TailContext->FollowFileList, NULL);
+    while (ListEntry != NULL) {
+        FollowFile = CONTAINING_RECORD(ListEntry, TAIL_FOLLOW_FILE, ListEntry);
+        TailProcessStream(FollowFile->FileHandle, TailContext, FollowFile);
+        ListEntry = YoriLibGetNextListEntry(&TailContext->FollowFileList, ListEntry);
+    }
+
+    //
+    //  Wait for cancellation or for a change in any directory containing a
+    //  followed file.  If any file can't be monitored, wake periodically to
+    //  check it.
+    //
+
+    HandleCount = 0;
+    CancelEvent = YoriLibCancelGetEvent();
+    if (CancelEvent != NULL) {
+        WaitHandles[HandleCount++] = CancelEvent;
+    }
+
+    for (Index = 0; Index < TailContext->ChangeNotificationCount; Index++) {
+        WaitHandles[HandleCount++] = TailContext->ChangeNotifications[Index];
+    }
+
+    Timeout = INFINITE;
+    if (TailContext->PollRequired || HandleCount == 0) {
+        Timeout = TAIL_FOLLOW_POLL_INTERVAL;
+    }
+
+    while (TRUE) {
+
+        YoriLibOutputFlush(GetStdHandle(STD_OUTPUT_HANDLE));
+
+        if (HandleCount == 0) {
+            Sleep(Timeout);
+        } else {
+            WaitResult = WaitForMultipleObjects(HandleCount, WaitHandles, FALSE, Timeout);
+            if (WaitResult == WAIT_FAILED) {
+                break;
+            }
+
+            if (WaitResult >= WAIT_OBJECT_0 && WaitResult < WAIT_OBJECT_0 + HandleCount) {
+                Index = WaitResult - WAIT_OBJECT_0;
+                if (WaitHandles[Index] == CancelEvent) {
+                    break;
+                }
+                FindNextChangeNotification(WaitHandles[Index]);
+            }
+        }
+
+        if (YoriLibIsOperationCancelled()) {
+            break;
+        }
+
+        ListEntry = YoriLibGetNextListEntry(&TailContext->FollowFileList, NULL);
+        while (ListEntry != NULL) {
+            FollowFile = CONTAINING_RECORD(ListEntry, TAIL_FOLLOW_FILE, ListEntry);
+            TailCheckFollowFile(TailContext, FollowFile);
+            ListEntry = YoriLibGetNextListEntry(&TailContext->FollowFileList, ListEntry);
+        }
+    }
+}
+
+/**
+ Free all state associated with following files.
+
+ @param TailContext Pointer to the tail context.
+ */
+VOID
+TailCleanupFollowFiles(
+    __inout PTAIL_CONTEXT TailContext
+    )
+{
+    PYORI_LIST_ENTRY ListEntry;
+    PTAIL_FOLLOW_FILE FollowFile;
+    DWORD Index;
+
+    ListEntry = YoriLibGetNextListEntry(&TailContext->FollowFileList, NULL);
+    while (ListEntry != NULL) {
+        FollowFile = CONTAINING_RECORD(ListEntry, TAIL_FOLLOW_FILE, ListEntry);
+        ListEntry = YoriLibGetNextListEntry(&TailContext->FollowFileList, ListEntry);
+        YoriLibRemoveListItem(&FollowFile->ListEntry);
+        if (FollowFile->LineContext != NULL) {
+            YoriLibLineReadClose(FollowFile->LineContext);
+        }
+        if (FollowFile->FilePath.LengthInChars > 0) {
+            CloseHandle(FollowFile->FileHandle);
+        }
+        YoriLibFreeStringContents(&FollowFile->DisplayPath);
+        YoriLibFreeStringContents(&FollowFile->FilePath);
+        YoriLibFree(FollowFile);
+    }
+    TailContext->FollowFileCount = 0;
+
+    for (Index = 0; Index < TailContext->ChangeNotificationCount; Index++) {
+        FindCloseChangeNotification(TailContext->ChangeNotifications[Index]);
+        YoriLibFreeStringContents(&TailContext->NotificationDirectories[Index]);
+    }
+    TailContext->ChangeNotificationCount = 0;
+}
+
 /**
  A callback that is invoked when a file is found that matches a search criteria
  specified in the set of strings to enumerate.
@@ -285,7 +962,20 @@ TailFileFoundCallback(
         }
 
         TailContext->SavedErrorThisArg = ERROR_SUCCESS;
-        TailProcessStream(FileHandle, TailContext);
+
+        //
+        //  Files on disk that are being followed are displayed once all
+        //  files have been found.
+        //
+
+        if (TailContext->WaitForMore &&
+            (GetFileType(FileHandle) & ~(FILE_TYPE_REMOTE)) == FILE_TYPE_DISK &&
+            TailAddFollowFile(TailContext, FilePath, FileHandle)) {
+
+            return TRUE;
+        }
+
+        TailProcessStream(FileHandle, TailContext, NULL);
 
         CloseHandle(FileHandle);
     }
@@ -393,6 +1083,7 @@ ENTRYPOINT(
     YORI_STRING Arg;
 
     ZeroMemory(&TailContext, sizeof(TailContext));
+    YoriLibInitializeListHead(&TailContext.FollowFileList);
     TailContext.LinesToDisplay = 10;
     ContextLine = -1;
 
@@ -472,6 +1163,13 @@ ENTRYPOINT(
 
     YoriLibEnableBackupPrivilege();
 
+    //
+    //  Output is generated a line at a time, so if it's going to a file or
+    //  pipe, buffer it to write in larger chunks.
+    //
+
+    YoriLibOutputEnableBuffering(GetStdHandle(STD_OUTPUT_HANDLE));
+
     for (Count = 0; Count < TailContext.LinesToDisplay; Count++) {
         YoriLibInitEmptyString(&TailContext.LinesArray[Count]);
     }
@@ -488,7 +1186,18 @@ ENTRYPOINT(
             return EXIT_FAILURE;
         }
 
-        TailProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TailContext);
+        //
+        //  If standard input is a file, it can be followed, although it
+        //  can't be reopened if it is replaced.  If it's a pipe, reading
+        //  waits for more data.
+        //
+
+        if (!TailContext.WaitForMore ||
+            (GetFileType(GetStdHandle(STD_INPUT_HANDLE)) & ~(FILE_TYPE_REMOTE)) != FILE_TYPE_DISK ||
+            !TailAddFollowFile(&TailContext, NULL, GetStdHandle(STD_INPUT_HANDLE))) {
+
+            TailProcessStream(GetStdHandle(STD_INPUT_HANDLE), &TailContext, NULL);
+        }
     } else {
         MatchFlags = YORILIB_FILEENUM_RETURN_FILES | YORILIB_FILEENUM_DIRECTORY_CONTENTS;
         if (TailContext.Recursive) {
@@ -525,6 +1234,11 @@ ENTRYPOINT(
         }
     }
 
+    if (TailContext.FollowFileCount > 0) {
+        TailFollowFiles(&TailContext);
+    }
+    TailCleanupFollowFiles(&TailContext);
+
     for (Count = 0; Count < TailContext.LinesToDisplay; Count++) {
         YoriLibFreeStringContents(&TailContext.LinesArray[Count]);
     }